@@ -20,16 +20,42 @@ static bool     s_gpio_state[GPIO_PIN_COUNT];
 static uint16_t s_adc_values[ADC_CHANNEL_COUNT];
 static bool     s_iwdg_reset = false;
 static uint32_t s_iwdg_feed_count = 0U;
+static uint32_t s_stack_free = BMS_TRACE_MAIN_STACK_BYTES;
 
-/* Mock I2C data store */
-#define MOCK_I2C_SIZE 4096U
+/* Mock I2C data store — 256 register bytes per module */
+#define MOCK_I2C_SIZE ((uint16_t)BMS_NUM_MODULES << 8U)
 static uint8_t s_i2c_data[MOCK_I2C_SIZE];
 static int32_t s_i2c_fail_result = 0;  /* 0=success, -1=fail */
+static uint8_t s_i2c_fail_module = 0xFFU;   /* this module only NACKs */
 static uint8_t s_selected_module = 0U;
-
-/* Mock NVM */
-#define MOCK_NVM_SIZE 4096U
-static uint8_t s_mock_nvm[MOCK_NVM_SIZE];
+static uint32_t s_i2c_txn_count = 0U;
+
+/* Mock AFE subcommand buffer: last subcommand per module, and the
+ * DASTATUS5 block served at 0x40.. while it is the active subcommand */
+#define MOCK_SUBCMD_REG       0x3EU
+#define MOCK_SUBCMD_DATA_REG  0x40U
+#define MOCK_SUBCMD_DASTATUS5 0x0075U
+#define MOCK_SUBCMD_DEVICE_NUM 0x0001U
+#define MOCK_DEVICE_NUMBER    0x7695U
+#define MOCK_DAS5_LEN         32U
+static uint16_t s_subcmd[BMS_NUM_MODULES];
+static uint8_t  s_das5[BMS_NUM_MODULES][MOCK_DAS5_LEN];
+
+/* Mock NVM — NOR flash semantics, see bms_hal.h */
+#define MOCK_NVM_SIZE        BMS_NVM_SIZE
+#define MOCK_NVM_SECTORS     (MOCK_NVM_SIZE / BMS_NVM_SECTOR_SIZE)
+#define MOCK_NVM_POWER_ON    0xFFFFFFFFU
+static uint8_t  s_mock_nvm[MOCK_NVM_SIZE];
+static uint32_t s_nvm_erase_count[MOCK_NVM_SECTORS];
+static uint32_t s_nvm_program_ops = 0U;
+static uint32_t s_nvm_program_bytes = 0U;
+static uint32_t s_nvm_violations = 0U;      /* non-erased byte or page straddle */
+static uint32_t s_nvm_power_bytes = MOCK_NVM_POWER_ON;
+static uint32_t s_nvm_erase_polls = 0U;     /* next erase reports busy this often */
+static uint32_t s_nvm_erase_left = 0U;
+static uint32_t s_nvm_erase_sector = 0U;
+static uint8_t  s_crit_depth = 0U;
+static uint32_t s_nvm_reads_in_crit = 0U;   /* flash access with IRQs off */
 
 /* Mock CAN */
 #define MOCK_CAN_RX_SIZE 16U
@@ -37,9 +63,34 @@ static bms_can_frame_t s_can_rx_buf[MOCK_CAN_RX_SIZE];
 static uint8_t s_can_rx_head = 0U;
 static uint8_t s_can_rx_tail = 0U;
 
-static bms_can_frame_t s_can_tx_buf[MOCK_CAN_RX_SIZE];
+#define MOCK_CAN_TX_SIZE 32U
+static bms_can_frame_t s_can_tx_buf[MOCK_CAN_TX_SIZE];
 static uint8_t s_can_tx_count = 0U;
 
+/* Mock bxCAN TX mailboxes — unlimited unless a test limits them */
+#define MOCK_CAN_MAILBOX_UNLIMITED 0xFFU
+static uint8_t s_can_mailbox_limit = MOCK_CAN_MAILBOX_UNLIMITED;
+static uint8_t s_can_mailbox_busy = 0U;
+static bool    s_can_tx_irq_enabled = true;
+static bool    s_can_rx_irq_armed = false;  /* tests play the ISR when set */
+
+/* Mock CAN FD TX capture */
+#define MOCK_CANFD_TX_SIZE 32U
+static bms_canfd_frame_t s_canfd_tx_buf[MOCK_CANFD_TX_SIZE];
+static uint8_t s_canfd_tx_count = 0U;
+
+/* Mock STOP: sleeping advances the tick; one wake event can be scheduled */
+static uint32_t   s_stop_count = 0U;
+static uint32_t   s_stop_ms = 0U;
+static bool       s_wake_pending = false;
+static uint32_t   s_wake_at = 0U;
+static hal_wake_t s_wake_src = HAL_WAKE_TIMER;
+static bool       s_afe_alert = false;
+
+/* P2-01: commissioned CAN auth key (unprovisioned by default) */
+static uint8_t s_auth_key[16];
+static bool    s_auth_key_set = false;
+
 /* ── Mock control API (for tests) ──────────────────────────────────── */
 
 void mock_reset_all(void)
@@ -48,13 +99,37 @@ void mock_reset_all(void)
     memset(s_gpio_state, 0, sizeof(s_gpio_state));
     memset(s_adc_values, 0, sizeof(s_adc_values));
     memset(s_i2c_data, 0, sizeof(s_i2c_data));
-    memset(s_mock_nvm, 0, sizeof(s_mock_nvm));
+    memset(s_subcmd, 0, sizeof(s_subcmd));
+    memset(s_das5, 0, sizeof(s_das5));
+    s_i2c_txn_count = 0U;
+    memset(s_mock_nvm, 0xFF, sizeof(s_mock_nvm));
+    memset(s_nvm_erase_count, 0, sizeof(s_nvm_erase_count));
+    s_nvm_program_ops = 0U;
+    s_nvm_program_bytes = 0U;
+    s_nvm_violations = 0U;
+    s_nvm_power_bytes = MOCK_NVM_POWER_ON;
+    s_nvm_erase_polls = 0U;
+    s_nvm_erase_left = 0U;
+    s_crit_depth = 0U;
+    s_nvm_reads_in_crit = 0U;
     s_i2c_fail_result = 0;
+    s_i2c_fail_module = 0xFFU;
     s_iwdg_reset = false;
     s_iwdg_feed_count = 0U;
+    s_stack_free = BMS_TRACE_MAIN_STACK_BYTES;
+    s_auth_key_set = false;
     s_can_rx_head = 0U;
     s_can_rx_tail = 0U;
     s_can_tx_count = 0U;
+    s_canfd_tx_count = 0U;
+    s_can_mailbox_limit = MOCK_CAN_MAILBOX_UNLIMITED;
+    s_can_mailbox_busy = 0U;
+    s_can_tx_irq_enabled = true;
+    s_can_rx_irq_armed = false;
+    s_stop_count = 0U;
+    s_stop_ms = 0U;
+    s_wake_pending = false;
+    s_afe_alert = false;
 }
 
 void mock_set_tick(uint32_t tick_ms) { s_tick = tick_ms; }
@@ -62,6 +137,7 @@ void mock_advance_tick(uint32_t ms) { s_tick += ms; }
 void mock_set_gpio(bms_gpio_pin_t pin, bool state) { s_gpio_state[pin] = state; }
 void mock_set_adc(bms_adc_channel_t ch, uint16_t val) { s_adc_values[ch] = val; }
 void mock_set_i2c_fail(int32_t result) { s_i2c_fail_result = result; }
+void mock_set_i2c_fail_module(uint8_t module) { s_i2c_fail_module = module; }
 void mock_set_iwdg_reset(bool was_reset) { s_iwdg_reset = was_reset; }
 uint32_t mock_get_iwdg_feed_count(void) { return s_iwdg_feed_count; }
 
@@ -82,6 +158,42 @@ const bms_can_frame_t *mock_get_can_tx(uint8_t idx)
     return NULL;
 }
 
+void mock_clear_can_tx(void) { s_can_tx_count = 0U; }
+
+uint32_t mock_get_nvm_erase_count(uint8_t sector) { return s_nvm_erase_count[sector]; }
+uint32_t mock_get_nvm_program_ops(void) { return s_nvm_program_ops; }
+uint32_t mock_get_nvm_program_bytes(void) { return s_nvm_program_bytes; }
+uint32_t mock_get_nvm_violations(void) { return s_nvm_violations; }
+uint32_t mock_get_nvm_reads_in_critical(void) { return s_nvm_reads_in_crit; }
+
+/* Following erases stay busy for n polls of bms_hal_nvm_erase_busy() */
+void mock_nvm_erase_busy_polls(uint32_t n) { s_nvm_erase_polls = n; }
+
+/* Power fails after n more programmed bytes (partial program, then every
+ * write and erase is lost); MOCK_NVM_POWER_ON restores it — i.e. reboot. */
+void mock_nvm_power_cut_after(uint32_t n) { s_nvm_power_bytes = n; }
+
+/* Test-only back door: corrupt flash without going through program rules */
+void mock_nvm_poke(uint32_t addr, uint8_t val)
+{
+    if (addr < MOCK_NVM_SIZE) { s_mock_nvm[addr] = val; }
+}
+
+/* Emulate bxCAN: n mailboxes; transmit fails once all are pending */
+void mock_set_can_mailboxes(uint8_t n) { s_can_mailbox_limit = n; s_can_mailbox_busy = 0U; }
+/* All pending mailboxes finished — test then calls the TX-complete ISR */
+void mock_can_tx_complete(void) { s_can_mailbox_busy = 0U; }
+bool mock_get_can_tx_irq_enabled(void) { return s_can_tx_irq_enabled; }
+
+uint8_t mock_get_canfd_tx_count(void) { return s_canfd_tx_count; }
+void mock_clear_canfd_tx(void) { s_canfd_tx_count = 0U; }
+
+const bms_canfd_frame_t *mock_get_canfd_tx(uint8_t idx)
+{
+    if (idx < s_canfd_tx_count) { return &s_canfd_tx_buf[idx]; }
+    return NULL;
+}
+
 /* Store I2C data for read-back (indexed by module << 8 | reg) */
 void mock_set_i2c_reg16(uint8_t module, uint8_t reg, uint16_t val)
 {
@@ -100,23 +212,73 @@ void mock_set_i2c_reg8(uint8_t module, uint8_t reg, uint8_t val)
     }
 }
 
+static void das5_put16(uint8_t module, uint8_t off, uint16_t val)
+{
+    s_das5[module][off] = (uint8_t)(val & 0xFFU);
+    s_das5[module][off + 1U] = (uint8_t)((val >> 8U) & 0xFFU);
+}
+
+/* DASTATUS5 summary for one module (temperatures in 0.1°C, sent as 0.1K) */
+void mock_set_afe_summary(uint8_t module, uint16_t max_mv, uint16_t min_mv,
+                          uint32_t stack_mv, int16_t max_dc, int16_t min_dc,
+                          int16_t avg_dc)
+{
+    if (module >= BMS_NUM_MODULES) { return; }
+    das5_put16(module, 4U, max_mv);
+    das5_put16(module, 6U, min_mv);
+    das5_put16(module, 8U, (uint16_t)(stack_mv / 10U));
+    das5_put16(module, 10U, (uint16_t)(avg_dc + 2731));
+    das5_put16(module, 14U, (uint16_t)(max_dc + 2731));
+    das5_put16(module, 16U, (uint16_t)(min_dc + 2731));
+    das5_put16(module, 18U, (uint16_t)(avg_dc + 2731));
+}
+
+uint32_t mock_get_i2c_txn_count(void) { return s_i2c_txn_count; }
+void mock_clear_i2c_txn_count(void) { s_i2c_txn_count = 0U; }
+
 /* ── HAL implementations ───────────────────────────────────────────── */
 
 void hal_i2c_select_module(uint8_t module_id) { s_selected_module = module_id; }
 
 int32_t hal_i2c_write(uint8_t addr, const uint8_t *data, uint16_t len)
 {
-    (void)addr; (void)data; (void)len;
-    return s_i2c_fail_result;
+    (void)addr;
+    s_i2c_txn_count++;
+    if (s_i2c_fail_result != 0) { return s_i2c_fail_result; }
+    if (s_selected_module == s_i2c_fail_module) { return -1; }
+    if (len >= 3U && data[0] == MOCK_SUBCMD_REG &&
+        s_selected_module < BMS_NUM_MODULES) {
+        uint16_t buf = ((uint16_t)s_selected_module << 8U) | MOCK_SUBCMD_DATA_REG;
+        s_subcmd[s_selected_module] = (uint16_t)((uint16_t)data[2] << 8U) | data[1];
+        if (len > 3U) {
+            /* Data-memory write: lands in the transfer buffer, so the
+             * read-back subcommand that follows returns it */
+            memcpy(&s_i2c_data[buf], &data[3], (size_t)len - 3U);
+        } else if (s_subcmd[s_selected_module] == MOCK_SUBCMD_DEVICE_NUM) {
+            s_i2c_data[buf] = (uint8_t)(MOCK_DEVICE_NUMBER & 0xFFU);
+            s_i2c_data[buf + 1U] = (uint8_t)(MOCK_DEVICE_NUMBER >> 8U);
+        }
+    }
+    return 0;
 }
 
 int32_t hal_i2c_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len)
 {
     (void)addr;
+    s_i2c_txn_count++;
     if (s_i2c_fail_result != 0) { return s_i2c_fail_result; }
+    if (s_selected_module == s_i2c_fail_module) { return -1; }
 
     uint16_t base = ((uint16_t)s_selected_module << 8U) | reg;
     uint16_t i;
+
+    if (s_selected_module < BMS_NUM_MODULES &&
+        s_subcmd[s_selected_module] == MOCK_SUBCMD_DASTATUS5 &&
+        reg >= MOCK_SUBCMD_DATA_REG &&
+        (uint16_t)(reg - MOCK_SUBCMD_DATA_REG) + len <= MOCK_DAS5_LEN) {
+        memcpy(buf, &s_das5[s_selected_module][reg - MOCK_SUBCMD_DATA_REG], len);
+        return 0;
+    }
     for (i = 0U; i < len && (base + i) < MOCK_I2C_SIZE; i++) {
         buf[i] = s_i2c_data[base + i];
     }
@@ -149,12 +311,34 @@ uint16_t hal_fan_tach_read_rpm(void) { return s_mock_fan_rpm; }
 
 int32_t hal_can_transmit(const bms_can_frame_t *frame)
 {
-    if (s_can_tx_count < MOCK_CAN_RX_SIZE) {
+    if (s_can_mailbox_limit != MOCK_CAN_MAILBOX_UNLIMITED) {
+        if (s_can_mailbox_busy >= s_can_mailbox_limit) { return -1; }
+        s_can_mailbox_busy++;
+    }
+    if (s_can_tx_count < MOCK_CAN_TX_SIZE) {
         s_can_tx_buf[s_can_tx_count++] = *frame;
     }
     return 0;
 }
 
+uint8_t hal_can_tx_free_mailboxes(void)
+{
+    if (s_can_mailbox_limit == MOCK_CAN_MAILBOX_UNLIMITED) { return 3U; }
+    return (uint8_t)(s_can_mailbox_limit - s_can_mailbox_busy);
+}
+
+void hal_can_tx_irq_enable(bool enable) { s_can_tx_irq_enabled = enable; }
+bool hal_can_rx_irq_armed(void) { return s_can_rx_irq_armed; }
+void mock_set_can_rx_irq_armed(bool armed) { s_can_rx_irq_armed = armed; }
+
+int32_t hal_canfd_transmit(const bms_canfd_frame_t *frame)
+{
+    if (s_canfd_tx_count < MOCK_CANFD_TX_SIZE) {
+        s_canfd_tx_buf[s_canfd_tx_count++] = *frame;
+    }
+    return 0;
+}
+
 int32_t hal_can_receive(bms_can_frame_t *frame)
 {
     if (s_can_rx_tail == s_can_rx_head) { return 1; }
@@ -164,32 +348,128 @@ int32_t hal_can_receive(bms_can_frame_t *frame)
 }
 
 void hal_can_set_filter(uint32_t id1, uint32_t id2) { (void)id1; (void)id2; }
+void hal_can_add_filter(uint32_t id) { (void)id; }
 
 uint32_t hal_tick_ms(void) { return s_tick; }
 void hal_delay_ms(uint32_t ms) { s_tick += ms; }
 
+/* Interrupt at at_ms: wakes a STOP in progress (an AFE alert also
+ * asserts the ALERT level until mock_set_afe_alert(false)) */
+void mock_schedule_wake(uint32_t at_ms, hal_wake_t src)
+{
+    s_wake_pending = true;
+    s_wake_at = at_ms;
+    s_wake_src = src;
+}
+
+void mock_set_afe_alert(bool active) { s_afe_alert = active; }
+uint32_t mock_get_stop_count(void) { return s_stop_count; }
+uint32_t mock_get_stop_ms(void) { return s_stop_ms; }
+
+hal_wake_t hal_stop_ms(uint32_t ms)
+{
+    int32_t until = (int32_t)(s_wake_at - s_tick);
+
+    s_stop_count++;
+    if (s_afe_alert) { return HAL_WAKE_AFE_ALERT; }  /* EXTI already pending */
+    if (s_wake_pending && until <= (int32_t)ms) {
+        uint32_t slept = (until > 0) ? (uint32_t)until : 0U;
+        s_tick += slept;
+        s_stop_ms += slept;
+        s_wake_pending = false;
+        if (s_wake_src == HAL_WAKE_AFE_ALERT) { s_afe_alert = true; }
+        return s_wake_src;
+    }
+    s_tick += ms;
+    s_stop_ms += ms;
+    return HAL_WAKE_TIMER;
+}
+
+bool hal_afe_alert_active(void) { return s_afe_alert; }
+uint32_t hal_cycle_count(void) { return 0U; }   /* no DWT on the host */
+uint32_t hal_stack_free_bytes(void) { return s_stack_free; }
+void mock_set_stack_free_bytes(uint32_t n) { s_stack_free = n; }
+
+int32_t hal_aes128_encrypt(const uint8_t key[16], const uint8_t in[16], uint8_t out[16])
+{
+    (void)key; (void)in; (void)out;
+    return -1;   /* no crypto engine — software AES */
+}
+
+void mock_set_can_auth_key(const uint8_t *key)
+{
+    s_auth_key_set = (key != NULL);
+    if (key != NULL) { memcpy(s_auth_key, key, sizeof(s_auth_key)); }
+}
+
+int32_t hal_can_auth_key(uint8_t key[16])
+{
+    if (!s_auth_key_set) { return -1; }
+    memcpy(key, s_auth_key, sizeof(s_auth_key));
+    return 0;
+}
+
 void hal_init(void) { mock_reset_all(); }
-void hal_critical_enter(void) { }
-void hal_critical_exit(void) { }
+void hal_critical_enter(void) { s_crit_depth++; }
+void hal_critical_exit(void) { if (s_crit_depth > 0U) { s_crit_depth--; } }
 void hal_system_reset(void) { }
 
 void hal_iwdg_init(uint32_t timeout_ms) { (void)timeout_ms; }
 void hal_iwdg_feed(void) { s_iwdg_feed_count++; }
 bool hal_iwdg_was_reset(void) { return s_iwdg_reset; }
+void hal_brownout_init(void) { }
 
 void bms_hal_nvm_write(uint32_t addr, const void *data, uint16_t len)
 {
-    if (addr + len <= MOCK_NVM_SIZE) {
-        memcpy(&s_mock_nvm[addr], data, len);
+    const uint8_t *p = (const uint8_t *)data;
+    uint16_t i;
+
+    if (addr + len > MOCK_NVM_SIZE || len == 0U) { return; }
+    if ((addr / BMS_NVM_PAGE_SIZE) != ((addr + len - 1U) / BMS_NVM_PAGE_SIZE)) {
+        s_nvm_violations++;       /* real parts wrap within the page */
+        return;
     }
+    if (s_nvm_erase_left > 0U && addr / BMS_NVM_SECTOR_SIZE == s_nvm_erase_sector) {
+        s_nvm_violations++;       /* programming the sector still erasing */
+        return;
+    }
+    s_nvm_program_ops++;
+    for (i = 0U; i < len; i++) {
+        if (s_nvm_power_bytes == 0U) { return; }
+        if (s_nvm_power_bytes != MOCK_NVM_POWER_ON) { s_nvm_power_bytes--; }
+        if (s_mock_nvm[addr + i] != 0xFFU) { s_nvm_violations++; }
+        s_mock_nvm[addr + i] &= p[i];  /* program only clears bits */
+        s_nvm_program_bytes++;
+    }
+}
+
+/* Erased at once; "busy" only holds the sector off limits for a while */
+void bms_hal_nvm_erase_start(uint32_t addr)
+{
+    uint32_t sector = addr / BMS_NVM_SECTOR_SIZE;
+
+    if (sector >= MOCK_NVM_SECTORS || s_nvm_power_bytes == 0U) { return; }
+    if (s_nvm_erase_left > 0U) { s_nvm_violations++; }   /* one at a time */
+    memset(&s_mock_nvm[sector * BMS_NVM_SECTOR_SIZE], 0xFF, BMS_NVM_SECTOR_SIZE);
+    s_nvm_erase_count[sector]++;
+    s_nvm_erase_sector = sector;
+    s_nvm_erase_left = s_nvm_erase_polls;
+}
+
+bool bms_hal_nvm_erase_busy(void)
+{
+    if (s_nvm_erase_left == 0U) { return false; }
+    s_nvm_erase_left--;
+    return true;
 }
 
 void bms_hal_nvm_read(uint32_t addr, void *data, uint16_t len)
 {
+    if (s_crit_depth > 0U) { s_nvm_reads_in_crit++; }
     if (addr + len <= MOCK_NVM_SIZE) {
         memcpy(data, &s_mock_nvm[addr], len);
     } else {
-        memset(data, 0, len);
+        memset(data, 0xFF, len);
     }
 }
 
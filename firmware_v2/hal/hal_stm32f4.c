@@ -67,6 +67,51 @@ bool hal_iwdg_was_reset(void)
     return s_iwdg_was_reset;
 }
 
+/* ── Brownout (PVD) ────────────────────────────────────────────────── */
+
+void hal_brownout_init(void)
+{
+    /* PVD at 2.9 V (PLS level 7), EXTI line 16 rising edge:
+     * PWR->CR |= PWR_CR_PLS_LEV7 | PWR_CR_PVDE;
+     * EXTI->IMR |= EXTI_IMR_MR16; EXTI->RTSR |= EXTI_RTSR_TR16;
+     * NVIC_EnableIRQ(PVD_IRQn);
+     * PVD_IRQHandler: EXTI->PR = EXTI_PR_PR16; bms_nvm_queue_brownout_isr(); */
+}
+
+/* ── Low power (STOP) ──────────────────────────────────────────────── */
+
+static volatile hal_wake_t s_wake_src;
+
+/* EXTI handlers set s_wake_src before the core leaves STOP:
+ *   ALERT  PB8, EXTI8 falling (open-drain, wired-OR across modules)
+ *   CAN    PD0 (CAN1_RX) EXTI0 falling, armed only for STOP: the bxCAN
+ *          clock is off in STOP, so the waking frame itself is lost
+ *   RTC    wakeup timer, EXTI22 */
+hal_wake_t hal_stop_ms(uint32_t ms)
+{
+    s_wake_src = HAL_WAKE_OTHER;
+    /* RTC->WPR = 0xCA; RTC->WPR = 0x53; RTC->CR &= ~RTC_CR_WUTE;
+     * while (!(RTC->ISR & RTC_ISR_WUTWF)) { }
+     * RTC->WUTR = ms * 2U - 1U;                   (LSI/16 = 2 kHz)
+     * RTC->CR |= RTC_CR_WUTE | RTC_CR_WUTIE;
+     * EXTI->IMR |= EXTI_IMR_MR0;                  (CAN RX edge)
+     * SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+     * PWR->CR |= PWR_CR_LPDS; PWR->CR &= ~PWR_CR_PDDS;
+     * SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk; __WFI();
+     * SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+     * SystemClock_Config();                       (HSE + PLL back, 168 MHz)
+     * EXTI->IMR &= ~EXTI_IMR_MR0;
+     * slept = (WUTR - RTC->WUTR countdown) / 2;   (RTC is the timebase)
+     * s_tick_ms += slept; SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk; */
+    (void)ms;
+    return s_wake_src;
+}
+
+bool hal_afe_alert_active(void)
+{
+    return false; /* return (GPIOB->IDR & GPIO_IDR_IDR_8) == 0U; */
+}
+
 /* ── I2C ───────────────────────────────────────────────────────────── */
 
 void hal_i2c_select_module(uint8_t module_id)
@@ -147,18 +192,53 @@ int32_t hal_can_transmit(const bms_can_frame_t *frame)
     return 0;
 }
 
+uint8_t hal_can_tx_free_mailboxes(void)
+{
+    /* Count of CAN1->TSR TME0..TME2 set */
+    return 3U;
+}
+
+void hal_can_tx_irq_enable(bool enable)
+{
+    /* TX-complete ISR (CAN1_TX_IRQHandler) calls bms_can_txq_isr()
+     * after clearing RQCPx. enable ? NVIC_EnableIRQ(CAN1_TX_IRQn)
+     *                               : NVIC_DisableIRQ(CAN1_TX_IRQn) */
+    (void)enable;
+}
+
 int32_t hal_can_receive(bms_can_frame_t *frame)
 {
     (void)frame;
     return 1; /* no frame */
 }
 
+bool hal_can_rx_irq_armed(void)
+{
+    /* CAN1_RX0_IRQHandler empties FIFO0 into bms_can_rx_isr(); FMPIE0
+     * and NVIC_EnableIRQ(CAN1_RX0_IRQn) are set in hal_init */
+    return true;
+}
+
 void hal_can_set_filter(uint32_t id1, uint32_t id2)
 {
     /* Configure CAN hardware filter bank to accept only id1 and id2 */
     (void)id1; (void)id2;
 }
 
+void hal_can_add_filter(uint32_t id)
+{
+    /* Next free bxCAN filter bank, 32-bit identifier-list mode */
+    (void)id;
+}
+
+int32_t hal_canfd_transmit(const bms_canfd_frame_t *frame)
+{
+    /* bxCAN on the F4 is classic CAN only; FD needs an external
+     * controller (e.g. MCP2518FD on SPI). Not fitted on this board. */
+    (void)frame;
+    return -1;
+}
+
 /* ── Timing ────────────────────────────────────────────────────────── */
 
 static volatile uint32_t s_tick_ms = 0U;
@@ -166,12 +246,57 @@ static volatile uint32_t s_tick_ms = 0U;
 uint32_t hal_tick_ms(void) { return s_tick_ms; }
 void hal_delay_ms(uint32_t ms) { (void)ms; /* HAL_Delay(ms); */ }
 
+uint32_t hal_cycle_count(void)
+{
+    /* Enabled in hal_init(): CoreDebug->DEMCR |= TRCENA; DWT->CTRL |= CYCCNTENA */
+    return 0U; /* return DWT->CYCCNT; */
+}
+
+uint32_t hal_stack_free_bytes(void)
+{
+    /* Reset_Handler fills _sstack.._estack with BMS_TRACE_STACK_PAINT
+     * before main(); the stack grows down, so count from the bottom:
+     *   const uint32_t *p = _sstack;
+     *   while (p < _estack && *p == BMS_TRACE_STACK_PAINT) { p++; }
+     *   return (uint32_t)(p - _sstack) * 4U; */
+    return BMS_TRACE_MAIN_STACK_BYTES;
+}
+
+/* ── Crypto (P2-01) ────────────────────────────────────────────────── */
+
+int32_t hal_aes128_encrypt(const uint8_t key[16], const uint8_t in[16], uint8_t out[16])
+{
+    /* F405/F407 have no CRYP block. On F415/F417: CRYP->CR = AES-ECB,
+     * 128-bit key in K2..K3 registers, write DIN ×4, poll OFNE, read DOUT. */
+    (void)key; (void)in; (void)out;
+    return -1;
+}
+
+/* Key lives in the last OTP block (0x1FFF7800 + 15 × 32), written once at
+ * commissioning and locked via its OTP lock byte. All-0xFF = blank. */
+#define BMS_OTP_AUTH_KEY_ADDR  (0x1FFF7800UL + 15UL * 32UL)
+
+int32_t hal_can_auth_key(uint8_t key[16])
+{
+    const volatile uint8_t *otp = (const volatile uint8_t *)BMS_OTP_AUTH_KEY_ADDR;
+    uint8_t all = 0xFFU;
+    uint8_t i;
+
+    for (i = 0U; i < 16U; i++) {
+        key[i] = otp[i];
+        all &= key[i];
+    }
+    return (all == 0xFFU) ? -1 : 0;
+}
+
 /* ── System ────────────────────────────────────────────────────────── */
 
 void hal_init(void)
 {
     /* HAL_Init(); SystemClock_Config(); MX_GPIO_Init(); MX_I2C1_Init();
      * MX_CAN1_Init(); MX_ADC1_Init(); */
+    /* CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+     * DWT->CYCCNT = 0U; DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; */
 }
 
 void hal_critical_enter(void) { /* __disable_irq(); */ }
@@ -190,6 +315,20 @@ void bms_hal_nvm_read(uint32_t addr, void *data, uint16_t len)
     (void)addr; (void)data; (void)len;
 }
 
+/* Sector erase: the external NOR's 4 KiB sector erase (0x20), left
+ * running. addr is relative to the journal base. read/write above wrap
+ * themselves in erase suspend (0x75) / resume (0x7A) while it runs. */
+void bms_hal_nvm_erase_start(uint32_t addr)
+{
+    (void)addr;
+}
+
+/* Status register 1, WIP bit */
+bool bms_hal_nvm_erase_busy(void)
+{
+    return false;
+}
+
 /* ── Balance ───────────────────────────────────────────────────────── */
 
 void bms_hal_bq76952_set_balance(uint8_t module_id, uint16_t cell_mask)
@@ -0,0 +1,117 @@
+/**
+ * @file bms_blackbox.h
+ * @brief Pre/post-fault black-box recorder
+ *
+ * Street Smart Edition.
+ * The NVM fault log says WHAT tripped; this says what the pack was doing
+ * on the way there. Every protection cycle (BMS_BBOX_PERIOD_MS) one pack
+ * summary — min/max cell, current, max temperature, mode, fault flags —
+ * is delta-coded into a RAM ring of BMS_BBOX_BLOCKS page-sized blocks.
+ * On the rising edge of fault_latched the recorder keeps going for
+ * BMS_BBOX_POST_MS, then freezes; the NVM task streams the frozen ring to
+ * its own flash region (BMS_NVM_BBOX_BASE) a few pages per slot, and
+ * recording resumes once the copy is verified.
+ *
+ * Block layout (big-endian, BMS_BBOX_BLOCK_SIZE bytes, 0xFF padded):
+ *   [0..3]   t0_ms      tick of the keyframe; sample i is t0 + i × period
+ *   [4..5]   count      samples in the block, keyframe included
+ *   [6..7]   seq        running block number
+ *   [8..20]  keyframe   min_mv u16, max_mv u16, current_da i16,
+ *                       max_temp_deci_c i16, mode u8, faults u32
+ *   [21..]   deltas     tag byte, 2 bits per field — current [7:6],
+ *                       min [5:4], max [3:2], temp [1:0]:
+ *                       0 unchanged, 1 i8 delta, 2 absolute 16-bit
+ *                       followed by the field bytes in that order
+ * A mode or fault-flag change always opens a new block, so every block
+ * decodes on its own.
+ *
+ * Stored capture: a header page at BMS_NVM_BBOX_BASE, then the blocks
+ * oldest first. The header is programmed last, after every block has
+ * been read back — a capture torn by power loss simply isn't there.
+ *
+ * Retrieval: ISO-TP diagnostics, DID 0xF103 (header) and 0xF200 + n
+ * (block n) — see bms_can_diag.h.
+ */
+
+#ifndef BMS_BLACKBOX_H
+#define BMS_BLACKBOX_H
+
+#include "bms_types.h"
+
+#define BMS_BBOX_KEY_OFFSET   8U
+#define BMS_BBOX_DELTA_OFFSET 21U
+
+typedef enum {
+    BBOX_RECORDING = 0,
+    BBOX_POST_TRIGGER,      /* latched — recording the post window */
+    BBOX_FROZEN,            /* ring frozen, NVM task streaming it */
+    BBOX_STORED             /* stream done; recorder restarts next sample */
+} bms_blackbox_state_t;
+
+typedef struct {
+    uint32_t t_ms;
+    uint16_t min_cell_mv;
+    uint16_t max_cell_mv;
+    int16_t  current_da;        /* 0.1 A, truncated, saturated */
+    int16_t  max_temp_deci_c;
+    uint8_t  mode;
+    uint32_t faults;            /* bms_fault_flags_t bits */
+} bms_blackbox_sample_t;
+
+/* Header of the capture stored in flash */
+typedef struct {
+    uint16_t blocks;
+    uint16_t trigger_block;     /* capture order, 0 = oldest */
+    uint16_t trigger_sample;    /* index within that block */
+    uint32_t trigger_ms;
+    uint32_t faults;            /* fault flags of the trigger sample */
+    uint32_t first_ms;
+    uint32_t last_ms;
+    uint32_t capture;           /* trigger count since boot */
+} bms_blackbox_info_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t blocks;            /* blocks opened */
+    uint32_t triggers;
+    uint32_t stored;            /* captures committed to flash */
+    uint32_t store_fail;        /* program/verify failure, capture dropped */
+    uint32_t frozen_skips;      /* samples not taken while frozen */
+} bms_blackbox_stats_t;
+
+void bms_blackbox_init(void);
+
+/**
+ * Take one sample (protection task, every BMS_BBOX_PERIOD_MS). O(1),
+ * no flash access. Triggers on the rising edge of pack->fault_latched.
+ */
+void bms_blackbox_record(const bms_pack_data_t *pack);
+
+/**
+ * Stream up to BMS_BBOX_PAGES_PER_FLUSH pages of a frozen capture to
+ * flash (NVM task).
+ * @return true while a capture is still being written
+ */
+bool bms_blackbox_flush(void);
+
+bms_blackbox_state_t bms_blackbox_state(void);
+
+/** RAM history currently held, first to last sample. */
+uint32_t bms_blackbox_span_ms(void);
+
+/** Stored capture header; false if flash holds no complete capture. */
+bool bms_blackbox_get_info(bms_blackbox_info_t *out);
+
+/** Copy stored block n (capture order) out of flash. */
+bool bms_blackbox_read_block(uint16_t n, uint8_t *out);
+
+/**
+ * Decode one block into samples (host tools, tests).
+ * @return samples written to out, 0 if the block is malformed
+ */
+uint16_t bms_blackbox_decode_block(const uint8_t *blk,
+                                   bms_blackbox_sample_t *out, uint16_t max);
+
+void bms_blackbox_get_stats(bms_blackbox_stats_t *out);
+
+#endif /* BMS_BLACKBOX_H */
@@ -50,6 +50,16 @@
 #define BQ76952_SUBCMD_RESET            0x0012U
 #define BQ76952_SUBCMD_SET_CFGUPDATE    0x0090U
 #define BQ76952_SUBCMD_EXIT_CFGUPDATE   0x0092U
+#define BQ76952_SUBCMD_DASTATUS5        0x0075U
+
+/* ── DASTATUS5 response layout (offsets into 0x40 buffer) ──────────── */
+#define BQ76952_DAS5_MAX_CELL_MV    4U
+#define BQ76952_DAS5_MIN_CELL_MV    6U
+#define BQ76952_DAS5_BAT_SUM_CV     8U
+#define BQ76952_DAS5_MAX_TEMP_DK   14U
+#define BQ76952_DAS5_MIN_TEMP_DK   16U
+#define BQ76952_DAS5_AVG_TEMP_DK   18U
+#define BQ76952_DAS5_FETCH_LEN     16U   /* bytes 4..19 */
 
 /* ── Safety Status A bitfields ─────────────────────────────────────── */
 #define BQ_SSA_SC_DCHG    (1U << 0)
@@ -80,6 +90,14 @@
 #define BQ76952_DM_SCD_THRESHOLD       0x9286U
 #define BQ76952_DM_SCD_DELAY           0x9287U
 #define BQ76952_DM_FET_OPTIONS         0x9308U
+#define BQ76952_DM_DEFAULT_ALARM_MASK  0x926DU  /* Alarm Status bits that drive ALERT */
+
+/* ── Alarm mask bits (ALERT wake in POWER_SAVE) ────────────────────── */
+#define BQ_ALARM_SSBC         (1U << 15)  /* Safety Status B/C */
+#define BQ_ALARM_SSA          (1U << 14)  /* Safety Status A */
+#define BQ_ALARM_PF           (1U << 13)  /* Permanent fail */
+#define BQ_ALARM_MSK_SFALERT  (1U << 12)  /* Safety alert (pre-trip) */
+#define BQ_ALARM_MSK_PFALERT  (1U << 11)  /* PF alert */
 
 /* ── P1-01: Protection Enable Bitmasks ─────────────────────────────── */
 #define BQ_PROT_A_SC_DCHG    (1U << 0)
@@ -114,6 +132,16 @@ uint16_t bq76952_read_stack_voltage(uint8_t module_id);
 int16_t  bq76952_read_temperature(uint8_t module_id, uint8_t sensor_idx);
 
 int32_t  bq76952_read_current(uint8_t module_id);
+
+/**
+ * Summary fast path (DASTATUS5). The AFE computes max/min cell voltage,
+ * the cell-voltage sum and max/min/avg cell temperature on chip, so one
+ * subcommand + one 16-byte block read replaces 14 cell + 3 TS reads.
+ * Pipelined: request on tick N, fetch on tick N+1, which also gives the
+ * AFE its subcommand turnaround time without a blocking delay.
+ */
+int32_t  bq76952_request_summary(uint8_t module_id);
+int32_t  bq76952_fetch_summary(uint8_t module_id, bms_bq_summary_t *out);
 int32_t  bq76952_read_safety(uint8_t module_id, bms_bq_safety_t *out);
 int32_t  bq76952_enter_config(uint8_t module_id);
 int32_t  bq76952_exit_config(uint8_t module_id);
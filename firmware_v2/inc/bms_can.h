@@ -5,13 +5,14 @@
  * Street Smart Edition.
  * Reviewer findings addressed:
  *   P2-06: Input validation — range checks, negative rejection (Yara)
- *   CC-01: Noted unauthenticated (all 6 reviewers) — auth deferred to P2-01
+ *   CC-01: AES-128-CMAC authentication — see bms_can_auth.h (P2-01)
  */
 
 #ifndef BMS_CAN_H
 #define BMS_CAN_H
 
 #include "bms_types.h"
+#include "bms_can_auth.h"
 
 void bms_can_init(void);
 
@@ -35,16 +36,7 @@ int32_t bms_can_decode_ems_command(const bms_can_frame_t *frame,
                                     bms_ems_command_t *cmd);
 
 void bms_can_tx_periodic(const bms_pack_data_t *pack);
+/** Drain all received frames into one merged command (see bms_can_rx.h). */
 bool bms_can_rx_process(bms_ems_command_t *cmd);
 
-/**
- * CC-01 / P2-01: CAN authentication stubs.
- * Sequence counter tracking is implemented; AES-128-CMAC deferred.
- * Gated by BMS_CAN_AUTH_ENABLED config flag.
- */
-bool bms_can_auth_verify(const bms_can_frame_t *frame);
-void bms_can_auth_sign(bms_can_frame_t *frame);
-uint16_t bms_can_auth_get_tx_seq(void);
-uint16_t bms_can_auth_get_rx_seq(void);
-
 #endif /* BMS_CAN_H */
@@ -0,0 +1,104 @@
+/**
+ * @file bms_can_auth.h
+ * @brief CC-01 / P2-01: AES-128-CMAC CAN frame authentication
+ *
+ * Street Smart Edition.
+ * One 32-bit freshness value (FV) per direction, incremented for every
+ * authenticated frame. The MAC always covers the full FV, so a replayed or
+ * reordered frame fails even when only the low bits travel on the wire.
+ *
+ *   MAC input = ID (u32 BE) ‖ FV (u32 BE) ‖ payload
+ *
+ * Classic layouts (DLC 8):
+ *   EMS command / other   [0..4] payload  [5] FV low byte  [6:7] CMAC[0:1]
+ *   EMS heartbeat (sync)  [0..3] FV       [4:7] CMAC[0:3]
+ *   The receiver rebuilds the FV as the smallest value > last accepted
+ *   with the received low byte, so up to 255 lost frames are tolerated;
+ *   the 1 Hz heartbeat carries the whole FV and resynchronises after any
+ *   longer outage.
+ * CAN FD layout:
+ *   payload (≤ BMS_CANFD_AUTH_PAYLOAD_MAX), zero pad, then the last 12
+ *   bytes of the rounded frame = FV (u32 BE) ‖ CMAC[0:7].
+ *
+ * Cost: every classic verify is exactly one AES block (≤ 13-byte MAC
+ * input), an FD verify at most four. With BMS_CAN_RX_DEPTH frames per
+ * state cycle the worst case is checked against BMS_CAN_AUTH_BUDGET_PCT
+ * at compile time (bms_can_auth.c); make bench measures it on the host.
+ *
+ * Forgery: a command carries only 16 MAC bits, so guessing is rate
+ * limited: a bucket of BMS_CAN_AUTH_FAIL_BURST bad command MACs, one
+ * back per BMS_CAN_AUTH_FAIL_REFILL_MS; emptying it starts a hold-off in
+ * which every command is rejected unchecked — a good guess looks the same as a
+ * bad one. That is ≤ 4 guesses per 10 s, about a day on average for a
+ * 1-in-65536 hit, and every hold-off is latched in the stats and logged
+ * to NVM (NVM_FAULT_CAN_AUTH). Heartbeats (32-bit MAC) are not held off,
+ * so the EMS watchdog stays fed.
+ *
+ * Replay across a reset: the receive FV high-water mark is persisted in
+ * the NVM journal (bms_can_auth_flush, NVM task) after every accepted
+ * command and after BMS_CAN_AUTH_FV_PERSIST_MS of heartbeat-only
+ * progress, and bms_can_auth_restore() starts from it. Frames captured
+ * before a reset stay stale after it; only heartbeats from the last
+ * persist interval, and a command accepted within one NVM drain period
+ * of the reset, could be replayed.
+ */
+
+#ifndef BMS_CAN_AUTH_H
+#define BMS_CAN_AUTH_H
+
+#include "bms_types.h"
+#include "bms_nvm.h"
+
+#define BMS_CAN_AUTH_MAC_LEN         2U    /* classic compact layout */
+#define BMS_CAN_AUTH_SYNC_MAC_LEN    4U    /* heartbeat layout */
+#define BMS_CAN_AUTH_PAYLOAD_MAX     5U    /* classic compact payload */
+#define BMS_CANFD_AUTH_MAC_LEN       8U
+#define BMS_CANFD_AUTH_TRAILER_LEN  12U    /* FV u32 + MAC64 */
+#define BMS_CANFD_AUTH_PAYLOAD_MAX  48U    /* rounds to ≤ 64 with trailer */
+
+typedef struct {
+    uint32_t verified;
+    uint32_t bad_mac;
+    uint32_t replay;        /* heartbeat FV not above last accepted */
+    uint32_t bad_format;    /* short DLC, unkeyed */
+    uint32_t resync;        /* heartbeat moved FV by > 256 */
+    uint32_t aes_blocks;    /* total AES block operations (verify + sign) */
+    uint32_t verify_cycles_max;  /* hal_cycle_count() delta, target only */
+    uint32_t held_off;      /* commands rejected unchecked in a hold-off */
+    uint32_t lockouts;      /* hold-offs started */
+    bool     lockout_latched;    /* any hold-off since init */
+} bms_can_auth_stats_t;
+
+/**
+ * Load the pre-shared key (NULL = not provisioned: every verify fails).
+ * Resets both freshness counters, the hold-off and the stats.
+ */
+void bms_can_auth_init(const uint8_t *key);
+
+/** Start the receive FV from the persisted high-water mark (after init). */
+void bms_can_auth_restore(const bms_nvm_persistent_t *p);
+
+/**
+ * NVM task: write a pending FV high-water mark, log a new hold-off.
+ * @return true if anything was written
+ */
+bool bms_can_auth_flush(bms_nvm_ctx_t *ctx);
+
+/** Verify an EMS frame and advance the receive FV on success. */
+bool bms_can_auth_verify(const bms_can_frame_t *frame);
+
+/** Sign a frame with the transmit FV (EMS side / test harness). */
+void bms_can_auth_sign(bms_can_frame_t *frame);
+
+/**
+ * Append the FD trailer to a frame whose len is its payload length.
+ * @return false if the payload exceeds BMS_CANFD_AUTH_PAYLOAD_MAX or unkeyed
+ */
+bool bms_can_auth_sign_fd(bms_canfd_frame_t *frame);
+bool bms_can_auth_verify_fd(const bms_canfd_frame_t *frame);
+
+uint32_t bms_can_auth_get_tx_seq(void);
+uint32_t bms_can_auth_get_rx_seq(void);
+void bms_can_auth_get_stats(bms_can_auth_stats_t *out);
+
+#endif /* BMS_CAN_AUTH_H */
@@ -0,0 +1,82 @@
+/**
+ * @file bms_can_diag.h
+ * @brief ISO 15765-2 (ISO-TP) diagnostic bulk-read service
+ *
+ * Street Smart Edition.
+ * Tester → BMS on CAN_ID_DIAG_REQ, BMS → tester on CAN_ID_DIAG_RESP,
+ * normal addressing, 8-byte frames padded with 0xCC. Requests are
+ * single-frame UDS ReadDataByIdentifier (0x22 DID_hi DID_lo); responses
+ * are 0x62 DID_hi DID_lo <data>, segmented FF/CF under tester flow control
+ * (BS, STmin honoured). The data is frozen when the request arrives, so a
+ * snapshot is one consistent instant however long the transfer takes.
+ *
+ * Pacing: CFs go to the lowest TX-queue class (BMS_CAN_PRIO_DIAG) at most
+ * BMS_DIAG_CF_PER_POLL per BMS_DIAG_POLL_MS, so periodic frames always
+ * win the mailboxes and the bus-load budget bounds total throughput.
+ *
+ * Data layouts (big-endian):
+ *   0xF100 fault log   count, then count × {ts u32, type u8, cell u8, value u16},
+ *                      newest first
+ *   0xF101 snapshot    uptime u32, cell_mv[308] u16, temp_deci_c[66] i16
+ *   0xF102 prot timers ov[308] u16, uv[308] u16, ot[66] u16, hw_ov, hw_uv,
+ *                      hw_ot, oc_chg, oc_dchg, subzero, safe_state,
+ *                      warning_hold (u32 each)
+ *   0xF103 black box   blocks u16, trigger_block u16, trigger_sample u16,
+ *                      trigger_ms u32, faults u32, first_ms u32,
+ *                      last_ms u32, capture u32 (stored capture header)
+ *   0xF200+n bbox blk  stored block n, BMS_BBOX_BLOCK_SIZE raw bytes —
+ *                      layout in bms_blackbox.h
+ *   0xF300+n history   raw flash page n of the operating-history region
+ *                      (16 pages per sector, tiers in order) — decode
+ *                      whole sectors with bms_history_decode_sector()
+ */
+
+#ifndef BMS_CAN_DIAG_H
+#define BMS_CAN_DIAG_H
+
+#include "bms_types.h"
+#include "bms_nvm.h"
+#include "bms_protection.h"
+
+#define BMS_DIAG_SID_READ_DID     0x22U
+#define BMS_DIAG_SID_NEGATIVE     0x7FU
+#define BMS_DIAG_NRC_NOT_SUPP     0x11U
+#define BMS_DIAG_NRC_BAD_LENGTH   0x13U
+#define BMS_DIAG_NRC_OUT_OF_RANGE 0x31U
+
+#define BMS_DIAG_DID_FAULT_LOG    0xF100U
+#define BMS_DIAG_DID_SNAPSHOT     0xF101U
+#define BMS_DIAG_DID_PROT_TIMERS  0xF102U
+#define BMS_DIAG_DID_BBOX_INFO    0xF103U
+#define BMS_DIAG_DID_BBOX_BLOCK   0xF200U   /* + block index */
+#define BMS_DIAG_DID_HISTORY      0xF300U   /* + page index */
+
+#define BMS_DIAG_LEN_FAULT_LOG  (3U + 1U + BMS_NVM_FAULT_LOG_SIZE * 8U)
+#define BMS_DIAG_LEN_SNAPSHOT   (3U + 4U + BMS_SE_PER_PACK * 2U + BMS_TOTAL_TEMP_SENSORS * 2U)
+#define BMS_DIAG_LEN_PROT       (3U + BMS_SE_PER_PACK * 4U + BMS_TOTAL_TEMP_SENSORS * 2U + 8U * 4U)
+#define BMS_DIAG_LEN_BBOX_INFO  (3U + 3U * 2U + 5U * 4U)
+#define BMS_DIAG_LEN_BBOX_BLOCK (3U + BMS_BBOX_BLOCK_SIZE)
+#define BMS_DIAG_LEN_HIST_PAGE  (3U + BMS_NVM_PAGE_SIZE)
+#define BMS_DIAG_HIST_PAGES \
+    (BMS_HIST_TIERS * BMS_NVM_HIST_SECTORS_PER_TIER * (BMS_NVM_SECTOR_SIZE / BMS_NVM_PAGE_SIZE))
+
+typedef struct {
+    uint32_t requests;
+    uint32_t negative;
+    uint32_t completed;
+    uint32_t aborted;          /* N_Bs timeout, tester overflow, TX drop */
+    uint32_t cf_sent;
+    uint32_t last_transfer_ms; /* request → last CF queued */
+} bms_can_diag_stats_t;
+
+void bms_can_diag_init(const bms_pack_data_t *pack,
+                       const bms_protection_state_t *prot,
+                       const bms_nvm_ctx_t *nvm);
+
+/** Service tick — call every BMS_DIAG_POLL_MS from the CAN task. */
+void bms_can_diag_poll(void);
+
+bool bms_can_diag_busy(void);
+void bms_can_diag_get_stats(bms_can_diag_stats_t *out);
+
+#endif /* BMS_CAN_DIAG_H */
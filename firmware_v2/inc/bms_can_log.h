@@ -0,0 +1,64 @@
+/**
+ * @file bms_can_log.h
+ * @brief Desktop CAN log decoder driven by bms_can_msgs.def
+ *
+ * Street Smart Edition.
+ * Host-side only (tools/can_log_decode.c, tests) — not linked into the
+ * firmware image. Signal names, units and scales come from the same table
+ * as the firmware encoders, so the decoder cannot drift from the wire.
+ */
+
+#ifndef BMS_CAN_LOG_H
+#define BMS_CAN_LOG_H
+
+#include "bms_types.h"
+#include <stddef.h>
+
+typedef enum {
+    BMS_CAN_WIRE_U8 = 0,
+    BMS_CAN_WIRE_I8,
+    BMS_CAN_WIRE_U16,
+    BMS_CAN_WIRE_I16,
+    BMS_CAN_WIRE_U32,
+    BMS_CAN_WIRE_I32
+} bms_can_wire_t;
+
+typedef struct {
+    const char     *name;
+    const char     *unit;
+    bms_can_wire_t  wire;
+    uint8_t         byte;
+    int32_t         div;
+    int32_t         add;
+} bms_can_sig_desc_t;
+
+typedef struct {
+    const char               *name;
+    uint32_t                  id;
+    uint16_t                  span;
+    uint8_t                   dlc;
+    uint8_t                   n_sigs;
+    const bms_can_sig_desc_t *sigs;
+} bms_can_msg_desc_t;
+
+/** Message whose ID is id, else whose span covers it; NULL if unknown. */
+const bms_can_msg_desc_t *bms_can_log_find(uint32_t id);
+
+/** Physical value of one signal: (raw - add) * div. */
+int64_t bms_can_log_signal(const bms_can_sig_desc_t *sig, const uint8_t *data);
+
+/**
+ * Format "name[idx] sig=val unit ..." into buf (always NUL-terminated).
+ * Signals beyond the frame's DLC print as "-".
+ * @return chars written, -1 if the ID is not in the table
+ */
+int bms_can_log_format(const bms_can_frame_t *frame, char *buf, size_t len);
+
+/**
+ * Parse one candump -l line: "(1697040000.123456) can0 100#0102030405060708".
+ * @param prefix_len  set to the offset of the ID (timestamp/interface text)
+ * @return true if a classic frame was parsed
+ */
+bool bms_can_log_parse(const char *line, bms_can_frame_t *frame, size_t *prefix_len);
+
+#endif /* BMS_CAN_LOG_H */
@@ -0,0 +1,71 @@
+/**
+ * @file bms_can_rx.h
+ * @brief ISR-fed CAN RX ring with urgent-command wake-up
+ *
+ * Street Smart Edition.
+ * The RX FIFO interrupt hands every frame to bms_can_rx_isr(), which
+ * drops anything that is not an EMS ID and queues the rest with its
+ * arrival tick. DISCONNECT and POWER_SAVE commands additionally fire the
+ * urgent hook so the state task runs now instead of at its next 100 ms
+ * slot. bms_can_rx_drain() empties the ring every cycle and hands the
+ * state machine one merged command (safety commands win).
+ * Diagnostic requests (CAN_ID_DIAG_REQ) go to a separate ring read by
+ * the ISO-TP service.
+ */
+
+#ifndef BMS_CAN_RX_H
+#define BMS_CAN_RX_H
+
+#include "bms_types.h"
+
+typedef struct {
+    uint32_t isr_frames;
+    uint32_t filtered;          /* ID not for us — dropped in ISR */
+    uint32_t overflow;          /* ring full — dropped in ISR */
+    uint32_t auth_reject;
+    uint32_t decode_reject;
+    uint32_t commands;
+    uint32_t heartbeats;
+    uint32_t superseded;        /* valid command outranked in same drain */
+    uint32_t urgent;
+    uint8_t  ring_hwm;
+    /* RX interrupt → state machine acted, commands only */
+    uint16_t cmd_latency_last_ms;
+    uint16_t cmd_latency_max_ms;
+    uint32_t cmd_latency_sum_ms;
+    uint32_t cmd_latency_count;
+} bms_can_rx_stats_t;
+
+typedef void (*bms_can_rx_hook_t)(void);
+
+void bms_can_rx_init(void);
+
+/** Called from the urgent ISR path (e.g. vTaskNotifyGiveFromISR). */
+void bms_can_rx_set_urgent_hook(bms_can_rx_hook_t hook);
+
+/** CAN RX FIFO ISR body. */
+void bms_can_rx_isr(const bms_can_frame_t *frame);
+
+/** Urgent command queued since the last drain. */
+bool bms_can_rx_urgent_pending(void);
+
+/**
+ * Drain the whole ring (task context). cmd receives the highest-ranked
+ * valid frame — DISCONNECT > POWER_SAVE > other commands > heartbeat,
+ * latest wins within a rank — with timestamp_ms = its RX interrupt tick.
+ * cmd->valid is cleared when nothing valid arrived, so a command is
+ * acted on once.
+ * @return true if cmd is valid
+ */
+bool bms_can_rx_drain(bms_ems_command_t *cmd);
+
+/** Record command latency once bms_state_run() has consumed cmd. */
+void bms_can_rx_note_handled(const bms_ems_command_t *cmd);
+
+/** Pop one ISO-TP frame addressed to CAN_ID_DIAG_REQ (diag service). */
+bool bms_can_rx_diag_pop(bms_can_frame_t *frame);
+
+uint8_t bms_can_rx_pending(void);
+void bms_can_rx_get_stats(bms_can_rx_stats_t *out);
+
+#endif /* BMS_CAN_RX_H */
@@ -0,0 +1,67 @@
+/**
+ * @file bms_can_txq.h
+ * @brief Prioritised CAN TX queue — ISR-drained, bus-load budgeted
+ *
+ * Street Smart Edition.
+ * Frames are no longer pushed straight into the three bxCAN mailboxes
+ * (mailbox-full returns were silently ignored). Each priority class has a
+ * bounded single-producer/single-consumer ring; the TX-complete ISR
+ * refills free mailboxes from the highest non-empty class, so an alarm
+ * queued behind a cell broadcast goes out on the next free mailbox.
+ *
+ * A token bucket (BMS_CAN_BUS_LOAD_PCT of BMS_CAN_BITRATE_BPS) caps our
+ * share of a shared vessel bus. ALARM frames are charged but never held.
+ *
+ * Concurrency: one producer context per class (the CAN TX task owns all
+ * periodic classes). The consumer is the ISR; bms_can_txq_kick() runs the
+ * same drain from task context with the TX interrupt masked.
+ */
+
+#ifndef BMS_CAN_TXQ_H
+#define BMS_CAN_TXQ_H
+
+#include "bms_types.h"
+
+typedef enum {
+    BMS_CAN_PRIO_ALARM     = 0,  /* faults/alarms — bypass the budget */
+    BMS_CAN_PRIO_CONTROL   = 1,  /* status, limits, heartbeat, safety I/O */
+    BMS_CAN_PRIO_TELEMETRY = 2,  /* pack voltages, temperatures */
+    BMS_CAN_PRIO_BULK      = 3,  /* cell broadcast */
+    BMS_CAN_PRIO_DIAG      = 4,  /* ISO-TP diagnostic responses */
+    BMS_CAN_PRIO_COUNT     = 5
+} bms_can_prio_t;
+
+typedef struct {
+    uint32_t enqueued[BMS_CAN_PRIO_COUNT];
+    uint32_t dropped[BMS_CAN_PRIO_COUNT];      /* ring full at enqueue */
+    uint32_t sent[BMS_CAN_PRIO_COUNT];
+    uint32_t latency_sum_ms[BMS_CAN_PRIO_COUNT];
+    uint16_t latency_max_ms[BMS_CAN_PRIO_COUNT];
+    uint8_t  depth_hwm[BMS_CAN_PRIO_COUNT];
+    uint32_t budget_deferrals;                 /* drain stopped by bucket */
+    uint32_t mailbox_full;                     /* HAL refused a frame */
+    uint32_t bits_sent;
+} bms_can_txq_stats_t;
+
+void bms_can_txq_init(void);
+
+/**
+ * Queue a classic frame. Never blocks.
+ * @return 0 on success, -1 if the class ring is full (frame dropped)
+ */
+int32_t bms_can_txq_send(const bms_can_frame_t *frame, bms_can_prio_t prio);
+
+/** CAN TX-complete ISR body: refill free mailboxes from the queue. */
+void bms_can_txq_isr(void);
+
+/** Task-side drain (TX IRQ masked) — starts the ISR chain, flushes
+ *  frames deferred by the budget. Call every BMS_CAN_TX_PERIOD_MS. */
+void bms_can_txq_kick(void);
+
+uint8_t bms_can_txq_pending(bms_can_prio_t prio);
+void bms_can_txq_get_stats(bms_can_txq_stats_t *out);
+
+/** Worst-case on-wire bits for a classic 11-bit frame (incl. stuffing, IFS). */
+uint16_t bms_can_frame_bits(uint8_t dlc);
+
+#endif /* BMS_CAN_TXQ_H */
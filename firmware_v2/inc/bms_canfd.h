@@ -0,0 +1,70 @@
+/**
+ * @file bms_canfd.h
+ * @brief CAN FD cell-voltage streaming — delta-encoded 64-byte frames
+ *
+ * Street Smart Edition.
+ * The classic 4-cell broadcast needs 77 frames (7.7 s at 100 ms) to cover
+ * 308 SEs. Over CAN FD each call emits:
+ *   - one PRIORITY frame: pack min/max cell first, then the cells that
+ *     moved most since the EMS last saw them (sparse index/value pairs)
+ *   - enough FULL frames to sweep every cell within
+ *     BMS_CANFD_FULL_REFRESH_MS (contiguous delta-encoded blocks)
+ *
+ * Wire format (all multi-byte fields big-endian, varints LEB128):
+ *   FULL     [0]=0x01 [1]=seq [2..3]=start idx [4]=count [5..6]=first mV
+ *            then (count-1) × zigzag varint ΔmV to the previous cell
+ *   PRIORITY [0]=0x02 [1]=seq [2]=count [3..4]=first idx [5..6]=first mV
+ *            then (count-1) × { varint idx gap, zigzag varint ΔmV }
+ * Every frame is self-contained: a lost frame only delays those cells
+ * until the next refresh, never corrupts later ones.
+ */
+
+#ifndef BMS_CANFD_H
+#define BMS_CANFD_H
+
+#include "bms_types.h"
+
+#define BMS_CANFD_TYPE_FULL      0x01U
+#define BMS_CANFD_TYPE_PRIORITY  0x02U
+#define BMS_CANFD_HDR_LEN        7U
+#define BMS_CANFD_PRIO_MAX      24U   /* candidates considered per frame */
+
+/* Cells the full sweep must cover per CAN TX period */
+#define BMS_CANFD_CELLS_PER_CALL \
+    ((BMS_SE_PER_PACK * BMS_CAN_TX_PERIOD_MS + BMS_CANFD_FULL_REFRESH_MS - 1U) \
+     / BMS_CANFD_FULL_REFRESH_MS)
+
+void bms_canfd_init(void);
+
+/**
+ * Encode a FULL block of cells starting at start_idx.
+ * @return number of cells encoded (≥ 1 while start_idx < BMS_SE_PER_PACK)
+ */
+uint16_t bms_canfd_encode_full(const uint16_t *cell_mv, uint16_t start_idx,
+                               uint8_t seq, bms_canfd_frame_t *frame);
+
+/**
+ * Encode a PRIORITY frame from idx[0..n-1] (any order, highest priority
+ * first). Lowest-priority entries are dropped until the frame fits.
+ * @return number of cells encoded
+ */
+uint8_t bms_canfd_encode_priority(const uint16_t *cell_mv, const uint16_t *idx,
+                                  uint8_t n, uint8_t seq,
+                                  bms_canfd_frame_t *frame);
+
+/**
+ * Decode a FULL or PRIORITY frame into cell_mv[BMS_SE_PER_PACK].
+ * @return cells updated, or -1 on a malformed / out-of-range frame
+ */
+int32_t bms_canfd_decode_cells(const bms_canfd_frame_t *frame, uint16_t *cell_mv);
+
+/**
+ * Periodic stream — call every BMS_CAN_TX_PERIOD_MS.
+ * @return number of FD frames transmitted
+ */
+uint8_t bms_canfd_tx_cells(const bms_pack_data_t *pack);
+
+/** Round a payload length up to the next valid CAN FD DLC length. */
+uint8_t bms_canfd_len_round(uint8_t len);
+
+#endif /* BMS_CANFD_H */
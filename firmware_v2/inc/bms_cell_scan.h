@@ -0,0 +1,53 @@
+/**
+ * @file bms_cell_scan.h
+ * @brief Packed 16-bit cell threshold scans → per-module exceedance masks
+ *
+ * Street Smart Edition.
+ * The protection loop compares all 308 SE voltages against up to eight
+ * thresholds per cycle. These kernels do the compares two lanes at a time
+ * on the Cortex-M4 (DSP SIMD: USUB16 + SEL), eight lanes at a time with
+ * SSE2 on the desktop build, and fall back to a portable scalar loop
+ * elsewhere. All variants produce bit-identical masks.
+ *
+ * Mask layout: bit c of mask[m] ↔ cell_mv[m * BMS_SE_PER_MODULE + c].
+ */
+
+#ifndef BMS_CELL_SCAN_H
+#define BMS_CELL_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bms_config.h"
+
+_Static_assert(BMS_SE_PER_MODULE <= 16U, "Module mask must fit in uint16_t");
+_Static_assert((BMS_SE_PER_MODULE % 2U) == 0U, "M4 kernel packs cells in pairs");
+
+typedef struct {
+    uint16_t mask[BMS_NUM_MODULES];
+} bms_cell_mask_t;
+
+/**
+ * Flag every cell with cell_mv >= thresh_mv.
+ * @return true if any cell is flagged
+ */
+bool bms_cell_scan_ge(const uint16_t *cell_mv, uint16_t thresh_mv,
+                      bms_cell_mask_t *out);
+
+/**
+ * Flag every cell with 0 < cell_mv <= thresh_mv.
+ * Zero readings (unread / comm-lost modules) are never flagged.
+ * @return true if any cell is flagged
+ */
+bool bms_cell_scan_le_nz(const uint16_t *cell_mv, uint16_t thresh_mv,
+                         bms_cell_mask_t *out);
+
+/* Portable scalar reference — always built, used by equivalence tests */
+bool bms_cell_scan_ge_ref(const uint16_t *cell_mv, uint16_t thresh_mv,
+                          bms_cell_mask_t *out);
+bool bms_cell_scan_le_nz_ref(const uint16_t *cell_mv, uint16_t thresh_mv,
+                             bms_cell_mask_t *out);
+
+/** Name of the kernel compiled into bms_cell_scan_ge/le_nz ("m4-dsp", ...). */
+const char *bms_cell_scan_impl(void);
+
+#endif /* BMS_CELL_SCAN_H */
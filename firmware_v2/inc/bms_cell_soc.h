@@ -0,0 +1,64 @@
+/**
+ * @file bms_cell_soc.h
+ * @brief Per-SE SoC and relative capacity, tracked against the pack EKF
+ *
+ * Street Smart Edition.
+ * bms_soc estimates one SoC for the string; balancing and SEV derating act
+ * on individual cells. This module tracks, for each of the 308 SEs,
+ *
+ *   dsoc[i]  SoC_i − SoC_pack          Q24 fraction, int32
+ *   icap[i]  C_nom / C_i               Q14 (16384 = nominal), uint16
+ *
+ * as structure-of-arrays, updated one module (14 cells) at a time right
+ * after that module's cells are read — cost per tick is 14 cells, never
+ * 308. The string current is shared, so all cells of a module see the same
+ * charge, the same measurement noise and therefore the same Kalman gain:
+ * one scalar filter per module, and a per-cell loop that is straight int32
+ * multiply-add over contiguous arrays (no branches, no per-cell divide).
+ *
+ *   predict  dsoc += dQ · (icap − 1)        dQ since this module's last scan
+ *   correct  dsoc += K · (v − v_model − dOCV/dSoC · dsoc)
+ *
+ * v_model is the pack EKF's average-cell terminal voltage at the same
+ * current, so R0·I and V_rc cancel and only the cell's own deviation is
+ * left. R grows with (cell R0 spread · I)², so under heavy current the
+ * filter coasts on the prediction.
+ *
+ * Capacity: a cell whose icap is wrong drifts by (icap error) · dQ, which
+ * the correction keeps undoing. Corrections are summed signed by the
+ * direction of dQ; after BMS_CELL_SOC_CAP_WINDOW of throughput the mean
+ * correction per unit charge is folded into icap (half-step) and the
+ * window restarts.
+ *
+ * Pack min/max cell SoC are reduced from per-module extremes and
+ * published on the pack (cell_soc_*) once every module has converged.
+ * RAM: 308 × (4 + 2 + 4) + 22 × 28 B ≈ 3.7 kB.
+ */
+
+#ifndef BMS_CELL_SOC_H
+#define BMS_CELL_SOC_H
+
+#include "bms_types.h"
+
+void bms_cell_soc_init(void);
+
+/**
+ * Predict and correct the cells of one module from pack->cell_mv.
+ * Call after the module's cells were read successfully.
+ */
+void bms_cell_soc_update_module(const bms_pack_data_t *pack, uint8_t mod_idx);
+
+/** Reduce the module extremes into pack->cell_soc_{min,max,valid}. */
+void bms_cell_soc_publish(bms_pack_data_t *pack);
+
+/** SoC of one SE (0–10000) given the current pack SoC. */
+uint16_t bms_cell_soc_get(uint16_t cell_idx, uint16_t pack_soc_hundredths);
+
+/** Relative capacity of one SE, Q14 (16384 = nominal). */
+uint16_t bms_cell_soc_get_capacity_q14(uint16_t cell_idx);
+
+/** Bit c set where SE (mod, c) is above thresh_hundredths of SoC. */
+uint16_t bms_cell_soc_mask_above(uint8_t mod_idx, uint16_t pack_soc_hundredths,
+                                 uint16_t thresh_hundredths);
+
+#endif /* BMS_CELL_SOC_H */
@@ -0,0 +1,56 @@
+/**
+ * @file bms_cmac.h
+ * @brief Constant-time AES-128 and AES-CMAC (NIST SP 800-38B / RFC 4493)
+ *
+ * Street Smart Edition.
+ * No S-box or T-tables: SubBytes is computed as x^254 in GF(2^8) plus the
+ * affine map, four state bytes per 32-bit word (SWAR). Every operation is
+ * a shift, mask, XOR or 32×32 multiply (single-cycle on the M4), so the
+ * run time does not depend on key or data — no cache or flash-accelerator
+ * timing leak. Round keys and CMAC subkeys K1/K2 are precomputed once.
+ *
+ * BMS_CAN_AUTH_HW_AES=1 tries hal_aes128_encrypt() (CRYP peripheral on
+ * F415/F417) first and falls back to software when it returns < 0.
+ */
+
+#ifndef BMS_CMAC_H
+#define BMS_CMAC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bms_config.h"
+
+#define BMS_AES_BLOCK_LEN  16U
+
+typedef struct {
+    uint32_t rk[44];                   /* 11 round keys, column words */
+#if BMS_CAN_AUTH_HW_AES
+    uint8_t  key[BMS_AES_BLOCK_LEN];   /* hardware engine takes the raw key */
+#endif
+} bms_aes128_ctx_t;
+
+typedef struct {
+    bms_aes128_ctx_t aes;
+    uint8_t          k1[BMS_AES_BLOCK_LEN];
+    uint8_t          k2[BMS_AES_BLOCK_LEN];
+} bms_cmac_ctx_t;
+
+void bms_aes128_init(bms_aes128_ctx_t *ctx, const uint8_t key[16]);
+void bms_aes128_encrypt(const bms_aes128_ctx_t *ctx, const uint8_t in[16],
+                        uint8_t out[16]);
+
+/** Expand key and derive subkeys K1, K2. */
+void bms_cmac_init(bms_cmac_ctx_t *ctx, const uint8_t key[16]);
+
+/** Full 16-byte tag. AES calls = max(1, ceil(len / 16)). */
+void bms_cmac_compute(const bms_cmac_ctx_t *ctx, const uint8_t *msg,
+                      uint16_t len, uint8_t mac[16]);
+
+/** Compare the first tag_len bytes of the tag in constant time. */
+bool bms_cmac_verify(const bms_cmac_ctx_t *ctx, const uint8_t *msg,
+                     uint16_t len, const uint8_t *tag, uint8_t tag_len);
+
+/** Overwrite round keys and subkeys. */
+void bms_cmac_wipe(bms_cmac_ctx_t *ctx);
+
+#endif /* BMS_CMAC_H */
@@ -94,10 +94,19 @@
  * P0-04: dT/dt Thermal Rate-of-Rise (Catherine, Mikael, Henrik, Priya)
  * ═══════════════════════════════════════════════════════════════════════ */
 #define BMS_DTDT_ALARM_DECI_C_PER_MIN  10     /* 1.0°C/min threshold */
-#define BMS_DTDT_WINDOW_SAMPLES        30U    /* 30 samples for moving avg */
+#define BMS_DTDT_WINDOW_SAMPLES        30U    /* 30 samples for LSQ slope */
 #define BMS_DTDT_SUSTAIN_MS          30000U   /* 30s sustained → alarm */
 #define BMS_DTDT_SAMPLE_PERIOD_MS     1000U   /* 1 sample/sec */
 
+/* dT/dt estimator: streaming least-squares over the window (default), or
+ * double EWMA (Brown) with no history at all. */
+#define BMS_DTDT_EST_LSQ                0
+#define BMS_DTDT_EST_EWMA               1
+#ifndef BMS_DTDT_ESTIMATOR
+#define BMS_DTDT_ESTIMATOR              BMS_DTDT_EST_LSQ
+#endif
+#define BMS_DTDT_EWMA_SHIFT             4U     /* α = 1/16 → ~16 s time constant */
+
 /* ═══════════════════════════════════════════════════════════════════════
  * P0-05: Sub-Zero Charging (Dave)
  * ═══════════════════════════════════════════════════════════════════════ */
@@ -110,6 +119,7 @@
  * ═══════════════════════════════════════════════════════════════════════ */
 #define BMS_IMBALANCE_WARN_MV          50U
 #define BMS_BALANCE_THRESHOLD_MV       20U
+#define BMS_BALANCE_THRESHOLD_SOC     100U    /* 1 %, once per-SE SoC is valid */
 
 /* ═══════════════════════════════════════════════════════════════════════
  * Contactor Timing — P0-03: Must use bus voltage (Dave)
@@ -140,10 +150,41 @@
 #define BMS_EMS_READY_TIMEOUT_MS  1800000U    /* 30 min in READY → POWER_SAVE (P2-09) */
 
 /* ═══════════════════════════════════════════════════════════════════════
- * CC-01 / P2-01: CAN Authentication (stub — full CMAC in Phase 2)
+ * CC-01 / P2-01: CAN Authentication — AES-128-CMAC, 32-bit freshness
+ * ═══════════════════════════════════════════════════════════════════════ */
+#define BMS_CAN_AUTH_ENABLED           0U     /* 0=disabled, 1=enforce CMAC on EMS frames */
+#define BMS_CAN_AUTH_HW_AES            0U     /* 1=try hal_aes128_encrypt() first (F415/F417 CRYP) */
+#define BMS_CPU_HZ             168000000U     /* STM32F407 core clock */
+#define BMS_CAN_AUTH_VERIFY_CYCLES 30000U     /* M4 worst case per frame: 1 AES block + framing */
+#define BMS_CAN_AUTH_BUDGET_PCT        5U     /* max share of the state-task period */
+#define BMS_CAN_AUTH_FAIL_BURST        4U     /* bad 16-bit MACs back to back ... */
+#define BMS_CAN_AUTH_FAIL_REFILL_MS 1000U     /* ... one more allowed per second ... */
+#define BMS_CAN_AUTH_HOLDOFF_MS    10000U     /* ... else every command rejected this long */
+#define BMS_CAN_AUTH_FV_PERSIST_MS 60000U     /* heartbeat-only FV progress → NVM */
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * CAN TX queue — priority classes, ISR drain, bus-load budget
+ * ═══════════════════════════════════════════════════════════════════════ */
+#define BMS_CAN_BITRATE_BPS       250000U     /* vessel EMS bus */
+#define BMS_CAN_BUS_LOAD_PCT          30U     /* our share of bus bandwidth */
+#define BMS_CAN_TXQ_BURST_MS         100U     /* token bucket depth (one TX period) */
+#define BMS_CAN_TXQ_DEPTH             16U     /* frames per class, power of 2 */
+#define BMS_CAN_RX_DEPTH              16U     /* ISR → state task, power of 2 */
+#define BMS_CAN_DIAG_RX_DEPTH          8U     /* ISR → diag service, power of 2 */
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * ISO-TP diagnostic service (0x7E0 / 0x7E8)
+ * ═══════════════════════════════════════════════════════════════════════ */
+#define BMS_DIAG_POLL_MS              10U     /* service + CF pacing tick */
+#define BMS_DIAG_CF_PER_POLL          12U     /* consecutive frames per tick */
+#define BMS_DIAG_N_BS_MS            1000U     /* wait for tester flow control */
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * CAN FD cell streaming (replaces 4-cell classic broadcast when enabled)
  * ═══════════════════════════════════════════════════════════════════════ */
-#define BMS_CAN_AUTH_ENABLED           0U     /* 0=disabled (stub), 1=enforce auth */
-#define BMS_CAN_SEQ_COUNTER_MAX   0xFFFFU     /* 16-bit sequence counter wrap */
+#define BMS_CAN_FD_ENABLED             0U     /* 1 = stream cells over CAN FD */
+#define BMS_CANFD_FULL_REFRESH_MS    300U     /* every cell at least this often */
+#define BMS_CANFD_PRIO_MIN_DELTA_MV    2U     /* smaller changes wait for refresh */
 
 /* ═══════════════════════════════════════════════════════════════════════
  * P2-07: I2C Plausibility (Dave, Yara, Priya)
@@ -152,6 +193,10 @@
 #define BMS_CELL_DV_DT_MAX_MV        50U     /* 50mV per 10ms max rate */
 #define BMS_INTER_MODULE_TEMP_DELTA_DC 200    /* 20°C inter-module max */
 
+/* Summary acquisition (BQ76952 DASTATUS5 fast path) */
+#define BMS_ACQ_SUMMARY_ENABLED        1U     /* 0 = legacy one-module-per-tick full scan */
+#define BMS_ACQ_DETAIL_EVERY_TICKS     2U     /* rotating per-cell detail: 1 module / 2 ticks */
+
 /* ═══════════════════════════════════════════════════════════════════════
  * Task Periods
  * ═══════════════════════════════════════════════════════════════════════ */
@@ -163,6 +208,38 @@
 #define BMS_THERMAL_PERIOD_MS        1000U    /* dT/dt at 1Hz */
 #define BMS_SAFETY_IO_PERIOD_MS       100U
 
+/* Bare-metal loop (bms_sched): release offsets, in whole 10 ms frames, so
+ * the slower tasks each get a frame of their own instead of all landing
+ * on the 100/1000 ms boundaries together with monitor + protection */
+#define BMS_CONTACTOR_PHASE_MS         10U    /* frames 1 and 6 of each 100 ms */
+#define BMS_SAFETY_IO_PHASE_MS         20U
+#define BMS_STATE_PHASE_MS             30U
+#define BMS_CAN_TX_PHASE_MS            40U
+#define BMS_NVM_DRAIN_PHASE_MS         50U
+#define BMS_THERMAL_PHASE_MS           70U    /* frames 8, 9, 0 stay free */
+#define BMS_SCHED_CATCHUP_MAX           3U    /* missed releases replayed, beyond = skip */
+
+/* WCET budgets at 168 MHz, µs — checked against bms_trace max on target.
+ * NVM issues at most one sector erase per release (bms_nvm_release) and
+ * never waits for it: the NOR erases in the background, suspended for
+ * reads and page programs, and the owner polls it done on a later release. */
+#define BMS_MONITOR_WCET_US          3000U    /* 22 × DASTATUS5 summary + 1 detail module */
+#define BMS_PROTECTION_WCET_US        400U
+#define BMS_DIAG_WCET_US              150U    /* BMS_DIAG_CF_PER_POLL frames queued */
+#define BMS_CONTACTOR_WCET_US         150U
+#define BMS_SAFETY_IO_WCET_US         300U
+#define BMS_STATE_WCET_US   (500U + BMS_CAN_RX_DEPTH * BMS_CAN_AUTH_VERIFY_CYCLES / (BMS_CPU_HZ / 1000000U))
+#define BMS_CAN_TX_WCET_US            800U
+#define BMS_NVM_DRAIN_WCET_US        2000U    /* page programs + one erase issue */
+#define BMS_THERMAL_WCET_US           600U
+#define BMS_SCHED_UTIL_MAX_PCT         70U    /* under the 9-task rate-monotonic bound (72 %) */
+
+/* POWER_SAVE tickless cadence (bms_power): contactors open, the AFEs'
+ * autonomous protection armed, the MCU in STOP between slow scans */
+#define BMS_PS_SCAN_PERIOD_MS         500U    /* monitor/protection/state/CAN while asleep */
+#define BMS_PS_WAKE_HOLD_MS         10000U    /* full cadence after ALERT/CAN wake or activity */
+#define BMS_PS_STOP_MAX_MS             80U    /* one STOP, then feed the IWDG (runs in STOP) */
+
 /* ═══════════════════════════════════════════════════════════════════════
  * P1-02: Hardware Watchdog (Henrik, Yara)
  * ═══════════════════════════════════════════════════════════════════════ */
@@ -204,11 +281,128 @@
 #define BMS_MAX_DISCHARGE_MA        640000    /* 5C × 128Ah */
 #define BMS_COULOMBIC_EFFICIENCY_PPT   998U   /* 0.998 */
 
+/* ═══════════════════════════════════════════════════════════════════════
+ * SoC Estimator — fixed-point EKF, 1-RC ECM per SE (bms_soc)
+ * Q31 variances: 1.0 SoC² or 1.0 V² = 2^31
+ * ═══════════════════════════════════════════════════════════════════════ */
+#define BMS_SOC_EKF_R0_UOHM           200U    /* ohmic, 25–45 °C mid-SoC (2.8 mΩ/module / 14) */
+#define BMS_SOC_EKF_R0_STD_UOHM        70U    /* R0 spread over T and SoC */
+#define BMS_SOC_EKF_R1_UOHM            40U    /* diffusion branch */
+#define BMS_SOC_EKF_TAU_MS          40000U    /* R1·C1 */
+#define BMS_SOC_EKF_PERIOD_MS         200U    /* min spacing of corrections */
+#define BMS_SOC_EKF_P0_SOC       21474836     /* (10 %)² after boot from NVM */
+#define BMS_SOC_EKF_P0_VRC           8590     /* (2 mV)² */
+#define BMS_SOC_EKF_Q_SOC_REST         60     /* SoC²/s: sigma +1 %/sqrt(h) */
+#define BMS_SOC_EKF_Q_SOC_PER_A         1     /* SoC²/s per A: sensor gain/offset */
+#define BMS_SOC_EKF_Q_VRC            2147     /* V²/s: (1 mV)²/s */
+#define BMS_SOC_EKF_R_MEAS          53687     /* V²: (5 mV)² OCV table + ADC */
+#define BMS_SOC_EKF_INNOV_MAX_MV       50     /* residual clamp per correction */
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * Per-SE SoC and relative capacity (bms_cell_soc)
+ * Variances in ppm² of SoC (1 % = 10 000 ppm), measurement noise in µV²
+ * ═══════════════════════════════════════════════════════════════════════ */
+#define BMS_CELL_SOC_P0_PPM2      2500000000U /* (5 %)² cell spread at boot */
+#define BMS_CELL_SOC_P_VALID_PPM2  100000000U /* publish once every module < (1 %)² */
+#define BMS_CELL_SOC_Q_PPM2_PER_S      100U   /* unmodelled drift, 0.06 %/sqrt(h) */
+#define BMS_CELL_SOC_R_MEAS_UV2    9000000U   /* (3 mV)² AFE + OCV-table mismatch */
+#define BMS_CELL_SOC_R_STD_UOHM         20U   /* cell-to-cell R0 spread */
+#define BMS_CELL_SOC_INNOV_MAX_MV       30    /* residual clamp per cell */
+#define BMS_CELL_SOC_CAP_WINDOW     1000U     /* capacity fit every 10 % throughput */
+#define BMS_CELL_SOC_CAP_MIN_Q14     13107U   /* relative capacity 1.25 … */
+#define BMS_CELL_SOC_CAP_MAX_Q14     20480U   /* ... 0.80, as C_nom/C_i in Q14 */
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * State of Health — RLS with forgetting (bms_soh)
+ * Resistance per module from current steps, capacity from the SoC swing
+ * between two OCV rests. Forgetting factors in Q16 per event.
+ * ═══════════════════════════════════════════════════════════════════════ */
+#define BMS_SOH_R_MODULE_NOM_UOHM  (BMS_SOC_EKF_R0_UOHM * BMS_SE_PER_MODULE)
+#define BMS_SOH_R_STEP_MA           50000     /* |dI| between two scans of a module */
+#define BMS_SOH_R_LAMBDA_Q16        65209U    /* 0.995: ~200-step memory */
+#define BMS_SOH_R_PRIOR_DA2       1000000U    /* prior weight: four 50 A steps (dA²) */
+#define BMS_SOH_R_MIN_PCT              50U    /* of nominal, clamp */
+#define BMS_SOH_R_MAX_PCT             400U
+#define BMS_SOH_REST_MA              2000     /* |I| below this ... */
+#define BMS_SOH_REST_MS          1800000U     /* ... for 30 min = OCV point */
+#define BMS_SOH_CAP_MIN_SWING        2000U    /* 20 % between rests to fit */
+#define BMS_SOH_CAP_LAMBDA_Q16      58982U    /* 0.9: ~10-swing memory */
+#define BMS_SOH_CAP_PRIOR         4000000U    /* prior weight: one 20 % swing */
+#define BMS_SOH_CAP_MIN_PCT            50U
+#define BMS_SOH_CAP_MAX_PCT           110U
+#define BMS_SOH_PERSIST_R_PCT           2U    /* R moved this much → persist ... */
+#define BMS_SOH_PERSIST_MIN_MS   3600000U     /* ... at most hourly */
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * State of Power — ECM prediction over fixed horizons (bms_sop)
+ * Largest constant current the limiting SE sustains for each horizon
+ * without crossing the SEV warning levels.
+ * ═══════════════════════════════════════════════════════════════════════ */
+#define BMS_SOP_PERIOD_MS             100U    /* recompute + publish, 10 Hz */
+#define BMS_SOP_HORIZONS                3U
+#define BMS_SOP_HORIZON_1_MS         2000U
+#define BMS_SOP_HORIZON_2_MS        10000U
+#define BMS_SOP_HORIZON_3_MS        30000U
+#define BMS_SOP_V_MAX_MV       BMS_SE_OV_WARN_MV
+#define BMS_SOP_V_MIN_MV       BMS_SE_UV_WARN_MV
+#define BMS_SOP_AGE_MAX_PCT           400U    /* learned R over the table, clamp */
+
 /* ═══════════════════════════════════════════════════════════════════════
  * NVM Configuration
  * ═══════════════════════════════════════════════════════════════════════ */
 #define BMS_NVM_FAULT_LOG_SIZE         64U
 
+/* Fault journal flash geometry (NOR semantics: erase → 0xFF, program only
+ * clears bits). Commits are append-only records; the active sector moves
+ * round-robin, so erases spread evenly across the ring. */
+#define BMS_NVM_SECTOR_SIZE          4096U    /* erase unit */
+#define BMS_NVM_PAGE_SIZE             256U    /* program unit, never straddled */
+#define BMS_NVM_JOURNAL_SECTORS         4U    /* wear-rotation ring */
+#define BMS_NVM_BBOX_SECTORS            9U    /* black-box capture, after the journal */
+#define BMS_NVM_BBOX_BASE   (BMS_NVM_SECTOR_SIZE * BMS_NVM_JOURNAL_SECTORS)
+#define BMS_NVM_HIST_SECTORS_PER_TIER   2U    /* operating history, per tier ring */
+#define BMS_NVM_HIST_BASE \
+    (BMS_NVM_SECTOR_SIZE * (BMS_NVM_JOURNAL_SECTORS + BMS_NVM_BBOX_SECTORS))
+#define BMS_NVM_SIZE \
+    (BMS_NVM_HIST_BASE + BMS_NVM_SECTOR_SIZE * BMS_NVM_HIST_SECTORS_PER_TIER * BMS_HIST_TIERS)
+#define BMS_NVM_COMMIT_MAX_EVENTS      16U    /* faults staged per commit */
+#define BMS_NVM_QUEUE_DEPTH            32U    /* protection → NVM task, power of 2 */
+#define BMS_NVM_DRAIN_PERIOD_MS       100U    /* NVM task cadence */
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * Black-Box Recorder
+ * ═══════════════════════════════════════════════════════════════════════ */
+/* 10 ms pack summaries, delta-coded into page-sized blocks. 132 × 256 B =
+ * 33 KB of RAM holds ≥35 s even with every field stepping past the i8
+ * delta range every sample (9 B/sample, fault-current transients); a
+ * steady pack codes in ~2 B/sample. Each mode or fault-flag change
+ * closes a block early, so the bound holds while those stay rare. */
+#define BMS_BBOX_PERIOD_MS             10U    /* one sample per protection cycle */
+#define BMS_BBOX_PRE_MS             30000U    /* history kept ahead of the trigger */
+#define BMS_BBOX_POST_MS             5000U    /* recorded after the trigger, then frozen */
+#define BMS_BBOX_BLOCK_SIZE           256U    /* one flash page per block */
+#define BMS_BBOX_BLOCKS               132U
+#define BMS_BBOX_PAGES_PER_FLUSH        4U    /* NVM task: pages per drain slot */
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * Operating History (warranty / SOH)
+ * ═══════════════════════════════════════════════════════════════════════ */
+/* Hourly aggregates roll up into days and 30-day months; each tier keeps
+ * its own sector ring, so older history survives only at coarser grain.
+ * ~25 B/record → one sector ≈ 5 days hourly, 5 months daily, 11 years
+ * monthly. */
+#define BMS_HIST_HOUR_MS          3600000U
+#define BMS_HIST_TIERS                 3U     /* hour, day, month */
+#define BMS_HIST_DAY_HOURS            24U
+#define BMS_HIST_MONTH_DAYS           30U
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * Runtime Trace (per-task execution time, jitter, deadlines, stacks)
+ * ═══════════════════════════════════════════════════════════════════════ */
+#define BMS_TRACE_TASKS                8U     /* RTOS tasks / main-loop slots */
+#define BMS_TRACE_MAIN_STACK_BYTES  4096U     /* bare-metal MSP, _Min_Stack_Size */
+#define BMS_TRACE_STACK_PAINT  0xA5A5A5A5U    /* high-water fill pattern */
+
 /* ═══════════════════════════════════════════════════════════════════════
  * Warning Timing
  * ═══════════════════════════════════════════════════════════════════════ */
@@ -223,5 +417,9 @@ _Static_assert(BMS_TOTAL_TEMP_SENSORS == 66U, "Must have 66 temperature sensors"
 _Static_assert(BMS_IWDG_TIMEOUT_MS <= 100U, "P1-02: IWDG must be ≤100ms");
 _Static_assert(BMS_SUBZERO_CHARGE_MARGIN_MA == 0, "P0-05: 0A margin below freezing");
 _Static_assert(BMS_I2C_FAULT_CONSEC_COUNT >= 3U, "P0-02: Need ≥3 consecutive failures");
+_Static_assert((BMS_CAN_TX_PERIOD_MS % BMS_DIAG_POLL_MS) == 0U, "CAN period must be a multiple of the diag tick");
+_Static_assert(BMS_PS_STOP_MAX_MS < BMS_IWDG_TIMEOUT_MS, "STOP chunk must end before the IWDG fires");
+_Static_assert(BMS_PS_SCAN_PERIOD_MS < BMS_HW_OV_DELAY_MS && BMS_PS_SCAN_PERIOD_MS < BMS_HW_UV_DELAY_MS,
+               "One slow scan must not satisfy a fault filter on its own");
 
 #endif /* BMS_CONFIG_H */
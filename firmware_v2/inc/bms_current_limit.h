@@ -10,8 +10,23 @@
 
 #include "bms_types.h"
 
+/**
+ * Charge/discharge limits = min(temp, SoC, SEV) derating, in mA.
+ * Division-free; repeated calls with unchanged inputs hit a cache.
+ * Safe to call from several tasks at once (lock-free, never blocks).
+ */
 void bms_current_limit_compute(const bms_pack_data_t *pack,
                                 int32_t *max_charge_ma,
                                 int32_t *max_discharge_ma);
 
+/**
+ * C-rate → mA from this capacity instead of the nominal one (bms_soh's
+ * estimate, every monitor run; cheap when unchanged). Rounded to 100 mAh.
+ * Limits stay clamped to BMS_MAX_CHARGE_MA / BMS_MAX_DISCHARGE_MA.
+ */
+void bms_current_limit_set_capacity(uint32_t capacity_mah);
+
+/** Drop the cached limit pair (tests, or after a table/capacity change). */
+void bms_current_limit_invalidate(void);
+
 #endif /* BMS_CURRENT_LIMIT_H */
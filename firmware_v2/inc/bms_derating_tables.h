@@ -0,0 +1,121 @@
+/**
+ * @file bms_derating_tables.h
+ * @brief Division-free current derating tables (§7.4, Figures 28/29/30)
+ *
+ * Street Smart Edition.
+ * GENERATED by tools/gen_derating_tables.py — do not edit by hand.
+ *
+ * slope[i] = ±ceil(|dy| × 2^BMS_DERATE_SLOPE_SHIFT / dx) for segment i;
+ * y = y[i] ± (((x − x[i]) × |slope[i]|) >> BMS_DERATE_SLOPE_SHIFT) matches
+ * the truncating y[i] + dy·(x − x[i])/dx exactly for every integer x.
+ */
+
+#ifndef BMS_DERATING_TABLES_H
+#define BMS_DERATING_TABLES_H
+
+#include <stdint.h>
+
+#define BMS_DERATE_SLOPE_SHIFT  28U
+
+typedef struct {
+    const int32_t *x;       /* breakpoints, strictly increasing */
+    const int32_t *y;       /* C-rate × 100 at each breakpoint */
+    const int32_t *slope;   /* n − 1 signed Q28 slopes */
+    uint8_t        n;
+} bms_derate_curve_t;
+
+/* Fig. 28 charge vs max temp (deci-C) */
+static const int32_t derate_temp_chg_x[8] = {
+    -250, 0, 50, 150, 350, 450, 550, 650
+};
+static const int32_t derate_temp_chg_y[8] = {
+    0, 0, 0, 300, 300, 200, 0, 0
+};
+static const int32_t derate_temp_chg_slope[7] = {
+    0, 0, 805306368, 0,
+    -268435456, -536870912, 0
+};
+static const bms_derate_curve_t k_derate_temp_chg = {
+    derate_temp_chg_x, derate_temp_chg_y, derate_temp_chg_slope, 8U
+};
+
+/* Fig. 28 discharge vs max temp (deci-C) */
+static const int32_t derate_temp_dchg_x[15] = {
+    -250, -150, -100, -50, 0, 50, 100, 250,
+    300, 350, 450, 550, 600, 650, 700
+};
+static const int32_t derate_temp_dchg_y[15] = {
+    20, 20, 100, 150, 200, 450, 500, 500,
+    450, 400, 380, 380, 20, 20, 0
+};
+static const int32_t derate_temp_dchg_slope[14] = {
+    0, 429496730, 268435456, 268435456,
+    1342177280, 268435456, 0, -268435456,
+    -268435456, -53687092, 0, -1932735284,
+    0, -107374183
+};
+static const bms_derate_curve_t k_derate_temp_dchg = {
+    derate_temp_dchg_x, derate_temp_dchg_y, derate_temp_dchg_slope, 15U
+};
+
+/* Fig. 29 charge vs SoC (0.01 %) */
+static const int32_t derate_soc_chg_x[5] = {
+    0, 8500, 9000, 9500, 10000
+};
+static const int32_t derate_soc_chg_y[5] = {
+    300, 300, 200, 100, 50
+};
+static const int32_t derate_soc_chg_slope[4] = {
+    0, -53687092, -53687092, -26843546
+};
+static const bms_derate_curve_t k_derate_soc_chg = {
+    derate_soc_chg_x, derate_soc_chg_y, derate_soc_chg_slope, 5U
+};
+
+/* Fig. 29 discharge vs SoC (0.01 %) */
+static const int32_t derate_soc_dchg_x[9] = {
+    0, 200, 500, 800, 1000, 1500, 2000, 5000,
+    10000
+};
+static const int32_t derate_soc_dchg_y[9] = {
+    100, 100, 220, 220, 400, 400, 500, 500,
+    500
+};
+static const int32_t derate_soc_dchg_slope[8] = {
+    0, 107374183, 0, 241591911,
+    0, 53687092, 0, 0
+};
+static const bms_derate_curve_t k_derate_soc_dchg = {
+    derate_soc_dchg_x, derate_soc_dchg_y, derate_soc_dchg_slope, 9U
+};
+
+/* Fig. 30 charge vs max cell (mV) */
+static const int32_t derate_sev_chg_x[3] = {
+    3000, 4100, 4200
+};
+static const int32_t derate_sev_chg_y[3] = {
+    300, 300, 0
+};
+static const int32_t derate_sev_chg_slope[2] = {
+    0, -805306368
+};
+static const bms_derate_curve_t k_derate_sev_chg = {
+    derate_sev_chg_x, derate_sev_chg_y, derate_sev_chg_slope, 3U
+};
+
+/* Fig. 30 discharge vs min cell (mV) */
+static const int32_t derate_sev_dchg_x[7] = {
+    3000, 3200, 3300, 3400, 3450, 3550, 4200
+};
+static const int32_t derate_sev_dchg_y[7] = {
+    0, 0, 200, 250, 380, 500, 500
+};
+static const int32_t derate_sev_dchg_slope[6] = {
+    0, 536870912, 134217728, 697932186,
+    322122548, 0
+};
+static const bms_derate_curve_t k_derate_sev_dchg = {
+    derate_sev_dchg_x, derate_sev_dchg_y, derate_sev_dchg_slope, 7U
+};
+
+#endif /* BMS_DERATING_TABLES_H */
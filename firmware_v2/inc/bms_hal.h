@@ -77,14 +77,39 @@ uint16_t hal_adc_read(bms_adc_channel_t channel);
 
 int32_t hal_can_transmit(const bms_can_frame_t *frame);
 int32_t hal_can_receive(bms_can_frame_t *frame);
+/** True when the RX FIFO interrupt feeds bms_can_rx_isr(): the RX ring
+ *  then has that single producer and the FIFO must not be polled. */
+bool hal_can_rx_irq_armed(void);
 
 /* P2-08: CAN hardware filter — accept only expected IDs */
 void hal_can_set_filter(uint32_t id1, uint32_t id2);
+/* Accept one more ID in a spare filter bank (diagnostic request) */
+void hal_can_add_filter(uint32_t id);
+
+/* TX mailboxes currently empty (bxCAN: 3) */
+uint8_t hal_can_tx_free_mailboxes(void);
+/* Mask/unmask the TX-complete interrupt (task-side queue drain) */
+void hal_can_tx_irq_enable(bool enable);
+
+/* CAN FD (BRS, 64-byte payload) — returns negative if no FD controller */
+int32_t hal_canfd_transmit(const bms_canfd_frame_t *frame);
 
 /* ── Timing ────────────────────────────────────────────────────────── */
 
 uint32_t hal_tick_ms(void);
 void     hal_delay_ms(uint32_t ms);
+/* Free-running core cycle counter (DWT->CYCCNT); 0 where unavailable */
+uint32_t hal_cycle_count(void);
+/* Bare-metal main stack never touched since boot (startup code paints
+ * it with BMS_TRACE_STACK_PAINT); the full size where unavailable */
+uint32_t hal_stack_free_bytes(void);
+
+/* ── Crypto (P2-01) ────────────────────────────────────────────────── */
+
+/* One AES-128 block on the CRYP engine — negative if none fitted */
+int32_t hal_aes128_encrypt(const uint8_t key[16], const uint8_t in[16], uint8_t out[16]);
+/* Commissioned EMS↔BMS pre-shared key — negative if not provisioned */
+int32_t hal_can_auth_key(uint8_t key[16]);
 
 /* ── System ────────────────────────────────────────────────────────── */
 
@@ -117,6 +142,29 @@ void hal_iwdg_feed(void);
 /** Check if last reset was caused by IWDG. */
 bool hal_iwdg_was_reset(void);
 
+/** Arm the supply brownout detector (PVD). Its interrupt handler calls
+ *  bms_nvm_queue_brownout_isr() so queued faults reach flash during the
+ *  hold-up time. */
+void hal_brownout_init(void);
+
+/* ── Low power (POWER_SAVE) ────────────────────────────────────────── */
+
+typedef enum {
+    HAL_WAKE_TIMER     = 0,   /* RTC wakeup: the requested time elapsed */
+    HAL_WAKE_AFE_ALERT = 1,   /* wired-OR BQ76952 ALERT line (EXTI) */
+    HAL_WAKE_CAN       = 2,   /* CAN RX pin edge — that frame is lost */
+    HAL_WAKE_OTHER     = 3    /* any other enabled interrupt (PVD, ...) */
+} hal_wake_t;
+
+/** Enter STOP for at most ms (RTC wakeup timer), waking early on the
+ *  ALERT line, CAN RX activity or any enabled interrupt. Returns with
+ *  clocks restored and hal_tick_ms() advanced by the time spent. The
+ *  IWDG keeps running in STOP, so callers bound ms below its timeout. */
+hal_wake_t hal_stop_ms(uint32_t ms);
+
+/** ALERT line asserted right now (level, any module). */
+bool hal_afe_alert_active(void);
+
 /* ── P3-03: Fan Tachometer (Priya — cooling failure detection) ──────── */
 
 /** Read fan RPM from tachometer input (GPIO pulse counting or timer capture).
@@ -125,8 +173,20 @@ uint16_t hal_fan_tach_read_rpm(void);
 
 /* ── NVM ───────────────────────────────────────────────────────────── */
 
+/* Flash semantics: write programs erased (0xFF) bytes only and must not
+ * cross a BMS_NVM_PAGE_SIZE boundary; erase resets the whole
+ * BMS_NVM_SECTOR_SIZE sector containing addr. Callers verify by reading
+ * back.
+ *
+ * Erase never blocks: _start issues it and returns, the part runs it
+ * (NOR 4 KiB: typ. 45 ms, up to a few hundred) and _busy polls it. A read
+ * or program elsewhere meanwhile is bracketed by erase suspend/resume,
+ * so only the sector being erased is off limits until _busy clears.
+ * One erase at a time — bms_nvm_erase_sector() arbitrates. */
 void bms_hal_nvm_write(uint32_t addr, const void *data, uint16_t len);
 void bms_hal_nvm_read(uint32_t addr, void *data, uint16_t len);
+void bms_hal_nvm_erase_start(uint32_t addr);
+bool bms_hal_nvm_erase_busy(void);
 
 /* ── Balance HAL ───────────────────────────────────────────────────── */
 
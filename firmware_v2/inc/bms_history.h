@@ -0,0 +1,96 @@
+/**
+ * @file bms_history.h
+ * @brief Long-term operating history — tiered, compressed, append-only
+ *
+ * Street Smart Edition.
+ * bms_nvm_persistent_t has lifetime totals only; warranty and SOH work
+ * needs the shape of the pack's life. The state task folds every pass
+ * into an hourly aggregate (cell voltage and temperature min/max/mean,
+ * charge/discharge Ah, peak currents, seconds in each mode). The NVM
+ * task appends each finished hour to the HOUR tier and rolls
+ * BMS_HIST_DAY_HOURS of them into one DAY record, and
+ * BMS_HIST_MONTH_DAYS days into one MONTH record.
+ *
+ * Each tier is a ring of BMS_NVM_HIST_SECTORS_PER_TIER sectors:
+ *   sector   [0..3] magic ("HST0" + tier)   [4..7] seq   [8..] records
+ *   record   [0] len   [1..len] payload   [len+1..len+2] CRC-32 low 16
+ *   payload  one zigzag LEB128 varint per field, delta against the
+ *            previous record in the same sector (the first record of a
+ *            sector is against zero, so every sector decodes alone)
+ * Field order is bms_history_rec_t top to bottom. When a sector is full
+ * the oldest one in the ring is erased — the tier above already holds
+ * that span at coarser grain.
+ *
+ * Hours are operating hours: a counter that resumes from the newest
+ * stored record at mount. The partial hour in RAM is lost on power-off;
+ * partial days and months are rebuilt from the tier below at mount.
+ */
+
+#ifndef BMS_HISTORY_H
+#define BMS_HISTORY_H
+
+#include "bms_types.h"
+
+typedef enum {
+    HIST_HOUR = 0,
+    HIST_DAY  = 1,
+    HIST_MONTH = 2
+} bms_history_tier_t;
+
+typedef struct {
+    uint32_t hour;              /* last operating hour covered */
+    uint32_t hours;             /* span in hours */
+    uint16_t cell_min_mv;
+    uint16_t cell_max_mv;
+    uint16_t cell_mean_mv;
+    int16_t  temp_min_deci_c;
+    int16_t  temp_max_deci_c;
+    int16_t  temp_mean_deci_c;
+    uint32_t charge_mah;
+    uint32_t discharge_mah;
+    uint32_t peak_charge_ma;
+    uint32_t peak_discharge_ma;
+    uint32_t mode_s[BMS_MODE_COUNT];
+} bms_history_rec_t;
+
+typedef struct {
+    uint32_t hours_closed;
+    uint32_t records[BMS_HIST_TIERS];
+    uint32_t rotations;         /* sector erases */
+    uint32_t dropped;           /* hour finished before the last was written */
+    uint32_t torn;              /* bad record found at mount */
+    uint32_t verify_fail;
+} bms_history_stats_t;
+
+/** Mount every tier and rebuild the partial day/month (boot). */
+void bms_history_init(void);
+
+/** Fold one pass into the current hour (state task, any cadence). */
+void bms_history_sample(const bms_pack_data_t *pack);
+
+/**
+ * Append a finished hour and any roll-ups it completes (NVM task). A
+ * tier rotation the NVM erase budget defers resumes on the next call.
+ * @return true if something was written or is still waiting
+ */
+bool bms_history_flush(void);
+
+/** Stored records in a tier (flash scan). */
+uint16_t bms_history_count(bms_history_tier_t tier);
+
+/** n-th newest stored record of a tier; n = 0 is the newest. */
+bool bms_history_get(bms_history_tier_t tier, uint16_t n, bms_history_rec_t *out);
+
+/**
+ * Decode a raw sector image (host tools reading it over diagnostics).
+ * @return records written to out; 0 for a blank or foreign sector
+ */
+uint16_t bms_history_decode_sector(const uint8_t *img, uint32_t len,
+                                   bms_history_rec_t *out, uint16_t max);
+
+/** Raw page of the history region (diagnostics), page 0 = tier 0 sector 0. */
+bool bms_history_read_page(uint16_t page, uint8_t *out);
+
+void bms_history_get_stats(bms_history_stats_t *out);
+
+#endif /* BMS_HISTORY_H */
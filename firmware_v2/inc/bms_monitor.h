@@ -7,6 +7,16 @@
  *   P0-01: Sensor fault detection — sentinel, cross-check, consecutive (Dave, Priya)
  *   P0-02: I2C failure counting and fault latching (Dave, Catherine)
  *   P2-07: Stack vs cells cross-check, plausibility (Dave, Yara, Priya)
+ *
+ * Acquisition modes:
+ *   BMS_ACQ_FULL_SCAN  one module per tick, every cell/TS register read and
+ *                      pack extremes recomputed once per 22-tick sweep.
+ *   BMS_ACQ_SUMMARY    every module's on-chip DASTATUS5 summary each tick
+ *                      (pack max/min/sum/temps refreshed every 10 ms), plus
+ *                      per-cell detail for one rotating module every
+ *                      BMS_ACQ_DETAIL_EVERY_TICKS, and on the ticks between
+ *                      for any module whose summary crosses a warning
+ *                      threshold. Default when BMS_ACQ_SUMMARY_ENABLED.
  */
 
 #ifndef BMS_MONITOR_H
@@ -14,12 +24,28 @@
 
 #include "bms_types.h"
 
+typedef enum {
+    BMS_ACQ_FULL_SCAN = 0,
+    BMS_ACQ_SUMMARY
+} bms_acq_mode_t;
+
 void     bms_monitor_init(bms_pack_data_t *pack);
 void     bms_monitor_run(bms_pack_data_t *pack);
+/** One run covering dt_ms (POWER_SAVE slow scan): SoC and uptime advance
+ *  by dt, and a full scan (or the summary detail rotation) reads as many
+ *  modules as dt spans, stopping at the end of the sweep — one whole fresh
+ *  sweep per run at 220 ms (440 ms) or more. */
+void     bms_monitor_run_dt(bms_pack_data_t *pack, uint32_t dt_ms);
 void     bms_monitor_read_module(bms_pack_data_t *pack, uint8_t module_id);
 void     bms_monitor_aggregate(bms_pack_data_t *pack);
 uint8_t  bms_monitor_get_scan_index(void);
 bool     bms_monitor_scan_complete(void);
 uint32_t bms_monitor_get_scan_count(void);
 
+void           bms_monitor_set_mode(bms_acq_mode_t mode);
+bms_acq_mode_t bms_monitor_get_mode(void);
+
+/** Queue a per-cell detail read of one module for the next tick. */
+void     bms_monitor_request_detail(uint8_t module_id);
+
 #endif /* BMS_MONITOR_H */
@@ -6,6 +6,22 @@
  * Reviewer findings addressed:
  *   P2-05: Reset event logging (Yara)
  *   P1-02: IWDG reset logging (Henrik)
+ *
+ * Storage is an append-only journal over BMS_NVM_JOURNAL_SECTORS flash
+ * sectors. Every sector starts with a snapshot (persistent data + the live
+ * fault log) followed by delta records; mount replays only the newest
+ * sector with a valid snapshot. See bms_nvm.c for the record format.
+ *
+ * Erase budget: the NVM task may start one sector erase per release
+ * (bms_nvm_release), shared by the journal, the black box and the
+ * history. The erase runs in the part; whoever is refused or finds it
+ * still running keeps its work for a later release, so no release ever
+ * waits on an erase.
+ *
+ * Other tasks never read the live fault ring: the NVM task publishes a
+ * newest-first copy after every change (two buffers + sequence counter,
+ * as bms_pack_share does for the pack) and readers take
+ * bms_nvm_fault_log_read(), which retries if a publish moved under it.
  */
 
 #ifndef BMS_NVM_H
@@ -37,7 +53,9 @@ typedef enum {
     NVM_FAULT_HW_OV       = 18,
     NVM_FAULT_HW_UV       = 19,
     NVM_FAULT_HW_OT       = 20,
-    NVM_FAULT_IMD_TREND   = 21   /* P1-06: periodic resistance log entry */
+    NVM_FAULT_IMD_TREND   = 21,  /* P1-06: periodic resistance log entry */
+    NVM_FAULT_LOG_OVERFLOW= 22,  /* value = events lost to a full queue */
+    NVM_FAULT_CAN_AUTH    = 23   /* CC-01 MAC hold-off, value = hold-offs so far */
 } bms_nvm_fault_type_t;
 
 typedef struct {
@@ -52,21 +70,99 @@ typedef struct {
     uint32_t runtime_hours;
     uint32_t total_charge_mah;
     uint32_t total_discharge_mah;
+    uint32_t soh_capacity_mah;                      /* bms_soh; 0 = not learned */
+    uint16_t soh_module_r_uohm[BMS_NUM_MODULES];    /* bms_soh; 0 = not learned */
+    uint32_t can_rx_fv;                             /* bms_can_auth high-water mark */
 } bms_nvm_persistent_t;
 
+typedef struct {
+    uint32_t commits;       /* records programmed (incl. snapshots) */
+    uint32_t events;        /* fault events made durable */
+    uint32_t rotations;     /* sector changes (one erase each) */
+    uint32_t torn;          /* bad record found at mount */
+    uint32_t verify_fail;   /* read-back mismatch after program */
+} bms_nvm_stats_t;
+
+/* Published copy of the fault ring for other tasks */
+typedef struct {
+    bms_nvm_fault_event_t ev[BMS_NVM_FAULT_LOG_SIZE];   /* newest first */
+    uint8_t               count;
+} bms_nvm_fault_log_t;
+
 typedef struct {
     bms_nvm_fault_event_t fault_log[BMS_NVM_FAULT_LOG_SIZE];
     uint8_t               fault_head;
     uint8_t               fault_count;
     bms_nvm_persistent_t  persistent;
+
+    /* Journal state — owned by bms_nvm.c */
+    bms_nvm_fault_event_t pending[BMS_NVM_COMMIT_MAX_EVENTS];
+    uint8_t               pending_count;
+    bool                  mounted;      /* false: RAM-only, never touches flash */
+    bool                  sector_full;  /* next commit rotates */
+    bool                  rotate_due;   /* rotation waiting for the erase budget */
+    uint8_t               sector;       /* active sector */
+    uint32_t              offset;       /* next free byte in active sector */
+    uint32_t              seq;          /* last committed sequence number */
+    bms_nvm_stats_t       stats;
+
+    /* Seqlock publication of the fault ring — written by the NVM task */
+    bms_nvm_fault_log_t   shared[2];
+    volatile uint32_t     shared_front;
+    volatile uint32_t     shared_seq;   /* bumped after every flip */
 } bms_nvm_ctx_t;
 
+/** Zero ctx and mount the journal (bms_nvm_load_persistent). Boot is a
+ *  release of its own: the erase budget starts armed. */
 void bms_nvm_init(bms_nvm_ctx_t *ctx);
+
+/** NVM task, first thing in every release: re-arm the one-erase budget. */
+void bms_nvm_release(void);
+
+/**
+ * Make sure the sector containing addr is erased, without waiting: starts
+ * the erase if this release's budget is free and no other erase runs.
+ * Call again with the same addr on later releases until it returns true,
+ * then program; never call it again for a sector already written.
+ */
+bool bms_nvm_erase_sector(uint32_t addr);
+
+/**
+ * Record a fault in the RAM log and stage it for the next commit.
+ * Commits by itself only when BMS_NVM_COMMIT_MAX_EVENTS are staged.
+ */
 void bms_nvm_log_fault(bms_nvm_ctx_t *ctx, uint32_t timestamp_ms,
                         uint8_t fault_type, uint8_t cell_index, uint16_t value);
+
+/**
+ * Write all staged faults as one journal record. Called once per
+ * protection cycle so a burst of faults costs one program sequence; with
+ * nothing staged it finishes a rotation left by the erase budget.
+ * @return false on an unmounted ctx, a failed program or a deferred
+ *         rotation (the events stay in the RAM log and go out with the
+ *         next sector's snapshot)
+ */
+bool bms_nvm_commit(bms_nvm_ctx_t *ctx);
+
 void bms_nvm_save_persistent(bms_nvm_ctx_t *ctx);
+
+/** Mount: replay the newest valid sector into ctx. */
 void bms_nvm_load_persistent(bms_nvm_ctx_t *ctx);
+/** Owner task only (NVM task, or before tasks start); idx 0 = newest. */
 bool bms_nvm_get_fault(const bms_nvm_ctx_t *ctx, uint8_t idx,
                         bms_nvm_fault_event_t *event);
 
+/** Any task: consistent copy of the last published fault log. Never
+ *  blocks; retries only if the NVM task published during the copy. */
+void bms_nvm_fault_log_read(const bms_nvm_ctx_t *ctx, bms_nvm_fault_log_t *out);
+
+/** CRC-32 (IEEE) used by the journal records; shared with the black box. */
+uint32_t bms_nvm_crc32(const uint8_t *p, uint32_t len);
+
+/**
+ * Program len bytes at addr in page-sized pieces, then read back and
+ * compare (NVM task only). Caller guarantees the range is erased.
+ */
+bool bms_nvm_program(uint32_t addr, const uint8_t *data, uint32_t len);
+
 #endif /* BMS_NVM_H */
@@ -0,0 +1,74 @@
+/**
+ * @file bms_nvm_queue.h
+ * @brief Write-behind fault event queue in front of the NVM journal
+ *
+ * Street Smart Edition.
+ * Protection, safety I/O and fault reset push events here in O(1) with
+ * no flash access; a low-priority task drains the ring into the journal
+ * (bms_nvm_log_fault + one bms_nvm_commit per drain). Protection WCET
+ * no longer depends on flash program/erase time, and the IWDG feed in
+ * the protection task can't be starved by a sector erase.
+ *
+ * Same SPSC scheme as the CAN rings: producers own head, the drain task
+ * owns tail, indices are free-running uint8_t. Producers must not run
+ * concurrently with each other. Bare-metal, they all run from the one
+ * cooperative loop. In the RTOS build:
+ *   - protection pushes with no lock; it is the highest-priority task, so
+ *     no other producer can preempt it mid-push;
+ *   - safety I/O and the state task (fault reset) push only from inside
+ *     their BMS_ENTER_CRITICAL section, so protection can't preempt them.
+ * A new producer must do the same: run at protection's priority or push
+ * under BMS_ENTER_CRITICAL. Never push from an ISR.
+ *
+ * Overflow drops the NEWEST event (the first fault of a burst is the
+ * root cause) and counts it; the next drain writes one
+ * NVM_FAULT_LOG_OVERFLOW event carrying the number lost.
+ *
+ * Brownout: the PVD interrupt calls bms_nvm_queue_brownout_isr(), which
+ * wakes the drain task through the hook so the queue reaches flash
+ * within the supply hold-up time.
+ */
+
+#ifndef BMS_NVM_QUEUE_H
+#define BMS_NVM_QUEUE_H
+
+#include "bms_nvm.h"
+
+typedef struct {
+    uint32_t pushed;
+    uint32_t dropped;       /* ring full — newest event lost */
+    uint32_t drained;
+    uint32_t drains;        /* drain calls that wrote something */
+    uint32_t brownouts;
+    uint8_t  ring_hwm;
+} bms_nvm_queue_stats_t;
+
+typedef void (*bms_nvm_queue_hook_t)(void);
+
+void bms_nvm_queue_init(void);
+
+/** Wake the drain task (e.g. vTaskNotifyGiveFromISR); may run in an ISR. */
+void bms_nvm_queue_set_wake_hook(bms_nvm_queue_hook_t hook);
+
+/**
+ * Queue one fault event. O(1), never touches flash.
+ * @return false if the ring was full (event counted as dropped)
+ */
+bool bms_nvm_queue_push(uint32_t timestamp_ms, uint8_t fault_type,
+                        uint8_t cell_index, uint16_t value);
+
+/**
+ * Move every queued event into ctx and commit once (task context).
+ * Clears a pending brownout request.
+ * @return number of events drained, not counting an overflow marker
+ */
+uint8_t bms_nvm_queue_drain(bms_nvm_ctx_t *ctx);
+
+/** PVD / brownout ISR: request an immediate drain. */
+void bms_nvm_queue_brownout_isr(void);
+bool bms_nvm_queue_brownout_pending(void);
+
+uint8_t bms_nvm_queue_depth(void);
+void bms_nvm_queue_get_stats(bms_nvm_queue_stats_t *out);
+
+#endif /* BMS_NVM_QUEUE_H */
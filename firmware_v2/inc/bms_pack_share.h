@@ -0,0 +1,87 @@
+/**
+ * @file bms_pack_share.h
+ * @brief Pack data shared between RTOS tasks without task-wide critical sections
+ *
+ * Street Smart Edition.
+ * P3-05 put every task body that touches g_pack inside
+ * BMS_ENTER_CRITICAL() — correct, but the monitor's I2C sweep and the
+ * 308-cell loops ran with interrupts off for milliseconds. The pack now
+ * splits by owner:
+ *
+ *   Measurements  written only by the monitor. It works on a private
+ *                 bms_pack_data_t, then publishes: copy into the back
+ *                 buffer, flip. Readers copy the front buffer between two
+ *                 reads of a sequence counter and retry if it moved, so
+ *                 the writer never waits and never disables interrupts.
+ *   Control       faults, fault_latched, has_warning, mode, limits, SoC,
+ *                 contactor state, last EMS message — a few words. Each
+ *                 task snapshots them with its copy, runs on the copy, then
+ *                 commits only what it changed: fault bits with atomic
+ *                 OR / AND-NOT (a bit another task set meanwhile is never
+ *                 lost), the rest with single aligned word stores.
+ *
+ * Seqlock with two buffers: the writer fills the buffer readers are NOT
+ * on, flips, then bumps seq. It only refills a buffer after flipping away
+ * from it, so a reader still on the old front buffer when the writer
+ * comes round to it sees seq moved and retries — a torn copy is never
+ * accepted. A reader that preempts the writer never spins: whichever
+ * buffer is front at that moment is complete.
+ *
+ * Single writer for the measurements (monitor task). The bare-metal loop
+ * in main.c is cooperative and keeps using g_pack directly.
+ */
+
+#ifndef BMS_PACK_SHARE_H
+#define BMS_PACK_SHARE_H
+
+#include "bms_types.h"
+
+/* Control half of the pack as a task saw it at snapshot time */
+typedef struct {
+    uint32_t faults;                /* bms_fault_flags_t bits */
+    bool     fault_latched;
+    bool     has_warning;
+    uint16_t soc_hundredths;
+    int32_t  charge_limit_ma;
+    int32_t  discharge_limit_ma;
+    uint8_t  contactor_state;
+    uint8_t  mode;
+    uint32_t last_ems_msg_ms;
+} bms_pack_ctl_t;
+
+typedef struct {
+    uint32_t publishes;
+    uint32_t reads;
+    uint32_t retries;               /* copies thrown away, writer moved */
+    uint32_t max_retries;           /* worst single read */
+    uint32_t fault_sets;            /* atomic OR commits */
+    uint32_t fault_clears;          /* atomic AND-NOT commits */
+} bms_pack_share_stats_t;
+
+/** Seed both buffers and the control words from an initialised pack. */
+void bms_pack_share_init(const bms_pack_data_t *pack);
+
+/** Monitor only: publish its working pack as the new front buffer. */
+void bms_pack_share_publish(const bms_pack_data_t *pack);
+
+/**
+ * Seqlock read side, for readers that want a few fields, not a copy:
+ *   do { p = bms_pack_share_read_begin(&seq); ...copy... }
+ *   while (bms_pack_share_read_retry(seq));
+ * Never blocks; the pointer is only valid until read_retry().
+ */
+const bms_pack_data_t *bms_pack_share_read_begin(uint32_t *seq);
+bool bms_pack_share_read_retry(uint32_t seq);
+
+/** Consistent copy of the measurements, control words overlaid. */
+void bms_pack_share_snapshot(bms_pack_data_t *dst, bms_pack_ctl_t *ctl);
+
+/** Overlay only the control words (the monitor, which owns the rest). */
+void bms_pack_share_pull(bms_pack_data_t *dst, bms_pack_ctl_t *ctl);
+
+/** Commit what the task changed in pack since ctl was taken. */
+void bms_pack_share_commit(const bms_pack_ctl_t *ctl, const bms_pack_data_t *pack);
+
+void bms_pack_share_get_stats(bms_pack_share_stats_t *out);
+
+#endif /* BMS_PACK_SHARE_H */
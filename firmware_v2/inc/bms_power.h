@@ -0,0 +1,57 @@
+/**
+ * @file bms_power.h
+ * @brief Tickless POWER_SAVE: slow scan, STOP between scans, ALERT/CAN wake
+ *
+ * Street Smart Edition.
+ * In POWER_SAVE the pack is parked with contactors open, yet the loop kept
+ * polling all 22 AFEs every 10 ms and spinning between jobs. Once the pack
+ * has been quiet for BMS_PS_WAKE_HOLD_MS this module switches bms_sched
+ * to the low-power cadence (BMS_PS_SCAN_PERIOD_MS) and the idle hook puts
+ * the MCU into STOP until the next release.
+ *
+ * Between scans the BQ76952s protect on their own (P1-01 thresholds and
+ * FET trip) and pull the wired-OR ALERT line on any safety alert; that
+ * line and CAN RX activity wake the MCU, and full cadence is restored at
+ * the wake tick — monitor and protection are released at once.
+ *
+ * Full cadence also returns, from the slow scan itself, on a mode change,
+ * a latched fault, a contactor leaving OPEN, or a reading past a warning
+ * threshold, so the protection filters see a fault at 10 ms resolution.
+ *
+ * The IWDG cannot be stopped in STOP on the F4: each STOP is at most
+ * BMS_PS_STOP_MAX_MS and the idle hook feeds the watchdog after it.
+ * Bare-metal loop only; the RTOS build would use configUSE_TICKLESS_IDLE.
+ */
+
+#ifndef BMS_POWER_H
+#define BMS_POWER_H
+
+#include "bms_types.h"
+
+typedef struct {
+    uint32_t entries;           /* switches to the low-power cadence */
+    uint32_t stops;             /* STOP periods entered */
+    uint32_t slept_ms;          /* time spent in STOP */
+    uint32_t wakes_alert;       /* full cadence restored by AFE ALERT */
+    uint32_t wakes_can;         /* ... by CAN RX activity */
+    uint32_t exits;             /* ... by the slow scan (mode, fault, limits) */
+} bms_power_stats_t;
+
+void bms_power_init(uint32_t now);
+
+/**
+ * Decide the cadence from the latest scan. Called after every protection
+ * run; switches bms_sched in either direction.
+ */
+void bms_power_update(const bms_pack_data_t *pack, uint32_t now);
+
+/**
+ * Idle hook: nothing released for idle_ms (bms_sched_idle_ms). At the
+ * low-power cadence, STOP for up to that long; otherwise return at once.
+ */
+void bms_power_idle(uint32_t now, uint32_t idle_ms);
+
+bool bms_power_low(void);
+void bms_power_get_stats(bms_power_stats_t *out);
+
+#endif /* BMS_POWER_H */
@@ -10,6 +10,13 @@
  *   P0-05: Sub-zero charging hard fault (Dave)
  *   P2-05: Timer preservation across reset (Yara)
  *   P2-07: Plausibility checks (Dave, Yara, Priya)
+ *
+ * Per-cell / per-sensor integrators are 16-bit, saturating at 65.535 s
+ * (every delay they are compared against is ≤ 5 s). A per-module bitmap
+ * marks which integrators are nonzero so a healthy pack only visits
+ * 22 words on the decay path instead of 682 timers.
+ *   RAM: 2 × 308 × 4 + 66 × 4 = 2728 B  →  2 × 308 × 2 + 66 × 2 + 3 × 22 × 2
+ *        = 1496 B (1232 B freed).
  */
 
 #ifndef BMS_PROTECTION_H
@@ -17,13 +24,24 @@
 
 #include "bms_types.h"
 
+#define BMS_PROT_TIMER_MAX_MS  0xFFFFU
+
+_Static_assert(BMS_SE_FAULT_DELAY_MS <= BMS_PROT_TIMER_MAX_MS,
+               "Per-cell fault delay must fit 16-bit integrator");
+_Static_assert(BMS_TEMPS_PER_MODULE <= 16U, "Sensor mask must fit in uint16_t");
+
 typedef struct {
-    /* Per-cell leaky integrator timers */
-    uint32_t ov_timer_ms[BMS_SE_PER_PACK];
-    uint32_t uv_timer_ms[BMS_SE_PER_PACK];
+    /* Per-cell leaky integrator timers (saturating 16-bit) */
+    uint16_t ov_timer_ms[BMS_SE_PER_PACK];
+    uint16_t uv_timer_ms[BMS_SE_PER_PACK];
+
+    /* Per-sensor OT timers (saturating 16-bit) */
+    uint16_t ot_timer_ms[BMS_TOTAL_TEMP_SENSORS];
 
-    /* Per-sensor OT timers */
-    uint32_t ot_timer_ms[BMS_TOTAL_TEMP_SENSORS];
+    /* Sparse active sets: bit n of [mod] set ⇔ that integrator is nonzero */
+    uint16_t ov_active[BMS_NUM_MODULES];
+    uint16_t uv_active[BMS_NUM_MODULES];
+    uint16_t ot_active[BMS_NUM_MODULES];
 
     /* HW safety timers */
     uint32_t hw_ov_timer_ms;
@@ -56,7 +74,6 @@ typedef struct {
 } bms_protection_state_t;
 
 void bms_protection_init(bms_protection_state_t *prot);
-void bms_protection_set_nvm(void *nvm);
 
 /**
  * Run all protection checks for one cycle.
@@ -14,12 +14,6 @@
 #define BMS_SAFETY_IO_H
 
 #include "bms_types.h"
-#include "bms_nvm.h"
-
-/**
- * Set NVM context for IMD resistance trend logging.
- */
-void bms_safety_io_set_nvm(bms_nvm_ctx_t *nvm);
 
 /**
  * Initialize safety I/O subsystem.
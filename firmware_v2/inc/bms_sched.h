@@ -0,0 +1,91 @@
+/**
+ * @file bms_sched.h
+ * @brief Table-driven rate-monotonic scheduler for the bare-metal loop
+ *
+ * Street Smart Edition.
+ * The superloop used to keep one `last_*` timestamp per task, all seeded
+ * with the same `now`, so every 1000 ms monitor, protection, contactor,
+ * state, CAN TX, safety I/O and thermal ran back to back in one pass and
+ * the 10 ms protection slot after it started late by their sum.
+ *
+ * Each task now has a fixed release grid, now0 + phase + k × period.
+ * bms_sched_dispatch() runs the highest-priority released task — the
+ * table order, shortest period first — and returns, so the loop re-scans
+ * from the top after every job and a 10 ms task never waits behind more
+ * than the one job already running. Phases put the slow tasks in frames
+ * of their own; main.c checks at compile time that every frame fits.
+ *
+ * A task that starts a full period or more after its release overran.
+ * Policy per task:
+ *   SKIP     drop the missed releases, resume on the grid (sampling,
+ *            telemetry — a second run now carries nothing new)
+ *   CATCHUP  replay up to BMS_SCHED_CATCHUP_MAX missed releases back to
+ *            back, then skip the rest (tasks that count time in calls:
+ *            fault filters, contactor and safety I/O timers)
+ *
+ * An optional early() hook releases a task off-grid (urgent EMS command,
+ * brownout); the grid itself is not moved.
+ *
+ * Low-power cadence (bms_power, POWER_SAVE): every task switches to its
+ * lp_period_ms, all released together so the MCU wakes once per scan,
+ * and bms_sched_idle_ms() tells the idle hook how long it may STOP. Each
+ * run is passed the period it is running at, as its dt.
+ */
+
+#ifndef BMS_SCHED_H
+#define BMS_SCHED_H
+
+#include "bms_types.h"
+
+#define BMS_SCHED_MAX_TASKS   12U
+#define BMS_SCHED_NO_TRACE    0xFFU
+
+typedef enum {
+    BMS_SCHED_SKIP = 0,
+    BMS_SCHED_CATCHUP
+} bms_sched_policy_t;
+
+typedef struct {
+    void     (*run)(uint32_t dt_ms);
+    bool     (*early)(void);        /* NULL, or true = run now, off-grid */
+    uint16_t period_ms;
+    uint16_t phase_ms;              /* < period_ms */
+    uint16_t lp_period_ms;          /* low-power cadence, ≥ period_ms; 0 = same */
+    bms_sched_policy_t policy;
+    uint8_t  trace;                 /* bms_trace_task_t or BMS_SCHED_NO_TRACE */
+} bms_sched_task_t;
+
+typedef struct {
+    uint32_t runs;
+    uint32_t early_runs;
+    uint32_t overruns;              /* jobs started ≥ one period after release */
+    uint32_t caught_up;             /* replayed releases (CATCHUP) */
+    uint32_t skipped;               /* dropped releases */
+    uint32_t max_late_ms;           /* start - release, worst case */
+} bms_sched_stats_t;
+
+/**
+ * Start the grid at now. The table is read in place and must outlive the
+ * scheduler; its order is the priority order.
+ * @return 0, or -1 if the table is empty, too long, or has a zero period,
+ *         a phase not below its period or a low-power period below it
+ */
+int32_t bms_sched_init(const bms_sched_task_t *table, uint8_t count, uint32_t now);
+
+/** Run the highest-priority released task, if any. @return true if one ran */
+bool bms_sched_dispatch(uint32_t now);
+
+/**
+ * Switch cadence at now. Entering low power releases every task next at
+ * now + its lp period; leaving restarts the full grid at now, so the
+ * phase-0 tasks (monitor, protection) run at once.
+ */
+void bms_sched_set_low_power(bool low, uint32_t now);
+bool bms_sched_low_power(void);
+
+/** ms until the next grid release (0 if one is due). */
+uint32_t bms_sched_idle_ms(uint32_t now);
+
+void bms_sched_get_stats(uint8_t task, bms_sched_stats_t *out);
+
+#endif /* BMS_SCHED_H */
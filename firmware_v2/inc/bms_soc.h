@@ -1,8 +1,31 @@
 /**
  * @file bms_soc.h
- * @brief SoC estimation — coulomb counting + OCV reset
+ * @brief SoC estimation — fixed-point EKF over a 1-RC equivalent circuit
  *
  * Street Smart Edition.
+ * The coulomb counter truncated every 10 ms step to 0.01 % (anything under
+ * ~4.6 kA·10 ms counted as zero) and only re-anchored from OCV after 30 s
+ * at rest in READY — which a vessel on a duty cycle never gets. Now:
+ *
+ *   state   x = [SoC, V_rc]            SoC Q31 fraction, V_rc Q31 volts
+ *   predict every call (bms_soc_update): exact integer coulomb count —
+ *           the sub-LSB remainder is carried, nothing is truncated away —
+ *           and V_rc relaxing towards R1·I with tau = R1·C1
+ *   correct once per fresh scan (bms_soc_correct, at most every
+ *           BMS_SOC_EKF_PERIOD_MS): scalar measurement
+ *           avg_cell_mv = OCV(SoC) + V_rc + R0·I, H = [dOCV/dSoC, 1]
+ *
+ * Covariance P is 2×2 symmetric, Q31 in the same SI units as the state;
+ * products in int64, no FPU and no floating point. Measurement noise
+ * grows with |I| (R0 uncertainty × I), so the filter leans on OCV when
+ * the current is low and on the coulomb count when it is high — no rest
+ * period needed. Cost is bounded: a fixed 23-segment OCV search and two
+ * 64-bit divisions per correction (make wcet: soc/ekf-correct).
+ *
+ * SoC, 1-sigma and V_rc go out as CAN_ID_SOC_EST (bms_soc_encode_can).
+ * bms_cell_soc tracks each SE relative to this estimate: it needs the raw
+ * charge count and the model's average-cell terminal voltage. bms_sop
+ * extrapolates the same model (OCV, V_rc decay) over its horizons.
  */
 
 #ifndef BMS_SOC_H
@@ -10,9 +33,34 @@
 
 #include "bms_types.h"
 
+typedef struct {
+    uint16_t soc_hundredths;
+    uint16_t soc_std_hundredths;    /* sqrt(P11) */
+    int32_t  vrc_uv;
+    uint32_t vrc_std_uv;            /* sqrt(P22) */
+    int8_t   corr_pct;              /* P12 / (sigma_soc · sigma_vrc), % */
+    int32_t  innov_uv;              /* last measurement residual */
+    uint32_t updates;               /* corrections applied */
+} bms_soc_est_t;
+
 void     bms_soc_init(uint16_t initial_soc_hundredths);
+/** Predict: coulomb count + RC relaxation over dt_ms. Every monitor run. */
 void     bms_soc_update(bms_pack_data_t *pack, uint32_t dt_ms);
+/** Correct from avg_cell_mv after a fresh scan; throttled internally. */
+void     bms_soc_correct(bms_pack_data_t *pack);
 uint16_t bms_soc_from_ocv(uint16_t cell_mv);
 uint16_t bms_soc_get(void);
+void     bms_soc_get_estimate(bms_soc_est_t *out);
+void     bms_soc_encode_can(bms_can_frame_t *frame);
+/** Charge counted since init, Q31 SoC (efficiency applied, never clamped
+ *  or corrected — differences are pure coulombs). */
+int64_t  bms_soc_get_charge_q31(void);
+/** Model terminal voltage of an average cell at i_ma, µV; slope dOCV/dSoC
+ *  at the current estimate in Q16 V (= µV/ppm). */
+int32_t  bms_soc_model_cell_uv(int32_t i_ma, int32_t *slope_q16);
+/** The model's OCV at any SoC (ppm, clamped to 0…10⁶), µV; slope as above. */
+int32_t  bms_soc_ocv_uv(int32_t soc_ppm, int32_t *slope_q16);
+/** RC branch decay exp(−dt/τ) in Q30 over dt_ms (≤ 60 s). */
+int32_t  bms_soc_rc_decay_q30(uint32_t dt_ms);
 
 #endif /* BMS_SOC_H */
@@ -0,0 +1,66 @@
+/**
+ * @file bms_soh.h
+ * @brief State of health — online resistance and capacity by RLS
+ *
+ * Street Smart Edition.
+ * Limits and the C-rate conversion assumed BMS_NOMINAL_CAPACITY_MAH and
+ * a fresh R forever. Two scalar regressions now track the aged pack, both
+ * exponentially-weighted least squares in information form:
+ *
+ *   S_xx ← λ·S_xx + x²    S_xy ← λ·S_xy + x·y    θ = S_xy / S_xx
+ *
+ * which for one parameter is exactly RLS with forgetting (P = 1/S_xx),
+ * seeded with a prior of weight S_xx0 at the nominal θ. Integer sums,
+ * λ in Q16, one division per accepted event.
+ *
+ *   resistance  per module, at each of its scans: x = ΔI, y = Δstack_mv
+ *               since its previous scan, when |ΔI| ≥ BMS_SOH_R_STEP_MA.
+ *               220 ms apart, OCV and the slow RC branch barely move, so
+ *               the step response is the ohmic R. Pack R = Σ modules.
+ *   capacity    at each OCV rest (|I| < BMS_SOH_REST_MA for
+ *               BMS_SOH_REST_MS): x = ΔSoC from OCV, y = counted charge
+ *               since the previous rest; θ = C / C_nom once the swing is
+ *               at least BMS_SOH_CAP_MIN_SWING.
+ *
+ * Results survive resets in bms_nvm_persistent_t. The monitor task
+ * estimates; bms_soh_flush (NVM task) writes — handed over through one
+ * ready slot, as bms_history does.
+ */
+
+#ifndef BMS_SOH_H
+#define BMS_SOH_H
+
+#include "bms_types.h"
+#include "bms_nvm.h"
+
+typedef struct {
+    uint32_t capacity_mah;
+    uint32_t pack_r_uohm;           /* Σ module R */
+    uint32_t r_events;              /* current steps used */
+    uint32_t cap_events;            /* rest-to-rest swings used */
+    uint32_t persisted;             /* handed to the NVM task */
+} bms_soh_t;
+
+/** Nominal capacity and R, empty regressions (monitor init). */
+void     bms_soh_init(void);
+
+/** Seed from stored estimates; zero fields stay nominal (boot, after NVM mount). */
+void     bms_soh_restore(const bms_nvm_persistent_t *p);
+
+/** Resistance step check for one module after its stack was read. */
+void     bms_soh_module_scan(const bms_pack_data_t *pack, uint8_t mod_idx);
+
+/** Rest detection and capacity fit; every monitor run, after bms_soc. */
+void     bms_soh_update(const bms_pack_data_t *pack, uint32_t dt_ms);
+
+uint32_t bms_soh_get_capacity_mah(void);
+uint32_t bms_soh_get_module_r_uohm(uint8_t mod_idx);
+void     bms_soh_get(bms_soh_t *out);
+
+/**
+ * Write estimates handed over since the last call (NVM task).
+ * @return true if a persistent record was written
+ */
+bool     bms_soh_flush(bms_nvm_ctx_t *ctx);
+
+#endif /* BMS_SOH_H */
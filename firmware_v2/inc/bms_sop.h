@@ -0,0 +1,50 @@
+/**
+ * @file bms_sop.h
+ * @brief State of power — sustainable current over 2 / 10 / 30 s horizons
+ *
+ * Street Smart Edition.
+ * charge_limit_ma / discharge_limit_ma are instantaneous derating: they
+ * say nothing about whether a 30 s thruster burst at that current ends
+ * below the SEV warning level. This extrapolates the SoC model's ECM over
+ * each horizon h at a constant current I, for the limiting SE (fullest
+ * for charge, emptiest for discharge, from bms_cell_soc):
+ *
+ *   V(h) = OCV(SoC + I·h/C) + V_rc·a + I·(R0 + R1·(1 − a)),  a = e^(−h/τ)
+ *
+ * R0 from the cell's R(T, SoC) table at the coldest sensor, times an
+ * ageing factor (bms_soh's learned R over the table, ≥ 1); C is
+ * bms_soh's capacity. V is linear in I but for the OCV and R0 terms, so:
+ * solve with the OCV tangent and R0 at the start, then once more with the
+ * secant and R0 over / at the SoC the first answer would reach. Both
+ * corrections err on the safe side. V(t) has no interior extreme between
+ * 0 and h in the limiting direction, so each horizon is also capped by
+ * the t = 0 answer and by the shorter horizons.
+ *
+ * Results never exceed the instantaneous limits, are recomputed every
+ * BMS_SOP_PERIOD_MS in the monitor task into bms_pack_data_t, and go out
+ * as CAN_ID_SOP_DCHG / CAN_ID_SOP_CHG. Fixed cost per side: 1 + 3 OCV
+ * evaluations and 1 + 3 table lookups (make wcet: sop/compute). make
+ * sopbench checks the predictions against the C simulator.
+ */
+
+#ifndef BMS_SOP_H
+#define BMS_SOP_H
+
+#include "bms_types.h"
+
+/** Zero the published figures, cache the horizon decays. Monitor init. */
+void bms_sop_init(bms_pack_data_t *pack);
+
+/** Every monitor run, after the current limits; recomputes at 10 Hz. */
+void bms_sop_update(bms_pack_data_t *pack, uint32_t dt_ms);
+
+/** Recompute now (bms_sop_update when due; tests and the bench). */
+void bms_sop_compute(bms_pack_data_t *pack);
+
+/** Cell R0 in µΩ at a temperature and SoC from the table, no ageing. */
+uint32_t bms_sop_cell_r_uohm(int16_t temp_deci_c, uint16_t soc_hundredths);
+
+void bms_sop_encode_can(const bms_pack_data_t *pack,
+                        bms_can_frame_t *dchg_frame, bms_can_frame_t *chg_frame);
+
+#endif /* BMS_SOP_H */
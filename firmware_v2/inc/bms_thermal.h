@@ -9,7 +9,13 @@
  *      best early indicator of thermal runaway" — Priya
  *     "~50-80 lines of C code. No hardware changes." — Priya
  *
- * Implementation: Per-sensor 30-sample moving average of dT/dt.
+ * Implementation: Per-sensor least-squares slope over a 30-sample window,
+ * updated in O(1) per sample from running ΣT and ΣkT (Σk and the normal-
+ * equation denominator are constants once the window is full). History is
+ * kept as int8 deltas (±12.7 °C/s slew limit) plus the oldest absolute
+ * sample: 41 B/sensor vs 60 B for the old int16 ring.
+ * BMS_DTDT_ESTIMATOR = BMS_DTDT_EST_EWMA drops the history entirely and
+ * uses double exponential smoothing instead: 10 B/sensor.
  * Alarm when dT/dt > 1°C/min sustained 30s with no load increase.
  */
 
@@ -19,8 +25,18 @@
 #include "bms_types.h"
 
 typedef struct {
-    /* Per-sensor temperature history for dT/dt (circular buffer) */
-    int16_t  temp_history[BMS_TOTAL_TEMP_SENSORS][BMS_DTDT_WINDOW_SAMPLES];
+#if BMS_DTDT_ESTIMATOR == BMS_DTDT_EST_LSQ
+    /* Per-sensor window: oldest sample + N−1 packed deltas (circular) */
+    int8_t   delta[BMS_TOTAL_TEMP_SENSORS][BMS_DTDT_WINDOW_SAMPLES - 1U];
+    int16_t  oldest_deci_c[BMS_TOTAL_TEMP_SENSORS];
+    int32_t  sum_t[BMS_TOTAL_TEMP_SENSORS];     /* Σ T_k        */
+    int32_t  sum_kt[BMS_TOTAL_TEMP_SENSORS];    /* Σ k·T_k, k=0 oldest */
+#else
+    /* Double EWMA of temperature (deci-°C, Q8) */
+    int32_t  ewma1_q8[BMS_TOTAL_TEMP_SENSORS];
+    int32_t  ewma2_q8[BMS_TOTAL_TEMP_SENSORS];
+#endif
+    int16_t  last_deci_c[BMS_TOTAL_TEMP_SENSORS];
     uint8_t  history_idx;
     uint8_t  history_count;
 
@@ -0,0 +1,100 @@
+/**
+ * @file bms_trace.h
+ * @brief Per-task runtime trace — execution time, release jitter,
+ *        deadline misses, stack high-water
+ *
+ * Street Smart Edition.
+ * Whether the 10 ms protection task ever overruns, or how close the
+ * 256–512 word stacks are to the edge, was guesswork. Each RTOS task body
+ * (or main-loop slot on bare metal) is bracketed by bms_trace_begin() /
+ * bms_trace_end(). Timestamps are DWT->CYCCNT on target and
+ * clock_gettime(CLOCK_MONOTONIC) on the desktop build, a few cycles each.
+ *
+ *   exec      end - begin, min / mean / max
+ *   jitter    release lateness, worst case: begin - (previous begin +
+ *             period). Measured from the previous start, so it fits both
+ *             vTaskDelayUntil() and bms_sched's grid on bare metal; an
+ *             early (event-woken) run counts 0.
+ *   miss      lateness + exec > period (implicit deadline)
+ *   stack     least free words ever reported for the task, against its
+ *             size (uxTaskGetStackHighWaterMark() under FreeRTOS, the
+ *             painted MSP on bare metal — every slot shares that one)
+ *
+ * Reported on CAN as CAN_ID_TASK_TRACE + task, one task per CAN period
+ * (bms_can_msgs.def), and as a text table on the desktop build.
+ * Single writer per task entry. Each published field is a single-copy
+ * atomic word, so a reader may mix two runs' values but never sees a
+ * torn one — fine for statistics.
+ */
+
+#ifndef BMS_TRACE_H
+#define BMS_TRACE_H
+
+#include "bms_types.h"
+
+typedef enum {
+    TRACE_PROTECTION = 0,
+    TRACE_MONITOR,
+    TRACE_CONTACTOR,
+    TRACE_SAFETY_IO,
+    TRACE_STATE,
+    TRACE_CAN,
+    TRACE_THERMAL,
+    TRACE_NVM,
+    TRACE_TASK_COUNT
+} bms_trace_task_t;
+
+typedef struct {
+    uint32_t runs;
+    uint32_t min_us;
+    uint32_t mean_us;
+    uint32_t max_us;
+    uint32_t jitter_max_us;
+    uint32_t misses;
+    uint16_t period_ms;
+    uint16_t stack_words;       /* 0 = not reported */
+    uint16_t stack_free_min;    /* words, least ever free */
+} bms_trace_stats_t;
+
+typedef uint32_t (*bms_trace_clock_t)(void);
+
+void bms_trace_init(void);
+
+/** Replace the timestamp source (NULL = this build's own clock). The
+ *  replacement counts in the same trace ticks; the host RTOS port uses it
+ *  to trace on its virtual clock. */
+void bms_trace_set_clock(bms_trace_clock_t now);
+
+/** Set a task's period (deadline) and stack size before it first runs. */
+void bms_trace_register(bms_trace_task_t id, uint16_t period_ms, uint16_t stack_words);
+
+/** Change a task's period (low-power cadence); the next interval is not
+ *  judged against either period. */
+void bms_trace_set_period(bms_trace_task_t id, uint16_t period_ms);
+
+/** Bracket one release of the task body. */
+void bms_trace_begin(bms_trace_task_t id);
+void bms_trace_end(bms_trace_task_t id);
+
+/** Same, with explicit timestamps in trace ticks (tests, replay). */
+void bms_trace_begin_at(bms_trace_task_t id, uint32_t t);
+void bms_trace_end_at(bms_trace_task_t id, uint32_t t);
+
+/** Trace ticks per microsecond on this build. */
+uint32_t bms_trace_ticks_per_us(void);
+
+/** Record a stack high-water sample (free words). */
+void bms_trace_stack(bms_trace_task_t id, uint16_t free_words);
+
+void bms_trace_get(bms_trace_task_t id, bms_trace_stats_t *out);
+
+/** Encode one task's figures into its CAN frame. */
+void bms_trace_encode_can(bms_trace_task_t id, bms_can_frame_t *frame);
+
+/** Encode the next task in round-robin order (one per CAN period). */
+void bms_trace_next_can(bms_can_frame_t *frame);
+
+/** Text table via BMS_LOG (desktop build; no-op on target). */
+void bms_trace_report(void);
+
+#endif /* BMS_TRACE_H */
@@ -25,7 +25,12 @@
 #include "bms_config.h"
 
 /* ── Logging ───────────────────────────────────────────────────────── */
-#ifdef DESKTOP_BUILD
+#if defined(DESKTOP_BUILD) && defined(BMS_LOG_OFF)
+  /* Host build with target logging (none): WCET harness. Arguments are
+   * type-checked and never evaluated. */
+  #include <stdio.h>
+  #define BMS_LOG(...) ((void)(0 && fprintf(stderr, __VA_ARGS__)))
+#elif defined(DESKTOP_BUILD)
   #include <stdio.h>
   #define BMS_LOG(...) fprintf(stderr, "[BMS] " __VA_ARGS__), fprintf(stderr, "\n")
 #else
@@ -95,6 +100,16 @@ typedef struct {
     uint8_t safety_alert_c;
 } bms_bq_safety_t;
 
+/* ── BQ76952 on-chip summary (DASTATUS5) ───────────────────────────── */
+typedef struct {
+    uint16_t max_cell_mv;
+    uint16_t min_cell_mv;
+    uint32_t stack_mv;             /* Battery Voltage Sum, cV → mV */
+    int16_t  max_temp_deci_c;      /* over cell-temperature thermistors */
+    int16_t  min_temp_deci_c;
+    int16_t  avg_temp_deci_c;
+} bms_bq_summary_t;
+
 /* ── P0-01: Per-Sensor Fault Tracking ──────────────────────────────── */
 typedef struct {
     uint8_t consec_fault_count;    /* consecutive bad reads */
@@ -109,6 +124,7 @@ typedef struct {
     int16_t          temp_deci_c[BMS_TEMPS_PER_MODULE];
     uint16_t         stack_mv;
     bms_bq_safety_t  bq_safety;
+    bms_bq_summary_t summary;          /* latest DASTATUS5 (summary mode) */
     bool             comm_ok;
     uint8_t          i2c_fail_count;   /* P0-02: consecutive failure counter */
     bms_sensor_fault_t sensor_fault[BMS_TEMPS_PER_MODULE]; /* P0-01 */
@@ -125,6 +141,13 @@ typedef struct {
     int16_t           max_temp_deci_c;
     int16_t           min_temp_deci_c;
     uint16_t          soc_hundredths;       /* 0–10000 */
+    uint16_t          cell_soc_min_hundredths;  /* weakest SE (bms_cell_soc) */
+    uint16_t          cell_soc_max_hundredths;  /* fullest SE */
+    bool              cell_soc_valid;       /* false: both = soc_hundredths */
+    int32_t           sop_charge_ma[BMS_SOP_HORIZONS];     /* bms_sop, 2/10/30 s */
+    int32_t           sop_discharge_ma[BMS_SOP_HORIZONS];
+    uint16_t          sop_charge_r_uohm;    /* limiting SE's R0 at T, SoC, age */
+    uint16_t          sop_discharge_r_uohm;
     bms_module_data_t modules[BMS_NUM_MODULES];
     bms_fault_flags_t faults;
     bool              fault_latched;
@@ -144,13 +167,21 @@ typedef enum {
     CAN_ID_LIMITS          = 0x105U,
     CAN_ID_HEARTBEAT       = 0x108U,
     CAN_ID_PACK_STATUS     = 0x110U,
+    CAN_ID_SOC_EST         = 0x112U,  /* SoC EKF: estimate + covariance */
+    CAN_ID_SOP_DCHG        = 0x114U,  /* state of power, discharge */
+    CAN_ID_SOP_CHG         = 0x115U,  /* state of power, charge */
     CAN_ID_PACK_ALARMS     = 0x120U,
     CAN_ID_PACK_VOLTAGES   = 0x130U,
     CAN_ID_CELL_BROADCAST  = 0x131U,
     CAN_ID_PACK_TEMPS      = 0x140U,
     CAN_ID_SAFETY_IO       = 0x150U,  /* NEW: safety I/O status */
     CAN_ID_DTDT_ALARM      = 0x151U,  /* NEW: dT/dt alarm */
+    CAN_ID_CELL_FD_PRIO    = 0x180U,  /* CAN FD: changed/extreme cells */
+    CAN_ID_CELL_FD_FULL    = 0x181U,  /* CAN FD: full-refresh cell blocks */
+    CAN_ID_TASK_TRACE      = 0x190U,  /* + task: runtime trace, round-robin */
     CAN_ID_EMS_COMMAND     = 0x200U,
+    CAN_ID_DIAG_REQ        = 0x7E0U,  /* ISO-TP: tester → BMS */
+    CAN_ID_DIAG_RESP       = 0x7E8U,  /* ISO-TP: BMS → tester */
     CAN_ID_EMS_HEARTBEAT   = 0x210U
 } bms_can_id_t;
 
@@ -161,6 +192,14 @@ typedef struct {
     uint8_t  data[8];
 } bms_can_frame_t;
 
+/* ── CAN FD Frame (64-byte payload) ────────────────────────────────── */
+#define BMS_CANFD_MAX_LEN  64U
+typedef struct {
+    uint32_t id;
+    uint8_t  len;                       /* 0–8, 12, 16, 20, 24, 32, 48, 64 */
+    uint8_t  data[BMS_CANFD_MAX_LEN];
+} bms_canfd_frame_t;
+
 /* ── EMS Command Types ─────────────────────────────────────────────── */
 typedef enum {
     EMS_CMD_NONE           = 0,
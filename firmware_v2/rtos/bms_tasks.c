@@ -11,8 +11,20 @@
  *   5: Protection + IWDG feed   (10ms, safety-critical)
  *   4: Monitor                  (10ms, data acquisition)
  *   3: Contactor control        (50ms)
- *   2: Safety I/O + State + CAN (100ms)
+ *   2: Safety I/O + State + CAN (100ms; CAN task ticks 10ms for ISO-TP)
  *   1: Thermal dT/dt            (1000ms)
+ *   1: NVM write-behind         (100ms, or at once on brownout;
+ *                                also black box + operating history)
+ *
+ * Pack data: the monitor owns g_pack and publishes it through
+ * bms_pack_share; every other task runs on its own snapshot and commits
+ * only what it changed (see bms_pack_share.h). No task body runs with
+ * interrupts off any more — the critical sections left guard the small
+ * safety I/O and protection contexts, for microseconds.
+ *
+ * Every task body is bracketed by bms_trace_begin()/end(); the NVM task
+ * samples all stack high-water marks (INCLUDE_uxTaskGetStackHighWaterMark)
+ * and the CAN task sends one task's figures per period.
  */
 
 #ifdef USE_FREERTOS
@@ -23,6 +35,7 @@
 #include "bms_hal.h"
 #include "bms_config.h"
 #include "bms_types.h"
+#include "bms_pack_share.h"
 #include "bms_bq76952.h"
 #include "bms_monitor.h"
 #include "bms_protection.h"
@@ -31,9 +44,19 @@
 #include "bms_contactor.h"
 #include "bms_state.h"
 #include "bms_can.h"
+#include "bms_can_txq.h"
+#include "bms_can_rx.h"
+#include "bms_can_diag.h"
+#include "bms_can_auth.h"
 #include "bms_nvm.h"
+#include "bms_nvm_queue.h"
+#include "bms_blackbox.h"
+#include "bms_history.h"
+#include "bms_trace.h"
 #include "bms_balance.h"
 #include "bms_soc.h"
+#include "bms_soh.h"
+#include "bms_sop.h"
 #include "bms_current_limit.h"
 
 /* ── Shared state (defined in main.c via extern) ───────────────────── */
@@ -46,6 +69,15 @@ extern bms_contactor_ctx_t      g_contactor;
 extern bms_nvm_ctx_t            g_nvm;
 extern bms_ems_command_t        g_ems_cmd;
 
+/* ── Per-task pack snapshots (~3 KB each; static, not on the stacks) ─ */
+
+static bms_pack_data_t s_pk_prot;
+static bms_pack_data_t s_pk_cont;
+static bms_pack_data_t s_pk_sio;
+static bms_pack_data_t s_pk_state;
+static bms_pack_data_t s_pk_can;
+static bms_pack_data_t s_pk_therm;
+
 /* ── Stack sizes ───────────────────────────────────────────────────── */
 
 #define BMS_TASK_STACK_MONITOR      512U
@@ -55,6 +87,7 @@ extern bms_ems_command_t        g_ems_cmd;
 #define BMS_TASK_STACK_CAN          256U
 #define BMS_TASK_STACK_THERMAL      256U
 #define BMS_TASK_STACK_SAFETY_IO    256U
+#define BMS_TASK_STACK_NVM          384U
 
 /* ── Task handles ──────────────────────────────────────────────────── */
 
@@ -65,6 +98,7 @@ static TaskHandle_t h_state;
 static TaskHandle_t h_can;
 static TaskHandle_t h_thermal;
 static TaskHandle_t h_safety_io;
+static TaskHandle_t h_nvm;
 
 /* ═══════════════════════════════════════════════════════════════════════
  * Task: Protection + IWDG feed (10ms, priority 5)
@@ -76,11 +110,17 @@ static void task_protection(void *arg)
     TickType_t last_wake = xTaskGetTickCount();
 
     for (;;) {
-        /* P3-05: Critical section around shared fault flag access (Dave) */
-        BMS_ENTER_CRITICAL();
-        bms_protection_run(&g_prot, &g_pack, BMS_PROTECTION_PERIOD_MS);
-        BMS_EXIT_CRITICAL();
+        bms_pack_ctl_t ctl;
+
+        /* Highest priority: nothing preempts the copy, so it never retries */
+        bms_trace_begin(TRACE_PROTECTION);
+        bms_pack_share_snapshot(&s_pk_prot, &ctl);
+        /* Pushes NVM fault events unlocked — see bms_nvm_queue.h */
+        bms_protection_run(&g_prot, &s_pk_prot, BMS_PROTECTION_PERIOD_MS);
+        bms_blackbox_record(&s_pk_prot);
+        bms_pack_share_commit(&ctl, &s_pk_prot);
         hal_iwdg_feed();
+        bms_trace_end(TRACE_PROTECTION);
         vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BMS_PROTECTION_PERIOD_MS));
     }
 }
@@ -92,10 +132,16 @@ static void task_monitor(void *arg)
     TickType_t last_wake = xTaskGetTickCount();
 
     for (;;) {
-        /* P3-05: Critical section around shared pack data writes (Dave) */
-        BMS_ENTER_CRITICAL();
+        bms_pack_ctl_t ctl;
+
+        /* I2C sweep on the private working copy, interrupts on; readers
+         * see the previous publish until the flip */
+        bms_trace_begin(TRACE_MONITOR);
+        bms_pack_share_pull(&g_pack, &ctl);
         bms_monitor_run(&g_pack);
-        BMS_EXIT_CRITICAL();
+        bms_pack_share_publish(&g_pack);
+        bms_pack_share_commit(&ctl, &g_pack);
+        bms_trace_end(TRACE_MONITOR);
         vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BMS_MONITOR_PERIOD_MS));
     }
 }
@@ -107,7 +153,13 @@ static void task_contactor(void *arg)
     TickType_t last_wake = xTaskGetTickCount();
 
     for (;;) {
-        bms_contactor_run(&g_contactor, &g_pack, BMS_CONTACTOR_PERIOD_MS);
+        bms_pack_ctl_t ctl;
+
+        bms_trace_begin(TRACE_CONTACTOR);
+        bms_pack_share_snapshot(&s_pk_cont, &ctl);
+        bms_contactor_run(&g_contactor, &s_pk_cont, BMS_CONTACTOR_PERIOD_MS);
+        bms_pack_share_commit(&ctl, &s_pk_cont);
+        bms_trace_end(TRACE_CONTACTOR);
         vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BMS_CONTACTOR_PERIOD_MS));
     }
 }
@@ -119,28 +171,67 @@ static void task_safety_io(void *arg)
     TickType_t last_wake = xTaskGetTickCount();
 
     for (;;) {
-        /* P3-05: Critical section around shared fault flag access (Dave) */
+        bms_pack_ctl_t ctl;
+
+        bms_trace_begin(TRACE_SAFETY_IO);
+        bms_pack_share_snapshot(&s_pk_sio, &ctl);
+        /* g_safety_io is read by the state and CAN tasks; GPIO/ADC only */
         BMS_ENTER_CRITICAL();
-        bms_safety_io_run(&g_safety_io, &g_pack);
+        bms_safety_io_run(&g_safety_io, &s_pk_sio);
         BMS_EXIT_CRITICAL();
+        bms_pack_share_commit(&ctl, &s_pk_sio);
+        bms_trace_end(TRACE_SAFETY_IO);
         vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BMS_SAFETY_IO_PERIOD_MS));
     }
 }
 
 /* ── Task: State machine + CAN RX (100ms, priority 2) ─────────────── */
+
+/* CAN RX ISR: DISCONNECT / POWER_SAVE queued → run the state task now */
+static void state_urgent_from_isr(void)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(h_state, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
 static void task_state(void *arg)
 {
     (void)arg;
+    const TickType_t period = pdMS_TO_TICKS(BMS_STATE_PERIOD_MS);
     TickType_t last_wake = xTaskGetTickCount();
 
+    bms_can_rx_set_urgent_hook(state_urgent_from_isr);
+
     for (;;) {
-        /* P3-05: Critical section around shared state + fault flag access (Dave) */
-        BMS_ENTER_CRITICAL();
+        bms_pack_ctl_t ctl;
+
+        bms_trace_begin(TRACE_STATE);
+        bms_pack_share_snapshot(&s_pk_state, &ctl);
         (void)bms_can_rx_process(&g_ems_cmd);
-        bms_state_run(&g_pack, &g_contactor, &g_prot,
+        /* State logic is short; the critical section keeps protection
+         * from running mid fault-reset on g_prot */
+        BMS_ENTER_CRITICAL();
+        bms_state_run(&s_pk_state, &g_contactor, &g_prot,
                       &g_safety_io, &g_ems_cmd, BMS_STATE_PERIOD_MS);
         BMS_EXIT_CRITICAL();
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BMS_STATE_PERIOD_MS));
+        bms_can_rx_note_handled(&g_ems_cmd);
+        bms_pack_share_commit(&ctl, &s_pk_state);
+        bms_history_sample(&s_pk_state);
+        bms_trace_end(TRACE_STATE);
+
+        /* Sleep to the next 100 ms slot unless an urgent command wakes us;
+         * the periodic cadence is kept either way. */
+        {
+            TickType_t elapsed = xTaskGetTickCount() - last_wake;
+            if (elapsed >= period) {
+                last_wake += period;
+                elapsed -= period;
+            }
+            if (elapsed < period) {
+                (void)ulTaskNotifyTake(pdTRUE, period - elapsed);
+            }
+        }
     }
 }
 
@@ -149,23 +240,49 @@ static void task_can_tx(void *arg)
 {
     (void)arg;
     TickType_t last_wake = xTaskGetTickCount();
+    uint8_t slot = 0U;
 
     for (;;) {
-        /* P3-05: Critical section around shared pack data reads (Dave) */
-        BMS_ENTER_CRITICAL();
-        bms_can_tx_periodic(&g_pack);
-        BMS_EXIT_CRITICAL();
+        /* Periodic frames every BMS_CAN_TX_PERIOD_MS; the ISO-TP service
+         * runs on every BMS_DIAG_POLL_MS slot in between. */
+        bms_trace_begin(TRACE_CAN);
+        if (slot == 0U) {
+            bms_pack_ctl_t ctl;
 
-        /* Safety I/O CAN frame */
-        {
-            bms_can_frame_t sio_frame;
-            BMS_ENTER_CRITICAL();
-            bms_safety_io_encode_can(&g_safety_io, &sio_frame);
-            BMS_EXIT_CRITICAL();
-            (void)hal_can_transmit(&sio_frame);
+            /* Read-only: no commit. ISO-TP snapshots read this copy too. */
+            bms_pack_share_snapshot(&s_pk_can, &ctl);
+            bms_can_tx_periodic(&s_pk_can);
+
+            /* Safety I/O, state of power and SoC estimator frames, and
+             * one task's trace figures. The EKF state belongs to the
+             * monitor task, which outranks this one: masked here, it is
+             * never seen half-done. SoP rides in the pack snapshot */
+            {
+                bms_can_frame_t sio_frame, soc_frame, sop_d_frame, sop_c_frame, trace_frame;
+                BMS_ENTER_CRITICAL();
+                bms_safety_io_encode_can(&g_safety_io, &sio_frame);
+                bms_soc_encode_can(&soc_frame);
+                BMS_EXIT_CRITICAL();
+                bms_sop_encode_can(&s_pk_can, &sop_d_frame, &sop_c_frame);
+                (void)bms_can_txq_send(&sio_frame, BMS_CAN_PRIO_CONTROL);
+                (void)bms_can_txq_send(&sop_d_frame, BMS_CAN_PRIO_CONTROL);
+                (void)bms_can_txq_send(&sop_c_frame, BMS_CAN_PRIO_CONTROL);
+                (void)bms_can_txq_send(&soc_frame, BMS_CAN_PRIO_TELEMETRY);
+                bms_trace_next_can(&trace_frame);
+                (void)bms_can_txq_send(&trace_frame, BMS_CAN_PRIO_BULK);
+            }
         }
+        slot++;
+        if (slot >= (uint8_t)(BMS_CAN_TX_PERIOD_MS / BMS_DIAG_POLL_MS)) { slot = 0U; }
+
+        bms_can_diag_poll();
 
-        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BMS_CAN_TX_PERIOD_MS));
+        /* Mailbox writes happen here and in the TX ISR, outside the
+         * critical section */
+        bms_can_txq_kick();
+        bms_trace_end(TRACE_CAN);
+
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BMS_DIAG_POLL_MS));
     }
 }
 
@@ -176,16 +293,94 @@ static void task_thermal(void *arg)
     TickType_t last_wake = xTaskGetTickCount();
 
     for (;;) {
-        bms_thermal_run(&g_thermal, &g_pack, BMS_THERMAL_PERIOD_MS);
+        bms_pack_ctl_t ctl;
+
+        bms_trace_begin(TRACE_THERMAL);
+        bms_pack_share_snapshot(&s_pk_therm, &ctl);
+        bms_thermal_run(&g_thermal, &s_pk_therm, BMS_THERMAL_PERIOD_MS);
+        bms_pack_share_commit(&ctl, &s_pk_therm);
+        bms_trace_end(TRACE_THERMAL);
         vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BMS_THERMAL_PERIOD_MS));
     }
 }
 
+/* ── Task: NVM write-behind (100ms, priority 1) ───────────────────── */
+
+/* PVD ISR: brownout — drain now instead of at the next slot */
+static void nvm_wake_from_isr(void)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(h_nvm, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* Least free stack words of every task since it started */
+static void sample_stacks(void)
+{
+    static TaskHandle_t *const k_handle[TRACE_TASK_COUNT] = {
+        &h_protection, &h_monitor, &h_contactor, &h_safety_io,
+        &h_state, &h_can, &h_thermal, &h_nvm
+    };
+    uint8_t t;
+
+    for (t = 0U; t < (uint8_t)TRACE_TASK_COUNT; t++) {
+        bms_trace_stack((bms_trace_task_t)t,
+                        (uint16_t)uxTaskGetStackHighWaterMark(*k_handle[t]));
+    }
+}
+
+/* Flash program/erase/verify happens only here, outside every critical
+ * section and below all control tasks — protection just enqueues. A
+ * frozen black-box capture streams a few pages per slot behind the fault
+ * queue, then any finished history hour; on brownout the hold-up time
+ * goes to the queue alone. */
+static void task_nvm(void *arg)
+{
+    (void)arg;
+
+    bms_nvm_queue_set_wake_hook(nvm_wake_from_isr);
+
+    for (;;) {
+        bool brownout;
+
+        (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BMS_NVM_DRAIN_PERIOD_MS));
+        bms_trace_begin(TRACE_NVM);
+        brownout = bms_nvm_queue_brownout_pending();
+        bms_nvm_release();                      /* one erase per release */
+        (void)bms_nvm_queue_drain(&g_nvm);
+        if (!brownout) {
+            (void)bms_blackbox_flush();
+            (void)bms_history_flush();
+            (void)bms_soh_flush(&g_nvm);
+            (void)bms_can_auth_flush(&g_nvm);
+            sample_stacks();
+        }
+        bms_trace_end(TRACE_NVM);
+    }
+}
+
 /* ═══════════════════════════════════════════════════════════════════════
  * Create all RTOS tasks. Called from main() after bms_init_all().
  * ═══════════════════════════════════════════════════════════════════════ */
 void bms_tasks_create(void)
 {
+    bms_pack_ctl_t ctl;
+
+    /* Before any task runs: seed the share and give diagnostics the CAN
+     * task's copy instead of the monitor's working buffer */
+    bms_pack_share_init(&g_pack);
+    bms_pack_share_snapshot(&s_pk_can, &ctl);
+    bms_can_diag_init(&s_pk_can, &g_prot, &g_nvm);
+
+    bms_trace_register(TRACE_PROTECTION, BMS_PROTECTION_PERIOD_MS, BMS_TASK_STACK_PROTECTION);
+    bms_trace_register(TRACE_MONITOR,    BMS_MONITOR_PERIOD_MS,    BMS_TASK_STACK_MONITOR);
+    bms_trace_register(TRACE_CONTACTOR,  BMS_CONTACTOR_PERIOD_MS,  BMS_TASK_STACK_CONTACTOR);
+    bms_trace_register(TRACE_SAFETY_IO,  BMS_SAFETY_IO_PERIOD_MS,  BMS_TASK_STACK_SAFETY_IO);
+    bms_trace_register(TRACE_STATE,      BMS_STATE_PERIOD_MS,      BMS_TASK_STACK_STATE);
+    bms_trace_register(TRACE_CAN,        BMS_DIAG_POLL_MS,         BMS_TASK_STACK_CAN);
+    bms_trace_register(TRACE_THERMAL,    BMS_THERMAL_PERIOD_MS,    BMS_TASK_STACK_THERMAL);
+    bms_trace_register(TRACE_NVM,        BMS_NVM_DRAIN_PERIOD_MS,  BMS_TASK_STACK_NVM);
+
     xTaskCreate(task_protection, "prot",  BMS_TASK_STACK_PROTECTION, NULL, 5, &h_protection);
     xTaskCreate(task_monitor,    "mon",   BMS_TASK_STACK_MONITOR,    NULL, 4, &h_monitor);
     xTaskCreate(task_contactor,  "cont",  BMS_TASK_STACK_CONTACTOR,  NULL, 3, &h_contactor);
@@ -193,6 +388,7 @@ void bms_tasks_create(void)
     xTaskCreate(task_state,      "state", BMS_TASK_STACK_STATE,      NULL, 2, &h_state);
     xTaskCreate(task_can_tx,     "can",   BMS_TASK_STACK_CAN,        NULL, 2, &h_can);
     xTaskCreate(task_thermal,    "therm", BMS_TASK_STACK_THERMAL,    NULL, 1, &h_thermal);
+    xTaskCreate(task_nvm,        "nvm",   BMS_TASK_STACK_NVM,        NULL, 1, &h_nvm);
 }
 
 #endif /* USE_FREERTOS */
@@ -0,0 +1,38 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host (pthreads) stand-in for the FreeRTOS kernel header
+ *
+ * Street Smart Edition.
+ * Only what rtos/bms_tasks.c and the soak harness use. Build with
+ * -Irtos/posix -DUSE_FREERTOS; the kernel itself is port_posix.c.
+ */
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t      TickType_t;
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint16_t      configSTACK_DEPTH_TYPE;
+
+#define configTICK_RATE_HZ      1000U
+#define configMAX_PRIORITIES    8U
+
+#define pdFALSE                 ((BaseType_t)0)
+#define pdTRUE                  ((BaseType_t)1)
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFU)
+
+#define pdMS_TO_TICKS(ms) \
+    ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+
+/* No preemption to request: a woken task is already runnable */
+#define portYIELD_FROM_ISR(woken)   ((void)(woken))
+
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+
+#endif /* FREERTOS_H */
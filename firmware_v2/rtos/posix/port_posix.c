@@ -0,0 +1,399 @@
+/**
+ * @file port_posix.c
+ * @brief FreeRTOS task API on pthreads with a virtual tick
+ *
+ * Street Smart Edition.
+ * Lets rtos/bms_tasks.c run on a Linux host, every task on its own
+ * thread, so ThreadSanitizer sees the real sharing between tasks, ISRs
+ * and the lock-free handoffs. Not a FreeRTOS simulator:
+ *
+ *   Time       virtual. The tick only moves when every task is blocked,
+ *              straight to the earliest wake-up, so a simulated day takes
+ *              as long as the task bodies take to run — minutes, not a
+ *              day. Each advance calls vApplicationTickHook() once (the
+ *              ticks skipped had nobody to wake) before any due task runs.
+ *   Priority   not emulated. All tasks due on the same tick run at once on
+ *              the host scheduler, which is a superset of the orderings
+ *              the target can produce.
+ *   Critical   stop-the-world. A running task holds s_world for reading
+ *              and drops it while blocked; taskENTER_CRITICAL() trades the
+ *              read hold for the write lock, so no other task (or
+ *              simulated ISR task) runs inside it — what interrupts off
+ *              means on one core. Nests; blocking inside it is a bug and
+ *              aborts.
+ *   Stacks     not measured; uxTaskGetStackHighWaterMark() returns the
+ *              full depth. Host frames say nothing about Cortex-M ones.
+ *
+ * vTaskEndScheduler() (from the tick hook or a task) stops the run:
+ * blocked tasks exit inside their blocking call and vTaskStartScheduler()
+ * joins them and returns. If every task is blocked with no timeout the
+ * run is deadlocked; the port reports it and stops the same way.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "port_posix.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define PORT_MAX_TASKS  16U
+
+struct tskTaskControlBlock {
+    pthread_t       thread;
+    pthread_cond_t  cv;
+    TaskFunction_t  code;
+    void           *arg;
+    const char     *name;
+    uint16_t        stack_words;
+    bool            blocked;
+    bool            timed;          /* blocked with a wake-up tick */
+    bool            on_notify;      /* a give ends the wait */
+    TickType_t      wake;
+    uint32_t        notify;
+    uint64_t        cpu_at_release; /* thread CPU ns when last released */
+};
+
+static struct tskTaskControlBlock s_tcb[PORT_MAX_TASKS];
+static uint32_t s_ntasks;
+
+/* Kernel state, all under s_kmx */
+static pthread_mutex_t  s_kmx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   s_idle_cv = PTHREAD_COND_INITIALIZER;  /* running → 0 */
+static pthread_cond_t   s_start_cv = PTHREAD_COND_INITIALIZER;
+static uint32_t         s_running;
+static bool             s_started;
+static bool             s_stop;
+
+/* Written only while no task runs (or before start) */
+static TickType_t       s_tick;
+static uint32_t         s_advances;
+static double           s_wall_s;
+
+/* Running tasks hold it shared; a critical section holds it exclusive */
+static pthread_rwlock_t s_world = PTHREAD_RWLOCK_INITIALIZER;
+
+static pthread_once_t   s_keys_once = PTHREAD_ONCE_INIT;
+static pthread_key_t    s_self_key;
+static pthread_key_t    s_crit_key;         /* nesting depth, as a pointer */
+
+static uint64_t clock_ns(clockid_t id)
+{
+    struct timespec ts;
+    (void)clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void port_fatal(const char *what)
+{
+    fprintf(stderr, "[PORT] %s\n", what);
+    abort();
+}
+
+static void make_keys(void)
+{
+    (void)pthread_key_create(&s_self_key, NULL);
+    (void)pthread_key_create(&s_crit_key, NULL);
+}
+
+static struct tskTaskControlBlock *self(void)
+{
+    (void)pthread_once(&s_keys_once, make_keys);
+    return (struct tskTaskControlBlock *)pthread_getspecific(s_self_key);
+}
+
+static uintptr_t crit_depth(void)
+{
+    (void)pthread_once(&s_keys_once, make_keys);
+    return (uintptr_t)pthread_getspecific(s_crit_key);
+}
+
+/* ── Blocking ──────────────────────────────────────────────────────── */
+
+/* Caller holds s_kmx and its world read lock was dropped by block() */
+static void make_ready(struct tskTaskControlBlock *t)
+{
+    t->blocked = false;
+    t->timed = false;
+    t->on_notify = false;
+    s_running++;
+    (void)pthread_cond_signal(&t->cv);
+}
+
+/* Leave the world, sleep until woken or stopped, come back in.
+ * Called with s_kmx held; returns with it released. */
+static void block(struct tskTaskControlBlock *t)
+{
+    (void)pthread_rwlock_unlock(&s_world);
+    t->blocked = true;
+    s_running--;
+    if (s_running == 0U) { (void)pthread_cond_signal(&s_idle_cv); }
+    while (t->blocked && !s_stop) {
+        (void)pthread_cond_wait(&t->cv, &s_kmx);
+    }
+    if (s_stop) {
+        (void)pthread_mutex_unlock(&s_kmx);
+        pthread_exit(NULL);
+    }
+    (void)pthread_mutex_unlock(&s_kmx);
+    (void)pthread_rwlock_rdlock(&s_world);
+    t->cpu_at_release = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+static void block_until(TickType_t wake, bool on_notify)
+{
+    struct tskTaskControlBlock *t = self();
+
+    if (t == NULL) { port_fatal("blocking call outside a task"); }
+    if (crit_depth() != 0U) { port_fatal("blocking call inside a critical section"); }
+    t->timed = true;
+    t->wake = wake;
+    t->on_notify = on_notify;
+    block(t);
+}
+
+static void *task_entry(void *p)
+{
+    struct tskTaskControlBlock *t = (struct tskTaskControlBlock *)p;
+
+    (void)pthread_setspecific(s_self_key, t);
+    (void)pthread_mutex_lock(&s_kmx);
+    while (!s_started && !s_stop) { (void)pthread_cond_wait(&s_start_cv, &s_kmx); }
+    if (s_stop) {
+        (void)pthread_mutex_unlock(&s_kmx);
+        return NULL;
+    }
+    (void)pthread_mutex_unlock(&s_kmx);
+    (void)pthread_rwlock_rdlock(&s_world);
+    t->cpu_at_release = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    t->code(t->arg);
+    port_fatal("task returned");
+    return NULL;
+}
+
+/* ── Task API ──────────────────────────────────────────────────────── */
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name,
+                       configSTACK_DEPTH_TYPE stack_words, void *arg,
+                       UBaseType_t priority, TaskHandle_t *created)
+{
+    struct tskTaskControlBlock *t;
+
+    (void)priority;
+    (void)pthread_once(&s_keys_once, make_keys);
+    if (s_ntasks >= PORT_MAX_TASKS || s_started) { return pdFAIL; }
+
+    t = &s_tcb[s_ntasks];
+    t->code = code;
+    t->arg = arg;
+    t->name = name;
+    t->stack_words = stack_words;
+    (void)pthread_cond_init(&t->cv, NULL);
+    if (pthread_create(&t->thread, NULL, task_entry, t) != 0) { return pdFAIL; }
+    s_ntasks++;
+    if (created != NULL) { *created = t; }
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return s_tick;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    (void)pthread_mutex_lock(&s_kmx);
+    block_until(s_tick + ticks, false);
+}
+
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment)
+{
+    TickType_t wake = *prev_wake + increment;
+
+    *prev_wake = wake;
+    (void)pthread_mutex_lock(&s_kmx);
+    /* Already due (zero increment): FreeRTOS returns without blocking */
+    if ((int32_t)(wake - s_tick) <= 0) {
+        (void)pthread_mutex_unlock(&s_kmx);
+        return;
+    }
+    block_until(wake, false);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait_ticks)
+{
+    struct tskTaskControlBlock *t = self();
+    uint32_t val;
+
+    (void)pthread_mutex_lock(&s_kmx);
+    if (t->notify == 0U && wait_ticks != 0U) {
+        if (wait_ticks == portMAX_DELAY) {
+            t->timed = false;
+            t->on_notify = true;
+            if (crit_depth() != 0U) { port_fatal("blocking call inside a critical section"); }
+            block(t);
+        } else {
+            block_until(s_tick + wait_ticks, true);
+        }
+        (void)pthread_mutex_lock(&s_kmx);
+    }
+    val = t->notify;
+    if (clear_on_exit != pdFALSE) {
+        t->notify = 0U;
+    } else if (val > 0U) {
+        t->notify--;
+    }
+    (void)pthread_mutex_unlock(&s_kmx);
+    return val;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    (void)pthread_mutex_lock(&s_kmx);
+    task->notify++;
+    if (task->blocked && task->on_notify) { make_ready(task); }
+    (void)pthread_mutex_unlock(&s_kmx);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_prio_woken)
+{
+    (void)xTaskNotifyGive(task);
+    if (higher_prio_woken != NULL) { *higher_prio_woken = pdTRUE; }
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return (task != NULL) ? task->stack_words : 0U;
+}
+
+/* ── Critical sections ─────────────────────────────────────────────── */
+
+void vPortEnterCritical(void)
+{
+    uintptr_t depth;
+
+    if (!s_started) { return; }                     /* single-threaded init */
+    depth = crit_depth();
+    if (depth == 0U) {
+        if (self() != NULL) { (void)pthread_rwlock_unlock(&s_world); }
+        (void)pthread_rwlock_wrlock(&s_world);
+    }
+    (void)pthread_setspecific(s_crit_key, (void *)(depth + 1U));
+}
+
+void vPortExitCritical(void)
+{
+    uintptr_t depth;
+
+    if (!s_started) { return; }
+    depth = crit_depth();
+    if (depth == 0U) { return; }
+    (void)pthread_setspecific(s_crit_key, (void *)(depth - 1U));
+    if (depth == 1U) {
+        (void)pthread_rwlock_unlock(&s_world);
+        if (self() != NULL) { (void)pthread_rwlock_rdlock(&s_world); }
+    }
+}
+
+/* ── Scheduler ─────────────────────────────────────────────────────── */
+
+/* Earliest timed wake-up among blocked tasks; false if there is none */
+static bool next_wake(TickType_t *delta)
+{
+    bool found = false;
+    uint32_t i;
+
+    for (i = 0U; i < s_ntasks; i++) {
+        const struct tskTaskControlBlock *t = &s_tcb[i];
+        if (t->blocked && t->timed) {
+            TickType_t d = t->wake - s_tick;
+            if ((int32_t)d < 0) { d = 0U; }
+            if (!found || d < *delta) { *delta = d; }
+            found = true;
+        }
+    }
+    return found;
+}
+
+void vTaskStartScheduler(void)
+{
+    uint64_t t0 = clock_ns(CLOCK_MONOTONIC);
+    uint32_t i;
+
+    (void)pthread_mutex_lock(&s_kmx);
+    s_running = s_ntasks;
+    s_started = true;
+    (void)pthread_cond_broadcast(&s_start_cv);
+
+    for (;;) {
+        TickType_t delta = 0U;
+
+        while (s_running > 0U && !s_stop) {
+            (void)pthread_cond_wait(&s_idle_cv, &s_kmx);
+        }
+        if (s_stop) { break; }
+        if (!next_wake(&delta)) {
+            fprintf(stderr, "[PORT] deadlock: every task blocked without timeout\n");
+            s_stop = true;
+            break;
+        }
+
+        s_tick += delta;
+        s_advances++;
+
+        /* The tick "interrupt": runs before anything due is released */
+        (void)pthread_mutex_unlock(&s_kmx);
+        vApplicationTickHook();
+        (void)pthread_mutex_lock(&s_kmx);
+        if (s_stop) { break; }
+
+        for (i = 0U; i < s_ntasks; i++) {
+            struct tskTaskControlBlock *t = &s_tcb[i];
+            if (t->blocked && t->timed && (int32_t)(t->wake - s_tick) <= 0) {
+                make_ready(t);
+            }
+        }
+    }
+
+    /* Every task is blocked (or never started): let them exit */
+    for (i = 0U; i < s_ntasks; i++) { (void)pthread_cond_broadcast(&s_tcb[i].cv); }
+    (void)pthread_cond_broadcast(&s_start_cv);
+    (void)pthread_mutex_unlock(&s_kmx);
+    for (i = 0U; i < s_ntasks; i++) { (void)pthread_join(s_tcb[i].thread, NULL); }
+    s_wall_s = (double)(clock_ns(CLOCK_MONOTONIC) - t0) / 1e9;
+}
+
+void vTaskEndScheduler(void)
+{
+    (void)pthread_mutex_lock(&s_kmx);
+    s_stop = true;
+    (void)pthread_cond_signal(&s_idle_cv);
+    (void)pthread_mutex_unlock(&s_kmx);
+}
+
+/* ── Host extras ───────────────────────────────────────────────────── */
+
+uint32_t posix_port_clock_ns(void)
+{
+    const struct tskTaskControlBlock *t = self();
+    uint64_t in_tick = 0U;
+
+    if (t != NULL) { in_tick = clock_ns(CLOCK_THREAD_CPUTIME_ID) - t->cpu_at_release; }
+    return (uint32_t)((uint64_t)s_tick * 1000000ULL + in_tick);
+}
+
+uint32_t posix_port_advances(void)
+{
+    return s_advances;
+}
+
+double posix_port_wall_s(void)
+{
+    return s_wall_s;
+}
@@ -0,0 +1,23 @@
+/**
+ * @file port_posix.h
+ * @brief Host-only extras of the pthreads FreeRTOS port
+ */
+
+#ifndef PORT_POSIX_H
+#define PORT_POSIX_H
+
+#include <stdint.h>
+
+/**
+ * Virtual time in ns: tick × 1 ms, plus (from a task) the thread CPU time
+ * it has used since it was last released. Tick-to-tick spacing is exact,
+ * execution is measured, and host preemption of the thread does not show
+ * up as jitter. Suitable for bms_trace_set_clock().
+ */
+uint32_t posix_port_clock_ns(void);
+
+/** Tick advances performed and the real seconds they took (after return). */
+uint32_t posix_port_advances(void);
+double posix_port_wall_s(void);
+
+#endif /* PORT_POSIX_H */
@@ -0,0 +1,42 @@
+/**
+ * @file task.h
+ * @brief Host (pthreads) stand-in for the FreeRTOS task API
+ *
+ * Street Smart Edition.
+ * Same signatures as FreeRTOS V10, so rtos/bms_tasks.c compiles unchanged.
+ * Semantics and limits of the port are described in port_posix.c.
+ */
+
+#ifndef TASK_H
+#define TASK_H
+
+#include "FreeRTOS.h"
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name,
+                       configSTACK_DEPTH_TYPE stack_words, void *arg,
+                       UBaseType_t priority, TaskHandle_t *created);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment);
+TickType_t xTaskGetTickCount(void);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait_ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_prio_woken);
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+/** Runs the tasks until vTaskEndScheduler(), then returns. */
+void vTaskStartScheduler(void);
+void vTaskEndScheduler(void);
+
+/* Application hook: called once per tick advance, before due tasks wake */
+void vApplicationTickHook(void);
+
+#define taskENTER_CRITICAL()    vPortEnterCritical()
+#define taskEXIT_CRITICAL()     vPortExitCritical()
+
+#endif /* TASK_H */
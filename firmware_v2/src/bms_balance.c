@@ -2,11 +2,16 @@
  * @file bms_balance.c
  * @brief Passive cell balancing via BQ76952
  *
- * Street Smart Edition. Functionally identical to original.
+ * Street Smart Edition.
+ * Once bms_cell_soc has converged the decision is made on per-SE SoC
+ * instead of voltage: on the flat middle of the OCV curve 20 mV is several
+ * percent of SoC, and under current the voltage spread is mostly R0.
+ * Until then, the original voltage-threshold rule.
  */
 
 #include "bms_balance.h"
 #include "bms_hal.h"
+#include "bms_cell_soc.h"
 #include "bms_config.h"
 #include <string.h>
 
@@ -27,6 +32,27 @@ static void disable_all(bms_balance_state_t *bal)
     bal->active = false;
 }
 
+/* Bleed every SE more than half a threshold above the emptiest one */
+static void run_by_soc(bms_balance_state_t *bal, const bms_pack_data_t *pack)
+{
+    uint16_t spread = pack->cell_soc_max_hundredths - pack->cell_soc_min_hundredths;
+    uint16_t target;
+    uint8_t mod;
+
+    if (spread <= BMS_BALANCE_THRESHOLD_SOC) {
+        if (bal->active) { disable_all(bal); }
+        return;
+    }
+
+    target = pack->cell_soc_min_hundredths + (BMS_BALANCE_THRESHOLD_SOC / 2U);
+    bal->active = true;
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        uint16_t mask = bms_cell_soc_mask_above(mod, pack->soc_hundredths, target);
+        bal->cell_mask[mod] = mask;
+        bms_hal_bq76952_set_balance(mod, mask);
+    }
+}
+
 void bms_balance_run(bms_balance_state_t *bal, const bms_pack_data_t *pack)
 {
     if (pack->mode != BMS_MODE_READY && pack->mode != BMS_MODE_CONNECTED) {
@@ -41,6 +67,11 @@ void bms_balance_run(bms_balance_state_t *bal, const bms_pack_data_t *pack)
         return;
     }
 
+    if (pack->cell_soc_valid) {
+        run_by_soc(bal, pack);
+        return;
+    }
+
     uint16_t imbalance = pack->max_cell_mv - pack->min_cell_mv;
     if (imbalance <= BMS_BALANCE_THRESHOLD_MV) {
         if (bal->active) { disable_all(bal); }
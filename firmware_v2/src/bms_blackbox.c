@@ -0,0 +1,439 @@
+/**
+ * @file bms_blackbox.c
+ * @brief Pre/post-fault black-box recorder
+ *
+ * Street Smart Edition.
+ * The protection task owns the ring while recording; once s_state goes
+ * FROZEN the NVM task owns it until it publishes STORED, and the next
+ * record() call restarts the ring. Neither side writes the other's
+ * fields in between, so no lock is needed beyond the state handoff.
+ */
+
+#include "bms_blackbox.h"
+#include "bms_nvm.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+#define BBX_MAGIC        0x42425831UL   /* "BBX1" */
+#define BBX_HDR_LEN      34U
+#define BBX_SAMPLE_MAX   9U             /* tag + 4 × absolute */
+#define BBX_PER_BLOCK_MIN \
+    (1U + (BMS_BBOX_BLOCK_SIZE - BMS_BBOX_DELTA_OFFSET) / BBX_SAMPLE_MAX)
+
+#define CODE_SAME   0U
+#define CODE_DELTA  1U
+#define CODE_ABS    2U
+
+_Static_assert(BMS_BBOX_BLOCK_SIZE == BMS_NVM_PAGE_SIZE, "One block per flash page");
+_Static_assert((BMS_NVM_BBOX_BASE % BMS_NVM_SECTOR_SIZE) == 0U, "Capture region sector aligned");
+_Static_assert((BMS_BBOX_BLOCKS + 1U) * BMS_BBOX_BLOCK_SIZE
+               <= BMS_NVM_BBOX_SECTORS * BMS_NVM_SECTOR_SIZE, "Capture exceeds flash region");
+_Static_assert(BBX_HDR_LEN <= BMS_NVM_PAGE_SIZE, "Header is one page");
+_Static_assert(BMS_BBOX_PERIOD_MS == BMS_PROTECTION_PERIOD_MS, "Sampled from the protection task");
+/* Sized for all-absolute samples. One block is lost to the trigger's
+ * keyframe split and one is partial. */
+_Static_assert((BMS_BBOX_BLOCKS - 2U) * BBX_PER_BLOCK_MIN * BMS_BBOX_PERIOD_MS
+               >= BMS_BBOX_PRE_MS + BMS_BBOX_POST_MS, "Ring too small for pre + post window");
+
+/* State handoff: ring writes before FROZEN (release), reads after (acquire) */
+#if defined(__GNUC__)
+  #define BBX_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define BBX_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  #define BBX_LOAD(p)       (*(p))
+  #define BBX_STORE(p, v)   (*(p) = (v))
+#endif
+
+static uint8_t  s_blk[BMS_BBOX_BLOCKS][BMS_BBOX_BLOCK_SIZE];
+static uint16_t s_head;             /* block being filled */
+static uint16_t s_used;             /* valid blocks */
+static uint16_t s_fill;             /* bytes used in s_blk[s_head] */
+static uint16_t s_count;            /* samples in s_blk[s_head] */
+static uint16_t s_seq;
+static bms_blackbox_sample_t s_prev;
+static bool     s_prev_latched;
+static uint32_t s_last_ms;
+
+static uint16_t s_trig_slot;
+static uint16_t s_trig_sample;
+static uint32_t s_trig_ms;
+static uint32_t s_trig_faults;
+static uint32_t s_post_left;
+
+static volatile bms_blackbox_state_t s_state;
+static uint16_t s_stream_next;      /* NVM task: next capture block */
+static uint8_t  s_chk[BMS_BBOX_BLOCK_SIZE];
+static bms_blackbox_stats_t s_stats;
+
+/* ── Byte helpers ──────────────────────────────────────────────────── */
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8U);
+    p[1] = (uint8_t)v;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24U);
+    p[1] = (uint8_t)(v >> 16U);
+    p[2] = (uint8_t)(v >> 8U);
+    p[3] = (uint8_t)v;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(((uint16_t)p[0] << 8U) | p[1]);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24U) | ((uint32_t)p[1] << 16U) |
+           ((uint32_t)p[2] << 8U) | (uint32_t)p[3];
+}
+
+/* ── Ring ──────────────────────────────────────────────────────────── */
+
+static uint16_t oldest_slot(void)
+{
+    return (uint16_t)((s_head + BMS_BBOX_BLOCKS + 1U - s_used) % BMS_BBOX_BLOCKS);
+}
+
+static void take(const bms_pack_data_t *pack, bms_blackbox_sample_t *s)
+{
+    int32_t da = pack->pack_current_ma / 100;
+
+    if (da > 32767)  { da = 32767; }
+    if (da < -32767) { da = -32767; }
+    s->t_ms = hal_tick_ms();
+    s->min_cell_mv = pack->min_cell_mv;
+    s->max_cell_mv = pack->max_cell_mv;
+    s->current_da = (int16_t)da;
+    s->max_temp_deci_c = pack->max_temp_deci_c;
+    s->mode = (uint8_t)pack->mode;
+    memcpy(&s->faults, &pack->faults, sizeof(s->faults));
+}
+
+static void freeze(void)
+{
+    s_stream_next = 0U;
+    BBX_STORE(&s_state, BBOX_FROZEN);
+}
+
+/* Start a block with s as its keyframe. Refuses (and freezes) rather
+ * than overwrite the trigger block during the post window. */
+static bool open_block(const bms_blackbox_sample_t *s)
+{
+    uint8_t *b;
+
+    if (s_used > 0U) {
+        uint16_t next = (uint16_t)((s_head + 1U) % BMS_BBOX_BLOCKS);
+        if (BBX_LOAD(&s_state) == BBOX_POST_TRIGGER && s_used == BMS_BBOX_BLOCKS &&
+            next == s_trig_slot) {
+            BMS_LOG("Black box: post window cut short, ring full");
+            freeze();
+            return false;
+        }
+        s_head = next;
+    }
+    if (s_used < BMS_BBOX_BLOCKS) { s_used++; }
+
+    b = s_blk[s_head];
+    memset(b, 0xFF, BMS_BBOX_BLOCK_SIZE);
+    put_u32(&b[0], s->t_ms);
+    put_u16(&b[4], 1U);
+    put_u16(&b[6], s_seq++);
+    b += BMS_BBOX_KEY_OFFSET;
+    put_u16(&b[0], s->min_cell_mv);
+    put_u16(&b[2], s->max_cell_mv);
+    put_u16(&b[4], (uint16_t)s->current_da);
+    put_u16(&b[6], (uint16_t)s->max_temp_deci_c);
+    b[8] = s->mode;
+    put_u32(&b[9], s->faults);
+
+    s_fill = BMS_BBOX_DELTA_OFFSET;
+    s_count = 1U;
+    s_stats.blocks++;
+    return true;
+}
+
+static uint8_t *enc_field(uint8_t *p, int32_t prev, int32_t cur, uint8_t *code)
+{
+    int32_t d = cur - prev;
+
+    if (d == 0) {
+        *code = CODE_SAME;
+    } else if (d >= -128 && d <= 127) {
+        *code = CODE_DELTA;
+        *p++ = (uint8_t)(int8_t)d;
+    } else {
+        *code = CODE_ABS;
+        put_u16(p, (uint16_t)cur);
+        p += 2;
+    }
+    return p;
+}
+
+static void append(const bms_blackbox_sample_t *s)
+{
+    uint8_t *b = s_blk[s_head];
+    uint8_t *p = &b[s_fill + 1U];
+    uint8_t c_cur, c_min, c_max, c_temp;
+
+    p = enc_field(p, s_prev.current_da, s->current_da, &c_cur);
+    p = enc_field(p, s_prev.min_cell_mv, s->min_cell_mv, &c_min);
+    p = enc_field(p, s_prev.max_cell_mv, s->max_cell_mv, &c_max);
+    p = enc_field(p, s_prev.max_temp_deci_c, s->max_temp_deci_c, &c_temp);
+    b[s_fill] = (uint8_t)((c_cur << 6U) | (c_min << 4U) | (c_max << 2U) | c_temp);
+
+    s_fill = (uint16_t)(p - b);
+    s_count++;
+    put_u16(&b[4], s_count);
+}
+
+/* ── Flash ─────────────────────────────────────────────────────────── */
+
+static bool program_page(uint32_t addr, const uint8_t *data, uint16_t len)
+{
+    bms_hal_nvm_write(addr, data, len);
+    bms_hal_nvm_read(addr, s_chk, len);
+    return memcmp(s_chk, data, len) == 0;
+}
+
+static bool write_header(void)
+{
+    uint8_t h[BBX_HDR_LEN];
+    uint16_t oldest = oldest_slot();
+
+    put_u32(&h[0], BBX_MAGIC);
+    put_u16(&h[4], s_used);
+    put_u16(&h[6], (uint16_t)((s_trig_slot + BMS_BBOX_BLOCKS - oldest) % BMS_BBOX_BLOCKS));
+    put_u16(&h[8], s_trig_sample);
+    put_u32(&h[10], s_trig_ms);
+    put_u32(&h[14], s_trig_faults);
+    put_u32(&h[18], get_u32(&s_blk[oldest][0]));
+    put_u32(&h[22], s_last_ms);
+    put_u32(&h[26], s_stats.triggers);
+    put_u32(&h[30], bms_nvm_crc32(h, BBX_HDR_LEN - 4U));
+    return program_page(BMS_NVM_BBOX_BASE, h, BBX_HDR_LEN);
+}
+
+/* ── Public API ────────────────────────────────────────────────────── */
+
+void bms_blackbox_init(void)
+{
+    memset(s_blk, 0xFF, sizeof(s_blk));
+    memset(&s_prev, 0, sizeof(s_prev));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_head = 0U;
+    s_used = 0U;
+    s_fill = 0U;
+    s_count = 0U;
+    s_seq = 0U;
+    s_prev_latched = false;
+    s_last_ms = 0U;
+    s_post_left = 0U;
+    s_stream_next = 0U;
+    BBX_STORE(&s_state, BBOX_RECORDING);
+}
+
+void bms_blackbox_record(const bms_pack_data_t *pack)
+{
+    bms_blackbox_sample_t s;
+    bool rising;
+
+    if (BBX_LOAD(&s_state) == BBOX_FROZEN) {
+        s_stats.frozen_skips++;
+        s_prev_latched = pack->fault_latched;
+        return;
+    }
+    if (BBX_LOAD(&s_state) == BBOX_STORED) {
+        s_used = 0U;
+        s_head = 0U;
+        BBX_STORE(&s_state, BBOX_RECORDING);
+    }
+
+    take(pack, &s);
+    if (s_used == 0U || s.mode != s_prev.mode || s.faults != s_prev.faults ||
+        (uint16_t)(s_fill + BBX_SAMPLE_MAX) > BMS_BBOX_BLOCK_SIZE) {
+        if (!open_block(&s)) { return; }
+    } else {
+        append(&s);
+    }
+    s_prev = s;
+    s_last_ms = s.t_ms;
+    s_stats.samples++;
+
+    rising = pack->fault_latched && !s_prev_latched;
+    s_prev_latched = pack->fault_latched;
+
+    if (rising && BBX_LOAD(&s_state) == BBOX_RECORDING) {
+        s_trig_slot = s_head;
+        s_trig_sample = (uint16_t)(s_count - 1U);
+        s_trig_ms = s.t_ms;
+        s_trig_faults = s.faults;
+        s_post_left = BMS_BBOX_POST_MS / BMS_BBOX_PERIOD_MS;
+        BBX_STORE(&s_state, BBOX_POST_TRIGGER);
+        s_stats.triggers++;
+        BMS_LOG("Black box: triggered at %lu ms, %lu ms of history",
+                (unsigned long)s.t_ms, (unsigned long)bms_blackbox_span_ms());
+    } else if (BBX_LOAD(&s_state) == BBOX_POST_TRIGGER) {
+        if (--s_post_left == 0U) { freeze(); }
+    }
+}
+
+bool bms_blackbox_flush(void)
+{
+    uint8_t pages = 0U;
+
+    if (BBX_LOAD(&s_state) != BBOX_FROZEN) { return false; }
+
+    while (pages < BMS_BBOX_PAGES_PER_FLUSH && s_stream_next < s_used) {
+        uint16_t slot = (uint16_t)((oldest_slot() + s_stream_next) % BMS_BBOX_BLOCKS);
+        uint32_t addr = BMS_NVM_BBOX_BASE +
+                        ((uint32_t)s_stream_next + 1U) * BMS_BBOX_BLOCK_SIZE;
+
+        /* First page erases the header's sector too: the old capture is
+         * gone from here on, the new one appears only with its header.
+         * Blocks are pages, so block 0 never opens a sector of its own.
+         * An erase the NVM budget refuses is retried next release. */
+        uint32_t erase = (s_stream_next == 0U) ? BMS_NVM_BBOX_BASE :
+                         ((addr % BMS_NVM_SECTOR_SIZE) == 0U) ? addr : 0U;
+        if (erase != 0U && !bms_nvm_erase_sector(erase)) { return true; }
+
+        if (!program_page(addr, s_blk[slot], BMS_BBOX_BLOCK_SIZE)) {
+            BMS_LOG("Black box: verify failed at 0x%05lX, capture dropped",
+                    (unsigned long)addr);
+            s_stats.store_fail++;
+            BBX_STORE(&s_state, BBOX_STORED);
+            return false;
+        }
+        s_stream_next++;
+        pages++;
+    }
+
+    if (s_stream_next < s_used) { return true; }
+
+    if (write_header()) {
+        s_stats.stored++;
+        BMS_LOG("Black box: %u blocks stored", s_used);
+    } else {
+        s_stats.store_fail++;
+    }
+    BBX_STORE(&s_state, BBOX_STORED);
+    return false;
+}
+
+bms_blackbox_state_t bms_blackbox_state(void)
+{
+    return BBX_LOAD(&s_state);
+}
+
+uint32_t bms_blackbox_span_ms(void)
+{
+    if (s_used == 0U) { return 0U; }
+    return s_last_ms - get_u32(&s_blk[oldest_slot()][0]);
+}
+
+bool bms_blackbox_get_info(bms_blackbox_info_t *out)
+{
+    uint8_t h[BBX_HDR_LEN];
+
+    bms_hal_nvm_read(BMS_NVM_BBOX_BASE, h, BBX_HDR_LEN);
+    if (get_u32(&h[0]) != BBX_MAGIC ||
+        get_u32(&h[30]) != bms_nvm_crc32(h, BBX_HDR_LEN - 4U)) {
+        return false;
+    }
+    out->blocks = get_u16(&h[4]);
+    out->trigger_block = get_u16(&h[6]);
+    out->trigger_sample = get_u16(&h[8]);
+    out->trigger_ms = get_u32(&h[10]);
+    out->faults = get_u32(&h[14]);
+    out->first_ms = get_u32(&h[18]);
+    out->last_ms = get_u32(&h[22]);
+    out->capture = get_u32(&h[26]);
+    return out->blocks <= BMS_BBOX_BLOCKS;
+}
+
+bool bms_blackbox_read_block(uint16_t n, uint8_t *out)
+{
+    bms_blackbox_info_t info;
+
+    if (!bms_blackbox_get_info(&info) || n >= info.blocks) { return false; }
+    bms_hal_nvm_read(BMS_NVM_BBOX_BASE + ((uint32_t)n + 1U) * BMS_BBOX_BLOCK_SIZE,
+                     out, BMS_BBOX_BLOCK_SIZE);
+    return true;
+}
+
+/* One delta field: advances *pp, false if it runs off the block */
+static bool dec_field(const uint8_t **pp, const uint8_t *end, uint8_t code,
+                      int32_t *val, bool is_signed)
+{
+    const uint8_t *p = *pp;
+
+    switch (code) {
+    case CODE_SAME:
+        break;
+    case CODE_DELTA:
+        if (end - p < 1) { return false; }
+        *val += (int8_t)p[0];
+        p += 1;
+        break;
+    case CODE_ABS:
+        if (end - p < 2) { return false; }
+        *val = is_signed ? (int32_t)(int16_t)get_u16(p) : (int32_t)get_u16(p);
+        p += 2;
+        break;
+    default:
+        return false;
+    }
+    *pp = p;
+    return true;
+}
+
+uint16_t bms_blackbox_decode_block(const uint8_t *blk,
+                                   bms_blackbox_sample_t *out, uint16_t max)
+{
+    const uint8_t *key = &blk[BMS_BBOX_KEY_OFFSET];
+    const uint8_t *p = &blk[BMS_BBOX_DELTA_OFFSET];
+    const uint8_t *end = &blk[BMS_BBOX_BLOCK_SIZE];
+    uint16_t count = get_u16(&blk[4]);
+    uint32_t t0 = get_u32(&blk[0]);
+    int32_t cur, mn, mx, temp;
+    uint16_t i;
+
+    if (count == 0U || count == 0xFFFFU || max == 0U) { return 0U; }
+
+    mn = get_u16(&key[0]);
+    mx = get_u16(&key[2]);
+    cur = (int16_t)get_u16(&key[4]);
+    temp = (int16_t)get_u16(&key[6]);
+
+    for (i = 0U; i < count && i < max; i++) {
+        if (i > 0U) {
+            uint8_t tag;
+            if (p >= end) { return 0U; }
+            tag = *p++;
+            if (!dec_field(&p, end, (uint8_t)(tag >> 6U), &cur, true) ||
+                !dec_field(&p, end, (uint8_t)((tag >> 4U) & 3U), &mn, false) ||
+                !dec_field(&p, end, (uint8_t)((tag >> 2U) & 3U), &mx, false) ||
+                !dec_field(&p, end, (uint8_t)(tag & 3U), &temp, true)) {
+                return 0U;
+            }
+        }
+        out[i].t_ms = t0 + (uint32_t)i * BMS_BBOX_PERIOD_MS;
+        out[i].min_cell_mv = (uint16_t)mn;
+        out[i].max_cell_mv = (uint16_t)mx;
+        out[i].current_da = (int16_t)cur;
+        out[i].max_temp_deci_c = (int16_t)temp;
+        out[i].mode = key[8];
+        out[i].faults = get_u32(&key[9]);
+    }
+    return i;
+}
+
+void bms_blackbox_get_stats(bms_blackbox_stats_t *out)
+{
+    *out = s_stats;
+}
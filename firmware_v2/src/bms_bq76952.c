@@ -175,6 +175,38 @@ int32_t bq76952_read_current(uint8_t module_id)
     return (int32_t)(int16_t)raw;
 }
 
+/* ── DASTATUS5 summary ─────────────────────────────────────────────── */
+
+static uint16_t le16(const uint8_t *b) { return (uint16_t)((uint16_t)b[1] << 8U) | b[0]; }
+
+/* Fetch starts at the first field used, so offsets are rebased */
+#define DAS5(buf, off)  (&(buf)[(off) - BQ76952_DAS5_MAX_CELL_MV])
+
+int32_t bq76952_request_summary(uint8_t module_id)
+{
+    return bq76952_subcommand(module_id, BQ76952_SUBCMD_DASTATUS5);
+}
+
+int32_t bq76952_fetch_summary(uint8_t module_id, bms_bq_summary_t *out)
+{
+    uint8_t buf[BQ76952_DAS5_FETCH_LEN];
+    uint8_t addr = module_i2c_addr(module_id);
+    int32_t rc;
+
+    rc = hal_i2c_read(addr, (uint8_t)(BQ76952_REG_SUBCMD_DATA + BQ76952_DAS5_MAX_CELL_MV),
+                      buf, BQ76952_DAS5_FETCH_LEN);
+    if (rc != 0) { return rc; }
+
+    out->max_cell_mv = le16(DAS5(buf, BQ76952_DAS5_MAX_CELL_MV));
+    out->min_cell_mv = le16(DAS5(buf, BQ76952_DAS5_MIN_CELL_MV));
+    out->stack_mv = (uint32_t)le16(DAS5(buf, BQ76952_DAS5_BAT_SUM_CV)) * 10U;
+    /* 0.1K → 0.1°C */
+    out->max_temp_deci_c = (int16_t)((int32_t)le16(DAS5(buf, BQ76952_DAS5_MAX_TEMP_DK)) - 2731);
+    out->min_temp_deci_c = (int16_t)((int32_t)le16(DAS5(buf, BQ76952_DAS5_MIN_TEMP_DK)) - 2731);
+    out->avg_temp_deci_c = (int16_t)((int32_t)le16(DAS5(buf, BQ76952_DAS5_AVG_TEMP_DK)) - 2731);
+    return 0;
+}
+
 /* ── Safety registers ──────────────────────────────────────────────── */
 
 int32_t bq76952_read_safety(uint8_t module_id, bms_bq_safety_t *out)
@@ -369,6 +401,27 @@ int32_t bq76952_configure_hw_protection(uint8_t module_id)
         }
     }
 
+    /* ALERT on safety alerts/faults only — not on every FULLSCAN — so
+     * the wired-OR line can wake the MCU from STOP in POWER_SAVE */
+    {
+        uint16_t mask = (uint16_t)(BQ_ALARM_SSBC | BQ_ALARM_SSA | BQ_ALARM_PF |
+                                   BQ_ALARM_MSK_SFALERT | BQ_ALARM_MSK_PFALERT);
+        uint8_t am_data[2];
+        uint8_t rd[2];
+
+        am_data[0] = (uint8_t)(mask & 0xFFU);
+        am_data[1] = (uint8_t)((mask >> 8U) & 0xFFU);
+        rc = bq76952_write_data_memory(module_id, BQ76952_DM_DEFAULT_ALARM_MASK, am_data, 2U);
+        if (rc != 0) { goto fail; }
+        hal_delay_ms(2U);
+
+        rc = bq76952_read_data_memory(module_id, BQ76952_DM_DEFAULT_ALARM_MASK, rd, 2U);
+        if (rc != 0 || rd[0] != am_data[0] || rd[1] != am_data[1]) {
+            BMS_LOG("BQ76952 module %u: alarm mask verify FAILED", module_id);
+            goto fail;
+        }
+    }
+
     /* Exit config update mode */
     rc = bq76952_exit_config(module_id);
     if (rc != 0) { return rc; }
@@ -10,121 +10,116 @@
  *     - Limits clamped to [0, BMS_MAX_*_MA]
  *     - EMS_CMD_NONE (0) rejected as command (must use 0x210 for heartbeat)
  *     - Reserved bytes validated as zero
- *   CC-01: CAN authentication noted but deferred to P2-01 (all 6 reviewers)
+ *   CC-01: CAN authentication — AES-128-CMAC in bms_can_auth.c (P2-01)
  *   P0-04: dT/dt alarm CAN message (Priya)
+ *   Cell detail goes over CAN FD (bms_canfd.c) when BMS_CAN_FD_ENABLED.
+ *   Classic TX goes through the prioritised queue (bms_can_txq.c),
+ *   RX through the ISR-fed ring (bms_can_rx.c).
+ *   Frame layouts come from bms_can_msgs.def; this file only maps pack
+ *   data onto signals.
  */
 
 #include "bms_can.h"
+#include "bms_can_msgs.h"
+#include "bms_canfd.h"
+#include "bms_can_txq.h"
+#include "bms_can_rx.h"
+#include "bms_can_auth.h"
 #include "bms_hal.h"
 #include "bms_config.h"
 #include <string.h>
 
-/* ── Big-endian helpers ────────────────────────────────────────────── */
-
-static void pack_u16_be(uint8_t *buf, uint16_t val)
-{
-    buf[0] = (uint8_t)((val >> 8U) & 0xFFU);
-    buf[1] = (uint8_t)(val & 0xFFU);
-}
-
-static void pack_i16_be(uint8_t *buf, int16_t val)
-{
-    pack_u16_be(buf, (uint16_t)val);
-}
-
-static void pack_u32_be(uint8_t *buf, uint32_t val)
-{
-    buf[0] = (uint8_t)((val >> 24U) & 0xFFU);
-    buf[1] = (uint8_t)((val >> 16U) & 0xFFU);
-    buf[2] = (uint8_t)((val >> 8U) & 0xFFU);
-    buf[3] = (uint8_t)(val & 0xFFU);
-}
-
-static int16_t unpack_i16_be(const uint8_t *buf)
-{
-    return (int16_t)((uint16_t)((uint16_t)buf[0] << 8U) | (uint16_t)buf[1]);
-}
-
 /* ── Init ──────────────────────────────────────────────────────────── */
 
 void bms_can_init(void)
 {
     /* P2-08: Set hardware filter to accept only expected IDs */
     hal_can_set_filter(CAN_ID_EMS_COMMAND, CAN_ID_EMS_HEARTBEAT);
+    hal_can_add_filter(CAN_ID_DIAG_REQ);
+    bms_can_txq_init();
+    bms_can_rx_init();
+    bms_canfd_init();
+
+    /* P2-01: commissioned key; without one every authenticated frame fails */
+    {
+        uint8_t key[16];
+        bool have = (hal_can_auth_key(key) == 0);
+        bms_can_auth_init(have ? key : NULL);
+        memset(key, 0, sizeof(key));
+        if (!have && BMS_CAN_AUTH_ENABLED) {
+            BMS_LOG("CC-01: No CAN auth key provisioned — EMS frames will be rejected");
+        }
+    }
 }
 
-/* ── Encode functions (unchanged from original, no SIMULATION DISCLAIMER) ── */
+/* ── Encode functions (layouts in bms_can_msgs.def) ─────────────── */
 
 void bms_can_encode_status(const bms_pack_data_t *pack, bms_can_frame_t *frame)
 {
-    memset(frame, 0, sizeof(*frame));
-    frame->id = CAN_ID_ARRAY_STATUS;
-    frame->dlc = 8U;
-    frame->data[0] = (uint8_t)pack->mode;
-    pack_u16_be(&frame->data[1], (uint16_t)(pack->pack_voltage_mv / 100U));
-    pack_i16_be(&frame->data[3], (int16_t)(pack->pack_current_ma / 100));
-    frame->data[5] = (uint8_t)(pack->soc_hundredths / 100U);
-    frame->data[6] = (uint8_t)((pack->max_temp_deci_c / 10) + 40);
-    {
-        uint32_t f;
-        memcpy(&f, &pack->faults, sizeof(f));
-        frame->data[7] = (uint8_t)(f & 0xFFU);
-    }
+    uint32_t f;
+
+    bms_can_msg_status_init(frame);
+    bms_can_msg_status_set_mode(frame, (uint8_t)pack->mode);
+    bms_can_msg_status_set_pack_voltage_mv(frame, pack->pack_voltage_mv);
+    bms_can_msg_status_set_pack_current_ma(frame, pack->pack_current_ma);
+    bms_can_msg_status_set_soc_hundredths(frame, pack->soc_hundredths);
+    bms_can_msg_status_set_max_temp_deci_c(frame, pack->max_temp_deci_c);
+    memcpy(&f, &pack->faults, sizeof(f));
+    bms_can_msg_status_set_faults(frame, (uint8_t)(f & 0xFFU));
 }
 
 void bms_can_encode_voltages(const bms_pack_data_t *pack, bms_can_frame_t *frame)
 {
-    memset(frame, 0, sizeof(*frame));
-    frame->id = CAN_ID_PACK_VOLTAGES;
-    frame->dlc = 8U;
-    pack_u16_be(&frame->data[0], pack->max_cell_mv);
-    pack_u16_be(&frame->data[2], pack->min_cell_mv);
-    pack_u16_be(&frame->data[4], pack->avg_cell_mv);
-    pack_u16_be(&frame->data[6], (uint16_t)(pack->max_cell_mv - pack->min_cell_mv));
+    bms_can_msg_voltages_init(frame);
+    bms_can_msg_voltages_set_max_cell_mv(frame, pack->max_cell_mv);
+    bms_can_msg_voltages_set_min_cell_mv(frame, pack->min_cell_mv);
+    bms_can_msg_voltages_set_avg_cell_mv(frame, pack->avg_cell_mv);
+    bms_can_msg_voltages_set_spread_mv(frame, (uint16_t)(pack->max_cell_mv - pack->min_cell_mv));
 }
 
 void bms_can_encode_temps(const bms_pack_data_t *pack, bms_can_frame_t *frame)
 {
-    memset(frame, 0, sizeof(*frame));
-    frame->id = CAN_ID_PACK_TEMPS;
-    frame->dlc = 8U;
-    pack_i16_be(&frame->data[0], pack->max_temp_deci_c);
-    pack_i16_be(&frame->data[2], pack->min_temp_deci_c);
-    pack_i16_be(&frame->data[4], (int16_t)(pack->charge_limit_ma / 100));
-    pack_i16_be(&frame->data[6], (int16_t)(pack->discharge_limit_ma / 100));
+    bms_can_msg_temps_init(frame);
+    bms_can_msg_temps_set_max_temp_deci_c(frame, pack->max_temp_deci_c);
+    bms_can_msg_temps_set_min_temp_deci_c(frame, pack->min_temp_deci_c);
+    bms_can_msg_temps_set_charge_limit_ma(frame, pack->charge_limit_ma);
+    bms_can_msg_temps_set_discharge_limit_ma(frame, pack->discharge_limit_ma);
 }
 
 void bms_can_encode_heartbeat(uint32_t uptime_ms, bms_can_frame_t *frame)
 {
-    memset(frame, 0, sizeof(*frame));
-    frame->id = CAN_ID_HEARTBEAT;
-    frame->dlc = 8U;
-    pack_u32_be(&frame->data[0], uptime_ms);
+    bms_can_msg_heartbeat_t m;
+
+    m.uptime_ms = uptime_ms;
+    bms_can_msg_heartbeat_encode(&m, frame);
 }
 
 void bms_can_encode_limits(const bms_pack_data_t *pack, bms_can_frame_t *frame)
 {
-    memset(frame, 0, sizeof(*frame));
-    frame->id = CAN_ID_LIMITS;
-    frame->dlc = 8U;
-    pack_u32_be(&frame->data[0], (uint32_t)pack->charge_limit_ma);
-    pack_u32_be(&frame->data[4], (uint32_t)pack->discharge_limit_ma);
+    bms_can_msg_limits_t m;
+
+    m.charge_limit_ma = pack->charge_limit_ma;
+    m.discharge_limit_ma = pack->discharge_limit_ma;
+    bms_can_msg_limits_encode(&m, frame);
+}
+
+static uint16_t cell_or_zero(const bms_pack_data_t *pack, uint16_t idx)
+{
+    return (idx < BMS_SE_PER_PACK) ? pack->cell_mv[idx] : 0U;
 }
 
 void bms_can_encode_cell_broadcast(const bms_pack_data_t *pack,
                                     uint8_t frame_idx, bms_can_frame_t *frame)
 {
-    uint16_t base;
-    uint8_t i;
-    memset(frame, 0, sizeof(*frame));
-    frame->id = CAN_ID_CELL_BROADCAST + (uint32_t)frame_idx;
-    frame->dlc = 8U;
-    base = (uint16_t)frame_idx * 4U;
-    for (i = 0U; i < 4U; i++) {
-        uint16_t idx = base + i;
-        uint16_t mv = (idx < BMS_SE_PER_PACK) ? pack->cell_mv[idx] : 0U;
-        pack_u16_be(&frame->data[i * 2U], mv);
-    }
+    bms_can_msg_cells_t m;
+    uint16_t base = (uint16_t)frame_idx * 4U;
+
+    m.cell0_mv = cell_or_zero(pack, base);
+    m.cell1_mv = cell_or_zero(pack, (uint16_t)(base + 1U));
+    m.cell2_mv = cell_or_zero(pack, (uint16_t)(base + 2U));
+    m.cell3_mv = cell_or_zero(pack, (uint16_t)(base + 3U));
+    bms_can_msg_cells_encode(&m, frame);
+    frame->id += (uint32_t)frame_idx;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════
@@ -146,14 +141,15 @@ void bms_can_encode_cell_broadcast(const bms_pack_data_t *pack,
 int32_t bms_can_decode_ems_command(const bms_can_frame_t *frame,
                                     bms_ems_command_t *cmd)
 {
-    int16_t raw_charge, raw_discharge;
+    bms_can_msg_ems_command_t m;
 
     if (frame->id != CAN_ID_EMS_COMMAND || frame->dlc < 5U) {
         cmd->valid = false;
         return -1;
     }
 
-    cmd->type = (bms_ems_cmd_type_t)frame->data[0];
+    bms_can_msg_ems_command_decode(frame, &m);
+    cmd->type = (bms_ems_cmd_type_t)m.cmd;
     cmd->timestamp_ms = hal_tick_ms();
 
     /* P2-06: Reject CMD_NONE — must use heartbeat ID 0x210 */
@@ -170,47 +166,33 @@ int32_t bms_can_decode_ems_command(const bms_can_frame_t *frame,
         return -1;
     }
 
-    /* P2-06: Validate reserved bytes are zero
-     * P3-01: When CAN auth is enabled, bytes [6] and [7] carry the sequence
-     *        counter — only byte [5] must be zero. (Yara CRITICAL: auth/reserved
-     *        byte conflict — NEW-01 from pentester-v2) */
-    if (frame->dlc >= 8U) {
-        if (frame->data[5] != 0U) {
-            BMS_LOG("P2-06: Non-zero reserved byte [5] in EMS command");
-            cmd->valid = false;
-            return -1;
-        }
+    /* P2-06: Validate reserved bytes are zero.
+     * With CAN auth enabled, bytes [5:7] carry the freshness low byte and
+     * truncated CMAC, already checked by bms_can_auth_verify(). */
 #if BMS_CAN_AUTH_ENABLED == 0U
-        /* Auth disabled: bytes [6] and [7] must also be zero */
-        if (frame->data[6] != 0U || frame->data[7] != 0U) {
-            BMS_LOG("P2-06: Non-zero reserved bytes [6:7] in EMS command");
-            cmd->valid = false;
-            return -1;
-        }
-#endif
-        /* When BMS_CAN_AUTH_ENABLED=1, bytes [6:7] hold the sequence counter
-         * and are validated by bms_can_auth_verify() instead. */
+    if (frame->dlc >= 8U && (m.fv_lsb != 0U || m.mac != 0U)) {
+        BMS_LOG("P2-06: Non-zero reserved bytes [5:7] in EMS command");
+        cmd->valid = false;
+        return -1;
     }
+#endif
 
-    /* Decode current limits */
-    raw_charge = unpack_i16_be(&frame->data[1]);
-    raw_discharge = unpack_i16_be(&frame->data[3]);
-
-    /* P2-06: Reject negative values (Yara: "negative values bypass downward clamp") */
-    if (raw_charge < 0) {
-        BMS_LOG("P2-06: Negative charge limit rejected (%d)", raw_charge);
+    /* P2-06: Reject negative values (Yara: "negative values bypass downward clamp").
+     * The table already scaled A → mA; the sign is the wire sign. */
+    if (m.charge_limit_ma < 0) {
+        BMS_LOG("P2-06: Negative charge limit rejected (%d)", (int)(m.charge_limit_ma / 1000));
         cmd->valid = false;
         return -1;
     }
-    if (raw_discharge < 0) {
-        BMS_LOG("P2-06: Negative discharge limit rejected (%d)", raw_discharge);
+    if (m.discharge_limit_ma < 0) {
+        BMS_LOG("P2-06: Negative discharge limit rejected (%d)", (int)(m.discharge_limit_ma / 1000));
         cmd->valid = false;
         return -1;
     }
 
-    /* Convert A → mA and clamp to hardware max */
-    cmd->charge_limit_ma = (int32_t)raw_charge * 1000;
-    cmd->discharge_limit_ma = (int32_t)raw_discharge * 1000;
+    /* Clamp to hardware max */
+    cmd->charge_limit_ma = m.charge_limit_ma;
+    cmd->discharge_limit_ma = m.discharge_limit_ma;
 
     if (cmd->charge_limit_ma > BMS_MAX_CHARGE_MA) {
         cmd->charge_limit_ma = BMS_MAX_CHARGE_MA;
@@ -232,123 +214,48 @@ void bms_can_tx_periodic(const bms_pack_data_t *pack)
     bms_can_frame_t frame;
     uint8_t max_broadcast = (uint8_t)((BMS_SE_PER_PACK + 3U) / 4U);
 
+    /* Enqueue only — frames leave via bms_can_txq_kick() / TX ISR */
     bms_can_encode_status(pack, &frame);
-    (void)hal_can_transmit(&frame);
+    (void)bms_can_txq_send(&frame, pack->fault_latched ? BMS_CAN_PRIO_ALARM
+                                                        : BMS_CAN_PRIO_CONTROL);
 
     bms_can_encode_limits(pack, &frame);
-    (void)hal_can_transmit(&frame);
+    (void)bms_can_txq_send(&frame, BMS_CAN_PRIO_CONTROL);
 
     bms_can_encode_heartbeat(pack->uptime_ms, &frame);
-    (void)hal_can_transmit(&frame);
+    (void)bms_can_txq_send(&frame, BMS_CAN_PRIO_CONTROL);
 
     bms_can_encode_voltages(pack, &frame);
-    (void)hal_can_transmit(&frame);
-
-    bms_can_encode_cell_broadcast(pack, s_cell_broadcast_idx, &frame);
-    (void)hal_can_transmit(&frame);
-    s_cell_broadcast_idx++;
-    if (s_cell_broadcast_idx >= max_broadcast) { s_cell_broadcast_idx = 0U; }
-
-    bms_can_encode_temps(pack, &frame);
-    (void)hal_can_transmit(&frame);
-}
-
-/* ═══════════════════════════════════════════════════════════════════════
- * CC-01 / P2-01: CAN Authentication Stub
- *
- * Sequence counter tracking is implemented now. AES-128-CMAC signature
- * verification is deferred to Phase 2.
- *
- * When BMS_CAN_AUTH_ENABLED=1:
- *   - TX frames get sequence counter in reserved bytes
- *   - RX frames must have valid (monotonically increasing) sequence counter
- *   - Auth failure → frame rejected + logged
- *
- * When BMS_CAN_AUTH_ENABLED=0 (default):
- *   - Counters still track (for debugging) but auth is not enforced
- * ═══════════════════════════════════════════════════════════════════════ */
-
-static uint16_t s_tx_seq_counter;
-static uint16_t s_rx_seq_counter;
-static bool     s_rx_seq_initialized;
-
-bool bms_can_auth_verify(const bms_can_frame_t *frame)
-{
-    /* TODO P2-01: Implement AES-128-CMAC verification */
-
-    /* Sequence counter validation (always tracked) */
-    if (frame->dlc < 8U) {
-        if (BMS_CAN_AUTH_ENABLED) {
-            BMS_LOG("CC-01: Auth reject — DLC %u < 8 (no room for seq counter)", frame->dlc);
-            return false;
-        }
-        return true;
+    (void)bms_can_txq_send(&frame, BMS_CAN_PRIO_TELEMETRY);
+
+    if (BMS_CAN_FD_ENABLED) {
+        (void)bms_canfd_tx_cells(pack);
+    } else {
+        bms_can_encode_cell_broadcast(pack, s_cell_broadcast_idx, &frame);
+        (void)bms_can_txq_send(&frame, BMS_CAN_PRIO_BULK);
+        s_cell_broadcast_idx++;
+        if (s_cell_broadcast_idx >= max_broadcast) { s_cell_broadcast_idx = 0U; }
     }
 
-    uint16_t rx_seq = (uint16_t)((uint16_t)frame->data[6] << 8U) | (uint16_t)frame->data[7];
-
-    if (!s_rx_seq_initialized) {
-        s_rx_seq_counter = rx_seq;
-        s_rx_seq_initialized = true;
-        return true;
-    }
-
-    /* Expect monotonically increasing (with wrap) */
-    uint16_t expected_next = (uint16_t)(s_rx_seq_counter + 1U);
-    if (rx_seq != expected_next && rx_seq != s_rx_seq_counter) {
-        if (BMS_CAN_AUTH_ENABLED) {
-            BMS_LOG("CC-01: Auth reject — seq %u, expected %u", rx_seq, expected_next);
-            return false;
-        }
-        /* Not enforced, just log and accept */
-        BMS_LOG("CC-01: Seq counter mismatch (non-enforced) — got %u, expected %u",
-                rx_seq, expected_next);
-    }
-
-    s_rx_seq_counter = rx_seq;
-    return true;
-}
-
-void bms_can_auth_sign(bms_can_frame_t *frame)
-{
-    /* TODO P2-01: Implement AES-128-CMAC signing */
-
-    /* Increment TX sequence counter and embed in frame */
-    s_tx_seq_counter++;
-    if (frame->dlc >= 8U) {
-        frame->data[6] = (uint8_t)((s_tx_seq_counter >> 8U) & 0xFFU);
-        frame->data[7] = (uint8_t)(s_tx_seq_counter & 0xFFU);
-    }
+    bms_can_encode_temps(pack, &frame);
+    (void)bms_can_txq_send(&frame, BMS_CAN_PRIO_TELEMETRY);
 }
 
-uint16_t bms_can_auth_get_tx_seq(void) { return s_tx_seq_counter; }
-uint16_t bms_can_auth_get_rx_seq(void) { return s_rx_seq_counter; }
-
 /* ── RX processing ─────────────────────────────────────────────────── */
 
 bool bms_can_rx_process(bms_ems_command_t *cmd)
 {
     bms_can_frame_t frame;
 
-    while (hal_can_receive(&frame) == 0) {
-        /* CC-01: Auth check on all received frames */
-        if (BMS_CAN_AUTH_ENABLED && !bms_can_auth_verify(&frame)) {
-            BMS_LOG("CC-01: Frame 0x%03X rejected — auth failed", frame.id);
-            continue;  /* reject frame */
-        }
-
-        if (frame.id == CAN_ID_EMS_COMMAND) {
-            if (bms_can_decode_ems_command(&frame, cmd) == 0) {
-                return true;
-            }
-        }
-        if (frame.id == CAN_ID_EMS_HEARTBEAT) {
-            cmd->type = EMS_CMD_NONE;
-            cmd->timestamp_ms = hal_tick_ms();
-            cmd->valid = true;
-            return true;
+    /* One producer per ring: on target CAN1_RX0_IRQHandler feeds it and
+     * the FIFO is never touched here. Only a build without the RX
+     * interrupt (desktop/mock) polls the FIFO in its place. */
+    if (!hal_can_rx_irq_armed()) {
+        while (hal_can_receive(&frame) == 0) {
+            bms_can_rx_isr(&frame);
         }
     }
 
-    return false;
+    /* Whole ring per cycle — no frames left waiting for the next slot */
+    return bms_can_rx_drain(cmd);
 }
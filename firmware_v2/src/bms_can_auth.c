@@ -0,0 +1,356 @@
+/**
+ * @file bms_can_auth.c
+ * @brief CC-01 / P2-01: AES-128-CMAC CAN frame authentication
+ *
+ * Street Smart Edition.
+ * Replaces the sequence-counter stub that lived in bms_can.c. Reviewer
+ * acceptance criteria (IMPLEMENTATION_PLAN P2-01): CMAC on 0x200/0x210,
+ * 4-byte monotonic counter, pre-shared commissioned key, invalid MAC or
+ * stale counter rejected and logged, heartbeat authenticated (Ghost EMS).
+ */
+
+#include "bms_can_auth.h"
+#include "bms_canfd.h"
+#include "bms_cmac.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+/* Worst case per state cycle: a full RX ring of classic frames */
+_Static_assert((uint64_t)BMS_CAN_RX_DEPTH * BMS_CAN_AUTH_VERIFY_CYCLES <=
+               (uint64_t)(BMS_CPU_HZ / 1000U) * BMS_STATE_PERIOD_MS *
+               BMS_CAN_AUTH_BUDGET_PCT / 100U,
+               "CAN auth verify cost exceeds state-task budget");
+_Static_assert(BMS_CANFD_AUTH_PAYLOAD_MAX + BMS_CANFD_AUTH_TRAILER_LEN <= BMS_CANFD_MAX_LEN,
+               "FD auth trailer must fit");
+
+_Static_assert(BMS_CAN_AUTH_FAIL_BURST > 0U && BMS_CAN_AUTH_FAIL_BURST <= 255U,
+               "Fail bucket is a uint8_t");
+
+#define MAC_HDR_LEN  8U   /* ID u32 + FV u32 */
+
+/* FV hand-over to the NVM task: one ready slot, as in bms_soh */
+#if defined(__GNUC__)
+  #define AUTH_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define AUTH_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  #define AUTH_LOAD(p)      (*(p))
+  #define AUTH_STORE(p, v)  (*(p) = (v))
+#endif
+
+static bms_cmac_ctx_t       s_cmac;
+static bool                 s_keyed;
+static uint32_t             s_tx_fv;
+static uint32_t             s_rx_fv;
+static bms_can_auth_stats_t s_stats;
+
+/* Forgery rate limit — verify side */
+static uint8_t              s_fail_tokens;
+static uint32_t             s_fail_t_ms;        /* last refill */
+static bool                 s_holdoff;
+static uint32_t             s_holdoff_end_ms;
+
+/* FV persistence — verify side hands over, NVM task writes */
+static uint32_t             s_persist_fv;       /* last handed over */
+static uint32_t             s_persist_t_ms;
+static bool                 s_fv_owed;          /* a command moved it */
+static uint32_t             s_ready_fv;
+static volatile bool        s_ready;
+static uint32_t             s_lockouts_logged;  /* NVM task */
+
+static void put_u32_be(uint8_t *b, uint32_t v)
+{
+    b[0] = (uint8_t)((v >> 24U) & 0xFFU);
+    b[1] = (uint8_t)((v >> 16U) & 0xFFU);
+    b[2] = (uint8_t)((v >> 8U) & 0xFFU);
+    b[3] = (uint8_t)(v & 0xFFU);
+}
+
+static uint32_t get_u32_be(const uint8_t *b)
+{
+    return ((uint32_t)b[0] << 24U) | ((uint32_t)b[1] << 16U) |
+           ((uint32_t)b[2] << 8U) | (uint32_t)b[3];
+}
+
+static uint16_t blocks_for(uint16_t len)
+{
+    return (len == 0U) ? 1U : (uint16_t)((len + BMS_AES_BLOCK_LEN - 1U) / BMS_AES_BLOCK_LEN);
+}
+
+/* ID ‖ FV ‖ payload → buf; returns MAC input length */
+static uint16_t mac_input(uint8_t *buf, uint32_t id, uint32_t fv,
+                          const uint8_t *payload, uint8_t len)
+{
+    put_u32_be(&buf[0], id);
+    put_u32_be(&buf[4], fv);
+    if (len > 0U) { memcpy(&buf[MAC_HDR_LEN], payload, len); }
+    return (uint16_t)(MAC_HDR_LEN + len);
+}
+
+static bool check_mac(const uint8_t *msg, uint16_t len, const uint8_t *tag, uint8_t tag_len)
+{
+    s_stats.aes_blocks += blocks_for(len);
+    return bms_cmac_verify(&s_cmac, msg, len, tag, tag_len);
+}
+
+static void make_mac(const uint8_t *msg, uint16_t len, uint8_t mac[16])
+{
+    s_stats.aes_blocks += blocks_for(len);
+    bms_cmac_compute(&s_cmac, msg, len, mac);
+}
+
+/* ── Forgery rate limit ────────────────────────────────────────────── */
+
+static void refill(uint32_t now_ms)
+{
+    uint32_t n = (now_ms - s_fail_t_ms) / BMS_CAN_AUTH_FAIL_REFILL_MS;
+
+    if (n == 0U) { return; }
+    if (n >= (uint32_t)(BMS_CAN_AUTH_FAIL_BURST - s_fail_tokens)) {
+        s_fail_tokens = (uint8_t)BMS_CAN_AUTH_FAIL_BURST;
+        s_fail_t_ms = now_ms;
+    } else {
+        s_fail_tokens = (uint8_t)(s_fail_tokens + n);
+        s_fail_t_ms += n * BMS_CAN_AUTH_FAIL_REFILL_MS;
+    }
+}
+
+static bool held_off(uint32_t now_ms)
+{
+    if (!s_holdoff) { return false; }
+    if ((int32_t)(now_ms - s_holdoff_end_ms) < 0) { return true; }
+    s_holdoff = false;
+    return false;
+}
+
+static void note_bad_mac(uint32_t now_ms)
+{
+    refill(now_ms);
+    if (s_fail_tokens > 0U) { s_fail_tokens--; }
+    if (s_fail_tokens > 0U) { return; }
+
+    s_holdoff = true;
+    s_holdoff_end_ms = now_ms + BMS_CAN_AUTH_HOLDOFF_MS;
+    s_stats.lockout_latched = true;
+    AUTH_STORE(&s_stats.lockouts, s_stats.lockouts + 1U);
+    BMS_LOG("CC-01: %u bad command MACs — commands held off for %u ms",
+            (unsigned)BMS_CAN_AUTH_FAIL_BURST, (unsigned)BMS_CAN_AUTH_HOLDOFF_MS);
+}
+
+/* ── FV persistence hand-over ──────────────────────────────────────── */
+
+/* After every accepted frame: a command's FV is owed to NVM at once,
+ * heartbeat progress every BMS_CAN_AUTH_FV_PERSIST_MS. A busy slot
+ * leaves it owed for the next frame (the 1 Hz heartbeat at the latest). */
+static void hand_over(bool command, uint32_t now_ms)
+{
+    if (command) { s_fv_owed = true; }
+    if (s_rx_fv == s_persist_fv) {
+        s_fv_owed = false;
+        return;
+    }
+    if (!s_fv_owed && (now_ms - s_persist_t_ms) < BMS_CAN_AUTH_FV_PERSIST_MS) { return; }
+    if (AUTH_LOAD(&s_ready)) { return; }                 /* NVM task still busy */
+
+    s_ready_fv = s_rx_fv;
+    AUTH_STORE(&s_ready, true);
+    s_persist_fv = s_rx_fv;
+    s_persist_t_ms = now_ms;
+    s_fv_owed = false;
+}
+
+/* ── Init ──────────────────────────────────────────────────────────── */
+
+void bms_can_auth_init(const uint8_t *key)
+{
+    uint32_t now = hal_tick_ms();
+
+    bms_cmac_wipe(&s_cmac);
+    s_keyed = (key != NULL);
+    if (s_keyed) { bms_cmac_init(&s_cmac, key); }
+    s_tx_fv = 0U;
+    s_rx_fv = 0U;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    s_fail_tokens = (uint8_t)BMS_CAN_AUTH_FAIL_BURST;
+    s_fail_t_ms = now;
+    s_holdoff = false;
+    s_persist_fv = 0U;
+    s_persist_t_ms = now;
+    s_fv_owed = false;
+    AUTH_STORE(&s_ready, false);
+    s_lockouts_logged = 0U;
+}
+
+void bms_can_auth_restore(const bms_nvm_persistent_t *p)
+{
+    if (p->can_rx_fv > s_rx_fv) { s_rx_fv = p->can_rx_fv; }
+    s_persist_fv = s_rx_fv;                         /* already stored */
+}
+
+/* ── Classic frames ────────────────────────────────────────────────── */
+
+bool bms_can_auth_verify(const bms_can_frame_t *frame)
+{
+    uint8_t msg[MAC_HDR_LEN + BMS_CAN_AUTH_PAYLOAD_MAX];
+    uint32_t t0 = hal_cycle_count();
+    uint32_t now = hal_tick_ms();
+    bool command = (frame->id != CAN_ID_EMS_HEARTBEAT);
+    uint32_t fv;
+    uint16_t len;
+    bool ok;
+
+    if (!s_keyed || frame->dlc < 8U) {
+        BMS_LOG("CC-01: Auth reject 0x%03X — %s", frame->id,
+                s_keyed ? "DLC < 8" : "no key provisioned");
+        s_stats.bad_format++;
+        return false;
+    }
+
+    if (frame->id == CAN_ID_EMS_HEARTBEAT) {
+        fv = get_u32_be(&frame->data[0]);
+        if (fv <= s_rx_fv) {
+            BMS_LOG("CC-01: Auth reject — heartbeat FV %lu ≤ %lu (replay)",
+                    (unsigned long)fv, (unsigned long)s_rx_fv);
+            s_stats.replay++;
+            return false;
+        }
+        len = mac_input(msg, frame->id, fv, NULL, 0U);
+        ok = check_mac(msg, len, &frame->data[4], BMS_CAN_AUTH_SYNC_MAC_LEN);
+    } else {
+        if (held_off(now)) {
+            s_stats.held_off++;
+            return false;
+        }
+        /* Smallest FV > last accepted whose low byte matches */
+        fv = (s_rx_fv & ~0xFFU) | (uint32_t)frame->data[5];
+        if (fv <= s_rx_fv) { fv += 0x100U; }
+        len = mac_input(msg, frame->id, fv, frame->data, BMS_CAN_AUTH_PAYLOAD_MAX);
+        ok = check_mac(msg, len, &frame->data[6], BMS_CAN_AUTH_MAC_LEN);
+    }
+
+    {
+        uint32_t dt = hal_cycle_count() - t0;
+        if (dt > s_stats.verify_cycles_max) { s_stats.verify_cycles_max = dt; }
+    }
+
+    if (!ok) {
+        BMS_LOG("CC-01: Auth reject 0x%03X — bad MAC", frame->id);
+        s_stats.bad_mac++;
+        if (command) { note_bad_mac(now); }
+        return false;
+    }
+    if (fv - s_rx_fv > 0x100U) { s_stats.resync++; }
+    s_rx_fv = fv;
+    s_stats.verified++;
+    hand_over(command, now);
+    return true;
+}
+
+void bms_can_auth_sign(bms_can_frame_t *frame)
+{
+    uint8_t msg[MAC_HDR_LEN + BMS_CAN_AUTH_PAYLOAD_MAX];
+    uint8_t mac[BMS_AES_BLOCK_LEN];
+    uint16_t len;
+
+    if (!s_keyed) { return; }
+    s_tx_fv++;
+    frame->dlc = 8U;
+
+    if (frame->id == CAN_ID_EMS_HEARTBEAT) {
+        put_u32_be(&frame->data[0], s_tx_fv);
+        len = mac_input(msg, frame->id, s_tx_fv, NULL, 0U);
+        make_mac(msg, len, mac);
+        memcpy(&frame->data[4], mac, BMS_CAN_AUTH_SYNC_MAC_LEN);
+    } else {
+        frame->data[5] = (uint8_t)(s_tx_fv & 0xFFU);
+        len = mac_input(msg, frame->id, s_tx_fv, frame->data, BMS_CAN_AUTH_PAYLOAD_MAX);
+        make_mac(msg, len, mac);
+        memcpy(&frame->data[6], mac, BMS_CAN_AUTH_MAC_LEN);
+    }
+}
+
+/* ── CAN FD ────────────────────────────────────────────────────────── */
+
+bool bms_can_auth_sign_fd(bms_canfd_frame_t *frame)
+{
+    uint8_t msg[MAC_HDR_LEN + BMS_CANFD_MAX_LEN];
+    uint8_t mac[BMS_AES_BLOCK_LEN];
+    uint8_t payload = frame->len;
+    uint8_t len, body;
+    uint16_t n;
+
+    if (!s_keyed || payload > BMS_CANFD_AUTH_PAYLOAD_MAX) { return false; }
+
+    len = bms_canfd_len_round((uint8_t)(payload + BMS_CANFD_AUTH_TRAILER_LEN));
+    body = (uint8_t)(len - BMS_CANFD_AUTH_TRAILER_LEN);
+    memset(&frame->data[payload], 0, (size_t)(BMS_CANFD_MAX_LEN - payload));
+
+    s_tx_fv++;
+    n = mac_input(msg, frame->id, s_tx_fv, frame->data, body);
+    make_mac(msg, n, mac);
+    put_u32_be(&frame->data[body], s_tx_fv);
+    memcpy(&frame->data[body + 4U], mac, BMS_CANFD_AUTH_MAC_LEN);
+    frame->len = len;
+    return true;
+}
+
+bool bms_can_auth_verify_fd(const bms_canfd_frame_t *frame)
+{
+    uint8_t msg[MAC_HDR_LEN + BMS_CANFD_MAX_LEN];
+    uint8_t body;
+    uint32_t fv;
+    uint16_t n;
+
+    if (!s_keyed || frame->len < BMS_CANFD_AUTH_TRAILER_LEN ||
+        frame->len > BMS_CANFD_MAX_LEN) {
+        s_stats.bad_format++;
+        return false;
+    }
+    body = (uint8_t)(frame->len - BMS_CANFD_AUTH_TRAILER_LEN);
+    fv = get_u32_be(&frame->data[body]);
+    if (fv <= s_rx_fv) {
+        s_stats.replay++;
+        return false;
+    }
+    n = mac_input(msg, frame->id, fv, frame->data, body);
+    if (!check_mac(msg, n, &frame->data[body + 4U], BMS_CANFD_AUTH_MAC_LEN)) {
+        s_stats.bad_mac++;
+        return false;
+    }
+    s_rx_fv = fv;
+    s_stats.verified++;
+    hand_over(true, hal_tick_ms());
+    return true;
+}
+
+/* ── NVM task ──────────────────────────────────────────────────────── */
+
+bool bms_can_auth_flush(bms_nvm_ctx_t *ctx)
+{
+    uint32_t lockouts = AUTH_LOAD(&s_stats.lockouts);
+    bool wrote = false;
+
+    if (lockouts != s_lockouts_logged) {
+        bms_nvm_log_fault(ctx, hal_tick_ms(), NVM_FAULT_CAN_AUTH, 0xFFU,
+                          (uint16_t)((lockouts > 0xFFFFU) ? 0xFFFFU : lockouts));
+        (void)bms_nvm_commit(ctx);
+        s_lockouts_logged = lockouts;
+        wrote = true;
+    }
+    if (AUTH_LOAD(&s_ready)) {
+        ctx->persistent.can_rx_fv = s_ready_fv;
+        AUTH_STORE(&s_ready, false);
+        bms_nvm_save_persistent(ctx);
+        wrote = true;
+    }
+    return wrote;
+}
+
+uint32_t bms_can_auth_get_tx_seq(void) { return s_tx_fv; }
+uint32_t bms_can_auth_get_rx_seq(void) { return s_rx_fv; }
+
+void bms_can_auth_get_stats(bms_can_auth_stats_t *out)
+{
+    *out = s_stats;
+}
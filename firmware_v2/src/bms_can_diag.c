@@ -0,0 +1,410 @@
+/**
+ * @file bms_can_diag.c
+ * @brief ISO 15765-2 (ISO-TP) diagnostic bulk-read service
+ *
+ * Street Smart Edition.
+ * Sender-side ISO-TP only: requests are single frames; a multi-frame
+ * request is refused with FC OVFLW. One transfer at a time — a new
+ * request aborts the one in progress (ISO 15765-2 §9.6.5 behaviour).
+ */
+
+#include "bms_can_diag.h"
+#include "bms_blackbox.h"
+#include "bms_history.h"
+#include "bms_can_rx.h"
+#include "bms_can_txq.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+#define ISOTP_PCI_SF   0x0U
+#define ISOTP_PCI_FF   0x1U
+#define ISOTP_PCI_CF   0x2U
+#define ISOTP_PCI_FC   0x3U
+#define ISOTP_FS_CTS   0x0U
+#define ISOTP_FS_WAIT  0x1U
+#define ISOTP_FS_OVFL  0x2U
+#define ISOTP_PAD      0xCCU
+#define ISOTP_MAX_LEN  4095U
+
+#define DIAG_BUF_LEN \
+    ((BMS_DIAG_LEN_PROT > BMS_DIAG_LEN_SNAPSHOT) ? BMS_DIAG_LEN_PROT : BMS_DIAG_LEN_SNAPSHOT)
+
+_Static_assert(BMS_DIAG_LEN_PROT <= ISOTP_MAX_LEN, "Response exceeds ISO-TP FF length");
+_Static_assert(BMS_DIAG_LEN_FAULT_LOG <= DIAG_BUF_LEN, "Fault log exceeds buffer");
+_Static_assert(BMS_DIAG_LEN_BBOX_BLOCK <= DIAG_BUF_LEN, "Black-box block exceeds buffer");
+_Static_assert(BMS_BBOX_BLOCKS <= 0x100U, "Black-box DIDs run into the next range");
+_Static_assert(BMS_DIAG_LEN_HIST_PAGE <= DIAG_BUF_LEN, "History page exceeds buffer");
+_Static_assert(BMS_DIAG_HIST_PAGES <= 0x100U, "History DIDs run into the next range");
+_Static_assert(BMS_DIAG_CF_PER_POLL <= BMS_CAN_TXQ_DEPTH, "CF burst exceeds TX ring");
+
+typedef enum {
+    DIAG_IDLE = 0,
+    DIAG_WAIT_FC,
+    DIAG_SEND_CF
+} diag_state_t;
+
+static const bms_pack_data_t        *s_pack;
+static const bms_protection_state_t *s_prot;
+static const bms_nvm_ctx_t          *s_nvm;
+
+static uint8_t      s_buf[DIAG_BUF_LEN];
+static bms_nvm_fault_log_t s_log;   /* fault log copy being serialised */
+static uint16_t     s_len;
+static uint16_t     s_pos;
+static uint8_t      s_sn;
+static uint8_t      s_bs;           /* 0 = no further FC */
+static uint8_t      s_bs_count;
+static uint8_t      s_stmin_ms;
+static uint32_t     s_last_cf_ms;
+static uint32_t     s_fc_wait_ms;
+static uint32_t     s_start_ms;
+static diag_state_t s_state;
+static bms_can_diag_stats_t s_stats;
+
+/* ── Frame helpers ─────────────────────────────────────────────────── */
+
+static bool send_frame(const uint8_t *bytes, uint8_t n)
+{
+    bms_can_frame_t f;
+
+    f.id = CAN_ID_DIAG_RESP;
+    f.dlc = 8U;
+    memset(f.data, ISOTP_PAD, sizeof(f.data));
+    memcpy(f.data, bytes, n);
+    return bms_can_txq_send(&f, BMS_CAN_PRIO_DIAG) == 0;
+}
+
+static void send_fc_overflow(void)
+{
+    const uint8_t fc[3] = { (uint8_t)((ISOTP_PCI_FC << 4U) | ISOTP_FS_OVFL), 0U, 0U };
+    (void)send_frame(fc, 3U);
+}
+
+/* STmin encoding → whole ms; 100–900 µs rounds up to one poll */
+static uint8_t stmin_ms(uint8_t raw)
+{
+    if (raw <= 0x7FU) { return raw; }
+    if (raw >= 0xF1U && raw <= 0xF9U) { return 1U; }
+    return 0x7FU;       /* reserved → maximum */
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8U);
+    p[1] = (uint8_t)v;
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24U);
+    p[1] = (uint8_t)(v >> 16U);
+    p[2] = (uint8_t)(v >> 8U);
+    p[3] = (uint8_t)v;
+    return p + 4;
+}
+
+/* ── Data builders (frozen into s_buf) ─────────────────────────────── */
+
+static uint16_t build_fault_log(uint8_t *p)
+{
+    uint8_t *start = p;
+    uint8_t i;
+
+    /* The NVM task's published copy, never its live ring */
+    bms_nvm_fault_log_read(s_nvm, &s_log);
+    *p++ = s_log.count;
+    for (i = 0U; i < s_log.count; i++) {
+        const bms_nvm_fault_event_t *ev = &s_log.ev[i];
+        p = put_u32(p, ev->timestamp_ms);
+        *p++ = ev->fault_type;
+        *p++ = ev->cell_index;
+        p = put_u16(p, ev->value);
+    }
+    return (uint16_t)(p - start);
+}
+
+static uint16_t build_snapshot(uint8_t *p)
+{
+    uint8_t *start = p;
+    uint16_t i;
+    uint8_t mod, s;
+
+    p = put_u32(p, s_pack->uptime_ms);
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { p = put_u16(p, s_pack->cell_mv[i]); }
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (s = 0U; s < BMS_TEMPS_PER_MODULE; s++) {
+            p = put_u16(p, (uint16_t)s_pack->modules[mod].temp_deci_c[s]);
+        }
+    }
+    return (uint16_t)(p - start);
+}
+
+static uint16_t build_prot(uint8_t *p)
+{
+    uint8_t *start = p;
+    uint16_t i;
+
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { p = put_u16(p, s_prot->ov_timer_ms[i]); }
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { p = put_u16(p, s_prot->uv_timer_ms[i]); }
+    for (i = 0U; i < BMS_TOTAL_TEMP_SENSORS; i++) { p = put_u16(p, s_prot->ot_timer_ms[i]); }
+    p = put_u32(p, s_prot->hw_ov_timer_ms);
+    p = put_u32(p, s_prot->hw_uv_timer_ms);
+    p = put_u32(p, s_prot->hw_ot_timer_ms);
+    p = put_u32(p, s_prot->oc_charge_timer_ms);
+    p = put_u32(p, s_prot->oc_discharge_timer_ms);
+    p = put_u32(p, s_prot->subzero_charge_timer_ms);
+    p = put_u32(p, s_prot->safe_state_ms);
+    p = put_u32(p, s_prot->warning_hold_ms);
+    return (uint16_t)(p - start);
+}
+
+static uint16_t build_bbox_info(uint8_t *p)
+{
+    bms_blackbox_info_t info;
+    uint8_t *start = p;
+
+    if (!bms_blackbox_get_info(&info)) { return 0xFFFFU; }
+    p = put_u16(p, info.blocks);
+    p = put_u16(p, info.trigger_block);
+    p = put_u16(p, info.trigger_sample);
+    p = put_u32(p, info.trigger_ms);
+    p = put_u32(p, info.faults);
+    p = put_u32(p, info.first_ms);
+    p = put_u32(p, info.last_ms);
+    p = put_u32(p, info.capture);
+    return (uint16_t)(p - start);
+}
+
+/* ── Transfer control ──────────────────────────────────────────────── */
+
+static void abort_transfer(void)
+{
+    if (s_state != DIAG_IDLE) { s_stats.aborted++; }
+    s_state = DIAG_IDLE;
+}
+
+static void start_response(uint16_t len, uint32_t now)
+{
+    uint8_t hdr[8];
+
+    s_len = len;
+    s_start_ms = now;
+
+    if (len <= 7U) {
+        hdr[0] = (uint8_t)((ISOTP_PCI_SF << 4U) | len);
+        memcpy(&hdr[1], s_buf, len);
+        if (send_frame(hdr, (uint8_t)(len + 1U))) {
+            s_stats.completed++;
+            s_stats.last_transfer_ms = 0U;
+        } else {
+            s_stats.aborted++;
+        }
+        s_state = DIAG_IDLE;
+        return;
+    }
+
+    hdr[0] = (uint8_t)((ISOTP_PCI_FF << 4U) | ((len >> 8U) & 0x0FU));
+    hdr[1] = (uint8_t)len;
+    memcpy(&hdr[2], s_buf, 6U);
+    if (!send_frame(hdr, 8U)) {
+        s_stats.aborted++;
+        s_state = DIAG_IDLE;
+        return;
+    }
+    s_pos = 6U;
+    s_sn = 1U;
+    s_state = DIAG_WAIT_FC;
+    s_fc_wait_ms = now;
+}
+
+static void negative(uint8_t sid, uint8_t nrc, uint32_t now)
+{
+    s_buf[0] = BMS_DIAG_SID_NEGATIVE;
+    s_buf[1] = sid;
+    s_buf[2] = nrc;
+    s_stats.negative++;
+    start_response(3U, now);
+}
+
+static void handle_request(const uint8_t *req, uint8_t len, uint32_t now)
+{
+    uint16_t did, n;
+
+    s_stats.requests++;
+    abort_transfer();
+
+    if (req[0] != BMS_DIAG_SID_READ_DID) {
+        negative(req[0], BMS_DIAG_NRC_NOT_SUPP, now);
+        return;
+    }
+    if (len != 3U) {
+        negative(req[0], BMS_DIAG_NRC_BAD_LENGTH, now);
+        return;
+    }
+
+    did = (uint16_t)(((uint16_t)req[1] << 8U) | req[2]);
+    s_buf[0] = (uint8_t)(BMS_DIAG_SID_READ_DID + 0x40U);
+    s_buf[1] = req[1];
+    s_buf[2] = req[2];
+
+    /* Freeze source data. Only the protection timers are copied with
+     * interrupts off (protection preempts this task). The snapshot is
+     * this task's own pack copy in the RTOS build (the main loop's in
+     * bare metal), the fault log is the NVM task's seqlock-published
+     * copy, and the rest are flash reads that must not run in a
+     * critical section. */
+    switch (did) {
+    case BMS_DIAG_DID_FAULT_LOG:
+        n = (s_nvm != NULL) ? build_fault_log(&s_buf[3]) : 0xFFFFU;
+        break;
+    case BMS_DIAG_DID_SNAPSHOT:
+        n = (s_pack != NULL) ? build_snapshot(&s_buf[3]) : 0xFFFFU;
+        break;
+    case BMS_DIAG_DID_PROT_TIMERS:
+        if (s_prot != NULL) {
+            BMS_ENTER_CRITICAL();
+            n = build_prot(&s_buf[3]);
+            BMS_EXIT_CRITICAL();
+        } else {
+            n = 0xFFFFU;
+        }
+        break;
+    case BMS_DIAG_DID_BBOX_INFO:
+        n = build_bbox_info(&s_buf[3]);
+        break;
+    default:
+        /* Stored black-box block / history page — 256-byte NOR reads */
+        if (did >= BMS_DIAG_DID_BBOX_BLOCK && did < BMS_DIAG_DID_BBOX_BLOCK + BMS_BBOX_BLOCKS &&
+            bms_blackbox_read_block((uint16_t)(did - BMS_DIAG_DID_BBOX_BLOCK), &s_buf[3])) {
+            n = BMS_BBOX_BLOCK_SIZE;
+        } else if (did >= BMS_DIAG_DID_HISTORY && did < BMS_DIAG_DID_HISTORY + BMS_DIAG_HIST_PAGES &&
+                   bms_history_read_page((uint16_t)(did - BMS_DIAG_DID_HISTORY), &s_buf[3])) {
+            n = BMS_NVM_PAGE_SIZE;
+        } else {
+            n = 0xFFFFU;
+        }
+        break;
+    }
+
+    if (n == 0xFFFFU) {
+        negative(BMS_DIAG_SID_READ_DID, BMS_DIAG_NRC_OUT_OF_RANGE, now);
+        return;
+    }
+    start_response((uint16_t)(3U + n), now);
+}
+
+static void handle_frame(const bms_can_frame_t *f, uint32_t now)
+{
+    uint8_t pci = (uint8_t)(f->data[0] >> 4U);
+
+    if (f->dlc < 1U) { return; }
+
+    switch (pci) {
+    case ISOTP_PCI_SF:
+        {
+            uint8_t len = (uint8_t)(f->data[0] & 0x0FU);
+            if (len >= 1U && len <= 7U && len < f->dlc) {
+                handle_request(&f->data[1], len, now);
+            }
+        }
+        break;
+    case ISOTP_PCI_FF:
+        send_fc_overflow();             /* no multi-frame requests */
+        break;
+    case ISOTP_PCI_FC:
+        if (s_state != DIAG_WAIT_FC || f->dlc < 3U) { break; }
+        switch (f->data[0] & 0x0FU) {
+        case ISOTP_FS_CTS:
+            s_bs = f->data[1];
+            s_bs_count = 0U;
+            s_stmin_ms = stmin_ms(f->data[2]);
+            s_last_cf_ms = now - s_stmin_ms;
+            s_state = DIAG_SEND_CF;
+            break;
+        case ISOTP_FS_WAIT:
+            s_fc_wait_ms = now;
+            break;
+        default:
+            abort_transfer();
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void send_cfs(uint32_t now)
+{
+    uint8_t burst = 0U;
+
+    while (s_state == DIAG_SEND_CF && burst < BMS_DIAG_CF_PER_POLL) {
+        uint8_t cf[8];
+        uint16_t n = (uint16_t)(s_len - s_pos);
+
+        if (s_stmin_ms > 0U && (now - s_last_cf_ms) < s_stmin_ms) { break; }
+        if (n > 7U) { n = 7U; }
+        cf[0] = (uint8_t)((ISOTP_PCI_CF << 4U) | (s_sn & 0x0FU));
+        memcpy(&cf[1], &s_buf[s_pos], n);
+        if (!send_frame(cf, (uint8_t)(n + 1U))) { break; }   /* ring full: retry */
+
+        s_pos = (uint16_t)(s_pos + n);
+        s_sn = (uint8_t)((s_sn + 1U) & 0x0FU);
+        s_last_cf_ms = now;
+        s_stats.cf_sent++;
+        burst++;
+
+        if (s_pos >= s_len) {
+            s_stats.completed++;
+            s_stats.last_transfer_ms = now - s_start_ms;
+            s_state = DIAG_IDLE;
+        } else if (s_bs != 0U && ++s_bs_count >= s_bs) {
+            s_state = DIAG_WAIT_FC;
+            s_fc_wait_ms = now;
+        } else if (s_stmin_ms > 0U) {
+            break;                      /* one CF per STmin */
+        }
+    }
+}
+
+/* ── Public API ────────────────────────────────────────────────────── */
+
+void bms_can_diag_init(const bms_pack_data_t *pack,
+                       const bms_protection_state_t *prot,
+                       const bms_nvm_ctx_t *nvm)
+{
+    s_pack = pack;
+    s_prot = prot;
+    s_nvm = nvm;
+    s_state = DIAG_IDLE;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void bms_can_diag_poll(void)
+{
+    bms_can_frame_t f;
+    uint32_t now = hal_tick_ms();
+
+    while (bms_can_rx_diag_pop(&f)) {
+        handle_frame(&f, now);
+    }
+
+    if (s_state == DIAG_WAIT_FC && (now - s_fc_wait_ms) > BMS_DIAG_N_BS_MS) {
+        BMS_LOG("Diag: N_Bs timeout, transfer aborted at %u/%u", s_pos, s_len);
+        abort_transfer();
+    }
+
+    send_cfs(now);
+}
+
+bool bms_can_diag_busy(void)
+{
+    return s_state != DIAG_IDLE;
+}
+
+void bms_can_diag_get_stats(bms_can_diag_stats_t *out)
+{
+    *out = s_stats;
+}
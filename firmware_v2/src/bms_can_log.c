@@ -0,0 +1,153 @@
+/**
+ * @file bms_can_log.c
+ * @brief Desktop CAN log decoder driven by bms_can_msgs.def
+ *
+ * Street Smart Edition.
+ * Expands the message table a third time into descriptor arrays and walks
+ * them at run time. Speed is irrelevant here; the firmware path uses the
+ * specialised inline encoders in bms_can_msgs.h.
+ */
+
+#include "bms_can_log.h"
+#include <stdio.h>
+#include <string.h>
+
+/* ── Descriptor tables ─────────────────────────────────────────────── */
+
+#define BMS_CAN_MSG(msg, mid, span, mdlc) \
+    static const bms_can_sig_desc_t s_sigs_##msg[] = {
+#define BMS_CAN_SIG(msg, sig, ctype, wire, byte, sdiv, sadd, unit) \
+        { #sig, unit, BMS_CAN_WIRE_##wire, (uint8_t)(byte), (int32_t)(sdiv), (int32_t)(sadd) },
+#define BMS_CAN_END(msg) \
+    };
+#include "bms_can_msgs.def"
+#undef BMS_CAN_MSG
+#undef BMS_CAN_SIG
+#undef BMS_CAN_END
+
+#define BMS_CAN_MSG(msg, mid, span, mdlc) \
+    { #msg, (uint32_t)(mid), (uint16_t)(span), (uint8_t)(mdlc), \
+      (uint8_t)(sizeof(s_sigs_##msg) / sizeof(s_sigs_##msg[0])), s_sigs_##msg },
+#define BMS_CAN_SIG(msg, sig, ctype, wire, byte, sdiv, sadd, unit)
+#define BMS_CAN_END(msg)
+static const bms_can_msg_desc_t s_msgs[] = {
+#include "bms_can_msgs.def"
+};
+#undef BMS_CAN_MSG
+#undef BMS_CAN_SIG
+#undef BMS_CAN_END
+
+#define N_MSGS  (sizeof(s_msgs) / sizeof(s_msgs[0]))
+
+static const uint8_t s_wire_size[] = { 1U, 1U, 2U, 2U, 4U, 4U };
+
+/* ── Lookup / decode ───────────────────────────────────────────────── */
+
+const bms_can_msg_desc_t *bms_can_log_find(uint32_t id)
+{
+    size_t i;
+
+    for (i = 0U; i < N_MSGS; i++) {
+        if (s_msgs[i].id == id) { return &s_msgs[i]; }
+    }
+    for (i = 0U; i < N_MSGS; i++) {
+        if (id > s_msgs[i].id && id < s_msgs[i].id + s_msgs[i].span) {
+            return &s_msgs[i];
+        }
+    }
+    return NULL;
+}
+
+int64_t bms_can_log_signal(const bms_can_sig_desc_t *sig, const uint8_t *data)
+{
+    const uint8_t *b = &data[sig->byte];
+    int64_t raw;
+
+    switch (sig->wire) {
+    case BMS_CAN_WIRE_U8:  raw = b[0]; break;
+    case BMS_CAN_WIRE_I8:  raw = (int8_t)b[0]; break;
+    case BMS_CAN_WIRE_U16: raw = (uint16_t)((b[0] << 8U) | b[1]); break;
+    case BMS_CAN_WIRE_I16: raw = (int16_t)(uint16_t)((b[0] << 8U) | b[1]); break;
+    case BMS_CAN_WIRE_U32:
+        raw = ((uint32_t)b[0] << 24U) | ((uint32_t)b[1] << 16U) |
+              ((uint32_t)b[2] << 8U) | (uint32_t)b[3];
+        break;
+    default:
+        raw = (int32_t)(((uint32_t)b[0] << 24U) | ((uint32_t)b[1] << 16U) |
+                        ((uint32_t)b[2] << 8U) | (uint32_t)b[3]);
+        break;
+    }
+    return (raw - sig->add) * sig->div;
+}
+
+int bms_can_log_format(const bms_can_frame_t *frame, char *buf, size_t len)
+{
+    const bms_can_msg_desc_t *msg = bms_can_log_find(frame->id);
+    size_t pos = 0U;
+    uint8_t i;
+    int n;
+
+    if (len == 0U) { return -1; }
+    buf[0] = '\0';
+    if (msg == NULL) { return -1; }
+
+    if (msg->span > 1U) {
+        n = snprintf(buf, len, "%s[%u]", msg->name, (unsigned)(frame->id - msg->id));
+    } else {
+        n = snprintf(buf, len, "%s", msg->name);
+    }
+    if (n > 0) { pos = ((size_t)n < len) ? (size_t)n : len - 1U; }
+
+    for (i = 0U; i < msg->n_sigs && pos < len - 1U; i++) {
+        const bms_can_sig_desc_t *s = &msg->sigs[i];
+        if ((uint32_t)s->byte + s_wire_size[s->wire] > frame->dlc) {
+            n = snprintf(&buf[pos], len - pos, " %s=-", s->name);
+        } else {
+            n = snprintf(&buf[pos], len - pos, " %s=%lld%s%s", s->name,
+                         (long long)bms_can_log_signal(s, frame->data),
+                         (s->unit[0] != '\0') ? " " : "", s->unit);
+        }
+        if (n > 0) { pos += ((size_t)n < len - pos) ? (size_t)n : len - pos - 1U; }
+    }
+    return (int)pos;
+}
+
+static int hex_val(char c)
+{
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    return -1;
+}
+
+bool bms_can_log_parse(const char *line, bms_can_frame_t *frame, size_t *prefix_len)
+{
+    const char *hash = strchr(line, '#');
+    const char *p;
+    uint32_t id = 0U;
+    uint8_t dlc = 0U;
+
+    if (hash == NULL || hash == line) { return false; }
+
+    /* ID: hex digits immediately before '#' (3 = standard, 8 = extended) */
+    p = hash;
+    while (p > line && hex_val(p[-1]) >= 0) { p--; }
+    if (p == hash || (hash - p) > 8) { return false; }
+    *prefix_len = (size_t)(p - line);
+    for (; p < hash; p++) { id = (id << 4U) | (uint32_t)hex_val(*p); }
+
+    memset(frame, 0, sizeof(*frame));
+    frame->id = id;
+
+    /* "##" marks CAN FD in candump -l — not a classic frame */
+    p = hash + 1;
+    if (*p == '#') { return false; }
+    while (hex_val(p[0]) >= 0 && hex_val(p[1]) >= 0) {
+        if (dlc >= 8U) { return false; }
+        frame->data[dlc] = (uint8_t)((hex_val(p[0]) << 4) | hex_val(p[1]));
+        dlc++;
+        p += 2;
+    }
+    frame->dlc = dlc;
+    return true;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file bms_can_rx.c
+ * @brief ISR-fed CAN RX ring with urgent-command wake-up
+ *
+ * Street Smart Edition.
+ * Same SPSC scheme as the TX queue: the ISR owns head, the draining
+ * task owns tail, indices are free-running uint8_t. Auth and P2-06
+ * validation stay in task context; the ISR only filters by ID and peeks
+ * at the command byte to decide whether to wake the state task.
+ */
+
+#include "bms_can_rx.h"
+#include "bms_can.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+#define RXQ_MASK  ((uint8_t)(BMS_CAN_RX_DEPTH - 1U))
+
+_Static_assert((BMS_CAN_RX_DEPTH & (BMS_CAN_RX_DEPTH - 1U)) == 0U,
+               "RX ring depth must be a power of 2");
+_Static_assert(BMS_CAN_RX_DEPTH <= 128U, "uint8_t ring indices");
+_Static_assert((BMS_CAN_DIAG_RX_DEPTH & (BMS_CAN_DIAG_RX_DEPTH - 1U)) == 0U,
+               "Diag RX ring depth must be a power of 2");
+
+/* Index hand-off: the slot is written before the index that publishes
+ * it (release) and read after the index that exposes it (acquire) */
+#if defined(__GNUC__)
+  #define RXQ_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define RXQ_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  #define RXQ_LOAD(p)       (*(p))
+  #define RXQ_STORE(p, v)   (*(p) = (v))
+#endif
+
+typedef struct {
+    bms_can_frame_t frame;
+    uint32_t        rx_ms;
+} rxq_slot_t;
+
+static rxq_slot_t        s_slot[BMS_CAN_RX_DEPTH];
+static volatile uint8_t  s_head;     /* ISR */
+static volatile uint8_t  s_tail;     /* task */
+static volatile bool     s_urgent;
+static bms_can_rx_hook_t s_hook;
+static bms_can_rx_stats_t s_stats;
+
+/* ISO-TP requests/flow control bypass the command merge */
+static bms_can_frame_t   s_diag[BMS_CAN_DIAG_RX_DEPTH];
+static volatile uint8_t  s_diag_head;
+static volatile uint8_t  s_diag_tail;
+
+void bms_can_rx_init(void)
+{
+    memset(s_slot, 0, sizeof(s_slot));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_head = 0U;
+    s_tail = 0U;
+    s_urgent = false;
+    s_diag_head = 0U;
+    s_diag_tail = 0U;
+}
+
+void bms_can_rx_set_urgent_hook(bms_can_rx_hook_t hook)
+{
+    s_hook = hook;
+}
+
+static bool is_urgent(const bms_can_frame_t *frame)
+{
+    return frame->id == CAN_ID_EMS_COMMAND && frame->dlc >= 1U &&
+           (frame->data[0] == (uint8_t)EMS_CMD_DISCONNECT ||
+            frame->data[0] == (uint8_t)EMS_CMD_POWER_SAVE);
+}
+
+void bms_can_rx_isr(const bms_can_frame_t *frame)
+{
+    uint8_t head = s_head;
+    uint8_t depth = (uint8_t)(head - RXQ_LOAD(&s_tail));
+
+    s_stats.isr_frames++;
+    if (frame->id == CAN_ID_DIAG_REQ) {
+        uint8_t dh = s_diag_head;
+        if ((uint8_t)(dh - RXQ_LOAD(&s_diag_tail)) >= BMS_CAN_DIAG_RX_DEPTH) {
+            s_stats.overflow++;
+            return;
+        }
+        s_diag[dh & (uint8_t)(BMS_CAN_DIAG_RX_DEPTH - 1U)] = *frame;
+        RXQ_STORE(&s_diag_head, (uint8_t)(dh + 1U));
+        return;
+    }
+    if (frame->id != CAN_ID_EMS_COMMAND && frame->id != CAN_ID_EMS_HEARTBEAT) {
+        s_stats.filtered++;
+        return;
+    }
+    if (depth >= BMS_CAN_RX_DEPTH) {
+        s_stats.overflow++;
+        return;
+    }
+
+    s_slot[head & RXQ_MASK].frame = *frame;
+    s_slot[head & RXQ_MASK].rx_ms = hal_tick_ms();
+    RXQ_STORE(&s_head, (uint8_t)(head + 1U));
+
+    depth++;
+    if (depth > s_stats.ring_hwm) { s_stats.ring_hwm = depth; }
+
+    if (is_urgent(frame)) {
+        s_stats.urgent++;
+        RXQ_STORE(&s_urgent, true);
+        if (s_hook != NULL) { s_hook(); }
+    }
+}
+
+bool bms_can_rx_urgent_pending(void)
+{
+    return RXQ_LOAD(&s_urgent);
+}
+
+static uint8_t cmd_rank(bms_ems_cmd_type_t type)
+{
+    switch (type) {
+    case EMS_CMD_DISCONNECT: return 4U;
+    case EMS_CMD_POWER_SAVE: return 3U;
+    case EMS_CMD_NONE:       return 1U;   /* heartbeat */
+    default:                 return 2U;
+    }
+}
+
+bool bms_can_rx_drain(bms_ems_command_t *cmd)
+{
+    bms_ems_command_t best;
+    bms_ems_command_t cur;
+    bool have = false;
+
+    RXQ_STORE(&s_urgent, false);
+    memset(&best, 0, sizeof(best));
+
+    while (s_tail != RXQ_LOAD(&s_head)) {
+        const rxq_slot_t *s;
+        s = &s_slot[s_tail & RXQ_MASK];
+
+        memset(&cur, 0, sizeof(cur));
+        /* CC-01: Auth check on all received frames */
+        if (BMS_CAN_AUTH_ENABLED && !bms_can_auth_verify(&s->frame)) {
+            BMS_LOG("CC-01: Frame 0x%03X rejected — auth failed", s->frame.id);
+            s_stats.auth_reject++;
+        } else if (s->frame.id == CAN_ID_EMS_COMMAND) {
+            if (bms_can_decode_ems_command(&s->frame, &cur) == 0) {
+                s_stats.commands++;
+            } else {
+                s_stats.decode_reject++;
+            }
+        } else {
+            cur.type = EMS_CMD_NONE;
+            cur.valid = true;
+            s_stats.heartbeats++;
+        }
+        cur.timestamp_ms = s->rx_ms;
+
+        if (cur.valid) {
+            if (!have || cmd_rank(cur.type) >= cmd_rank(best.type)) {
+                if (have && best.type != EMS_CMD_NONE) { s_stats.superseded++; }
+                best = cur;
+                have = true;
+            } else if (cur.type != EMS_CMD_NONE) {
+                s_stats.superseded++;
+            }
+        }
+
+        RXQ_STORE(&s_tail, (uint8_t)(s_tail + 1U));
+    }
+
+    if (have) {
+        *cmd = best;
+    } else {
+        cmd->valid = false;
+    }
+    return have;
+}
+
+void bms_can_rx_note_handled(const bms_ems_command_t *cmd)
+{
+    uint32_t lat;
+
+    if (!cmd->valid || cmd->type == EMS_CMD_NONE) { return; }
+    lat = hal_tick_ms() - cmd->timestamp_ms;
+    if (lat > 0xFFFFU) { lat = 0xFFFFU; }
+
+    s_stats.cmd_latency_last_ms = (uint16_t)lat;
+    if (lat > s_stats.cmd_latency_max_ms) { s_stats.cmd_latency_max_ms = (uint16_t)lat; }
+    s_stats.cmd_latency_sum_ms += lat;
+    s_stats.cmd_latency_count++;
+}
+
+bool bms_can_rx_diag_pop(bms_can_frame_t *frame)
+{
+    uint8_t dt = s_diag_tail;
+
+    if (dt == RXQ_LOAD(&s_diag_head)) { return false; }
+    *frame = s_diag[dt & (uint8_t)(BMS_CAN_DIAG_RX_DEPTH - 1U)];
+    RXQ_STORE(&s_diag_tail, (uint8_t)(dt + 1U));
+    return true;
+}
+
+uint8_t bms_can_rx_pending(void)
+{
+    return (uint8_t)(RXQ_LOAD(&s_head) - RXQ_LOAD(&s_tail));
+}
+
+void bms_can_rx_get_stats(bms_can_rx_stats_t *out)
+{
+    *out = s_stats;
+}
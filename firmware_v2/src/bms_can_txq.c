@@ -0,0 +1,172 @@
+/**
+ * @file bms_can_txq.c
+ * @brief Prioritised CAN TX queue — ISR-drained, bus-load budgeted
+ *
+ * Street Smart Edition.
+ * Ring indices are free-running uint8_t; depth = head - tail (mod 256).
+ * The producer owns head, the consumer owns tail; each publishes its
+ * index only after the slot access is complete (barrier before store).
+ *
+ * Budget: tokens are on-wire bits. Refilled from hal_tick_ms() at
+ * BMS_CAN_BITRATE_BPS × BMS_CAN_BUS_LOAD_PCT, capped at
+ * BMS_CAN_TXQ_BURST_MS worth. A frame that does not fit stays queued
+ * until the next kick; ALARM frames go regardless and may overdraw.
+ */
+
+#include "bms_can_txq.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+#define TXQ_MASK         ((uint8_t)(BMS_CAN_TXQ_DEPTH - 1U))
+#define TXQ_BITS_PER_MS  ((int32_t)((BMS_CAN_BITRATE_BPS / 1000U) * BMS_CAN_BUS_LOAD_PCT / 100U))
+#define TXQ_BURST_BITS   (TXQ_BITS_PER_MS * (int32_t)BMS_CAN_TXQ_BURST_MS)
+
+_Static_assert((BMS_CAN_TXQ_DEPTH & (BMS_CAN_TXQ_DEPTH - 1U)) == 0U,
+               "TX queue depth must be a power of 2");
+_Static_assert(BMS_CAN_TXQ_DEPTH <= 128U, "uint8_t ring indices");
+_Static_assert(BMS_CAN_BUS_LOAD_PCT >= 1U && BMS_CAN_BUS_LOAD_PCT <= 100U,
+               "Bus load budget out of range");
+_Static_assert(((BMS_CAN_BITRATE_BPS / 1000U) * BMS_CAN_BUS_LOAD_PCT / 100U) >= 1U,
+               "Budget below one bit per ms");
+
+/* Index hand-off: acquire/release, a DMB each on Cortex-M */
+#if defined(__GNUC__)
+  #define TXQ_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define TXQ_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  #define TXQ_LOAD(p)       (*(p))
+  #define TXQ_STORE(p, v)   (*(p) = (v))
+#endif
+
+typedef struct {
+    bms_can_frame_t frame;
+    uint32_t        enq_ms;
+} txq_slot_t;
+
+typedef struct {
+    txq_slot_t       slot[BMS_CAN_TXQ_DEPTH];
+    volatile uint8_t head;     /* producer */
+    volatile uint8_t tail;     /* consumer */
+} txq_ring_t;
+
+static txq_ring_t s_ring[BMS_CAN_PRIO_COUNT];
+static bms_can_txq_stats_t s_stats;
+static int32_t  s_tokens;
+static uint32_t s_refill_ms;
+
+uint16_t bms_can_frame_bits(uint8_t dlc)
+{
+    /* SOF..EOF = 44 + 8·dlc; worst-case stuffing over the 34 + 8·dlc
+     * stuffable bits; 3-bit intermission */
+    uint16_t n = (uint16_t)(8U * ((dlc > 8U) ? 8U : dlc));
+    return (uint16_t)(44U + n + (34U + n - 1U) / 4U + 3U);
+}
+
+void bms_can_txq_init(void)
+{
+    memset(s_ring, 0, sizeof(s_ring));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_tokens = TXQ_BURST_BITS;
+    s_refill_ms = hal_tick_ms();
+}
+
+int32_t bms_can_txq_send(const bms_can_frame_t *frame, bms_can_prio_t prio)
+{
+    txq_ring_t *r;
+    uint8_t head, depth;
+
+    if ((uint32_t)prio >= (uint32_t)BMS_CAN_PRIO_COUNT) { return -1; }
+    r = &s_ring[prio];
+    head = r->head;
+    depth = (uint8_t)(head - TXQ_LOAD(&r->tail));
+
+    s_stats.enqueued[prio]++;
+    if (depth >= BMS_CAN_TXQ_DEPTH) {
+        s_stats.dropped[prio]++;
+        return -1;
+    }
+
+    r->slot[head & TXQ_MASK].frame = *frame;
+    r->slot[head & TXQ_MASK].enq_ms = hal_tick_ms();
+    TXQ_STORE(&r->head, (uint8_t)(head + 1U));
+
+    depth++;
+    if (depth > s_stats.depth_hwm[prio]) { s_stats.depth_hwm[prio] = depth; }
+    return 0;
+}
+
+static void refill(void)
+{
+    uint32_t now = hal_tick_ms();
+    uint32_t elapsed = now - s_refill_ms;
+
+    s_refill_ms = now;
+    if (elapsed > BMS_CAN_TXQ_BURST_MS) { elapsed = BMS_CAN_TXQ_BURST_MS; }
+    s_tokens += (int32_t)elapsed * TXQ_BITS_PER_MS;
+    if (s_tokens > TXQ_BURST_BITS) { s_tokens = TXQ_BURST_BITS; }
+}
+
+/* Consumer: move frames into free mailboxes, highest class first. */
+static void drain(void)
+{
+    refill();
+
+    while (hal_can_tx_free_mailboxes() > 0U) {
+        txq_ring_t *r = NULL;
+        const txq_slot_t *s;
+        uint32_t lat;
+        uint16_t bits;
+        uint8_t p;
+
+        for (p = 0U; p < (uint8_t)BMS_CAN_PRIO_COUNT; p++) {
+            if (TXQ_LOAD(&s_ring[p].head) != s_ring[p].tail) { r = &s_ring[p]; break; }
+        }
+        if (r == NULL) { break; }
+
+        s = &r->slot[r->tail & TXQ_MASK];
+        bits = bms_can_frame_bits(s->frame.dlc);
+        if (p != (uint8_t)BMS_CAN_PRIO_ALARM && s_tokens < (int32_t)bits) {
+            s_stats.budget_deferrals++;
+            break;
+        }
+        if (hal_can_transmit(&s->frame) != 0) {
+            s_stats.mailbox_full++;
+            break;
+        }
+
+        s_tokens -= (int32_t)bits;
+        if (s_tokens < -TXQ_BURST_BITS) { s_tokens = -TXQ_BURST_BITS; }
+        lat = hal_tick_ms() - s->enq_ms;
+        if (lat > 0xFFFFU) { lat = 0xFFFFU; }
+        s_stats.sent[p]++;
+        s_stats.bits_sent += bits;
+        s_stats.latency_sum_ms[p] += lat;
+        if (lat > s_stats.latency_max_ms[p]) { s_stats.latency_max_ms[p] = (uint16_t)lat; }
+
+        TXQ_STORE(&r->tail, (uint8_t)(r->tail + 1U));
+    }
+}
+
+void bms_can_txq_isr(void)
+{
+    drain();
+}
+
+void bms_can_txq_kick(void)
+{
+    hal_can_tx_irq_enable(false);
+    drain();
+    hal_can_tx_irq_enable(true);
+}
+
+uint8_t bms_can_txq_pending(bms_can_prio_t prio)
+{
+    if ((uint32_t)prio >= (uint32_t)BMS_CAN_PRIO_COUNT) { return 0U; }
+    return (uint8_t)(TXQ_LOAD(&s_ring[prio].head) - TXQ_LOAD(&s_ring[prio].tail));
+}
+
+void bms_can_txq_get_stats(bms_can_txq_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -0,0 +1,312 @@
+/**
+ * @file bms_canfd.c
+ * @brief CAN FD cell-voltage streaming — delta-encoded 64-byte frames
+ *
+ * Street Smart Edition.
+ * Adjacent SEs in a module sit within a few mV of each other, so most
+ * zigzag deltas fit one varint byte: a 64-byte FULL frame typically
+ * carries ~58 cells (worst case 20), against 4 cells per classic frame.
+ * The PRIORITY frame spends the remaining bandwidth on what the EMS most
+ * needs to see now: the pack extremes and the biggest movers.
+ * With BMS_CAN_AUTH_ENABLED the last 12 bytes of each frame carry the
+ * CMAC trailer (bms_can_auth.h), so payloads stop at 48 bytes.
+ */
+
+#include "bms_canfd.h"
+#include "bms_can_auth.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+_Static_assert(BMS_SE_PER_PACK <= 0xFFFFU, "FULL start index is 16-bit");
+_Static_assert(BMS_CANFD_CELLS_PER_CALL >= 1U, "Refresh must advance each call");
+_Static_assert(BMS_CANFD_FULL_REFRESH_MS >= BMS_CAN_TX_PERIOD_MS,
+               "Refresh window shorter than the TX period");
+
+#define CANFD_PAYLOAD_MAX \
+    (BMS_CAN_AUTH_ENABLED ? BMS_CANFD_AUTH_PAYLOAD_MAX : BMS_CANFD_MAX_LEN)
+
+static uint16_t s_last_sent_mv[BMS_SE_PER_PACK];   /* EMS view of each cell */
+static uint16_t s_full_cursor;
+static uint8_t  s_seq;
+
+/* ── Varint helpers ────────────────────────────────────────────────── */
+
+static uint32_t zigzag(int32_t d)
+{
+    return (d >= 0) ? ((uint32_t)d << 1U) : ((((uint32_t)(-(d + 1))) << 1U) | 1U);
+}
+
+static int32_t unzigzag(uint32_t z)
+{
+    return ((z & 1U) != 0U) ? -(int32_t)(z >> 1U) - 1 : (int32_t)(z >> 1U);
+}
+
+/* Append LEB128 varint; returns new position, 0 if it would overflow. */
+static uint8_t put_varint(uint8_t *buf, uint8_t pos, uint32_t val)
+{
+    do {
+        uint8_t b = (uint8_t)(val & 0x7FU);
+        val >>= 7U;
+        if (pos >= CANFD_PAYLOAD_MAX) { return 0U; }
+        buf[pos++] = (val != 0U) ? (uint8_t)(b | 0x80U) : b;
+    } while (val != 0U);
+    return pos;
+}
+
+/* Read varint (≤ 3 bytes — enough for 16-bit values); 0 on malformed. */
+static uint8_t get_varint(const uint8_t *buf, uint8_t pos, uint8_t len,
+                          uint32_t *val)
+{
+    uint32_t v = 0U;
+    uint8_t shift = 0U;
+
+    while (pos < len && shift < 21U) {
+        uint8_t b = buf[pos++];
+        v |= (uint32_t)(b & 0x7FU) << shift;
+        if ((b & 0x80U) == 0U) { *val = v; return pos; }
+        shift = (uint8_t)(shift + 7U);
+    }
+    return 0U;
+}
+
+static void pack_u16_be(uint8_t *buf, uint16_t val)
+{
+    buf[0] = (uint8_t)((val >> 8U) & 0xFFU);
+    buf[1] = (uint8_t)(val & 0xFFU);
+}
+
+static uint16_t unpack_u16_be(const uint8_t *buf)
+{
+    return (uint16_t)((uint16_t)((uint16_t)buf[0] << 8U) | (uint16_t)buf[1]);
+}
+
+uint8_t bms_canfd_len_round(uint8_t len)
+{
+    static const uint8_t k_fd_len[] = { 8U, 12U, 16U, 20U, 24U, 32U, 48U, 64U };
+    uint8_t i;
+
+    for (i = 0U; i < (uint8_t)sizeof(k_fd_len); i++) {
+        if (len <= k_fd_len[i]) { return (len <= 8U) ? len : k_fd_len[i]; }
+    }
+    return BMS_CANFD_MAX_LEN;
+}
+
+/* ── Encoders ──────────────────────────────────────────────────────── */
+
+uint16_t bms_canfd_encode_full(const uint16_t *cell_mv, uint16_t start_idx,
+                               uint8_t seq, bms_canfd_frame_t *frame)
+{
+    uint8_t pos = BMS_CANFD_HDR_LEN;
+    uint16_t count = 0U;
+    uint16_t i;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_CELL_FD_FULL;
+    if (start_idx >= BMS_SE_PER_PACK) { return 0U; }
+
+    frame->data[0] = BMS_CANFD_TYPE_FULL;
+    frame->data[1] = seq;
+    pack_u16_be(&frame->data[2], start_idx);
+    pack_u16_be(&frame->data[5], cell_mv[start_idx]);
+    count = 1U;
+
+    for (i = (uint16_t)(start_idx + 1U); i < BMS_SE_PER_PACK && count < 0xFFU; i++) {
+        int32_t d = (int32_t)cell_mv[i] - (int32_t)cell_mv[i - 1U];
+        uint8_t next = put_varint(frame->data, pos, zigzag(d));
+        if (next == 0U) { break; }
+        pos = next;
+        count++;
+    }
+
+    frame->data[4] = (uint8_t)count;
+    frame->len = bms_canfd_len_round(pos);
+    return count;
+}
+
+/* Encode the first n of idx[] (sorted by index on the wire); 0 if too big. */
+static uint8_t encode_priority_n(const uint16_t *cell_mv, const uint16_t *idx,
+                                 uint8_t n, uint8_t seq, bms_canfd_frame_t *frame)
+{
+    uint16_t sorted[BMS_CANFD_PRIO_MAX];
+    uint8_t pos = BMS_CANFD_HDR_LEN;
+    uint8_t i, j;
+
+    /* Insertion sort — n ≤ 24 */
+    for (i = 0U; i < n; i++) {
+        uint16_t v = idx[i];
+        j = i;
+        while (j > 0U && sorted[j - 1U] > v) { sorted[j] = sorted[j - 1U]; j--; }
+        sorted[j] = v;
+    }
+
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_CELL_FD_PRIO;
+    frame->data[0] = BMS_CANFD_TYPE_PRIORITY;
+    frame->data[1] = seq;
+    frame->data[2] = n;
+    pack_u16_be(&frame->data[3], sorted[0]);
+    pack_u16_be(&frame->data[5], cell_mv[sorted[0]]);
+
+    for (i = 1U; i < n; i++) {
+        int32_t d = (int32_t)cell_mv[sorted[i]] - (int32_t)cell_mv[sorted[i - 1U]];
+        pos = put_varint(frame->data, pos, (uint32_t)(sorted[i] - sorted[i - 1U]));
+        if (pos == 0U) { return 0U; }
+        pos = put_varint(frame->data, pos, zigzag(d));
+        if (pos == 0U) { return 0U; }
+    }
+    return pos;
+}
+
+uint8_t bms_canfd_encode_priority(const uint16_t *cell_mv, const uint16_t *idx,
+                                  uint8_t n, uint8_t seq,
+                                  bms_canfd_frame_t *frame)
+{
+    if (n > BMS_CANFD_PRIO_MAX) { n = BMS_CANFD_PRIO_MAX; }
+
+    /* Drop lowest-priority entries (tail of idx[]) until it fits */
+    while (n > 0U) {
+        uint8_t len = encode_priority_n(cell_mv, idx, n, seq, frame);
+        if (len != 0U) {
+            frame->len = bms_canfd_len_round(len);
+            return n;
+        }
+        n--;
+    }
+    memset(frame, 0, sizeof(*frame));
+    return 0U;
+}
+
+/* ── Decoder (EMS side / test harness) ─────────────────────────────── */
+
+int32_t bms_canfd_decode_cells(const bms_canfd_frame_t *frame, uint16_t *cell_mv)
+{
+    const uint8_t *b = frame->data;
+    uint8_t len = frame->len;
+    uint8_t pos = BMS_CANFD_HDR_LEN;
+    uint16_t idx, count, k;
+    int32_t mv;
+
+    if (len < BMS_CANFD_HDR_LEN || len > BMS_CANFD_MAX_LEN) { return -1; }
+
+    if (b[0] == BMS_CANFD_TYPE_FULL) {
+        idx = unpack_u16_be(&b[2]);
+        count = b[4];
+        mv = (int32_t)unpack_u16_be(&b[5]);
+        if (count == 0U || (uint32_t)idx + count > BMS_SE_PER_PACK) { return -1; }
+        cell_mv[idx] = (uint16_t)mv;
+        for (k = 1U; k < count; k++) {
+            uint32_t z;
+            pos = get_varint(b, pos, len, &z);
+            if (pos == 0U) { return -1; }
+            mv += unzigzag(z);
+            if (mv < 0 || mv > 0xFFFF) { return -1; }
+            cell_mv[idx + k] = (uint16_t)mv;
+        }
+        return (int32_t)count;
+    }
+
+    if (b[0] == BMS_CANFD_TYPE_PRIORITY) {
+        count = b[2];
+        idx = unpack_u16_be(&b[3]);
+        mv = (int32_t)unpack_u16_be(&b[5]);
+        if (count == 0U || idx >= BMS_SE_PER_PACK) { return -1; }
+        cell_mv[idx] = (uint16_t)mv;
+        for (k = 1U; k < count; k++) {
+            uint32_t gap, z;
+            pos = get_varint(b, pos, len, &gap);
+            if (pos == 0U) { return -1; }
+            pos = get_varint(b, pos, len, &z);
+            if (pos == 0U) { return -1; }
+            if (gap == 0U || (uint32_t)idx + gap >= BMS_SE_PER_PACK) { return -1; }
+            idx = (uint16_t)(idx + gap);
+            mv += unzigzag(z);
+            if (mv < 0 || mv > 0xFFFF) { return -1; }
+            cell_mv[idx] = (uint16_t)mv;
+        }
+        return (int32_t)count;
+    }
+
+    return -1;
+}
+
+/* ── Scheduler ─────────────────────────────────────────────────────── */
+
+void bms_canfd_init(void)
+{
+    memset(s_last_sent_mv, 0, sizeof(s_last_sent_mv));
+    s_full_cursor = 0U;
+    s_seq = 0U;
+}
+
+/* Extremes first, then the largest |mV − last sent| above the deadband. */
+static uint8_t select_priority(const uint16_t *cell_mv, uint16_t *idx)
+{
+    uint16_t delta[BMS_CANFD_PRIO_MAX];
+    uint16_t i_max = 0U, i_min = 0xFFFFU;
+    uint8_t n = 0U, fixed, j;
+    uint16_t i;
+
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        if (cell_mv[i] > cell_mv[i_max]) { i_max = i; }
+        if (cell_mv[i] != 0U && (i_min == 0xFFFFU || cell_mv[i] < cell_mv[i_min])) {
+            i_min = i;
+        }
+    }
+    idx[n++] = i_max;
+    if (i_min != 0xFFFFU && i_min != i_max) { idx[n++] = i_min; }
+    fixed = n;
+
+    /* Top-K by delta: descending insertion into idx[fixed..] */
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        uint16_t d = (cell_mv[i] > s_last_sent_mv[i])
+                   ? (uint16_t)(cell_mv[i] - s_last_sent_mv[i])
+                   : (uint16_t)(s_last_sent_mv[i] - cell_mv[i]);
+        if (d < BMS_CANFD_PRIO_MIN_DELTA_MV || i == i_max || i == i_min) { continue; }
+        if (n == BMS_CANFD_PRIO_MAX && d <= delta[n - 1U]) { continue; }
+        j = (n < BMS_CANFD_PRIO_MAX) ? n++ : (uint8_t)(n - 1U);
+        while (j > fixed && delta[j - 1U] < d) {
+            idx[j] = idx[j - 1U];
+            delta[j] = delta[j - 1U];
+            j--;
+        }
+        idx[j] = i;
+        delta[j] = d;
+    }
+    return n;
+}
+
+uint8_t bms_canfd_tx_cells(const bms_pack_data_t *pack)
+{
+    bms_canfd_frame_t frame;
+    uint16_t idx[BMS_CANFD_PRIO_MAX];
+    uint16_t swept = 0U;
+    uint8_t sent = 0U;
+    uint8_t n, k;
+
+    /* Priority frame */
+    n = select_priority(pack->cell_mv, idx);
+    n = bms_canfd_encode_priority(pack->cell_mv, idx, n, s_seq, &frame);
+    if (n > 0U) {
+        if (BMS_CAN_AUTH_ENABLED) { (void)bms_can_auth_sign_fd(&frame); }
+        if (hal_canfd_transmit(&frame) < 0) { return 0U; }
+        s_seq++;
+        sent++;
+        for (k = 0U; k < n; k++) { s_last_sent_mv[idx[k]] = pack->cell_mv[idx[k]]; }
+    }
+
+    /* Full sweep: ≥ CELLS_PER_CALL cells → whole pack within refresh window */
+    while (swept < BMS_CANFD_CELLS_PER_CALL) {
+        uint16_t c = bms_canfd_encode_full(pack->cell_mv, s_full_cursor, s_seq, &frame);
+        if (BMS_CAN_AUTH_ENABLED) { (void)bms_can_auth_sign_fd(&frame); }
+        if (hal_canfd_transmit(&frame) < 0) { break; }
+        s_seq++;
+        sent++;
+        memcpy(&s_last_sent_mv[s_full_cursor], &pack->cell_mv[s_full_cursor],
+               (size_t)c * sizeof(uint16_t));
+        swept = (uint16_t)(swept + c);
+        s_full_cursor = (uint16_t)(s_full_cursor + c);
+        if (s_full_cursor >= BMS_SE_PER_PACK) { s_full_cursor = 0U; }
+    }
+    return sent;
+}
@@ -0,0 +1,226 @@
+/**
+ * @file bms_cell_scan.c
+ * @brief Packed 16-bit cell threshold scans → per-module exceedance masks
+ *
+ * Street Smart Edition.
+ * Kernel selection (compile time):
+ *   __ARM_FEATURE_SIMD32  Cortex-M4 DSP: USUB16 sets APSR.GE per halfword
+ *                         (CMSIS __USUB16), SEL turns GE into lane masks
+ *                         (CMSIS __SEL). One module = 7 packed words.
+ *   __SSE2__              Desktop: unsigned saturating subtract + compare,
+ *                         16 cells per iteration via PACKSSWB/PMOVMSKB.
+ *   otherwise             Portable scalar loop (same as the _ref variants).
+ *
+ * Unsigned compares are expressed as saturating subtraction so both SIMD
+ * paths avoid the signed-only compare instructions:
+ *   v >= t  ⇔  sat(t - v) == 0        v <= t  ⇔  sat(v - t) == 0
+ */
+
+#include "bms_cell_scan.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_SIMD32) && !defined(BMS_CELL_SCAN_PORTABLE)
+  #include <arm_acle.h>
+  #define CELL_SCAN_M4
+#elif defined(__SSE2__) && !defined(BMS_CELL_SCAN_PORTABLE)
+  #include <emmintrin.h>
+  #define CELL_SCAN_SSE2
+#endif
+
+#define MODULE_MASK  ((uint16_t)((1UL << BMS_SE_PER_MODULE) - 1UL))
+
+/* ── Portable reference ────────────────────────────────────────────── */
+
+bool bms_cell_scan_ge_ref(const uint16_t *cell_mv, uint16_t thresh_mv,
+                          bms_cell_mask_t *out)
+{
+    uint8_t mod, cell;
+    uint16_t any = 0U;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        const uint16_t *p = &cell_mv[(uint16_t)mod * BMS_SE_PER_MODULE];
+        uint16_t bits = 0U;
+        for (cell = 0U; cell < BMS_SE_PER_MODULE; cell++) {
+            if (p[cell] >= thresh_mv) { bits |= (uint16_t)(1U << cell); }
+        }
+        out->mask[mod] = bits;
+        any |= bits;
+    }
+    return any != 0U;
+}
+
+bool bms_cell_scan_le_nz_ref(const uint16_t *cell_mv, uint16_t thresh_mv,
+                             bms_cell_mask_t *out)
+{
+    uint8_t mod, cell;
+    uint16_t any = 0U;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        const uint16_t *p = &cell_mv[(uint16_t)mod * BMS_SE_PER_MODULE];
+        uint16_t bits = 0U;
+        for (cell = 0U; cell < BMS_SE_PER_MODULE; cell++) {
+            if (p[cell] > 0U && p[cell] <= thresh_mv) {
+                bits |= (uint16_t)(1U << cell);
+            }
+        }
+        out->mask[mod] = bits;
+        any |= bits;
+    }
+    return any != 0U;
+}
+
+#if defined(CELL_SCAN_M4)
+
+/* ── Cortex-M4 DSP kernel ──────────────────────────────────────────── */
+
+/* Lane masks from SEL are 0x0000/0xFFFF per halfword; fold to 2 bits. */
+static uint32_t lanes_to_bits(uint32_t sel)
+{
+    return (sel & 1U) | ((sel >> 15U) & 2U);
+}
+
+bool bms_cell_scan_ge(const uint16_t *cell_mv, uint16_t thresh_mv,
+                      bms_cell_mask_t *out)
+{
+    const uint32_t t2 = (uint32_t)thresh_mv * 0x00010001U;
+    uint8_t mod, k;
+    uint16_t any = 0U;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        const uint16_t *p = &cell_mv[(uint16_t)mod * BMS_SE_PER_MODULE];
+        uint32_t bits = 0U;
+        for (k = 0U; k < (BMS_SE_PER_MODULE / 2U); k++) {
+            uint32_t w;
+            memcpy(&w, &p[2U * k], sizeof(w));
+            (void)__usub16(w, t2);            /* GE[n] = (v[n] >= t) */
+            bits |= lanes_to_bits(__sel(0xFFFFFFFFU, 0U)) << (2U * k);
+        }
+        out->mask[mod] = (uint16_t)bits;
+        any |= (uint16_t)bits;
+    }
+    return any != 0U;
+}
+
+bool bms_cell_scan_le_nz(const uint16_t *cell_mv, uint16_t thresh_mv,
+                         bms_cell_mask_t *out)
+{
+    const uint32_t t2 = (uint32_t)thresh_mv * 0x00010001U;
+    uint8_t mod, k;
+    uint16_t any = 0U;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        const uint16_t *p = &cell_mv[(uint16_t)mod * BMS_SE_PER_MODULE];
+        uint32_t bits = 0U;
+        for (k = 0U; k < (BMS_SE_PER_MODULE / 2U); k++) {
+            uint32_t w, le;
+            memcpy(&w, &p[2U * k], sizeof(w));
+            (void)__usub16(t2, w);            /* GE[n] = (t >= v[n]) */
+            le = __sel(0xFFFFFFFFU, 0U);
+            (void)__usub16(w, 0x00010001U);   /* GE[n] = (v[n] != 0) */
+            bits |= lanes_to_bits(__sel(le, 0U)) << (2U * k);
+        }
+        out->mask[mod] = (uint16_t)bits;
+        any |= (uint16_t)bits;
+    }
+    return any != 0U;
+}
+
+const char *bms_cell_scan_impl(void) { return "m4-dsp"; }
+
+#elif defined(CELL_SCAN_SSE2)
+
+/* ── SSE2 kernel ───────────────────────────────────────────────────── */
+
+#define FLAT_WORDS  ((BMS_SE_PER_PACK + 31U) / 32U + 1U)
+
+/* Split a flat 308-bit map into 22 × 14-bit module masks. */
+static bool flat_to_modules(const uint32_t *flat, bms_cell_mask_t *out)
+{
+    uint8_t mod;
+    uint16_t any = 0U;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        uint32_t bit = (uint32_t)mod * BMS_SE_PER_MODULE;
+        uint32_t w = bit >> 5U;
+        uint32_t sh = bit & 31U;
+        uint32_t v = flat[w] >> sh;
+        if (sh + BMS_SE_PER_MODULE > 32U) {
+            v |= flat[w + 1U] << (32U - sh);
+        }
+        out->mask[mod] = (uint16_t)(v & MODULE_MASK);
+        any |= out->mask[mod];
+    }
+    return any != 0U;
+}
+
+bool bms_cell_scan_ge(const uint16_t *cell_mv, uint16_t thresh_mv,
+                      bms_cell_mask_t *out)
+{
+    uint32_t flat[FLAT_WORDS];
+    const __m128i t = _mm_set1_epi16((short)thresh_mv);
+    const __m128i zero = _mm_setzero_si128();
+    uint16_t i;
+
+    memset(flat, 0, sizeof(flat));
+    for (i = 0U; (uint16_t)(i + 16U) <= BMS_SE_PER_PACK; i += 16U) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(const void *)&cell_mv[i]);
+        __m128i b = _mm_loadu_si128((const __m128i *)(const void *)&cell_mv[i + 8U]);
+        __m128i ra = _mm_cmpeq_epi16(_mm_subs_epu16(t, a), zero);
+        __m128i rb = _mm_cmpeq_epi16(_mm_subs_epu16(t, b), zero);
+        uint32_t bits = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(ra, rb));
+        flat[i >> 5U] |= bits << (i & 31U);
+    }
+    for (; i < BMS_SE_PER_PACK; i++) {
+        if (cell_mv[i] >= thresh_mv) { flat[i >> 5U] |= 1UL << (i & 31U); }
+    }
+    return flat_to_modules(flat, out);
+}
+
+bool bms_cell_scan_le_nz(const uint16_t *cell_mv, uint16_t thresh_mv,
+                         bms_cell_mask_t *out)
+{
+    uint32_t flat[FLAT_WORDS];
+    const __m128i t = _mm_set1_epi16((short)thresh_mv);
+    const __m128i zero = _mm_setzero_si128();
+    uint16_t i;
+
+    memset(flat, 0, sizeof(flat));
+    for (i = 0U; (uint16_t)(i + 16U) <= BMS_SE_PER_PACK; i += 16U) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(const void *)&cell_mv[i]);
+        __m128i b = _mm_loadu_si128((const __m128i *)(const void *)&cell_mv[i + 8U]);
+        __m128i ra = _mm_andnot_si128(_mm_cmpeq_epi16(a, zero),
+                                      _mm_cmpeq_epi16(_mm_subs_epu16(a, t), zero));
+        __m128i rb = _mm_andnot_si128(_mm_cmpeq_epi16(b, zero),
+                                      _mm_cmpeq_epi16(_mm_subs_epu16(b, t), zero));
+        uint32_t bits = (uint32_t)_mm_movemask_epi8(_mm_packs_epi16(ra, rb));
+        flat[i >> 5U] |= bits << (i & 31U);
+    }
+    for (; i < BMS_SE_PER_PACK; i++) {
+        if (cell_mv[i] > 0U && cell_mv[i] <= thresh_mv) {
+            flat[i >> 5U] |= 1UL << (i & 31U);
+        }
+    }
+    return flat_to_modules(flat, out);
+}
+
+const char *bms_cell_scan_impl(void) { return "sse2"; }
+
+#else
+
+/* ── Portable fallback ─────────────────────────────────────────────── */
+
+bool bms_cell_scan_ge(const uint16_t *cell_mv, uint16_t thresh_mv,
+                      bms_cell_mask_t *out)
+{
+    return bms_cell_scan_ge_ref(cell_mv, thresh_mv, out);
+}
+
+bool bms_cell_scan_le_nz(const uint16_t *cell_mv, uint16_t thresh_mv,
+                         bms_cell_mask_t *out)
+{
+    return bms_cell_scan_le_nz_ref(cell_mv, thresh_mv, out);
+}
+
+const char *bms_cell_scan_impl(void) { return "portable"; }
+
+#endif
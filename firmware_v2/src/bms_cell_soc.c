@@ -0,0 +1,241 @@
+/**
+ * @file bms_cell_soc.c
+ * @brief Per-SE SoC and relative capacity, tracked against the pack EKF
+ *
+ * Street Smart Edition.
+ * Units (see bms_cell_soc.h): dsoc Q24 SoC, icap Q14, module charge Q20
+ * SoC, P in ppm², voltages in µV, dOCV/dSoC in Q16 µV/ppm. The per-cell
+ * loops stay in int32 — every bound is noted where the product is formed —
+ * so they map onto 32-bit SIMD lanes; int64 is confined to the per-module
+ * scalars and the once-per-window capacity fold.
+ */
+
+#include "bms_cell_soc.h"
+#include "bms_soc.h"
+#include "bms_config.h"
+
+#define ICAP_ONE         16384
+#define DSOC_MAX         (1L << 22)     /* ±25 % from the pack */
+#define DQ_MAX           (1L << 17)     /* ±12.5 % per scan (Q20) */
+#define Q24_PER_HUNDREDTH_DEN  10000
+#define P_MAX            4000000000U    /* (6.3 %)² */
+#define MOD_DT_MAX_MS    60000U
+#define CAP_WINDOW_Q20   ((uint32_t)(((uint64_t)BMS_CELL_SOC_CAP_WINDOW << 20) / 10000U))
+
+_Static_assert(BMS_NUM_MODULES <= 32U, "Module bitmaps are uint32_t");
+
+/* Per SE, contiguous per module */
+static int32_t  s_dsoc[BMS_SE_PER_PACK];        /* Q24 */
+static uint16_t s_icap[BMS_SE_PER_PACK];        /* Q14, C_nom / C_i */
+static int32_t  s_cap_acc[BMS_SE_PER_PACK];     /* Q24, signed by dQ */
+
+/* Per module */
+static uint32_t s_mod_p[BMS_NUM_MODULES];       /* ppm² */
+static int64_t  s_mod_cc[BMS_NUM_MODULES];      /* charge count at last scan */
+static uint32_t s_mod_t_ms[BMS_NUM_MODULES];
+static uint32_t s_mod_win[BMS_NUM_MODULES];     /* Σ|dQ| this window, Q20 */
+static int32_t  s_mod_dmin[BMS_NUM_MODULES];
+static int32_t  s_mod_dmax[BMS_NUM_MODULES];
+static uint32_t s_seen;                         /* bit m: scanned once */
+
+/* ── Helpers ───────────────────────────────────────────────────────── */
+
+static int32_t clamp32(int32_t v, int32_t lo, int32_t hi)
+{
+    if (v < lo) { return lo; }
+    if (v > hi) { return hi; }
+    return v;
+}
+
+static uint16_t to_hundredths(uint16_t pack_soc, int32_t dsoc)
+{
+    int32_t d = (int32_t)(((int64_t)dsoc * Q24_PER_HUNDREDTH_DEN + (1L << 23)) >> 24);
+
+    return (uint16_t)clamp32((int32_t)pack_soc + d, 0, 10000);
+}
+
+/* Fold the window's mean correction per unit charge into icap */
+static void fold_capacity(uint16_t base, uint32_t win_q20)
+{
+    /* Δicap_q14 = acc_q24 / (16 · win_q20) · 2^14 = acc · 2^40 / win >> 30;
+     * win ≥ 10 % (≥ 2^16) keeps recip ≤ 2^24, acc · recip ≤ 2^55 */
+    int64_t recip = (int64_t)((1ULL << 40) / win_q20);
+    uint8_t c;
+
+    for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+        int32_t d = (int32_t)(((int64_t)s_cap_acc[base + c] * recip) >> 31);  /* half-step */
+        s_icap[base + c] = (uint16_t)clamp32((int32_t)s_icap[base + c] + d,
+                                             (int32_t)BMS_CELL_SOC_CAP_MIN_Q14,
+                                             (int32_t)BMS_CELL_SOC_CAP_MAX_Q14);
+        s_cap_acc[base + c] = 0;
+    }
+}
+
+/* ── API ───────────────────────────────────────────────────────────── */
+
+void bms_cell_soc_init(void)
+{
+    uint16_t i;
+    uint8_t m;
+
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        s_dsoc[i] = 0;
+        s_icap[i] = ICAP_ONE;
+        s_cap_acc[i] = 0;
+    }
+    for (m = 0U; m < BMS_NUM_MODULES; m++) {
+        s_mod_p[m] = BMS_CELL_SOC_P0_PPM2;
+        s_mod_cc[m] = 0;
+        s_mod_t_ms[m] = 0U;
+        s_mod_win[m] = 0U;
+        s_mod_dmin[m] = 0;
+        s_mod_dmax[m] = 0;
+    }
+    s_seen = 0U;
+}
+
+void bms_cell_soc_update_module(const bms_pack_data_t *pack, uint8_t mod_idx)
+{
+    const uint16_t base = (uint16_t)((uint16_t)mod_idx * BMS_SE_PER_MODULE);
+    const uint16_t *mv = &pack->cell_mv[base];
+    int32_t *dsoc = &s_dsoc[base];
+    const uint16_t *icap = &s_icap[base];
+    int32_t *acc = &s_cap_acc[base];
+    int32_t i_ma = pack->pack_current_ma;
+    int64_t cc = bms_soc_get_charge_q31();
+    int32_t dq, vref, h_q16, hk, g, dmin, dmax, sgn;
+    int64_t p, ph, s, r;
+    bool learn;
+    uint8_t c;
+
+    if (mod_idx >= BMS_NUM_MODULES) { return; }
+    for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+        if (mv[c] == 0U) { return; }                    /* not a full read */
+    }
+
+    /* ── Predict: charge since this module's last scan, Q20 as a
+     * difference of floors so nothing is lost between scans ── */
+    if ((s_seen & (1UL << mod_idx)) == 0U) {
+        s_seen |= 1UL << mod_idx;
+        dq = 0;
+        p = (int64_t)s_mod_p[mod_idx];
+    } else {
+        uint32_t dt = pack->uptime_ms - s_mod_t_ms[mod_idx];
+        int64_t d64 = (cc >> 11) - (s_mod_cc[mod_idx] >> 11);
+
+        if (dt > MOD_DT_MAX_MS) { dt = MOD_DT_MAX_MS; }
+        dq = (d64 > DQ_MAX) ? DQ_MAX : (d64 < -DQ_MAX) ? -DQ_MAX : (int32_t)d64;
+        p = (int64_t)s_mod_p[mod_idx] +
+            (int64_t)BMS_CELL_SOC_Q_PPM2_PER_S * dt / 1000;
+        if (p > (int64_t)P_MAX) { p = P_MAX; }
+    }
+    s_mod_cc[mod_idx] = cc;
+    s_mod_t_ms[mod_idx] = pack->uptime_ms;
+
+    /* |dq| ≤ 2^17, |icap − 1| ≤ 2^13: product ≤ 2^30; Q20·Q14 >> 10 = Q24 */
+    for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+        dsoc[c] += (dq * ((int32_t)icap[c] - ICAP_ONE) + 512) >> 10;
+    }
+
+    /* ── Gain, shared by the module: scalar Kalman on dsoc, H = dOCV/dSoC.
+     * P ≤ 2^32 ppm², h ≤ 2^20 (14 V/SoC below 2 %, Q16): ph ≤ 2^36,
+     * s ≤ 2^40, p·r ≤ 2^60 ── */
+    vref = bms_soc_model_cell_uv(i_ma, &h_q16);
+    {
+        int64_t sr_uv = ((int64_t)BMS_CELL_SOC_R_STD_UOHM * i_ma) / 1000;  /* µΩ·mA = nV */
+        r = (int64_t)BMS_CELL_SOC_R_MEAS_UV2 + sr_uv * sr_uv;
+    }
+    ph = (p * h_q16) >> 16;                                     /* ppm·µV */
+    s = ((ph * h_q16) >> 16) + r;                               /* µV² */
+    g = (int32_t)((ph * 4294967LL) / (s * 1000LL));             /* Q24/µV, Q8 */
+    p = (p * r) / s;                                            /* P·(1 − K·H) */
+    s_mod_p[mod_idx] = (p > 0) ? (uint32_t)p : 1U;
+    learn = (s_mod_p[mod_idx] < BMS_CELL_SOC_P_VALID_PPM2) && (dq != 0);
+    sgn = (dq < 0) ? -1 : 1;
+
+    /* µV per Q16 SoC in Q8: h_q16 · 10^6 / 2^24; ≤ 2^16 */
+    hk = (int32_t)(((int64_t)h_q16 * 1000000) >> 24);
+
+    /* ── Correct. |dsoc >> 8| ≤ 2^14 times hk ≤ 2^16; |e| ≤ 30 000 times
+     * g ≤ 17 900 (2^32 / 10^6 over the flattest slope, 0.24 V/SoC) ── */
+    dmin = DSOC_MAX;
+    dmax = -DSOC_MAX;
+    for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+        int32_t e = (int32_t)mv[c] * 1000 - vref - (((dsoc[c] >> 8) * hk) >> 8);
+        int32_t k;
+
+        e = clamp32(e, -BMS_CELL_SOC_INNOV_MAX_MV * 1000, BMS_CELL_SOC_INNOV_MAX_MV * 1000);
+        k = (e * g) >> 8;
+        dsoc[c] = clamp32(dsoc[c] + k, -DSOC_MAX, DSOC_MAX);
+        acc[c] += learn ? sgn * k : 0;
+        dmin = (dsoc[c] < dmin) ? dsoc[c] : dmin;
+        dmax = (dsoc[c] > dmax) ? dsoc[c] : dmax;
+    }
+    s_mod_dmin[mod_idx] = dmin;
+    s_mod_dmax[mod_idx] = dmax;
+
+    /* ── Capacity window ── */
+    if (learn) {
+        s_mod_win[mod_idx] += (uint32_t)((dq < 0) ? -dq : dq);
+        if (s_mod_win[mod_idx] >= CAP_WINDOW_Q20) {
+            fold_capacity(base, s_mod_win[mod_idx]);
+            s_mod_win[mod_idx] = 0U;
+        }
+    }
+}
+
+void bms_cell_soc_publish(bms_pack_data_t *pack)
+{
+    const uint32_t all = (BMS_NUM_MODULES == 32U) ? 0xFFFFFFFFUL
+                                                  : ((1UL << BMS_NUM_MODULES) - 1UL);
+    int32_t dmin = DSOC_MAX;
+    int32_t dmax = -DSOC_MAX;
+    bool valid = (s_seen == all);
+    uint8_t m;
+
+    for (m = 0U; m < BMS_NUM_MODULES; m++) {
+        if (s_mod_p[m] >= BMS_CELL_SOC_P_VALID_PPM2) { valid = false; }
+        if (s_mod_dmin[m] < dmin) { dmin = s_mod_dmin[m]; }
+        if (s_mod_dmax[m] > dmax) { dmax = s_mod_dmax[m]; }
+    }
+
+    pack->cell_soc_valid = valid;
+    if (valid) {
+        pack->cell_soc_min_hundredths = to_hundredths(pack->soc_hundredths, dmin);
+        pack->cell_soc_max_hundredths = to_hundredths(pack->soc_hundredths, dmax);
+    } else {
+        pack->cell_soc_min_hundredths = pack->soc_hundredths;
+        pack->cell_soc_max_hundredths = pack->soc_hundredths;
+    }
+}
+
+uint16_t bms_cell_soc_get(uint16_t cell_idx, uint16_t pack_soc_hundredths)
+{
+    if (cell_idx >= BMS_SE_PER_PACK) { return pack_soc_hundredths; }
+    return to_hundredths(pack_soc_hundredths, s_dsoc[cell_idx]);
+}
+
+uint16_t bms_cell_soc_get_capacity_q14(uint16_t cell_idx)
+{
+    if (cell_idx >= BMS_SE_PER_PACK) { return ICAP_ONE; }
+    return (uint16_t)((1UL << 28) / s_icap[cell_idx]);
+}
+
+uint16_t bms_cell_soc_mask_above(uint8_t mod_idx, uint16_t pack_soc_hundredths,
+                                 uint16_t thresh_hundredths)
+{
+    /* Compare in Q24 against one per-module threshold: no per-cell rounding */
+    int32_t t = (int32_t)(((int64_t)((int32_t)thresh_hundredths -
+                                     (int32_t)pack_soc_hundredths) * (1LL << 24)) /
+                          Q24_PER_HUNDREDTH_DEN);
+    const int32_t *dsoc;
+    uint16_t mask = 0U;
+    uint8_t c;
+
+    if (mod_idx >= BMS_NUM_MODULES) { return 0U; }
+    dsoc = &s_dsoc[(uint16_t)mod_idx * BMS_SE_PER_MODULE];
+    for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+        mask |= (uint16_t)((dsoc[c] > t) ? (1U << c) : 0U);
+    }
+    return mask;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file bms_cmac.c
+ * @brief Constant-time AES-128 and AES-CMAC
+ *
+ * Street Smart Edition.
+ * State layout: w[c] holds column c, row r in byte lane r (bits 8r..8r+7),
+ * i.e. w[c] = in[4c] | in[4c+1] << 8 | in[4c+2] << 16 | in[4c+3] << 24.
+ * All GF(2^8) arithmetic runs on four lanes at once.
+ *
+ * Rough M4 cost per block: SubBytes 4 × (7 squarings + 4 multiplies +
+ * affine) ≈ 2.4k cycles/round, ×10 rounds plus ShiftRows/MixColumns ≈ 26k
+ * cycles ≈ 155 µs at 168 MHz. BMS_CAN_AUTH_VERIFY_CYCLES budgets for it.
+ */
+
+#include "bms_cmac.h"
+#include "bms_hal.h"
+#include <string.h>
+
+#define LANE_LSB   0x01010101U
+#define LANE_LOW7  0x7F7F7F7FU
+
+/* ── GF(2^8) × 4 lanes ─────────────────────────────────────────────── */
+
+static uint32_t xtime4(uint32_t x)
+{
+    return ((x & LANE_LOW7) << 1U) ^ (((x >> 7U) & LANE_LSB) * 0x1BU);
+}
+
+static uint32_t gf_mul4(uint32_t a, uint32_t b)
+{
+    uint32_t r = 0U;
+    uint8_t i;
+
+    for (i = 0U; i < 8U; i++) {
+        r ^= a & (((b >> i) & LANE_LSB) * 0xFFU);
+        a = xtime4(a);
+    }
+    return r;
+}
+
+/* Squaring is linear over GF(2): bit i maps to x^(2i) mod 0x11B */
+static uint32_t gf_sq4(uint32_t a)
+{
+    static const uint8_t k_sq[8] = { 0x01U, 0x04U, 0x10U, 0x40U,
+                                     0x1BU, 0x6CU, 0xABU, 0x9AU };
+    uint32_t r = 0U;
+    uint8_t i;
+
+    for (i = 0U; i < 8U; i++) {
+        r ^= (((a >> i) & LANE_LSB) * 0xFFU) & ((uint32_t)k_sq[i] * LANE_LSB);
+    }
+    return r;
+}
+
+/* x^254 = x^-1 (0 → 0): 7 squarings, 4 multiplies */
+static uint32_t gf_inv4(uint32_t x)
+{
+    uint32_t x2 = gf_sq4(x);
+    uint32_t x3 = gf_mul4(x2, x);
+    uint32_t x12 = gf_sq4(gf_sq4(x3));
+    uint32_t x15 = gf_mul4(x12, x3);
+    uint32_t x240 = gf_sq4(gf_sq4(gf_sq4(gf_sq4(x15))));
+    return gf_mul4(gf_mul4(x240, x12), x2);
+}
+
+static uint32_t rotl_lanes(uint32_t x, uint8_t n)
+{
+    uint32_t lo = ((uint32_t)(0xFFU >> (8U - n))) * LANE_LSB;
+    return ((x << n) & ~lo) | ((x >> (8U - n)) & lo);
+}
+
+static uint32_t sub_word(uint32_t x)
+{
+    uint32_t b = gf_inv4(x);
+    return b ^ rotl_lanes(b, 1U) ^ rotl_lanes(b, 2U) ^ rotl_lanes(b, 3U) ^
+           rotl_lanes(b, 4U) ^ 0x63636363U;
+}
+
+static uint32_t ror8(uint32_t x)  { return (x >> 8U) | (x << 24U); }
+static uint32_t ror16(uint32_t x) { return (x >> 16U) | (x << 16U); }
+
+static uint32_t mix_column(uint32_t w)
+{
+    uint32_t r1 = ror8(w);
+    return xtime4(w ^ r1) ^ r1 ^ ror16(w) ^ ror8(ror16(w));
+}
+
+static uint32_t load_le32(const uint8_t *b)
+{
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8U) |
+           ((uint32_t)b[2] << 16U) | ((uint32_t)b[3] << 24U);
+}
+
+static void store_le32(uint8_t *b, uint32_t v)
+{
+    b[0] = (uint8_t)(v & 0xFFU);
+    b[1] = (uint8_t)((v >> 8U) & 0xFFU);
+    b[2] = (uint8_t)((v >> 16U) & 0xFFU);
+    b[3] = (uint8_t)((v >> 24U) & 0xFFU);
+}
+
+/* ── AES-128 ───────────────────────────────────────────────────────── */
+
+void bms_aes128_init(bms_aes128_ctx_t *ctx, const uint8_t key[16])
+{
+    uint32_t rcon = 0x01U;
+    uint8_t i;
+
+    for (i = 0U; i < 4U; i++) { ctx->rk[i] = load_le32(&key[4U * i]); }
+    for (i = 4U; i < 44U; i++) {
+        uint32_t t = ctx->rk[i - 1U];
+        if ((i & 3U) == 0U) {
+            t = sub_word(ror8(t)) ^ rcon;
+            rcon = xtime4(rcon);
+        }
+        ctx->rk[i] = ctx->rk[i - 4U] ^ t;
+    }
+#if BMS_CAN_AUTH_HW_AES
+    memcpy(ctx->key, key, BMS_AES_BLOCK_LEN);
+#endif
+}
+
+void bms_aes128_encrypt(const bms_aes128_ctx_t *ctx, const uint8_t in[16],
+                        uint8_t out[16])
+{
+    uint32_t s[4], t[4];
+    uint8_t c, round;
+
+#if BMS_CAN_AUTH_HW_AES
+    if (hal_aes128_encrypt(ctx->key, in, out) == 0) { return; }
+#endif
+
+    for (c = 0U; c < 4U; c++) { s[c] = load_le32(&in[4U * c]) ^ ctx->rk[c]; }
+
+    for (round = 1U; round <= 10U; round++) {
+        const uint32_t *rk = &ctx->rk[4U * round];
+        for (c = 0U; c < 4U; c++) { s[c] = sub_word(s[c]); }
+        /* ShiftRows: row r of column c comes from column c + r */
+        for (c = 0U; c < 4U; c++) {
+            t[c] = (s[c] & 0x000000FFU) |
+                   (s[(c + 1U) & 3U] & 0x0000FF00U) |
+                   (s[(c + 2U) & 3U] & 0x00FF0000U) |
+                   (s[(c + 3U) & 3U] & 0xFF000000U);
+        }
+        for (c = 0U; c < 4U; c++) {
+            s[c] = ((round < 10U) ? mix_column(t[c]) : t[c]) ^ rk[c];
+        }
+    }
+
+    for (c = 0U; c < 4U; c++) { store_le32(&out[4U * c], s[c]); }
+}
+
+/* ── CMAC ──────────────────────────────────────────────────────────── */
+
+/* Left shift by one bit, XOR Rb = 0x87 if the MSB fell off (constant time) */
+static void dbl(uint8_t out[16], const uint8_t in[16])
+{
+    uint8_t carry = (uint8_t)(in[0] >> 7U);
+    uint8_t i;
+
+    for (i = 0U; i < 15U; i++) {
+        out[i] = (uint8_t)((uint8_t)(in[i] << 1U) | (in[i + 1U] >> 7U));
+    }
+    out[15] = (uint8_t)((uint8_t)(in[15] << 1U) ^ (uint8_t)(0x87U & (0U - (uint32_t)carry)));
+}
+
+void bms_cmac_init(bms_cmac_ctx_t *ctx, const uint8_t key[16])
+{
+    uint8_t l[BMS_AES_BLOCK_LEN];
+
+    bms_aes128_init(&ctx->aes, key);
+    memset(l, 0, sizeof(l));
+    bms_aes128_encrypt(&ctx->aes, l, l);
+    dbl(ctx->k1, l);
+    dbl(ctx->k2, ctx->k1);
+    memset(l, 0, sizeof(l));
+}
+
+void bms_cmac_compute(const bms_cmac_ctx_t *ctx, const uint8_t *msg,
+                      uint16_t len, uint8_t mac[16])
+{
+    uint8_t x[BMS_AES_BLOCK_LEN];
+    uint16_t n = (uint16_t)((len + BMS_AES_BLOCK_LEN - 1U) / BMS_AES_BLOCK_LEN);
+    uint16_t blk;
+    uint8_t i;
+    bool complete;
+
+    if (n == 0U) { n = 1U; }
+    complete = (len != 0U) && ((len % BMS_AES_BLOCK_LEN) == 0U);
+
+    memset(x, 0, sizeof(x));
+    for (blk = 0U; blk + 1U < n; blk++) {
+        for (i = 0U; i < BMS_AES_BLOCK_LEN; i++) { x[i] ^= msg[blk * BMS_AES_BLOCK_LEN + i]; }
+        bms_aes128_encrypt(&ctx->aes, x, x);
+    }
+
+    /* Last block: XOR K1 if complete, else 10* padding and K2 */
+    for (i = 0U; i < BMS_AES_BLOCK_LEN; i++) {
+        uint16_t off = (uint16_t)(blk * BMS_AES_BLOCK_LEN + i);
+        uint8_t m;
+        if (off < len)       { m = msg[off]; }
+        else if (off == len) { m = 0x80U; }
+        else                 { m = 0x00U; }
+        x[i] ^= m ^ (complete ? ctx->k1[i] : ctx->k2[i]);
+    }
+    bms_aes128_encrypt(&ctx->aes, x, mac);
+    memset(x, 0, sizeof(x));
+}
+
+bool bms_cmac_verify(const bms_cmac_ctx_t *ctx, const uint8_t *msg,
+                     uint16_t len, const uint8_t *tag, uint8_t tag_len)
+{
+    uint8_t mac[BMS_AES_BLOCK_LEN];
+    uint8_t diff = 0U;
+    uint8_t i;
+
+    if (tag_len == 0U || tag_len > BMS_AES_BLOCK_LEN) { return false; }
+    bms_cmac_compute(ctx, msg, len, mac);
+    for (i = 0U; i < tag_len; i++) { diff |= (uint8_t)(mac[i] ^ tag[i]); }
+    memset(mac, 0, sizeof(mac));
+    return diff == 0U;
+}
+
+void bms_cmac_wipe(bms_cmac_ctx_t *ctx)
+{
+    volatile uint8_t *p = (volatile uint8_t *)ctx;
+    size_t i;
+
+    for (i = 0U; i < sizeof(*ctx); i++) { p[i] = 0U; }
+}
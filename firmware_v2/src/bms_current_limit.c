@@ -6,91 +6,189 @@
  * P0-05: Sub-zero charge limit is 0A (not 5A via OC formula margin).
  * The actual hard fault is in bms_protection.c; this function returns
  * 0A charge limit below 5°C which is the correct derating curve.
+ *
+ * No runtime division: breakpoints and per-segment reciprocal slopes come
+ * from bms_derating_tables.h (tools/gen_derating_tables.py), and C-rate →
+ * mA is one multiply by mA per 0.01 C. That scale starts at the nominal
+ * capacity and follows bms_soh's learned capacity (rounded to 100 mAh)
+ * through bms_current_limit_set_capacity, so the limits age with the
+ * pack. The result pair is cached on its six inputs because monitor
+ * (every 10 ms) and the protection OC check both ask for it with the same
+ * pack state.
+ *
+ * SoC derating acts on the extreme cells once bms_cell_soc has them: the
+ * fullest SE limits charge, the emptiest limits discharge. Until then
+ * both fall back to the pack SoC.
+ *
+ * Those are different tasks, and protection can preempt the monitor in
+ * the middle of a cache update, so the cache is a small seqlock: a writer
+ * claims it by moving seq from even to odd, a reader only trusts a copy
+ * taken between two equal even seq loads. Neither side ever waits — a
+ * busy cache is simply a miss (reader) or not refreshed (writer).
  */
 
 #include "bms_current_limit.h"
+#include "bms_derating_tables.h"
 #include "bms_config.h"
 
-static int32_t interp_i32(const int32_t *x_bp, const int32_t *y_bp,
-                           uint8_t n, int32_t x)
+#define MA_PER_CENTI_C  ((int32_t)(BMS_NOMINAL_CAPACITY_MAH / 100))
+
+_Static_assert((BMS_NOMINAL_CAPACITY_MAH % 100) == 0,
+               "C-rate x100 -> mA must be an exact multiply");
+
+static int32_t s_ma_per_centi_c = MA_PER_CENTI_C;
+
+static int32_t derate_eval(const bms_derate_curve_t *c, int32_t x)
 {
     uint8_t i;
-    if (x <= x_bp[0]) { return y_bp[0]; }
-    if (x >= x_bp[n - 1U]) { return y_bp[n - 1U]; }
-
-    for (i = 1U; i < n; i++) {
-        if (x <= x_bp[i]) {
-            int32_t dx = x_bp[i] - x_bp[i - 1U];
-            int32_t dy = y_bp[i] - y_bp[i - 1U];
-            if (dx == 0) { return y_bp[i]; }
-            return y_bp[i - 1U] + (dy * (x - x_bp[i - 1U])) / dx;
-        }
+    uint32_t mag;
+    int32_t m;
+
+    if (x <= c->x[0]) { return c->y[0]; }
+    if (x >= c->x[c->n - 1U]) { return c->y[c->n - 1U]; }
+
+    for (i = 1U; i < (uint8_t)(c->n - 1U); i++) {
+        if (x <= c->x[i]) { break; }
     }
-    return y_bp[n - 1U];
+    i--;
+    m = c->slope[i];
+    mag = (uint32_t)(((uint64_t)(uint32_t)(x - c->x[i]) *
+                      (uint32_t)((m < 0) ? -m : m)) >> BMS_DERATE_SLOPE_SHIFT);
+    return (m < 0) ? (c->y[i] - (int32_t)mag) : (c->y[i] + (int32_t)mag);
 }
 
-static int32_t centi_c_to_ma(int32_t centi_c)
+static int32_t min32(int32_t a, int32_t b) { return (a < b) ? a : b; }
+
+static int32_t centi_c_to_ma(int32_t centi_c, int32_t ma_per_centi_c)
 {
-    return (int32_t)(((int64_t)centi_c * BMS_NOMINAL_CAPACITY_MAH) / 100);
+    return centi_c * ma_per_centi_c;
 }
 
-/* Temperature derating breakpoints */
-static const int32_t temp_chg_bp[] = { -250, 0, 50, 150, 350, 450, 550, 650 };
-static const int32_t temp_chg_cr[] = {    0, 0,  0, 300, 300, 200,   0,   0 };
-#define TEMP_CHG_N 8U
-
-static const int32_t temp_dchg_bp[] = {
-    -250, -150, -100, -50, 0, 50, 100, 250, 300, 350, 450, 550, 600, 650, 700
-};
-static const int32_t temp_dchg_cr[] = {
-    20, 20, 100, 150, 200, 450, 500, 500, 450, 400, 380, 380, 20, 20, 0
-};
-#define TEMP_DCHG_N 15U
-
-/* SoC derating */
-static const int32_t soc_chg_bp[] = {    0, 8500, 9000, 9500, 10000 };
-static const int32_t soc_chg_cr[] = { 300,  300,  200,  100,    50 };
-#define SOC_CHG_N 5U
-
-static const int32_t soc_dchg_bp[] = {   0, 200,  500,  800, 1000, 1500, 2000, 5000, 10000 };
-static const int32_t soc_dchg_cr[] = { 100, 100,  220,  220,  400,  400,  500,  500,   500 };
-#define SOC_DCHG_N 9U
-
-/* SEV derating */
-static const int32_t sev_chg_bp[] = { 3000, 4100, 4200 };
-static const int32_t sev_chg_cr[] = {  300,  300,    0 };
-#define SEV_CHG_N 3U
-
-static const int32_t sev_dchg_bp[] = { 3000, 3200, 3300, 3400, 3450, 3550, 4200 };
-static const int32_t sev_dchg_cr[] = {    0,    0,  200,  250,  380,  500,  500 };
-#define SEV_DCHG_N 7U
+static uint16_t soc_for_charge(const bms_pack_data_t *pack)
+{
+    return pack->cell_soc_valid ? pack->cell_soc_max_hundredths : pack->soc_hundredths;
+}
 
-static int32_t min32(int32_t a, int32_t b) { return (a < b) ? a : b; }
+static uint16_t soc_for_discharge(const bms_pack_data_t *pack)
+{
+    return pack->cell_soc_valid ? pack->cell_soc_min_hundredths : pack->soc_hundredths;
+}
+
+/* ── Result cache ──────────────────────────────────────────────────── */
+
+#if defined(__GNUC__)
+  #define CLC_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define CLC_PUT(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+  #define CLC_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+  #define CLC_CLAIM(p, s)   __atomic_compare_exchange_n((p), &(s), (s) + 1U, false, \
+                                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+#else
+  #define CLC_LOAD(p)       (*(p))
+  #define CLC_PUT(p, v)     (*(p) = (v))
+  #define CLC_STORE(p, v)   (*(p) = (v))
+  #define CLC_CLAIM(p, s)   ((*(p) == (s)) ? ((*(p) = (s) + 1U), true) : false)
+#endif
+
+static struct {
+    uint32_t seq;               /* odd while a writer is filling */
+    bool     valid;
+    int16_t  max_temp_deci_c;
+    uint16_t soc_chg_hundredths;
+    uint16_t soc_dchg_hundredths;
+    uint16_t max_cell_mv;
+    uint16_t min_cell_mv;
+    int32_t  ma_per_centi_c;
+    int32_t  chg_ma;
+    int32_t  dchg_ma;
+} s_cache;
+
+/* Claim the cache for writing; false if another task holds it */
+static bool cache_claim(uint32_t *seq)
+{
+    *seq = CLC_LOAD(&s_cache.seq);
+    if ((*seq & 1U) != 0U) { return false; }
+    return CLC_CLAIM(&s_cache.seq, *seq);
+}
+
+static bool cache_lookup(const bms_pack_data_t *pack, int32_t scale,
+                         int32_t *chg, int32_t *dchg)
+{
+    uint32_t seq = CLC_LOAD(&s_cache.seq);
+    bool hit;
+
+    if ((seq & 1U) != 0U) { return false; }
+    hit = CLC_LOAD(&s_cache.valid) &&
+          CLC_LOAD(&s_cache.max_temp_deci_c) == pack->max_temp_deci_c &&
+          CLC_LOAD(&s_cache.soc_chg_hundredths) == soc_for_charge(pack) &&
+          CLC_LOAD(&s_cache.soc_dchg_hundredths) == soc_for_discharge(pack) &&
+          CLC_LOAD(&s_cache.max_cell_mv) == pack->max_cell_mv &&
+          CLC_LOAD(&s_cache.min_cell_mv) == pack->min_cell_mv &&
+          CLC_LOAD(&s_cache.ma_per_centi_c) == scale;
+    *chg = CLC_LOAD(&s_cache.chg_ma);
+    *dchg = CLC_LOAD(&s_cache.dchg_ma);
+    return hit && CLC_LOAD(&s_cache.seq) == seq;
+}
+
+void bms_current_limit_invalidate(void)
+{
+    uint32_t seq;
+
+    /* A compute in flight finishes with the inputs it started on */
+    if (!cache_claim(&seq)) { return; }
+    CLC_PUT(&s_cache.valid, false);
+    CLC_STORE(&s_cache.seq, seq + 2U);
+}
+
+void bms_current_limit_set_capacity(uint32_t capacity_mah)
+{
+    int32_t scale = (int32_t)((capacity_mah + 50U) / 100U);
+
+    if (scale <= 0 || scale == CLC_LOAD(&s_ma_per_centi_c)) { return; }
+    /* Part of the cache key: stale pairs miss on their own */
+    CLC_STORE(&s_ma_per_centi_c, scale);
+}
 
 void bms_current_limit_compute(const bms_pack_data_t *pack,
                                 int32_t *max_charge_ma,
                                 int32_t *max_discharge_ma)
 {
     int32_t tc, td, sc, sd, vc, vd;
-    int32_t t = (int32_t)pack->max_temp_deci_c;
+    uint16_t soc_c, soc_d;
+    uint32_t seq;
+    int32_t scale = CLC_LOAD(&s_ma_per_centi_c);
 
-    tc = centi_c_to_ma(interp_i32(temp_chg_bp, temp_chg_cr, TEMP_CHG_N, t));
-    td = centi_c_to_ma(interp_i32(temp_dchg_bp, temp_dchg_cr, TEMP_DCHG_N, t));
+    if (cache_lookup(pack, scale, max_charge_ma, max_discharge_ma)) { return; }
 
-    int32_t s = (int32_t)pack->soc_hundredths;
-    sc = centi_c_to_ma(interp_i32(soc_chg_bp, soc_chg_cr, SOC_CHG_N, s));
-    sd = centi_c_to_ma(interp_i32(soc_dchg_bp, soc_dchg_cr, SOC_DCHG_N, s));
+    soc_c = soc_for_charge(pack);
+    soc_d = soc_for_discharge(pack);
 
-    {
-        int32_t dummy;
-        vc = centi_c_to_ma(interp_i32(sev_chg_bp, sev_chg_cr, SEV_CHG_N, (int32_t)pack->max_cell_mv));
-        vd = centi_c_to_ma(interp_i32(sev_dchg_bp, sev_dchg_cr, SEV_DCHG_N, (int32_t)pack->min_cell_mv));
-        (void)dummy;
-    }
+    tc = derate_eval(&k_derate_temp_chg, (int32_t)pack->max_temp_deci_c);
+    td = derate_eval(&k_derate_temp_dchg, (int32_t)pack->max_temp_deci_c);
+    sc = derate_eval(&k_derate_soc_chg, (int32_t)soc_c);
+    sd = derate_eval(&k_derate_soc_dchg, (int32_t)soc_d);
+    vc = derate_eval(&k_derate_sev_chg, (int32_t)pack->max_cell_mv);
+    vd = derate_eval(&k_derate_sev_dchg, (int32_t)pack->min_cell_mv);
 
-    *max_charge_ma = min32(tc, min32(sc, vc));
-    *max_discharge_ma = min32(td, min32(sd, vd));
+    /* min() commutes with the positive mA scale, so scale once */
+    *max_charge_ma = centi_c_to_ma(min32(tc, min32(sc, vc)), scale);
+    *max_discharge_ma = centi_c_to_ma(min32(td, min32(sd, vd)), scale);
 
     if (*max_charge_ma < 0) { *max_charge_ma = 0; }
     if (*max_discharge_ma < 0) { *max_discharge_ma = 0; }
+    /* A learned capacity above nominal must not lift the limit past the
+     * hardware rating — BMS_MAX_DISCHARGE_MA is the hard OC trip */
+    *max_charge_ma = min32(*max_charge_ma, BMS_MAX_CHARGE_MA);
+    *max_discharge_ma = min32(*max_discharge_ma, BMS_MAX_DISCHARGE_MA);
+
+    if (!cache_claim(&seq)) { return; }
+    CLC_PUT(&s_cache.max_temp_deci_c, pack->max_temp_deci_c);
+    CLC_PUT(&s_cache.soc_chg_hundredths, soc_c);
+    CLC_PUT(&s_cache.soc_dchg_hundredths, soc_d);
+    CLC_PUT(&s_cache.max_cell_mv, pack->max_cell_mv);
+    CLC_PUT(&s_cache.min_cell_mv, pack->min_cell_mv);
+    CLC_PUT(&s_cache.ma_per_centi_c, scale);
+    CLC_PUT(&s_cache.chg_ma, *max_charge_ma);
+    CLC_PUT(&s_cache.dchg_ma, *max_discharge_ma);
+    CLC_PUT(&s_cache.valid, true);
+    CLC_STORE(&s_cache.seq, seq + 2U);
 }
@@ -0,0 +1,656 @@
+/**
+ * @file bms_history.c
+ * @brief Long-term operating history — tiered, compressed, append-only
+ *
+ * Street Smart Edition.
+ * The state task owns the hour accumulator and hands each finished hour
+ * over through a one-slot mailbox; everything that touches flash (the
+ * tier rings and the day/month roll-up accumulators) belongs to the NVM
+ * task. Layout and compression are described in bms_history.h.
+ */
+
+#include "bms_history.h"
+#include "bms_nvm.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+#define HST_MAGIC       0x48535430UL    /* "HST0" + tier */
+#define HST_HDR_LEN     8U
+#define HST_FIELDS      (12U + (uint32_t)BMS_MODE_COUNT)
+#define HST_REC_MAX     (1U + HST_FIELDS * 5U + 2U)
+#define HST_PAGES       (BMS_HIST_TIERS * BMS_NVM_HIST_SECTORS_PER_TIER * \
+                         (BMS_NVM_SECTOR_SIZE / BMS_NVM_PAGE_SIZE))
+
+_Static_assert(HST_REC_MAX - 3U < 0xFFU, "Record length is one byte, 0xFF = erased");
+_Static_assert(BMS_NVM_HIST_SECTORS_PER_TIER >= 2U, "Tier ring needs a spare sector");
+_Static_assert((BMS_NVM_HIST_BASE % BMS_NVM_SECTOR_SIZE) == 0U, "History region sector aligned");
+_Static_assert(BMS_HIST_TIERS == 3U, "Tier ratios below assume hour/day/month");
+
+/* Hour record handoff: record before flag (release), flag before record (acquire) */
+#if defined(__GNUC__)
+  #define HST_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define HST_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  #define HST_LOAD(p)       (*(p))
+  #define HST_STORE(p, v)   (*(p) = (v))
+#endif
+
+typedef enum { PARSE_OK = 0, PARSE_END, PARSE_BAD } parse_t;
+
+typedef void (*visit_fn_t)(const bms_history_rec_t *r, void *ctx);
+
+typedef struct {
+    bool              open;         /* active sector has a valid header */
+    bool              full;         /* next append rotates */
+    uint8_t           sector;       /* active, index within the tier */
+    uint32_t          offset;
+    uint32_t          seq;
+    uint16_t          in_sector;    /* records in the active sector */
+    bool              any;          /* tier holds at least one record */
+    uint32_t          last_hour;
+    bms_history_rec_t base;         /* delta base: last record in sector */
+} tier_t;
+
+static const uint16_t k_ratio[BMS_HIST_TIERS] = {
+    1U, BMS_HIST_DAY_HOURS, BMS_HIST_MONTH_DAYS
+};
+
+/* NVM task */
+static tier_t            s_tier[BMS_HIST_TIERS];
+static bms_history_rec_t s_acc[BMS_HIST_TIERS];     /* [0] unused */
+static uint16_t          s_acc_n[BMS_HIST_TIERS];
+static bms_history_stats_t s_stats;
+
+/* NVM task: a cascade whose next append waits for the erase budget */
+static bms_history_rec_t s_pend_rec;
+static uint8_t           s_pend_tier;
+static bool              s_pend;
+
+/* State task → NVM task */
+static bms_history_rec_t s_ready_rec;
+static volatile bool     s_ready;
+
+/* State task: the hour in progress */
+static struct {
+    bool     started;
+    uint32_t last_tick;
+    uint32_t ms;
+    uint32_t n;
+    uint32_t sum_mv;
+    int32_t  sum_t;
+    uint16_t vmin, vmax;
+    int16_t  tmin, tmax;
+    uint64_t chg_mams;              /* mA·ms, remainder carried over */
+    uint64_t dchg_mams;
+    uint32_t peak_chg, peak_dchg;
+    uint32_t mode_ms[BMS_MODE_COUNT];
+    uint32_t hour;
+} s_hr;
+
+/* ── Byte / varint helpers ─────────────────────────────────────────── */
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24U);
+    p[1] = (uint8_t)(v >> 16U);
+    p[2] = (uint8_t)(v >> 8U);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24U) | ((uint32_t)p[1] << 16U) |
+           ((uint32_t)p[2] << 8U) | (uint32_t)p[3];
+}
+
+static void to_fields(const bms_history_rec_t *r, uint32_t *f)
+{
+    uint8_t m;
+
+    f[0] = r->hour;
+    f[1] = r->hours;
+    f[2] = r->cell_min_mv;
+    f[3] = r->cell_max_mv;
+    f[4] = r->cell_mean_mv;
+    f[5] = (uint32_t)(int32_t)r->temp_min_deci_c;
+    f[6] = (uint32_t)(int32_t)r->temp_max_deci_c;
+    f[7] = (uint32_t)(int32_t)r->temp_mean_deci_c;
+    f[8] = r->charge_mah;
+    f[9] = r->discharge_mah;
+    f[10] = r->peak_charge_ma;
+    f[11] = r->peak_discharge_ma;
+    for (m = 0U; m < BMS_MODE_COUNT; m++) { f[12U + m] = r->mode_s[m]; }
+}
+
+static void from_fields(const uint32_t *f, bms_history_rec_t *r)
+{
+    uint8_t m;
+
+    r->hour = f[0];
+    r->hours = f[1];
+    r->cell_min_mv = (uint16_t)f[2];
+    r->cell_max_mv = (uint16_t)f[3];
+    r->cell_mean_mv = (uint16_t)f[4];
+    r->temp_min_deci_c = (int16_t)(int32_t)f[5];
+    r->temp_max_deci_c = (int16_t)(int32_t)f[6];
+    r->temp_mean_deci_c = (int16_t)(int32_t)f[7];
+    r->charge_mah = f[8];
+    r->discharge_mah = f[9];
+    r->peak_charge_ma = f[10];
+    r->peak_discharge_ma = f[11];
+    for (m = 0U; m < BMS_MODE_COUNT; m++) { r->mode_s[m] = f[12U + m]; }
+}
+
+/* Record: len, zigzag-varint deltas, CRC-32 low 16 bits. Returns size. */
+static uint8_t rec_encode(const bms_history_rec_t *r, const bms_history_rec_t *base,
+                          uint8_t *buf)
+{
+    uint32_t f[HST_FIELDS], b[HST_FIELDS];
+    uint8_t *p = &buf[1];
+    uint32_t i, crc;
+    uint8_t len;
+
+    to_fields(r, f);
+    to_fields(base, b);
+    for (i = 0U; i < HST_FIELDS; i++) {
+        uint32_t d = f[i] - b[i];
+        uint32_t z = (d << 1U) ^ (0U - (d >> 31U));
+        while (z >= 0x80U) {
+            *p++ = (uint8_t)((z & 0x7FU) | 0x80U);
+            z >>= 7U;
+        }
+        *p++ = (uint8_t)z;
+    }
+    len = (uint8_t)(p - &buf[1]);
+    buf[0] = len;
+    crc = bms_nvm_crc32(buf, 1U + len);
+    p[0] = (uint8_t)(crc >> 8U);
+    p[1] = (uint8_t)crc;
+    return (uint8_t)(len + 3U);
+}
+
+static parse_t rec_parse(const uint8_t *buf, uint32_t avail,
+                         const bms_history_rec_t *base, bms_history_rec_t *out,
+                         uint32_t *used)
+{
+    uint32_t f[HST_FIELDS];
+    const uint8_t *p, *end;
+    uint32_t i, crc;
+    uint8_t len;
+
+    if (avail < 1U) { return PARSE_END; }
+    len = buf[0];
+    if (len == 0xFFU) { return PARSE_END; }
+    if (len == 0U || (uint32_t)len + 3U > avail) { return PARSE_BAD; }
+    crc = bms_nvm_crc32(buf, 1U + len);
+    if (buf[1U + len] != (uint8_t)(crc >> 8U) || buf[2U + len] != (uint8_t)crc) {
+        return PARSE_BAD;
+    }
+
+    to_fields(base, f);
+    p = &buf[1];
+    end = &buf[1U + len];
+    for (i = 0U; i < HST_FIELDS; i++) {
+        uint32_t z = 0U, d;
+        uint8_t shift = 0U;
+        uint8_t byte;
+        do {
+            if (p >= end || shift > 28U) { return PARSE_BAD; }
+            byte = *p++;
+            z |= (uint32_t)(byte & 0x7FU) << shift;
+            shift = (uint8_t)(shift + 7U);
+        } while ((byte & 0x80U) != 0U);
+        d = (z >> 1U) ^ (0U - (z & 1U));
+        f[i] += d;
+    }
+    if (p != end) { return PARSE_BAD; }
+
+    from_fields(f, out);
+    *used = (uint32_t)len + 3U;
+    return PARSE_OK;
+}
+
+/* ── Flash layout ──────────────────────────────────────────────────── */
+
+static uint32_t sector_addr(uint8_t tier, uint8_t sector)
+{
+    return BMS_NVM_HIST_BASE +
+           ((uint32_t)tier * BMS_NVM_HIST_SECTORS_PER_TIER + sector) * BMS_NVM_SECTOR_SIZE;
+}
+
+static bool sector_seq(uint8_t tier, uint8_t sector, uint32_t *seq)
+{
+    uint8_t h[HST_HDR_LEN];
+
+    bms_hal_nvm_read(sector_addr(tier, sector), h, HST_HDR_LEN);
+    *seq = get_u32(&h[4]);
+    return get_u32(&h[0]) == HST_MAGIC + tier && *seq != 0xFFFFFFFFU;
+}
+
+/* Visit every record of one sector, oldest first */
+static uint16_t scan_sector(uint32_t addr, visit_fn_t fn, void *ctx, tier_t *track)
+{
+    uint8_t buf[HST_REC_MAX];
+    bms_history_rec_t base, r;
+    uint32_t off = HST_HDR_LEN;
+    uint16_t n = 0U;
+
+    memset(&base, 0, sizeof(base));
+    while (off < BMS_NVM_SECTOR_SIZE) {
+        uint32_t avail = BMS_NVM_SECTOR_SIZE - off;
+        uint32_t used = 0U;
+        parse_t res;
+
+        if (avail > HST_REC_MAX) { avail = HST_REC_MAX; }
+        bms_hal_nvm_read(addr + off, buf, (uint16_t)avail);
+        res = rec_parse(buf, avail, &base, &r, &used);
+        if (res == PARSE_END) { break; }
+        if (res == PARSE_BAD) {
+            if (track != NULL) {
+                track->full = true;
+                s_stats.torn++;
+            }
+            break;
+        }
+        if (fn != NULL) { fn(&r, ctx); }
+        base = r;
+        off += used;
+        n++;
+    }
+    if (track != NULL) {
+        track->offset = off;
+        track->in_sector = n;
+        track->base = base;
+    }
+    return n;
+}
+
+/* Visit every record of a tier, oldest sector first */
+static uint16_t scan_tier(uint8_t tier, visit_fn_t fn, void *ctx)
+{
+    uint32_t seq[BMS_NVM_HIST_SECTORS_PER_TIER];
+    bool valid[BMS_NVM_HIST_SECTORS_PER_TIER];
+    uint16_t n = 0U;
+    uint8_t s, k;
+
+    for (s = 0U; s < BMS_NVM_HIST_SECTORS_PER_TIER; s++) {
+        valid[s] = sector_seq(tier, s, &seq[s]);
+    }
+    for (k = 0U; k < BMS_NVM_HIST_SECTORS_PER_TIER; k++) {
+        uint8_t pick = BMS_NVM_HIST_SECTORS_PER_TIER;
+        for (s = 0U; s < BMS_NVM_HIST_SECTORS_PER_TIER; s++) {
+            if (valid[s] && (pick == BMS_NVM_HIST_SECTORS_PER_TIER || seq[s] < seq[pick])) {
+                pick = s;
+            }
+        }
+        if (pick == BMS_NVM_HIST_SECTORS_PER_TIER) { break; }
+        valid[pick] = false;
+        n = (uint16_t)(n + scan_sector(sector_addr(tier, pick), fn, ctx, NULL));
+    }
+    return n;
+}
+
+/* ── Aggregation ───────────────────────────────────────────────────── */
+
+static void merge(bms_history_rec_t *acc, uint16_t *n, const bms_history_rec_t *r)
+{
+    uint32_t h = acc->hours + r->hours;
+    uint8_t m;
+
+    if (*n == 0U || h == 0U) {
+        *acc = *r;
+        *n = 1U;
+        return;
+    }
+    acc->cell_mean_mv = (uint16_t)(((uint64_t)acc->cell_mean_mv * acc->hours +
+                                    (uint64_t)r->cell_mean_mv * r->hours) / h);
+    acc->temp_mean_deci_c = (int16_t)(((int64_t)acc->temp_mean_deci_c * acc->hours +
+                                       (int64_t)r->temp_mean_deci_c * r->hours) / (int64_t)h);
+    acc->hour = r->hour;
+    acc->hours = h;
+    if (r->cell_min_mv < acc->cell_min_mv) { acc->cell_min_mv = r->cell_min_mv; }
+    if (r->cell_max_mv > acc->cell_max_mv) { acc->cell_max_mv = r->cell_max_mv; }
+    if (r->temp_min_deci_c < acc->temp_min_deci_c) { acc->temp_min_deci_c = r->temp_min_deci_c; }
+    if (r->temp_max_deci_c > acc->temp_max_deci_c) { acc->temp_max_deci_c = r->temp_max_deci_c; }
+    acc->charge_mah += r->charge_mah;
+    acc->discharge_mah += r->discharge_mah;
+    if (r->peak_charge_ma > acc->peak_charge_ma) { acc->peak_charge_ma = r->peak_charge_ma; }
+    if (r->peak_discharge_ma > acc->peak_discharge_ma) { acc->peak_discharge_ma = r->peak_discharge_ma; }
+    for (m = 0U; m < BMS_MODE_COUNT; m++) { acc->mode_s[m] += r->mode_s[m]; }
+    (*n)++;
+}
+
+static void hour_reset(void)
+{
+    s_hr.n = 0U;
+    s_hr.sum_mv = 0U;
+    s_hr.sum_t = 0;
+    s_hr.vmin = 0xFFFFU;
+    s_hr.vmax = 0U;
+    s_hr.tmin = 32767;
+    s_hr.tmax = -32768;
+    s_hr.peak_chg = 0U;
+    s_hr.peak_dchg = 0U;
+}
+
+static void hour_close(void)
+{
+    bms_history_rec_t r;
+    uint8_t m;
+
+    memset(&r, 0, sizeof(r));
+    r.hour = s_hr.hour++;
+    r.hours = 1U;
+    if (s_hr.n > 0U) {
+        r.cell_min_mv = s_hr.vmin;
+        r.cell_max_mv = s_hr.vmax;
+        r.cell_mean_mv = (uint16_t)(s_hr.sum_mv / s_hr.n);
+        r.temp_min_deci_c = s_hr.tmin;
+        r.temp_max_deci_c = s_hr.tmax;
+        r.temp_mean_deci_c = (int16_t)(s_hr.sum_t / (int32_t)s_hr.n);
+    }
+    r.charge_mah = (uint32_t)(s_hr.chg_mams / BMS_HIST_HOUR_MS);
+    r.discharge_mah = (uint32_t)(s_hr.dchg_mams / BMS_HIST_HOUR_MS);
+    s_hr.chg_mams %= BMS_HIST_HOUR_MS;
+    s_hr.dchg_mams %= BMS_HIST_HOUR_MS;
+    r.peak_charge_ma = s_hr.peak_chg;
+    r.peak_discharge_ma = s_hr.peak_dchg;
+    for (m = 0U; m < BMS_MODE_COUNT; m++) {
+        r.mode_s[m] = s_hr.mode_ms[m] / 1000U;
+        s_hr.mode_ms[m] %= 1000U;
+    }
+    hour_reset();
+
+    s_stats.hours_closed++;
+    if (HST_LOAD(&s_ready)) {
+        s_stats.dropped++;          /* NVM task stalled a whole hour */
+        return;
+    }
+    s_ready_rec = r;
+    HST_STORE(&s_ready, true);
+}
+
+/* ── Tier append ───────────────────────────────────────────────────── */
+
+typedef enum { APPEND_OK, APPEND_FAIL, APPEND_LATER } append_t;
+
+static append_t rotate(uint8_t tier)
+{
+    tier_t *t = &s_tier[tier];
+    uint8_t next = t->open ? (uint8_t)((t->sector + 1U) % BMS_NVM_HIST_SECTORS_PER_TIER) : 0U;
+    uint8_t h[HST_HDR_LEN];
+
+    /* Nothing changes until the erase is done, so a retry picks `next` again */
+    if (!bms_nvm_erase_sector(sector_addr(tier, next))) { return APPEND_LATER; }
+    s_stats.rotations++;
+    put_u32(&h[0], HST_MAGIC + tier);
+    put_u32(&h[4], t->seq + 1U);
+    t->sector = next;
+    t->open = false;
+    if (!bms_nvm_program(sector_addr(tier, next), h, HST_HDR_LEN)) {
+        s_stats.verify_fail++;
+        return APPEND_FAIL;
+    }
+    t->open = true;
+    t->full = false;
+    t->seq++;
+    t->offset = HST_HDR_LEN;
+    t->in_sector = 0U;
+    memset(&t->base, 0, sizeof(t->base));
+    return APPEND_OK;
+}
+
+static append_t append(uint8_t tier, const bms_history_rec_t *r)
+{
+    tier_t *t = &s_tier[tier];
+    uint8_t buf[HST_REC_MAX];
+    append_t st;
+    uint8_t n;
+
+    if (!t->open || t->full) {
+        st = rotate(tier);
+        if (st != APPEND_OK) { return st; }
+    }
+    n = rec_encode(r, &t->base, buf);
+    if (t->offset + n > BMS_NVM_SECTOR_SIZE) {
+        st = rotate(tier);
+        if (st != APPEND_OK) { return st; }
+        n = rec_encode(r, &t->base, buf);
+    }
+    if (!bms_nvm_program(sector_addr(tier, t->sector) + t->offset, buf, n)) {
+        s_stats.verify_fail++;
+        t->full = true;             /* never program over partial bytes */
+        return APPEND_FAIL;
+    }
+    t->offset += n;
+    t->in_sector++;
+    t->base = *r;
+    t->any = true;
+    t->last_hour = r->hour;
+    s_stats.records[tier]++;
+    return APPEND_OK;
+}
+
+/* ── Mount ─────────────────────────────────────────────────────────── */
+
+static void visit_last(const bms_history_rec_t *r, void *ctx)
+{
+    tier_t *t = (tier_t *)ctx;
+    t->any = true;
+    t->last_hour = r->hour;
+}
+
+/* Records of the tier below not yet rolled into tier ctx */
+static void visit_rebuild(const bms_history_rec_t *r, void *ctx)
+{
+    uint8_t tier = *(const uint8_t *)ctx;
+
+    if (!s_tier[tier].any || r->hour > s_tier[tier].last_hour) {
+        merge(&s_acc[tier], &s_acc_n[tier], r);
+    }
+}
+
+static void mount_tier(uint8_t tier)
+{
+    tier_t *t = &s_tier[tier];
+    uint32_t seq;
+    uint8_t s;
+
+    memset(t, 0, sizeof(*t));
+    for (s = 0U; s < BMS_NVM_HIST_SECTORS_PER_TIER; s++) {
+        if (sector_seq(tier, s, &seq) && (!t->open || seq > t->seq)) {
+            t->open = true;
+            t->sector = s;
+            t->seq = seq;
+        }
+    }
+    if (t->open) {
+        (void)scan_sector(sector_addr(tier, t->sector), NULL, NULL, t);
+    }
+    (void)scan_tier(tier, visit_last, t);
+}
+
+/* ── Public API ────────────────────────────────────────────────────── */
+
+void bms_history_init(void)
+{
+    uint32_t next_hour = 0U;
+    uint8_t tier;
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(s_acc, 0, sizeof(s_acc));
+    memset(s_acc_n, 0, sizeof(s_acc_n));
+    memset(&s_hr, 0, sizeof(s_hr));
+    hour_reset();
+    s_pend = false;
+    HST_STORE(&s_ready, false);
+
+    for (tier = 0U; tier < BMS_HIST_TIERS; tier++) {
+        mount_tier(tier);
+        if (s_tier[tier].any && s_tier[tier].last_hour + 1U > next_hour) {
+            next_hour = s_tier[tier].last_hour + 1U;
+        }
+    }
+    for (tier = 1U; tier < BMS_HIST_TIERS; tier++) {
+        uint8_t below = (uint8_t)(tier - 1U);
+        (void)scan_tier(below, visit_rebuild, &tier);
+    }
+    s_hr.hour = next_hour;
+}
+
+void bms_history_sample(const bms_pack_data_t *pack)
+{
+    uint32_t now = hal_tick_ms();
+    uint32_t dt;
+    int32_t sum_t = 0;
+    uint8_t mod, i;
+
+    if (!s_hr.started) {
+        s_hr.started = true;
+        s_hr.last_tick = now;
+    }
+    dt = now - s_hr.last_tick;
+    s_hr.last_tick = now;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (i = 0U; i < BMS_TEMPS_PER_MODULE; i++) {
+            sum_t += pack->modules[mod].temp_deci_c[i];
+        }
+    }
+    s_hr.n++;
+    s_hr.sum_mv += pack->avg_cell_mv;
+    s_hr.sum_t += sum_t / (int32_t)BMS_TOTAL_TEMP_SENSORS;
+    if (pack->min_cell_mv < s_hr.vmin) { s_hr.vmin = pack->min_cell_mv; }
+    if (pack->max_cell_mv > s_hr.vmax) { s_hr.vmax = pack->max_cell_mv; }
+    if (pack->min_temp_deci_c < s_hr.tmin) { s_hr.tmin = pack->min_temp_deci_c; }
+    if (pack->max_temp_deci_c > s_hr.tmax) { s_hr.tmax = pack->max_temp_deci_c; }
+
+    if (pack->pack_current_ma > 0) {
+        s_hr.chg_mams += (uint64_t)pack->pack_current_ma * dt;
+        if ((uint32_t)pack->pack_current_ma > s_hr.peak_chg) {
+            s_hr.peak_chg = (uint32_t)pack->pack_current_ma;
+        }
+    } else {
+        uint32_t ma = (uint32_t)(-(int64_t)pack->pack_current_ma);
+        s_hr.dchg_mams += (uint64_t)ma * dt;
+        if (ma > s_hr.peak_dchg) { s_hr.peak_dchg = ma; }
+    }
+    if ((uint32_t)pack->mode < (uint32_t)BMS_MODE_COUNT) {
+        s_hr.mode_ms[pack->mode] += dt;
+    }
+
+    s_hr.ms += dt;
+    if (s_hr.ms >= BMS_HIST_HOUR_MS) {
+        s_hr.ms -= BMS_HIST_HOUR_MS;
+        hour_close();
+    }
+}
+
+bool bms_history_flush(void)
+{
+    uint8_t tier;
+
+    if (!s_pend) {
+        if (!HST_LOAD(&s_ready)) { return false; }
+        s_pend_rec = s_ready_rec;
+        s_pend_tier = (uint8_t)HIST_HOUR;
+        s_pend = true;
+        HST_STORE(&s_ready, false);
+    }
+
+    /* A record waiting on the erase budget keeps its place; the roll-ups
+     * above it are merged only once it is in flash (or failed for good) */
+    for (;;) {
+        if (append(s_pend_tier, &s_pend_rec) == APPEND_LATER) { return true; }
+        tier = (uint8_t)(s_pend_tier + 1U);
+        if (tier >= BMS_HIST_TIERS) { break; }
+        merge(&s_acc[tier], &s_acc_n[tier], &s_pend_rec);
+        if (s_acc_n[tier] < k_ratio[tier]) { break; }
+        s_pend_rec = s_acc[tier];
+        s_pend_tier = tier;
+        s_acc_n[tier] = 0U;
+    }
+    s_pend = false;
+    return true;
+}
+
+static void visit_count(const bms_history_rec_t *r, void *ctx)
+{
+    (void)r;
+    (*(uint16_t *)ctx)++;
+}
+
+uint16_t bms_history_count(bms_history_tier_t tier)
+{
+    uint16_t n = 0U;
+
+    if ((uint32_t)tier >= BMS_HIST_TIERS) { return 0U; }
+    (void)scan_tier((uint8_t)tier, visit_count, &n);
+    return n;
+}
+
+typedef struct {
+    uint16_t          want;         /* oldest-first index */
+    uint16_t          at;
+    bool              found;
+    bms_history_rec_t *out;
+} pick_t;
+
+static void visit_pick(const bms_history_rec_t *r, void *ctx)
+{
+    pick_t *p = (pick_t *)ctx;
+    if (p->at++ == p->want) {
+        *p->out = *r;
+        p->found = true;
+    }
+}
+
+bool bms_history_get(bms_history_tier_t tier, uint16_t n, bms_history_rec_t *out)
+{
+    uint16_t count = bms_history_count(tier);
+    pick_t pick;
+
+    if (n >= count) { return false; }
+    pick.want = (uint16_t)(count - 1U - n);
+    pick.at = 0U;
+    pick.found = false;
+    pick.out = out;
+    (void)scan_tier((uint8_t)tier, visit_pick, &pick);
+    return pick.found;
+}
+
+uint16_t bms_history_decode_sector(const uint8_t *img, uint32_t len,
+                                   bms_history_rec_t *out, uint16_t max)
+{
+    bms_history_rec_t base;
+    uint32_t magic, off = HST_HDR_LEN;
+    uint16_t n = 0U;
+
+    if (len < HST_HDR_LEN) { return 0U; }
+    magic = get_u32(img);
+    if (magic < HST_MAGIC || magic >= HST_MAGIC + BMS_HIST_TIERS) { return 0U; }
+
+    memset(&base, 0, sizeof(base));
+    while (off < len && n < max) {
+        uint32_t used = 0U;
+        if (rec_parse(&img[off], len - off, &base, &out[n], &used) != PARSE_OK) { break; }
+        base = out[n];
+        off += used;
+        n++;
+    }
+    return n;
+}
+
+bool bms_history_read_page(uint16_t page, uint8_t *out)
+{
+    if (page >= HST_PAGES) { return false; }
+    bms_hal_nvm_read(BMS_NVM_HIST_BASE + (uint32_t)page * BMS_NVM_PAGE_SIZE,
+                     out, BMS_NVM_PAGE_SIZE);
+    return true;
+}
+
+void bms_history_get_stats(bms_history_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -13,6 +13,11 @@
  *     - Bus recovery attempted before declaring failure
  *   P2-07: Stack voltage vs sum-of-cells cross-check (Dave, Yara, Priya)
  *     - |sum(cells) - stack_mv| > 2% → plausibility flag
+ *
+ * Summary mode (BMS_ACQ_SUMMARY) offloads min/max/sum/avg to the AFE:
+ *   tick N:  fetch DASTATUS5 requested on tick N−1, then request again
+ *   → pack extremes every tick for 2 transactions/module, instead of
+ *     23 transactions/module spread over a 220 ms sweep.
  */
 
 #include "bms_monitor.h"
@@ -20,6 +25,9 @@
 #include "bms_hal.h"
 #include "bms_config.h"
 #include "bms_soc.h"
+#include "bms_cell_soc.h"
+#include "bms_soh.h"
+#include "bms_sop.h"
 #include "bms_current_limit.h"
 #include "bms_balance.h"
 #include <string.h>
@@ -29,6 +37,17 @@ static uint8_t  s_current_module;
 static bool     s_scan_complete;
 static uint32_t s_scan_count;
 
+/* Summary-mode state */
+static bms_acq_mode_t s_mode;
+static uint32_t s_summary_inflight;    /* bit m: DASTATUS5 requested */
+static uint32_t s_summary_valid;       /* bit m: summary holds data */
+static uint32_t s_stack_mv[BMS_NUM_MODULES];   /* last good summary, 0 = none */
+static uint32_t s_detail_pending;      /* bit m: on-demand detail */
+static uint8_t  s_detail_rr;           /* round-robin among pending */
+static uint8_t  s_detail_tick;
+
+_Static_assert(BMS_NUM_MODULES <= 32U, "Module bitmaps are uint32_t");
+
 void bms_monitor_init(bms_pack_data_t *pack)
 {
     uint16_t i;
@@ -59,8 +78,18 @@ void bms_monitor_init(bms_pack_data_t *pack)
     s_current_module = 0U;
     s_scan_complete = false;
     s_scan_count = 0U;
+    s_mode = (BMS_ACQ_SUMMARY_ENABLED != 0U) ? BMS_ACQ_SUMMARY : BMS_ACQ_FULL_SCAN;
+    s_summary_inflight = 0U;
+    s_summary_valid = 0U;
+    memset(s_stack_mv, 0, sizeof(s_stack_mv));
+    s_detail_pending = 0U;
+    s_detail_rr = 0U;
+    s_detail_tick = 0U;
 
     bms_soc_init(pack->soc_hundredths);
+    bms_cell_soc_init();
+    bms_soh_init();
+    bms_sop_init(pack);
     bms_balance_init(&s_balance);
 }
 
@@ -148,13 +177,13 @@ static void cross_check_module_temps(bms_module_data_t *mod,
     }
 }
 
-void bms_monitor_read_module(bms_pack_data_t *pack, uint8_t mod_idx)
+/**
+ * P0-02: Track consecutive I2C failures for a module.
+ * @return true if rc indicates success
+ */
+static bool note_comm_result(bms_pack_data_t *pack, uint8_t mod_idx, int32_t rc)
 {
     bms_module_data_t *m = &pack->modules[mod_idx];
-    uint8_t cell, sens;
-
-    /* Read all cell voltages */
-    int32_t rc = bq76952_read_all_cells(mod_idx, m->cell_mv);
 
     if (rc != 0) {
         /* P0-02: I2C failure tracking with bus recovery */
@@ -175,12 +204,26 @@ void bms_monitor_read_module(bms_pack_data_t *pack, uint8_t mod_idx)
             BMS_LOG("P0-02: comm_loss LATCHED — module %u, %u consecutive failures",
                     mod_idx, m->i2c_fail_count);
         }
-        return;
+        return false;
     }
 
     /* Successful read — reset failure counter */
     m->comm_ok = true;
     m->i2c_fail_count = 0U;
+    return true;
+}
+
+void bms_monitor_read_module(bms_pack_data_t *pack, uint8_t mod_idx)
+{
+    bms_module_data_t *m = &pack->modules[mod_idx];
+    uint8_t cell, sens;
+
+    /* Read all cell voltages */
+    int32_t rc = bq76952_read_all_cells(mod_idx, m->cell_mv);
+
+    if (!note_comm_result(pack, mod_idx, rc)) {
+        return;
+    }
 
     /* Copy into flat pack array */
     for (cell = 0U; cell < BMS_SE_PER_MODULE; cell++) {
@@ -235,6 +278,10 @@ void bms_monitor_read_module(bms_pack_data_t *pack, uint8_t mod_idx)
         }
     }
 
+    /* Per-SE SoC and the R step check: this module only, at the shared current */
+    bms_cell_soc_update_module(pack, mod_idx);
+    bms_soh_module_scan(pack, mod_idx);
+
     /* Read temperatures with P0-01 sensor fault detection */
     for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
         int16_t raw_temp = bq76952_read_temperature(mod_idx, sens);
@@ -262,6 +309,66 @@ void bms_monitor_read_module(bms_pack_data_t *pack, uint8_t mod_idx)
     }
 }
 
+/* ── Aggregation helpers ───────────────────────────────────────────── */
+
+/**
+ * P2-07: Inter-module temperature comparison
+ * Flag if one module's average temp is >BMS_INTER_MODULE_TEMP_DELTA_DC
+ * different from its neighbors — indicates sensor fault or localized issue.
+ */
+static void check_inter_module_temps(bms_pack_data_t *pack)
+{
+    int16_t mod_avg_temp[BMS_NUM_MODULES];
+    uint8_t m2;
+
+    /* Compute per-module average temperature (non-faulted sensors only) */
+    for (m2 = 0U; m2 < BMS_NUM_MODULES; m2++) {
+        int32_t sum_t = 0;
+        uint8_t count = 0U;
+        uint8_t s2;
+        for (s2 = 0U; s2 < BMS_TEMPS_PER_MODULE; s2++) {
+            if (!pack->modules[m2].sensor_fault[s2].faulted) {
+                sum_t += (int32_t)pack->modules[m2].temp_deci_c[s2];
+                count++;
+            }
+        }
+        mod_avg_temp[m2] = (count > 0U) ? (int16_t)(sum_t / (int32_t)count) : 0;
+    }
+
+    /* Compare adjacent modules */
+    for (m2 = 1U; m2 < BMS_NUM_MODULES; m2++) {
+        int16_t delta = mod_avg_temp[m2] - mod_avg_temp[m2 - 1U];
+        if (delta < 0) { delta = -delta; }
+        if (delta > BMS_INTER_MODULE_TEMP_DELTA_DC) {
+            pack->faults.plausibility = 1U;
+            pack->has_warning = true;
+            BMS_LOG("P2-07: Inter-module temp delta — mod %u=%d, mod %u=%d (delta=%d)",
+                    m2 - 1U, mod_avg_temp[m2 - 1U], m2, mod_avg_temp[m2], delta);
+        }
+    }
+}
+
+/* Cell imbalance + P0-03 bus voltage — shared by both acquisition modes */
+static void finish_aggregate(bms_pack_data_t *pack)
+{
+    uint16_t max_mv = pack->max_cell_mv;
+    uint16_t min_mv = pack->min_cell_mv;
+
+    /* Cell imbalance */
+    if (max_mv > 0U && min_mv < 0xFFFFU &&
+        (uint16_t)(max_mv - min_mv) > BMS_IMBALANCE_WARN_MV) {
+        pack->faults.imbalance = 1U;
+        pack->has_warning = true;
+    } else {
+        pack->faults.imbalance = 0U;
+    }
+
+    /* P0-03: Read actual bus voltage for pre-charge reference */
+    /* P3-04: Use single calibration constant (Dave — ADC scaling consistency) */
+    pack->bus_voltage_mv = (uint32_t)hal_adc_read(ADC_BUS_VOLTAGE)
+                         * BMS_ADC_BUS_VOLTAGE_SCALE_NUM / BMS_ADC_BUS_VOLTAGE_SCALE_DEN;
+}
+
 void bms_monitor_aggregate(bms_pack_data_t *pack)
 {
     uint16_t i;
@@ -298,74 +405,253 @@ void bms_monitor_aggregate(bms_pack_data_t *pack)
     pack->max_temp_deci_c = max_temp;
     pack->min_temp_deci_c = min_temp;
 
-    /* P2-07: Inter-module temperature comparison
-     * Flag if one module's average temp is >BMS_INTER_MODULE_TEMP_DELTA_DC
-     * different from its neighbors — indicates sensor fault or localized issue. */
-    {
-        int16_t mod_avg_temp[BMS_NUM_MODULES];
-        uint8_t m2;
-
-        /* Compute per-module average temperature (non-faulted sensors only) */
-        for (m2 = 0U; m2 < BMS_NUM_MODULES; m2++) {
-            int32_t sum_t = 0;
-            uint8_t count = 0U;
-            uint8_t s2;
-            for (s2 = 0U; s2 < BMS_TEMPS_PER_MODULE; s2++) {
-                if (!pack->modules[m2].sensor_fault[s2].faulted) {
-                    sum_t += (int32_t)pack->modules[m2].temp_deci_c[s2];
-                    count++;
+    check_inter_module_temps(pack);
+    finish_aggregate(pack);
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ * Summary acquisition (BQ76952 DASTATUS5 fast path)
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static bool summary_needs_detail(const bms_bq_summary_t *sm)
+{
+    return (sm->max_cell_mv >= BMS_SE_OV_WARN_MV) ||
+           (sm->min_cell_mv > 0U && sm->min_cell_mv <= BMS_SE_UV_WARN_MV) ||
+           (sm->max_temp_deci_c >= BMS_SE_OT_WARN_DECI_C);
+}
+
+/* Fetch last tick's summaries, then queue the next round */
+static void summary_acquire(bms_pack_data_t *pack)
+{
+    uint8_t mod;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        uint32_t bit = 1UL << mod;
+        bms_module_data_t *m = &pack->modules[mod];
+
+        bool fetched = (s_summary_inflight & bit) != 0U;
+        int32_t rc;
+
+        if (fetched) {
+            rc = bq76952_fetch_summary(mod, &m->summary);
+            if (note_comm_result(pack, mod, rc)) {
+                s_summary_valid |= bit;
+                if (summary_needs_detail(&m->summary)) {
+                    s_detail_pending |= bit;
                 }
+            } else {
+                s_summary_valid &= ~bit;
             }
-            mod_avg_temp[m2] = (count > 0U) ? (int16_t)(sum_t / (int32_t)count) : 0;
         }
 
-        /* Compare adjacent modules */
-        for (m2 = 1U; m2 < BMS_NUM_MODULES; m2++) {
-            int16_t delta = mod_avg_temp[m2] - mod_avg_temp[m2 - 1U];
-            if (delta < 0) { delta = -delta; }
-            if (delta > BMS_INTER_MODULE_TEMP_DELTA_DC) {
-                pack->faults.plausibility = 1U;
-                pack->has_warning = true;
-                BMS_LOG("P2-07: Inter-module temp delta — mod %u=%d, mod %u=%d (delta=%d)",
-                        m2 - 1U, mod_avg_temp[m2 - 1U], m2, mod_avg_temp[m2], delta);
+        rc = bq76952_request_summary(mod);
+        if (rc == 0) {
+            s_summary_inflight |= bit;
+        } else {
+            s_summary_inflight &= ~bit;
+            /* One failure per module per tick toward P0-02 */
+            if (!fetched) { (void)note_comm_result(pack, mod, rc); }
+        }
+    }
+}
+
+/**
+ * Pack extremes from on-chip summaries. The AFE has no notion of our
+ * P0-01 sensor faults, so a module with a faulted thermistor contributes
+ * its non-faulted per-sensor readings instead of its chip temperatures.
+ * A module whose summary is missing this tick adds its last good stack
+ * voltage; one that never had one is left out and the pack voltage is
+ * scaled from the cells that were summed — precharge compares it to the
+ * bus, so it must not read low by a module.
+ */
+static void summary_aggregate(bms_pack_data_t *pack)
+{
+    uint32_t sum_mv = 0U;
+    uint32_t cells = 0U;
+    uint16_t max_mv = 0U;
+    uint16_t min_mv = 0xFFFFU;
+    int16_t  max_temp = -400;
+    int16_t  min_temp = 7000;
+    uint8_t  mod, sens;
+
+    if (s_summary_valid == 0U) { return; }
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        const bms_module_data_t *m = &pack->modules[mod];
+        bool any_faulted = false;
+
+        if ((s_summary_valid & (1UL << mod)) != 0U) {
+            s_stack_mv[mod] = m->summary.stack_mv;
+        }
+        if (s_stack_mv[mod] != 0U) {
+            sum_mv += s_stack_mv[mod];
+            cells += BMS_SE_PER_MODULE;
+        }
+        if ((s_summary_valid & (1UL << mod)) == 0U) { continue; }
+
+        if (m->summary.max_cell_mv > max_mv) { max_mv = m->summary.max_cell_mv; }
+        if (m->summary.min_cell_mv > 0U && m->summary.min_cell_mv < min_mv) {
+            min_mv = m->summary.min_cell_mv;
+        }
+
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            if (m->sensor_fault[sens].faulted) { any_faulted = true; }
+        }
+        if (!any_faulted) {
+            if (m->summary.max_temp_deci_c > max_temp) { max_temp = m->summary.max_temp_deci_c; }
+            if (m->summary.min_temp_deci_c < min_temp) { min_temp = m->summary.min_temp_deci_c; }
+        } else {
+            for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+                if (m->sensor_fault[sens].faulted) { continue; }
+                if (m->temp_deci_c[sens] > max_temp) { max_temp = m->temp_deci_c[sens]; }
+                if (m->temp_deci_c[sens] < min_temp) { min_temp = m->temp_deci_c[sens]; }
             }
         }
     }
 
-    /* Cell imbalance */
-    if (max_mv > 0U && min_mv < 0xFFFFU &&
-        (uint16_t)(max_mv - min_mv) > BMS_IMBALANCE_WARN_MV) {
-        pack->faults.imbalance = 1U;
-        pack->has_warning = true;
-    } else {
-        pack->faults.imbalance = 0U;
+    pack->max_cell_mv = max_mv;
+    pack->min_cell_mv = min_mv;
+    if (cells > 0U) {
+        pack->avg_cell_mv = (uint16_t)(sum_mv / cells);
+        pack->pack_voltage_mv = sum_mv * (uint32_t)BMS_SE_PER_PACK / cells;
     }
+    pack->max_temp_deci_c = max_temp;
+    pack->min_temp_deci_c = min_temp;
 
-    /* P0-03: Read actual bus voltage for pre-charge reference */
-    /* P3-04: Use single calibration constant (Dave — ADC scaling consistency) */
-    pack->bus_voltage_mv = (uint32_t)hal_adc_read(ADC_BUS_VOLTAGE)
-                         * BMS_ADC_BUS_VOLTAGE_SCALE_NUM / BMS_ADC_BUS_VOLTAGE_SCALE_DEN;
+    finish_aggregate(pack);
 }
 
-void bms_monitor_run(bms_pack_data_t *pack)
+/* Next n modules of the detail rotation, stopping at the end of it; n
+ * spanning the whole rotation restarts it, as the full scan does */
+static void summary_rotate(bms_pack_data_t *pack, uint32_t n)
 {
-    s_scan_complete = false;
-
-    bms_monitor_read_module(pack, s_current_module);
-    s_current_module++;
+    uint32_t left = BMS_NUM_MODULES - (uint32_t)s_current_module;
 
+    if (n >= BMS_NUM_MODULES) {
+        s_current_module = 0U;
+        n = BMS_NUM_MODULES;
+    } else if (n > left) {
+        n = left;
+    }
+    while (n-- > 0U) {
+        s_detail_pending &= ~(1UL << s_current_module);
+        bms_monitor_read_module(pack, s_current_module);
+        s_current_module++;
+    }
     if (s_current_module >= BMS_NUM_MODULES) {
         s_current_module = 0U;
         s_scan_complete = true;
         s_scan_count++;
-        bms_monitor_aggregate(pack);
+        check_inter_module_temps(pack);
+    }
+}
+
+/* At most one per-cell detail read per tick. The rotation keeps its own
+ * tick: per-SE SoC and the R step check only run on a detail read, so a
+ * module parked past a warning threshold (pending again every tick) must
+ * not starve the other 21. On-demand reads take the ticks in between.
+ * A slow scan rotates through as many modules as dt spans. */
+static void summary_detail(bms_pack_data_t *pack, uint32_t dt_ms)
+{
+    uint32_t n = dt_ms / (BMS_MONITOR_PERIOD_MS * BMS_ACQ_DETAIL_EVERY_TICKS);
+
+    if (n > 1U) {
+        s_detail_tick = 0U;
+        summary_rotate(pack, n);
+        return;
+    }
+    if (++s_detail_tick >= BMS_ACQ_DETAIL_EVERY_TICKS) {
+        s_detail_tick = 0U;
+        summary_rotate(pack, 1U);
+        return;
     }
 
-    bms_soc_update(pack, BMS_MONITOR_PERIOD_MS);
+    if (s_detail_pending != 0U) {
+        uint8_t k;
+        for (k = 0U; k < BMS_NUM_MODULES; k++) {
+            uint8_t mod = (uint8_t)((s_detail_rr + k) % BMS_NUM_MODULES);
+            if ((s_detail_pending & (1UL << mod)) != 0U) {
+                s_detail_pending &= ~(1UL << mod);
+                s_detail_rr = (uint8_t)((mod + 1U) % BMS_NUM_MODULES);
+                bms_monitor_read_module(pack, mod);
+                return;
+            }
+        }
+    }
+}
+
+void bms_monitor_set_mode(bms_acq_mode_t mode)
+{
+    s_mode = mode;
+    s_summary_inflight = 0U;
+    s_summary_valid = 0U;
+    memset(s_stack_mv, 0, sizeof(s_stack_mv));
+    s_detail_pending = 0U;
+    s_detail_tick = 0U;
+}
+
+bms_acq_mode_t bms_monitor_get_mode(void) { return s_mode; }
+
+void bms_monitor_request_detail(uint8_t module_id)
+{
+    if (module_id < BMS_NUM_MODULES) {
+        s_detail_pending |= 1UL << module_id;
+    }
+}
+
+void bms_monitor_run(bms_pack_data_t *pack)
+{
+    bms_monitor_run_dt(pack, BMS_MONITOR_PERIOD_MS);
+}
+
+void bms_monitor_run_dt(bms_pack_data_t *pack, uint32_t dt_ms)
+{
+    s_scan_complete = false;
+
+    if (s_mode == BMS_ACQ_SUMMARY) {
+        summary_acquire(pack);
+        summary_detail(pack, dt_ms);
+        summary_aggregate(pack);
+    } else {
+        /* The modules this dt would have swept, up to the end of the
+         * sweep; a dt spanning a whole sweep restarts it, so every slow
+         * scan is one fresh sweep */
+        uint32_t n = dt_ms / BMS_MONITOR_PERIOD_MS;
+        uint32_t left = BMS_NUM_MODULES - (uint32_t)s_current_module;
+
+        if (n == 0U) { n = 1U; }
+        if (n >= BMS_NUM_MODULES) {
+            s_current_module = 0U;
+            n = BMS_NUM_MODULES;
+        } else if (n > left) {
+            n = left;
+        }
+        while (n-- > 0U) {
+            bms_monitor_read_module(pack, s_current_module);
+            s_current_module++;
+        }
+        if (s_current_module >= BMS_NUM_MODULES) {
+            s_current_module = 0U;
+            s_scan_complete = true;
+            s_scan_count++;
+            bms_monitor_aggregate(pack);
+        }
+    }
+
+    /* Predict every run; correct from a fresh pack average (each summary
+     * tick, or a completed sweep) — bms_soc throttles the rate */
+    bms_soc_update(pack, dt_ms);
+    if (s_mode == BMS_ACQ_SUMMARY || s_scan_complete) {
+        bms_soc_correct(pack);
+    }
+    bms_cell_soc_publish(pack);
+    bms_soh_update(pack, dt_ms);
+    bms_current_limit_set_capacity(bms_soh_get_capacity_mah());
     bms_current_limit_compute(pack, &pack->charge_limit_ma, &pack->discharge_limit_ma);
+    bms_sop_update(pack, dt_ms);
     bms_balance_run(&s_balance, pack);
 
-    pack->uptime_ms += BMS_MONITOR_PERIOD_MS;
+    pack->uptime_ms += dt_ms;
 }
 
 uint8_t  bms_monitor_get_scan_index(void) { return s_current_module; }
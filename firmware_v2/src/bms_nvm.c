@@ -1,11 +1,33 @@
 /**
  * @file bms_nvm.c
- * @brief NVM fault logging — expanded
+ * @brief NVM fault logging — log-structured, wear-levelled journal
  *
  * Street Smart Edition.
  * Reviewer findings addressed:
  *   P2-05: Reset events logged to NVM (Yara)
  *   P1-02: IWDG reset events logged (Henrik)
+ *   P3-06: Power loss during a write never corrupts committed data (Dave)
+ *
+ * The old layout rewrote the same head/count bytes (plus a shadow copy)
+ * on every fault: six programs per event, all wear on two cells. Now
+ * every write is an append:
+ *
+ *   record   [0..3] seq   [4] type   [5] events   [6..7] payload len
+ *            [8..]  payload          [last 4] CRC-32 over header + payload
+ *   SNAPSHOT persistent block + live fault log, oldest first
+ *   FAULTS   up to BMS_NVM_COMMIT_MAX_EVENTS events staged in one cycle
+ *   PERSIST  persistent block
+ *
+ * A sector always opens with a SNAPSHOT, so mount only needs the newest
+ * sector with a valid one. When a record does not fit, the next sector in
+ * the ring is erased and a fresh SNAPSHOT written there — the old sector
+ * stays intact until then, so a torn rotation falls back to it. A torn
+ * record at the tail fails its CRC; mount stops there and the next commit
+ * rotates instead of programming over the partial bytes.
+ *
+ * A rotation refused by the erase budget (or waiting for its erase) sets
+ * rotate_due; everything meanwhile stays in the RAM state that the
+ * rotation's SNAPSHOT writes, and the NVM task's next commit retries.
  */
 
 #include "bms_nvm.h"
@@ -13,83 +35,329 @@
 #include "bms_config.h"
 #include <string.h>
 
-#define NVM_ADDR_FAULT_LOG    0x0000U
-#define NVM_ADDR_FAULT_HEAD   (NVM_ADDR_FAULT_LOG + \
-    (uint32_t)(BMS_NVM_FAULT_LOG_SIZE * sizeof(bms_nvm_fault_event_t)))
-#define NVM_ADDR_FAULT_COUNT  (NVM_ADDR_FAULT_HEAD + 1U)
-#define NVM_ADDR_PERSISTENT   (NVM_ADDR_FAULT_COUNT + 1U)
+/* Fault log publication: buffer before index (release), index before buffer (acquire) */
+#if defined(__GNUC__)
+  #define NVM_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define NVM_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  #define NVM_LOAD(p)       (*(p))
+  #define NVM_STORE(p, v)   (*(p) = (v))
+#endif
 
-/* P3-06: Shadow/staging area for atomic writes (Dave — NVM write atomicity)
- * Offset the shadow area after the active area to avoid overlap. */
-#define NVM_SHADOW_OFFSET     0x1000U
-#define NVM_ADDR_SHADOW_LOG   (NVM_ADDR_FAULT_LOG + NVM_SHADOW_OFFSET)
-#define NVM_ADDR_SHADOW_HEAD  (NVM_ADDR_FAULT_HEAD + NVM_SHADOW_OFFSET)
-#define NVM_ADDR_SHADOW_COUNT (NVM_ADDR_FAULT_COUNT + NVM_SHADOW_OFFSET)
-#define NVM_ADDR_SHADOW_PERSISTENT (NVM_ADDR_PERSISTENT + NVM_SHADOW_OFFSET)
+#define REC_HDR_LEN     8U
+#define REC_CRC_LEN     4U
+#define REC_OVERHEAD    (REC_HDR_LEN + REC_CRC_LEN)
 
-void bms_nvm_init(bms_nvm_ctx_t *ctx)
+#define REC_SNAPSHOT    0x01U
+#define REC_FAULTS      0x02U
+#define REC_PERSIST     0x03U
+
+#define EV_LEN          ((uint32_t)sizeof(bms_nvm_fault_event_t))
+#define PERSIST_LEN     ((uint32_t)sizeof(bms_nvm_persistent_t))
+#define REC_MAX_LEN     (REC_OVERHEAD + PERSIST_LEN + BMS_NVM_FAULT_LOG_SIZE * EV_LEN)
+
+_Static_assert(REC_MAX_LEN + REC_OVERHEAD + BMS_NVM_COMMIT_MAX_EVENTS * EV_LEN
+               <= BMS_NVM_SECTOR_SIZE, "Snapshot + one commit must fit a sector");
+_Static_assert((BMS_NVM_SECTOR_SIZE % BMS_NVM_PAGE_SIZE) == 0U, "Sector must be whole pages");
+_Static_assert(BMS_NVM_JOURNAL_SECTORS >= 2U, "Rotation needs a spare sector");
+_Static_assert(BMS_NVM_COMMIT_MAX_EVENTS <= 255U, "Event count is one byte");
+
+/* Record assembly buffer — NVM is written from one task at a time */
+static uint8_t s_rec[REC_MAX_LEN];
+
+/* Erase budget (NVM task): one erase started per release, one running */
+static bool     s_erase_free = true;
+static bool     s_erasing;
+static uint32_t s_erase_addr;
+
+/* ── CRC-32 (IEEE, reflected), nibble table ────────────────────────── */
+
+uint32_t bms_nvm_crc32(const uint8_t *p, uint32_t len)
 {
-    memset(ctx, 0, sizeof(*ctx));
-    bms_nvm_load_persistent(ctx);
+    static const uint32_t k_tab[16] = {
+        0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+        0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+        0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+        0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU
+    };
+    uint32_t c = 0xFFFFFFFFU;
+    uint32_t i;
+
+    for (i = 0U; i < len; i++) {
+        c ^= p[i];
+        c = (c >> 4U) ^ k_tab[c & 0x0FU];
+        c = (c >> 4U) ^ k_tab[c & 0x0FU];
+    }
+    return ~c;
 }
 
-/* P3-06: Atomic NVM write via shadow/staging area (Dave — carried from V1)
- *
- * Write sequence:
- *   1. Write data to shadow/staging area
- *   2. Read back shadow and verify against RAM
- *   3. If verified, commit (copy shadow to active area)
- *   4. Power loss during step 1-2 → active area untouched
- *   5. Power loss during step 3 → worst case: stale active data, shadow has new
- *
- * This ensures power loss during write doesn't corrupt the active entry.
- */
-static bool nvm_atomic_write(uint32_t active_addr, uint32_t shadow_addr,
-                              const void *data, uint16_t len)
+/* ── Flash access ──────────────────────────────────────────────────── */
+
+void bms_nvm_release(void)
+{
+    s_erase_free = true;
+}
+
+bool bms_nvm_erase_sector(uint32_t addr)
 {
-    uint8_t verify_buf[sizeof(bms_nvm_fault_event_t)]; /* large enough for any single write */
+    addr -= addr % BMS_NVM_SECTOR_SIZE;
+    if (s_erasing) {
+        if (bms_hal_nvm_erase_busy()) { return false; }
+        s_erasing = false;
+        if (addr == s_erase_addr) { return true; }
+    }
+    if (!s_erase_free) { return false; }
 
-    /* Step 1: Write to shadow area */
-    bms_hal_nvm_write(shadow_addr, data, len);
+    s_erase_free = false;
+    s_erase_addr = addr;
+    bms_hal_nvm_erase_start(addr);
+    if (!bms_hal_nvm_erase_busy()) { return true; }
+    s_erasing = true;
+    return false;
+}
 
-    /* Step 2: Read back and verify */
-    if (len <= (uint16_t)sizeof(verify_buf)) {
-        bms_hal_nvm_read(shadow_addr, verify_buf, len);
-        if (memcmp(verify_buf, data, len) != 0) {
-            BMS_LOG("P3-06: NVM shadow verify failed at 0x%04X", (unsigned)shadow_addr);
+static uint32_t sector_addr(uint8_t sector)
+{
+    return (uint32_t)sector * BMS_NVM_SECTOR_SIZE;
+}
+
+/* Program in page-sized pieces, then read back and compare */
+bool bms_nvm_program(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    uint8_t chk[32];
+    uint32_t done = 0U;
+
+    while (done < len) {
+        uint32_t room = BMS_NVM_PAGE_SIZE - ((addr + done) % BMS_NVM_PAGE_SIZE);
+        uint32_t n = (len - done < room) ? (len - done) : room;
+        bms_hal_nvm_write(addr + done, &data[done], (uint16_t)n);
+        done += n;
+    }
+
+    for (done = 0U; done < len; done += (uint32_t)sizeof(chk)) {
+        uint32_t n = (len - done < sizeof(chk)) ? (len - done) : (uint32_t)sizeof(chk);
+        bms_hal_nvm_read(addr + done, chk, (uint16_t)n);
+        if (memcmp(chk, &data[done], n) != 0) {
+            BMS_LOG("P3-06: NVM verify failed at 0x%05lX", (unsigned long)(addr + done));
             return false;
         }
     }
+    return true;
+}
+
+/* ── Record build / parse ──────────────────────────────────────────── */
+
+static uint32_t rec_build(uint32_t seq, uint8_t type, uint8_t events,
+                          const uint8_t *payload, uint32_t len)
+{
+    uint32_t crc;
+    uint16_t len16 = (uint16_t)len;
+
+    memcpy(&s_rec[0], &seq, 4U);
+    s_rec[4] = type;
+    s_rec[5] = events;
+    memcpy(&s_rec[6], &len16, 2U);
+    if (payload != NULL && len > 0U) { memcpy(&s_rec[REC_HDR_LEN], payload, len); }
+    /* payload == NULL: caller already placed it at s_rec[REC_HDR_LEN] */
+    crc = bms_nvm_crc32(s_rec, REC_HDR_LEN + len);
+    memcpy(&s_rec[REC_HDR_LEN + len], &crc, REC_CRC_LEN);
+    return REC_HDR_LEN + len + REC_CRC_LEN;
+}
+
+typedef enum { REC_OK, REC_END, REC_BAD } rec_status_t;
+
+/* Read the record at sector/offset into s_rec; header fields via out */
+static rec_status_t rec_read(uint8_t sector, uint32_t offset,
+                             uint32_t *seq, uint8_t *type, uint8_t *events,
+                             uint32_t *len)
+{
+    uint8_t hdr[REC_HDR_LEN];
+    uint16_t len16;
+    uint32_t crc;
+    uint8_t i, erased = 0xFFU;
+
+    if (offset + REC_OVERHEAD > BMS_NVM_SECTOR_SIZE) { return REC_END; }
+    bms_hal_nvm_read(sector_addr(sector) + offset, hdr, REC_HDR_LEN);
+    for (i = 0U; i < REC_HDR_LEN; i++) { erased &= hdr[i]; }
+    if (erased == 0xFFU) { return REC_END; }
+
+    memcpy(seq, &hdr[0], 4U);
+    *type = hdr[4];
+    *events = hdr[5];
+    memcpy(&len16, &hdr[6], 2U);
+    *len = len16;
+    if (*type < REC_SNAPSHOT || *type > REC_PERSIST ||
+        *len > REC_MAX_LEN - REC_OVERHEAD ||
+        offset + REC_OVERHEAD + *len > BMS_NVM_SECTOR_SIZE ||
+        (uint32_t)*events * EV_LEN > *len) {
+        return REC_BAD;
+    }
+
+    bms_hal_nvm_read(sector_addr(sector) + offset, s_rec,
+                     (uint16_t)(REC_OVERHEAD + *len));
+    memcpy(&crc, &s_rec[REC_HDR_LEN + *len], REC_CRC_LEN);
+    return (crc == bms_nvm_crc32(s_rec, REC_HDR_LEN + *len)) ? REC_OK : REC_BAD;
+}
+
+/* ── RAM log ───────────────────────────────────────────────────────── */
+
+static void ring_push(bms_nvm_ctx_t *ctx, const bms_nvm_fault_event_t *ev)
+{
+    ctx->fault_log[ctx->fault_head] = *ev;
+    ctx->fault_head = (uint8_t)((ctx->fault_head + 1U) % BMS_NVM_FAULT_LOG_SIZE);
+    if (ctx->fault_count < BMS_NVM_FAULT_LOG_SIZE) { ctx->fault_count++; }
+}
+
+/* Fill the copy readers are not on, flip, then bump seq. A buffer is
+ * only refilled after flipping away from it, so an unchanged seq means
+ * the reader's copy is whole. */
+static void publish(bms_nvm_ctx_t *ctx)
+{
+    uint32_t back = NVM_LOAD(&ctx->shared_front) ^ 1U;
+    bms_nvm_fault_log_t *dst = &ctx->shared[back];
+    uint8_t i;
+
+    dst->count = ctx->fault_count;
+    for (i = 0U; i < ctx->fault_count; i++) {
+        (void)bms_nvm_get_fault(ctx, i, &dst->ev[i]);
+    }
+    NVM_STORE(&ctx->shared_front, back);
+    NVM_STORE(&ctx->shared_seq, ctx->shared_seq + 1U);
+}
+
+static void apply_events(bms_nvm_ctx_t *ctx, const uint8_t *p, uint8_t n)
+{
+    bms_nvm_fault_event_t ev;
+    uint8_t i;
+
+    for (i = 0U; i < n; i++) {
+        memcpy(&ev, &p[(uint32_t)i * EV_LEN], EV_LEN);
+        ring_push(ctx, &ev);
+    }
+}
+
+/* ── Append / rotate ───────────────────────────────────────────────── */
+
+/* Erase the next sector and open it with a snapshot of the RAM state.
+ * Everything staged is in the RAM log already, so this commits it too. */
+static bool journal_rotate(bms_nvm_ctx_t *ctx)
+{
+    uint8_t next = (uint8_t)((ctx->sector + 1U) % BMS_NVM_JOURNAL_SECTORS);
+    uint8_t *payload = &s_rec[REC_HDR_LEN];   /* built in place */
+    uint32_t len = PERSIST_LEN;
+    uint32_t n;
+    uint8_t i;
+
+    if (!bms_nvm_erase_sector(sector_addr(next))) {
+        ctx->rotate_due = true;
+        return false;
+    }
+    ctx->rotate_due = false;
+
+    memcpy(payload, &ctx->persistent, PERSIST_LEN);
+    for (i = 0U; i < ctx->fault_count; i++) {
+        uint8_t idx = (uint8_t)((ctx->fault_head + BMS_NVM_FAULT_LOG_SIZE -
+                                 ctx->fault_count + i) % BMS_NVM_FAULT_LOG_SIZE);
+        memcpy(&payload[len], &ctx->fault_log[idx], EV_LEN);
+        len += EV_LEN;
+    }
 
-    /* Step 3: Commit — copy shadow to active */
-    bms_hal_nvm_write(active_addr, data, len);
+    ctx->stats.rotations++;
+    ctx->sector = next;
+    ctx->offset = 0U;
+    ctx->sector_full = false;
+
+    n = rec_build(ctx->seq + 1U, REC_SNAPSHOT, ctx->fault_count, NULL, len);
+    if (!bms_nvm_program(sector_addr(next), s_rec, n)) {
+        ctx->stats.verify_fail++;
+        ctx->sector_full = true;
+        return false;
+    }
+    ctx->seq++;
+    ctx->offset = n;
+    ctx->stats.commits++;
+    ctx->stats.events += ctx->pending_count;
+    ctx->pending_count = 0U;
+    return true;
+}
+
+static bool journal_append(bms_nvm_ctx_t *ctx, uint8_t type, uint8_t events,
+                           const void *payload, uint32_t len)
+{
+    uint32_t n;
+
+    if (ctx->sector_full || ctx->offset + REC_OVERHEAD + len > BMS_NVM_SECTOR_SIZE) {
+        return journal_rotate(ctx);
+    }
+
+    n = rec_build(ctx->seq + 1U, type, events, (const uint8_t *)payload, len);
+    if (!bms_nvm_program(sector_addr(ctx->sector) + ctx->offset, s_rec, n)) {
+        /* Never program over a partial record — retry in a fresh sector */
+        ctx->stats.verify_fail++;
+        ctx->sector_full = true;
+        return false;
+    }
+    ctx->seq++;
+    ctx->offset += n;
+    ctx->stats.commits++;
     return true;
 }
 
+/* ── Public API ────────────────────────────────────────────────────── */
+
+void bms_nvm_init(bms_nvm_ctx_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    s_erase_free = true;
+    s_erasing = false;
+    bms_nvm_load_persistent(ctx);
+}
+
 void bms_nvm_log_fault(bms_nvm_ctx_t *ctx, uint32_t timestamp_ms,
                         uint8_t fault_type, uint8_t cell_index, uint16_t value)
 {
-    bms_nvm_fault_event_t *ev = &ctx->fault_log[ctx->fault_head];
-    ev->timestamp_ms = timestamp_ms;
-    ev->fault_type = fault_type;
-    ev->cell_index = cell_index;
-    ev->value = value;
+    bms_nvm_fault_event_t ev;
 
-    uint32_t ev_offset = (uint32_t)ctx->fault_head * (uint32_t)sizeof(*ev);
+    memset(&ev, 0, sizeof(ev));
+    ev.timestamp_ms = timestamp_ms;
+    ev.fault_type = fault_type;
+    ev.cell_index = cell_index;
+    ev.value = value;
+    ring_push(ctx, &ev);
+    publish(ctx);
 
-    /* P3-06: Atomic write — shadow first, verify, then commit */
-    (void)nvm_atomic_write(
-        NVM_ADDR_FAULT_LOG + ev_offset,
-        NVM_ADDR_SHADOW_LOG + ev_offset,
-        ev, (uint16_t)sizeof(*ev));
+    if (ctx->pending_count < BMS_NVM_COMMIT_MAX_EVENTS) {
+        ctx->pending[ctx->pending_count++] = ev;
+    }
+    if (ctx->pending_count >= BMS_NVM_COMMIT_MAX_EVENTS) {
+        (void)bms_nvm_commit(ctx);
+    }
+}
 
-    ctx->fault_head = (uint8_t)((ctx->fault_head + 1U) % BMS_NVM_FAULT_LOG_SIZE);
-    if (ctx->fault_count < BMS_NVM_FAULT_LOG_SIZE) { ctx->fault_count++; }
+bool bms_nvm_commit(bms_nvm_ctx_t *ctx)
+{
+    uint8_t n = ctx->pending_count;
+
+    if (!ctx->mounted) {
+        ctx->pending_count = 0U;
+        return false;
+    }
+    if (n == 0U && !ctx->rotate_due) { return true; }
 
-    (void)nvm_atomic_write(NVM_ADDR_FAULT_HEAD, NVM_ADDR_SHADOW_HEAD,
-                           &ctx->fault_head, 1U);
-    (void)nvm_atomic_write(NVM_ADDR_FAULT_COUNT, NVM_ADDR_SHADOW_COUNT,
-                           &ctx->fault_count, 1U);
+    if ((n == 0U) ? !journal_rotate(ctx) :
+        !journal_append(ctx, REC_FAULTS, n, ctx->pending, (uint32_t)n * EV_LEN)) {
+        /* Still in the RAM log; the next rotation's snapshot carries them.
+         * Retried next release only when the erase budget deferred the
+         * rotation — a dead sector would otherwise be erased at 100 Hz. */
+        ctx->pending_count = 0U;
+        return false;
+    }
+    /* journal_rotate() already accounted for the staged events */
+    if (ctx->pending_count != 0U) {
+        ctx->stats.events += n;
+        ctx->pending_count = 0U;
+    }
+    return true;
 }
 
 bool bms_nvm_get_fault(const bms_nvm_ctx_t *ctx, uint8_t idx,
@@ -102,23 +370,84 @@ bool bms_nvm_get_fault(const bms_nvm_ctx_t *ctx, uint8_t idx,
     return true;
 }
 
+void bms_nvm_fault_log_read(const bms_nvm_ctx_t *ctx, bms_nvm_fault_log_t *out)
+{
+    uint32_t seq;
+
+    do {
+        seq = NVM_LOAD(&ctx->shared_seq);
+        memcpy(out, &ctx->shared[NVM_LOAD(&ctx->shared_front)], sizeof(*out));
+    } while (NVM_LOAD(&ctx->shared_seq) != seq);
+}
+
 void bms_nvm_save_persistent(bms_nvm_ctx_t *ctx)
 {
-    /* P3-06: Atomic write for persistent data */
-    (void)nvm_atomic_write(NVM_ADDR_PERSISTENT, NVM_ADDR_SHADOW_PERSISTENT,
-                           &ctx->persistent, (uint16_t)sizeof(ctx->persistent));
+    if (!ctx->mounted) { return; }
+    (void)bms_nvm_commit(ctx);
+    (void)journal_append(ctx, REC_PERSIST, 0U, &ctx->persistent, PERSIST_LEN);
 }
 
 void bms_nvm_load_persistent(bms_nvm_ctx_t *ctx)
 {
-    bms_hal_nvm_read(NVM_ADDR_PERSISTENT, &ctx->persistent,
-                     (uint16_t)sizeof(ctx->persistent));
-    bms_hal_nvm_read(NVM_ADDR_FAULT_HEAD, &ctx->fault_head, 1U);
-    bms_hal_nvm_read(NVM_ADDR_FAULT_COUNT, &ctx->fault_count, 1U);
+    uint32_t best_seq = 0U, seq, len, offset;
+    uint8_t best = BMS_NVM_JOURNAL_SECTORS;
+    uint8_t s, type, events;
+    rec_status_t st;
 
-    if (ctx->fault_head >= BMS_NVM_FAULT_LOG_SIZE) { ctx->fault_head = 0U; }
-    if (ctx->fault_count > BMS_NVM_FAULT_LOG_SIZE) { ctx->fault_count = 0U; }
+    memset(ctx->fault_log, 0, sizeof(ctx->fault_log));
+    memset(&ctx->persistent, 0, sizeof(ctx->persistent));
+    ctx->fault_head = 0U;
+    ctx->fault_count = 0U;
+    ctx->pending_count = 0U;
+    ctx->rotate_due = false;
+    ctx->mounted = true;
+
+    /* Newest sector that opens with a valid snapshot */
+    for (s = 0U; s < BMS_NVM_JOURNAL_SECTORS; s++) {
+        if (rec_read(s, 0U, &seq, &type, &events, &len) == REC_OK &&
+            type == REC_SNAPSHOT && len == PERSIST_LEN + (uint32_t)events * EV_LEN &&
+            (best == BMS_NVM_JOURNAL_SECTORS || seq > best_seq)) {
+            best = s;
+            best_seq = seq;
+        }
+    }
 
-    bms_hal_nvm_read(NVM_ADDR_FAULT_LOG, ctx->fault_log,
-                     (uint16_t)(BMS_NVM_FAULT_LOG_SIZE * sizeof(bms_nvm_fault_event_t)));
+    if (best == BMS_NVM_JOURNAL_SECTORS) {
+        /* Blank (or unreadable) journal: first commit opens sector 0 */
+        ctx->sector = (uint8_t)(BMS_NVM_JOURNAL_SECTORS - 1U);
+        ctx->sector_full = true;
+        ctx->offset = 0U;
+        ctx->seq = 0U;
+        publish(ctx);
+        return;
+    }
+
+    ctx->sector = best;
+    ctx->seq = best_seq - 1U;
+    ctx->sector_full = false;
+    offset = 0U;
+
+    for (;;) {
+        st = rec_read(best, offset, &seq, &type, &events, &len);
+        if (st == REC_END) { break; }
+        if (st == REC_BAD || seq != ctx->seq + 1U) {
+            BMS_LOG("P3-06: NVM torn record at sector %u +0x%03lX — rotating",
+                    (unsigned)best, (unsigned long)offset);
+            ctx->stats.torn++;
+            ctx->sector_full = true;
+            break;
+        }
+        if (type == REC_SNAPSHOT) {
+            memcpy(&ctx->persistent, &s_rec[REC_HDR_LEN], PERSIST_LEN);
+            apply_events(ctx, &s_rec[REC_HDR_LEN + PERSIST_LEN], events);
+        } else if (type == REC_FAULTS) {
+            apply_events(ctx, &s_rec[REC_HDR_LEN], events);
+        } else if (len == PERSIST_LEN) {
+            memcpy(&ctx->persistent, &s_rec[REC_HDR_LEN], PERSIST_LEN);
+        }
+        ctx->seq = seq;
+        offset += REC_OVERHEAD + len;
+    }
+    ctx->offset = offset;
+    publish(ctx);
 }
@@ -0,0 +1,133 @@
+/**
+ * @file bms_nvm_queue.c
+ * @brief Write-behind fault event queue in front of the NVM journal
+ *
+ * Street Smart Edition.
+ * Producers own s_head and s_dropped, the drain task owns s_tail and
+ * s_dropped_seen. See bms_nvm_queue.h for the ownership rules.
+ */
+
+#include "bms_nvm_queue.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+#define NVQ_MASK  ((uint8_t)(BMS_NVM_QUEUE_DEPTH - 1U))
+
+_Static_assert((BMS_NVM_QUEUE_DEPTH & (BMS_NVM_QUEUE_DEPTH - 1U)) == 0U,
+               "NVM queue depth must be a power of 2");
+_Static_assert(BMS_NVM_QUEUE_DEPTH <= 128U, "uint8_t ring indices");
+
+/* Index hand-off: slot before index (release), index before slot (acquire) */
+#if defined(__GNUC__)
+  #define NVQ_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define NVQ_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  #define NVQ_LOAD(p)       (*(p))
+  #define NVQ_STORE(p, v)   (*(p) = (v))
+#endif
+
+static bms_nvm_fault_event_t s_ring[BMS_NVM_QUEUE_DEPTH];
+static volatile uint8_t      s_head;           /* producers */
+static volatile uint8_t      s_tail;           /* drain task */
+static volatile uint32_t     s_dropped;        /* producers */
+static uint32_t              s_dropped_seen;   /* drain task */
+static volatile bool         s_brownout;
+static bms_nvm_queue_hook_t  s_hook;
+static bms_nvm_queue_stats_t s_stats;
+
+void bms_nvm_queue_init(void)
+{
+    memset(s_ring, 0, sizeof(s_ring));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_head = 0U;
+    s_tail = 0U;
+    s_dropped = 0U;
+    s_dropped_seen = 0U;
+    s_brownout = false;
+}
+
+void bms_nvm_queue_set_wake_hook(bms_nvm_queue_hook_t hook)
+{
+    s_hook = hook;
+}
+
+bool bms_nvm_queue_push(uint32_t timestamp_ms, uint8_t fault_type,
+                        uint8_t cell_index, uint16_t value)
+{
+    uint8_t head = s_head;
+    uint8_t depth = (uint8_t)(head - NVQ_LOAD(&s_tail));
+    bms_nvm_fault_event_t *ev;
+
+    if (depth >= BMS_NVM_QUEUE_DEPTH) {
+        NVQ_STORE(&s_dropped, s_dropped + 1U);
+        return false;
+    }
+
+    ev = &s_ring[head & NVQ_MASK];
+    ev->timestamp_ms = timestamp_ms;
+    ev->fault_type = fault_type;
+    ev->cell_index = cell_index;
+    ev->value = value;
+    NVQ_STORE(&s_head, (uint8_t)(head + 1U));
+
+    s_stats.pushed++;
+    depth++;
+    if (depth > s_stats.ring_hwm) { s_stats.ring_hwm = depth; }
+    return true;
+}
+
+uint8_t bms_nvm_queue_drain(bms_nvm_ctx_t *ctx)
+{
+    uint8_t n = 0U;
+    uint32_t dropped = NVQ_LOAD(&s_dropped);
+
+    NVQ_STORE(&s_brownout, false);
+
+    while (s_tail != NVQ_LOAD(&s_head)) {
+        const bms_nvm_fault_event_t *ev;
+        ev = &s_ring[s_tail & NVQ_MASK];
+        bms_nvm_log_fault(ctx, ev->timestamp_ms, ev->fault_type,
+                          ev->cell_index, ev->value);
+        NVQ_STORE(&s_tail, (uint8_t)(s_tail + 1U));
+        n++;
+    }
+
+    if (dropped != s_dropped_seen) {
+        uint32_t lost = dropped - s_dropped_seen;
+        BMS_LOG("NVM queue overflow — %lu fault events lost", (unsigned long)lost);
+        bms_nvm_log_fault(ctx, hal_tick_ms(), NVM_FAULT_LOG_OVERFLOW, 0xFFU,
+                          (uint16_t)((lost > 0xFFFFU) ? 0xFFFFU : lost));
+        s_dropped_seen = dropped;
+    }
+
+    if (ctx->pending_count > 0U || ctx->rotate_due) {
+        (void)bms_nvm_commit(ctx);
+        s_stats.drains++;
+    }
+    s_stats.drained += n;
+    return n;
+}
+
+void bms_nvm_queue_brownout_isr(void)
+{
+    NVQ_STORE(&s_brownout, true);
+    s_stats.brownouts++;
+    if (s_hook != NULL) { s_hook(); }
+}
+
+bool bms_nvm_queue_brownout_pending(void)
+{
+    return NVQ_LOAD(&s_brownout);
+}
+
+uint8_t bms_nvm_queue_depth(void)
+{
+    return (uint8_t)(NVQ_LOAD(&s_head) - NVQ_LOAD(&s_tail));
+}
+
+void bms_nvm_queue_get_stats(bms_nvm_queue_stats_t *out)
+{
+    *out = s_stats;
+    out->dropped = NVQ_LOAD(&s_dropped);
+}
@@ -0,0 +1,183 @@
+/**
+ * @file bms_pack_share.c
+ * @brief Pack data shared between RTOS tasks — seqlock + atomic fault bits
+ *
+ * Street Smart Edition.
+ * See bms_pack_share.h for the ownership split. Nothing here disables
+ * interrupts: the writer only ever fills the buffer readers are not
+ * pointed at, and readers detect a flip by the sequence counter.
+ */
+
+#include "bms_pack_share.h"
+#include <string.h>
+
+_Static_assert(sizeof(bms_fault_flags_t) == sizeof(uint32_t), "Fault flags are one atomic word");
+
+/* Loads acquire, stores release: every word is also a publication
+ * fence for what the same task wrote before it (a DMB on Cortex-M) */
+#if defined(__GNUC__)
+  #define SHR_LOAD(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define SHR_STORE(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+  #define SHR_OR(p, v)        ((void)__atomic_fetch_or((p), (v), __ATOMIC_ACQ_REL))
+  #define SHR_AND(p, v)       ((void)__atomic_fetch_and((p), (v), __ATOMIC_ACQ_REL))
+  #define SHR_ADD(p, v)       ((void)__atomic_fetch_add((p), (v), __ATOMIC_RELAXED))
+#else
+  #define SHR_LOAD(p)         (*(p))
+  #define SHR_STORE(p, v)     (*(p) = (v))
+  #define SHR_OR(p, v)        (*(p) |= (v))
+  #define SHR_AND(p, v)       (*(p) &= (v))
+  #define SHR_ADD(p, v)       (*(p) += (v))
+#endif
+
+/* ── Measurements: two buffers, one writer ─────────────────────────── */
+
+static bms_pack_data_t   s_buf[2];
+static volatile uint32_t s_seq;     /* bumped after every flip */
+static volatile uint32_t s_front;
+
+/* ── Control words: aligned, each a single-copy-atomic access ──────── */
+
+static volatile uint32_t s_faults;
+static volatile uint32_t s_latched;
+static volatile uint32_t s_warning;
+static volatile uint32_t s_soc;
+static volatile int32_t  s_chg_limit;
+static volatile int32_t  s_dchg_limit;
+static volatile uint32_t s_contactor;
+static volatile uint32_t s_mode;
+static volatile uint32_t s_last_ems;
+
+static bms_pack_share_stats_t s_stats;
+
+static uint32_t fault_bits(const bms_pack_data_t *pack)
+{
+    uint32_t w;
+    memcpy(&w, &pack->faults, sizeof(w));
+    return w;
+}
+
+void bms_pack_share_init(const bms_pack_data_t *pack)
+{
+    memcpy(&s_buf[0], pack, sizeof(s_buf[0]));
+    memcpy(&s_buf[1], pack, sizeof(s_buf[1]));
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    SHR_STORE(&s_faults, fault_bits(pack));
+    SHR_STORE(&s_latched, pack->fault_latched ? 1U : 0U);
+    SHR_STORE(&s_warning, pack->has_warning ? 1U : 0U);
+    SHR_STORE(&s_soc, (uint32_t)pack->soc_hundredths);
+    SHR_STORE(&s_chg_limit, pack->charge_limit_ma);
+    SHR_STORE(&s_dchg_limit, pack->discharge_limit_ma);
+    SHR_STORE(&s_contactor, (uint32_t)pack->contactor_state);
+    SHR_STORE(&s_mode, (uint32_t)pack->mode);
+    SHR_STORE(&s_last_ems, pack->last_ems_msg_ms);
+    SHR_STORE(&s_front, 0U);
+    SHR_STORE(&s_seq, 0U);
+}
+
+void bms_pack_share_publish(const bms_pack_data_t *pack)
+{
+    uint32_t back = s_front ^ 1U;
+
+    memcpy(&s_buf[back], pack, sizeof(s_buf[back]));
+    SHR_STORE(&s_front, back);
+    SHR_STORE(&s_seq, s_seq + 1U);
+    SHR_ADD(&s_stats.publishes, 1U);
+}
+
+const bms_pack_data_t *bms_pack_share_read_begin(uint32_t *seq)
+{
+    *seq = SHR_LOAD(&s_seq);
+    return &s_buf[SHR_LOAD(&s_front)];
+}
+
+/* The writer only refills a buffer after flipping away from it, and
+ * every flip moves seq — so an unchanged seq means an untorn copy. */
+bool bms_pack_share_read_retry(uint32_t seq)
+{
+    return SHR_LOAD(&s_seq) != seq;
+}
+
+void bms_pack_share_snapshot(bms_pack_data_t *dst, bms_pack_ctl_t *ctl)
+{
+    const bms_pack_data_t *src;
+    uint32_t seq;
+    uint32_t tries = 0U;
+
+    for (;;) {
+        src = bms_pack_share_read_begin(&seq);
+        memcpy(dst, src, sizeof(*dst));
+        if (!bms_pack_share_read_retry(seq)) { break; }
+        tries++;
+    }
+    SHR_ADD(&s_stats.reads, 1U);
+    if (tries > 0U) {
+        SHR_ADD(&s_stats.retries, tries);
+        if (tries > SHR_LOAD(&s_stats.max_retries)) { SHR_STORE(&s_stats.max_retries, tries); }
+    }
+
+    bms_pack_share_pull(dst, ctl);
+}
+
+void bms_pack_share_pull(bms_pack_data_t *dst, bms_pack_ctl_t *ctl)
+{
+    ctl->faults = SHR_LOAD(&s_faults);
+    ctl->fault_latched = (SHR_LOAD(&s_latched) != 0U);
+    ctl->has_warning = (SHR_LOAD(&s_warning) != 0U);
+    ctl->soc_hundredths = (uint16_t)SHR_LOAD(&s_soc);
+    ctl->charge_limit_ma = SHR_LOAD(&s_chg_limit);
+    ctl->discharge_limit_ma = SHR_LOAD(&s_dchg_limit);
+    ctl->contactor_state = (uint8_t)SHR_LOAD(&s_contactor);
+    ctl->mode = (uint8_t)SHR_LOAD(&s_mode);
+    ctl->last_ems_msg_ms = SHR_LOAD(&s_last_ems);
+
+    memcpy(&dst->faults, &ctl->faults, sizeof(dst->faults));
+    dst->fault_latched = ctl->fault_latched;
+    dst->has_warning = ctl->has_warning;
+    dst->soc_hundredths = ctl->soc_hundredths;
+    dst->charge_limit_ma = ctl->charge_limit_ma;
+    dst->discharge_limit_ma = ctl->discharge_limit_ma;
+    dst->contactor_state = (bms_contactor_state_t)ctl->contactor_state;
+    dst->mode = (bms_pack_mode_t)ctl->mode;
+    dst->last_ems_msg_ms = ctl->last_ems_msg_ms;
+}
+
+void bms_pack_share_commit(const bms_pack_ctl_t *ctl, const bms_pack_data_t *pack)
+{
+    uint32_t now = fault_bits(pack);
+    uint32_t set = now & ~ctl->faults;
+    uint32_t clr = ctl->faults & ~now;
+
+    /* Bits before the latch, so a reader that sees latched sees why */
+    if (set != 0U) { SHR_OR(&s_faults, set); SHR_ADD(&s_stats.fault_sets, 1U); }
+    if (clr != 0U) { SHR_AND(&s_faults, ~clr); SHR_ADD(&s_stats.fault_clears, 1U); }
+
+    if (pack->fault_latched != ctl->fault_latched) {
+        if (pack->fault_latched) {
+            SHR_STORE(&s_latched, 1U);
+        } else {
+            /* Fault reset. A task that set a bit since our snapshot has
+             * latched (or is about to) — don't wipe that out; a spurious
+             * latch is the safe side. */
+            SHR_STORE(&s_latched, 0U);
+            if ((SHR_LOAD(&s_faults) & ~ctl->faults & ~now) != 0U) { SHR_STORE(&s_latched, 1U); }
+        }
+    }
+    if (pack->has_warning != ctl->has_warning) { SHR_STORE(&s_warning, pack->has_warning ? 1U : 0U); }
+    if (pack->soc_hundredths != ctl->soc_hundredths) { SHR_STORE(&s_soc, (uint32_t)pack->soc_hundredths); }
+    if (pack->charge_limit_ma != ctl->charge_limit_ma) { SHR_STORE(&s_chg_limit, pack->charge_limit_ma); }
+    if (pack->discharge_limit_ma != ctl->discharge_limit_ma) { SHR_STORE(&s_dchg_limit, pack->discharge_limit_ma); }
+    if ((uint8_t)pack->contactor_state != ctl->contactor_state) { SHR_STORE(&s_contactor, (uint32_t)pack->contactor_state); }
+    if ((uint8_t)pack->mode != ctl->mode) { SHR_STORE(&s_mode, (uint32_t)pack->mode); }
+    if (pack->last_ems_msg_ms != ctl->last_ems_msg_ms) { SHR_STORE(&s_last_ems, pack->last_ems_msg_ms); }
+}
+
+void bms_pack_share_get_stats(bms_pack_share_stats_t *out)
+{
+    out->publishes = SHR_LOAD(&s_stats.publishes);
+    out->reads = SHR_LOAD(&s_stats.reads);
+    out->retries = SHR_LOAD(&s_stats.retries);
+    out->max_retries = SHR_LOAD(&s_stats.max_retries);
+    out->fault_sets = SHR_LOAD(&s_stats.fault_sets);
+    out->fault_clears = SHR_LOAD(&s_stats.fault_clears);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file bms_power.c
+ * @brief Tickless POWER_SAVE: slow scan, STOP between scans, ALERT/CAN wake
+ *
+ * Street Smart Edition.
+ * Main loop only: update runs inside the protection job, idle between
+ * jobs, so neither races bms_sched.
+ */
+
+#include "bms_power.h"
+#include "bms_sched.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <string.h>
+
+static bool              s_low;
+static uint32_t          s_busy_at;     /* last tick full cadence was needed */
+static bms_power_stats_t s_stats;
+
+void bms_power_init(uint32_t now)
+{
+    s_low = false;
+    s_busy_at = now;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+/* Nothing the slow scan would be too slow for */
+static bool pack_quiet(const bms_pack_data_t *pack)
+{
+    return pack->mode == BMS_MODE_POWER_SAVE &&
+           !pack->fault_latched &&
+           pack->contactor_state == CONTACTOR_OPEN &&
+           pack->max_cell_mv < BMS_SE_OV_WARN_MV &&
+           (pack->min_cell_mv == 0U || pack->min_cell_mv > BMS_SE_UV_WARN_MV) &&
+           pack->max_temp_deci_c < BMS_SE_OT_WARN_DECI_C &&
+           !hal_afe_alert_active();
+}
+
+static void full_cadence(uint32_t now)
+{
+    s_low = false;
+    s_busy_at = now;
+    bms_sched_set_low_power(false, now);
+}
+
+void bms_power_update(const bms_pack_data_t *pack, uint32_t now)
+{
+    if (!pack_quiet(pack)) {
+        if (s_low) {
+            s_stats.exits++;
+            full_cadence(now);
+            BMS_LOG("POWER_SAVE: full cadence (mode %u, fault %u)",
+                    (unsigned)pack->mode, pack->fault_latched ? 1U : 0U);
+        }
+        s_busy_at = now;
+        return;
+    }
+
+    if (!s_low && (now - s_busy_at) >= BMS_PS_WAKE_HOLD_MS) {
+        s_low = true;
+        s_stats.entries++;
+        bms_sched_set_low_power(true, now);
+    }
+}
+
+void bms_power_idle(uint32_t now, uint32_t idle_ms)
+{
+    hal_wake_t src;
+    uint32_t woke;
+
+    if (!s_low || idle_ms == 0U) { return; }
+    if (idle_ms > BMS_PS_STOP_MAX_MS) { idle_ms = BMS_PS_STOP_MAX_MS; }
+
+    src = hal_stop_ms(idle_ms);
+    woke = hal_tick_ms();
+    s_stats.stops++;
+    s_stats.slept_ms += woke - now;
+    hal_iwdg_feed();
+
+    if (src == HAL_WAKE_AFE_ALERT) {
+        s_stats.wakes_alert++;
+        full_cadence(woke);
+    } else if (src == HAL_WAKE_CAN) {
+        s_stats.wakes_can++;
+        full_cadence(woke);
+    }
+}
+
+bool bms_power_low(void)
+{
+    return s_low;
+}
+
+void bms_power_get_stats(bms_power_stats_t *out)
+{
+    *out = s_stats;
+}
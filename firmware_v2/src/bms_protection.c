@@ -14,22 +14,15 @@
 
 #include "bms_protection.h"
 #include "bms_current_limit.h"
-#include "bms_nvm.h"
+#include "bms_cell_scan.h"
+#include "bms_nvm_queue.h"
 #include "bms_config.h"
 #include <string.h>
 
-static bms_nvm_ctx_t *s_nvm_ctx;
-
-void bms_protection_set_nvm(void *nvm)
-{
-    s_nvm_ctx = (bms_nvm_ctx_t *)nvm;
-}
-
+/* O(1) hand-off — flash is written later by the NVM task */
 static void log_fault(uint32_t ts, uint8_t type, uint8_t cell, uint16_t val)
 {
-    if (s_nvm_ctx != NULL) {
-        bms_nvm_log_fault(s_nvm_ctx, ts, type, cell, val);
-    }
+    (void)bms_nvm_queue_push(ts, type, cell, val);
 }
 
 /* ── Leaky integrator helpers ──────────────────────────────────────── */
@@ -53,6 +46,68 @@ static void leak_dec(uint32_t *timer, uint32_t dt_ms)
     }
 }
 
+static void leak_inc16(uint16_t *timer, uint32_t dt_ms)
+{
+    uint32_t t = (uint32_t)*timer + dt_ms;
+    *timer = (t < BMS_PROT_TIMER_MAX_MS) ? (uint16_t)t : (uint16_t)BMS_PROT_TIMER_MAX_MS;
+}
+
+static void leak_dec16(uint16_t *timer, uint32_t dt_ms)
+{
+    uint32_t decay = dt_ms >> BMS_LEAK_DECAY_SHIFT;
+    *timer = (*timer > decay) ? (uint16_t)(*timer - decay) : 0U;
+}
+
+/* Index of the lowest set bit (w != 0) */
+static uint8_t lowest_bit(uint16_t w)
+{
+#if defined(__GNUC__)
+    return (uint8_t)__builtin_ctz(w);
+#else
+    uint8_t n = 0U;
+    while ((w & 1U) == 0U) { w >>= 1U; n++; }
+    return n;
+#endif
+}
+
+/**
+ * Drive a bank of 16-bit leaky integrators from an exceedance mask.
+ * Per module only (hit | active) & live is visited: flagged entries
+ * integrate up, active ones decay, idle ones are skipped entirely.
+ * Entries outside `live` (NULL = all) are held. Entries are visited in
+ * index order and the walk stops at the first integrator to reach
+ * delay_ms, so later entries are not updated on the cycle that trips.
+ * @return index of the tripped entry, or BMS_NUM_MODULES * per_mod if none
+ */
+static uint16_t run_timers(uint16_t *timers, uint16_t *active,
+                           const uint16_t *hit, const uint16_t *live,
+                           uint8_t per_mod, uint32_t dt_ms, uint32_t delay_ms)
+{
+    uint8_t mod;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        uint16_t work = (uint16_t)(hit[mod] | active[mod]);
+        if (live != NULL) { work &= live[mod]; }
+
+        while (work != 0U) {
+            uint8_t n = lowest_bit(work);
+            uint16_t bit = (uint16_t)(1U << n);
+            uint16_t i = (uint16_t)((uint16_t)mod * per_mod + n);
+            work &= (uint16_t)(work - 1U);
+
+            if ((hit[mod] & bit) != 0U) {
+                leak_inc16(&timers[i], dt_ms);
+                active[mod] |= bit;
+                if (timers[i] >= delay_ms) { return i; }
+            } else {
+                leak_dec16(&timers[i], dt_ms);
+                if (timers[i] == 0U) { active[mod] &= (uint16_t)~bit; }
+            }
+        }
+    }
+    return (uint16_t)(BMS_NUM_MODULES * per_mod);
+}
+
 /* ── Init ──────────────────────────────────────────────────────────── */
 
 void bms_protection_init(bms_protection_state_t *prot)
@@ -66,15 +121,12 @@ void bms_protection_hw_safety(bms_protection_state_t *prot,
                                bms_pack_data_t *pack,
                                uint32_t dt_ms)
 {
-    uint16_t i;
-    bool any_hw_ov = false;
-    bool any_hw_uv = false;
+    bms_cell_mask_t mask;
+    bool any_hw_ov, any_hw_uv;
     bool any_hw_ot = false;
     uint8_t mod, sens;
 
-    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
-        if (pack->cell_mv[i] >= BMS_HW_OV_MV) { any_hw_ov = true; break; }
-    }
+    any_hw_ov = bms_cell_scan_ge(pack->cell_mv, BMS_HW_OV_MV, &mask);
     if (any_hw_ov) {
         leak_inc(&prot->hw_ov_timer_ms, dt_ms);
         if (prot->hw_ov_timer_ms >= BMS_HW_OV_DELAY_MS) {
@@ -85,11 +137,7 @@ void bms_protection_hw_safety(bms_protection_state_t *prot,
         leak_dec(&prot->hw_ov_timer_ms, dt_ms);
     }
 
-    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
-        if (pack->cell_mv[i] > 0U && pack->cell_mv[i] <= BMS_HW_UV_MV) {
-            any_hw_uv = true; break;
-        }
-    }
+    any_hw_uv = bms_cell_scan_le_nz(pack->cell_mv, BMS_HW_UV_MV, &mask);
     if (any_hw_uv) {
         leak_inc(&prot->hw_uv_timer_ms, dt_ms);
         if (prot->hw_uv_timer_ms >= BMS_HW_UV_DELAY_MS) {
@@ -126,6 +174,7 @@ void bms_protection_run(bms_protection_state_t *prot,
                         bms_pack_data_t *pack,
                         uint32_t dt_ms)
 {
+    bms_cell_mask_t mask;
     uint16_t i;
     uint8_t mod, sens;
 
@@ -134,14 +183,9 @@ void bms_protection_run(bms_protection_state_t *prot,
 
     /* If fault-latched, accumulate safe-state time only */
     if (pack->fault_latched) {
-        bool all_safe = true;
-        for (i = 0U; i < BMS_SE_PER_PACK; i++) {
-            if (pack->cell_mv[i] >= BMS_SE_OV_FAULT_MV ||
-                (pack->cell_mv[i] > 0U && pack->cell_mv[i] <= BMS_SE_UV_FAULT_MV)) {
-                all_safe = false;
-                break;
-            }
-        }
+        bool all_safe =
+            !bms_cell_scan_ge(pack->cell_mv, BMS_SE_OV_FAULT_MV, &mask) &&
+            !bms_cell_scan_le_nz(pack->cell_mv, BMS_SE_UV_FAULT_MV, &mask);
         if (all_safe && pack->max_temp_deci_c < BMS_SE_OT_FAULT_DECI_C) {
             leak_inc(&prot->safe_state_ms, dt_ms);
         } else {
@@ -151,62 +195,57 @@ void bms_protection_run(bms_protection_state_t *prot,
     }
 
     /* ── Per-cell OV ───────────────────────────────────────────────── */
-    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
-        if (pack->cell_mv[i] >= BMS_SE_OV_FAULT_MV) {
-            leak_inc(&prot->ov_timer_ms[i], dt_ms);
-            if (prot->ov_timer_ms[i] >= BMS_SE_FAULT_DELAY_MS) {
-                pack->faults.cell_ov = 1U;
-                pack->fault_latched = true;
-                log_fault(pack->uptime_ms, NVM_FAULT_OV, (uint8_t)i, pack->cell_mv[i]);
-                return;
-            }
-        } else {
-            leak_dec(&prot->ov_timer_ms[i], dt_ms);
-        }
+    (void)bms_cell_scan_ge(pack->cell_mv, BMS_SE_OV_FAULT_MV, &mask);
+    i = run_timers(prot->ov_timer_ms, prot->ov_active, mask.mask, NULL,
+                   BMS_SE_PER_MODULE, dt_ms, BMS_SE_FAULT_DELAY_MS);
+    if (i < BMS_SE_PER_PACK) {
+        pack->faults.cell_ov = 1U;
+        pack->fault_latched = true;
+        log_fault(pack->uptime_ms, NVM_FAULT_OV, (uint8_t)i, pack->cell_mv[i]);
+        return;
     }
 
-    /* ── Per-cell UV ───────────────────────────────────────────────── */
-    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
-        if (pack->cell_mv[i] == 0U) { continue; }
-        if (pack->cell_mv[i] <= BMS_SE_UV_FAULT_MV) {
-            leak_inc(&prot->uv_timer_ms[i], dt_ms);
-            if (prot->uv_timer_ms[i] >= BMS_SE_FAULT_DELAY_MS) {
-                pack->faults.cell_uv = 1U;
-                pack->fault_latched = true;
-                log_fault(pack->uptime_ms, NVM_FAULT_UV, (uint8_t)i, pack->cell_mv[i]);
-                return;
-            }
-        } else {
-            leak_dec(&prot->uv_timer_ms[i], dt_ms);
-        }
+    /* ── Per-cell UV (zero = unread cell: timer held, not decayed) ─── */
+    {
+        bms_cell_mask_t live;
+        (void)bms_cell_scan_ge(pack->cell_mv, 1U, &live);
+        (void)bms_cell_scan_le_nz(pack->cell_mv, BMS_SE_UV_FAULT_MV, &mask);
+        i = run_timers(prot->uv_timer_ms, prot->uv_active, mask.mask,
+                       live.mask, BMS_SE_PER_MODULE, dt_ms,
+                       BMS_SE_FAULT_DELAY_MS);
+    }
+    if (i < BMS_SE_PER_PACK) {
+        pack->faults.cell_uv = 1U;
+        pack->fault_latched = true;
+        log_fault(pack->uptime_ms, NVM_FAULT_UV, (uint8_t)i, pack->cell_mv[i]);
+        return;
     }
 
-    /* ── Per-sensor OT ─────────────────────────────────────────────── */
+    /* ── Per-sensor OT (P0-01: faulted sensors held, not decayed) ─── */
     {
-        uint16_t sensor_idx = 0U;
+        uint16_t hot[BMS_NUM_MODULES];
+        uint16_t ok[BMS_NUM_MODULES];
         for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+            hot[mod] = 0U;
+            ok[mod] = 0U;
             for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
-                /* P0-01: Skip faulted sensors */
-                if (pack->modules[mod].sensor_fault[sens].faulted) {
-                    sensor_idx++;
-                    continue;
-                }
-                int16_t t = pack->modules[mod].temp_deci_c[sens];
-                if (t >= BMS_SE_OT_FAULT_DECI_C) {
-                    leak_inc(&prot->ot_timer_ms[sensor_idx], dt_ms);
-                    if (prot->ot_timer_ms[sensor_idx] >= BMS_SE_FAULT_DELAY_MS) {
-                        pack->faults.cell_ot = 1U;
-                        pack->fault_latched = true;
-                        log_fault(pack->uptime_ms, NVM_FAULT_OT,
-                                  (uint8_t)sensor_idx, (uint16_t)t);
-                        return;
-                    }
-                } else {
-                    leak_dec(&prot->ot_timer_ms[sensor_idx], dt_ms);
+                if (pack->modules[mod].sensor_fault[sens].faulted) { continue; }
+                ok[mod] |= (uint16_t)(1U << sens);
+                if (pack->modules[mod].temp_deci_c[sens] >= BMS_SE_OT_FAULT_DECI_C) {
+                    hot[mod] |= (uint16_t)(1U << sens);
                 }
-                sensor_idx++;
             }
         }
+        i = run_timers(prot->ot_timer_ms, prot->ot_active, hot, ok,
+                       BMS_TEMPS_PER_MODULE, dt_ms, BMS_SE_FAULT_DELAY_MS);
+        if (i < BMS_TOTAL_TEMP_SENSORS) {
+            int16_t t = pack->modules[i / BMS_TEMPS_PER_MODULE]
+                            .temp_deci_c[i % BMS_TEMPS_PER_MODULE];
+            pack->faults.cell_ot = 1U;
+            pack->fault_latched = true;
+            log_fault(pack->uptime_ms, NVM_FAULT_OT, (uint8_t)i, (uint16_t)t);
+            return;
+        }
     }
 
     /* ═══════════════════════════════════════════════════════════════════
@@ -267,19 +306,14 @@ void bms_protection_run(bms_protection_state_t *prot,
 
     /* ── Warnings (with hysteresis) ────────────────────────────────── */
     {
-        bool warn_ov = false, warn_uv = false, warn_ot = false;
-
-        for (i = 0U; i < BMS_SE_PER_PACK; i++) {
-            uint16_t thresh = prot->warn_ov_active ?
-                BMS_SE_OV_WARN_CLEAR_MV : BMS_SE_OV_WARN_MV;
-            if (pack->cell_mv[i] >= thresh) { warn_ov = true; break; }
-        }
-        for (i = 0U; i < BMS_SE_PER_PACK; i++) {
-            if (pack->cell_mv[i] == 0U) { continue; }
-            uint16_t thresh = prot->warn_uv_active ?
-                BMS_SE_UV_WARN_CLEAR_MV : BMS_SE_UV_WARN_MV;
-            if (pack->cell_mv[i] <= thresh) { warn_uv = true; break; }
-        }
+        bool warn_ov, warn_uv, warn_ot = false;
+
+        warn_ov = bms_cell_scan_ge(pack->cell_mv, prot->warn_ov_active ?
+                                   BMS_SE_OV_WARN_CLEAR_MV : BMS_SE_OV_WARN_MV,
+                                   &mask);
+        warn_uv = bms_cell_scan_le_nz(pack->cell_mv, prot->warn_uv_active ?
+                                      BMS_SE_UV_WARN_CLEAR_MV : BMS_SE_UV_WARN_MV,
+                                      &mask);
         {
             int16_t thresh = prot->warn_ot_active ?
                 BMS_SE_OT_WARN_CLEAR_DC : BMS_SE_OT_WARN_DECI_C;
@@ -373,7 +407,7 @@ void bms_protection_reset(bms_protection_state_t *prot,
     /* Reset safe-state accumulator */
     prot->safe_state_ms = 0U;
 
-    /* Note: ov_timer_ms[], uv_timer_ms[], ot_timer_ms[] are PRESERVED.
+    /* Note: ov/uv/ot_timer_ms[] and their active sets are PRESERVED.
      * This prevents Yara's timing attack where resetting every 60s
      * prevents faults from ever latching. */
 }
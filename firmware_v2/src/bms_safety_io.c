@@ -16,19 +16,12 @@
  */
 
 #include "bms_safety_io.h"
+#include "bms_can_msgs.h"
 #include "bms_hal.h"
-#include "bms_nvm.h"
+#include "bms_nvm_queue.h"
 #include "bms_config.h"
 #include <string.h>
 
-/* P1-06: NVM context for IMD resistance trend logging */
-static bms_nvm_ctx_t *s_sio_nvm_ctx;
-
-void bms_safety_io_set_nvm(bms_nvm_ctx_t *nvm)
-{
-    s_sio_nvm_ctx = nvm;
-}
-
 void bms_safety_io_init(bms_safety_io_state_t *sio)
 {
     memset(sio, 0, sizeof(*sio));
@@ -145,35 +138,32 @@ void bms_safety_io_run(bms_safety_io_state_t *sio,
          *   - Fallback: hourly logging for trend data if no significant change
          */
         sio->imd_log_timer_ms += BMS_SAFETY_IO_PERIOD_MS;
-        if (s_sio_nvm_ctx != NULL) {
-            bool should_log = false;
-            uint32_t r = sio->imd_resistance_kohm;
-
-            if (r < BMS_IMD_WARNING_THRESHOLD_KOHM) {
-                /* Below warning: rapid logging for safety trending */
-                if (sio->imd_log_timer_ms >= BMS_IMD_LOG_INTERVAL_RAPID_MS) {
-                    should_log = true;
-                }
-            } else {
-                /* Above warning: log on significant change (>10% delta) */
-                uint32_t last = sio->imd_last_logged_kohm;
-                uint32_t delta = (r > last) ? (r - last) : (last - r);
-                if (last > 0U && delta * 10U > last) {
-                    /* >10% change from last logged value */
-                    should_log = true;
-                } else if (sio->imd_log_timer_ms >= BMS_IMD_LOG_INTERVAL_SLOW_MS) {
-                    /* Hourly fallback for trend data */
-                    should_log = true;
-                }
-            }
+        bool should_log = false;
+        uint32_t r = sio->imd_resistance_kohm;
 
-            if (should_log) {
-                sio->imd_log_timer_ms = 0U;
-                sio->imd_last_logged_kohm = r;
-                bms_nvm_log_fault(s_sio_nvm_ctx, pack->uptime_ms,
-                                  NVM_FAULT_IMD_TREND, 0xFFU,
-                                  (uint16_t)r);
+        if (r < BMS_IMD_WARNING_THRESHOLD_KOHM) {
+            /* Below warning: rapid logging for safety trending */
+            if (sio->imd_log_timer_ms >= BMS_IMD_LOG_INTERVAL_RAPID_MS) {
+                should_log = true;
             }
+        } else {
+            /* Above warning: log on significant change (>10% delta) */
+            uint32_t last = sio->imd_last_logged_kohm;
+            uint32_t delta = (r > last) ? (r - last) : (last - r);
+            if (last > 0U && delta * 10U > last) {
+                /* >10% change from last logged value */
+                should_log = true;
+            } else if (sio->imd_log_timer_ms >= BMS_IMD_LOG_INTERVAL_SLOW_MS) {
+                /* Hourly fallback for trend data */
+                should_log = true;
+            }
+        }
+
+        if (should_log) {
+            sio->imd_log_timer_ms = 0U;
+            sio->imd_last_logged_kohm = r;
+            (void)bms_nvm_queue_push(pack->uptime_ms, NVM_FAULT_IMD_TREND,
+                                     0xFFU, (uint16_t)r);
         }
     }
 }
@@ -199,14 +189,11 @@ bool bms_safety_io_emergency_shutdown(const bms_safety_io_state_t *sio)
 void bms_safety_io_encode_can(const bms_safety_io_state_t *sio,
                                bms_can_frame_t *frame)
 {
-    memset(frame, 0, sizeof(*frame));
-    frame->id = CAN_ID_SAFETY_IO;
-    frame->dlc = 8U;
-    frame->data[0] = (uint8_t)sio->gas_level;
-    frame->data[1] = (uint8_t)sio->vent_level;
-    frame->data[2] = (uint8_t)sio->fire_level;
-    frame->data[3] = (uint8_t)sio->imd_level;
-    frame->data[4] = sio->fire_suppression_active ? 1U : 0U;
-    frame->data[5] = sio->vent_running ? 1U : 0U;
-    /* [6:7] reserved */
+    bms_can_msg_safety_io_init(frame);         /* [6:7] reserved, zero */
+    bms_can_msg_safety_io_set_gas_level(frame, (uint8_t)sio->gas_level);
+    bms_can_msg_safety_io_set_vent_level(frame, (uint8_t)sio->vent_level);
+    bms_can_msg_safety_io_set_fire_level(frame, (uint8_t)sio->fire_level);
+    bms_can_msg_safety_io_set_imd_level(frame, (uint8_t)sio->imd_level);
+    bms_can_msg_safety_io_set_suppression_active(frame, sio->fire_suppression_active ? 1U : 0U);
+    bms_can_msg_safety_io_set_vent_running(frame, sio->vent_running ? 1U : 0U);
 }
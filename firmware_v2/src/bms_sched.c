@@ -0,0 +1,144 @@
+/**
+ * @file bms_sched.c
+ * @brief Table-driven rate-monotonic scheduler for the bare-metal loop
+ *
+ * Street Smart Edition.
+ * Release times are absolute uint32_t ms compared by signed difference,
+ * so the tick counter may wrap. Single-threaded: main loop only.
+ */
+
+#include "bms_sched.h"
+#include "bms_trace.h"
+#include <string.h>
+
+typedef struct {
+    uint32_t release;               /* next grid release */
+    bms_sched_stats_t st;
+} sched_ent_t;
+
+static const bms_sched_task_t *s_table;
+static uint8_t                 s_count;
+static bool                    s_low;
+static sched_ent_t             s_ent[BMS_SCHED_MAX_TASKS];
+
+static uint32_t period_of(const bms_sched_task_t *t)
+{
+    return (s_low && t->lp_period_ms != 0U) ? t->lp_period_ms : t->period_ms;
+}
+
+int32_t bms_sched_init(const bms_sched_task_t *table, uint8_t count, uint32_t now)
+{
+    uint8_t i;
+
+    s_table = NULL;
+    s_count = 0U;
+    s_low = false;
+    memset(s_ent, 0, sizeof(s_ent));
+
+    if (table == NULL || count == 0U || count > BMS_SCHED_MAX_TASKS) { return -1; }
+    for (i = 0U; i < count; i++) {
+        if (table[i].run == NULL || table[i].period_ms == 0U ||
+            table[i].phase_ms >= table[i].period_ms ||
+            (table[i].lp_period_ms != 0U && table[i].lp_period_ms < table[i].period_ms)) {
+            return -1;
+        }
+        s_ent[i].release = now + table[i].phase_ms;
+    }
+    s_table = table;
+    s_count = count;
+    return 0;
+}
+
+/* Consume the release a grid job is starting for, applying the policy */
+static void take_release(const bms_sched_task_t *t, sched_ent_t *e, uint32_t now)
+{
+    uint32_t period = period_of(t);
+    uint32_t late = now - e->release;
+    uint32_t behind = late / period;    /* further releases already due */
+
+    if (late > e->st.max_late_ms) { e->st.max_late_ms = late; }
+    if (behind == 0U) {
+        e->release += period;
+        return;
+    }
+
+    e->st.overruns++;
+    if (t->policy == BMS_SCHED_CATCHUP) {
+        /* Keep the newest BMS_SCHED_CATCHUP_MAX due releases, drop older */
+        uint32_t skip = (behind > BMS_SCHED_CATCHUP_MAX) ? behind - BMS_SCHED_CATCHUP_MAX : 0U;
+        e->st.caught_up++;
+        e->st.skipped += skip;
+        e->release += (skip + 1U) * period;     /* the next one is due at once */
+    } else {
+        e->st.skipped += behind;
+        e->release += (behind + 1U) * period;
+    }
+}
+
+bool bms_sched_dispatch(uint32_t now)
+{
+    uint8_t i;
+
+    for (i = 0U; i < s_count; i++) {
+        const bms_sched_task_t *t = &s_table[i];
+        sched_ent_t *e = &s_ent[i];
+
+        if ((int32_t)(now - e->release) >= 0) {
+            take_release(t, e, now);
+        } else if (t->early != NULL && t->early()) {
+            e->st.early_runs++;
+        } else {
+            continue;
+        }
+
+        if (t->trace != BMS_SCHED_NO_TRACE) { bms_trace_begin((bms_trace_task_t)t->trace); }
+        t->run(period_of(t));
+        if (t->trace != BMS_SCHED_NO_TRACE) { bms_trace_end((bms_trace_task_t)t->trace); }
+        e->st.runs++;
+        return true;
+    }
+    return false;
+}
+
+void bms_sched_set_low_power(bool low, uint32_t now)
+{
+    uint8_t i;
+
+    s_low = low;
+    for (i = 0U; i < s_count; i++) {
+        const bms_sched_task_t *t = &s_table[i];
+
+        s_ent[i].release = now + (low ? period_of(t) : t->phase_ms);
+        if (t->trace != BMS_SCHED_NO_TRACE) {
+            bms_trace_set_period((bms_trace_task_t)t->trace, (uint16_t)period_of(t));
+        }
+    }
+}
+
+bool bms_sched_low_power(void)
+{
+    return s_low;
+}
+
+uint32_t bms_sched_idle_ms(uint32_t now)
+{
+    uint32_t idle = 0xFFFFFFFFU;
+    uint8_t i;
+
+    if (s_count == 0U) { return 0U; }
+    for (i = 0U; i < s_count; i++) {
+        int32_t d = (int32_t)(s_ent[i].release - now);
+        if (d <= 0) { return 0U; }
+        if ((uint32_t)d < idle) { idle = (uint32_t)d; }
+    }
+    return idle;
+}
+
+void bms_sched_get_stats(uint8_t task, bms_sched_stats_t *out)
+{
+    if (task >= s_count) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    *out = s_ent[task].st;
+}
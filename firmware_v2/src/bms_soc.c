@@ -1,11 +1,15 @@
 /**
  * @file bms_soc.c
- * @brief SoC estimation — coulomb counting + OCV reset
+ * @brief SoC estimation — fixed-point EKF over a 1-RC equivalent circuit
  *
- * Street Smart Edition. Functionally identical to original.
+ * Street Smart Edition.
+ * Q formats (see bms_soc.h): SoC and V_rc Q31, P Q31, dOCV/dSoC Q16 V,
+ * gains Q24. Every product is int64; worst-case magnitudes are noted
+ * where they are formed.
  */
 
 #include "bms_soc.h"
+#include "bms_can_msgs.h"
 #include "bms_config.h"
 
 static const uint16_t ocv_soc_bp[24] = {
@@ -20,16 +24,131 @@ static const uint16_t ocv_mv_bp[24] = {
     3765, 3800, 3845, 3900, 3960, 4030, 4100, 4190
 };
 
+#define Q31_ONE          0x7FFFFFFF
+#define Q30_ONE          (1L << 30)
+#define Q31_SCALE        (1LL << 31)    /* multiply, never << a signed value */
+#define Q24_SCALE        (1LL << 24)
+
+/* Coulomb count in mA·ms·ppt (efficiency applied); one Q31 SoC LSB is
+ * this many units, rounded — 1.5 ppm off the nominal capacity */
+#define SOC_CC_UNITS_PER_LSB \
+    ((((int64_t)BMS_NOMINAL_CAPACITY_MAH * 3600000LL * 1000LL) + (1LL << 30)) >> 31)
+
+#define SOC_ACC_MAX_MS   60000U     /* covariance step cap when scans stall */
+#define P11_MIN          1          /* keep P positive definite */
+#define P11_MAX          (1L << 29) /* sigma 50 % */
+#define P22_MIN          1
+#define P22_MAX          5368709    /* (50 mV)² */
+
+static int32_t  s_soc;              /* Q31 */
+static int32_t  s_vrc;              /* Q31 V */
+static int64_t  s_cc_rem;           /* coulomb-count remainder, < 1 LSB */
+static int64_t  s_cc_total;         /* Q31, unclamped, for bms_cell_soc */
+static int32_t  s_p11, s_p12, s_p22;
+static uint32_t s_acc_ms;           /* since the last correction */
+static uint32_t s_acc_amp_ms;       /* ∫|I|dt since then, A·ms */
+static int32_t  s_innov_uv;
+static uint32_t s_updates;
 static uint16_t s_soc_hundredths;
-static uint32_t s_low_current_ms;
 
-#define SOC_LOW_CURRENT_MA   2000
-#define SOC_OCV_RESET_MS    30000U
+/* ── Fixed-point helpers ───────────────────────────────────────────── */
+
+static uint16_t q31_to_hundredths(int32_t q)
+{
+    return (uint16_t)(((int64_t)q * 10000 + (1LL << 30)) >> 31);
+}
+
+static int32_t q31_to_uv(int32_t q)
+{
+    return (int32_t)(((int64_t)q * 1000000) >> 31);
+}
+
+static int32_t uv_to_q31(int32_t uv)
+{
+    return (int32_t)(((int64_t)uv * Q31_SCALE) / 1000000);
+}
+
+static uint32_t isqrt64(uint64_t v)
+{
+    uint64_t r = 0U;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v) { bit >>= 2; }
+    while (bit != 0U) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+static int32_t clamp32(int64_t v, int32_t lo, int32_t hi)
+{
+    if (v < lo) { return lo; }
+    if (v > hi) { return hi; }
+    return (int32_t)v;
+}
+
+/* exp(-dt/tau) in Q30: third-order series on chunks of tau/8, so the
+ * loop is bounded by dt ≤ SOC_ACC_MAX_MS */
+static int32_t decay_q30(uint32_t dt_ms)
+{
+    const uint32_t chunk = BMS_SOC_EKF_TAU_MS / 8U;
+    int64_t a = Q30_ONE;
+
+    while (dt_ms > 0U) {
+        uint32_t d = (dt_ms > chunk) ? chunk : dt_ms;
+        int64_t x = ((int64_t)d << 30) / BMS_SOC_EKF_TAU_MS;     /* ≤ 1/8 */
+        int64_t x2 = (x * x) >> 30;
+        int64_t e = Q30_ONE - x + (x2 >> 1) - (((x2 * x) >> 30) / 6);
+
+        a = (a * e) >> 30;
+        dt_ms -= d;
+    }
+    return (int32_t)a;
+}
+
+/* OCV in µV at soc (Q31), and its slope dOCV/dSoC in Q16 V */
+static int32_t ocv_uv(int32_t soc, int32_t *slope_q16)
+{
+    int32_t ppm = (int32_t)(((int64_t)soc * 1000000) >> 31);
+    uint8_t i;
+    int32_t x0, dx, dy;
+
+    if (ppm > 1000000) { ppm = 1000000; }
+    for (i = 1U; i < 23U; i++) {
+        if (ppm <= (int32_t)ocv_soc_bp[i] * 100) { break; }
+    }
+    x0 = (int32_t)ocv_soc_bp[i - 1U] * 100;
+    dx = ((int32_t)ocv_soc_bp[i] - (int32_t)ocv_soc_bp[i - 1U]) * 100;
+    dy = ((int32_t)ocv_mv_bp[i] - (int32_t)ocv_mv_bp[i - 1U]) * 1000;
+
+    *slope_q16 = (int32_t)(((int64_t)dy << 16) / dx);           /* µV/ppm = V/SoC */
+    return (int32_t)ocv_mv_bp[i - 1U] * 1000 +
+           (int32_t)(((int64_t)dy * (ppm - x0)) / dx);
+}
+
+/* ── API ───────────────────────────────────────────────────────────── */
 
 void bms_soc_init(uint16_t initial_soc_hundredths)
 {
+    if (initial_soc_hundredths > 10000U) { initial_soc_hundredths = 10000U; }
+    s_soc = clamp32(((int64_t)initial_soc_hundredths << 31) / 10000, 0, Q31_ONE);
+    s_vrc = 0;
+    s_cc_rem = 0;
+    s_cc_total = 0;
+    s_p11 = BMS_SOC_EKF_P0_SOC;
+    s_p12 = 0;
+    s_p22 = BMS_SOC_EKF_P0_VRC;
+    s_acc_ms = 0U;
+    s_acc_amp_ms = 0U;
+    s_innov_uv = 0;
+    s_updates = 0U;
     s_soc_hundredths = initial_soc_hundredths;
-    s_low_current_ms = 0U;
 }
 
 uint16_t bms_soc_get(void) { return s_soc_hundredths; }
@@ -52,34 +171,152 @@ uint16_t bms_soc_from_ocv(uint16_t cell_mv)
     return ocv_soc_bp[23];
 }
 
+int32_t bms_soc_model_cell_uv(int32_t i_ma, int32_t *slope_q16)
+{
+    return ocv_uv(s_soc, slope_q16) + q31_to_uv(s_vrc) +
+           (int32_t)(((int64_t)BMS_SOC_EKF_R0_UOHM * i_ma) / 1000);
+}
+
 void bms_soc_update(bms_pack_data_t *pack, uint32_t dt_ms)
 {
-    int64_t delta = ((int64_t)pack->pack_current_ma * (int64_t)dt_ms);
-    if (pack->pack_current_ma > 0) {
-        delta = delta * BMS_COULOMBIC_EFFICIENCY_PPT / 1000;
+    int32_t i_ma = pack->pack_current_ma;
+    int64_t num, dq;
+    int32_t a;
+
+    /* Coulomb count: |I·dt·ppt| ≤ 640 A × 60 s × 1000, far inside int64 */
+    if (dt_ms > SOC_ACC_MAX_MS) { dt_ms = SOC_ACC_MAX_MS; }
+    num = (int64_t)i_ma * (int64_t)dt_ms *
+          ((i_ma > 0) ? (int64_t)BMS_COULOMBIC_EFFICIENCY_PPT : 1000LL);
+    num += s_cc_rem;
+    dq = num / SOC_CC_UNITS_PER_LSB;
+    s_cc_rem = num - dq * SOC_CC_UNITS_PER_LSB;
+    s_soc = clamp32((int64_t)s_soc + dq, 0, Q31_ONE);
+    s_cc_total += dq;
+
+    /* V_rc → R1·I with tau: x' = a·x + (1 − a)·R1·I; R1·I in nV → Q31 V */
+    a = decay_q30(dt_ms);
+    {
+        int64_t r1i_nv = (int64_t)BMS_SOC_EKF_R1_UOHM * i_ma;
+        int64_t drive = (r1i_nv * ((int64_t)Q30_ONE - a)) >> 30;
+
+        s_vrc = (int32_t)((((int64_t)s_vrc * a) >> 30) +
+                          ((drive * Q31_SCALE) / 1000000000LL));
     }
-    delta = delta / ((int64_t)BMS_NOMINAL_CAPACITY_MAH * 360);
 
-    int32_t new_soc = (int32_t)s_soc_hundredths + (int32_t)delta;
-    if (new_soc < 0) { new_soc = 0; }
-    if (new_soc > 10000) { new_soc = 10000; }
-    s_soc_hundredths = (uint16_t)new_soc;
+    s_acc_ms += dt_ms;
+    if (s_acc_ms > SOC_ACC_MAX_MS) { s_acc_ms = SOC_ACC_MAX_MS; }
+    {
+        uint32_t amps = (uint32_t)((i_ma < 0) ? -i_ma : i_ma) / 1000U;
+        uint32_t add = amps * dt_ms;
+        s_acc_amp_ms = (s_acc_amp_ms > 0xFFFFFFFFU - add) ? 0xFFFFFFFFU
+                                                          : s_acc_amp_ms + add;
+    }
 
-    int32_t abs_current = pack->pack_current_ma;
-    if (abs_current < 0) { abs_current = -abs_current; }
+    s_soc_hundredths = q31_to_hundredths(s_soc);
+    pack->soc_hundredths = s_soc_hundredths;
+}
 
-    if (abs_current < SOC_LOW_CURRENT_MA) {
-        if (s_low_current_ms <= (0xFFFFFFFFU - dt_ms)) {
-            s_low_current_ms += dt_ms;
-        }
-    } else {
-        s_low_current_ms = 0U;
+void bms_soc_correct(bms_pack_data_t *pack)
+{
+    int32_t i_ma = pack->pack_current_ma;
+    int32_t h1, y_uv, e_uv, e;
+    int64_t a, q11, ph1, ph2, s, k1, k2, p11, p12, p22, r;
+
+    if (s_acc_ms < BMS_SOC_EKF_PERIOD_MS || pack->avg_cell_mv == 0U) { return; }
+
+    /* Covariance predict over the time since the last correction:
+     * F = diag(1, a), Q accrued per second (A·ms/1000 = A·s) */
+    a = decay_q30(s_acc_ms);
+    q11 = ((int64_t)BMS_SOC_EKF_Q_SOC_REST * s_acc_ms +
+           (int64_t)BMS_SOC_EKF_Q_SOC_PER_A * s_acc_amp_ms) / 1000;
+    p11 = (int64_t)s_p11 + q11;
+    p12 = ((int64_t)s_p12 * a) >> 30;
+    p22 = ((((((int64_t)s_p22 * a) >> 30) * a) >> 30) +
+           (int64_t)BMS_SOC_EKF_Q_VRC * s_acc_ms / 1000);
+    s_acc_ms = 0U;
+    s_acc_amp_ms = 0U;
+    if (p11 > P11_MAX) { p11 = P11_MAX; }
+    if (p22 > P22_MAX) { p22 = P22_MAX; }
+
+    /* Predicted terminal voltage; R0·I: µΩ × mA = nV */
+    y_uv = bms_soc_model_cell_uv(i_ma, &h1);
+    e_uv = (int32_t)pack->avg_cell_mv * 1000 - y_uv;
+    s_innov_uv = e_uv;
+    e_uv = clamp32(e_uv, -BMS_SOC_EKF_INNOV_MAX_MV * 1000, BMS_SOC_EKF_INNOV_MAX_MV * 1000);
+    e = uv_to_q31(e_uv);                                         /* ≤ 2^27 */
+
+    /* Measurement variance: fixed part + (sigma_R0 · I)² */
+    {
+        int64_t sr_uv = ((int64_t)BMS_SOC_EKF_R0_STD_UOHM * i_ma) / 1000;
+        r = BMS_SOC_EKF_R_MEAS + (sr_uv * sr_uv * 2147) / 1000000;   /* µV² → Q31 V² */
     }
 
-    if (s_low_current_ms >= SOC_OCV_RESET_MS && pack->mode == BMS_MODE_READY) {
-        s_soc_hundredths = bms_soc_from_ocv(pack->avg_cell_mv);
-        s_low_current_ms = 0U;
+    /* P·Hᵀ (Q31 SoC·V, V²) and S = H·P·Hᵀ + R (Q31 V²).
+     * p11 ≤ 2^29, h1 ≤ 14 V in Q16 ≤ 2^20: products ≤ 2^49 */
+    ph1 = ((p11 * h1) >> 16) + p12;
+    ph2 = ((p12 * h1) >> 16) + p22;
+    s = ((ph1 * h1) >> 16) + ph2 + r;
+
+    /* Gains Q24; k1 ≤ 1/min(dOCV/dSoC) ≈ 4 SoC/V */
+    k1 = (ph1 * Q24_SCALE) / s;
+    k2 = (ph2 * Q24_SCALE) / s;
+
+    s_soc = clamp32((int64_t)s_soc + ((k1 * e) >> 24), 0, Q31_ONE);
+    s_vrc = clamp32((int64_t)s_vrc + ((k2 * e) >> 24), -Q31_ONE, Q31_ONE);
+
+    p11 -= (k1 * ph1) >> 24;
+    p12 -= (k1 * ph2) >> 24;
+    p22 -= (k2 * ph2) >> 24;
+
+    /* Fixed-point rounding must not break symmetry or definiteness */
+    s_p11 = clamp32(p11, P11_MIN, P11_MAX);
+    s_p22 = clamp32(p22, P22_MIN, P22_MAX);
+    {
+        int64_t lim = (int64_t)isqrt64((uint64_t)s_p11 * (uint64_t)s_p22);
+        s_p12 = clamp32(p12, (int32_t)-lim, (int32_t)lim);
     }
+    s_updates++;
 
+    s_soc_hundredths = q31_to_hundredths(s_soc);
     pack->soc_hundredths = s_soc_hundredths;
 }
+
+int64_t bms_soc_get_charge_q31(void) { return s_cc_total; }
+
+int32_t bms_soc_ocv_uv(int32_t soc_ppm, int32_t *slope_q16)
+{
+    soc_ppm = clamp32(soc_ppm, 0, 1000000);
+    return ocv_uv((int32_t)(((int64_t)soc_ppm * Q31_ONE) / 1000000), slope_q16);
+}
+
+int32_t bms_soc_rc_decay_q30(uint32_t dt_ms) { return decay_q30(dt_ms); }
+
+void bms_soc_get_estimate(bms_soc_est_t *out)
+{
+    uint32_t sd_soc = isqrt64((uint64_t)s_p11 << 31);           /* Q31 */
+    uint32_t sd_vrc = isqrt64((uint64_t)s_p22 << 31);
+    uint32_t sd_prod = (uint32_t)(((uint64_t)sd_soc * sd_vrc) >> 31);
+
+    out->soc_hundredths = s_soc_hundredths;
+    out->soc_std_hundredths = q31_to_hundredths((int32_t)sd_soc);
+    out->vrc_uv = q31_to_uv(s_vrc);
+    out->vrc_std_uv = (uint32_t)q31_to_uv((int32_t)sd_vrc);
+    out->corr_pct = (sd_prod == 0U) ? 0 :
+        (int8_t)clamp32(((int64_t)s_p12 * 100) / (int64_t)sd_prod, -100, 100);
+    out->innov_uv = s_innov_uv;
+    out->updates = s_updates;
+}
+
+void bms_soc_encode_can(bms_can_frame_t *frame)
+{
+    bms_can_msg_soc_est_t m;
+    bms_soc_est_t est;
+
+    bms_soc_get_estimate(&est);
+    m.soc_hundredths = est.soc_hundredths;
+    m.soc_std_hundredths = est.soc_std_hundredths;
+    m.vrc_uv = est.vrc_uv;
+    m.vrc_std_uv = (est.vrc_std_uv > 25500U) ? 25500U : est.vrc_std_uv;
+    m.corr_pct = est.corr_pct;
+    bms_can_msg_soc_est_encode(&m, frame);
+}
@@ -0,0 +1,302 @@
+/**
+ * @file bms_soh.c
+ * @brief State of health — online resistance and capacity by RLS
+ *
+ * Street Smart Edition.
+ * Units: resistance regressor x in dA, y in 0.1 µV, so θ = y/x is µΩ;
+ * capacity regressor x in 0.01 % SoC (OCV), y in 0.01 % of nominal Q8,
+ * so θ is C/C_nom in Q16. Sums are uint64 — only events with x·y > 0 are
+ * accepted, so they never go negative — and bounded by the forgetting
+ * factor at roughly 1/(1 − λ) times the largest event.
+ */
+
+#include "bms_soh.h"
+#include "bms_soc.h"
+#include "bms_config.h"
+#include <string.h>
+
+#if defined(__GNUC__)
+  #define SOH_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define SOH_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+  #define SOH_LOAD(p)       (*(p))
+  #define SOH_STORE(p, v)   (*(p) = (v))
+#endif
+
+#define Q31_SCALE        (1LL << 31)
+/* Two module visits: a full-scan sweep is 22 ticks, the summary-mode
+ * rotation 22 × BMS_ACQ_DETAIL_EVERY_TICKS */
+#define R_MAX_GAP_MS     (2U * BMS_ACQ_DETAIL_EVERY_TICKS * BMS_NUM_MODULES * BMS_MONITOR_PERIOD_MS)
+#define R_MIN_UOHM       ((uint32_t)BMS_SOH_R_MODULE_NOM_UOHM * BMS_SOH_R_MIN_PCT / 100U)
+#define R_MAX_UOHM       ((uint32_t)BMS_SOH_R_MODULE_NOM_UOHM * BMS_SOH_R_MAX_PCT / 100U)
+#define CAP_MIN_Q16      ((uint32_t)((65536ULL * BMS_SOH_CAP_MIN_PCT) / 100U))
+#define CAP_MAX_Q16      ((uint32_t)((65536ULL * BMS_SOH_CAP_MAX_PCT) / 100U))
+
+_Static_assert(R_MAX_UOHM <= 0xFFFFU, "Module R is persisted as uint16_t");
+
+typedef struct {
+    uint64_t sxx;
+    uint64_t sxy;
+    uint32_t theta;
+} rls_t;
+
+typedef struct {
+    uint32_t capacity_mah;
+    uint16_t module_r_uohm[BMS_NUM_MODULES];
+} soh_rec_t;
+
+/* Resistance, per module */
+static rls_t    s_r[BMS_NUM_MODULES];               /* θ in µΩ */
+static int32_t  s_r_prev_ma[BMS_NUM_MODULES];
+static uint16_t s_r_prev_mv[BMS_NUM_MODULES];
+static uint32_t s_r_prev_t_ms[BMS_NUM_MODULES];
+static uint32_t s_r_seen;                           /* bit m: prev valid */
+static uint32_t s_r_events;
+
+/* Capacity */
+static rls_t    s_cap;                              /* θ = C/C_nom, Q16 */
+static uint32_t s_rest_ms;
+static bool     s_rest_taken;
+static bool     s_anchor_valid;
+static uint16_t s_anchor_soc;
+static int64_t  s_anchor_cc;
+static uint32_t s_cap_events;
+
+/* Hand-over to the NVM task */
+static soh_rec_t s_persist;                         /* last handed over */
+static uint32_t  s_persist_t_ms;
+static bool      s_cap_dirty;
+static soh_rec_t s_ready_rec;
+static volatile bool s_ready;
+static uint32_t  s_persisted;
+
+_Static_assert(BMS_NUM_MODULES <= 32U, "Module bitmaps are uint32_t");
+
+/* ── RLS ───────────────────────────────────────────────────────────── */
+
+/* s·λ without the 64-bit product overflowing */
+static uint64_t forget(uint64_t s, uint32_t lambda_q16)
+{
+    return (s >> 16) * lambda_q16 + (((s & 0xFFFFU) * lambda_q16) >> 16);
+}
+
+/* Prior of `weight` at θ; θ is in y/x units × scale, as rls_add reports it */
+static void rls_seed(rls_t *r, uint64_t weight, uint32_t theta, uint32_t scale)
+{
+    r->sxx = weight;
+    r->sxy = (weight * theta) / scale;
+    r->theta = theta;
+}
+
+/* One event, |x|·|y| > 0; θ clamped to [lo, hi] */
+static void rls_add(rls_t *r, uint32_t lambda_q16, uint32_t ax, uint32_t ay,
+                    uint32_t scale, uint32_t lo, uint32_t hi)
+{
+    uint64_t t;
+
+    r->sxx = forget(r->sxx, lambda_q16) + (uint64_t)ax * ax;
+    r->sxy = forget(r->sxy, lambda_q16) + (uint64_t)ax * ay;
+    t = (r->sxy * scale) / r->sxx;
+    r->theta = (t < lo) ? lo : (t > hi) ? hi : (uint32_t)t;
+}
+
+static uint32_t cap_mah(void)
+{
+    return (uint32_t)(((uint64_t)BMS_NOMINAL_CAPACITY_MAH * s_cap.theta + 32768U) >> 16);
+}
+
+/* ── Persistence hand-over ─────────────────────────────────────────── */
+
+static void snapshot(soh_rec_t *rec)
+{
+    uint8_t m;
+
+    rec->capacity_mah = cap_mah();
+    for (m = 0U; m < BMS_NUM_MODULES; m++) {
+        rec->module_r_uohm[m] = (uint16_t)s_r[m].theta;
+    }
+}
+
+static bool r_moved(void)
+{
+    uint8_t m;
+
+    for (m = 0U; m < BMS_NUM_MODULES; m++) {
+        uint32_t was = s_persist.module_r_uohm[m];
+        uint32_t now = s_r[m].theta;
+        uint32_t d = (now > was) ? now - was : was - now;
+        if (d * 100U > was * BMS_SOH_PERSIST_R_PCT) { return true; }
+    }
+    return false;
+}
+
+static void maybe_hand_over(uint32_t now_ms)
+{
+    bool due = s_cap_dirty ||
+               ((now_ms - s_persist_t_ms) >= BMS_SOH_PERSIST_MIN_MS && r_moved());
+
+    if (!due || SOH_LOAD(&s_ready)) { return; }      /* NVM task still busy */
+    snapshot(&s_persist);
+    s_ready_rec = s_persist;
+    SOH_STORE(&s_ready, true);
+    s_persist_t_ms = now_ms;
+    s_cap_dirty = false;
+}
+
+/* ── API ───────────────────────────────────────────────────────────── */
+
+void bms_soh_init(void)
+{
+    uint8_t m;
+
+    for (m = 0U; m < BMS_NUM_MODULES; m++) {
+        rls_seed(&s_r[m], BMS_SOH_R_PRIOR_DA2, BMS_SOH_R_MODULE_NOM_UOHM, 1U);
+        s_r_prev_ma[m] = 0;
+        s_r_prev_mv[m] = 0U;
+        s_r_prev_t_ms[m] = 0U;
+    }
+    s_r_seen = 0U;
+    s_r_events = 0U;
+
+    rls_seed(&s_cap, BMS_SOH_CAP_PRIOR, 65536U, 256U);
+    s_rest_ms = 0U;
+    s_rest_taken = false;
+    s_anchor_valid = false;
+    s_anchor_soc = 0U;
+    s_anchor_cc = 0;
+    s_cap_events = 0U;
+
+    snapshot(&s_persist);
+    s_persist_t_ms = 0U;
+    s_cap_dirty = false;
+    SOH_STORE(&s_ready, false);
+    s_persisted = 0U;
+}
+
+void bms_soh_restore(const bms_nvm_persistent_t *p)
+{
+    uint8_t m;
+
+    if (p->soh_capacity_mah != 0U) {
+        uint32_t q = (uint32_t)(((uint64_t)p->soh_capacity_mah << 16) /
+                                BMS_NOMINAL_CAPACITY_MAH);
+        q = (q < CAP_MIN_Q16) ? CAP_MIN_Q16 : (q > CAP_MAX_Q16) ? CAP_MAX_Q16 : q;
+        rls_seed(&s_cap, BMS_SOH_CAP_PRIOR, q, 256U);
+    }
+    for (m = 0U; m < BMS_NUM_MODULES; m++) {
+        uint32_t r = p->soh_module_r_uohm[m];
+        if (r != 0U) {
+            r = (r < R_MIN_UOHM) ? R_MIN_UOHM : (r > R_MAX_UOHM) ? R_MAX_UOHM : r;
+            rls_seed(&s_r[m], BMS_SOH_R_PRIOR_DA2, r, 1U);
+        }
+    }
+    snapshot(&s_persist);                           /* already stored */
+}
+
+void bms_soh_module_scan(const bms_pack_data_t *pack, uint8_t mod_idx)
+{
+    int32_t i_ma = pack->pack_current_ma;
+    uint16_t v_mv;
+    bool fresh;
+
+    if (mod_idx >= BMS_NUM_MODULES) { return; }
+    v_mv = pack->modules[mod_idx].stack_mv;
+    fresh = ((s_r_seen & (1UL << mod_idx)) != 0U) &&
+            (pack->uptime_ms - s_r_prev_t_ms[mod_idx]) <= R_MAX_GAP_MS;
+
+    if (fresh && v_mv != 0U) {
+        int32_t di = i_ma - s_r_prev_ma[mod_idx];
+        int32_t dv = (int32_t)v_mv - (int32_t)s_r_prev_mv[mod_idx];
+
+        /* Same sign: R > 0. dA and 0.1 µV: |x| ≤ 12 800, |y| ≤ 6.6·10^8 */
+        if ((di >= BMS_SOH_R_STEP_MA || di <= -BMS_SOH_R_STEP_MA) &&
+            ((di > 0 && dv > 0) || (di < 0 && dv < 0))) {
+            uint32_t ax = (uint32_t)((di < 0) ? -di : di) / 100U;
+            uint32_t ay = (uint32_t)((dv < 0) ? -dv : dv) * 10000U;
+
+            rls_add(&s_r[mod_idx], BMS_SOH_R_LAMBDA_Q16, ax, ay, 1U,
+                    R_MIN_UOHM, R_MAX_UOHM);
+            s_r_events++;
+        }
+    }
+    if (v_mv != 0U) {
+        s_r_seen |= 1UL << mod_idx;
+        s_r_prev_ma[mod_idx] = i_ma;
+        s_r_prev_mv[mod_idx] = v_mv;
+        s_r_prev_t_ms[mod_idx] = pack->uptime_ms;
+    }
+}
+
+void bms_soh_update(const bms_pack_data_t *pack, uint32_t dt_ms)
+{
+    int32_t i_ma = pack->pack_current_ma;
+
+    if (i_ma < BMS_SOH_REST_MA && i_ma > -BMS_SOH_REST_MA) {
+        s_rest_ms = (s_rest_ms > 0xFFFFFFFFU - dt_ms) ? 0xFFFFFFFFU : s_rest_ms + dt_ms;
+    } else {
+        s_rest_ms = 0U;
+        s_rest_taken = false;
+    }
+
+    if (s_rest_ms >= BMS_SOH_REST_MS && !s_rest_taken && pack->avg_cell_mv != 0U) {
+        uint16_t soc = bms_soc_from_ocv(pack->avg_cell_mv);
+        int64_t cc = bms_soc_get_charge_q31();
+
+        s_rest_taken = true;
+        if (s_anchor_valid) {
+            int32_t dx = (int32_t)soc - (int32_t)s_anchor_soc;
+            int64_t dy = ((cc - s_anchor_cc) * 2560000LL) / Q31_SCALE;   /* Q8 */
+            uint32_t ax = (uint32_t)((dx < 0) ? -dx : dx);
+
+            if (ax >= BMS_SOH_CAP_MIN_SWING &&
+                ((dx > 0 && dy > 0) || (dx < 0 && dy < 0)) &&
+                (dy < 0 ? -dy : dy) <= 0xFFFFFFFFLL) {
+                rls_add(&s_cap, BMS_SOH_CAP_LAMBDA_Q16, ax,
+                        (uint32_t)((dy < 0) ? -dy : dy), 256U,
+                        CAP_MIN_Q16, CAP_MAX_Q16);
+                s_cap_events++;
+                s_cap_dirty = true;
+            }
+        }
+        s_anchor_valid = true;
+        s_anchor_soc = soc;
+        s_anchor_cc = cc;
+    }
+
+    maybe_hand_over(pack->uptime_ms);
+}
+
+uint32_t bms_soh_get_capacity_mah(void) { return cap_mah(); }
+
+uint32_t bms_soh_get_module_r_uohm(uint8_t mod_idx)
+{
+    return (mod_idx < BMS_NUM_MODULES) ? s_r[mod_idx].theta : 0U;
+}
+
+void bms_soh_get(bms_soh_t *out)
+{
+    uint8_t m;
+
+    out->capacity_mah = cap_mah();
+    out->pack_r_uohm = 0U;
+    for (m = 0U; m < BMS_NUM_MODULES; m++) { out->pack_r_uohm += s_r[m].theta; }
+    out->r_events = s_r_events;
+    out->cap_events = s_cap_events;
+    out->persisted = s_persisted;
+}
+
+bool bms_soh_flush(bms_nvm_ctx_t *ctx)
+{
+    soh_rec_t r;
+
+    if (!SOH_LOAD(&s_ready)) { return false; }
+    r = s_ready_rec;
+    SOH_STORE(&s_ready, false);
+
+    ctx->persistent.soh_capacity_mah = r.capacity_mah;
+    memcpy(ctx->persistent.soh_module_r_uohm, r.module_r_uohm,
+           sizeof(ctx->persistent.soh_module_r_uohm));
+    bms_nvm_save_persistent(ctx);
+    s_persisted++;
+    return true;
+}
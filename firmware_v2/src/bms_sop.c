@@ -0,0 +1,247 @@
+/**
+ * @file bms_sop.c
+ * @brief State of power — sustainable current over 2 / 10 / 30 s horizons
+ *
+ * Street Smart Edition.
+ * Units: V in µV, R in µΩ, I in mA (V·1000 / R), SoC in ppm. The OCV
+ * term as a resistance: ΔSoC = I·h / (C·3.6) ppm, so dOCV/dSoC (Q16 V)
+ * adds slope·h·10⁴ / (2^16·36·C) µΩ.
+ */
+
+#include "bms_sop.h"
+#include "bms_soc.h"
+#include "bms_soh.h"
+#include "bms_can_msgs.h"
+#include "bms_config.h"
+
+#define Q30_ONE         (1L << 30)
+#define SOP_WIRE_MAX_MA 655350      /* U16 × 100 mA */
+
+/* Module R(T, SoC) in µΩ — cell datasheet, rows SoC, columns T. U-shaped
+ * in SoC, lowest at 50 %. */
+#define R_NUM_T  6U
+#define R_NUM_S  7U
+#define R_S0     500                /* SoC axis: 5 % … 95 % every 15 % */
+#define R_DS     1500
+
+static const int16_t  k_r_temp[R_NUM_T] = { -100, 0, 100, 250, 350, 450 };
+static const uint16_t k_r_mod_uohm[R_NUM_S][R_NUM_T] = {
+    { 15300U, 9700U, 6200U, 5000U, 4400U, 4100U },     /*  5 % */
+    { 10900U, 7200U, 4700U, 3600U, 3300U, 3100U },     /* 20 % */
+    {  9900U, 6600U, 4300U, 3300U, 3000U, 2800U },     /* 35 % */
+    {  9300U, 6200U, 4000U, 3100U, 2800U, 2600U },     /* 50 % */
+    {  9600U, 6400U, 4200U, 3200U, 2900U, 2700U },     /* 65 % */
+    { 10200U, 6800U, 4400U, 3400U, 3100U, 2900U },     /* 80 % */
+    { 13500U, 8900U, 5600U, 4200U, 3900U, 3600U },     /* 95 % */
+};
+
+static const uint32_t k_horizon_ms[BMS_SOP_HORIZONS] = {
+    BMS_SOP_HORIZON_1_MS, BMS_SOP_HORIZON_2_MS, BMS_SOP_HORIZON_3_MS
+};
+
+static int32_t  s_decay_q30[BMS_SOP_HORIZONS];
+static uint32_t s_acc_ms;
+
+_Static_assert(BMS_SOP_HORIZONS == 3U, "CAN layout carries three horizons");
+_Static_assert(BMS_SOP_HORIZON_3_MS <= 60000U, "RC decay is bounded to 60 s");
+
+typedef struct {
+    int32_t  soc_ppm;
+    int32_t  ocv_uv;
+    int32_t  slope_q16;
+    int32_t  r0_uohm;
+    int32_t  vrc_uv;
+    uint32_t cap_mah;
+    uint32_t age_q16;
+    int16_t  temp_deci_c;
+} sop_cell_t;
+
+/* ── Model ─────────────────────────────────────────────────────────── */
+
+uint32_t bms_sop_cell_r_uohm(int16_t temp_deci_c, uint16_t soc_hundredths)
+{
+    int32_t t = temp_deci_c;
+    int32_t s = soc_hundredths;
+    uint8_t ti, si;
+    int32_t dt, ft, fs;
+    int64_t r0, r1;
+
+    if (t < k_r_temp[0]) { t = k_r_temp[0]; }
+    if (t > k_r_temp[R_NUM_T - 1U]) { t = k_r_temp[R_NUM_T - 1U]; }
+    if (s < R_S0) { s = R_S0; }
+    if (s > R_S0 + (int32_t)(R_NUM_S - 1U) * R_DS) { s = R_S0 + (int32_t)(R_NUM_S - 1U) * R_DS; }
+
+    for (ti = 0U; ti < R_NUM_T - 2U; ti++) {
+        if (t < k_r_temp[ti + 1U]) { break; }
+    }
+    si = (uint8_t)((s - R_S0) / R_DS);
+    if (si > R_NUM_S - 2U) { si = R_NUM_S - 2U; }
+
+    dt = k_r_temp[ti + 1U] - k_r_temp[ti];
+    ft = t - k_r_temp[ti];
+    fs = s - (R_S0 + (int32_t)si * R_DS);
+
+    /* Bilinear, scaled by dt · R_DS until the one division */
+    r0 = (int64_t)k_r_mod_uohm[si][ti] * dt +
+         ((int64_t)k_r_mod_uohm[si][ti + 1U] - k_r_mod_uohm[si][ti]) * ft;
+    r1 = (int64_t)k_r_mod_uohm[si + 1U][ti] * dt +
+         ((int64_t)k_r_mod_uohm[si + 1U][ti + 1U] - k_r_mod_uohm[si + 1U][ti]) * ft;
+    r0 = r0 * R_DS + (r1 - r0) * fs;
+    return (uint32_t)((r0 + (int64_t)dt * R_DS * BMS_SE_PER_MODULE / 2) /
+                      ((int64_t)dt * R_DS * BMS_SE_PER_MODULE));
+}
+
+/* Ageing: bms_soh's pack R, learned over recent steps, against the table
+ * at the present mean temperature and SoC. Never below the table. */
+static uint32_t age_q16(const bms_pack_data_t *pack)
+{
+    bms_soh_t soh;
+    int16_t t_mean = (int16_t)(((int32_t)pack->max_temp_deci_c + pack->min_temp_deci_c) / 2);
+    uint64_t table = (uint64_t)bms_sop_cell_r_uohm(t_mean, pack->soc_hundredths) *
+                     BMS_SE_PER_PACK;
+    uint64_t q;
+
+    bms_soh_get(&soh);
+    q = ((uint64_t)soh.pack_r_uohm << 16) / table;
+    if (q < 65536U) { q = 65536U; }
+    if (q > (65536ULL * BMS_SOP_AGE_MAX_PCT) / 100U) { q = (65536ULL * BMS_SOP_AGE_MAX_PCT) / 100U; }
+    return (uint32_t)q;
+}
+
+static int32_t r0_at(const sop_cell_t *c, int32_t soc_ppm)
+{
+    if (soc_ppm < 0) { soc_ppm = 0; }
+    return (int32_t)(((uint64_t)bms_sop_cell_r_uohm(c->temp_deci_c,
+                                                    (uint16_t)(soc_ppm / 100)) *
+                      c->age_q16) >> 16);
+}
+
+static void cell_at(sop_cell_t *c, const bms_pack_data_t *pack, uint16_t soc,
+                    uint32_t age, int32_t vrc_uv, uint32_t cap_mah)
+{
+    c->soc_ppm = (int32_t)soc * 100;
+    c->ocv_uv = bms_soc_ocv_uv(c->soc_ppm, &c->slope_q16);
+    c->age_q16 = age;
+    c->temp_deci_c = pack->min_temp_deci_c;
+    c->r0_uohm = r0_at(c, c->soc_ppm);
+    c->vrc_uv = vrc_uv;
+    c->cap_mah = cap_mah;
+}
+
+/* Largest |I| (mA) for which the end-of-horizon voltage stays inside
+ * the limit; dir = +1 charge, −1 discharge */
+static int32_t solve(const sop_cell_t *c, int32_t dir, uint32_t h_ms, int32_t a_q30)
+{
+    int64_t v0 = (int64_t)c->ocv_uv + (((int64_t)c->vrc_uv * a_q30) / Q30_ONE);
+    int64_t head = (dir > 0) ? (int64_t)BMS_SOP_V_MAX_MV * 1000 - v0
+                             : v0 - (int64_t)BMS_SOP_V_MIN_MV * 1000;
+    int64_t r_rc = ((int64_t)BMS_SOC_EKF_R1_UOHM * (Q30_ONE - a_q30)) >> 30;
+    int64_t cap36 = (int64_t)c->cap_mah * 36;
+    int64_t r_ocv, i1, i2, room, dppm, i_room;
+    int32_t slope_end, end_ppm;
+
+    if (head <= 0) { return 0; }
+    if (h_ms == 0U) { return (int32_t)((head * 1000) / c->r0_uohm); }
+
+    /* Tangent, R0 where the cell starts */
+    r_ocv = ((int64_t)c->slope_q16 * h_ms * 10000) / (cap36 * 65536);
+    i1 = (head * 1000) / (c->r0_uohm + r_rc + r_ocv);
+
+    /* The cell must not run out of SoC within the horizon either */
+    room = (dir > 0) ? 1000000 - c->soc_ppm : c->soc_ppm;
+    i_room = (room * cap36) / ((int64_t)h_ms * 10);
+    if (i1 > i_room) { i1 = i_room; }
+    if (i1 <= 0) { return 0; }
+
+    /* Secant over the SoC that current would cover, R0 where it ends */
+    dppm = (i1 * h_ms * 10) / cap36;
+    end_ppm = c->soc_ppm + (int32_t)(dir * dppm);
+    {
+        int32_t end = bms_soc_ocv_uv(end_ppm, &slope_end);
+        int64_t dv = (int64_t)end - c->ocv_uv;
+
+        r_ocv = ((dv < 0 ? -dv : dv) * 1000) / i1;
+    }
+    i2 = (head * 1000) / (r0_at(c, end_ppm) + r_rc + r_ocv);
+    if (i2 > i_room) { i2 = i_room; }
+    return (int32_t)((i2 > 0x7FFFFFFF) ? 0x7FFFFFFF : i2);
+}
+
+static void side(const sop_cell_t *c, int32_t dir, int32_t limit_ma, int32_t *out)
+{
+    int32_t cap = solve(c, dir, 0U, Q30_ONE);                /* t = 0 */
+    uint8_t k;
+
+    if (cap > limit_ma) { cap = limit_ma; }
+    if (cap < 0) { cap = 0; }
+    for (k = 0U; k < BMS_SOP_HORIZONS; k++) {
+        int32_t i = solve(c, dir, k_horizon_ms[k], s_decay_q30[k]);
+        if (i < cap) { cap = i; }
+        out[k] = cap;
+    }
+}
+
+/* ── API ───────────────────────────────────────────────────────────── */
+
+void bms_sop_init(bms_pack_data_t *pack)
+{
+    uint8_t k;
+
+    for (k = 0U; k < BMS_SOP_HORIZONS; k++) {
+        s_decay_q30[k] = bms_soc_rc_decay_q30(k_horizon_ms[k]);
+        pack->sop_charge_ma[k] = 0;
+        pack->sop_discharge_ma[k] = 0;
+    }
+    pack->sop_charge_r_uohm = 0U;
+    pack->sop_discharge_r_uohm = 0U;
+    s_acc_ms = 0U;
+}
+
+void bms_sop_compute(bms_pack_data_t *pack)
+{
+    bms_soc_est_t est;
+    sop_cell_t c;
+    uint32_t age = age_q16(pack);
+    uint32_t cap_mah = bms_soh_get_capacity_mah();
+    uint16_t soc_c = pack->cell_soc_valid ? pack->cell_soc_max_hundredths : pack->soc_hundredths;
+    uint16_t soc_d = pack->cell_soc_valid ? pack->cell_soc_min_hundredths : pack->soc_hundredths;
+
+    bms_soc_get_estimate(&est);
+
+    cell_at(&c, pack, soc_d, age, est.vrc_uv, cap_mah);
+    side(&c, -1, pack->discharge_limit_ma, pack->sop_discharge_ma);
+    pack->sop_discharge_r_uohm = (uint16_t)((c.r0_uohm > 0xFFFF) ? 0xFFFF : c.r0_uohm);
+
+    cell_at(&c, pack, soc_c, age, est.vrc_uv, cap_mah);
+    side(&c, 1, pack->charge_limit_ma, pack->sop_charge_ma);
+    pack->sop_charge_r_uohm = (uint16_t)((c.r0_uohm > 0xFFFF) ? 0xFFFF : c.r0_uohm);
+}
+
+void bms_sop_update(bms_pack_data_t *pack, uint32_t dt_ms)
+{
+    s_acc_ms += dt_ms;
+    if (s_acc_ms < BMS_SOP_PERIOD_MS) { return; }
+    s_acc_ms = 0U;
+    bms_sop_compute(pack);
+}
+
+static int32_t wire_ma(int32_t ma) { return (ma > SOP_WIRE_MAX_MA) ? SOP_WIRE_MAX_MA : ma; }
+
+void bms_sop_encode_can(const bms_pack_data_t *pack,
+                        bms_can_frame_t *dchg_frame, bms_can_frame_t *chg_frame)
+{
+    bms_can_msg_sop_dchg_t d;
+    bms_can_msg_sop_chg_t c;
+
+    d.i_2s_ma = wire_ma(pack->sop_discharge_ma[0]);
+    d.i_10s_ma = wire_ma(pack->sop_discharge_ma[1]);
+    d.i_30s_ma = wire_ma(pack->sop_discharge_ma[2]);
+    d.r_uohm = pack->sop_discharge_r_uohm;
+    bms_can_msg_sop_dchg_encode(&d, dchg_frame);
+
+    c.i_2s_ma = wire_ma(pack->sop_charge_ma[0]);
+    c.i_10s_ma = wire_ma(pack->sop_charge_ma[1]);
+    c.i_30s_ma = wire_ma(pack->sop_charge_ma[2]);
+    c.r_uohm = pack->sop_charge_r_uohm;
+    bms_can_msg_sop_chg_encode(&c, chg_frame);
+}
@@ -178,6 +178,7 @@ void bms_state_run(bms_pack_data_t *pack,
         break;
 
     case BMS_MODE_OFF:
+    default:
         break;
     }
 }
@@ -13,8 +13,10 @@
  *  warning." — Implementation Plan
  *
  * Algorithm:
- *   1. Store temperature history in circular buffer (1 sample/sec, 30 samples)
- *   2. Compute dT/dt = (T_now - T_oldest) / window_seconds → deci-°C/min
+ *   1. Push each sample (1 sample/sec) into a 30-sample window per sensor
+ *   2. dT/dt = least-squares slope over the window → deci-°C/min. A single
+ *      spike moves the LSQ slope by a fraction of what it does to a
+ *      two-point difference, so one bad read no longer looks like a ramp.
  *   3. If dT/dt > 1°C/min (10 deci-°C/min) sustained 30s AND current
  *      hasn't increased proportionally → alarm
  *   4. dT/dt alarm → fault_latched, distinct CAN message
@@ -29,6 +31,103 @@
 static void leak_timer_inc(uint32_t *timer, uint32_t dt_ms);
 static void leak_timer_dec(uint32_t *timer, uint32_t dt_ms);
 
+#define N_WIN  ((int32_t)BMS_DTDT_WINDOW_SAMPLES)
+
+/* ── dT/dt estimator ───────────────────────────────────────────────── */
+
+#if BMS_DTDT_ESTIMATOR == BMS_DTDT_EST_LSQ
+
+/* Σk for k = 0..N−1, and N·Σk² − (Σk)² = N²(N²−1)/12 */
+#define LSQ_SUM_K  (N_WIN * (N_WIN - 1) / 2)
+#define LSQ_DEN    (N_WIN * N_WIN * (N_WIN * N_WIN - 1) / 12)
+
+_Static_assert(BMS_DTDT_WINDOW_SAMPLES >= 3U && BMS_DTDT_WINDOW_SAMPLES <= 255U,
+               "dT/dt window out of range");
+
+/**
+ * Push one sample. Before the window is full the sums simply accumulate;
+ * afterwards the oldest sample drops out and every index shifts down by
+ * one, so ΣkT loses Σ(remaining T) and gains (N−1)·T_new.
+ */
+static void dtdt_push(bms_thermal_state_t *therm, uint16_t s, int16_t t_raw)
+{
+    int32_t d, t_new;
+
+    if (therm->history_count == 0U) {
+        therm->oldest_deci_c[s] = t_raw;
+        therm->last_deci_c[s] = t_raw;
+        therm->sum_t[s] = t_raw;
+        therm->sum_kt[s] = 0;
+        return;
+    }
+
+    d = (int32_t)t_raw - therm->last_deci_c[s];
+    if (d > 127) { d = 127; }
+    if (d < -127) { d = -127; }
+    t_new = therm->last_deci_c[s] + d;
+
+    if (therm->history_count < BMS_DTDT_WINDOW_SAMPLES) {
+        therm->sum_kt[s] += (int32_t)therm->history_count * t_new;
+        therm->sum_t[s] += t_new;
+    } else {
+        int32_t rest = therm->sum_t[s] - therm->oldest_deci_c[s];
+        therm->oldest_deci_c[s] = (int16_t)(therm->oldest_deci_c[s] +
+                                            therm->delta[s][therm->history_idx]);
+        therm->sum_kt[s] += (N_WIN - 1) * t_new - rest;
+        therm->sum_t[s] = rest + t_new;
+    }
+    therm->delta[s][therm->history_idx] = (int8_t)d;
+    therm->last_deci_c[s] = (int16_t)t_new;
+}
+
+static int16_t dtdt_slope(const bms_thermal_state_t *therm, uint16_t s)
+{
+    /* slope/sample = (N·ΣkT − Σk·ΣT) / den; × 60 samples/min, rounded */
+    int64_t num = ((int64_t)N_WIN * therm->sum_kt[s] -
+                   (int64_t)LSQ_SUM_K * therm->sum_t[s]) *
+                  (int64_t)(60000U / BMS_DTDT_SAMPLE_PERIOD_MS);
+    int64_t q = (num >= 0) ? ((num + LSQ_DEN / 2) / LSQ_DEN)
+                           : -((-num + LSQ_DEN / 2) / LSQ_DEN);
+    if (q > 32767) { q = 32767; }
+    if (q < -32768) { q = -32768; }
+    return (int16_t)q;
+}
+
+#else /* BMS_DTDT_EST_EWMA */
+
+/**
+ * Brown's double exponential smoothing: S1 = EWMA(T), S2 = EWMA(S1),
+ * slope = α/(1−α)·(S1 − S2). Unbiased on a linear ramp, and alternating
+ * single-sample glitches are attenuated by both stages.
+ */
+static void dtdt_push(bms_thermal_state_t *therm, uint16_t s, int16_t t_raw)
+{
+    int32_t t_q8 = (int32_t)t_raw * 256;
+
+    if (therm->history_count == 0U) {
+        therm->ewma1_q8[s] = t_q8;
+        therm->ewma2_q8[s] = t_q8;
+    } else {
+        therm->ewma1_q8[s] += (t_q8 - therm->ewma1_q8[s]) / (1 << BMS_DTDT_EWMA_SHIFT);
+        therm->ewma2_q8[s] += (therm->ewma1_q8[s] - therm->ewma2_q8[s]) /
+                              (1 << BMS_DTDT_EWMA_SHIFT);
+    }
+    therm->last_deci_c[s] = t_raw;
+}
+
+static int16_t dtdt_slope(const bms_thermal_state_t *therm, uint16_t s)
+{
+    int32_t diff = therm->ewma1_q8[s] - therm->ewma2_q8[s];
+    int32_t den = ((1 << BMS_DTDT_EWMA_SHIFT) - 1) * 256;
+    int32_t num = diff * (int32_t)(60000U / BMS_DTDT_SAMPLE_PERIOD_MS);
+    int32_t q = (num >= 0) ? ((num + den / 2) / den) : -((-num + den / 2) / den);
+    if (q > 32767) { q = 32767; }
+    if (q < -32768) { q = -32768; }
+    return (int16_t)q;
+}
+
+#endif
+
 void bms_thermal_init(bms_thermal_state_t *therm)
 {
     memset(therm, 0, sizeof(*therm));
@@ -44,21 +143,23 @@ void bms_thermal_run(bms_thermal_state_t *therm,
     uint8_t mod, sens;
     uint16_t sensor_idx = 0U;
 
-    /* Store current temperatures in history buffer */
+    /* Push current temperatures into the dT/dt window */
     for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
         for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
-            /* P0-01: Skip faulted sensors */
-            if (pack->modules[mod].sensor_fault[sens].faulted) {
-                sensor_idx++;
-                continue;
-            }
-            therm->temp_history[sensor_idx][therm->history_idx] =
+            /* P0-01: Faulted sensors hold their last good reading */
+            int16_t t = (pack->modules[mod].sensor_fault[sens].faulted &&
+                         therm->history_count > 0U) ?
+                therm->last_deci_c[sensor_idx] :
                 pack->modules[mod].temp_deci_c[sens];
+            dtdt_push(therm, sensor_idx, t);
             sensor_idx++;
         }
     }
 
-    therm->history_idx = (therm->history_idx + 1U) % BMS_DTDT_WINDOW_SAMPLES;
+    if (therm->history_count > 0U) {
+        therm->history_idx = (uint8_t)((therm->history_idx + 1U) %
+                                       (BMS_DTDT_WINDOW_SAMPLES - 1U));
+    }
     if (therm->history_count < BMS_DTDT_WINDOW_SAMPLES) {
         therm->history_count++;
     }
@@ -69,17 +170,10 @@ void bms_thermal_run(bms_thermal_state_t *therm,
     }
 
     /* Compute dT/dt for each sensor */
-    uint8_t oldest_idx = therm->history_idx; /* oldest = current position (circular) */
     bool any_alarm = false;
 
     for (sensor_idx = 0U; sensor_idx < BMS_TOTAL_TEMP_SENSORS; sensor_idx++) {
-        int16_t t_now = therm->temp_history[sensor_idx]
-            [(therm->history_idx + BMS_DTDT_WINDOW_SAMPLES - 1U) % BMS_DTDT_WINDOW_SAMPLES];
-        int16_t t_old = therm->temp_history[sensor_idx][oldest_idx];
-
-        /* dT/dt in deci-°C per 30 seconds.
-         * Convert to deci-°C per minute: multiply by 2 (30s → 60s) */
-        int16_t dtdt = (int16_t)((int32_t)(t_now - t_old) * 2);
+        int16_t dtdt = dtdt_slope(therm, sensor_idx);
         therm->dtdt_deci_c_per_min[sensor_idx] = dtdt;
 
         /* Check alarm threshold */
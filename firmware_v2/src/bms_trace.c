@@ -0,0 +1,218 @@
+/**
+ * @file bms_trace.c
+ * @brief Per-task runtime trace
+ *
+ * Street Smart Edition.
+ * Everything is kept in trace ticks (CPU cycles on target, ns on the
+ * desktop) as 32-bit differences, so counter wrap is harmless for spans
+ * under ~25 s at 168 MHz; conversion to microseconds happens on read.
+ */
+
+#ifdef DESKTOP_BUILD
+  #define _POSIX_C_SOURCE 199309L   /* clock_gettime() under -std=c99 */
+  #include <time.h>
+#endif
+
+#include "bms_trace.h"
+#include "bms_config.h"
+#include "bms_hal.h"
+#include "bms_can_msgs.h"
+#include <string.h>
+
+_Static_assert(TRACE_TASK_COUNT == BMS_TRACE_TASKS, "CAN span must cover every traced task");
+
+/* Published fields: owner stores, any task loads, no ordering needed */
+#if defined(__GNUC__)
+  #define TRC_LOAD(p)       __atomic_load_n((p), __ATOMIC_RELAXED)
+  #define TRC_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#else
+  #define TRC_LOAD(p)       (*(p))
+  #define TRC_STORE(p, v)   (*(p) = (v))
+#endif
+
+#ifdef DESKTOP_BUILD
+  #define TRACE_TICKS_PER_US  1000U
+
+static uint32_t trace_now(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+#else
+  #define TRACE_TICKS_PER_US  (BMS_CPU_HZ / 1000000U)
+
+static uint32_t trace_now(void)
+{
+    return hal_cycle_count();
+}
+#endif
+
+typedef struct {
+    uint32_t runs;
+    uint32_t min_t;
+    uint32_t max_t;
+    uint32_t mean_t;            /* published copy: sum_t tears on a 32-bit CPU */
+    uint64_t sum_t;             /* owner only */
+    uint32_t jitter_t;
+    uint32_t misses;
+    uint32_t period_t;
+    uint32_t start;
+    uint32_t late;              /* lateness of the run in progress */
+    uint16_t period_ms;
+    uint16_t stack_words;
+    uint16_t stack_free_min;
+    bool     started;
+} trace_ent_t;
+
+static trace_ent_t s_ent[TRACE_TASK_COUNT];
+static uint8_t     s_can_next;
+static bms_trace_clock_t s_clock = trace_now;
+
+static uint32_t to_us(uint32_t t)
+{
+    return t / TRACE_TICKS_PER_US;
+}
+
+static uint16_t sat16(uint32_t v)
+{
+    return (v > 0xFFFFU) ? 0xFFFFU : (uint16_t)v;
+}
+
+void bms_trace_init(void)
+{
+    memset(s_ent, 0, sizeof(s_ent));
+    s_can_next = 0U;
+}
+
+void bms_trace_set_clock(bms_trace_clock_t now)
+{
+    s_clock = (now != NULL) ? now : trace_now;
+}
+
+void bms_trace_register(bms_trace_task_t id, uint16_t period_ms, uint16_t stack_words)
+{
+    trace_ent_t *e = &s_ent[id];
+
+    e->period_ms = period_ms;
+    e->period_t = (uint32_t)period_ms * 1000U * TRACE_TICKS_PER_US;
+    e->stack_words = stack_words;
+    e->stack_free_min = stack_words;
+}
+
+void bms_trace_set_period(bms_trace_task_t id, uint16_t period_ms)
+{
+    trace_ent_t *e = &s_ent[id];
+
+    e->period_ms = period_ms;
+    e->period_t = (uint32_t)period_ms * 1000U * TRACE_TICKS_PER_US;
+    e->started = false;
+}
+
+void bms_trace_begin_at(bms_trace_task_t id, uint32_t t)
+{
+    trace_ent_t *e = &s_ent[id];
+
+    e->late = 0U;
+    if (e->started) {
+        uint32_t interval = t - e->start;
+        if (interval > e->period_t) { e->late = interval - e->period_t; }
+        if (e->late > e->jitter_t) { TRC_STORE(&e->jitter_t, e->late); }
+    }
+    e->started = true;
+    e->start = t;
+}
+
+void bms_trace_end_at(bms_trace_task_t id, uint32_t t)
+{
+    trace_ent_t *e = &s_ent[id];
+    uint32_t exec = t - e->start;
+
+    if (e->runs == 0U || exec < e->min_t) { TRC_STORE(&e->min_t, exec); }
+    if (exec > e->max_t) { TRC_STORE(&e->max_t, exec); }
+    e->sum_t += exec;
+    TRC_STORE(&e->mean_t, (uint32_t)(e->sum_t / (e->runs + 1U)));
+    TRC_STORE(&e->runs, e->runs + 1U);
+    if (e->late + exec > e->period_t) { TRC_STORE(&e->misses, e->misses + 1U); }
+}
+
+void bms_trace_begin(bms_trace_task_t id)
+{
+    bms_trace_begin_at(id, s_clock());
+}
+
+void bms_trace_end(bms_trace_task_t id)
+{
+    bms_trace_end_at(id, s_clock());
+}
+
+uint32_t bms_trace_ticks_per_us(void)
+{
+    return TRACE_TICKS_PER_US;
+}
+
+void bms_trace_stack(bms_trace_task_t id, uint16_t free_words)
+{
+    if (free_words < s_ent[id].stack_free_min) { TRC_STORE(&s_ent[id].stack_free_min, free_words); }
+}
+
+void bms_trace_get(bms_trace_task_t id, bms_trace_stats_t *out)
+{
+    const trace_ent_t *e = &s_ent[id];
+
+    out->runs = TRC_LOAD(&e->runs);
+    out->min_us = to_us(TRC_LOAD(&e->min_t));
+    out->max_us = to_us(TRC_LOAD(&e->max_t));
+    out->mean_us = to_us(TRC_LOAD(&e->mean_t));
+    out->jitter_max_us = to_us(TRC_LOAD(&e->jitter_t));
+    out->misses = TRC_LOAD(&e->misses);
+    out->period_ms = e->period_ms;
+    out->stack_words = e->stack_words;
+    out->stack_free_min = TRC_LOAD(&e->stack_free_min);
+}
+
+void bms_trace_encode_can(bms_trace_task_t id, bms_can_frame_t *frame)
+{
+    bms_can_msg_task_trace_t m;
+    bms_trace_stats_t st;
+
+    bms_trace_get(id, &st);
+    m.max_us = sat16(st.max_us);
+    m.mean_us = sat16(st.mean_us);
+    m.jitter_us = sat16(st.jitter_max_us);
+    m.misses = (st.misses > 0xFFU) ? 0xFFU : (uint8_t)st.misses;
+    m.stack_used_pct = (st.stack_words == 0U) ? 0xFFU :
+        (uint8_t)(((uint32_t)(st.stack_words - st.stack_free_min) * 100U) / st.stack_words);
+    bms_can_msg_task_trace_encode(&m, frame);
+    frame->id += (uint32_t)id;
+}
+
+void bms_trace_next_can(bms_can_frame_t *frame)
+{
+    bms_trace_encode_can((bms_trace_task_t)s_can_next, frame);
+    s_can_next++;
+    if (s_can_next >= (uint8_t)TRACE_TASK_COUNT) { s_can_next = 0U; }
+}
+
+void bms_trace_report(void)
+{
+#ifdef DESKTOP_BUILD
+    static const char *const k_name[TRACE_TASK_COUNT] = {
+        "prot", "mon", "cont", "sio", "state", "can", "therm", "nvm"
+    };
+    uint8_t i;
+
+    BMS_LOG("Trace: task  period   runs   min/mean/max us   jitter us  miss  stack free/size");
+    for (i = 0U; i < (uint8_t)TRACE_TASK_COUNT; i++) {
+        bms_trace_stats_t st;
+        bms_trace_get((bms_trace_task_t)i, &st);
+        if (st.runs == 0U) { continue; }
+        BMS_LOG("Trace: %-5s %4u ms %7lu %5lu/%lu/%lu %9lu %5lu  %u/%u",
+                k_name[i], (unsigned)st.period_ms, (unsigned long)st.runs,
+                (unsigned long)st.min_us, (unsigned long)st.mean_us,
+                (unsigned long)st.max_us, (unsigned long)st.jitter_max_us,
+                (unsigned long)st.misses,
+                (unsigned)st.stack_free_min, (unsigned)st.stack_words);
+    }
+#endif
+}
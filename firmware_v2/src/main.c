@@ -6,7 +6,7 @@
  * Startup sequence:
  *   1. HAL init (clocks, GPIO, peripherals)
  *   2. IWDG reset detection + NVM logging
- *   3. NVM init + load persistent data
+ *   3. NVM init + load persistent data, fault queue, black box, history
  *   4. AFE init (BQ76952 per module — includes HW protection config)
  *   5. Monitor init (zero pack data)
  *   6. Protection init
@@ -14,9 +14,9 @@
  *   8. Safety I/O init
  *   9. Contactor init (opens all contactors as fail-safe)
  *  10. State machine init
- *  11. CAN init (filter setup)
+ *  11. CAN init (filter setup) + runtime trace
  *  12. IWDG init (start watchdog LAST — after all init completes)
- *  13. Start RTOS tasks (or enter main loop)
+ *  13. Start RTOS tasks (or enter the bms_sched main loop)
  */
 
 #include "bms_hal.h"
@@ -30,10 +30,22 @@
 #include "bms_contactor.h"
 #include "bms_state.h"
 #include "bms_can.h"
+#include "bms_can_txq.h"
+#include "bms_can_rx.h"
+#include "bms_can_diag.h"
+#include "bms_can_auth.h"
 #include "bms_nvm.h"
+#include "bms_nvm_queue.h"
+#include "bms_blackbox.h"
+#include "bms_history.h"
+#include "bms_trace.h"
 #include "bms_balance.h"
 #include "bms_soc.h"
+#include "bms_soh.h"
+#include "bms_sop.h"
 #include "bms_current_limit.h"
+#include "bms_sched.h"
+#include "bms_power.h"
 
 /* ── Global state ──────────────────────────────────────────────────── */
 
@@ -45,6 +57,8 @@ static bms_contactor_ctx_t      g_contactor;
 static bms_nvm_ctx_t            g_nvm;
 static bms_ems_command_t        g_ems_cmd;
 
+#define MAIN_STACK_WORDS ((uint16_t)(BMS_TRACE_MAIN_STACK_BYTES / 4U))
+
 /* ── Forward declarations for task functions ───────────────────────── */
 
 void bms_task_monitor(void);
@@ -66,16 +80,21 @@ static int32_t bms_init_all(void)
     hal_init();
 
     /* 2. NVM init + check for IWDG reset */
-    bms_nvm_init(&g_nvm);
-    bms_nvm_load_persistent(&g_nvm);
+    bms_nvm_init(&g_nvm);    /* mounts the journal, loads persistent data */
 
     if (hal_iwdg_was_reset()) {
         bms_nvm_log_fault(&g_nvm, 0U, NVM_FAULT_IWDG, 0xFFU, 0U);
+        (void)bms_nvm_commit(&g_nvm);
         BMS_LOG("IWDG reset detected — logged to NVM");
     }
 
-    /* 3. Wire NVM into protection for fault logging */
-    bms_protection_set_nvm(&g_nvm);
+    /* 3. Fault events: protection/safety I/O → queue → NVM drain;
+     *    black box and operating history sampled by their tasks,
+     *    written by the same drain */
+    bms_nvm_queue_init();
+    bms_blackbox_init();
+    bms_history_init();      /* mounts the tier rings */
+    hal_brownout_init();
 
     /* 4. AFE init — BQ76952 per module (includes HW protection config) */
     for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
@@ -86,8 +105,12 @@ static int32_t bms_init_all(void)
         }
     }
 
-    /* 5. Monitor init (zeroes pack data, inits SoC + balance) */
+    /* 5. Monitor init (zeroes pack data, inits SoC + balance, summary
+     *    acquisition per BMS_ACQ_SUMMARY_ENABLED — both the bare-metal
+     *    loop and the RTOS monitor task run this), then the learned
+     *    capacity/R from the persistent record mounted in step 2 */
     bms_monitor_init(&g_pack);
+    bms_soh_restore(&g_nvm.persistent);
 
     /* 6. Protection init */
     bms_protection_init(&g_prot);
@@ -95,8 +118,7 @@ static int32_t bms_init_all(void)
     /* 7. Thermal init */
     bms_thermal_init(&g_thermal);
 
-    /* 8. Safety I/O init + wire NVM for IMD trend logging */
-    bms_safety_io_set_nvm(&g_nvm);
+    /* 8. Safety I/O init */
     bms_safety_io_init(&g_safety_io);
 
     /* 9. Contactor init — opens all contactors (fail-safe default) */
@@ -105,8 +127,13 @@ static int32_t bms_init_all(void)
     /* 10. State machine init */
     bms_state_init(&g_pack);
 
-    /* 11. CAN init (hardware filter setup) */
+    /* 11. CAN init (hardware filter setup), receive FV from the journal
+     *     (no replay across the reset) + ISO-TP diagnostic sources */
     bms_can_init();
+    bms_can_auth_restore(&g_nvm.persistent);
+    bms_can_diag_init(&g_pack, &g_prot, &g_nvm);
+    bms_trace_init();
+    bms_power_init(hal_tick_ms());
 
     /* 12. Start IWDG LAST — all init must complete before watchdog runs */
     hal_iwdg_init(BMS_IWDG_TIMEOUT_MS);
@@ -119,91 +146,222 @@ static int32_t bms_init_all(void)
  * Main Loop (bare-metal cooperative scheduler)
  *
  * If using FreeRTOS, replace this with vTaskStartScheduler() and
- * create tasks in bms_tasks.c. This loop provides the same timing
- * guarantees via tick-based scheduling.
+ * create tasks in bms_tasks.c. Here bms_sched releases the slots below
+ * on a fixed grid, highest priority first (see bms_sched.h). Each slot
+ * gets the period it ran at as dt — longer at the POWER_SAVE cadence
+ * (bms_power.h), when the loop sleeps in STOP between releases.
  * ═══════════════════════════════════════════════════════════════════════ */
 
-int main(void)
+/* ── 10ms: Monitor (cell voltage + temp reads) ─────────────────────── */
+static void loop_monitor(uint32_t dt_ms)
 {
-    int32_t rc;
-    uint32_t now, last_monitor, last_protection, last_can;
-    uint32_t last_contactor, last_state, last_thermal, last_safety_io;
+    bms_monitor_run_dt(&g_pack, dt_ms);
+}
 
-    rc = bms_init_all();
-    if (rc != 0) {
-        /* Init failed — enter safe state with contactors open (already done
-         * by contactor_init). Spin forever; IWDG will reset us. */
-        while (1) { /* IWDG will fire */ }
-    }
+/* ── 10ms: Protection (OV/UV/OT/OC/sub-zero checks) ───────────────── */
+static void loop_protection(uint32_t dt_ms)
+{
+    bms_protection_run(&g_prot, &g_pack, dt_ms);
+    bms_blackbox_record(&g_pack);
+    bms_power_update(&g_pack, hal_tick_ms());
 
-    now = hal_tick_ms();
-    last_monitor    = now;
-    last_protection = now;
-    last_can        = now;
-    last_contactor  = now;
-    last_state      = now;
-    last_thermal    = now;
-    last_safety_io  = now;
+    /* P1-02: Feed IWDG from protection loop.
+     * If protection hangs, watchdog fires → safe reset. */
+    hal_iwdg_feed();
+}
 
-    while (1) {
-        now = hal_tick_ms();
+/* ── 10ms: ISO-TP diagnostic service (paced CFs) ───────────────────── */
+static void loop_diag(uint32_t dt_ms)
+{
+    (void)dt_ms;
+    bms_can_diag_poll();
+    bms_can_txq_kick();
+}
 
-        /* ── 10ms: Monitor (cell voltage + temp reads) ─────────── */
-        if ((now - last_monitor) >= BMS_MONITOR_PERIOD_MS) {
-            last_monitor = now;
-            bms_monitor_run(&g_pack);
-        }
+/* ── 50ms: Contactor control ───────────────────────────────────────── */
+static void loop_contactor(uint32_t dt_ms)
+{
+    bms_contactor_run(&g_contactor, &g_pack, dt_ms);
+}
 
-        /* ── 10ms: Protection (OV/UV/OT/OC/sub-zero checks) ───── */
-        if ((now - last_protection) >= BMS_PROTECTION_PERIOD_MS) {
-            last_protection = now;
-            bms_protection_run(&g_prot, &g_pack, BMS_PROTECTION_PERIOD_MS);
+/* ── 100ms: Safety I/O (gas/vent/fire/IMD) — 100ms in POWER_SAVE too ─ */
+static void loop_safety_io(uint32_t dt_ms)
+{
+    (void)dt_ms;    /* timers count calls; no AFE backstop for these */
+    bms_safety_io_run(&g_safety_io, &g_pack);
+}
 
-            /* P1-02: Feed IWDG from protection loop.
-             * If protection hangs, watchdog fires → safe reset. */
-            hal_iwdg_feed();
-        }
+/* ── 100ms: State machine (early on urgent EMS command) ────────────── */
+static void loop_state(uint32_t dt_ms)
+{
+    /* Process CAN RX before state machine */
+    (void)bms_can_rx_process(&g_ems_cmd);
 
-        /* ── 100ms: Safety I/O (gas/vent/fire/IMD) ─────────────── */
-        if ((now - last_safety_io) >= BMS_SAFETY_IO_PERIOD_MS) {
-            last_safety_io = now;
-            bms_safety_io_run(&g_safety_io, &g_pack);
-        }
+    bms_state_run(&g_pack, &g_contactor, &g_prot,
+                  &g_safety_io, &g_ems_cmd, dt_ms);
+    bms_can_rx_note_handled(&g_ems_cmd);
+    bms_history_sample(&g_pack);
+}
 
-        /* ── 50ms: Contactor control ───────────────────────────── */
-        if ((now - last_contactor) >= BMS_CONTACTOR_PERIOD_MS) {
-            last_contactor = now;
-            bms_contactor_run(&g_contactor, &g_pack, BMS_CONTACTOR_PERIOD_MS);
+/* ── 100ms: CAN TX ─────────────────────────────────────────────────── */
+static void loop_can(uint32_t dt_ms)
+{
+    bms_can_frame_t sio_frame, soc_frame, sop_d_frame, sop_c_frame, trace_frame;
+
+    (void)dt_ms;
+    bms_can_tx_periodic(&g_pack);
+
+    /* Also send safety I/O status, the SoC estimator state, state of
+     * power, and one task's trace figures */
+    bms_safety_io_encode_can(&g_safety_io, &sio_frame);
+    (void)bms_can_txq_send(&sio_frame, BMS_CAN_PRIO_CONTROL);
+    bms_sop_encode_can(&g_pack, &sop_d_frame, &sop_c_frame);
+    (void)bms_can_txq_send(&sop_d_frame, BMS_CAN_PRIO_CONTROL);
+    (void)bms_can_txq_send(&sop_c_frame, BMS_CAN_PRIO_CONTROL);
+    bms_soc_encode_can(&soc_frame);
+    (void)bms_can_txq_send(&soc_frame, BMS_CAN_PRIO_TELEMETRY);
+    bms_trace_next_can(&trace_frame);
+    (void)bms_can_txq_send(&trace_frame, BMS_CAN_PRIO_BULK);
+    bms_can_txq_kick();
+}
+
+/* ── 100ms: NVM write-behind (immediately on brownout) ─────────────── */
+static void loop_nvm(uint32_t dt_ms)
+{
+    bool brownout = bms_nvm_queue_brownout_pending();
+
+    (void)dt_ms;
+    bms_nvm_release();                          /* one erase per release */
+    (void)bms_nvm_queue_drain(&g_nvm);
+    if (!brownout) {                                         /* queue first */
+        uint16_t free_words = (uint16_t)(hal_stack_free_bytes() / 4U);
+        uint8_t t;
+
+        (void)bms_blackbox_flush();
+        (void)bms_history_flush();
+        (void)bms_soh_flush(&g_nvm);
+        (void)bms_can_auth_flush(&g_nvm);
+        for (t = 0U; t < (uint8_t)TRACE_TASK_COUNT; t++) {
+            bms_trace_stack((bms_trace_task_t)t, free_words);
         }
+    }
+}
 
-        /* ── 100ms: State machine ──────────────────────────────── */
-        if ((now - last_state) >= BMS_STATE_PERIOD_MS) {
-            last_state = now;
+/* ── 1000ms: Thermal dT/dt ─────────────────────────────────────────── */
+static void loop_thermal(uint32_t dt_ms)
+{
+    bms_thermal_run(&g_thermal, &g_pack, dt_ms);
+}
 
-            /* Process CAN RX before state machine */
-            (void)bms_can_rx_process(&g_ems_cmd);
+/* Rate-monotonic order; monitor ahead of protection so it sees this
+ * frame's readings. CATCHUP for tasks whose timers count calls. */
+#define PS  BMS_PS_SCAN_PERIOD_MS
+static const bms_sched_task_t k_loop[] = {
+    { loop_monitor,    NULL, BMS_MONITOR_PERIOD_MS,    0U,                     PS, BMS_SCHED_SKIP,    TRACE_MONITOR },
+    { loop_protection, NULL, BMS_PROTECTION_PERIOD_MS, 0U,                     PS, BMS_SCHED_CATCHUP, TRACE_PROTECTION },
+    { loop_diag,       NULL, BMS_DIAG_POLL_MS,         0U,                     PS, BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+    { loop_contactor,  NULL, BMS_CONTACTOR_PERIOD_MS,  BMS_CONTACTOR_PHASE_MS, PS, BMS_SCHED_CATCHUP, TRACE_CONTACTOR },
+    { loop_safety_io,  NULL, BMS_SAFETY_IO_PERIOD_MS,  BMS_SAFETY_IO_PHASE_MS, 0U, BMS_SCHED_CATCHUP, TRACE_SAFETY_IO },
+    { loop_state,      bms_can_rx_urgent_pending,
+                             BMS_STATE_PERIOD_MS,      BMS_STATE_PHASE_MS,     PS, BMS_SCHED_CATCHUP, TRACE_STATE },
+    { loop_can,        NULL, BMS_CAN_TX_PERIOD_MS,     BMS_CAN_TX_PHASE_MS,    PS, BMS_SCHED_SKIP,    TRACE_CAN },
+    { loop_nvm,        bms_nvm_queue_brownout_pending,
+                             BMS_NVM_DRAIN_PERIOD_MS,  BMS_NVM_DRAIN_PHASE_MS, PS, BMS_SCHED_SKIP,    TRACE_NVM },
+    { loop_thermal,    NULL, BMS_THERMAL_PERIOD_MS,    BMS_THERMAL_PHASE_MS,   0U, BMS_SCHED_SKIP,    TRACE_THERMAL },
+};
+#undef PS
+
+#define LOOP_TASKS  (sizeof(k_loop) / sizeof(k_loop[0]))
+
+/* ── Compile-time schedule check ───────────────────────────────────────
+ * Frames are one protection period. Every slower task is released on a
+ * frame boundary into a frame slot of the 100 ms major cycle that no
+ * other slow task uses, and runs after monitor + protection + diag. If
+ * each frame's budget fits the frame, protection's release is never
+ * late behind a slow task — thermal included. State and NVM can also be
+ * released early, into any frame: the worst such frame is checked too. */
+
+#define SCHED_FRAME_MS   BMS_PROTECTION_PERIOD_MS
+#define SCHED_FRAME_US   (SCHED_FRAME_MS * 1000U)
+#define SCHED_SLOTS      (BMS_CAN_TX_PERIOD_MS / SCHED_FRAME_MS)
+#define SCHED_SLOT(ph)   (1UL << (((ph) / SCHED_FRAME_MS) % SCHED_SLOTS))
+#define SCHED_BASE_US    (BMS_MONITOR_WCET_US + BMS_PROTECTION_WCET_US + BMS_DIAG_WCET_US)
+#define SCHED_PERMILLE(wcet_us, period_ms)  ((wcet_us) / (period_ms))
+
+_Static_assert(BMS_MONITOR_PERIOD_MS == SCHED_FRAME_MS && BMS_DIAG_POLL_MS == SCHED_FRAME_MS,
+               "Monitor, protection and diag make up the frame");
+_Static_assert(BMS_CONTACTOR_PERIOD_MS * 2U == BMS_CAN_TX_PERIOD_MS &&
+               BMS_SAFETY_IO_PERIOD_MS == BMS_CAN_TX_PERIOD_MS &&
+               BMS_STATE_PERIOD_MS == BMS_CAN_TX_PERIOD_MS &&
+               BMS_NVM_DRAIN_PERIOD_MS == BMS_CAN_TX_PERIOD_MS &&
+               (BMS_THERMAL_PERIOD_MS % BMS_CAN_TX_PERIOD_MS) == 0U,
+               "Slot map below assumes 50/100/1000 ms tasks");
+_Static_assert((BMS_CONTACTOR_PHASE_MS % SCHED_FRAME_MS) + (BMS_SAFETY_IO_PHASE_MS % SCHED_FRAME_MS) +
+               (BMS_STATE_PHASE_MS % SCHED_FRAME_MS) + (BMS_CAN_TX_PHASE_MS % SCHED_FRAME_MS) +
+               (BMS_NVM_DRAIN_PHASE_MS % SCHED_FRAME_MS) + (BMS_THERMAL_PHASE_MS % SCHED_FRAME_MS) == 0U,
+               "Phases are whole frames");
+_Static_assert(BMS_CONTACTOR_PHASE_MS < BMS_CONTACTOR_PERIOD_MS &&
+               BMS_THERMAL_PHASE_MS < BMS_CAN_TX_PERIOD_MS,
+               "Phase beyond the first period");
+_Static_assert((SCHED_SLOT(BMS_CONTACTOR_PHASE_MS) + SCHED_SLOT(BMS_CONTACTOR_PHASE_MS + BMS_CONTACTOR_PERIOD_MS) +
+                SCHED_SLOT(BMS_SAFETY_IO_PHASE_MS) + SCHED_SLOT(BMS_STATE_PHASE_MS) +
+                SCHED_SLOT(BMS_CAN_TX_PHASE_MS) + SCHED_SLOT(BMS_NVM_DRAIN_PHASE_MS) +
+                SCHED_SLOT(BMS_THERMAL_PHASE_MS)) ==
+               (SCHED_SLOT(BMS_CONTACTOR_PHASE_MS) | SCHED_SLOT(BMS_CONTACTOR_PHASE_MS + BMS_CONTACTOR_PERIOD_MS) |
+                SCHED_SLOT(BMS_SAFETY_IO_PHASE_MS) | SCHED_SLOT(BMS_STATE_PHASE_MS) |
+                SCHED_SLOT(BMS_CAN_TX_PHASE_MS) | SCHED_SLOT(BMS_NVM_DRAIN_PHASE_MS) |
+                SCHED_SLOT(BMS_THERMAL_PHASE_MS)),
+               "Two slow tasks share a frame");
+_Static_assert(SCHED_BASE_US + BMS_CONTACTOR_WCET_US <= SCHED_FRAME_US &&
+               SCHED_BASE_US + BMS_SAFETY_IO_WCET_US <= SCHED_FRAME_US &&
+               SCHED_BASE_US + BMS_CAN_TX_WCET_US    <= SCHED_FRAME_US &&
+               SCHED_BASE_US + BMS_THERMAL_WCET_US   <= SCHED_FRAME_US,
+               "Slow task does not fit its frame");
+_Static_assert(SCHED_BASE_US + BMS_STATE_WCET_US + BMS_NVM_DRAIN_WCET_US <= SCHED_FRAME_US &&
+               SCHED_BASE_US + BMS_STATE_WCET_US + BMS_THERMAL_WCET_US   <= SCHED_FRAME_US,
+               "Early state/NVM release overflows a frame");
+_Static_assert(SCHED_PERMILLE(BMS_MONITOR_WCET_US,    BMS_MONITOR_PERIOD_MS) +
+               SCHED_PERMILLE(BMS_PROTECTION_WCET_US, BMS_PROTECTION_PERIOD_MS) +
+               SCHED_PERMILLE(BMS_DIAG_WCET_US,       BMS_DIAG_POLL_MS) +
+               SCHED_PERMILLE(BMS_CONTACTOR_WCET_US,  BMS_CONTACTOR_PERIOD_MS) +
+               SCHED_PERMILLE(BMS_SAFETY_IO_WCET_US,  BMS_SAFETY_IO_PERIOD_MS) +
+               SCHED_PERMILLE(BMS_STATE_WCET_US,      BMS_STATE_PERIOD_MS) +
+               SCHED_PERMILLE(BMS_CAN_TX_WCET_US,     BMS_CAN_TX_PERIOD_MS) +
+               SCHED_PERMILLE(BMS_NVM_DRAIN_WCET_US,  BMS_NVM_DRAIN_PERIOD_MS) +
+               SCHED_PERMILLE(BMS_THERMAL_WCET_US,    BMS_THERMAL_PERIOD_MS) + 9U
+               <= BMS_SCHED_UTIL_MAX_PCT * 10U,
+               "CPU utilization above the rate-monotonic budget");
 
-            bms_state_run(&g_pack, &g_contactor, &g_prot,
-                          &g_safety_io, &g_ems_cmd, BMS_STATE_PERIOD_MS);
-        }
+int main(void)
+{
+    int32_t rc;
 
-        /* ── 100ms: CAN TX ─────────────────────────────────────── */
-        if ((now - last_can) >= BMS_CAN_TX_PERIOD_MS) {
-            last_can = now;
-            bms_can_tx_periodic(&g_pack);
-
-            /* Also send safety I/O status */
-            {
-                bms_can_frame_t sio_frame;
-                bms_safety_io_encode_can(&g_safety_io, &sio_frame);
-                (void)hal_can_transmit(&sio_frame);
-            }
-        }
+    rc = bms_init_all();
+    if (rc != 0) {
+        /* Init failed — enter safe state with contactors open (already done
+         * by contactor_init). Spin forever; IWDG will reset us. */
+        while (1) { /* IWDG will fire */ }
+    }
+
+    /* One shared MSP on bare metal: every slot reports it */
+    bms_trace_register(TRACE_PROTECTION, BMS_PROTECTION_PERIOD_MS, MAIN_STACK_WORDS);
+    bms_trace_register(TRACE_MONITOR,    BMS_MONITOR_PERIOD_MS,    MAIN_STACK_WORDS);
+    bms_trace_register(TRACE_CONTACTOR,  BMS_CONTACTOR_PERIOD_MS,  MAIN_STACK_WORDS);
+    bms_trace_register(TRACE_SAFETY_IO,  BMS_SAFETY_IO_PERIOD_MS,  MAIN_STACK_WORDS);
+    bms_trace_register(TRACE_STATE,      BMS_STATE_PERIOD_MS,      MAIN_STACK_WORDS);
+    bms_trace_register(TRACE_CAN,        BMS_CAN_TX_PERIOD_MS,     MAIN_STACK_WORDS);
+    bms_trace_register(TRACE_THERMAL,    BMS_THERMAL_PERIOD_MS,    MAIN_STACK_WORDS);
+    bms_trace_register(TRACE_NVM,        BMS_NVM_DRAIN_PERIOD_MS,  MAIN_STACK_WORDS);
+
+    if (bms_sched_init(k_loop, (uint8_t)LOOP_TASKS, hal_tick_ms()) != 0) {
+        while (1) { /* IWDG will fire */ }
+    }
+
+    while (1) {
+        uint32_t now = hal_tick_ms();
 
-        /* ── 1000ms: Thermal dT/dt ────────────────────────────── */
-        if ((now - last_thermal) >= BMS_THERMAL_PERIOD_MS) {
-            last_thermal = now;
-            bms_thermal_run(&g_thermal, &g_pack, BMS_THERMAL_PERIOD_MS);
+        if (!bms_sched_dispatch(now)) {
+            bms_power_idle(now, bms_sched_idle_ms(now));
         }
     }
 
@@ -0,0 +1,161 @@
+/**
+ * bench_can_msgs.c — table-generated CAN encoders vs hand-packed originals
+ *
+ * make bench  (builds at -O2, runs, exits 1 if any generated encoder is
+ *              slower than its reference beyond BENCH_NOISE)
+ *
+ * Both sides are called through volatile function pointers so neither can
+ * be inlined into the loop. Generated and reference runs alternate; each
+ * adjacent pair gives one gen/ref ratio, and the median ratio is gated, so
+ * clock ramp-up cancels within a pair and a preempted run is outvoted.
+ * Each pair's output is compared before timing. Every frame is gated on
+ * its own — a fast frame must not hide a slow one in the total.
+ */
+
+#include "bms_can.h"
+#include "bms_safety_io.h"
+#include "bms_config.h"
+#include "can_ref_encode.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ITERS  4000000UL
+#define BENCH_RUNS   21U    /* odd: the median is a real pair */
+#define BENCH_NOISE  0.03   /* median ratio of a reference timed against itself
+                             * stayed within ±2.6 % on a loaded host */
+
+typedef void (*enc_fn_t)(const bms_pack_data_t *pack, bms_can_frame_t *frame);
+
+/* Adapters for encoders with other signatures. The inner call also goes
+ * through a volatile pointer so the same-TU reference cannot be inlined
+ * into its adapter while the generated one pays a cross-TU call. */
+typedef void (*hb_fn_t)(uint32_t uptime_ms, bms_can_frame_t *frame);
+typedef void (*cell_fn_t)(const bms_pack_data_t *pack, uint8_t idx, bms_can_frame_t *frame);
+typedef void (*sio_fn_t)(const bms_safety_io_state_t *sio, bms_can_frame_t *frame);
+
+static hb_fn_t   volatile s_gen_hb    = bms_can_encode_heartbeat;
+static hb_fn_t   volatile s_ref_hb    = ref_encode_heartbeat;
+static cell_fn_t volatile s_gen_cells = bms_can_encode_cell_broadcast;
+static cell_fn_t volatile s_ref_cells = ref_encode_cell_broadcast;
+static sio_fn_t  volatile s_gen_sio   = bms_safety_io_encode_can;
+static sio_fn_t  volatile s_ref_sio   = ref_encode_safety_io;
+static bms_safety_io_state_t s_sio[2];   /* vent off / on, alternated per call */
+
+static void gen_heartbeat(const bms_pack_data_t *p, bms_can_frame_t *f) { s_gen_hb(p->uptime_ms, f); }
+static void ref_heartbeat(const bms_pack_data_t *p, bms_can_frame_t *f) { s_ref_hb(p->uptime_ms, f); }
+static void gen_cells(const bms_pack_data_t *p, bms_can_frame_t *f) { s_gen_cells(p, (uint8_t)(p->uptime_ms % 77U), f); }
+static void ref_cells(const bms_pack_data_t *p, bms_can_frame_t *f) { s_ref_cells(p, (uint8_t)(p->uptime_ms % 77U), f); }
+static void gen_safety(const bms_pack_data_t *p, bms_can_frame_t *f) { s_gen_sio(&s_sio[p->uptime_ms & 1U], f); }
+static void ref_safety(const bms_pack_data_t *p, bms_can_frame_t *f) { s_ref_sio(&s_sio[p->uptime_ms & 1U], f); }
+
+typedef struct {
+    const char *name;
+    enc_fn_t    gen;
+    enc_fn_t    ref;
+} bench_case_t;
+
+static const bench_case_t s_cases[] = {
+    { "status",    bms_can_encode_status,   ref_encode_status },
+    { "voltages",  bms_can_encode_voltages, ref_encode_voltages },
+    { "temps",     bms_can_encode_temps,    ref_encode_temps },
+    { "limits",    bms_can_encode_limits,   ref_encode_limits },
+    { "heartbeat", gen_heartbeat,           ref_heartbeat },
+    { "cells",     gen_cells,               ref_cells },
+    { "safety_io", gen_safety,              ref_safety },
+};
+
+static bms_pack_data_t s_pack;
+static volatile uint8_t s_sink;
+
+static double run_once(enc_fn_t fn)
+{
+    enc_fn_t volatile call = fn;
+    bms_can_frame_t frame;
+    clock_t t0 = clock();
+    unsigned long i;
+
+    for (i = 0UL; i < BENCH_ITERS; i++) {
+        s_pack.uptime_ms = (uint32_t)i;
+        s_pack.pack_current_ma = (int32_t)i - 1000000;
+        call(&s_pack, &frame);
+        s_sink ^= frame.data[7];
+    }
+    return (double)(clock() - t0) / (double)CLOCKS_PER_SEC;
+}
+
+/* Best times for display, median paired ratio for the gate */
+static double time_pair(enc_fn_t gen, enc_fn_t ref, double *tg, double *tr)
+{
+    double ratio[BENCH_RUNS];
+    unsigned r, i;
+
+    *tg = 1e9;
+    *tr = 1e9;
+    for (r = 0U; r < BENCH_RUNS; r++) {
+        double g = run_once(gen);
+        double f = run_once(ref);
+
+        if (g < *tg) { *tg = g; }
+        if (f < *tr) { *tr = f; }
+        /* insertion sort — BENCH_RUNS entries */
+        for (i = r; (i > 0U) && (ratio[i - 1U] > g / f); i--) {
+            ratio[i] = ratio[i - 1U];
+        }
+        ratio[i] = g / f;
+    }
+    return ratio[BENCH_RUNS / 2U];
+}
+
+int main(void)
+{
+    double tot_gen = 0.0, tot_ref = 0.0;
+    size_t c;
+    uint16_t i;
+    int rc = 0;
+
+    memset(&s_pack, 0, sizeof(s_pack));
+    memset(s_sio, 0, sizeof(s_sio));
+    s_sio[1].vent_running = true;
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { s_pack.cell_mv[i] = (uint16_t)(3600U + i); }
+    s_pack.pack_voltage_mv = 1150000U;
+    s_pack.max_cell_mv = 3907U;
+    s_pack.min_cell_mv = 3600U;
+    s_pack.avg_cell_mv = 3753U;
+    s_pack.max_temp_deci_c = 312;
+    s_pack.min_temp_deci_c = 204;
+    s_pack.soc_hundredths = 8700U;
+    s_pack.charge_limit_ma = 250000;
+    s_pack.discharge_limit_ma = 480000;
+    s_pack.mode = BMS_MODE_READY;
+
+    printf("%-10s %10s %10s %7s\n", "frame", "gen ns", "ref ns", "ratio");
+    for (c = 0U; c < sizeof(s_cases) / sizeof(s_cases[0]); c++) {
+        bms_can_frame_t a, b;
+        double tg, tr, ratio;
+
+        s_cases[c].gen(&s_pack, &a);
+        s_cases[c].ref(&s_pack, &b);
+        if (memcmp(&a, &b, sizeof(a)) != 0) {
+            printf("%-10s OUTPUT MISMATCH\n", s_cases[c].name);
+            rc = 1;
+        }
+
+        ratio = time_pair(s_cases[c].gen, s_cases[c].ref, &tg, &tr);
+        tot_gen += tg;
+        tot_ref += tr;
+        printf("%-10s %10.2f %10.2f %7.3f%s\n", s_cases[c].name,
+               tg * 1e9 / (double)BENCH_ITERS, tr * 1e9 / (double)BENCH_ITERS, ratio,
+               (ratio > 1.0 + BENCH_NOISE) ? "  SLOWER" : "");
+        if (ratio > 1.0 + BENCH_NOISE) { rc = 1; }
+    }
+
+    printf("%-10s %10.2f %10.2f %7.3f\n", "total",
+           tot_gen * 1e9 / (double)BENCH_ITERS, tot_ref * 1e9 / (double)BENCH_ITERS,
+           tot_gen / tot_ref);
+    if (rc != 0) {
+        printf("FAIL: generated encoder slower than hand-packed (noise margin %.0f%%)\n",
+               BENCH_NOISE * 100.0);
+    }
+    return rc;
+}
@@ -0,0 +1,174 @@
+/**
+ * bench_soc.c — SoC estimator error against the C simulator's ground truth
+ *
+ * make socbench  (builds at -O2, runs, exits 1 if the EKF's error after
+ * the first hour exceeds BENCH_MAX_ERR or its final error BENCH_END_ERR)
+ *
+ * 72 h of an hourly ferry cycle that never rests — |I| ≥ 8 A throughout,
+ * so the old 30 s OCV reset never fires — through the simulator's
+ * VirtualPack (OCV(SoC) + R(T, SoC), first-order thermal). The firmware
+ * sees what it would on the vessel: current with a gain and offset error,
+ * the pack average cell voltage rounded to mV with ±2 mV noise, and a
+ * boot SoC 10 % off (stale NVM). Three estimators, one measurement stream:
+ *
+ *   legacy  the previous bms_soc_update, 0.01 % truncation per 10 ms step
+ *   count   exact integer coulomb count of the measured current
+ *   ekf     bms_soc (predict each 10 ms run, correct each 220 ms sweep)
+ *
+ * The simulator has no RC branch, so the EKF's V_rc is model mismatch it
+ * has to tolerate, as is R varying with T and SoC around the fixed R0.
+ */
+
+#include "bms_soc.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define BENCH_HOURS      72U
+#define BENCH_BOOT_ERR   1000       /* NVM SoC off by +10 % */
+#define BENCH_I_GAIN     1.005      /* current sensor +0.5 % */
+#define BENCH_I_OFFS_A   0.25       /* ... and +250 mA */
+#define BENCH_MAX_ERR    300        /* 0.01 %, after the first hour */
+#define BENCH_END_ERR    150
+
+void   sim_init(double soc, double temp_c);
+void   sim_step(double dt_s, double current_a);
+double sim_soc(void);
+double sim_cell_v(void);
+double sim_temp(void);
+
+typedef struct {
+    const char *name;
+    double   sum_sq;
+    int32_t  max_err;
+    int32_t  end_err;
+    uint32_t n;
+} bench_stat_t;
+
+/* ── Hourly ferry cycle, A (+ = charge) ────────────────────────────── */
+static double ferry_current(uint32_t t_ms)
+{
+    uint32_t s = (t_ms / 1000U) % 3600U;
+
+    if (s < 480U)  { return 300.0; }                        /* shore charge */
+    if (s < 660U)  { return -250.0; }                       /* departure */
+    if (s < 2820U) {                                        /* transit */
+        return -44.0 + 10.0 * sin(2.0 * 3.14159265 * (double)s / 300.0);
+    }
+    if (s < 3140U) { return ((s / 20U) & 1U) ? 200.0 : -200.0; }  /* manoeuvre */
+    return -8.0;                                            /* hotel at berth */
+}
+
+/* ── The previous estimator, verbatim minus the OCV reset (never at rest) */
+static uint16_t s_legacy;
+
+static void legacy_update(int32_t current_ma, uint32_t dt_ms)
+{
+    int64_t delta = ((int64_t)current_ma * (int64_t)dt_ms);
+    if (current_ma > 0) {
+        delta = delta * BMS_COULOMBIC_EFFICIENCY_PPT / 1000;
+    }
+    delta = delta / ((int64_t)BMS_NOMINAL_CAPACITY_MAH * 360);
+
+    int32_t new_soc = (int32_t)s_legacy + (int32_t)delta;
+    if (new_soc < 0) { new_soc = 0; }
+    if (new_soc > 10000) { new_soc = 10000; }
+    s_legacy = (uint16_t)new_soc;
+}
+
+static void stat_add(bench_stat_t *st, int32_t est, int32_t truth)
+{
+    int32_t e = est - truth;
+
+    if (e < 0) { e = -e; }
+    st->sum_sq += (double)e * (double)e;
+    if (e > st->max_err) { st->max_err = e; }
+    st->end_err = e;
+    st->n++;
+}
+
+static uint32_t s_lcg = 12345U;
+static int32_t noise_mv(void)                               /* −2 … +2 */
+{
+    s_lcg = s_lcg * 1664525U + 1013904223U;
+    return (int32_t)((s_lcg >> 16) % 5U) - 2;
+}
+
+int main(void)
+{
+    bms_pack_data_t pack;
+    bench_stat_t st[3] = { { "legacy", 0.0, 0, 0, 0U },
+                           { "count",  0.0, 0, 0, 0U },
+                           { "ekf",    0.0, 0, 0, 0U } };
+    const uint32_t end = BENCH_HOURS * 3600000U;
+    int64_t count_mams = 0;
+    uint32_t t, step = 0U, in_2sigma = 0U, samples = 0U;
+    int32_t boot;
+    bms_soc_est_t est;
+    uint8_t i;
+    int fail = 0;
+
+    memset(&pack, 0, sizeof(pack));
+    sim_init(0.50, 25.0);
+    boot = (int32_t)lround(sim_soc() * 10000.0) + BENCH_BOOT_ERR;
+    bms_soc_init((uint16_t)boot);
+    s_legacy = (uint16_t)boot;
+    count_mams = (int64_t)boot * BMS_NOMINAL_CAPACITY_MAH * 360;
+
+    for (t = 0U; t < end; t += BMS_MONITOR_PERIOD_MS) {
+        double i_true = ferry_current(t);
+        int32_t i_meas = (int32_t)lround((i_true * BENCH_I_GAIN + BENCH_I_OFFS_A) * 1000.0);
+
+        sim_step((double)BMS_MONITOR_PERIOD_MS / 1000.0, i_true);
+
+        pack.pack_current_ma = i_meas;
+        legacy_update(i_meas, BMS_MONITOR_PERIOD_MS);
+        count_mams += (int64_t)i_meas * BMS_MONITOR_PERIOD_MS *
+                      ((i_meas > 0) ? BMS_COULOMBIC_EFFICIENCY_PPT : 1000) / 1000;
+        bms_soc_update(&pack, BMS_MONITOR_PERIOD_MS);
+        if (++step % BMS_NUM_MODULES == 0U) {
+            pack.avg_cell_mv = (uint16_t)(lround(sim_cell_v() * 1000.0) + noise_mv());
+            bms_soc_correct(&pack);
+        }
+
+        if (t >= 3600000U && (t % 1000U) == 0U) {
+            int32_t truth = (int32_t)lround(sim_soc() * 10000.0);
+            int32_t cnt = (int32_t)(count_mams / ((int64_t)BMS_NOMINAL_CAPACITY_MAH * 360));
+
+            stat_add(&st[0], s_legacy, truth);
+            stat_add(&st[1], cnt, truth);
+            stat_add(&st[2], pack.soc_hundredths, truth);
+            bms_soc_get_estimate(&est);
+            samples++;
+            if ((int32_t)st[2].end_err <= 2 * (int32_t)est.soc_std_hundredths) { in_2sigma++; }
+        }
+    }
+
+    bms_soc_get_estimate(&est);
+    printf("SoC estimators vs simulator truth — %u h ferry cycle, no rest, "
+           "boot +%d.%02d %%, I ×%.3f %+.2f A, end %.1f °C\n",
+           (unsigned)BENCH_HOURS, BENCH_BOOT_ERR / 100, BENCH_BOOT_ERR % 100,
+           BENCH_I_GAIN, BENCH_I_OFFS_A, sim_temp());
+    printf("estimator   rms %%    max %%    end %%   (after hour 1)\n");
+    for (i = 0U; i < 3U; i++) {
+        printf("%-9s %7.2f  %7.2f  %7.2f\n", st[i].name,
+               sqrt(st[i].sum_sq / (double)st[i].n) / 100.0,
+               (double)st[i].max_err / 100.0, (double)st[i].end_err / 100.0);
+    }
+    printf("ekf: sigma %.2f %%, |err| <= 2 sigma %.1f %% of the time, %lu corrections\n",
+           (double)est.soc_std_hundredths / 100.0,
+           100.0 * (double)in_2sigma / (double)samples, (unsigned long)est.updates);
+
+    if (st[2].max_err > BENCH_MAX_ERR || st[2].end_err > BENCH_END_ERR) {
+        printf("socbench: EKF error over the %d.%02d %% / %d.%02d %% gate\n",
+               BENCH_MAX_ERR / 100, BENCH_MAX_ERR % 100,
+               BENCH_END_ERR / 100, BENCH_END_ERR % 100);
+        fail = 1;
+    } else {
+        printf("socbench: EKF within %d.%02d %% max, %d.%02d %% at the end\n",
+               BENCH_MAX_ERR / 100, BENCH_MAX_ERR % 100,
+               BENCH_END_ERR / 100, BENCH_END_ERR % 100);
+    }
+    return fail;
+}
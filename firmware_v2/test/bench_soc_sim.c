@@ -0,0 +1,25 @@
+/**
+ * bench_soc_sim.c — ground-truth pack for bench_soc.c: the C simulator's
+ *                   VirtualPack (../c/corvus_bms.c)
+ *
+ * A translation unit of its own: corvus_bms.h and the firmware headers
+ * both define the BMS_* constants and mode enum.
+ */
+
+#include "corvus_bms.h"
+
+static corvus_pack_t s_sim;
+
+void sim_init(double soc, double temp_c)
+{
+    corvus_pack_init(&s_sim, 1, soc, temp_c);
+}
+
+void sim_step(double dt_s, double current_a)
+{
+    (void)corvus_pack_step(&s_sim, dt_s, current_a, true, 0.0);
+}
+
+double sim_soc(void)    { return s_sim.soc; }
+double sim_cell_v(void) { return s_sim.cell_voltage; }
+double sim_temp(void)   { return s_sim.temperature; }
@@ -0,0 +1,166 @@
+/**
+ * bench_sop.c — state-of-power prediction against the C simulator
+ *
+ * make sopbench  (builds at -O2, runs, exits 1 on a violation or if the
+ * prediction is too conservative)
+ *
+ * For each start temperature and SoC, bms_sop predicts the 2 / 10 / 30 s
+ * charge and discharge currents. Each one is then held for its horizon
+ * on a fresh simulator VirtualPack (../c/corvus_bms.c: OCV(SoC) + R(T,
+ * SoC) re-evaluated every step, I²R heating), and the true limit is found
+ * by bisection on the same pack. A prediction is
+ *
+ *   safe     the cell never crosses BMS_SOP_V_MIN/MAX_MV by more than
+ *            BENCH_TOL_MV (the firmware's OCV table is the simulator's
+ *            at 1 mV resolution)
+ *   useful   at least BENCH_MIN_RATIO of the true limit, where that limit
+ *            is below BENCH_I_MAX_A
+ *
+ * The instantaneous limits are lifted to BENCH_I_MAX_A so the voltage
+ * model, not the derating clamp, decides every case.
+ *
+ * The simulator has no RC branch, so the firmware's R1 makes the long
+ * horizons a little conservative by design.
+ */
+
+#include "bms_sop.h"
+#include "bms_soc.h"
+#include "bms_soh.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#define BENCH_TOL_MV     2.0
+#define BENCH_MIN_RATIO  0.80
+#define BENCH_DT_S       0.1
+#define BENCH_I_MAX_A    2000.0     /* above the hardware limits, so the
+                                     * voltage model is what binds */
+
+void   sim_init(double soc, double temp_c);
+void   sim_step(double dt_s, double current_a);
+double sim_soc(void);
+double sim_cell_v(void);
+double sim_temp(void);
+
+static const double k_temps[] = { -10.0, 0.0, 10.0, 25.0, 35.0 };
+static const int    k_socs[]  = { 5, 10, 20, 35, 50, 65, 80, 90, 95 };
+static const uint32_t k_h_ms[BMS_SOP_HORIZONS] = {
+    BMS_SOP_HORIZON_1_MS, BMS_SOP_HORIZON_2_MS, BMS_SOP_HORIZON_3_MS
+};
+
+/* Worst cell voltage (V) while holding i_a for h_s from (soc, temp) */
+static double hold(double soc, double temp, double i_a, double h_s)
+{
+    double worst, t;
+
+    sim_init(soc, temp);
+    sim_step(BENCH_DT_S, i_a);
+    worst = sim_cell_v();
+    for (t = BENCH_DT_S; t < h_s - 1e-9; t += BENCH_DT_S) {
+        double v;
+        sim_step(BENCH_DT_S, i_a);
+        v = sim_cell_v();
+        worst = (i_a > 0.0) ? fmax(worst, v) : fmin(worst, v);
+    }
+    return worst;
+}
+
+static bool within(double v, int dir)
+{
+    return (dir > 0) ? v <= BMS_SOP_V_MAX_MV / 1000.0 : v >= BMS_SOP_V_MIN_MV / 1000.0;
+}
+
+/* Largest |I| (A) the simulator holds inside the limit, by bisection */
+static double true_limit(double soc, double temp, double h_s, int dir, double i_max)
+{
+    double lo = 0.0, hi = i_max;
+    int n;
+
+    if (within(hold(soc, temp, dir * i_max, h_s), dir)) { return i_max; }
+    for (n = 0; n < 20; n++) {
+        double mid = 0.5 * (lo + hi);
+        if (within(hold(soc, temp, dir * mid, h_s), dir)) { lo = mid; } else { hi = mid; }
+    }
+    return lo;
+}
+
+int main(void)
+{
+    bms_pack_data_t pack;
+    double min_ratio = 1e9, sum_ratio = 0.0, worst_over_mv = 0.0;
+    uint32_t n_ratio = 0U, violations = 0U;
+    size_t ti, si;
+    int dir;
+    uint8_t k;
+    int fail = 0;
+
+    printf("sopbench — bms_sop against the simulator, limits %u / %u mV\n",
+           (unsigned)BMS_SOP_V_MIN_MV, (unsigned)BMS_SOP_V_MAX_MV);
+    printf("  T °C  SoC  side      2 s A (true)       10 s A (true)       30 s A (true)\n");
+
+    for (ti = 0U; ti < sizeof(k_temps) / sizeof(k_temps[0]); ti++) {
+        for (si = 0U; si < sizeof(k_socs) / sizeof(k_socs[0]); si++) {
+            int soc_pct = k_socs[si];
+
+            memset(&pack, 0, sizeof(pack));
+            pack.soc_hundredths = (uint16_t)(soc_pct * 100);
+            pack.max_temp_deci_c = (int16_t)lround(k_temps[ti] * 10.0);
+            pack.min_temp_deci_c = pack.max_temp_deci_c;
+            pack.charge_limit_ma = (int32_t)(BENCH_I_MAX_A * 1000.0);
+            pack.discharge_limit_ma = (int32_t)(BENCH_I_MAX_A * 1000.0);
+            bms_soc_init(pack.soc_hundredths);
+            bms_soh_init();
+            bms_sop_init(&pack);
+            bms_sop_compute(&pack);
+
+            for (dir = -1; dir <= 1; dir += 2) {
+                const int32_t *sop = (dir > 0) ? pack.sop_charge_ma : pack.sop_discharge_ma;
+                double i_max = BENCH_I_MAX_A;
+
+                printf("  %4.0f  %3d  %s", k_temps[ti], soc_pct, (dir > 0) ? "charge   " : "discharge");
+                for (k = 0U; k < BMS_SOP_HORIZONS; k++) {
+                    double h_s = k_h_ms[k] / 1000.0;
+                    double i_sop = sop[k] / 1000.0;
+                    double v = hold(soc_pct / 100.0, k_temps[ti], dir * i_sop, h_s);
+                    double over = (dir > 0) ? (v - BMS_SOP_V_MAX_MV / 1000.0)
+                                            : (BMS_SOP_V_MIN_MV / 1000.0 - v);
+                    double i_true = true_limit(soc_pct / 100.0, k_temps[ti], h_s, dir, i_max);
+
+                    over *= 1000.0;
+                    if (over > worst_over_mv) { worst_over_mv = over; }
+                    if (over > BENCH_TOL_MV) { violations++; }
+                    if (i_true < i_max && i_true > 1.0) {
+                        double r = i_sop / i_true;
+                        if (r < min_ratio) { min_ratio = r; }
+                        sum_ratio += r;
+                        n_ratio++;
+                    }
+                    printf("  %7.1f (%7.1f)", i_sop, i_true);
+                }
+                printf("\n");
+            }
+        }
+    }
+
+    printf("\nsafe:   %u violations > %.1f mV, worst excursion %.2f mV\n",
+           (unsigned)violations, BENCH_TOL_MV, worst_over_mv);
+    if (n_ratio > 0U) {
+        printf("useful: predicted / true limit, min %.3f, mean %.3f over %u voltage-bound cases\n",
+               min_ratio, sum_ratio / n_ratio, (unsigned)n_ratio);
+    }
+    if (violations > 0U) {
+        printf("sopbench: FAIL — prediction crosses the SEV limit\n");
+        fail = 1;
+    }
+    if (n_ratio > 0U && min_ratio < BENCH_MIN_RATIO) {
+        printf("sopbench: FAIL — prediction below %.0f %% of the true limit\n",
+               BENCH_MIN_RATIO * 100.0);
+        fail = 1;
+    }
+    if (!fail) {
+        printf("sopbench: safe, and within %.0f %% of the true limit\n",
+               (1.0 - BENCH_MIN_RATIO) * 100.0);
+    }
+    return fail;
+}
@@ -0,0 +1,120 @@
+/**
+ * can_ref_encode.h — the pre-table hand-packed CAN encoders, frozen
+ *
+ * Reference for test_can_msgs.c (byte-identical output) and
+ * bench_can_msgs.c (generated code must not be slower). Do not "fix"
+ * these — they define the deployed wire format.
+ */
+
+#ifndef CAN_REF_ENCODE_H
+#define CAN_REF_ENCODE_H
+
+#include "bms_types.h"
+#include <string.h>
+
+static void ref_pack_u16_be(uint8_t *buf, uint16_t val)
+{
+    buf[0] = (uint8_t)((val >> 8U) & 0xFFU);
+    buf[1] = (uint8_t)(val & 0xFFU);
+}
+
+static void ref_pack_i16_be(uint8_t *buf, int16_t val)
+{
+    ref_pack_u16_be(buf, (uint16_t)val);
+}
+
+static void ref_pack_u32_be(uint8_t *buf, uint32_t val)
+{
+    buf[0] = (uint8_t)((val >> 24U) & 0xFFU);
+    buf[1] = (uint8_t)((val >> 16U) & 0xFFU);
+    buf[2] = (uint8_t)((val >> 8U) & 0xFFU);
+    buf[3] = (uint8_t)(val & 0xFFU);
+}
+
+static void ref_encode_status(const bms_pack_data_t *pack, bms_can_frame_t *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_ARRAY_STATUS;
+    frame->dlc = 8U;
+    frame->data[0] = (uint8_t)pack->mode;
+    ref_pack_u16_be(&frame->data[1], (uint16_t)(pack->pack_voltage_mv / 100U));
+    ref_pack_i16_be(&frame->data[3], (int16_t)(pack->pack_current_ma / 100));
+    frame->data[5] = (uint8_t)(pack->soc_hundredths / 100U);
+    frame->data[6] = (uint8_t)((pack->max_temp_deci_c / 10) + 40);
+    {
+        uint32_t f;
+        memcpy(&f, &pack->faults, sizeof(f));
+        frame->data[7] = (uint8_t)(f & 0xFFU);
+    }
+}
+
+static void ref_encode_voltages(const bms_pack_data_t *pack, bms_can_frame_t *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_PACK_VOLTAGES;
+    frame->dlc = 8U;
+    ref_pack_u16_be(&frame->data[0], pack->max_cell_mv);
+    ref_pack_u16_be(&frame->data[2], pack->min_cell_mv);
+    ref_pack_u16_be(&frame->data[4], pack->avg_cell_mv);
+    ref_pack_u16_be(&frame->data[6], (uint16_t)(pack->max_cell_mv - pack->min_cell_mv));
+}
+
+static void ref_encode_temps(const bms_pack_data_t *pack, bms_can_frame_t *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_PACK_TEMPS;
+    frame->dlc = 8U;
+    ref_pack_i16_be(&frame->data[0], pack->max_temp_deci_c);
+    ref_pack_i16_be(&frame->data[2], pack->min_temp_deci_c);
+    ref_pack_i16_be(&frame->data[4], (int16_t)(pack->charge_limit_ma / 100));
+    ref_pack_i16_be(&frame->data[6], (int16_t)(pack->discharge_limit_ma / 100));
+}
+
+static void ref_encode_heartbeat(uint32_t uptime_ms, bms_can_frame_t *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_HEARTBEAT;
+    frame->dlc = 8U;
+    ref_pack_u32_be(&frame->data[0], uptime_ms);
+}
+
+static void ref_encode_limits(const bms_pack_data_t *pack, bms_can_frame_t *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_LIMITS;
+    frame->dlc = 8U;
+    ref_pack_u32_be(&frame->data[0], (uint32_t)pack->charge_limit_ma);
+    ref_pack_u32_be(&frame->data[4], (uint32_t)pack->discharge_limit_ma);
+}
+
+static void ref_encode_cell_broadcast(const bms_pack_data_t *pack,
+                                      uint8_t frame_idx, bms_can_frame_t *frame)
+{
+    uint16_t base;
+    uint8_t i;
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_CELL_BROADCAST + (uint32_t)frame_idx;
+    frame->dlc = 8U;
+    base = (uint16_t)frame_idx * 4U;
+    for (i = 0U; i < 4U; i++) {
+        uint16_t idx = base + i;
+        uint16_t mv = (idx < BMS_SE_PER_PACK) ? pack->cell_mv[idx] : 0U;
+        ref_pack_u16_be(&frame->data[i * 2U], mv);
+    }
+}
+
+static void ref_encode_safety_io(const bms_safety_io_state_t *sio,
+                                 bms_can_frame_t *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->id = CAN_ID_SAFETY_IO;
+    frame->dlc = 8U;
+    frame->data[0] = (uint8_t)sio->gas_level;
+    frame->data[1] = (uint8_t)sio->vent_level;
+    frame->data[2] = (uint8_t)sio->fire_level;
+    frame->data[3] = (uint8_t)sio->imd_level;
+    frame->data[4] = sio->fire_suppression_active ? 1U : 0U;
+    frame->data[5] = sio->vent_running ? 1U : 0U;
+}
+
+#endif /* CAN_REF_ENCODE_H */
@@ -0,0 +1,318 @@
+/**
+ * soak_rtos.c — all RTOS tasks concurrently on the host, for simulated hours
+ *
+ * make soak       (-O2, SOAK_HOURS simulated, default 24)
+ * make soak-tsan  (ThreadSanitizer, SOAK_TSAN_HOURS, default 2)
+ *
+ * rtos/bms_tasks.c unchanged on the pthreads port (rtos/posix), every task
+ * on its own thread with a virtual tick. A plant model in the tick hook
+ * mirrors contactor feedback and bus voltage and drifts the cells; an
+ * "ems" task above protection stands in for the CAN RX interrupt and
+ * plays a healthy EMS: 1 Hz heartbeat, connect at the top of every hour,
+ * limits every 10 s, disconnect at :50, a diagnostic snapshot read every
+ * minute. Exits 1 if the pack faults, a frame or fault event is dropped,
+ * a connect fails to close the contactors, or an hour goes unrecorded.
+ *
+ * Trace figures are host microseconds on the virtual clock: exec time
+ * tracks code cost, jitter and misses show scheduling regressions
+ * (a period change, a task woken off its grid, a body that blocks).
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "port_posix.h"
+
+#include "bms_hal.h"
+#include "bms_config.h"
+#include "bms_types.h"
+#include "bms_bq76952.h"
+#include "bms_monitor.h"
+#include "bms_protection.h"
+#include "bms_thermal.h"
+#include "bms_safety_io.h"
+#include "bms_contactor.h"
+#include "bms_state.h"
+#include "bms_can.h"
+#include "bms_can_rx.h"
+#include "bms_nvm.h"
+#include "bms_nvm_queue.h"
+#include "bms_blackbox.h"
+#include "bms_history.h"
+#include "bms_pack_share.h"
+#include "bms_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern void mock_set_tick(uint32_t tick_ms);
+extern void mock_set_gpio(bms_gpio_pin_t pin, bool state);
+extern void mock_set_adc(bms_adc_channel_t ch, uint16_t val);
+extern void mock_clear_can_tx(void);
+extern void mock_set_i2c_reg16(uint8_t module, uint8_t reg, uint16_t val);
+extern void mock_set_afe_summary(uint8_t module, uint16_t max_mv, uint16_t min_mv,
+                                 uint32_t stack_mv, int16_t max_dc, int16_t min_dc,
+                                 int16_t avg_dc);
+
+extern void bms_tasks_create(void);
+
+/* ── Shared state bms_tasks.c expects (main.c on target) ───────────── */
+
+bms_pack_data_t          g_pack;
+bms_protection_state_t   g_prot;
+bms_thermal_state_t      g_thermal;
+bms_safety_io_state_t    g_safety_io;
+bms_contactor_ctx_t      g_contactor;
+bms_nvm_ctx_t            g_nvm;
+bms_ems_command_t        g_ems_cmd;
+
+/* ── Scenario ──────────────────────────────────────────────────────── */
+
+#define SOAK_HOUR_MS            3600000U
+#define SOAK_CONNECT_AT_MS      1000U
+#define SOAK_DISCONNECT_AT_MS   3000000U        /* :50 */
+#define SOAK_LIMITS_EVERY_MS    10000U
+#define SOAK_DIAG_EVERY_MS      60000U
+#define SOAK_EMS_PERIOD_MS      100U
+
+/* Cells drift 3230..3244 mV over two hours: inside every warning band,
+ * and 308 of them stay under the 1000 V bus ADC full scale */
+#define SOAK_CELL_MV_LOW        3230U
+#define SOAK_CELL_MV_SPAN       14U
+#define SOAK_CELL_STEP_MS       (2U * SOAK_HOUR_MS / (2U * SOAK_CELL_MV_SPAN))
+#define SOAK_TEMP_DECI_C        250
+
+/* Plant, touched only from the tick hook (no task running) */
+static uint32_t s_end_ms;
+static uint32_t s_plant_last_ms;
+static uint16_t s_cell_mv;
+static bool     s_pos_closed;
+static uint32_t s_closures;
+
+static void plant_cells(uint16_t mv)
+{
+    uint8_t mod, c;
+    uint32_t pack_mv = (uint32_t)mv * BMS_SE_PER_PACK;
+
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+            mock_set_i2c_reg16(mod, BQ76952_CELL_REG(c), mv);
+        }
+        mock_set_i2c_reg16(mod, BQ76952_REG_STACK_VOLTAGE,
+                           (uint16_t)((uint32_t)mv * BMS_SE_PER_MODULE / 10U));
+        mock_set_i2c_reg16(mod, BQ76952_REG_TS1_TEMP, (uint16_t)(SOAK_TEMP_DECI_C + 2731));
+        mock_set_i2c_reg16(mod, BQ76952_REG_TS2_TEMP, (uint16_t)(SOAK_TEMP_DECI_C + 2731));
+        mock_set_i2c_reg16(mod, BQ76952_REG_TS3_TEMP, (uint16_t)(SOAK_TEMP_DECI_C + 2731));
+        mock_set_afe_summary(mod, mv, mv, (uint32_t)mv * BMS_SE_PER_MODULE,
+                             SOAK_TEMP_DECI_C, SOAK_TEMP_DECI_C, SOAK_TEMP_DECI_C);
+    }
+    /* The bus sits at our own voltage: other packs are not modelled */
+    mock_set_adc(ADC_BUS_VOLTAGE, (uint16_t)((pack_mv * BMS_ADC_BUS_VOLTAGE_SCALE_DEN +
+                 BMS_ADC_BUS_VOLTAGE_SCALE_NUM / 2U) / BMS_ADC_BUS_VOLTAGE_SCALE_NUM));
+    s_cell_mv = mv;
+}
+
+static void plant_init(void)
+{
+    mock_set_gpio(GPIO_VENT_STATUS, true);
+    mock_set_adc(ADC_IMD_RESISTANCE, 2000U);
+    plant_cells(SOAK_CELL_MV_LOW);
+}
+
+static void plant_step(uint32_t now)
+{
+    bool pos = hal_gpio_read(GPIO_CONTACTOR_POS);
+    uint32_t phase;
+
+    /* Contactor auxiliaries follow the coils */
+    mock_set_gpio(GPIO_CONTACTOR_FB_POS, pos);
+    mock_set_gpio(GPIO_CONTACTOR_FB_NEG, hal_gpio_read(GPIO_CONTACTOR_NEG));
+    if (pos && !s_pos_closed) { s_closures++; }
+    s_pos_closed = pos;
+
+    if ((now - s_plant_last_ms) >= SOAK_CELL_STEP_MS) {
+        s_plant_last_ms = now;
+        phase = (now / SOAK_CELL_STEP_MS) % (2U * SOAK_CELL_MV_SPAN);
+        if (phase > SOAK_CELL_MV_SPAN) { phase = 2U * SOAK_CELL_MV_SPAN - phase; }
+        if (s_cell_mv != SOAK_CELL_MV_LOW + phase) {
+            plant_cells((uint16_t)(SOAK_CELL_MV_LOW + phase));
+        }
+    }
+}
+
+void vApplicationTickHook(void)
+{
+    uint32_t now = xTaskGetTickCount();
+
+    mock_set_tick(now);
+    mock_clear_can_tx();            /* capture buffer is for unit tests */
+    plant_step(now);
+    if ((int32_t)(now - s_end_ms) >= 0) { vTaskEndScheduler(); }
+}
+
+/* ── EMS / CAN RX interrupt stand-in ───────────────────────────────── */
+
+static void ems_send(uint32_t id, const uint8_t *bytes, uint8_t n, uint8_t pad)
+{
+    bms_can_frame_t f;
+
+    f.id = id;
+    f.dlc = 8U;
+    memset(f.data, pad, sizeof(f.data));
+    memcpy(f.data, bytes, n);
+    bms_can_rx_isr(&f);
+}
+
+static void ems_command(bms_ems_cmd_type_t type)
+{
+    uint8_t d[5] = { 0U, 0U, 0U, 0U, 0U };
+
+    d[0] = (uint8_t)type;
+    if (type == EMS_CMD_SET_LIMITS) {
+        d[2] = 100U;                            /* 100 A charge */
+        d[4] = 150U;                            /* 150 A discharge */
+    }
+    ems_send(CAN_ID_EMS_COMMAND, d, sizeof(d), 0U);
+}
+
+static void task_ems(void *arg)
+{
+    static const uint8_t k_read_snapshot[4] = { 0x03U, 0x22U, 0xF1U, 0x01U };
+    static const uint8_t k_flow_control[3] = { 0x30U, 0U, 0U };
+    TickType_t last_wake = xTaskGetTickCount();
+
+    (void)arg;
+    for (;;) {
+        uint32_t now = xTaskGetTickCount();
+        uint32_t in_hour = now % SOAK_HOUR_MS;
+
+        if ((now % 1000U) == 0U) {
+            ems_send(CAN_ID_EMS_HEARTBEAT, k_flow_control, 0U, 0U);
+        }
+        if (in_hour == SOAK_CONNECT_AT_MS) {
+            ems_command(EMS_CMD_CONNECT_DCHG);
+        } else if (in_hour == SOAK_DISCONNECT_AT_MS) {
+            ems_command(EMS_CMD_DISCONNECT);
+        } else if (in_hour > SOAK_CONNECT_AT_MS && in_hour < SOAK_DISCONNECT_AT_MS &&
+                   (in_hour % SOAK_LIMITS_EVERY_MS) == 0U) {
+            ems_command(EMS_CMD_SET_LIMITS);
+        }
+        if ((now % SOAK_DIAG_EVERY_MS) == 20000U) {
+            ems_send(CAN_ID_DIAG_REQ, k_read_snapshot, sizeof(k_read_snapshot), 0xAAU);
+        } else if ((now % SOAK_DIAG_EVERY_MS) == 20000U + SOAK_EMS_PERIOD_MS) {
+            ems_send(CAN_ID_DIAG_REQ, k_flow_control, sizeof(k_flow_control), 0xAAU);
+        }
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SOAK_EMS_PERIOD_MS));
+    }
+}
+
+/* ── Init (mirrors bms_init_all() in main.c) ───────────────────────── */
+
+static int init_all(void)
+{
+    uint8_t mod;
+
+    hal_init();
+    bms_nvm_init(&g_nvm);
+    bms_nvm_queue_init();
+    bms_blackbox_init();
+    bms_history_init();
+    hal_brownout_init();
+    plant_init();
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        if (bq76952_init(mod) != 0) { return -1; }
+    }
+    bms_monitor_init(&g_pack);
+    bms_protection_init(&g_prot);
+    bms_thermal_init(&g_thermal);
+    bms_safety_io_init(&g_safety_io);
+    bms_contactor_init(&g_contactor);
+    bms_state_init(&g_pack);
+    bms_can_init();
+    bms_trace_init();
+    hal_iwdg_init(BMS_IWDG_TIMEOUT_MS);
+    mock_set_tick(0U);              /* AFE init delays ran the mock clock */
+    return 0;
+}
+
+/* ── Report ────────────────────────────────────────────────────────── */
+
+static int report(uint32_t hours)
+{
+    static bms_pack_data_t pack;
+    bms_pack_ctl_t ctl;
+    bms_pack_share_stats_t ps;
+    bms_can_rx_stats_t rx;
+    bms_nvm_queue_stats_t nq;
+    bms_history_stats_t hs;
+    double wall = posix_port_wall_s();
+    int rc = 0;
+
+    bms_pack_share_snapshot(&pack, &ctl);
+    bms_pack_share_get_stats(&ps);
+    bms_can_rx_get_stats(&rx);
+    bms_nvm_queue_get_stats(&nq);
+    bms_history_get_stats(&hs);
+
+    bms_trace_report();
+    printf("%-22s %u h simulated in %.1f s (%.0fx), %u tick advances\n", "soak",
+           (unsigned)hours, wall, (wall > 0.0) ? (double)hours * 3600.0 / wall : 0.0,
+           (unsigned)posix_port_advances());
+    printf("%-22s mode %s, faults 0x%08lX, latched %u, contactor closures %u\n", "pack",
+           bms_state_mode_name((bms_pack_mode_t)ctl.mode), (unsigned long)ctl.faults,
+           (unsigned)ctl.fault_latched, (unsigned)s_closures);
+    printf("%-22s %lu publishes, %lu reads, %lu retries (worst %lu)\n", "pack share",
+           (unsigned long)ps.publishes, (unsigned long)ps.reads,
+           (unsigned long)ps.retries, (unsigned long)ps.max_retries);
+    printf("%-22s %lu frames, %lu commands, %lu heartbeats, %lu overflow, "
+           "latency max %u ms\n", "can rx",
+           (unsigned long)rx.isr_frames, (unsigned long)rx.commands,
+           (unsigned long)rx.heartbeats, (unsigned long)rx.overflow,
+           (unsigned)rx.cmd_latency_max_ms);
+    printf("%-22s %lu pushed, %lu dropped\n", "nvm queue",
+           (unsigned long)nq.pushed, (unsigned long)nq.dropped);
+    printf("%-22s %lu hours, %lu dropped, %lu verify failures\n", "history",
+           (unsigned long)hs.hours_closed, (unsigned long)hs.dropped,
+           (unsigned long)hs.verify_fail);
+
+    if (ctl.fault_latched || ctl.faults != 0U) {
+        printf("FAIL: healthy pack faulted\n");
+        rc = 1;
+    }
+    if (s_closures != hours) {
+        printf("FAIL: %u connects closed the contactors %u times\n",
+               (unsigned)hours, (unsigned)s_closures);
+        rc = 1;
+    }
+    if (rx.overflow != 0U || rx.decode_reject != 0U || nq.dropped != 0U) {
+        printf("FAIL: frames or fault events dropped\n");
+        rc = 1;
+    }
+    if (hs.hours_closed != hours || hs.dropped != 0U || hs.verify_fail != 0U) {
+        printf("FAIL: operating history lost hours\n");
+        rc = 1;
+    }
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t hours = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 24U;
+
+    if (hours == 0U || hours > 24U * 31U) {
+        fprintf(stderr, "usage: %s [hours 1..744]\n", argv[0]);
+        return 2;
+    }
+    if (init_all() != 0) {
+        fprintf(stderr, "soak: init failed\n");
+        return 1;
+    }
+
+    bms_tasks_create();
+    bms_trace_set_clock(posix_port_clock_ns);
+    (void)xTaskCreate(task_ems, "ems", 256U, NULL, 6U, NULL);
+
+    /* A few ms past the last hour so its record is closed and flushed */
+    s_end_ms = hours * SOAK_HOUR_MS + 2U * BMS_NVM_DRAIN_PERIOD_MS;
+    vTaskStartScheduler();
+    return report(hours);
+}
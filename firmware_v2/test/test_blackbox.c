@@ -0,0 +1,281 @@
+/**
+ * test_blackbox.c — black-box recorder: delta coding, 30 s window, capture
+ */
+
+#include "bms_blackbox.h"
+#include "bms_nvm.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern void mock_advance_tick(uint32_t ms);
+extern uint32_t mock_get_nvm_violations(void);
+extern void mock_nvm_power_cut_after(uint32_t n);
+
+#define POWER_ON      0xFFFFFFFFU
+#define POST_SAMPLES  (BMS_BBOX_POST_MS / BMS_BBOX_PERIOD_MS)
+#define MAX_SAMPLES   (BMS_BBOX_BLOCKS * (BMS_BBOX_BLOCK_SIZE - BMS_BBOX_DELTA_OFFSET))
+
+static bms_pack_data_t       s_pack;
+static bms_blackbox_sample_t s_out[MAX_SAMPLES];
+static uint8_t               s_page[BMS_BBOX_BLOCK_SIZE];
+
+static void setup(void)
+{
+    mock_reset_all();
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.min_cell_mv = 3300U;
+    s_pack.max_cell_mv = 3320U;
+    s_pack.max_temp_deci_c = 250;
+    s_pack.mode = BMS_MODE_CONNECTED;
+    bms_blackbox_init();
+}
+
+/* One NVM task release: re-arm the erase budget, stream a slice */
+static bool nvm_release_flush(void)
+{
+    bms_nvm_release();
+    return bms_blackbox_flush();
+}
+
+static void tick(void)
+{
+    mock_advance_tick(BMS_BBOX_PERIOD_MS);
+    bms_blackbox_record(&s_pack);
+}
+
+static void latch(void)
+{
+    s_pack.faults.cell_ov = 1U;
+    s_pack.fault_latched = true;
+    s_pack.mode = BMS_MODE_FAULT;
+}
+
+/* Run the post window and stream the capture; returns flush calls */
+static uint16_t finish_capture(void)
+{
+    uint16_t i, calls = 0U;
+
+    for (i = 0U; i < POST_SAMPLES; i++) { tick(); }
+    while (nvm_release_flush()) { calls++; }
+    return (uint16_t)(calls + 1U);
+}
+
+/* Decode the stored capture, oldest first; returns samples */
+static uint32_t read_capture(void)
+{
+    bms_blackbox_info_t info;
+    uint32_t total = 0U;
+    uint16_t b;
+
+    if (!bms_blackbox_get_info(&info)) { return 0U; }
+    for (b = 0U; b < info.blocks; b++) {
+        uint16_t n;
+        if (!bms_blackbox_read_block(b, s_page)) { return 0U; }
+        n = bms_blackbox_decode_block(s_page, &s_out[total],
+                                      (uint16_t)(MAX_SAMPLES - total));
+        if (n == 0U) { return 0U; }
+        total += n;
+    }
+    return total;
+}
+
+static void test_roundtrip_exact(void)
+{
+    static bms_blackbox_sample_t exp[601U + POST_SAMPLES];
+    bms_blackbox_info_t info;
+    uint32_t n, i, mismatches = 0U;
+
+    fprintf(stderr, "  test_roundtrip_exact\n");
+    setup();
+
+    /* Small moves, big steps (i8 → absolute), a mode change, a fault */
+    for (i = 0U; i < 601U + POST_SAMPLES; i++) {
+        if (i == 600U) { latch(); }
+        s_pack.pack_current_ma = (i % 97U == 0U) ? -350000 : (int32_t)(120000 + (int32_t)(i % 7U) * 180);
+        s_pack.min_cell_mv = (uint16_t)(3300U + (i / 10U) % 5U);
+        s_pack.max_cell_mv = (i == 300U) ? 4300U : (uint16_t)(3320U + i % 3U);
+        s_pack.max_temp_deci_c = (int16_t)(250 + (int16_t)(i / 50U) - ((i == 450U) ? 400 : 0));
+        if (i == 200U) { s_pack.mode = BMS_MODE_READY; }
+        tick();
+        exp[i].t_ms = (i + 1U) * BMS_BBOX_PERIOD_MS;
+        exp[i].current_da = (int16_t)(s_pack.pack_current_ma / 100);
+        exp[i].min_cell_mv = s_pack.min_cell_mv;
+        exp[i].max_cell_mv = s_pack.max_cell_mv;
+        exp[i].max_temp_deci_c = s_pack.max_temp_deci_c;
+        exp[i].mode = (uint8_t)s_pack.mode;
+        exp[i].faults = (i >= 600U) ? 1U : 0U;
+    }
+    TEST_ASSERT_EQ(bms_blackbox_state(), BBOX_FROZEN);
+    while (nvm_release_flush()) { }
+    TEST_ASSERT_EQ(bms_blackbox_state(), BBOX_STORED);
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+
+    n = read_capture();
+    TEST_ASSERT_EQ(n, 601U + POST_SAMPLES);
+    for (i = 0U; i < n && i < 601U + POST_SAMPLES; i++) {
+        const bms_blackbox_sample_t *a = &s_out[i], *e = &exp[i];
+        if (a->t_ms != e->t_ms || a->current_da != e->current_da ||
+            a->min_cell_mv != e->min_cell_mv || a->max_cell_mv != e->max_cell_mv ||
+            a->max_temp_deci_c != e->max_temp_deci_c || a->mode != e->mode ||
+            a->faults != e->faults) {
+            mismatches++;
+        }
+    }
+    TEST_ASSERT_EQ(mismatches, 0U);
+
+    TEST_ASSERT(bms_blackbox_get_info(&info));
+    TEST_ASSERT_EQ(info.trigger_ms, 601U * BMS_BBOX_PERIOD_MS);
+    TEST_ASSERT_EQ(info.faults, 1U);
+    TEST_ASSERT_EQ(info.first_ms, BMS_BBOX_PERIOD_MS);
+    TEST_ASSERT_EQ(info.last_ms, (601U + POST_SAMPLES) * BMS_BBOX_PERIOD_MS);
+    TEST_ASSERT_EQ(info.capture, 1U);
+    /* The fault opened a fresh block: its keyframe is the trigger */
+    TEST_ASSERT_EQ(info.trigger_sample, 0U);
+    TEST_ASSERT(bms_blackbox_read_block(info.trigger_block, s_page));
+    TEST_ASSERT_EQ(bms_blackbox_decode_block(s_page, s_out, 1U), 1U);
+    TEST_ASSERT_EQ(s_out[0].t_ms, info.trigger_ms);
+    TEST_ASSERT_EQ(s_out[0].mode, (uint8_t)BMS_MODE_FAULT);
+
+    /* A count that runs past the coded bytes is rejected */
+    s_page[4] = 0x7FU;
+    TEST_ASSERT_EQ(bms_blackbox_decode_block(s_page, s_out, MAX_SAMPLES), 0U);
+}
+
+static void test_30s_history_worst_motion(void)
+{
+    bms_blackbox_info_t info;
+    bms_blackbox_stats_t st;
+    uint32_t i;
+
+    fprintf(stderr, "  test_30s_history_worst_motion\n");
+    setup();
+
+    /* Every field steps past the i8 delta range every sample, so every
+     * sample is absolute-coded (fault-current transients) — the sizing case */
+    for (i = 0U; i < 6000U; i++) {
+        int32_t sgn = (i & 1U) ? 1 : -1;
+        s_pack.pack_current_ma += sgn * 20000;
+        s_pack.min_cell_mv = (uint16_t)(s_pack.min_cell_mv + sgn * 200);
+        s_pack.max_cell_mv = (uint16_t)(s_pack.max_cell_mv - sgn * 400);
+        s_pack.max_temp_deci_c = (int16_t)(s_pack.max_temp_deci_c + sgn * 200);
+        tick();
+    }
+    TEST_ASSERT(bms_blackbox_span_ms() >= BMS_BBOX_PRE_MS + BMS_BBOX_POST_MS);
+
+    latch();
+    tick();
+    TEST_ASSERT_EQ(bms_blackbox_state(), BBOX_POST_TRIGGER);
+    (void)finish_capture();
+
+    TEST_ASSERT(bms_blackbox_get_info(&info));
+    TEST_ASSERT(info.trigger_ms - info.first_ms >= BMS_BBOX_PRE_MS);
+    TEST_ASSERT(info.last_ms - info.trigger_ms >= BMS_BBOX_POST_MS);
+    TEST_ASSERT_EQ(info.blocks, BMS_BBOX_BLOCKS);
+    TEST_ASSERT_EQ(read_capture(), (info.last_ms - info.first_ms) / BMS_BBOX_PERIOD_MS + 1U);
+
+    bms_blackbox_get_stats(&st);
+    TEST_ASSERT_EQ(st.stored, 1U);
+    TEST_ASSERT_EQ(st.store_fail, 0U);
+}
+
+static void test_rearm_after_store(void)
+{
+    bms_blackbox_info_t info;
+    bms_blackbox_stats_t st;
+    uint16_t i, flushes;
+
+    fprintf(stderr, "  test_rearm_after_store\n");
+    setup();
+    TEST_ASSERT(!bms_blackbox_get_info(&info));         /* blank flash */
+    TEST_ASSERT(!bms_blackbox_flush());                 /* nothing frozen */
+
+    for (i = 0U; i < 200U; i++) { tick(); }
+    latch();
+    tick();
+    for (i = 0U; i < POST_SAMPLES; i++) { tick(); }
+    TEST_ASSERT_EQ(bms_blackbox_state(), BBOX_FROZEN);
+
+    /* Frozen: samples are skipped, the ring is not touched */
+    tick();
+    tick();
+    bms_blackbox_get_stats(&st);
+    TEST_ASSERT_EQ(st.frozen_skips, 2U);
+
+    /* Streams a few pages per NVM slot */
+    flushes = 1U;
+    while (nvm_release_flush()) { flushes++; }
+    TEST_ASSERT(bms_blackbox_get_info(&info));
+    TEST_ASSERT_EQ(flushes, (uint16_t)((info.blocks + BMS_BBOX_PAGES_PER_FLUSH - 1U) /
+                                       BMS_BBOX_PAGES_PER_FLUSH));
+
+    /* Still latched: recording resumes but does not re-trigger */
+    for (i = 0U; i < 100U; i++) { tick(); }
+    TEST_ASSERT_EQ(bms_blackbox_state(), BBOX_RECORDING);
+    TEST_ASSERT(bms_blackbox_span_ms() < 1000U);        /* fresh ring */
+
+    /* Reset, then a second trip overwrites the stored capture */
+    s_pack.fault_latched = false;
+    s_pack.faults.cell_ov = 0U;
+    s_pack.mode = BMS_MODE_READY;
+    for (i = 0U; i < 100U; i++) { tick(); }
+    s_pack.faults.cell_uv = 1U;
+    s_pack.fault_latched = true;
+    tick();
+    (void)finish_capture();
+    TEST_ASSERT(bms_blackbox_get_info(&info));
+    TEST_ASSERT_EQ(info.capture, 2U);
+    TEST_ASSERT_EQ(info.faults, 2U);                    /* cell_uv */
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+}
+
+static void test_torn_capture_invisible(void)
+{
+    bms_blackbox_info_t info;
+    bms_blackbox_stats_t st;
+    uint16_t i;
+
+    fprintf(stderr, "  test_torn_capture_invisible\n");
+    setup();
+    for (i = 0U; i < 300U; i++) { tick(); }
+    latch();
+    tick();
+    for (i = 0U; i < POST_SAMPLES; i++) { tick(); }
+
+    /* Power dies three pages into the stream */
+    mock_nvm_power_cut_after(3U * BMS_BBOX_BLOCK_SIZE);
+    while (nvm_release_flush()) { }
+    bms_blackbox_get_stats(&st);
+    TEST_ASSERT_EQ(st.store_fail, 1U);
+    TEST_ASSERT_EQ(st.stored, 0U);
+
+    /* Reboot: no header, so no half capture is ever served */
+    mock_nvm_power_cut_after(POWER_ON);
+    TEST_ASSERT(!bms_blackbox_get_info(&info));
+    TEST_ASSERT(!bms_blackbox_read_block(0U, s_page));
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+}
+
+void test_blackbox_suite(void)
+{
+    test_roundtrip_exact();
+    test_30s_history_worst_motion();
+    test_rearm_after_store();
+    test_torn_capture_invisible();
+}
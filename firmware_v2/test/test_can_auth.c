@@ -0,0 +1,416 @@
+/**
+ * test_can_auth.c — AES-128 / CMAC vectors and CAN frame authentication
+ */
+
+#include "bms_cmac.h"
+#include "bms_can_auth.h"
+#include "bms_can.h"
+#include "bms_nvm.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern void mock_advance_tick(uint32_t ms);
+
+/* RFC 4493 §4 key and message */
+static const uint8_t k_rfc_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint8_t k_rfc_msg[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+static void test_aes_fips197(void)
+{
+    static const uint8_t key[16] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+    };
+    static const uint8_t pt[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+        0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+    };
+    static const uint8_t ct[16] = {
+        0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+        0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+    };
+    bms_aes128_ctx_t aes;
+    uint8_t out[16];
+
+    fprintf(stderr, "  test_aes_fips197\n");
+    bms_aes128_init(&aes, key);
+    bms_aes128_encrypt(&aes, pt, out);
+    TEST_ASSERT(memcmp(out, ct, 16) == 0);
+
+    /* Last round key of the FIPS-197 Appendix A.1 expansion (2b7e.. key) */
+    bms_aes128_init(&aes, k_rfc_key);
+    TEST_ASSERT_EQ(aes.rk[40], 0xa8f914d0U);   /* d0 14 f9 a8 */
+    TEST_ASSERT_EQ(aes.rk[43], 0xa60c63b6U);   /* b6 63 0c a6 */
+}
+
+static void test_cmac_rfc4493(void)
+{
+    static const uint8_t k1[16] = {
+        0xfb, 0xee, 0xd6, 0x18, 0x35, 0x71, 0x33, 0x66,
+        0x7c, 0x85, 0xe0, 0x8f, 0x72, 0x36, 0xa8, 0xde
+    };
+    static const uint8_t k2[16] = {
+        0xf7, 0xdd, 0xac, 0x30, 0x6a, 0xe2, 0x66, 0xcc,
+        0xf9, 0x0b, 0xc1, 0x1e, 0xe4, 0x6d, 0x51, 0x3b
+    };
+    static const struct { uint16_t len; uint8_t mac[16]; } k_vec[4] = {
+        {  0U, { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28,
+                 0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 } },
+        { 16U, { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44,
+                 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+        { 40U, { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30,
+                 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+        { 64U, { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92,
+                 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe } },
+    };
+    bms_cmac_ctx_t ctx;
+    uint8_t mac[16];
+    uint8_t i;
+
+    fprintf(stderr, "  test_cmac_rfc4493\n");
+    bms_cmac_init(&ctx, k_rfc_key);
+    TEST_ASSERT(memcmp(ctx.k1, k1, 16) == 0);
+    TEST_ASSERT(memcmp(ctx.k2, k2, 16) == 0);
+
+    for (i = 0U; i < 4U; i++) {
+        bms_cmac_compute(&ctx, k_rfc_msg, k_vec[i].len, mac);
+        TEST_ASSERT(memcmp(mac, k_vec[i].mac, 16) == 0);
+        TEST_ASSERT(bms_cmac_verify(&ctx, k_rfc_msg, k_vec[i].len, k_vec[i].mac, 16U));
+    }
+
+    /* Truncated compare; one flipped bit anywhere in the tag fails */
+    TEST_ASSERT(bms_cmac_verify(&ctx, k_rfc_msg, 16U, k_vec[1].mac, 2U));
+    memcpy(mac, k_vec[1].mac, 16);
+    mac[1] ^= 0x01U;
+    TEST_ASSERT(!bms_cmac_verify(&ctx, k_rfc_msg, 16U, mac, 2U));
+    TEST_ASSERT(!bms_cmac_verify(&ctx, k_rfc_msg, 16U, mac, 0U));
+
+    bms_cmac_wipe(&ctx);
+    TEST_ASSERT_EQ(ctx.aes.rk[0], 0U);
+}
+
+static void ems_cmd(bms_can_frame_t *f, uint8_t cmd, uint8_t amps)
+{
+    memset(f, 0, sizeof(*f));
+    f->id = CAN_ID_EMS_COMMAND;
+    f->dlc = 8U;
+    f->data[0] = cmd;
+    f->data[2] = amps;
+    f->data[4] = amps;
+}
+
+static void ems_heartbeat(bms_can_frame_t *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->id = CAN_ID_EMS_HEARTBEAT;
+    f->dlc = 8U;
+}
+
+static void test_classic_sign_verify(void)
+{
+    bms_can_frame_t f, g;
+    bms_ems_command_t cmd;
+    bms_can_auth_stats_t st;
+    uint8_t byte, bit;
+    uint16_t bad = 0U;
+
+    fprintf(stderr, "  test_classic_sign_verify\n");
+    mock_reset_all();
+    bms_can_auth_init(k_rfc_key);
+
+    ems_cmd(&f, (uint8_t)EMS_CMD_CONNECT_CHG, 100U);
+    bms_can_auth_sign(&f);
+    TEST_ASSERT_EQ(f.data[5], 1U);                 /* FV low byte */
+    TEST_ASSERT_EQ(bms_can_auth_get_tx_seq(), 1U);
+    g = f;
+    TEST_ASSERT(bms_can_auth_verify(&f));
+    TEST_ASSERT_EQ(bms_can_auth_get_rx_seq(), 1U);
+
+    /* Payload still decodes (auth bytes are not "reserved" any more) */
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), BMS_CAN_AUTH_ENABLED ? 0 : -1);
+
+    /* Replay of the same frame */
+    TEST_ASSERT(!bms_can_auth_verify(&g));
+
+    /* Every single-bit flip in payload, FV or MAC is rejected (paced at
+     * the fail-bucket refill so each one reaches the MAC check) */
+    ems_cmd(&f, (uint8_t)EMS_CMD_CONNECT_DCHG, 50U);
+    bms_can_auth_sign(&f);
+    for (byte = 0U; byte < 8U; byte++) {
+        for (bit = 0U; bit < 8U; bit++) {
+            g = f;
+            g.data[byte] ^= (uint8_t)(1U << bit);
+            mock_advance_tick(BMS_CAN_AUTH_FAIL_REFILL_MS);
+            if (bms_can_auth_verify(&g)) { bad++; }
+        }
+    }
+    TEST_ASSERT_EQ(bad, 0U);
+    g = f;
+    g.id = CAN_ID_EMS_COMMAND + 1U;                 /* ID is authenticated */
+    TEST_ASSERT(!bms_can_auth_verify(&g));
+    TEST_ASSERT(bms_can_auth_verify(&f));           /* original still good */
+
+    /* Short frame has no room for the trailer */
+    f.dlc = 5U;
+    TEST_ASSERT(!bms_can_auth_verify(&f));
+
+    bms_can_auth_get_stats(&st);
+    TEST_ASSERT_EQ(st.verified, 2U);
+    TEST_ASSERT(st.bad_mac >= 65U);
+    TEST_ASSERT_EQ(st.bad_format, 1U);
+    TEST_ASSERT_EQ(st.lockouts, 0U);
+}
+
+/* ── Forged commands: a burst of bad MACs holds every command off ──── */
+static void test_forgery_holdoff(void)
+{
+    static bms_nvm_ctx_t ctx;
+    bms_can_frame_t f, good, hb;
+    bms_can_auth_stats_t st;
+    bms_nvm_fault_event_t ev;
+    uint8_t i;
+
+    fprintf(stderr, "  test_forgery_holdoff\n");
+    mock_reset_all();
+    bms_nvm_init(&ctx);
+    bms_can_auth_init(k_rfc_key);
+    TEST_ASSERT(!bms_can_auth_flush(&ctx));
+
+    ems_cmd(&good, (uint8_t)EMS_CMD_CONNECT_CHG, 10U);
+    bms_can_auth_sign(&good);
+    for (i = 0U; i < BMS_CAN_AUTH_FAIL_BURST; i++) {
+        f = good;
+        f.data[6] ^= (uint8_t)(i + 1U);             /* guessed MAC */
+        TEST_ASSERT(!bms_can_auth_verify(&f));
+    }
+    bms_can_auth_get_stats(&st);
+    TEST_ASSERT_EQ(st.bad_mac, BMS_CAN_AUTH_FAIL_BURST);
+    TEST_ASSERT_EQ(st.lockouts, 1U);
+    TEST_ASSERT(st.lockout_latched);
+
+    /* Held off: even the right MAC is not checked; heartbeats still are */
+    TEST_ASSERT(!bms_can_auth_verify(&good));
+    ems_heartbeat(&hb);
+    bms_can_auth_sign(&hb);
+    TEST_ASSERT(bms_can_auth_verify(&hb));
+    bms_can_auth_get_stats(&st);
+    TEST_ASSERT_EQ(st.held_off, 1U);
+    TEST_ASSERT_EQ(st.bad_mac, BMS_CAN_AUTH_FAIL_BURST);
+
+    mock_advance_tick(BMS_CAN_AUTH_HOLDOFF_MS);
+    ems_cmd(&good, (uint8_t)EMS_CMD_CONNECT_CHG, 10U);
+    bms_can_auth_sign(&good);
+    TEST_ASSERT(bms_can_auth_verify(&good));
+
+    /* The bucket refilled during the hold-off: one slip is tolerated */
+    f = good;
+    f.data[7] ^= 0x01U;
+    TEST_ASSERT(!bms_can_auth_verify(&f));
+    ems_cmd(&good, (uint8_t)EMS_CMD_DISCONNECT, 0U);
+    bms_can_auth_sign(&good);
+    TEST_ASSERT(bms_can_auth_verify(&good));
+
+    /* Latched in NVM by the NVM task */
+    TEST_ASSERT(bms_can_auth_flush(&ctx));
+    TEST_ASSERT(bms_nvm_get_fault(&ctx, 0U, &ev));
+    TEST_ASSERT_EQ(ev.fault_type, (uint8_t)NVM_FAULT_CAN_AUTH);
+    TEST_ASSERT_EQ(ev.value, 1U);
+    TEST_ASSERT(!bms_can_auth_flush(&ctx));
+    bms_can_auth_get_stats(&st);
+    TEST_ASSERT(st.lockout_latched);
+    mock_reset_all();
+}
+
+/* ── The receive FV survives a reset: captured frames stay stale ───── */
+static void test_fv_persist_restore(void)
+{
+    static bms_nvm_ctx_t ctx, boot;
+    bms_can_frame_t hb, cmd, cap_hb, cap_cmd, next_hb, next_cmd;
+
+    fprintf(stderr, "  test_fv_persist_restore\n");
+    mock_reset_all();
+    bms_nvm_init(&ctx);
+    bms_can_auth_init(k_rfc_key);
+
+    ems_heartbeat(&hb);
+    bms_can_auth_sign(&hb);
+    cap_hb = hb;
+    TEST_ASSERT(bms_can_auth_verify(&hb));
+    TEST_ASSERT(!bms_can_auth_flush(&ctx));         /* heartbeat: not yet */
+
+    ems_cmd(&cmd, (uint8_t)EMS_CMD_CONNECT_DCHG, 40U);
+    bms_can_auth_sign(&cmd);
+    cap_cmd = cmd;
+    TEST_ASSERT(bms_can_auth_verify(&cmd));
+    TEST_ASSERT(bms_can_auth_flush(&ctx));          /* command: at once */
+    TEST_ASSERT_EQ(ctx.persistent.can_rx_fv, 2U);
+
+    /* Heartbeat-only progress goes out after BMS_CAN_AUTH_FV_PERSIST_MS */
+    mock_advance_tick(BMS_CAN_AUTH_FV_PERSIST_MS);
+    ems_heartbeat(&hb);
+    bms_can_auth_sign(&hb);
+    TEST_ASSERT(bms_can_auth_verify(&hb));
+    TEST_ASSERT(bms_can_auth_flush(&ctx));
+    TEST_ASSERT_EQ(ctx.persistent.can_rx_fv, 3U);
+
+    /* The EMS carries on; its next frames arrive after the reset */
+    ems_heartbeat(&next_hb);
+    bms_can_auth_sign(&next_hb);
+    ems_cmd(&next_cmd, (uint8_t)EMS_CMD_CONNECT_DCHG, 40U);
+    bms_can_auth_sign(&next_cmd);
+
+    bms_nvm_init(&boot);                            /* reboot */
+    TEST_ASSERT_EQ(boot.persistent.can_rx_fv, 3U);
+    bms_can_auth_init(k_rfc_key);
+    bms_can_auth_restore(&boot.persistent);
+    TEST_ASSERT_EQ(bms_can_auth_get_rx_seq(), 3U);
+
+    TEST_ASSERT(!bms_can_auth_verify(&cap_hb));     /* replayed after reset */
+    TEST_ASSERT(!bms_can_auth_verify(&cap_cmd));
+    TEST_ASSERT(bms_can_auth_verify(&next_hb));
+    TEST_ASSERT(bms_can_auth_verify(&next_cmd));
+    mock_reset_all();
+}
+
+static void test_freshness_window_and_resync(void)
+{
+    bms_can_frame_t f;
+    bms_can_auth_stats_t st;
+    uint16_t i;
+
+    fprintf(stderr, "  test_freshness_window_and_resync\n");
+    mock_reset_all();
+    bms_can_auth_init(k_rfc_key);
+
+    /* 255 frames lost on the bus — the 256th still verifies */
+    for (i = 0U; i < 255U; i++) {
+        ems_cmd(&f, (uint8_t)EMS_CMD_CONNECT_CHG, 1U);
+        bms_can_auth_sign(&f);
+    }
+    ems_cmd(&f, (uint8_t)EMS_CMD_CONNECT_CHG, 1U);
+    bms_can_auth_sign(&f);
+    TEST_ASSERT(bms_can_auth_verify(&f));
+    TEST_ASSERT_EQ(bms_can_auth_get_rx_seq(), 256U);
+
+    /* 300 lost: low byte aliases, command rejected until the heartbeat */
+    for (i = 0U; i < 300U; i++) {
+        ems_cmd(&f, (uint8_t)EMS_CMD_CONNECT_CHG, 1U);
+        bms_can_auth_sign(&f);
+    }
+    ems_cmd(&f, (uint8_t)EMS_CMD_CONNECT_CHG, 1U);
+    bms_can_auth_sign(&f);
+    TEST_ASSERT(!bms_can_auth_verify(&f));
+
+    ems_heartbeat(&f);
+    bms_can_auth_sign(&f);
+    TEST_ASSERT(bms_can_auth_verify(&f));
+    TEST_ASSERT_EQ(bms_can_auth_get_rx_seq(), bms_can_auth_get_tx_seq());
+
+    ems_cmd(&f, (uint8_t)EMS_CMD_DISCONNECT, 0U);
+    bms_can_auth_sign(&f);
+    TEST_ASSERT(bms_can_auth_verify(&f));
+
+    /* Replayed heartbeat (Ghost EMS) */
+    ems_heartbeat(&f);
+    bms_can_auth_sign(&f);
+    TEST_ASSERT(bms_can_auth_verify(&f));
+    TEST_ASSERT(!bms_can_auth_verify(&f));
+
+    bms_can_auth_get_stats(&st);
+    TEST_ASSERT_EQ(st.resync, 1U);
+    TEST_ASSERT_EQ(st.replay, 1U);
+}
+
+static void test_unkeyed_and_wrong_key(void)
+{
+    static const uint8_t other_key[16] = { 1U, 2U, 3U };
+    bms_can_frame_t f;
+
+    fprintf(stderr, "  test_unkeyed_and_wrong_key\n");
+    mock_reset_all();
+    bms_can_auth_init(other_key);
+    ems_cmd(&f, (uint8_t)EMS_CMD_CONNECT_CHG, 10U);
+    bms_can_auth_sign(&f);
+
+    bms_can_auth_init(k_rfc_key);
+    TEST_ASSERT(!bms_can_auth_verify(&f));
+
+    bms_can_auth_init(NULL);
+    bms_can_auth_sign(&f);                         /* no-op without a key */
+    TEST_ASSERT_EQ(bms_can_auth_get_tx_seq(), 0U);
+    TEST_ASSERT(!bms_can_auth_verify(&f));
+}
+
+static void test_fd_trailer(void)
+{
+    bms_canfd_frame_t f, g;
+    uint8_t i, bad = 0U;
+
+    fprintf(stderr, "  test_fd_trailer\n");
+    mock_reset_all();
+    bms_can_auth_init(k_rfc_key);
+
+    memset(&f, 0, sizeof(f));
+    f.id = CAN_ID_CELL_FD_FULL;
+    f.len = 20U;
+    for (i = 0U; i < 20U; i++) { f.data[i] = (uint8_t)(i * 7U); }
+    TEST_ASSERT(bms_can_auth_sign_fd(&f));
+    TEST_ASSERT_EQ(f.len, 32U);                    /* 20 + 12 → 32 */
+    TEST_ASSERT_EQ(f.data[20], 0U);                /* FV starts at len − 12 */
+    TEST_ASSERT_EQ(f.data[23], 1U);
+    g = f;
+    TEST_ASSERT(bms_can_auth_verify_fd(&f));
+    TEST_ASSERT(!bms_can_auth_verify_fd(&g));      /* replay */
+
+    f.len = BMS_CANFD_AUTH_PAYLOAD_MAX;
+    TEST_ASSERT(bms_can_auth_sign_fd(&f));
+    TEST_ASSERT_EQ(f.len, 64U);
+    for (i = 0U; i < 64U; i++) {
+        g = f;
+        g.data[i] ^= 0x80U;
+        if (bms_can_auth_verify_fd(&g)) { bad++; }
+    }
+    TEST_ASSERT_EQ(bad, 0U);
+    TEST_ASSERT(bms_can_auth_verify_fd(&f));
+
+    f.len = (uint8_t)(BMS_CANFD_AUTH_PAYLOAD_MAX + 1U);
+    TEST_ASSERT(!bms_can_auth_sign_fd(&f));
+
+}
+
+void test_can_auth_suite(void)
+{
+    test_aes_fips197();
+    test_cmac_rfc4493();
+    test_classic_sign_verify();
+    test_freshness_window_and_resync();
+    test_forgery_holdoff();
+    test_fv_persist_restore();
+    test_unkeyed_and_wrong_key();
+    test_fd_trailer();
+}
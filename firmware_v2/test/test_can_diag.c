@@ -0,0 +1,342 @@
+/**
+ * test_can_diag.c — ISO-TP diagnostic service against a simulated tester
+ */
+
+#include "bms_can_diag.h"
+#include "bms_blackbox.h"
+#include "bms_can_rx.h"
+#include "bms_can_txq.h"
+#include "bms_can.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern void mock_advance_tick(uint32_t ms);
+extern uint8_t mock_get_can_tx_count(void);
+extern const bms_can_frame_t *mock_get_can_tx(uint8_t idx);
+extern void mock_clear_can_tx(void);
+extern uint32_t mock_get_nvm_reads_in_critical(void);
+
+static bms_pack_data_t        s_pack;
+static bms_protection_state_t s_prot;
+static bms_nvm_ctx_t          s_nvm;
+static uint8_t                s_rx[2048];
+
+/* One NVM task release: re-arm the erase budget, stream a slice */
+static bool nvm_release_flush(void)
+{
+    bms_nvm_release();
+    return bms_blackbox_flush();
+}
+
+/* Simulated tester results */
+static uint16_t s_total;
+static uint16_t s_got;
+static uint16_t s_fc_sent;
+static uint16_t s_periodic_seen;
+static uint16_t s_periodic_calls;
+static bool     s_sn_error;
+
+static void setup(void)
+{
+    mock_reset_all();
+    memset(&s_pack, 0, sizeof(s_pack));
+    memset(&s_prot, 0, sizeof(s_prot));
+    memset(&s_nvm, 0, sizeof(s_nvm));
+    bms_can_init();
+    bms_can_diag_init(&s_pack, &s_prot, &s_nvm);
+}
+
+static void tester_send(const uint8_t *bytes, uint8_t n)
+{
+    bms_can_frame_t f;
+    f.id = CAN_ID_DIAG_REQ;
+    f.dlc = 8U;
+    memset(f.data, 0xAAU, sizeof(f.data));
+    memcpy(f.data, bytes, n);
+    bms_can_rx_isr(&f);
+}
+
+static void tester_fc(uint8_t bs, uint8_t stmin)
+{
+    const uint8_t fc[3] = { 0x30U, bs, stmin };
+    tester_send(fc, 3U);
+    s_fc_sent++;
+}
+
+static void tester_request(uint16_t did)
+{
+    const uint8_t sf[4] = { 0x03U, BMS_DIAG_SID_READ_DID,
+                            (uint8_t)(did >> 8U), (uint8_t)did };
+    tester_send(sf, 4U);
+}
+
+/* Run 10 ms ticks until the response is complete; returns elapsed ms */
+static uint32_t tester_collect(uint8_t bs, uint8_t stmin, bool with_periodic)
+{
+    uint32_t elapsed = 0U;
+    uint16_t block = 0U;
+    uint8_t next_sn = 1U;
+    uint16_t iter;
+
+    s_total = 0U; s_got = 0U; s_fc_sent = 0U;
+    s_periodic_seen = 0U; s_periodic_calls = 0U; s_sn_error = false;
+
+    for (iter = 0U; iter < 500U; iter++) {
+        uint8_t i;
+
+        if (with_periodic && (iter % (BMS_CAN_TX_PERIOD_MS / BMS_DIAG_POLL_MS)) == 0U) {
+            bms_can_tx_periodic(&s_pack);
+            s_periodic_calls++;
+        }
+        bms_can_diag_poll();
+        bms_can_txq_kick();
+
+        for (i = 0U; i < mock_get_can_tx_count(); i++) {
+            const bms_can_frame_t *f = mock_get_can_tx(i);
+            uint8_t pci;
+            if (f->id != CAN_ID_DIAG_RESP) { s_periodic_seen++; continue; }
+            pci = (uint8_t)(f->data[0] >> 4U);
+            if (pci == 0U) {
+                s_total = (uint16_t)(f->data[0] & 0x0FU);
+                memcpy(s_rx, &f->data[1], s_total);
+                s_got = s_total;
+            } else if (pci == 1U) {
+                s_total = (uint16_t)(((uint16_t)(f->data[0] & 0x0FU) << 8U) | f->data[1]);
+                memcpy(s_rx, &f->data[2], 6U);
+                s_got = 6U;
+                tester_fc(bs, stmin);
+            } else if (pci == 2U) {
+                uint16_t n = (uint16_t)(s_total - s_got);
+                if ((f->data[0] & 0x0FU) != next_sn) { s_sn_error = true; }
+                next_sn = (uint8_t)((next_sn + 1U) & 0x0FU);
+                if (n > 7U) { n = 7U; }
+                memcpy(&s_rx[s_got], &f->data[1], n);
+                s_got = (uint16_t)(s_got + n);
+                block++;
+                if (bs != 0U && block == bs && s_got < s_total) {
+                    block = 0U;
+                    tester_fc(bs, stmin);
+                }
+            }
+        }
+        mock_clear_can_tx();
+        if (s_total != 0U && s_got >= s_total) { break; }
+        mock_advance_tick(BMS_DIAG_POLL_MS);
+        elapsed += BMS_DIAG_POLL_MS;
+    }
+    return elapsed;
+}
+
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(((uint16_t)p[0] << 8U) | p[1]); }
+static uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24U) | ((uint32_t)p[1] << 16U) | ((uint32_t)p[2] << 8U) | p[3];
+}
+
+static void test_snapshot_frozen_and_paced(void)
+{
+    uint32_t elapsed;
+    uint16_t i;
+    bool cells_ok = true;
+
+    setup();
+    s_pack.uptime_ms = 123456U;
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { s_pack.cell_mv[i] = (uint16_t)(3000U + i * 3U); }
+    s_pack.modules[21].temp_deci_c[2] = -105;
+
+    tester_request(BMS_DIAG_DID_SNAPSHOT);
+    bms_can_diag_poll();                    /* request served, data frozen */
+    s_pack.cell_mv[0] = 4444U;              /* later change must not leak in */
+
+    elapsed = tester_collect(0U, 0U, true);
+    TEST_ASSERT_EQ(s_total, BMS_DIAG_LEN_SNAPSHOT);
+    TEST_ASSERT_EQ(s_got, s_total);
+    TEST_ASSERT(!s_sn_error);
+    TEST_ASSERT_EQ(s_rx[0], 0x62U);
+    TEST_ASSERT_EQ(get_u16(&s_rx[1]), BMS_DIAG_DID_SNAPSHOT);
+    TEST_ASSERT_EQ(get_u32(&s_rx[3]), 123456U);
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        if (get_u16(&s_rx[7U + 2U * i]) != (uint16_t)(3000U + i * 3U)) { cells_ok = false; }
+    }
+    TEST_ASSERT(cells_ok);
+    TEST_ASSERT_EQ((int16_t)get_u16(&s_rx[BMS_DIAG_LEN_SNAPSHOT - 2U]), -105);
+
+    /* Periodic traffic never starved: every 100 ms batch went out */
+    TEST_ASSERT_EQ(s_periodic_seen, (uint16_t)(s_periodic_calls * 6U));
+    /* Well under the 7.7 s cell-broadcast cycle */
+    TEST_ASSERT(elapsed < 500U);
+    TEST_ASSERT(!bms_can_diag_busy());
+}
+
+static void test_fault_log(void)
+{
+    setup();
+    bms_nvm_log_fault(&s_nvm, 1000U, NVM_FAULT_OV, 17U, 4210U);
+    bms_nvm_log_fault(&s_nvm, 2000U, NVM_FAULT_OT, 0xFFU, 650U);
+    bms_nvm_log_fault(&s_nvm, 3000U, NVM_FAULT_RESET, 0xFFU, 0U);
+
+    tester_request(BMS_DIAG_DID_FAULT_LOG);
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_total, 3U + 1U + 3U * 8U);
+    TEST_ASSERT_EQ(s_rx[3], 3U);
+    TEST_ASSERT_EQ(get_u32(&s_rx[4]), 3000U);          /* newest first */
+    TEST_ASSERT_EQ(s_rx[4U + 16U + 4U], NVM_FAULT_OV);
+    TEST_ASSERT_EQ(s_rx[4U + 16U + 5U], 17U);
+    TEST_ASSERT_EQ(get_u16(&s_rx[4U + 16U + 6U]), 4210U);
+
+    /* NVM task preempted mid-push: the live ring is half-written, the
+     * response still carries the last published copy */
+    s_nvm.fault_log[s_nvm.fault_head].timestamp_ms = 0xDEADBEEFU;
+    s_nvm.fault_head = (uint8_t)((s_nvm.fault_head + 1U) % BMS_NVM_FAULT_LOG_SIZE);
+    tester_request(BMS_DIAG_DID_FAULT_LOG);
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_total, 3U + 1U + 3U * 8U);
+    TEST_ASSERT_EQ(get_u32(&s_rx[4]), 3000U);
+}
+
+static void test_prot_timers_block_size(void)
+{
+    uint16_t cfs;
+
+    setup();
+    s_prot.ov_timer_ms[5] = 1234U;
+    s_prot.uv_timer_ms[307] = 42U;
+    s_prot.warning_hold_ms = 0xDEADBEEFU;
+
+    tester_request(BMS_DIAG_DID_PROT_TIMERS);
+    (void)tester_collect(4U, 0U, false);
+    TEST_ASSERT_EQ(s_total, BMS_DIAG_LEN_PROT);
+    TEST_ASSERT_EQ(s_got, s_total);
+    TEST_ASSERT_EQ(get_u16(&s_rx[3U + 10U]), 1234U);
+    TEST_ASSERT_EQ(get_u16(&s_rx[3U + 616U + 614U]), 42U);
+    TEST_ASSERT_EQ(get_u32(&s_rx[BMS_DIAG_LEN_PROT - 4U]), 0xDEADBEEFU);
+
+    /* One FC after the FF, then one per 4-CF block */
+    cfs = (uint16_t)((BMS_DIAG_LEN_PROT - 6U + 6U) / 7U);
+    TEST_ASSERT_EQ(s_fc_sent, (uint16_t)(1U + (cfs - 1U) / 4U));
+}
+
+static void test_stmin_honoured(void)
+{
+    uint32_t elapsed;
+
+    setup();
+    tester_request(BMS_DIAG_DID_FAULT_LOG);     /* empty log: 4 bytes → SF */
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_total, 4U);
+
+    /* 20 ms STmin → one CF per 20 ms */
+    bms_nvm_log_fault(&s_nvm, 1U, NVM_FAULT_UV, 1U, 2900U);
+    bms_nvm_log_fault(&s_nvm, 2U, NVM_FAULT_UV, 2U, 2900U);
+    tester_request(BMS_DIAG_DID_FAULT_LOG);
+    elapsed = tester_collect(0U, 20U, false);
+    TEST_ASSERT_EQ(s_total, 20U);               /* FF + 2 CFs */
+    TEST_ASSERT(elapsed >= 20U);
+}
+
+static void test_negative_and_timeout(void)
+{
+    const uint8_t bad_sid[2] = { 0x01U, 0x10U };
+    const uint8_t ff_req[8] = { 0x10U, 0x20U, 0x22U, 0xF1U, 0x00U, 0U, 0U, 0U };
+    bms_can_diag_stats_t st;
+    const bms_can_frame_t *f;
+
+    setup();
+    tester_request(0x1234U);
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_total, 3U);
+    TEST_ASSERT_EQ(s_rx[0], BMS_DIAG_SID_NEGATIVE);
+    TEST_ASSERT_EQ(s_rx[2], BMS_DIAG_NRC_OUT_OF_RANGE);
+
+    tester_send(bad_sid, 2U);
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_rx[2], BMS_DIAG_NRC_NOT_SUPP);
+
+    /* Multi-frame request → FC overflow */
+    tester_send(ff_req, 8U);
+    bms_can_diag_poll();
+    bms_can_txq_kick();
+    f = mock_get_can_tx(0U);
+    TEST_ASSERT(f != NULL && f->id == CAN_ID_DIAG_RESP && f->data[0] == 0x32U);
+    mock_clear_can_tx();
+
+    /* Tester never sends FC → N_Bs abort */
+    tester_request(BMS_DIAG_DID_SNAPSHOT);
+    bms_can_diag_poll();
+    TEST_ASSERT(bms_can_diag_busy());
+    mock_advance_tick(BMS_DIAG_N_BS_MS + 10U);
+    bms_can_diag_poll();
+    TEST_ASSERT(!bms_can_diag_busy());
+    bms_can_diag_get_stats(&st);
+    TEST_ASSERT_EQ(st.aborted, 1U);
+    TEST_ASSERT_EQ(st.negative, 2U);
+}
+
+static void test_blackbox_dids(void)
+{
+    static uint8_t blk[BMS_BBOX_BLOCK_SIZE];
+    uint16_t i;
+
+    setup();
+    bms_blackbox_init();
+    tester_request(BMS_DIAG_DID_BBOX_INFO);         /* nothing stored yet */
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_rx[0], BMS_DIAG_SID_NEGATIVE);
+
+    s_pack.mode = BMS_MODE_CONNECTED;
+    for (i = 0U; i <= 300U + BMS_BBOX_POST_MS / BMS_BBOX_PERIOD_MS; i++) {
+        if (i == 300U) { s_pack.fault_latched = true; }
+        s_pack.pack_current_ma = (int32_t)i * 250;
+        mock_advance_tick(BMS_BBOX_PERIOD_MS);
+        bms_blackbox_record(&s_pack);
+    }
+    while (nvm_release_flush()) { }
+
+    tester_request(BMS_DIAG_DID_BBOX_INFO);
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_total, BMS_DIAG_LEN_BBOX_INFO);
+    TEST_ASSERT_EQ(get_u16(&s_rx[1]), BMS_DIAG_DID_BBOX_INFO);
+    TEST_ASSERT(get_u16(&s_rx[3]) >= 2U);                       /* blocks */
+    TEST_ASSERT_EQ(get_u32(&s_rx[9]), 301U * BMS_BBOX_PERIOD_MS); /* trigger */
+
+    tester_request(BMS_DIAG_DID_BBOX_BLOCK + 1U);
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_total, BMS_DIAG_LEN_BBOX_BLOCK);
+    TEST_ASSERT_EQ(s_got, s_total);
+    TEST_ASSERT(bms_blackbox_read_block(1U, blk));
+    TEST_ASSERT(memcmp(&s_rx[3], blk, sizeof(blk)) == 0);
+
+    tester_request((uint16_t)(BMS_DIAG_DID_BBOX_BLOCK + get_u16(&s_rx[3]) + 40U));
+    (void)tester_collect(0U, 0U, false);
+    TEST_ASSERT_EQ(s_rx[2], BMS_DIAG_NRC_OUT_OF_RANGE);
+
+    /* Every one of those flash reads ran with interrupts enabled */
+    TEST_ASSERT_EQ(mock_get_nvm_reads_in_critical(), 0U);
+}
+
+void test_can_diag_suite(void)
+{
+    test_snapshot_frozen_and_paced();
+    test_fault_log();
+    test_prot_timers_block_size();
+    test_stmin_honoured();
+    test_negative_and_timeout();
+    test_blackbox_dids();
+}
@@ -0,0 +1,262 @@
+/**
+ * test_can_msgs.c — table-generated CAN codec vs the hand-packed originals
+ */
+
+#include "bms_can.h"
+#include "bms_can_msgs.h"
+#include "bms_can_log.h"
+#include "bms_safety_io.h"
+#include "bms_config.h"
+#include "can_ref_encode.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+
+static uint32_t s_lcg = 0xC0FFEEU;
+
+static uint32_t rnd32(void)
+{
+    s_lcg = s_lcg * 1103515245U + 12345U;
+    return (s_lcg >> 8U) ^ (s_lcg << 20U);
+}
+
+static bool same_frame(const bms_can_frame_t *a, const bms_can_frame_t *b)
+{
+    return a->id == b->id && a->dlc == b->dlc &&
+           memcmp(a->data, b->data, sizeof(a->data)) == 0;
+}
+
+/* Full-range random pack, including negative currents/temps and limits
+ * past the 16-bit wire range (truncation must match too) */
+static void random_pack(bms_pack_data_t *p)
+{
+    uint16_t i;
+    uint32_t f = rnd32();
+
+    memset(p, 0, sizeof(*p));
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { p->cell_mv[i] = (uint16_t)rnd32(); }
+    p->pack_voltage_mv = rnd32();
+    p->pack_current_ma = (int32_t)rnd32();
+    p->max_cell_mv = (uint16_t)rnd32();
+    p->min_cell_mv = (uint16_t)rnd32();
+    p->avg_cell_mv = (uint16_t)rnd32();
+    p->max_temp_deci_c = (int16_t)rnd32();
+    p->min_temp_deci_c = (int16_t)rnd32();
+    p->soc_hundredths = (uint16_t)rnd32();
+    memcpy(&p->faults, &f, sizeof(f));
+    p->charge_limit_ma = (int32_t)rnd32();
+    p->discharge_limit_ma = (int32_t)rnd32();
+    p->mode = (bms_pack_mode_t)(rnd32() % 8U);
+    p->uptime_ms = rnd32();
+}
+
+static void test_encoders_match_reference(void)
+{
+    bms_pack_data_t pack;
+    bms_can_frame_t a, b;
+    uint16_t n;
+    uint16_t bad = 0U;
+
+    fprintf(stderr, "  test_encoders_match_reference\n");
+    for (n = 0U; n < 500U; n++) {
+        uint8_t idx = (uint8_t)(rnd32() % ((BMS_SE_PER_PACK + 3U) / 4U));
+        random_pack(&pack);
+
+        bms_can_encode_status(&pack, &a);    ref_encode_status(&pack, &b);
+        if (!same_frame(&a, &b)) { bad++; }
+        bms_can_encode_voltages(&pack, &a);  ref_encode_voltages(&pack, &b);
+        if (!same_frame(&a, &b)) { bad++; }
+        bms_can_encode_temps(&pack, &a);     ref_encode_temps(&pack, &b);
+        if (!same_frame(&a, &b)) { bad++; }
+        bms_can_encode_heartbeat(pack.uptime_ms, &a);
+        ref_encode_heartbeat(pack.uptime_ms, &b);
+        if (!same_frame(&a, &b)) { bad++; }
+        bms_can_encode_limits(&pack, &a);    ref_encode_limits(&pack, &b);
+        if (!same_frame(&a, &b)) { bad++; }
+        bms_can_encode_cell_broadcast(&pack, idx, &a);
+        ref_encode_cell_broadcast(&pack, idx, &b);
+        if (!same_frame(&a, &b)) { bad++; }
+    }
+    TEST_ASSERT_EQ(bad, 0U);
+
+    /* Last broadcast frame is partly past the pack — zero padded */
+    random_pack(&pack);
+    bms_can_encode_cell_broadcast(&pack, (uint8_t)((BMS_SE_PER_PACK + 3U) / 4U - 1U), &a);
+    ref_encode_cell_broadcast(&pack, (uint8_t)((BMS_SE_PER_PACK + 3U) / 4U - 1U), &b);
+    TEST_ASSERT(same_frame(&a, &b));
+}
+
+static void test_safety_io_matches_reference(void)
+{
+    bms_safety_io_state_t sio;
+    bms_can_frame_t a, b;
+
+    fprintf(stderr, "  test_safety_io_matches_reference\n");
+    memset(&sio, 0, sizeof(sio));
+    sio.gas_level = SAFETY_IO_SHUTDOWN;
+    sio.fire_level = SAFETY_IO_SHUTDOWN;
+    sio.fire_suppression_active = true;
+    bms_safety_io_encode_can(&sio, &a);
+    ref_encode_safety_io(&sio, &b);
+    TEST_ASSERT(same_frame(&a, &b));
+
+    sio.vent_running = true;
+    sio.fire_suppression_active = false;
+    bms_safety_io_encode_can(&sio, &a);
+    ref_encode_safety_io(&sio, &b);
+    TEST_ASSERT(same_frame(&a, &b));
+}
+
+static void ems_frame(bms_can_frame_t *f, uint8_t cmd, int16_t chg_a, int16_t dchg_a)
+{
+    bms_can_msg_ems_command_t m;
+
+    memset(&m, 0, sizeof(m));
+    m.cmd = cmd;
+    m.charge_limit_ma = (int32_t)chg_a * 1000;
+    m.discharge_limit_ma = (int32_t)dchg_a * 1000;
+    bms_can_msg_ems_command_encode(&m, f);
+}
+
+static void test_ems_decode_validation(void)
+{
+    bms_can_frame_t f;
+    bms_ems_command_t cmd;
+
+    fprintf(stderr, "  test_ems_decode_validation\n");
+    mock_reset_all();
+
+    ems_frame(&f, (uint8_t)EMS_CMD_SET_LIMITS, 200, 300);
+    TEST_ASSERT_EQ(f.data[1], 0x00U);
+    TEST_ASSERT_EQ(f.data[2], 200U);
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), 0);
+    TEST_ASSERT_EQ(cmd.charge_limit_ma, 200000);
+    TEST_ASSERT_EQ(cmd.discharge_limit_ma, 300000);
+
+    /* Clamped to hardware maximum */
+    ems_frame(&f, (uint8_t)EMS_CMD_SET_LIMITS, 30000, 30000);
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), 0);
+    TEST_ASSERT_EQ(cmd.charge_limit_ma, BMS_MAX_CHARGE_MA);
+    TEST_ASSERT_EQ(cmd.discharge_limit_ma, BMS_MAX_DISCHARGE_MA);
+
+    /* P2-06 rejections still hold through the table decoder */
+    ems_frame(&f, (uint8_t)EMS_CMD_SET_LIMITS, -1, 100);
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), -1);
+    ems_frame(&f, (uint8_t)EMS_CMD_SET_LIMITS, 100, -1);
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), -1);
+    ems_frame(&f, (uint8_t)EMS_CMD_NONE, 0, 0);
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), -1);
+    ems_frame(&f, (uint8_t)EMS_CMD_COUNT, 0, 0);
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), -1);
+    ems_frame(&f, (uint8_t)EMS_CMD_CONNECT_CHG, 10, 10);
+    f.data[5] = 1U;
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), -1);
+    TEST_ASSERT(!cmd.valid);
+
+    /* Short (5-byte) command: reserved bytes not checked */
+    ems_frame(&f, (uint8_t)EMS_CMD_CONNECT_DCHG, 10, 20);
+    f.dlc = 5U;
+    TEST_ASSERT_EQ(bms_can_decode_ems_command(&f, &cmd), 0);
+    TEST_ASSERT_EQ(cmd.discharge_limit_ma, 20000);
+}
+
+static void test_decode_roundtrip(void)
+{
+    bms_can_msg_status_t in, out;
+    bms_can_msg_limits_t lin, lout;
+    bms_can_frame_t f;
+
+    fprintf(stderr, "  test_decode_roundtrip\n");
+    in.mode = 3U;
+    in.pack_voltage_mv = 1150000U;
+    in.pack_current_ma = -123400;
+    in.soc_hundredths = 8700U;
+    in.max_temp_deci_c = -150;
+    in.faults = 0x5AU;
+    bms_can_msg_status_encode(&in, &f);
+    bms_can_msg_status_decode(&f, &out);
+    TEST_ASSERT_EQ(out.mode, 3U);
+    TEST_ASSERT_EQ(out.pack_voltage_mv, 1150000U);
+    TEST_ASSERT_EQ(out.pack_current_ma, -123400);
+    TEST_ASSERT_EQ(out.soc_hundredths, 8700U);
+    TEST_ASSERT_EQ(out.max_temp_deci_c, -150);
+    TEST_ASSERT_EQ(out.faults, 0x5AU);
+
+    lin.charge_limit_ma = -7;
+    lin.discharge_limit_ma = 640000;
+    bms_can_msg_limits_encode(&lin, &f);
+    bms_can_msg_limits_decode(&f, &lout);
+    TEST_ASSERT_EQ(lout.charge_limit_ma, -7);
+    TEST_ASSERT_EQ(lout.discharge_limit_ma, 640000);
+}
+
+static void test_log_decoder(void)
+{
+    bms_can_frame_t f;
+    char buf[256];
+    size_t prefix = 0U;
+    const bms_can_msg_desc_t *d;
+
+    fprintf(stderr, "  test_log_decoder\n");
+
+    TEST_ASSERT(bms_can_log_parse("(1697040000.100000) can0 100#032CEC0000571E01",
+                                  &f, &prefix));
+    TEST_ASSERT_EQ(prefix, 25U);
+    TEST_ASSERT_EQ(f.id, 0x100U);
+    TEST_ASSERT_EQ(f.dlc, 8U);
+    TEST_ASSERT(bms_can_log_format(&f, buf, sizeof(buf)) > 0);
+    TEST_ASSERT(strcmp(buf, "status mode=3 pack_voltage_mv=1150000 mV pack_current_ma=0 mA"
+                            " soc_hundredths=8700 0.01% max_temp_deci_c=-100 0.1C"
+                            " faults=1") == 0);
+
+    /* Exact ID beats the cell-broadcast span; inside the span gets an index */
+    d = bms_can_log_find(CAN_ID_PACK_TEMPS);
+    TEST_ASSERT(d != NULL && strcmp(d->name, "temps") == 0);
+    d = bms_can_log_find(CAN_ID_CELL_BROADCAST + 3U);
+    TEST_ASSERT(d != NULL && strcmp(d->name, "cells") == 0);
+    TEST_ASSERT(bms_can_log_parse("can0 134#0E420E4300000000", &f, &prefix));
+    (void)bms_can_log_format(&f, buf, sizeof(buf));
+    TEST_ASSERT(strncmp(buf, "cells[3] cell0_mv=3650 mV cell1_mv=3651 mV", 42) == 0);
+
+    /* Truncated frame: missing signals print as '-' */
+    TEST_ASSERT(bms_can_log_parse("108#0001", &f, &prefix));
+    (void)bms_can_log_format(&f, buf, sizeof(buf));
+    TEST_ASSERT(strcmp(buf, "heartbeat uptime_ms=-") == 0);
+
+    /* Unknown ID, CAN FD marker, garbage */
+    TEST_ASSERT(bms_can_log_parse("7FF#00", &f, &prefix));
+    TEST_ASSERT_EQ(bms_can_log_format(&f, buf, sizeof(buf)), -1);
+    TEST_ASSERT(!bms_can_log_parse("181##10102", &f, &prefix));
+    TEST_ASSERT(!bms_can_log_parse("no frame here", &f, &prefix));
+    TEST_ASSERT(!bms_can_log_parse("100#001122334455667788", &f, &prefix));
+
+    /* Small buffer is truncated, never overrun */
+    TEST_ASSERT(bms_can_log_parse("100#032CEC0000571E01", &f, &prefix));
+    TEST_ASSERT(bms_can_log_format(&f, buf, 12U) <= 11);
+    TEST_ASSERT_EQ(strlen(buf), 11U);
+}
+
+void test_can_msgs_suite(void)
+{
+    test_encoders_match_reference();
+    test_safety_io_matches_reference();
+    test_ems_decode_validation();
+    test_decode_roundtrip();
+    test_log_decoder();
+}
@@ -0,0 +1,220 @@
+/**
+ * test_can_rx.c — CAN RX ring: ISR filter, full drain, urgent wake, latency
+ */
+
+#include "bms_can_rx.h"
+#include "bms_can.h"
+#include "bms_state.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern void mock_set_tick(uint32_t tick_ms);
+extern void mock_advance_tick(uint32_t ms);
+extern void mock_inject_can_frame(const bms_can_frame_t *frame);
+extern void mock_set_can_rx_irq_armed(bool armed);
+
+static bms_can_rx_stats_t s_st;
+static uint8_t s_hook_calls;
+
+static void hook(void) { s_hook_calls++; }
+
+static void setup(void)
+{
+    mock_reset_all();
+    bms_can_rx_init();
+    bms_can_rx_set_urgent_hook(hook);
+    s_hook_calls = 0U;
+}
+
+static bms_can_frame_t ems_cmd(bms_ems_cmd_type_t type)
+{
+    bms_can_frame_t f;
+    memset(&f, 0, sizeof(f));
+    f.id = CAN_ID_EMS_COMMAND;
+    f.dlc = 8U;
+    f.data[0] = (uint8_t)type;
+    if (type == EMS_CMD_SET_LIMITS) {
+        f.data[2] = 100U;                       /* 100 A charge */
+        f.data[4] = 100U;                       /* 100 A discharge */
+    }
+    return f;
+}
+
+static bms_can_frame_t ems_heartbeat(void)
+{
+    bms_can_frame_t f;
+    memset(&f, 0, sizeof(f));
+    f.id = CAN_ID_EMS_HEARTBEAT;
+    f.dlc = 8U;
+    return f;
+}
+
+static void test_isr_filters_foreign_ids(void)
+{
+    bms_can_frame_t f;
+
+    setup();
+    memset(&f, 0, sizeof(f));
+    f.id = 0x123U;
+    bms_can_rx_isr(&f);
+    bms_can_rx_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.filtered, 1U);
+    TEST_ASSERT_EQ(bms_can_rx_pending(), 0U);
+}
+
+static void test_drains_all_frames(void)
+{
+    bms_ems_command_t cmd;
+    bms_can_frame_t f;
+
+    setup();
+    f = ems_heartbeat();  bms_can_rx_isr(&f);
+    f = ems_cmd(EMS_CMD_SET_LIMITS);  bms_can_rx_isr(&f);
+    f = ems_heartbeat();  bms_can_rx_isr(&f);
+    TEST_ASSERT_EQ(bms_can_rx_pending(), 3U);
+    TEST_ASSERT(!bms_can_rx_urgent_pending());
+
+    TEST_ASSERT(bms_can_rx_drain(&cmd));
+    TEST_ASSERT_EQ(bms_can_rx_pending(), 0U);
+    TEST_ASSERT_EQ(cmd.type, EMS_CMD_SET_LIMITS);    /* not masked by heartbeat */
+    TEST_ASSERT_EQ(cmd.charge_limit_ma, 100000);
+    bms_can_rx_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.commands, 1U);
+    TEST_ASSERT_EQ(s_st.heartbeats, 2U);
+
+    /* Nothing new → command is not replayed next cycle */
+    TEST_ASSERT(!bms_can_rx_drain(&cmd));
+    TEST_ASSERT(!cmd.valid);
+}
+
+static void test_disconnect_is_urgent_and_wins(void)
+{
+    bms_ems_command_t cmd;
+    bms_can_frame_t f;
+
+    setup();
+    f = ems_cmd(EMS_CMD_DISCONNECT);   bms_can_rx_isr(&f);
+    TEST_ASSERT(bms_can_rx_urgent_pending());
+    TEST_ASSERT_EQ(s_hook_calls, 1U);
+    f = ems_cmd(EMS_CMD_CONNECT_CHG);  bms_can_rx_isr(&f);
+    TEST_ASSERT_EQ(s_hook_calls, 1U);
+
+    TEST_ASSERT(bms_can_rx_drain(&cmd));
+    TEST_ASSERT_EQ(cmd.type, EMS_CMD_DISCONNECT);
+    TEST_ASSERT(!bms_can_rx_urgent_pending());
+    bms_can_rx_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.superseded, 1U);
+    TEST_ASSERT_EQ(s_st.urgent, 1U);
+}
+
+static void test_invalid_frames_counted(void)
+{
+    bms_ems_command_t cmd;
+    bms_can_frame_t f;
+
+    setup();
+    f = ems_cmd(EMS_CMD_DISCONNECT);
+    f.data[5] = 0xAAU;                           /* P2-06 reserved byte */
+    bms_can_rx_isr(&f);
+    TEST_ASSERT(!bms_can_rx_drain(&cmd));
+    bms_can_rx_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.decode_reject, 1U);
+}
+
+static void test_overflow_counted(void)
+{
+    bms_can_frame_t f = ems_heartbeat();
+    uint8_t i;
+
+    setup();
+    for (i = 0U; i < (uint8_t)(BMS_CAN_RX_DEPTH + 1U); i++) { bms_can_rx_isr(&f); }
+    bms_can_rx_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.overflow, 1U);
+    TEST_ASSERT_EQ(s_st.ring_hwm, BMS_CAN_RX_DEPTH);
+}
+
+static void test_disconnect_latency(void)
+{
+    bms_pack_data_t pack;
+    bms_contactor_ctx_t contactor;
+    bms_ems_command_t cmd;
+    bms_can_frame_t f;
+
+    setup();
+    memset(&pack, 0, sizeof(pack));
+    bms_contactor_init(&contactor);
+    pack.mode = BMS_MODE_CONNECTED;
+    pack.uptime_ms = 1000U;
+    pack.last_ems_msg_ms = 1000U;
+    mock_set_tick(1000U);
+
+    /* Frame arrives through the polled/mocked FIFO path */
+    f = ems_cmd(EMS_CMD_DISCONNECT);
+    mock_inject_can_frame(&f);
+    memset(&cmd, 0, sizeof(cmd));
+    TEST_ASSERT(bms_can_rx_process(&cmd));
+
+    mock_advance_tick(3U);
+    bms_state_run(&pack, &contactor, NULL, NULL, &cmd, BMS_STATE_PERIOD_MS);
+    bms_can_rx_note_handled(&cmd);
+    TEST_ASSERT_EQ(pack.mode, BMS_MODE_READY);
+
+    bms_can_rx_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.cmd_latency_count, 1U);
+    TEST_ASSERT_EQ(s_st.cmd_latency_last_ms, 3U);
+    TEST_ASSERT(s_st.cmd_latency_max_ms < 10U);
+}
+
+/* ── Test: with the RX interrupt armed the task never polls the FIFO ─ */
+static void test_isr_sole_producer(void)
+{
+    bms_ems_command_t cmd;
+    bms_can_frame_t f;
+
+    setup();
+    mock_set_can_rx_irq_armed(true);
+
+    /* A frame left in the FIFO belongs to the ISR, not the state task */
+    f = ems_cmd(EMS_CMD_DISCONNECT);
+    mock_inject_can_frame(&f);
+    memset(&cmd, 0, sizeof(cmd));
+    TEST_ASSERT(!bms_can_rx_process(&cmd));
+    bms_can_rx_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.isr_frames, 0U);
+
+    /* The ISR's frames are drained as before */
+    bms_can_rx_isr(&f);
+    TEST_ASSERT(bms_can_rx_process(&cmd));
+    TEST_ASSERT_EQ(cmd.type, EMS_CMD_DISCONNECT);
+    bms_can_rx_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.isr_frames, 1U);
+    mock_set_can_rx_irq_armed(false);
+}
+
+void test_can_rx_suite(void)
+{
+    test_isr_filters_foreign_ids();
+    test_drains_all_frames();
+    test_disconnect_is_urgent_and_wins();
+    test_invalid_frames_counted();
+    test_overflow_counted();
+    test_disconnect_latency();
+    test_isr_sole_producer();
+}
@@ -0,0 +1,195 @@
+/**
+ * test_can_txq.c — CAN TX queue: priority preemption, drops, budget, latency
+ */
+
+#include "bms_can_txq.h"
+#include "bms_can.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern void mock_advance_tick(uint32_t ms);
+extern uint8_t mock_get_can_tx_count(void);
+extern const bms_can_frame_t *mock_get_can_tx(uint8_t idx);
+extern void mock_clear_can_tx(void);
+extern void mock_set_can_mailboxes(uint8_t n);
+extern void mock_can_tx_complete(void);
+extern bool mock_get_can_tx_irq_enabled(void);
+
+static bms_can_txq_stats_t s_st;
+
+static void setup(void)
+{
+    mock_reset_all();
+    bms_can_txq_init();
+}
+
+static void queue_n(bms_can_prio_t prio, uint32_t id, uint8_t n)
+{
+    bms_can_frame_t f;
+    uint8_t i;
+    memset(&f, 0, sizeof(f));
+    f.dlc = 8U;
+    for (i = 0U; i < n; i++) {
+        f.id = id + i;
+        (void)bms_can_txq_send(&f, prio);
+    }
+}
+
+static void test_frame_bits(void)
+{
+    TEST_ASSERT_EQ(bms_can_frame_bits(0U), 55U);
+    TEST_ASSERT_EQ(bms_can_frame_bits(8U), 135U);
+    TEST_ASSERT_EQ(bms_can_frame_bits(15U), 135U);
+}
+
+static void test_alarm_preempts_bulk(void)
+{
+    const bms_can_frame_t *f;
+
+    setup();
+    mock_set_can_mailboxes(3U);
+    queue_n(BMS_CAN_PRIO_BULK, 0x131U, 6U);
+    bms_can_txq_kick();
+    TEST_ASSERT_EQ(mock_get_can_tx_count(), 3U);
+    TEST_ASSERT_EQ(bms_can_txq_pending(BMS_CAN_PRIO_BULK), 3U);
+    TEST_ASSERT(mock_get_can_tx_irq_enabled());
+
+    /* Alarm arrives behind three queued broadcasts */
+    queue_n(BMS_CAN_PRIO_ALARM, CAN_ID_DTDT_ALARM, 1U);
+    mock_clear_can_tx();
+    mock_can_tx_complete();
+    bms_can_txq_isr();
+    f = mock_get_can_tx(0U);
+    TEST_ASSERT(f != NULL && f->id == CAN_ID_DTDT_ALARM);
+    TEST_ASSERT_EQ(mock_get_can_tx_count(), 3U);
+    TEST_ASSERT_EQ(bms_can_txq_pending(BMS_CAN_PRIO_BULK), 1U);
+
+    /* Mailboxes busy → no transmit attempt, nothing lost */
+    bms_can_txq_isr();
+    TEST_ASSERT_EQ(bms_can_txq_pending(BMS_CAN_PRIO_BULK), 1U);
+}
+
+static void test_ring_full_drops_counted(void)
+{
+    bms_can_frame_t f;
+
+    setup();
+    mock_set_can_mailboxes(0U);
+    memset(&f, 0, sizeof(f));
+    queue_n(BMS_CAN_PRIO_TELEMETRY, 0x130U, (uint8_t)BMS_CAN_TXQ_DEPTH);
+    TEST_ASSERT_EQ(bms_can_txq_send(&f, BMS_CAN_PRIO_TELEMETRY), -1);
+    TEST_ASSERT_EQ(bms_can_txq_send(&f, BMS_CAN_PRIO_TELEMETRY), -1);
+    /* Other classes unaffected */
+    TEST_ASSERT_EQ(bms_can_txq_send(&f, BMS_CAN_PRIO_CONTROL), 0);
+
+    bms_can_txq_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.dropped[BMS_CAN_PRIO_TELEMETRY], 2U);
+    TEST_ASSERT_EQ(s_st.dropped[BMS_CAN_PRIO_CONTROL], 0U);
+    TEST_ASSERT_EQ(s_st.depth_hwm[BMS_CAN_PRIO_TELEMETRY], BMS_CAN_TXQ_DEPTH);
+}
+
+static void test_bus_load_budget(void)
+{
+    const uint32_t per_ms = (BMS_CAN_BITRATE_BPS / 1000U) * BMS_CAN_BUS_LOAD_PCT / 100U;
+    const uint32_t burst = per_ms * BMS_CAN_TXQ_BURST_MS;
+    uint32_t sent_before;
+    uint8_t round;
+
+    setup();
+    /* Offer far more than the budget at a single instant */
+    for (round = 0U; round < 3U; round++) {
+        queue_n(BMS_CAN_PRIO_CONTROL, 0x100U, (uint8_t)BMS_CAN_TXQ_DEPTH);
+        queue_n(BMS_CAN_PRIO_TELEMETRY, 0x130U, (uint8_t)BMS_CAN_TXQ_DEPTH);
+        queue_n(BMS_CAN_PRIO_BULK, 0x131U, (uint8_t)BMS_CAN_TXQ_DEPTH);
+        bms_can_txq_kick();
+    }
+    bms_can_txq_get_stats(&s_st);
+    TEST_ASSERT(s_st.bits_sent <= burst);
+    TEST_ASSERT(s_st.bits_sent + bms_can_frame_bits(8U) > burst);
+    TEST_ASSERT(s_st.budget_deferrals > 0U);
+    TEST_ASSERT(bms_can_txq_pending(BMS_CAN_PRIO_BULK) > 0U);
+    /* Once the bucket is short, higher classes go first */
+    TEST_ASSERT(s_st.sent[BMS_CAN_PRIO_CONTROL] > s_st.sent[BMS_CAN_PRIO_BULK]);
+
+    /* Alarms bypass an exhausted bucket */
+    queue_n(BMS_CAN_PRIO_ALARM, CAN_ID_DTDT_ALARM, 1U);
+    bms_can_txq_kick();
+    bms_can_txq_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.sent[BMS_CAN_PRIO_ALARM], 1U);
+
+    /* 100 ms later the refill lets the backlog continue, within rate */
+    sent_before = s_st.bits_sent;
+    mock_advance_tick(100U);
+    bms_can_txq_kick();
+    bms_can_txq_get_stats(&s_st);
+    TEST_ASSERT(s_st.bits_sent > sent_before);
+    TEST_ASSERT(s_st.bits_sent - sent_before <= per_ms * 100U);
+}
+
+static void test_latency_stats(void)
+{
+    setup();
+    mock_set_can_mailboxes(1U);
+    queue_n(BMS_CAN_PRIO_CONTROL, 0x100U, 3U);
+    bms_can_txq_kick();
+    mock_advance_tick(5U);
+    mock_can_tx_complete();
+    bms_can_txq_isr();
+    mock_advance_tick(5U);
+    mock_can_tx_complete();
+    bms_can_txq_isr();
+
+    bms_can_txq_get_stats(&s_st);
+    TEST_ASSERT_EQ(s_st.sent[BMS_CAN_PRIO_CONTROL], 3U);
+    TEST_ASSERT_EQ(s_st.latency_max_ms[BMS_CAN_PRIO_CONTROL], 10U);
+    TEST_ASSERT_EQ(s_st.latency_sum_ms[BMS_CAN_PRIO_CONTROL], 15U);
+}
+
+static void test_periodic_goes_through_queue(void)
+{
+    bms_pack_data_t pack;
+    const bms_can_frame_t *f;
+
+    mock_reset_all();
+    bms_can_init();
+    memset(&pack, 0, sizeof(pack));
+    pack.fault_latched = true;
+
+    bms_can_tx_periodic(&pack);
+    TEST_ASSERT_EQ(mock_get_can_tx_count(), 0U);          /* enqueue only */
+    TEST_ASSERT_EQ(bms_can_txq_pending(BMS_CAN_PRIO_ALARM), 1U);
+
+    bms_can_txq_kick();
+    TEST_ASSERT_EQ(mock_get_can_tx_count(), 6U);
+    f = mock_get_can_tx(0U);
+    TEST_ASSERT(f != NULL && f->id == CAN_ID_ARRAY_STATUS);
+    f = mock_get_can_tx(5U);
+    TEST_ASSERT(f != NULL && f->id == CAN_ID_CELL_BROADCAST);
+}
+
+void test_can_txq_suite(void)
+{
+    test_frame_bits();
+    test_alarm_preempts_bulk();
+    test_ring_full_drops_counted();
+    test_bus_load_budget();
+    test_latency_stats();
+    test_periodic_goes_through_queue();
+}
@@ -0,0 +1,254 @@
+/**
+ * test_canfd.c — CAN FD cell streaming: encoding, priority, refresh bound
+ */
+
+#include "bms_canfd.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern uint8_t mock_get_canfd_tx_count(void);
+extern const bms_canfd_frame_t *mock_get_canfd_tx(uint8_t idx);
+extern void mock_clear_canfd_tx(void);
+
+static bms_pack_data_t s_pack;
+static uint16_t s_ems_mv[BMS_SE_PER_PACK];     /* decoder-side mirror */
+static uint32_t s_lcg = 12345U;
+
+static uint16_t rnd(uint16_t range)
+{
+    s_lcg = s_lcg * 1103515245U + 12345U;
+    return (uint16_t)((s_lcg >> 16U) % range);
+}
+
+static bool valid_fd_len(uint8_t len)
+{
+    return len <= 8U || len == 12U || len == 16U || len == 20U || len == 24U ||
+           len == 32U || len == 48U || len == 64U;
+}
+
+static void setup(void)
+{
+    uint16_t i;
+    mock_reset_all();
+    bms_canfd_init();
+    memset(&s_pack, 0, sizeof(s_pack));
+    memset(s_ems_mv, 0, sizeof(s_ems_mv));
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        s_pack.cell_mv[i] = (uint16_t)(3650U + rnd(20U));
+    }
+}
+
+/* One TX period; decode everything into the mirror, mark delivered cells */
+static uint8_t run_call(bool *seen, bool full_only)
+{
+    uint8_t n, f;
+    uint16_t scratch[BMS_SE_PER_PACK];
+    uint16_t i;
+
+    mock_clear_canfd_tx();
+    n = bms_canfd_tx_cells(&s_pack);
+    TEST_ASSERT_EQ(mock_get_canfd_tx_count(), n);
+    for (f = 0U; f < n; f++) {
+        const bms_canfd_frame_t *fr = mock_get_canfd_tx(f);
+        if (!valid_fd_len(fr->len)) { TEST_ASSERT(valid_fd_len(fr->len)); }
+        memset(scratch, 0xFF, sizeof(scratch));
+        if (bms_canfd_decode_cells(fr, scratch) < 0) {
+            TEST_ASSERT(false);
+            continue;
+        }
+        (void)bms_canfd_decode_cells(fr, s_ems_mv);
+        if (seen == NULL) { continue; }
+        if (full_only && fr->data[0] != BMS_CANFD_TYPE_FULL) { continue; }
+        for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+            if (scratch[i] != 0xFFFFU) { seen[i] = true; }
+        }
+    }
+    return n;
+}
+
+static void test_len_round(void)
+{
+    TEST_ASSERT_EQ(bms_canfd_len_round(7U), 7U);
+    TEST_ASSERT_EQ(bms_canfd_len_round(9U), 12U);
+    TEST_ASSERT_EQ(bms_canfd_len_round(25U), 32U);
+    TEST_ASSERT_EQ(bms_canfd_len_round(33U), 48U);
+    TEST_ASSERT_EQ(bms_canfd_len_round(64U), 64U);
+}
+
+static void test_full_roundtrip(void)
+{
+    bms_canfd_frame_t fr;
+    uint16_t out[BMS_SE_PER_PACK];
+    uint16_t start = 0U, n, frames = 0U;
+
+    setup();
+    memset(out, 0, sizeof(out));
+    while (start < BMS_SE_PER_PACK) {
+        n = bms_canfd_encode_full(s_pack.cell_mv, start, 0U, &fr);
+        TEST_ASSERT(n >= 1U);
+        TEST_ASSERT_EQ(bms_canfd_decode_cells(&fr, out), (int32_t)n);
+        start = (uint16_t)(start + n);
+        frames++;
+    }
+    TEST_ASSERT(memcmp(out, s_pack.cell_mv, sizeof(out)) == 0);
+    /* 20 mV spread → 1-byte deltas → ≥ 50 cells/frame */
+    TEST_ASSERT(frames <= 7U);
+
+    /* Worst case: full-scale swings every cell still round-trip */
+    for (n = 0U; n < BMS_SE_PER_PACK; n++) {
+        s_pack.cell_mv[n] = ((n & 1U) != 0U) ? 0xFFFFU : 0U;
+    }
+    memset(out, 0, sizeof(out));
+    start = 0U;
+    while (start < BMS_SE_PER_PACK) {
+        n = bms_canfd_encode_full(s_pack.cell_mv, start, 0U, &fr);
+        TEST_ASSERT(n >= 1U);
+        (void)bms_canfd_decode_cells(&fr, out);
+        start = (uint16_t)(start + n);
+    }
+    TEST_ASSERT(memcmp(out, s_pack.cell_mv, sizeof(out)) == 0);
+}
+
+static void test_decode_rejects_malformed(void)
+{
+    bms_canfd_frame_t fr;
+    uint16_t out[BMS_SE_PER_PACK];
+
+    setup();
+    (void)bms_canfd_encode_full(s_pack.cell_mv, 300U, 0U, &fr);
+    fr.data[2] = 0x02U;                      /* start 0x012C → 0x022C */
+    TEST_ASSERT_EQ(bms_canfd_decode_cells(&fr, out), -1);
+
+    (void)bms_canfd_encode_full(s_pack.cell_mv, 0U, 0U, &fr);
+    fr.data[0] = 0x7FU;
+    TEST_ASSERT_EQ(bms_canfd_decode_cells(&fr, out), -1);
+
+    (void)bms_canfd_encode_full(s_pack.cell_mv, 0U, 0U, &fr);
+    fr.len = 8U;                             /* truncated delta stream */
+    TEST_ASSERT_EQ(bms_canfd_decode_cells(&fr, out), -1);
+}
+
+static void test_full_refresh_bound(void)
+{
+    bool seen[BMS_SE_PER_PACK];
+    uint8_t win, call;
+    uint16_t i;
+    bool all = true;
+
+    setup();
+    /* Every window of 300 ms / 100 ms calls must sweep every cell */
+    for (win = 0U; win < 4U; win++) {
+        memset(seen, 0, sizeof(seen));
+        for (call = 0U; call < (uint8_t)(BMS_CANFD_FULL_REFRESH_MS / BMS_CAN_TX_PERIOD_MS); call++) {
+            (void)run_call(seen, true);
+        }
+        for (i = 0U; i < BMS_SE_PER_PACK; i++) { if (!seen[i]) { all = false; } }
+    }
+    TEST_ASSERT(all);
+    TEST_ASSERT(memcmp(s_ems_mv, s_pack.cell_mv, sizeof(s_ems_mv)) == 0);
+}
+
+static void test_priority_changed_and_extremes(void)
+{
+    const bms_canfd_frame_t *fr;
+    uint16_t out[BMS_SE_PER_PACK];
+    uint8_t call;
+
+    setup();
+    for (call = 0U; call < 3U; call++) { (void)run_call(NULL, false); }
+
+    s_pack.cell_mv[200] = (uint16_t)(s_pack.cell_mv[200] + 50U);  /* big mover */
+    s_pack.cell_mv[10]  = (uint16_t)(s_pack.cell_mv[10] - 6U);    /* small mover */
+    s_pack.cell_mv[77]  = 4100U;                                   /* new max */
+    s_pack.cell_mv[150] = 3100U;                                   /* new min */
+
+    mock_clear_canfd_tx();
+    (void)bms_canfd_tx_cells(&s_pack);
+    fr = mock_get_canfd_tx(0U);
+    TEST_ASSERT(fr != NULL);
+    if (fr == NULL) { return; }
+    TEST_ASSERT_EQ(fr->id, CAN_ID_CELL_FD_PRIO);
+    TEST_ASSERT_EQ(fr->data[0], BMS_CANFD_TYPE_PRIORITY);
+
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT(bms_canfd_decode_cells(fr, out) >= 4);
+    TEST_ASSERT_EQ(out[77], 4100U);
+    TEST_ASSERT_EQ(out[150], 3100U);
+    TEST_ASSERT_EQ(out[200], s_pack.cell_mv[200]);
+    TEST_ASSERT_EQ(out[10], s_pack.cell_mv[10]);
+}
+
+static void test_priority_drops_lowest_when_full(void)
+{
+    bms_canfd_frame_t fr;
+    uint16_t idx[BMS_CANFD_PRIO_MAX];
+    uint16_t out[BMS_SE_PER_PACK];
+    uint8_t k, n;
+
+    setup();
+    /* Full-scale values spread across the pack: 5 bytes per entry */
+    for (k = 0U; k < BMS_CANFD_PRIO_MAX; k++) {
+        idx[k] = (uint16_t)(k * 12U);
+        s_pack.cell_mv[idx[k]] = ((k & 1U) != 0U) ? 0xFFFFU : 1U;
+    }
+    n = bms_canfd_encode_priority(s_pack.cell_mv, idx, BMS_CANFD_PRIO_MAX, 0U, &fr);
+    TEST_ASSERT(n > 0U && n < BMS_CANFD_PRIO_MAX);
+    TEST_ASSERT(fr.len <= BMS_CANFD_MAX_LEN);
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_EQ(bms_canfd_decode_cells(&fr, out), (int32_t)n);
+    /* Kept entries are the highest-priority prefix */
+    for (k = 0U; k < n; k++) { TEST_ASSERT_EQ(out[idx[k]], s_pack.cell_mv[idx[k]]); }
+}
+
+static void test_every_cell_visible_500ms(void)
+{
+    bool seen[BMS_SE_PER_PACK];
+    uint8_t age[BMS_SE_PER_PACK];
+    uint8_t call, worst = 0U;
+    uint16_t i;
+
+    setup();
+    memset(age, 0, sizeof(age));
+    /* Noisy pack: every cell changes every call */
+    for (call = 0U; call < 30U; call++) {
+        for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+            s_pack.cell_mv[i] = (uint16_t)(3600U + rnd(200U));
+        }
+        memset(seen, 0, sizeof(seen));
+        (void)run_call(seen, false);
+        for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+            age[i] = seen[i] ? 0U : (uint8_t)(age[i] + 1U);
+            if (call >= 5U && age[i] > worst) { worst = age[i]; }
+        }
+    }
+    /* Staleness in calls: < 500 ms / 100 ms */
+    TEST_ASSERT(worst < (uint8_t)(500U / BMS_CAN_TX_PERIOD_MS));
+}
+
+void test_canfd_suite(void)
+{
+    test_len_round();
+    test_full_roundtrip();
+    test_decode_rejects_malformed();
+    test_full_refresh_bound();
+    test_priority_changed_and_extremes();
+    test_priority_drops_lowest_when_full();
+    test_every_cell_visible_500ms();
+}
@@ -0,0 +1,150 @@
+/**
+ * test_cell_scan.c — SIMD threshold scans vs. portable reference
+ */
+
+#include "bms_cell_scan.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+static uint16_t s_cells[BMS_SE_PER_PACK];
+static uint32_t s_lcg = 12345U;
+
+static uint16_t lcg_next(void)
+{
+    s_lcg = s_lcg * 1103515245U + 12345U;
+    return (uint16_t)(s_lcg >> 16);
+}
+
+/* Compare both kernels against the reference for one threshold */
+static bool scan_matches_ref(uint16_t thresh)
+{
+    bms_cell_mask_t a, b;
+    bool ra, rb, ok = true;
+
+    ra = bms_cell_scan_ge(s_cells, thresh, &a);
+    rb = bms_cell_scan_ge_ref(s_cells, thresh, &b);
+    ok = ok && (ra == rb) && (memcmp(&a, &b, sizeof(a)) == 0);
+
+    ra = bms_cell_scan_le_nz(s_cells, thresh, &a);
+    rb = bms_cell_scan_le_nz_ref(s_cells, thresh, &b);
+    ok = ok && (ra == rb) && (memcmp(&a, &b, sizeof(a)) == 0);
+    return ok;
+}
+
+/* ── Test: nominal pack flags nothing ──────────────────────────────── */
+static void test_nominal_no_flags(void)
+{
+    bms_cell_mask_t m;
+    uint16_t i;
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { s_cells[i] = 3675U; }
+
+    TEST_ASSERT(!bms_cell_scan_ge(s_cells, BMS_SE_OV_FAULT_MV, &m));
+    TEST_ASSERT_EQ(m.mask[0], 0U);
+    TEST_ASSERT(!bms_cell_scan_le_nz(s_cells, BMS_SE_UV_FAULT_MV, &m));
+    TEST_ASSERT_EQ(m.mask[BMS_NUM_MODULES - 1U], 0U);
+}
+
+/* ── Test: every cell index maps to its own module bit ─────────────── */
+static void test_index_mapping(void)
+{
+    bms_cell_mask_t m;
+    uint16_t i;
+    bool ok = true;
+
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        uint8_t mod = (uint8_t)(i / BMS_SE_PER_MODULE);
+        uint8_t k;
+        memset(s_cells, 0, sizeof(s_cells));
+        s_cells[i] = BMS_SE_OV_FAULT_MV;
+        if (!bms_cell_scan_ge(s_cells, BMS_SE_OV_FAULT_MV, &m)) { ok = false; }
+        for (k = 0U; k < BMS_NUM_MODULES; k++) {
+            uint16_t want = (k == mod) ?
+                (uint16_t)(1U << (i % BMS_SE_PER_MODULE)) : 0U;
+            if (m.mask[k] != want) { ok = false; }
+        }
+    }
+    TEST_ASSERT(ok);
+}
+
+/* ── Test: zero (unread) cells never flag as UV ────────────────────── */
+static void test_zero_ignored_for_uv(void)
+{
+    bms_cell_mask_t m;
+    memset(s_cells, 0, sizeof(s_cells));
+    TEST_ASSERT(!bms_cell_scan_le_nz(s_cells, BMS_SE_UV_FAULT_MV, &m));
+
+    s_cells[300] = 1U;
+    TEST_ASSERT(bms_cell_scan_le_nz(s_cells, BMS_SE_UV_FAULT_MV, &m));
+    TEST_ASSERT_EQ(m.mask[300U / BMS_SE_PER_MODULE],
+                   1U << (300U % BMS_SE_PER_MODULE));
+}
+
+/* ── Test: threshold boundaries and extreme values ─────────────────── */
+static void test_boundaries_match_ref(void)
+{
+    static const uint16_t vals[] = {
+        0U, 1U, 2699U, 2700U, 2701U, 2999U, 3000U, 3001U,
+        4224U, 4225U, 4226U, 0x7FFFU, 0x8000U, 0x8001U, 0xFFFEU, 0xFFFFU
+    };
+    static const uint16_t thresh[] = {
+        0U, 1U, BMS_HW_UV_MV, BMS_SE_UV_FAULT_MV, BMS_SE_OV_FAULT_MV,
+        0x7FFFU, 0x8000U, 0xFFFFU
+    };
+    uint16_t i;
+    uint8_t t;
+    bool ok = true;
+
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        s_cells[i] = vals[i % (sizeof(vals) / sizeof(vals[0]))];
+    }
+    for (t = 0U; t < sizeof(thresh) / sizeof(thresh[0]); t++) {
+        if (!scan_matches_ref(thresh[t])) { ok = false; }
+    }
+    TEST_ASSERT(ok);
+}
+
+/* ── Test: randomised packs match reference ────────────────────────── */
+static void test_random_match_ref(void)
+{
+    uint16_t iter, i;
+    bool ok = true;
+
+    for (iter = 0U; iter < 500U; iter++) {
+        for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+            /* Mostly near the operating window, occasionally anywhere */
+            uint16_t r = lcg_next();
+            s_cells[i] = ((r & 7U) == 0U) ? lcg_next()
+                                          : (uint16_t)(2600U + (r % 1800U));
+        }
+        if (!scan_matches_ref((uint16_t)(2600U + (lcg_next() % 1800U)))) {
+            ok = false;
+        }
+    }
+    TEST_ASSERT(ok);
+}
+
+void test_cell_scan_suite(void)
+{
+    fprintf(stderr, "  kernel: %s\n", bms_cell_scan_impl());
+    test_nominal_no_flags();
+    test_index_mapping();
+    test_zero_ignored_for_uv();
+    test_boundaries_match_ref();
+    test_random_match_ref();
+}
@@ -0,0 +1,216 @@
+/**
+ * test_cell_soc.c — Per-SE SoC: spread at rest, one module per update,
+ *                   relative capacity under load, SoC-based balancing
+ */
+
+#include "bms_cell_soc.h"
+#include "bms_soc.h"
+#include "bms_balance.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern uint16_t mock_get_balance_mask(uint8_t module_id);
+
+#define SE(m, c)  ((uint16_t)((m) * BMS_SE_PER_MODULE + (c)))
+
+static bms_pack_data_t s_pack;
+static double s_truth[BMS_SE_PER_PACK];     /* hundredths */
+static double s_cap[BMS_SE_PER_PACK];       /* relative capacity */
+static uint32_t s_tick;
+
+static int32_t absdiff(int32_t a, int32_t b) { return (a > b) ? a - b : b - a; }
+
+/* Cell OCV in mV: the first mV the firmware's table maps to that SoC,
+ * tabulated once per hundredth */
+static uint16_t s_ocv_mv[10001];
+
+static void ocv_table_init(void)
+{
+    uint16_t mv = 3000U;
+    uint16_t soc;
+
+    for (soc = 0U; soc <= 10000U; soc++) {
+        while (mv < 4190U && bms_soc_from_ocv(mv) < soc) { mv++; }
+        s_ocv_mv[soc] = mv;
+    }
+}
+
+static uint16_t ocv_mv_at(double soc_hundredths)
+{
+    long soc = lround(soc_hundredths);
+
+    if (soc < 0) { soc = 0; }
+    if (soc > 10000) { soc = 10000; }
+    return s_ocv_mv[soc];
+}
+
+static void setup(uint16_t soc_hundredths)
+{
+    uint16_t i;
+
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.soc_hundredths = soc_hundredths;
+    bms_soc_init(soc_hundredths);
+    bms_cell_soc_init();
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        s_truth[i] = (double)soc_hundredths;
+        s_cap[i] = 1.0;
+    }
+    s_tick = 0U;
+}
+
+/* The monitor's cadence: one module read per 10 ms tick, the pack EKF
+ * predicted every tick and corrected on each completed sweep */
+static void run(uint32_t ms, int32_t i_ma)
+{
+    uint32_t t;
+    uint16_t i;
+
+    s_pack.pack_current_ma = i_ma;
+    for (t = 0U; t < ms; t += BMS_MONITOR_PERIOD_MS) {
+        uint8_t mod = (uint8_t)(s_tick % BMS_NUM_MODULES);
+        double dq = (double)i_ma * BMS_MONITOR_PERIOD_MS /
+                    ((double)BMS_NOMINAL_CAPACITY_MAH * 360.0);
+        uint8_t c;
+
+        for (i = 0U; i < BMS_SE_PER_PACK; i++) { s_truth[i] += dq / s_cap[i]; }
+        for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+            uint16_t se = SE(mod, c);
+            s_pack.cell_mv[se] = (uint16_t)lround((double)ocv_mv_at(s_truth[se]) +
+                                 (double)BMS_SOC_EKF_R0_UOHM * i_ma / 1e6);
+        }
+        bms_cell_soc_update_module(&s_pack, mod);
+        bms_soc_update(&s_pack, BMS_MONITOR_PERIOD_MS);
+        if (mod == BMS_NUM_MODULES - 1U) {
+            uint32_t sum = 0U;
+            for (i = 0U; i < BMS_SE_PER_PACK; i++) { sum += s_pack.cell_mv[i]; }
+            s_pack.avg_cell_mv = (uint16_t)((sum + BMS_SE_PER_PACK / 2U) / BMS_SE_PER_PACK);
+            bms_soc_correct(&s_pack);
+        }
+        bms_cell_soc_publish(&s_pack);
+        s_pack.uptime_ms += BMS_MONITOR_PERIOD_MS;
+        s_tick++;
+    }
+}
+
+/* ── Test: two outliers at rest are found, published once converged ── */
+static void test_spread_at_rest(void)
+{
+    fprintf(stderr, "  test_spread_at_rest\n");
+    setup(5000U);
+    s_truth[SE(3, 5)] = 5400.0;
+    s_truth[SE(7, 0)] = 4600.0;
+
+    run(10U * BMS_MONITOR_PERIOD_MS, 0);                    /* half a sweep */
+    TEST_ASSERT(!s_pack.cell_soc_valid);
+    TEST_ASSERT_EQ(s_pack.cell_soc_max_hundredths, s_pack.soc_hundredths);
+
+    run(2000U, 0);
+    TEST_ASSERT(s_pack.cell_soc_valid);
+    TEST_ASSERT(absdiff(s_pack.cell_soc_max_hundredths, 5400) <= 60);
+    TEST_ASSERT(absdiff(s_pack.cell_soc_min_hundredths, 4600) <= 60);
+    TEST_ASSERT(absdiff(bms_cell_soc_get(SE(3, 5), s_pack.soc_hundredths), 5400) <= 60);
+    TEST_ASSERT(absdiff(bms_cell_soc_get(SE(3, 4), s_pack.soc_hundredths), 5000) <= 60);
+}
+
+/* ── Test: an update touches the scanned module and nothing else ───── */
+static void test_one_module_per_update(void)
+{
+    uint16_t i;
+    bool others_untouched = true;
+
+    fprintf(stderr, "  test_one_module_per_update\n");
+    setup(5000U);
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { s_pack.cell_mv[i] = ocv_mv_at(5000.0); }
+    s_pack.cell_mv[SE(4, 9)] = ocv_mv_at(5500.0);
+    s_pack.cell_mv[SE(5, 9)] = ocv_mv_at(5500.0);          /* not scanned */
+
+    bms_cell_soc_update_module(&s_pack, 4U);
+    TEST_ASSERT(bms_cell_soc_get(SE(4, 9), 5000U) > 5200U);
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        if (i / BMS_SE_PER_MODULE != 4U && bms_cell_soc_get(i, 5000U) != 5000U) {
+            others_untouched = false;
+        }
+    }
+    TEST_ASSERT(others_untouched);
+
+    /* A cell reading 0 mV is not a full read: the module is left alone */
+    s_pack.cell_mv[SE(5, 0)] = 0U;
+    bms_cell_soc_update_module(&s_pack, 5U);
+    TEST_ASSERT_EQ(bms_cell_soc_get(SE(5, 9), 5000U), 5000U);
+}
+
+/* ── Test: a 90 % cell is found from its drift under a steady load ──── */
+static void test_capacity_under_load(void)
+{
+    uint16_t weak = SE(2, 3);
+    int32_t cap;
+
+    fprintf(stderr, "  test_capacity_under_load\n");
+    setup(9000U);
+    s_cap[weak] = 0.90;
+    run(2000U, 0);
+    run(3000000U, -100000);                                 /* 50 min at 100 A */
+
+    cap = (int32_t)bms_cell_soc_get_capacity_q14(weak);
+    fprintf(stderr, "    weak SE: capacity %.3f, SoC %u vs truth %.0f (0.01 %%)\n",
+            (double)cap / 16384.0, (unsigned)s_pack.cell_soc_min_hundredths,
+            s_truth[weak]);
+    TEST_ASSERT(absdiff(cap, 14746) <= 490);                /* 0.90 ± 0.03 */
+    TEST_ASSERT(absdiff((int32_t)bms_cell_soc_get_capacity_q14(SE(2, 4)), 16384) <= 330);
+    TEST_ASSERT(absdiff((int32_t)bms_cell_soc_get_capacity_q14(SE(15, 0)), 16384) <= 330);
+    TEST_ASSERT(s_pack.cell_soc_valid);
+    TEST_ASSERT(absdiff(s_pack.cell_soc_min_hundredths, (int32_t)lround(s_truth[weak])) <= 150);
+}
+
+/* ── Test: once valid, balancing bleeds every SE above the emptiest ── */
+static void test_balance_by_soc(void)
+{
+    bms_balance_state_t bal;
+    uint16_t full = (uint16_t)((1U << BMS_SE_PER_MODULE) - 1U);
+
+    fprintf(stderr, "  test_balance_by_soc\n");
+    setup(5000U);
+    s_truth[SE(7, 0)] = 4600.0;
+    run(2000U, 0);
+    TEST_ASSERT(s_pack.cell_soc_valid);
+
+    s_pack.mode = BMS_MODE_READY;
+    bms_balance_init(&bal);
+    bms_balance_run(&bal, &s_pack);
+    TEST_ASSERT(bal.active);
+    TEST_ASSERT_EQ(mock_get_balance_mask(7U), (uint16_t)(full & ~1U));
+    TEST_ASSERT_EQ(mock_get_balance_mask(0U), full);
+
+    /* All within the threshold: balancing stops */
+    s_pack.cell_soc_min_hundredths = s_pack.cell_soc_max_hundredths;
+    bms_balance_run(&bal, &s_pack);
+    TEST_ASSERT(!bal.active);
+    TEST_ASSERT_EQ(mock_get_balance_mask(7U), 0U);
+}
+
+void test_cell_soc_suite(void)
+{
+    ocv_table_init();
+    test_spread_at_rest();
+    test_one_module_per_update();
+    test_capacity_under_load();
+    test_balance_by_soc();
+}
@@ -0,0 +1,203 @@
+/**
+ * test_current_limit.c — Division-free derating vs. divide-based reference
+ */
+
+#include "bms_current_limit.h"
+#include "bms_derating_tables.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+/* The pre-table implementation: linear scan + 32-bit divide */
+static int32_t interp_ref(const bms_derate_curve_t *c, int32_t x)
+{
+    uint8_t i;
+    if (x <= c->x[0]) { return c->y[0]; }
+    if (x >= c->x[c->n - 1U]) { return c->y[c->n - 1U]; }
+    for (i = 1U; i < c->n; i++) {
+        if (x <= c->x[i]) {
+            int32_t dx = c->x[i] - c->x[i - 1U];
+            int32_t dy = c->y[i] - c->y[i - 1U];
+            return c->y[i - 1U] + (dy * (x - c->x[i - 1U])) / dx;
+        }
+    }
+    return c->y[c->n - 1U];
+}
+
+static int32_t cc_to_ma_ref(int32_t centi_c)
+{
+    return (int32_t)(((int64_t)centi_c * BMS_NOMINAL_CAPACITY_MAH) / 100);
+}
+
+static int32_t min32(int32_t a, int32_t b) { return (a < b) ? a : b; }
+
+static bms_pack_data_t s_pack;
+
+static void setup_nominal(void)
+{
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.max_temp_deci_c = 250;
+    s_pack.soc_hundredths = 5000U;
+    s_pack.max_cell_mv = 3675U;
+    s_pack.min_cell_mv = 3675U;
+    bms_current_limit_invalidate();
+}
+
+static bool limits_match_ref(void)
+{
+    int32_t chg, dchg, rc, rd;
+    uint16_t soc_c = s_pack.cell_soc_valid ? s_pack.cell_soc_max_hundredths : s_pack.soc_hundredths;
+    uint16_t soc_d = s_pack.cell_soc_valid ? s_pack.cell_soc_min_hundredths : s_pack.soc_hundredths;
+    bms_current_limit_compute(&s_pack, &chg, &dchg);
+    rc = min32(cc_to_ma_ref(interp_ref(&k_derate_temp_chg, s_pack.max_temp_deci_c)),
+         min32(cc_to_ma_ref(interp_ref(&k_derate_soc_chg, soc_c)),
+               cc_to_ma_ref(interp_ref(&k_derate_sev_chg, s_pack.max_cell_mv))));
+    rd = min32(cc_to_ma_ref(interp_ref(&k_derate_temp_dchg, s_pack.max_temp_deci_c)),
+         min32(cc_to_ma_ref(interp_ref(&k_derate_soc_dchg, soc_d)),
+               cc_to_ma_ref(interp_ref(&k_derate_sev_dchg, s_pack.min_cell_mv))));
+    if (rc < 0) { rc = 0; }
+    if (rd < 0) { rd = 0; }
+    return (chg == rc) && (dchg == rd);
+}
+
+/* ── Test: nominal point (25 °C, 50 %, 3.675 V) ────────────────────── */
+static void test_nominal_limits(void)
+{
+    int32_t chg, dchg;
+    setup_nominal();
+    bms_current_limit_compute(&s_pack, &chg, &dchg);
+    TEST_ASSERT_EQ(chg, 300 * (BMS_NOMINAL_CAPACITY_MAH / 100));
+    TEST_ASSERT_EQ(dchg, 500 * (BMS_NOMINAL_CAPACITY_MAH / 100));
+}
+
+/* ── Test: every curve, every integer input, bit-exact ─────────────── */
+static void test_curves_exact(void)
+{
+    static const bms_derate_curve_t *const curves[] = {
+        &k_derate_temp_chg, &k_derate_temp_dchg, &k_derate_soc_chg,
+        &k_derate_soc_dchg, &k_derate_sev_chg, &k_derate_sev_dchg
+    };
+    uint8_t c;
+    bool ok = true;
+
+    for (c = 0U; c < sizeof(curves) / sizeof(curves[0]); c++) {
+        int32_t lo = curves[c]->x[0] - 100;
+        int32_t hi = curves[c]->x[curves[c]->n - 1U] + 100;
+        int32_t x;
+        for (x = lo; x <= hi; x++) {
+            setup_nominal();
+            if (c < 2U) { s_pack.max_temp_deci_c = (int16_t)x; }
+            else if (c < 4U) { s_pack.soc_hundredths = (uint16_t)((x < 0) ? 0 : x); }
+            else { s_pack.max_cell_mv = s_pack.min_cell_mv = (uint16_t)x; }
+            if (!limits_match_ref()) { ok = false; }
+        }
+    }
+    TEST_ASSERT(ok);
+}
+
+/* ── Test: sub-zero → 0 A charge (P0-05) ───────────────────────────── */
+static void test_subzero_zero_charge(void)
+{
+    int32_t chg, dchg;
+    setup_nominal();
+    s_pack.max_temp_deci_c = -50;
+    bms_current_limit_compute(&s_pack, &chg, &dchg);
+    TEST_ASSERT_EQ(chg, 0);
+    TEST_ASSERT(dchg > 0);
+}
+
+/* ── Test: cache tracks every key field ────────────────────────────── */
+static void test_cache_keys(void)
+{
+    int32_t c0, d0, c1, d1;
+    setup_nominal();
+    bms_current_limit_compute(&s_pack, &c0, &d0);
+    bms_current_limit_compute(&s_pack, &c1, &d1);
+    TEST_ASSERT_EQ(c0, c1);
+    TEST_ASSERT_EQ(d0, d1);
+
+    s_pack.max_temp_deci_c = 500;           /* 50 °C: charge derated */
+    TEST_ASSERT(limits_match_ref());
+    s_pack.soc_hundredths = 9800U;          /* near full: charge derated */
+    TEST_ASSERT(limits_match_ref());
+    s_pack.max_cell_mv = 4150U;             /* SEV charge ramp */
+    TEST_ASSERT(limits_match_ref());
+    s_pack.min_cell_mv = 3350U;             /* SEV discharge ramp */
+    TEST_ASSERT(limits_match_ref());
+    bms_current_limit_compute(&s_pack, &c1, &d1);
+    TEST_ASSERT(c1 < c0);
+    TEST_ASSERT(d1 < d0);
+}
+
+/* ── Test: per-SE extremes drive SoC derating once valid ──────────── */
+static void test_cell_soc_extremes(void)
+{
+    int32_t c0, d0, c1, d1;
+    setup_nominal();
+    s_pack.cell_soc_max_hundredths = 9500U;  /* one SE nearly full */
+    s_pack.cell_soc_min_hundredths = 700U;   /* one nearly empty */
+    bms_current_limit_compute(&s_pack, &c0, &d0);
+    TEST_ASSERT(limits_match_ref());         /* not valid yet: pack SoC */
+
+    s_pack.cell_soc_valid = true;
+    bms_current_limit_compute(&s_pack, &c1, &d1);
+    TEST_ASSERT(limits_match_ref());
+    TEST_ASSERT_EQ(c1, 100 * (BMS_NOMINAL_CAPACITY_MAH / 100));
+    TEST_ASSERT(c1 < c0);
+    TEST_ASSERT(d1 < d0);
+
+    s_pack.cell_soc_max_hundredths = 9000U;  /* each extreme is a cache key */
+    TEST_ASSERT(limits_match_ref());
+    s_pack.cell_soc_min_hundredths = 1500U;
+    TEST_ASSERT(limits_match_ref());
+}
+
+/* ── Test: 110 % learned capacity never exceeds the hardware rating ─ */
+static void test_capacity_clamped(void)
+{
+    int32_t chg, dchg, max_c = 0, max_d = 0;
+    int16_t t;
+    uint16_t soc;
+
+    setup_nominal();
+    bms_current_limit_set_capacity(BMS_NOMINAL_CAPACITY_MAH * BMS_SOH_CAP_MAX_PCT / 100U);
+    for (t = -200; t <= 600; t += 25) {
+        for (soc = 0U; soc <= 10000U; soc += 250U) {
+            s_pack.max_temp_deci_c = t;
+            s_pack.soc_hundredths = soc;
+            bms_current_limit_compute(&s_pack, &chg, &dchg);
+            if (chg > max_c) { max_c = chg; }
+            if (dchg > max_d) { max_d = dchg; }
+        }
+    }
+    TEST_ASSERT(max_c <= BMS_MAX_CHARGE_MA);
+    TEST_ASSERT_EQ(max_d, BMS_MAX_DISCHARGE_MA);       /* 5C peak, clamped */
+    bms_current_limit_set_capacity(BMS_NOMINAL_CAPACITY_MAH);
+    setup_nominal();
+    TEST_ASSERT(limits_match_ref());
+}
+
+void test_current_limit_suite(void)
+{
+    test_nominal_limits();
+    test_curves_exact();
+    test_subzero_zero_charge();
+    test_cache_keys();
+    test_cell_soc_extremes();
+    test_capacity_clamped();
+}
@@ -0,0 +1,248 @@
+/**
+ * test_history.c — operating history: hourly aggregates, roll-up, years in flash
+ */
+
+#include "bms_history.h"
+#include "bms_nvm.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern void mock_advance_tick(uint32_t ms);
+extern uint32_t mock_get_nvm_violations(void);
+extern void mock_nvm_power_cut_after(uint32_t n);
+
+#define POWER_ON   0xFFFFFFFFU
+#define STEP_MS    600000U          /* 10 min per sample keeps years fast */
+#define STEPS_H    (BMS_HIST_HOUR_MS / STEP_MS)
+#define PAGES_SEC  (BMS_NVM_SECTOR_SIZE / BMS_NVM_PAGE_SIZE)
+
+static bms_pack_data_t   s_pack;
+static bms_history_rec_t s_recs[200];
+static uint8_t           s_img[BMS_NVM_SECTOR_SIZE];
+
+static void set_temps(int16_t t)
+{
+    uint8_t mod, i;
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (i = 0U; i < BMS_TEMPS_PER_MODULE; i++) { s_pack.modules[mod].temp_deci_c[i] = t; }
+    }
+    s_pack.min_temp_deci_c = t;
+    s_pack.max_temp_deci_c = t;
+}
+
+static void setup(void)
+{
+    mock_reset_all();
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.min_cell_mv = 3280U;
+    s_pack.max_cell_mv = 3320U;
+    s_pack.avg_cell_mv = 3300U;
+    s_pack.mode = BMS_MODE_CONNECTED;
+    set_temps(250);
+    bms_history_init();
+    bms_history_sample(&s_pack);            /* t = 0 */
+}
+
+/* One operating hour: charge 30 min, discharge 30 min, day/night swing */
+static void run_hours(uint32_t hours)
+{
+    uint32_t h, s;
+
+    for (h = 0U; h < hours; h++) {
+        for (s = 0U; s < STEPS_H; s++) {
+            s_pack.pack_current_ma = (s < STEPS_H / 2U) ? 100000 : -50000;
+            s_pack.avg_cell_mv = (uint16_t)(3300U + (h % 24U) * 5U + s);
+            s_pack.min_cell_mv = (uint16_t)(s_pack.avg_cell_mv - 20U);
+            s_pack.max_cell_mv = (uint16_t)(s_pack.avg_cell_mv + 20U);
+            set_temps((int16_t)(200 + (int16_t)(h % 24U) * 3));
+            mock_advance_tick(STEP_MS);
+            bms_history_sample(&s_pack);
+            bms_nvm_release();
+            (void)bms_history_flush();
+        }
+    }
+}
+
+static void test_hour_aggregates(void)
+{
+    bms_history_rec_t r;
+
+    fprintf(stderr, "  test_hour_aggregates\n");
+    setup();
+    TEST_ASSERT_EQ(bms_history_count(HIST_HOUR), 0U);
+    run_hours(1U);
+
+    TEST_ASSERT_EQ(bms_history_count(HIST_HOUR), 1U);
+    TEST_ASSERT(bms_history_get(HIST_HOUR, 0U, &r));
+    TEST_ASSERT_EQ(r.hour, 0U);
+    TEST_ASSERT_EQ(r.hours, 1U);
+    TEST_ASSERT_EQ(r.charge_mah, 50000U);           /* 100 A × 30 min */
+    TEST_ASSERT_EQ(r.discharge_mah, 25000U);        /*  50 A × 30 min */
+    TEST_ASSERT_EQ(r.peak_charge_ma, 100000U);
+    TEST_ASSERT_EQ(r.peak_discharge_ma, 50000U);
+    TEST_ASSERT_EQ(r.cell_min_mv, 3280U);           /* t = 0 sample */
+    TEST_ASSERT_EQ(r.cell_max_mv, 3325U);
+    TEST_ASSERT_EQ(r.temp_min_deci_c, 200);
+    TEST_ASSERT_EQ(r.temp_max_deci_c, 250);
+    TEST_ASSERT_EQ(r.mode_s[BMS_MODE_CONNECTED], 3600U);
+    TEST_ASSERT_EQ(r.mode_s[BMS_MODE_READY], 0U);
+    TEST_ASSERT(!bms_history_get(HIST_HOUR, 1U, &r));
+    TEST_ASSERT(!bms_history_flush());              /* nothing pending */
+}
+
+static void test_rollup_and_remount(void)
+{
+    bms_history_rec_t r;
+    bms_history_stats_t st;
+
+    fprintf(stderr, "  test_rollup_and_remount\n");
+    setup();
+    run_hours(3U * 24U + 5U);
+    TEST_ASSERT_EQ(bms_history_count(HIST_HOUR), 77U);
+    TEST_ASSERT_EQ(bms_history_count(HIST_DAY), 3U);
+    TEST_ASSERT_EQ(bms_history_count(HIST_MONTH), 0U);
+    TEST_ASSERT(bms_history_get(HIST_DAY, 0U, &r));
+    TEST_ASSERT_EQ(r.hour, 71U);
+    TEST_ASSERT_EQ(r.hours, 24U);
+    TEST_ASSERT_EQ(r.charge_mah, 24U * 50000U);
+    TEST_ASSERT_EQ(r.mode_s[BMS_MODE_CONNECTED], 24U * 3600U);
+    TEST_ASSERT_EQ(r.temp_max_deci_c, 200 + 23 * 3);
+
+    /* Reboot mid-day: the hour counter resumes and the partial day is
+     * rebuilt from the hour tier, so day 4 still covers 24 hours */
+    bms_history_init();
+    bms_history_get_stats(&st);
+    TEST_ASSERT_EQ(st.torn, 0U);
+    bms_history_sample(&s_pack);
+    run_hours(19U);
+    TEST_ASSERT_EQ(bms_history_count(HIST_DAY), 4U);
+    TEST_ASSERT(bms_history_get(HIST_DAY, 0U, &r));
+    TEST_ASSERT_EQ(r.hour, 95U);
+    TEST_ASSERT_EQ(r.hours, 24U);
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+}
+
+/* ── Test: a roll-up whose rotation waits for the erase budget ─────── */
+static void test_rollup_waits_for_erase(void)
+{
+    bms_history_rec_t r;
+    uint32_t s;
+
+    fprintf(stderr, "  test_rollup_waits_for_erase\n");
+    setup();
+    run_hours(23U);
+    for (s = 0U; s < STEPS_H; s++) {
+        mock_advance_tick(STEP_MS);
+        bms_history_sample(&s_pack);
+    }
+
+    /* Hour 23 lands in the open hour sector; the first day record needs
+     * an erase another flusher already took this release */
+    bms_nvm_release();
+    TEST_ASSERT(bms_nvm_erase_sector(BMS_NVM_BBOX_BASE));
+    TEST_ASSERT(bms_history_flush());
+    TEST_ASSERT_EQ(bms_history_count(HIST_HOUR), 24U);
+    TEST_ASSERT_EQ(bms_history_count(HIST_DAY), 0U);
+
+    bms_nvm_release();
+    TEST_ASSERT(bms_history_flush());
+    TEST_ASSERT_EQ(bms_history_count(HIST_DAY), 1U);
+    TEST_ASSERT(bms_history_get(HIST_DAY, 0U, &r));
+    TEST_ASSERT_EQ(r.hour, 23U);
+    TEST_ASSERT_EQ(r.hours, 24U);
+    TEST_ASSERT(!bms_history_flush());
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+}
+
+static void test_years_fit(void)
+{
+    bms_history_rec_t r;
+    bms_history_stats_t st;
+    uint16_t page, n, months;
+
+    fprintf(stderr, "  test_years_fit\n");
+    setup();
+    run_hours(3U * 365U * 24U);                     /* three years */
+
+    months = bms_history_count(HIST_MONTH);
+    TEST_ASSERT_EQ(months, (3U * 365U * 24U) / (24U * BMS_HIST_MONTH_DAYS));
+    TEST_ASSERT(bms_history_get(HIST_MONTH, (uint16_t)(months - 1U), &r));
+    TEST_ASSERT_EQ(r.hour, 719U);                   /* first month survives */
+    TEST_ASSERT_EQ(r.hours, 720U);
+    TEST_ASSERT_EQ(r.charge_mah, 720U * 50000U);
+
+    /* Finer tiers keep at least a sector's worth of recent history */
+    TEST_ASSERT(bms_history_count(HIST_DAY) >= 100U);
+    TEST_ASSERT(bms_history_count(HIST_HOUR) >= 100U);
+    TEST_ASSERT(bms_history_get(HIST_HOUR, 0U, &r));
+    TEST_ASSERT_EQ(r.hour, 3U * 365U * 24U - 1U);
+
+    bms_history_get_stats(&st);
+    TEST_ASSERT(st.rotations > 2U * BMS_HIST_TIERS);
+    TEST_ASSERT_EQ(st.verify_fail, 0U);
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+
+    /* Diagnostic page reads reassemble into a decodable sector */
+    for (page = 0U; page < PAGES_SEC; page++) {
+        TEST_ASSERT(bms_history_read_page((uint16_t)(2U * BMS_NVM_HIST_SECTORS_PER_TIER * PAGES_SEC + page),
+                                          &s_img[page * BMS_NVM_PAGE_SIZE]));
+    }
+    n = bms_history_decode_sector(s_img, sizeof(s_img), s_recs, 200U);
+    TEST_ASSERT_EQ(n, months);                      /* month tier, sector 0 */
+    TEST_ASSERT_EQ(s_recs[0].hour, 719U);
+}
+
+static void test_torn_append(void)
+{
+    bms_history_rec_t r;
+    bms_history_stats_t st;
+
+    fprintf(stderr, "  test_torn_append\n");
+    setup();
+    run_hours(10U);
+
+    /* Power dies inside the 11th hour's record */
+    mock_nvm_power_cut_after(6U);
+    run_hours(1U);
+    mock_nvm_power_cut_after(POWER_ON);
+
+    bms_history_init();
+    bms_history_get_stats(&st);
+    TEST_ASSERT_EQ(st.torn, 1U);
+    TEST_ASSERT_EQ(bms_history_count(HIST_HOUR), 10U);
+
+    /* Next hour goes to a fresh sector, never over the partial bytes */
+    bms_history_sample(&s_pack);
+    run_hours(1U);
+    TEST_ASSERT_EQ(bms_history_count(HIST_HOUR), 11U);
+    TEST_ASSERT(bms_history_get(HIST_HOUR, 0U, &r));
+    TEST_ASSERT_EQ(r.hour, 10U);
+    TEST_ASSERT_EQ(r.charge_mah, 50000U);
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+}
+
+void test_history_suite(void)
+{
+    test_hour_aggregates();
+    test_rollup_and_remount();
+    test_rollup_waits_for_erase();
+    test_years_fit();
+    test_torn_append();
+}
@@ -0,0 +1,110 @@
+/**
+ * test_main.c — Minimal test runner (Street Smart Edition)
+ *
+ * No external test framework — just assert-style macros.
+ * Returns 0 on all pass, 1 on any failure.
+ *
+ * SIMULATION DISCLAIMER: Firmware architecture demo, not production code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ── Test infrastructure ───────────────────────────────────────────── */
+
+int g_tests_run = 0;
+int g_tests_passed = 0;
+int g_tests_failed = 0;
+
+/* ── External test suites ──────────────────────────────────────────── */
+extern void test_cell_scan_suite(void);
+extern void test_protection_suite(void);
+extern void test_current_limit_suite(void);
+extern void test_thermal_suite(void);
+extern void test_monitor_suite(void);
+extern void test_canfd_suite(void);
+extern void test_can_txq_suite(void);
+extern void test_can_rx_suite(void);
+extern void test_can_diag_suite(void);
+extern void test_can_msgs_suite(void);
+extern void test_can_auth_suite(void);
+extern void test_nvm_suite(void);
+extern void test_blackbox_suite(void);
+extern void test_history_suite(void);
+extern void test_pack_share_suite(void);
+extern void test_trace_suite(void);
+extern void test_sched_suite(void);
+extern void test_power_suite(void);
+extern void test_soc_suite(void);
+extern void test_cell_soc_suite(void);
+extern void test_soh_suite(void);
+extern void test_sop_suite(void);
+
+/* ── Main ──────────────────────────────────────────────────────────── */
+
+int main(void)
+{
+    fprintf(stderr, "\n=== Corvus Orca ESS BMS Firmware Tests (Street Smart) ===\n\n");
+
+    fprintf(stderr, "[SUITE] Cell Threshold Scan\n");
+    test_cell_scan_suite();
+
+    fprintf(stderr, "\n[SUITE] Protection\n");
+    test_protection_suite();
+
+    fprintf(stderr, "\n[SUITE] Current Limits\n");
+    test_current_limit_suite();
+
+    fprintf(stderr, "\n[SUITE] Thermal dT/dt\n");
+    test_thermal_suite();
+
+    fprintf(stderr, "\n[SUITE] Monitor Acquisition\n");
+    test_monitor_suite();
+
+    fprintf(stderr, "\n[SUITE] CAN FD Cell Stream\n");
+    test_canfd_suite();
+
+    fprintf(stderr, "\n[SUITE] CAN TX Queue\n");
+    test_can_txq_suite();
+
+    fprintf(stderr, "\n[SUITE] CAN RX Ring\n");
+    test_can_rx_suite();
+
+    fprintf(stderr, "\n[SUITE] CAN ISO-TP Diagnostics\n");
+    test_can_diag_suite();
+
+    fprintf(stderr, "\n[SUITE] CAN Message Table\n");
+    test_can_msgs_suite();
+
+    fprintf(stderr, "\n[SUITE] CAN Authentication\n");
+    test_can_auth_suite();
+
+    fprintf(stderr, "\n[SUITE] NVM Fault Journal\n");
+    test_nvm_suite();
+
+    fprintf(stderr, "\n[SUITE] Black-Box Recorder\n");
+    test_blackbox_suite();
+    fprintf(stderr, "\n[SUITE] Operating History\n");
+    test_history_suite();
+    fprintf(stderr, "\n[SUITE] Pack Share\n");
+    test_pack_share_suite();
+    fprintf(stderr, "\n[SUITE] Runtime Trace\n");
+    test_trace_suite();
+    fprintf(stderr, "\n[SUITE] Bare-Metal Scheduler\n");
+    test_sched_suite();
+    fprintf(stderr, "\n[SUITE] Tickless POWER_SAVE\n");
+    test_power_suite();
+    fprintf(stderr, "\n[SUITE] SoC Estimator\n");
+    test_soc_suite();
+    fprintf(stderr, "\n[SUITE] Per-SE SoC\n");
+    test_cell_soc_suite();
+    fprintf(stderr, "\n[SUITE] State of Health\n");
+    test_soh_suite();
+    fprintf(stderr, "\n[SUITE] State of Power\n");
+    test_sop_suite();
+
+    fprintf(stderr, "\n=== Results: %d/%d passed, %d failed ===\n\n",
+            g_tests_passed, g_tests_run, g_tests_failed);
+
+    return (g_tests_failed > 0) ? 1 : 0;
+}
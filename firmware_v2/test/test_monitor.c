@@ -0,0 +1,253 @@
+/**
+ * test_monitor.c — Acquisition tests (full scan vs. DASTATUS5 summary mode)
+ */
+
+#include "bms_monitor.h"
+#include "bms_bq76952.h"
+#include "bms_cell_soc.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern void mock_set_i2c_fail(int32_t result);
+extern void mock_set_i2c_fail_module(uint8_t module);
+extern void mock_set_i2c_reg16(uint8_t module, uint8_t reg, uint16_t val);
+extern void mock_set_afe_summary(uint8_t module, uint16_t max_mv, uint16_t min_mv,
+                                 uint32_t stack_mv, int16_t max_dc, int16_t min_dc,
+                                 int16_t avg_dc);
+extern uint32_t mock_get_i2c_txn_count(void);
+extern void mock_clear_i2c_txn_count(void);
+
+/* Per-cell reads in one detail pass: 14 cells + stack + 3 TS + 5 safety */
+#define DETAIL_TXNS  (BMS_SE_PER_MODULE + 1U + BMS_TEMPS_PER_MODULE + 5U)
+
+static bms_pack_data_t s_pack;
+
+/* Detail registers + summary for a uniform healthy module */
+static void set_module_nominal(uint8_t mod, uint16_t mv, int16_t deci_c)
+{
+    uint8_t c;
+    for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+        mock_set_i2c_reg16(mod, BQ76952_CELL_REG(c), mv);
+    }
+    mock_set_i2c_reg16(mod, BQ76952_REG_STACK_VOLTAGE,
+                       (uint16_t)((uint32_t)mv * BMS_SE_PER_MODULE / 10U));
+    mock_set_i2c_reg16(mod, BQ76952_REG_TS1_TEMP, (uint16_t)(deci_c + 2731));
+    mock_set_i2c_reg16(mod, BQ76952_REG_TS2_TEMP, (uint16_t)(deci_c + 2731));
+    mock_set_i2c_reg16(mod, BQ76952_REG_TS3_TEMP, (uint16_t)(deci_c + 2731));
+    mock_set_afe_summary(mod, mv, mv, (uint32_t)mv * BMS_SE_PER_MODULE,
+                         deci_c, deci_c, deci_c);
+}
+
+static void setup(bms_acq_mode_t mode)
+{
+    uint8_t mod;
+    mock_reset_all();
+    memset(&s_pack, 0, sizeof(s_pack));
+    bms_monitor_init(&s_pack);
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        set_module_nominal(mod, 3675U, 250);
+    }
+    bms_monitor_set_mode(mode);
+}
+
+/* ── Test: init takes the configured mode; full scan still sweeps ─── */
+static void test_default_mode(void)
+{
+    uint8_t k;
+    setup(BMS_ACQ_FULL_SCAN);
+    bms_monitor_init(&s_pack);
+    TEST_ASSERT_EQ(bms_monitor_get_mode(),
+                   (BMS_ACQ_SUMMARY_ENABLED != 0U) ? BMS_ACQ_SUMMARY : BMS_ACQ_FULL_SCAN);
+
+    bms_monitor_set_mode(BMS_ACQ_FULL_SCAN);
+
+    mock_clear_i2c_txn_count();
+    for (k = 0U; k < BMS_NUM_MODULES; k++) { bms_monitor_run(&s_pack); }
+    TEST_ASSERT(bms_monitor_scan_complete());
+    TEST_ASSERT_EQ(s_pack.max_cell_mv, 3675U);
+    /* One refresh of pack extremes costs a full 22-module sweep */
+    TEST_ASSERT_EQ(mock_get_i2c_txn_count(), (uint32_t)BMS_NUM_MODULES * DETAIL_TXNS);
+}
+
+/* ── Test: summaries drive pack extremes after one pipelined tick ──── */
+static void test_summary_extremes(void)
+{
+    setup(BMS_ACQ_SUMMARY);
+    mock_set_afe_summary(4U, 3801U, 3650U, 3700U * BMS_SE_PER_MODULE, 330, 240, 280);
+    mock_set_afe_summary(17U, 3700U, 3402U, 3600U * BMS_SE_PER_MODULE, 260, 180, 220);
+
+    bms_monitor_run(&s_pack);          /* request only */
+    bms_monitor_run(&s_pack);          /* fetch + aggregate */
+
+    TEST_ASSERT_EQ(s_pack.max_cell_mv, 3801U);
+    TEST_ASSERT_EQ(s_pack.min_cell_mv, 3402U);
+    TEST_ASSERT_EQ(s_pack.max_temp_deci_c, 330);
+    TEST_ASSERT_EQ(s_pack.min_temp_deci_c, 180);
+    TEST_ASSERT_EQ(s_pack.pack_voltage_mv,
+                   (uint32_t)BMS_SE_PER_MODULE * (3675U * 20U + 3700U + 3600U));
+    TEST_ASSERT_EQ(s_pack.faults.imbalance, 1U);
+}
+
+/* ── Test: steady-state bus cost per tick ──────────────────────────── */
+static void test_summary_txn_budget(void)
+{
+    uint32_t t0, t1, t2;
+    setup(BMS_ACQ_SUMMARY);
+    bms_monitor_run(&s_pack);
+
+    t0 = mock_get_i2c_txn_count();
+    bms_monitor_run(&s_pack);
+    t1 = mock_get_i2c_txn_count();
+    bms_monitor_run(&s_pack);
+    t2 = mock_get_i2c_txn_count();
+
+    /* Fetch + request per module every tick; detail every other tick */
+    TEST_ASSERT_EQ((t1 - t0) + (t2 - t1),
+                   4U * BMS_NUM_MODULES + DETAIL_TXNS);
+}
+
+/* ── Test: summary crossing a warning pulls that module's detail now ─ */
+static void test_on_demand_detail(void)
+{
+    uint16_t idx = 15U * BMS_SE_PER_MODULE + 3U;
+    setup(BMS_ACQ_SUMMARY);
+    bms_monitor_run(&s_pack);
+    bms_monitor_run(&s_pack);
+    TEST_ASSERT(s_pack.cell_mv[idx] == 0U);   /* rotation hasn't reached 15 */
+
+    mock_set_i2c_reg16(15U, BQ76952_CELL_REG(3U), BMS_SE_OV_WARN_MV + 5U);
+    mock_set_afe_summary(15U, BMS_SE_OV_WARN_MV + 5U, 3675U,
+                         3675U * BMS_SE_PER_MODULE, 250, 250, 250);
+    bms_monitor_run(&s_pack);
+    TEST_ASSERT_EQ(s_pack.cell_mv[idx], BMS_SE_OV_WARN_MV + 5U);
+    TEST_ASSERT_EQ(s_pack.max_cell_mv, BMS_SE_OV_WARN_MV + 5U);
+
+    /* Explicit request works the same way */
+    mock_set_i2c_reg16(20U, BQ76952_CELL_REG(0U), 3690U);
+    bms_monitor_request_detail(20U);
+    bms_monitor_run(&s_pack);
+    bms_monitor_run(&s_pack);
+    TEST_ASSERT_EQ(s_pack.cell_mv[20U * BMS_SE_PER_MODULE], 3690U);
+}
+
+/* ── Test: a module parked past a warning can't starve the rotation ── */
+static void test_rotation_not_starved(void)
+{
+    uint32_t k;
+    uint8_t mod;
+    setup(BMS_ACQ_SUMMARY);
+    mock_set_afe_summary(15U, BMS_SE_OV_WARN_MV + 5U, 3675U,
+                         3675U * BMS_SE_PER_MODULE, 250, 250, 250);
+
+    /* Module 15 asks for detail every tick; the rotation still completes
+     * its sweeps and converges every module's per-SE SoC */
+    for (k = 0U; k < 1U + 3U * BMS_ACQ_DETAIL_EVERY_TICKS * BMS_NUM_MODULES; k++) {
+        bms_monitor_run(&s_pack);
+    }
+    TEST_ASSERT_EQ(bms_monitor_get_scan_count(), 3U);
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        TEST_ASSERT_EQ(s_pack.cell_mv[mod * BMS_SE_PER_MODULE], 3675U);
+    }
+    TEST_ASSERT(s_pack.cell_soc_valid);
+}
+
+/* ── Test: a POWER_SAVE slow scan rotates through what dt spans ───── */
+static void test_summary_slow_scan(void)
+{
+    uint8_t mod;
+    setup(BMS_ACQ_SUMMARY);
+    bms_monitor_run_dt(&s_pack, BMS_PS_SCAN_PERIOD_MS);
+    TEST_ASSERT(bms_monitor_scan_complete());
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        TEST_ASSERT_EQ(s_pack.cell_mv[mod * BMS_SE_PER_MODULE], 3675U);
+    }
+}
+
+/* ── Test: faulted thermistor does not leak in through chip min temp ─ */
+static void test_faulted_sensor_excluded(void)
+{
+    setup(BMS_ACQ_SUMMARY);
+    s_pack.modules[9].sensor_fault[1].faulted = true;
+    s_pack.modules[9].temp_deci_c[0] = 250;
+    s_pack.modules[9].temp_deci_c[2] = 250;
+    /* Open thermistor reads -40 °C on the AFE */
+    mock_set_afe_summary(9U, 3675U, 3675U, 3675U * BMS_SE_PER_MODULE, 250, -400, 100);
+    bms_monitor_run(&s_pack);
+    bms_monitor_run(&s_pack);
+    TEST_ASSERT_EQ(s_pack.min_temp_deci_c, 250);
+}
+
+/* ── Test: a missing summary never pulls the pack voltage low ──────── */
+static void test_summary_missing_module(void)
+{
+    const uint32_t full = (uint32_t)BMS_SE_PER_PACK * 3675U;
+
+    /* Dropped after a good summary: its last stack voltage stands in */
+    setup(BMS_ACQ_SUMMARY);
+    bms_monitor_run(&s_pack);
+    bms_monitor_run(&s_pack);
+    TEST_ASSERT_EQ(s_pack.pack_voltage_mv, full);
+    mock_set_i2c_fail_module(6U);
+    bms_monitor_run(&s_pack);
+    bms_monitor_run(&s_pack);
+    TEST_ASSERT_EQ(s_pack.pack_voltage_mv, full);
+    TEST_ASSERT_EQ(s_pack.avg_cell_mv, 3675U);
+
+    /* Never answered: scaled from the 21 modules that did */
+    setup(BMS_ACQ_SUMMARY);
+    mock_set_i2c_fail_module(6U);
+    mock_set_afe_summary(3U, 3700U, 3700U, 3700U * BMS_SE_PER_MODULE, 250, 250, 250);
+    bms_monitor_run(&s_pack);
+    bms_monitor_run(&s_pack);
+    TEST_ASSERT_EQ(s_pack.avg_cell_mv,
+                   (3675U * 20U + 3700U) / (BMS_NUM_MODULES - 1U));
+    TEST_ASSERT_EQ(s_pack.pack_voltage_mv,
+                   (uint32_t)BMS_SE_PER_MODULE * (3675U * 20U + 3700U) *
+                   BMS_NUM_MODULES / (BMS_NUM_MODULES - 1U));
+    mock_set_i2c_fail_module(0xFFU);
+}
+
+/* ── Test: summary fetch failures latch comm_loss (P0-02) ──────────── */
+static void test_summary_comm_loss(void)
+{
+    uint8_t k;
+    setup(BMS_ACQ_SUMMARY);
+    bms_monitor_run(&s_pack);
+    mock_set_i2c_fail(-1);
+    for (k = 0U; k < BMS_I2C_FAULT_CONSEC_COUNT; k++) { bms_monitor_run(&s_pack); }
+    mock_set_i2c_fail(0);
+    TEST_ASSERT_EQ(s_pack.faults.comm_loss, 1U);
+    TEST_ASSERT(s_pack.fault_latched);
+}
+
+void test_monitor_suite(void)
+{
+    test_default_mode();
+    test_summary_extremes();
+    test_summary_txn_budget();
+    test_on_demand_detail();
+    test_rotation_not_starved();
+    test_summary_slow_scan();
+    test_faulted_sensor_excluded();
+    test_summary_missing_module();
+    test_summary_comm_loss();
+    bms_monitor_set_mode(BMS_ACQ_FULL_SCAN);
+}
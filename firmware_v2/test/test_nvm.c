@@ -0,0 +1,377 @@
+/**
+ * test_nvm.c — NVM fault journal: batching, wear rotation, power loss
+ */
+
+#include "bms_nvm.h"
+#include "bms_nvm_queue.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern uint32_t mock_get_nvm_erase_count(uint8_t sector);
+extern uint32_t mock_get_nvm_program_ops(void);
+extern uint32_t mock_get_nvm_violations(void);
+extern void mock_nvm_power_cut_after(uint32_t n);
+extern void mock_nvm_erase_busy_polls(uint32_t n);
+
+#define POWER_ON     0xFFFFFFFFU
+#define FAULT_REC    (12U + 8U)     /* one-event FAULTS record */
+
+static bms_nvm_ctx_t s_ctx;
+static bms_nvm_ctx_t s_boot;        /* "after reboot" view of the same flash */
+
+/* One event, committed in its own NVM task release */
+static void log_one(uint32_t ts)
+{
+    bms_nvm_release();
+    bms_nvm_log_fault(&s_ctx, ts, NVM_FAULT_OV, (uint8_t)(ts & 0xFFU), (uint16_t)ts);
+    (void)bms_nvm_commit(&s_ctx);
+}
+
+static void test_blank_mount_and_reload(void)
+{
+    bms_nvm_fault_event_t ev;
+
+    fprintf(stderr, "  test_blank_mount_and_reload\n");
+    mock_reset_all();
+    bms_nvm_init(&s_ctx);
+    TEST_ASSERT_EQ(s_ctx.fault_count, 0U);
+    TEST_ASSERT(bms_nvm_commit(&s_ctx));             /* nothing staged */
+    TEST_ASSERT_EQ(mock_get_nvm_program_ops(), 0U);
+
+    bms_nvm_log_fault(&s_ctx, 1000U, NVM_FAULT_OT, 0xFFU, 650U);
+    TEST_ASSERT(bms_nvm_commit(&s_ctx));
+    TEST_ASSERT_EQ(mock_get_nvm_erase_count(0U), 1U);
+    TEST_ASSERT_EQ(s_ctx.stats.events, 1U);
+
+    s_ctx.persistent.soc_hundredths = 8123U;
+    s_ctx.persistent.total_charge_mah = 123456U;
+    bms_nvm_save_persistent(&s_ctx);
+    bms_nvm_log_fault(&s_ctx, 2000U, NVM_FAULT_UV, 7U, 2800U);
+    TEST_ASSERT(bms_nvm_commit(&s_ctx));
+
+    bms_nvm_init(&s_boot);
+    TEST_ASSERT_EQ(s_boot.fault_count, 2U);
+    TEST_ASSERT(bms_nvm_get_fault(&s_boot, 0U, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, 2000U);
+    TEST_ASSERT_EQ(ev.cell_index, 7U);
+    TEST_ASSERT_EQ(ev.value, 2800U);
+    TEST_ASSERT_EQ(s_boot.persistent.soc_hundredths, 8123U);
+    TEST_ASSERT_EQ(s_boot.persistent.total_charge_mah, 123456U);
+    TEST_ASSERT_EQ(s_boot.seq, s_ctx.seq);
+    TEST_ASSERT_EQ(s_boot.offset, s_ctx.offset);
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+}
+
+static void test_burst_is_one_commit(void)
+{
+    uint32_t ops, commits;
+    uint8_t i;
+
+    fprintf(stderr, "  test_burst_is_one_commit\n");
+    mock_reset_all();
+    bms_nvm_init(&s_ctx);
+    log_one(1U);
+
+    ops = mock_get_nvm_program_ops();
+    commits = s_ctx.stats.commits;
+    for (i = 0U; i < 8U; i++) {
+        bms_nvm_log_fault(&s_ctx, 100U + i, NVM_FAULT_UV, i, 2700U);
+    }
+    TEST_ASSERT_EQ(mock_get_nvm_program_ops(), ops);   /* staged, not written */
+    TEST_ASSERT(bms_nvm_commit(&s_ctx));
+    TEST_ASSERT_EQ(s_ctx.stats.commits, commits + 1U);
+    /* 76-byte record: at most one page boundary → ≤ 2 programs (was 48) */
+    TEST_ASSERT(mock_get_nvm_program_ops() - ops <= 2U);
+
+    /* A full staging buffer commits by itself */
+    ops = s_ctx.stats.commits;
+    for (i = 0U; i < BMS_NVM_COMMIT_MAX_EVENTS; i++) {
+        bms_nvm_log_fault(&s_ctx, 200U + i, NVM_FAULT_OT, i, 600U);
+    }
+    TEST_ASSERT_EQ(s_ctx.stats.commits, ops + 1U);
+    TEST_ASSERT_EQ(s_ctx.pending_count, 0U);
+
+    bms_nvm_init(&s_boot);
+    TEST_ASSERT_EQ(s_boot.fault_count, 1U + 8U + BMS_NVM_COMMIT_MAX_EVENTS);
+}
+
+static void test_wear_rotation(void)
+{
+    static bms_nvm_fault_log_t log;
+    bms_nvm_fault_event_t ev;
+    uint32_t i, lo = 0xFFFFFFFFU, hi = 0U, erases = 0U;
+    uint8_t s;
+
+    fprintf(stderr, "  test_wear_rotation\n");
+    mock_reset_all();
+    bms_nvm_init(&s_ctx);
+    s_ctx.persistent.runtime_hours = 4242U;
+    bms_nvm_save_persistent(&s_ctx);
+
+    for (i = 1U; i <= 5000U; i++) { log_one(i); }
+
+    for (s = 0U; s < BMS_NVM_JOURNAL_SECTORS; s++) {
+        uint32_t e = mock_get_nvm_erase_count(s);
+        if (e < lo) { lo = e; }
+        if (e > hi) { hi = e; }
+        erases += e;
+    }
+    TEST_ASSERT(lo >= 4U);
+    TEST_ASSERT(hi - lo <= 1U);                       /* even wear */
+    TEST_ASSERT_EQ(erases, s_ctx.stats.rotations);   /* one erase per sector change */
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+    TEST_ASSERT_EQ(s_ctx.stats.events, 5000U);
+
+    /* Newest 64 survive rotation and reboot, in order */
+    bms_nvm_init(&s_boot);
+    TEST_ASSERT_EQ(s_boot.fault_count, BMS_NVM_FAULT_LOG_SIZE);
+    TEST_ASSERT(bms_nvm_get_fault(&s_boot, 0U, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, 5000U);
+    TEST_ASSERT(bms_nvm_get_fault(&s_boot, BMS_NVM_FAULT_LOG_SIZE - 1U, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, 5000U - BMS_NVM_FAULT_LOG_SIZE + 1U);
+    TEST_ASSERT_EQ(s_boot.persistent.runtime_hours, 4242U);
+
+    /* Published copy for other tasks matches, newest first */
+    bms_nvm_fault_log_read(&s_boot, &log);
+    TEST_ASSERT_EQ(log.count, BMS_NVM_FAULT_LOG_SIZE);
+    TEST_ASSERT_EQ(log.ev[0].timestamp_ms, 5000U);
+    TEST_ASSERT_EQ(log.ev[BMS_NVM_FAULT_LOG_SIZE - 1U].timestamp_ms,
+                   5000U - BMS_NVM_FAULT_LOG_SIZE + 1U);
+    bms_nvm_fault_log_read(&s_ctx, &log);
+    TEST_ASSERT_EQ(log.ev[0].timestamp_ms, 5000U);
+}
+
+static void test_torn_commit(void)
+{
+    bms_nvm_fault_event_t ev;
+    uint32_t i;
+
+    fprintf(stderr, "  test_torn_commit\n");
+    mock_reset_all();
+    bms_nvm_init(&s_ctx);
+    for (i = 1U; i <= 10U; i++) { log_one(i); }
+
+    /* Power fails 10 bytes into the 11th record */
+    mock_nvm_power_cut_after(10U);
+    log_one(11U);
+    mock_nvm_power_cut_after(POWER_ON);
+
+    bms_nvm_init(&s_ctx);
+    TEST_ASSERT_EQ(s_ctx.stats.torn, 1U);
+    TEST_ASSERT_EQ(s_ctx.fault_count, 10U);
+    TEST_ASSERT(bms_nvm_get_fault(&s_ctx, 0U, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, 10U);
+
+    /* Next commit goes to a fresh sector, never over the partial bytes */
+    log_one(12U);
+    TEST_ASSERT_EQ(s_ctx.stats.rotations, 1U);
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+    bms_nvm_init(&s_boot);
+    TEST_ASSERT_EQ(s_boot.stats.torn, 0U);
+    TEST_ASSERT_EQ(s_boot.fault_count, 11U);
+}
+
+static void test_torn_rotation_falls_back(void)
+{
+    bms_nvm_fault_event_t ev;
+    uint32_t ts = 0U;
+    uint8_t sector;
+
+    fprintf(stderr, "  test_torn_rotation_falls_back\n");
+    mock_reset_all();
+    bms_nvm_init(&s_ctx);
+    log_one(++ts);
+    sector = s_ctx.sector;
+    while (s_ctx.offset + FAULT_REC <= BMS_NVM_SECTOR_SIZE) { log_one(++ts); }
+    TEST_ASSERT_EQ(s_ctx.sector, sector);
+
+    /* Snapshot into the next sector is cut short */
+    mock_nvm_power_cut_after(100U);
+    log_one(ts + 1U);
+    mock_nvm_power_cut_after(POWER_ON);
+    TEST_ASSERT(s_ctx.sector != sector);
+
+    bms_nvm_init(&s_boot);
+    TEST_ASSERT_EQ(s_boot.sector, sector);
+    TEST_ASSERT_EQ(s_boot.fault_count, BMS_NVM_FAULT_LOG_SIZE);
+    TEST_ASSERT(bms_nvm_get_fault(&s_boot, 0U, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, ts);
+
+    /* Old sector is full, so the retry rotates again over the torn one */
+    bms_nvm_log_fault(&s_boot, ts + 2U, NVM_FAULT_OT, 0U, 0U);
+    TEST_ASSERT(bms_nvm_commit(&s_boot));
+    TEST_ASSERT(s_boot.sector != sector);
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+    bms_nvm_init(&s_ctx);
+    TEST_ASSERT(bms_nvm_get_fault(&s_ctx, 0U, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, ts + 2U);
+}
+
+/* ── Test: one erase per release, rotation deferred, never waited for ─ */
+static void test_erase_budget(void)
+{
+    bms_nvm_fault_event_t ev;
+    uint32_t ts = 0U, rotations;
+    uint8_t sector;
+    const uint8_t bbox = (uint8_t)BMS_NVM_JOURNAL_SECTORS;
+
+    fprintf(stderr, "  test_erase_budget\n");
+    mock_reset_all();
+    bms_nvm_init(&s_ctx);
+    log_one(++ts);
+    while (s_ctx.offset + FAULT_REC <= BMS_NVM_SECTOR_SIZE) { log_one(++ts); }
+    sector = s_ctx.sector;
+    rotations = s_ctx.stats.rotations;
+
+    /* Black box took this release's erase: the rotation waits, the event
+     * stays in RAM and the queue drain retries without new events */
+    bms_nvm_release();
+    TEST_ASSERT(bms_nvm_erase_sector(BMS_NVM_BBOX_BASE));
+    TEST_ASSERT(!bms_nvm_erase_sector(BMS_NVM_BBOX_BASE + BMS_NVM_SECTOR_SIZE));
+    bms_nvm_log_fault(&s_ctx, ++ts, NVM_FAULT_OV, 0U, 0U);
+    TEST_ASSERT(!bms_nvm_commit(&s_ctx));
+    TEST_ASSERT(s_ctx.rotate_due);
+    TEST_ASSERT_EQ(s_ctx.sector, sector);
+    TEST_ASSERT_EQ(s_ctx.stats.rotations, rotations);
+    TEST_ASSERT(bms_nvm_get_fault(&s_ctx, 0U, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, ts);
+
+    bms_nvm_release();
+    TEST_ASSERT_EQ(bms_nvm_queue_drain(&s_ctx), 0U);
+    TEST_ASSERT(!s_ctx.rotate_due);
+    TEST_ASSERT(s_ctx.sector != sector);
+    TEST_ASSERT_EQ(s_ctx.stats.rotations, rotations + 1U);
+    bms_nvm_init(&s_boot);
+    TEST_ASSERT(bms_nvm_get_fault(&s_boot, 0U, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, ts);
+
+    /* A slow erase spans releases; nothing else starts or touches it */
+    mock_nvm_erase_busy_polls(2U);
+    bms_nvm_release();
+    TEST_ASSERT(!bms_nvm_erase_sector(BMS_NVM_BBOX_BASE));
+    bms_nvm_release();
+    TEST_ASSERT(!bms_nvm_erase_sector(BMS_NVM_BBOX_BASE + BMS_NVM_SECTOR_SIZE));
+    bms_nvm_release();
+    TEST_ASSERT(bms_nvm_erase_sector(BMS_NVM_BBOX_BASE));
+    TEST_ASSERT_EQ(mock_get_nvm_erase_count(bbox), 2U);
+    TEST_ASSERT_EQ(mock_get_nvm_erase_count(bbox + 1U), 0U);
+    TEST_ASSERT_EQ(mock_get_nvm_violations(), 0U);
+}
+
+static void test_unmounted_is_ram_only(void)
+{
+    bms_nvm_fault_event_t ev;
+
+    fprintf(stderr, "  test_unmounted_is_ram_only\n");
+    mock_reset_all();
+    memset(&s_ctx, 0, sizeof(s_ctx));
+    bms_nvm_log_fault(&s_ctx, 5U, NVM_FAULT_GAS, 0xFFU, 1U);
+    TEST_ASSERT(!bms_nvm_commit(&s_ctx));
+    TEST_ASSERT(bms_nvm_get_fault(&s_ctx, 0U, &ev));
+    TEST_ASSERT_EQ(ev.fault_type, NVM_FAULT_GAS);
+    TEST_ASSERT_EQ(mock_get_nvm_program_ops(), 0U);
+    TEST_ASSERT_EQ(mock_get_nvm_erase_count(0U), 0U);
+}
+
+static void test_queue_overflow_accounting(void)
+{
+    bms_nvm_queue_stats_t st;
+    bms_nvm_fault_event_t ev;
+    uint8_t i;
+
+    fprintf(stderr, "  test_queue_overflow_accounting\n");
+    mock_reset_all();
+    bms_nvm_init(&s_ctx);
+    bms_nvm_queue_init();
+
+    for (i = 0U; i < BMS_NVM_QUEUE_DEPTH; i++) {
+        TEST_ASSERT(bms_nvm_queue_push(i, NVM_FAULT_UV, i, 2500U));
+    }
+    /* Full: the newest are dropped, the first of the burst kept */
+    TEST_ASSERT(!bms_nvm_queue_push(100U, NVM_FAULT_OT, 0U, 0U));
+    TEST_ASSERT(!bms_nvm_queue_push(101U, NVM_FAULT_OT, 0U, 0U));
+    TEST_ASSERT(!bms_nvm_queue_push(102U, NVM_FAULT_OT, 0U, 0U));
+    TEST_ASSERT_EQ(bms_nvm_queue_depth(), BMS_NVM_QUEUE_DEPTH);
+
+    TEST_ASSERT_EQ(bms_nvm_queue_drain(&s_ctx), BMS_NVM_QUEUE_DEPTH);
+    TEST_ASSERT_EQ(bms_nvm_queue_depth(), 0U);
+    TEST_ASSERT(bms_nvm_get_fault(&s_ctx, 0U, &ev));
+    TEST_ASSERT_EQ(ev.fault_type, NVM_FAULT_LOG_OVERFLOW);
+    TEST_ASSERT_EQ(ev.value, 3U);
+    TEST_ASSERT(bms_nvm_get_fault(&s_ctx, BMS_NVM_QUEUE_DEPTH, &ev));
+    TEST_ASSERT_EQ(ev.timestamp_ms, 0U);
+
+    bms_nvm_queue_get_stats(&st);
+    TEST_ASSERT_EQ(st.pushed, BMS_NVM_QUEUE_DEPTH);
+    TEST_ASSERT_EQ(st.dropped, 3U);
+    TEST_ASSERT_EQ(st.drained, BMS_NVM_QUEUE_DEPTH);
+    TEST_ASSERT_EQ(st.ring_hwm, BMS_NVM_QUEUE_DEPTH);
+
+    /* Marker written once, not on every later drain */
+    TEST_ASSERT(bms_nvm_queue_push(200U, NVM_FAULT_OV, 1U, 4300U));
+    TEST_ASSERT_EQ(bms_nvm_queue_drain(&s_ctx), 1U);
+    TEST_ASSERT(bms_nvm_get_fault(&s_ctx, 1U, &ev));
+    TEST_ASSERT_EQ(ev.fault_type, NVM_FAULT_LOG_OVERFLOW);
+
+    /* Everything survived to flash */
+    bms_nvm_init(&s_boot);
+    TEST_ASSERT_EQ(s_boot.fault_count, BMS_NVM_QUEUE_DEPTH + 2U);
+}
+
+static uint8_t s_wakes;
+static void count_wake(void) { s_wakes++; }
+
+static void test_queue_brownout_flush(void)
+{
+    fprintf(stderr, "  test_queue_brownout_flush\n");
+    mock_reset_all();
+    bms_nvm_init(&s_ctx);
+    bms_nvm_queue_init();
+    s_wakes = 0U;
+    bms_nvm_queue_set_wake_hook(count_wake);
+
+    (void)bms_nvm_queue_push(1U, NVM_FAULT_OC_DCHG, 0xFFU, 0U);
+    (void)bms_nvm_queue_push(2U, NVM_FAULT_WELD, 0xFFU, 0U);
+    TEST_ASSERT_EQ(mock_get_nvm_program_ops(), 0U);
+
+    bms_nvm_queue_brownout_isr();
+    TEST_ASSERT_EQ(s_wakes, 1U);
+    TEST_ASSERT(bms_nvm_queue_brownout_pending());
+    TEST_ASSERT_EQ(bms_nvm_queue_drain(&s_ctx), 2U);
+    TEST_ASSERT(!bms_nvm_queue_brownout_pending());
+    TEST_ASSERT_EQ(s_ctx.stats.commits, 1U);         /* both in one commit */
+
+    bms_nvm_init(&s_boot);
+    TEST_ASSERT_EQ(s_boot.fault_count, 2U);
+    bms_nvm_queue_set_wake_hook(NULL);
+}
+
+void test_nvm_suite(void)
+{
+    test_blank_mount_and_reload();
+    test_burst_is_one_commit();
+    test_wear_rotation();
+    test_torn_commit();
+    test_torn_rotation_falls_back();
+    test_erase_budget();
+    test_unmounted_is_ram_only();
+    test_queue_overflow_accounting();
+    test_queue_brownout_flush();
+}
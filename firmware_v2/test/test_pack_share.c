@@ -0,0 +1,200 @@
+/**
+ * test_pack_share.c — seqlock pack snapshot and lock-free fault commits
+ */
+
+#include "bms_pack_share.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+/* Monitor working copy and two reader tasks' copies */
+static bms_pack_data_t s_mon, s_a, s_b;
+
+static void setup(void)
+{
+    memset(&s_mon, 0, sizeof(s_mon));
+    s_mon.mode = BMS_MODE_READY;
+    s_mon.soc_hundredths = 5000U;
+    s_mon.min_cell_mv = 3300U;
+    bms_pack_share_init(&s_mon);
+}
+
+static void publish_cells(uint16_t mv)
+{
+    uint16_t i;
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) { s_mon.cell_mv[i] = mv; }
+    s_mon.min_cell_mv = mv;
+    s_mon.max_cell_mv = mv;
+    bms_pack_share_publish(&s_mon);
+}
+
+static bool cells_uniform(const bms_pack_data_t *p, uint16_t mv)
+{
+    uint16_t i;
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        if (p->cell_mv[i] != mv) { return false; }
+    }
+    return (p->min_cell_mv == mv) && (p->max_cell_mv == mv);
+}
+
+static void test_snapshot_roundtrip(void)
+{
+    bms_pack_ctl_t ctl;
+
+    fprintf(stderr, "  test_snapshot_roundtrip\n");
+    setup();
+    bms_pack_share_snapshot(&s_a, &ctl);
+    TEST_ASSERT_EQ(s_a.min_cell_mv, 3300U);
+    TEST_ASSERT_EQ(ctl.mode, BMS_MODE_READY);
+
+    publish_cells(3456U);
+    bms_pack_share_snapshot(&s_a, &ctl);
+    TEST_ASSERT(cells_uniform(&s_a, 3456U));
+    TEST_ASSERT_EQ(s_a.mode, BMS_MODE_READY);
+    TEST_ASSERT_EQ(s_a.soc_hundredths, 5000U);
+
+    /* The monitor's stale control fields never leak through a publish */
+    s_mon.mode = BMS_MODE_FAULT;
+    publish_cells(3457U);
+    bms_pack_share_snapshot(&s_a, &ctl);
+    TEST_ASSERT_EQ(s_a.mode, BMS_MODE_READY);
+}
+
+static void test_torn_read_detected(void)
+{
+    const bms_pack_data_t *p;
+    bms_pack_data_t copy;
+    uint32_t seq;
+
+    fprintf(stderr, "  test_torn_read_detected\n");
+    setup();
+    publish_cells(3300U);
+
+    /* Undisturbed read */
+    p = bms_pack_share_read_begin(&seq);
+    memcpy(&copy, p, sizeof(copy));
+    TEST_ASSERT(!bms_pack_share_read_retry(seq));
+    TEST_ASSERT(cells_uniform(&copy, 3300U));
+
+    /* Monitor preempts the reader and publishes once: the buffer being
+     * read is untouched, but the flip is still reported */
+    p = bms_pack_share_read_begin(&seq);
+    memcpy(copy.cell_mv, p->cell_mv, 100U);
+    publish_cells(3400U);
+    memcpy(&copy.cell_mv[50], &p->cell_mv[50], sizeof(copy.cell_mv) - 100U);
+    TEST_ASSERT_EQ(copy.cell_mv[BMS_SE_PER_PACK - 1U], 3300U);
+    TEST_ASSERT(bms_pack_share_read_retry(seq));
+
+    /* Two publishes: the writer is back on the reader's buffer — torn
+     * halves, and the retry catches it */
+    p = bms_pack_share_read_begin(&seq);
+    memcpy(copy.cell_mv, p->cell_mv, 100U);
+    publish_cells(3500U);
+    publish_cells(3600U);
+    memcpy(&copy.cell_mv[50], &p->cell_mv[50], sizeof(copy.cell_mv) - 100U);
+    TEST_ASSERT_EQ(copy.cell_mv[0], 3400U);
+    TEST_ASSERT_EQ(copy.cell_mv[BMS_SE_PER_PACK - 1U], 3600U);
+    TEST_ASSERT(bms_pack_share_read_retry(seq));
+
+    /* The retried read is whole */
+    p = bms_pack_share_read_begin(&seq);
+    memcpy(&copy, p, sizeof(copy));
+    TEST_ASSERT(!bms_pack_share_read_retry(seq));
+    TEST_ASSERT(cells_uniform(&copy, 3600U));
+}
+
+static void test_fault_bits_not_lost(void)
+{
+    bms_pack_ctl_t ca, cb, c;
+
+    fprintf(stderr, "  test_fault_bits_not_lost\n");
+    setup();
+
+    /* Both tasks start from the same snapshot and set different bits */
+    bms_pack_share_snapshot(&s_a, &ca);
+    bms_pack_share_snapshot(&s_b, &cb);
+    s_a.faults.cell_ov = 1U;
+    s_a.fault_latched = true;
+    s_b.faults.gas_alarm_low = 1U;
+    s_b.has_warning = true;
+    bms_pack_share_commit(&ca, &s_a);
+    bms_pack_share_commit(&cb, &s_b);
+
+    bms_pack_share_snapshot(&s_a, &c);
+    TEST_ASSERT_EQ(s_a.faults.cell_ov, 1U);
+    TEST_ASSERT_EQ(s_a.faults.gas_alarm_low, 1U);
+    TEST_ASSERT(s_a.fault_latched);
+    TEST_ASSERT(s_a.has_warning);
+
+    /* Clearing one bit leaves the other task's bit alone */
+    s_a.faults.gas_alarm_low = 0U;
+    bms_pack_share_commit(&c, &s_a);
+    bms_pack_share_snapshot(&s_b, &cb);
+    TEST_ASSERT_EQ(s_b.faults.gas_alarm_low, 0U);
+    TEST_ASSERT_EQ(s_b.faults.cell_ov, 1U);
+}
+
+static void test_reset_races_new_fault(void)
+{
+    bms_pack_ctl_t cr, cc, c;
+
+    fprintf(stderr, "  test_reset_races_new_fault\n");
+    setup();
+    bms_pack_share_snapshot(&s_a, &c);
+    s_a.faults.cell_ov = 1U;
+    s_a.fault_latched = true;
+    bms_pack_share_commit(&c, &s_a);
+
+    /* Plain reset */
+    bms_pack_share_snapshot(&s_a, &cr);
+    memset(&s_a.faults, 0, sizeof(s_a.faults));
+    s_a.fault_latched = false;
+    bms_pack_share_commit(&cr, &s_a);
+    bms_pack_share_snapshot(&s_b, &c);
+    TEST_ASSERT(!s_b.fault_latched);
+    TEST_ASSERT_EQ(c.faults, 0U);
+
+    /* Reset in flight while the contactor task latches a weld */
+    s_b.faults.cell_ov = 1U;
+    s_b.fault_latched = true;
+    bms_pack_share_commit(&c, &s_b);
+    bms_pack_share_snapshot(&s_a, &cr);             /* state task */
+    bms_pack_share_snapshot(&s_b, &cc);             /* contactor task */
+    s_b.faults.contactor_weld = 1U;
+    s_b.contactor_state = CONTACTOR_WELDED;
+    bms_pack_share_commit(&cc, &s_b);
+    memset(&s_a.faults, 0, sizeof(s_a.faults));
+    s_a.fault_latched = false;
+    s_a.mode = BMS_MODE_NOT_READY;
+    bms_pack_share_commit(&cr, &s_a);
+
+    bms_pack_share_snapshot(&s_a, &c);
+    TEST_ASSERT_EQ(s_a.faults.cell_ov, 0U);         /* reset took */
+    TEST_ASSERT_EQ(s_a.faults.contactor_weld, 1U);  /* weld survived */
+    TEST_ASSERT(s_a.fault_latched);                 /* ...and stays latched */
+    TEST_ASSERT_EQ(s_a.contactor_state, CONTACTOR_WELDED);
+    TEST_ASSERT_EQ(s_a.mode, BMS_MODE_NOT_READY);
+}
+
+void test_pack_share_suite(void)
+{
+    test_snapshot_roundtrip();
+    test_torn_read_detected();
+    test_fault_bits_not_lost();
+    test_reset_races_new_fault();
+}
@@ -0,0 +1,275 @@
+/**
+ * test_power.c — tickless POWER_SAVE: slow cadence, STOP duty cycle,
+ *                ALERT/CAN wake, exit on activity, IWDG coverage
+ */
+
+#include "bms_power.h"
+#include "bms_sched.h"
+#include "bms_monitor.h"
+#include "bms_protection.h"
+#include "bms_bq76952.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern void mock_advance_tick(uint32_t ms);
+extern void mock_set_i2c_reg16(uint8_t module, uint8_t reg, uint16_t val);
+extern void mock_set_afe_summary(uint8_t module, uint16_t max_mv, uint16_t min_mv,
+                                 uint32_t stack_mv, int16_t max_dc, int16_t min_dc,
+                                 int16_t avg_dc);
+extern uint32_t mock_get_iwdg_feed_count(void);
+extern void mock_schedule_wake(uint32_t at_ms, hal_wake_t src);
+extern void mock_set_afe_alert(bool active);
+extern uint32_t mock_get_stop_ms(void);
+
+/* ── A main-loop table on the mock: every job costs 1 ms awake ─────── */
+
+static bms_pack_data_t       s_pack;
+static bms_protection_state_t s_prot;
+static uint32_t              s_monitor_at;      /* tick of the last monitor run */
+static uint32_t              s_monitor_dt;
+
+static void p_monitor(uint32_t dt_ms)
+{
+    s_monitor_at = hal_tick_ms();
+    s_monitor_dt = dt_ms;
+    bms_monitor_run_dt(&s_pack, dt_ms);
+    mock_advance_tick(1U);
+}
+
+static void p_protection(uint32_t dt_ms)
+{
+    bms_protection_run(&s_prot, &s_pack, dt_ms);
+    bms_power_update(&s_pack, hal_tick_ms());
+    hal_iwdg_feed();
+    mock_advance_tick(1U);
+}
+
+static void p_safety(uint32_t dt_ms)
+{
+    (void)dt_ms;
+    mock_advance_tick(1U);
+}
+
+static const bms_sched_task_t k_tbl[] = {
+    { p_monitor,    NULL, BMS_MONITOR_PERIOD_MS,    0U,  BMS_PS_SCAN_PERIOD_MS, BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+    { p_protection, NULL, BMS_PROTECTION_PERIOD_MS, 0U,  BMS_PS_SCAN_PERIOD_MS, BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+    { p_safety,     NULL, BMS_SAFETY_IO_PERIOD_MS,  20U, 0U,                    BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+};
+
+static uint32_t s_feed_gap_max;
+
+/* The bare-metal loop until tick `to`; spins 1 ms when nothing is due
+ * at full cadence, like main() */
+static void loop_until(uint32_t to)
+{
+    uint32_t feeds = mock_get_iwdg_feed_count();
+    uint32_t fed_at = hal_tick_ms();
+
+    while ((int32_t)(to - hal_tick_ms()) > 0) {
+        uint32_t now = hal_tick_ms();
+
+        if (!bms_sched_dispatch(now)) {
+            if (bms_power_low()) {
+                bms_power_idle(now, bms_sched_idle_ms(now));
+            } else {
+                mock_advance_tick(1U);
+            }
+        }
+        if (mock_get_iwdg_feed_count() != feeds) {
+            uint32_t gap = hal_tick_ms() - fed_at;
+            if (gap > s_feed_gap_max) { s_feed_gap_max = gap; }
+            feeds = mock_get_iwdg_feed_count();
+            fed_at = hal_tick_ms();
+        }
+    }
+}
+
+static void set_module_mv(uint8_t mod, uint16_t mv)
+{
+    uint8_t c;
+
+    for (c = 0U; c < BMS_SE_PER_MODULE; c++) {
+        mock_set_i2c_reg16(mod, BQ76952_CELL_REG(c), mv);
+    }
+    mock_set_i2c_reg16(mod, BQ76952_REG_STACK_VOLTAGE,
+                       (uint16_t)((uint32_t)mv * BMS_SE_PER_MODULE / 10U));
+    mock_set_afe_summary(mod, mv, mv, (uint32_t)mv * BMS_SE_PER_MODULE, 250, 250, 250);
+}
+
+static void setup(void)
+{
+    uint8_t mod;
+
+    mock_reset_all();
+    memset(&s_pack, 0, sizeof(s_pack));
+    bms_monitor_init(&s_pack);
+    bms_protection_init(&s_prot);
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        set_module_mv(mod, 3650U);
+        mock_set_i2c_reg16(mod, BQ76952_REG_TS1_TEMP, 250U + 2731U);
+        mock_set_i2c_reg16(mod, BQ76952_REG_TS2_TEMP, 250U + 2731U);
+        mock_set_i2c_reg16(mod, BQ76952_REG_TS3_TEMP, 250U + 2731U);
+    }
+    s_pack.mode = BMS_MODE_POWER_SAVE;
+    s_feed_gap_max = 0U;
+    bms_power_init(0U);
+    (void)bms_sched_init(k_tbl, 3U, 0U);
+}
+
+/* Awake share of [from, to) in per mille */
+static uint32_t duty_permille(uint32_t from, uint32_t to)
+{
+    uint32_t stop0 = mock_get_stop_ms();
+
+    loop_until(to);
+    return 1000U - (mock_get_stop_ms() - stop0) * 1000U / (to - from);
+}
+
+/* ── Test: quiet POWER_SAVE drops to the slow cadence and sleeps ───── */
+static void test_slow_cadence_duty(void)
+{
+    bms_power_stats_t st;
+    uint32_t duty;
+
+    fprintf(stderr, "  test_slow_cadence_duty\n");
+    setup();
+
+    /* Full cadence until the pack has been quiet for the hold time */
+    duty = duty_permille(0U, BMS_PS_WAKE_HOLD_MS - 100U);
+    TEST_ASSERT(!bms_power_low());
+    TEST_ASSERT_EQ(duty, 1000U);
+    TEST_ASSERT_EQ(s_monitor_dt, BMS_MONITOR_PERIOD_MS);
+
+    loop_until(BMS_PS_WAKE_HOLD_MS + 100U);
+    TEST_ASSERT(bms_power_low());
+
+    /* 2 scan jobs per 500 ms + safety I/O every 100 ms ≈ 1.4 % awake */
+    duty = duty_permille(BMS_PS_WAKE_HOLD_MS + 100U, BMS_PS_WAKE_HOLD_MS + 60100U);
+    fprintf(stderr, "    POWER_SAVE duty: %u.%u %%\n", (unsigned)(duty / 10U), (unsigned)(duty % 10U));
+    TEST_ASSERT(duty <= 20U);
+    TEST_ASSERT_EQ(s_monitor_dt, BMS_PS_SCAN_PERIOD_MS);
+    TEST_ASSERT(bms_monitor_scan_complete());               /* whole sweep per scan */
+
+    bms_power_get_stats(&st);
+    TEST_ASSERT_EQ(st.entries, 1U);
+    TEST_ASSERT(st.stops > 0U);
+    TEST_ASSERT(s_feed_gap_max <= BMS_PS_STOP_MAX_MS + 2U);
+    TEST_ASSERT(s_feed_gap_max < BMS_IWDG_TIMEOUT_MS);
+    TEST_ASSERT(!s_pack.fault_latched);
+}
+
+/* ── Test: ALERT wake restores full cadence within one tick ────────── */
+static void test_alert_wake(void)
+{
+    bms_power_stats_t st;
+    uint32_t t_wake = BMS_PS_WAKE_HOLD_MS + 2345U;
+
+    fprintf(stderr, "  test_alert_wake\n");
+    setup();
+    loop_until(BMS_PS_WAKE_HOLD_MS + 100U);
+    TEST_ASSERT(bms_power_low());
+
+    mock_schedule_wake(t_wake, HAL_WAKE_AFE_ALERT);
+    loop_until(t_wake + 2U);
+    TEST_ASSERT(!bms_power_low());
+    TEST_ASSERT(s_monitor_at >= t_wake && s_monitor_at <= t_wake + 1U);
+
+    /* ALERT still asserted: stays at full cadence past the hold time */
+    loop_until(t_wake + BMS_PS_WAKE_HOLD_MS + 1000U);
+    TEST_ASSERT(!bms_power_low());
+
+    /* Released: back to the slow scan one hold time later */
+    mock_set_afe_alert(false);
+    loop_until(hal_tick_ms() + BMS_PS_WAKE_HOLD_MS + 100U);
+    TEST_ASSERT(bms_power_low());
+
+    bms_power_get_stats(&st);
+    TEST_ASSERT_EQ(st.wakes_alert, 1U);
+    TEST_ASSERT_EQ(st.entries, 2U);
+}
+
+/* ── Test: CAN RX wake, then back to sleep after the hold ──────────── */
+static void test_can_wake(void)
+{
+    bms_power_stats_t st;
+    uint32_t t_wake = BMS_PS_WAKE_HOLD_MS + 777U;
+
+    fprintf(stderr, "  test_can_wake\n");
+    setup();
+    loop_until(BMS_PS_WAKE_HOLD_MS + 100U);
+
+    mock_schedule_wake(t_wake, HAL_WAKE_CAN);
+    loop_until(t_wake + 2U);
+    TEST_ASSERT(!bms_power_low());
+    TEST_ASSERT(s_monitor_at >= t_wake && s_monitor_at <= t_wake + 1U);
+
+    loop_until(t_wake + BMS_PS_WAKE_HOLD_MS - 100U);
+    TEST_ASSERT(!bms_power_low());                          /* held for the EMS */
+    loop_until(t_wake + BMS_PS_WAKE_HOLD_MS + 100U);
+    TEST_ASSERT(bms_power_low());
+
+    bms_power_get_stats(&st);
+    TEST_ASSERT_EQ(st.wakes_can, 1U);
+    TEST_ASSERT_EQ(st.wakes_alert, 0U);
+}
+
+/* ── Test: the slow scan itself leaves on mode change or near-limit ── */
+static void test_exit_on_activity(void)
+{
+    bms_power_stats_t st;
+    uint32_t t;
+
+    fprintf(stderr, "  test_exit_on_activity\n");
+    setup();
+    set_module_mv(3U, BMS_SE_OV_WARN_MV - 20U);            /* topped-up module */
+    loop_until(BMS_PS_WAKE_HOLD_MS + 100U);
+    TEST_ASSERT(bms_power_low());
+
+    /* EMS took the pack out of POWER_SAVE: next slow scan restores 10 ms */
+    s_pack.mode = BMS_MODE_READY;
+    t = hal_tick_ms();
+    loop_until(t + BMS_PS_SCAN_PERIOD_MS + 2U);
+    TEST_ASSERT(!bms_power_low());
+    s_pack.mode = BMS_MODE_POWER_SAVE;
+    loop_until(hal_tick_ms() + BMS_PS_WAKE_HOLD_MS + 100U);
+    TEST_ASSERT(bms_power_low());
+
+    /* A cell past the OV warning level: full cadence, no fault from
+     * one slow sample */
+    set_module_mv(3U, BMS_SE_OV_WARN_MV + 20U);
+    t = hal_tick_ms();
+    loop_until(t + BMS_PS_SCAN_PERIOD_MS + 2U);
+    TEST_ASSERT(!bms_power_low());
+    TEST_ASSERT(!s_pack.fault_latched);
+    loop_until(hal_tick_ms() + BMS_PS_WAKE_HOLD_MS + 100U);
+    TEST_ASSERT(!bms_power_low());
+
+    bms_power_get_stats(&st);
+    TEST_ASSERT_EQ(st.exits, 2U);
+}
+
+void test_power_suite(void)
+{
+    test_slow_cadence_duty();
+    test_alert_wake();
+    test_can_wake();
+    test_exit_on_activity();
+}
@@ -0,0 +1,250 @@
+/**
+ * test_protection.c — Fault detection tests (per-cell, leaky timers, HW layer)
+ */
+
+#include "bms_protection.h"
+#include "bms_nvm_queue.h"
+#include "bms_hal.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+extern uint32_t mock_get_nvm_program_ops(void);
+
+static bms_pack_data_t s_pack;
+static bms_protection_state_t s_prot;
+
+static void setup_nominal(void)
+{
+    uint16_t i;
+    uint8_t mod, sens;
+
+    mock_reset_all();
+    memset(&s_pack, 0, sizeof(s_pack));
+    bms_protection_init(&s_prot);
+
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        s_pack.cell_mv[i] = 3675U;
+    }
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            s_pack.modules[mod].temp_deci_c[sens] = 250;
+        }
+    }
+    s_pack.max_temp_deci_c = 250;
+    s_pack.min_temp_deci_c = 250;
+    s_pack.max_cell_mv = 3675U;
+    s_pack.min_cell_mv = 3675U;
+    s_pack.avg_cell_mv = 3675U;
+    s_pack.soc_hundredths = 5000U;
+    s_pack.pack_current_ma = 0;
+}
+
+static void run_for(uint32_t ms)
+{
+    uint32_t t;
+    for (t = 0U; t < ms; t += 10U) {
+        bms_protection_run(&s_prot, &s_pack, 10U);
+    }
+}
+
+/* ── Test: no fault under normal conditions ────────────────────────── */
+static void test_no_fault_nominal(void)
+{
+    setup_nominal();
+    run_for(100U);
+    TEST_ASSERT(!s_pack.fault_latched);
+    TEST_ASSERT_EQ(s_pack.faults.cell_ov, 0U);
+    TEST_ASSERT_EQ(s_pack.faults.cell_uv, 0U);
+}
+
+/* ── Test: single cell OV after delay ──────────────────────────────── */
+static void test_single_cell_ov(void)
+{
+    setup_nominal();
+    s_pack.cell_mv[42] = BMS_SE_OV_FAULT_MV;
+
+    run_for(4900U);
+    TEST_ASSERT(!s_pack.fault_latched);
+    TEST_ASSERT_EQ(s_prot.ov_timer_ms[41], 0U);
+
+    run_for(200U);
+    TEST_ASSERT(s_pack.fault_latched);
+    TEST_ASSERT_EQ(s_pack.faults.cell_ov, 1U);
+}
+
+/* ── Test: single cell UV after delay (last cell in pack) ──────────── */
+static void test_single_cell_uv(void)
+{
+    setup_nominal();
+    s_pack.cell_mv[BMS_SE_PER_PACK - 1U] = BMS_SE_UV_FAULT_MV;
+
+    run_for(5100U);
+    TEST_ASSERT(s_pack.fault_latched);
+    TEST_ASSERT_EQ(s_pack.faults.cell_uv, 1U);
+}
+
+/* ── Test: zero reading is an unread cell — no UV, timer held ──────── */
+static void test_zero_cell_holds_uv_timer(void)
+{
+    setup_nominal();
+    s_pack.cell_mv[7] = BMS_SE_UV_FAULT_MV;
+    run_for(2000U);
+    TEST_ASSERT_EQ(s_prot.uv_timer_ms[7], 2000U);
+
+    s_pack.cell_mv[7] = 0U;
+    run_for(10000U);
+    TEST_ASSERT(!s_pack.fault_latched);
+    TEST_ASSERT_EQ(s_prot.uv_timer_ms[7], 2000U);
+}
+
+/* ── Test: leaky timer decay — transient OV should NOT trip ────────── */
+static void test_leaky_timer_decay(void)
+{
+    setup_nominal();
+    s_pack.cell_mv[10] = BMS_SE_OV_FAULT_MV;
+    run_for(2000U);
+    TEST_ASSERT(!s_pack.fault_latched);
+
+    s_pack.cell_mv[10] = 3675U;
+    run_for(6000U);
+    TEST_ASSERT(!s_pack.fault_latched);
+    TEST_ASSERT(s_prot.ov_timer_ms[10] < 100U);
+}
+
+/* ── Test: HW OV trips after 1 s regardless of SW delay ────────────── */
+static void test_hw_ov(void)
+{
+    setup_nominal();
+    s_pack.cell_mv[200] = BMS_HW_OV_MV;
+    run_for(900U);
+    TEST_ASSERT_EQ(s_pack.faults.hw_ov, 0U);
+    run_for(200U);
+    TEST_ASSERT_EQ(s_pack.faults.hw_ov, 1U);
+    TEST_ASSERT(s_pack.fault_latched);
+}
+
+/* ── Test: warnings with hysteresis ────────────────────────────────── */
+static void test_ov_warning_hysteresis(void)
+{
+    setup_nominal();
+    s_pack.cell_mv[150] = BMS_SE_OV_WARN_MV;
+    run_for(BMS_WARN_DELAY_MS + 100U);
+    TEST_ASSERT(s_prot.warn_ov_active);
+    TEST_ASSERT(!s_pack.fault_latched);
+
+    /* Between clear and set thresholds: stays active */
+    s_pack.cell_mv[150] = BMS_SE_OV_WARN_CLEAR_MV;
+    run_for(1000U);
+    TEST_ASSERT(s_prot.warn_ov_active);
+}
+
+/* ── Test: active set tracks nonzero integrators only ──────────────── */
+static void test_active_set_tracks_timers(void)
+{
+    setup_nominal();
+    TEST_ASSERT_EQ(s_prot.ov_active[3], 0U);
+
+    s_pack.cell_mv[3U * BMS_SE_PER_MODULE + 5U] = BMS_SE_OV_FAULT_MV;
+    run_for(1000U);
+    TEST_ASSERT_EQ(s_prot.ov_active[3], 1U << 5);
+    TEST_ASSERT_EQ(s_prot.ov_timer_ms[3U * BMS_SE_PER_MODULE + 5U], 1000U);
+
+    /* Decays at dt/2 — 2 s clean drains 1 s of accumulation */
+    s_pack.cell_mv[3U * BMS_SE_PER_MODULE + 5U] = 3675U;
+    run_for(1990U);
+    TEST_ASSERT_EQ(s_prot.ov_active[3], 1U << 5);
+    run_for(10U);
+    TEST_ASSERT_EQ(s_prot.ov_timer_ms[3U * BMS_SE_PER_MODULE + 5U], 0U);
+    TEST_ASSERT_EQ(s_prot.ov_active[3], 0U);
+}
+
+/* ── Test: OT trips per sensor; faulted sensor timer is held ───────── */
+static void test_ot_sparse(void)
+{
+    uint16_t idx = 4U * BMS_TEMPS_PER_MODULE + 2U;
+
+    setup_nominal();
+    s_pack.modules[4].temp_deci_c[2] = BMS_SE_OT_FAULT_DECI_C;
+    run_for(2000U);
+    TEST_ASSERT_EQ(s_prot.ot_timer_ms[idx], 2000U);
+    TEST_ASSERT_EQ(s_prot.ot_active[4], 1U << 2);
+
+    s_pack.modules[4].sensor_fault[2].faulted = true;
+    run_for(5000U);
+    TEST_ASSERT(!s_pack.fault_latched);
+    TEST_ASSERT_EQ(s_prot.ot_timer_ms[idx], 2000U);
+
+    s_pack.modules[4].sensor_fault[2].faulted = false;
+    run_for(3100U);
+    TEST_ASSERT(s_pack.fault_latched);
+    TEST_ASSERT_EQ(s_pack.faults.cell_ot, 1U);
+}
+
+/* ── Test: timers saturate, do not wrap ────────────────────────────── */
+static void test_timer_saturates(void)
+{
+    setup_nominal();
+    s_prot.ov_timer_ms[0] = (uint16_t)(BMS_PROT_TIMER_MAX_MS - 5U);
+    s_prot.ov_active[0] = 1U;
+    s_pack.fault_latched = false;
+    s_pack.cell_mv[0] = BMS_SE_OV_FAULT_MV;
+    bms_protection_run(&s_prot, &s_pack, 10U);
+    TEST_ASSERT_EQ(s_prot.ov_timer_ms[0], BMS_PROT_TIMER_MAX_MS);
+    TEST_ASSERT(s_pack.fault_latched);
+}
+
+/* ── Test: faults are queued, flash is written by the drain only ───── */
+static void test_fault_log_write_behind(void)
+{
+    bms_nvm_ctx_t nvm;
+    bms_nvm_fault_event_t ev;
+
+    setup_nominal();
+    bms_nvm_queue_init();
+    s_pack.cell_mv[42] = BMS_SE_OV_FAULT_MV;
+    s_pack.uptime_ms = 5100U;
+    run_for(5100U);
+    TEST_ASSERT(s_pack.fault_latched);
+    TEST_ASSERT_EQ(bms_nvm_queue_depth(), 1U);
+    TEST_ASSERT_EQ(mock_get_nvm_program_ops(), 0U);   /* no flash in protection */
+
+    bms_nvm_init(&nvm);
+    TEST_ASSERT_EQ(bms_nvm_queue_drain(&nvm), 1U);
+    TEST_ASSERT(mock_get_nvm_program_ops() > 0U);
+    TEST_ASSERT(bms_nvm_get_fault(&nvm, 0U, &ev));
+    TEST_ASSERT_EQ(ev.fault_type, NVM_FAULT_OV);
+    TEST_ASSERT_EQ(ev.cell_index, 42U);
+    TEST_ASSERT_EQ(ev.value, BMS_SE_OV_FAULT_MV);
+}
+
+void test_protection_suite(void)
+{
+    test_no_fault_nominal();
+    test_single_cell_ov();
+    test_single_cell_uv();
+    test_zero_cell_holds_uv_timer();
+    test_leaky_timer_decay();
+    test_hw_ov();
+    test_ov_warning_hysteresis();
+    test_active_set_tracks_timers();
+    test_ot_sparse();
+    test_timer_saturates();
+    test_fault_log_write_behind();
+}
@@ -0,0 +1,379 @@
+/**
+ * test_sched.c — table-driven bare-metal scheduler: grid, priority,
+ *                overrun policies, early release, phased frame load
+ */
+
+#include "bms_sched.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+/* ── Recording tasks ───────────────────────────────────────────────── */
+
+static uint32_t s_now;
+static uint32_t s_log_t[64];
+static uint8_t  s_log_id[64];
+static uint8_t  s_log_n;
+static bool     s_early;
+
+static void note(uint8_t id)
+{
+    if (s_log_n < 64U) {
+        s_log_t[s_log_n] = s_now;
+        s_log_id[s_log_n] = id;
+        s_log_n++;
+    }
+}
+
+static uint32_t s_dt_a;
+
+static void task_a(uint32_t dt_ms) { s_dt_a = dt_ms; note(0U); }
+static void task_b(uint32_t dt_ms) { (void)dt_ms; note(1U); }
+static void task_c(uint32_t dt_ms) { (void)dt_ms; note(2U); }
+
+/* Like bms_can_rx_urgent_pending(): the flag is consumed by the run */
+static bool early_c(void)
+{
+    bool e = s_early;
+    s_early = false;
+    return e;
+}
+
+/* Dispatch until idle at each ms in [from, to] */
+static void run_until(uint32_t from, uint32_t to)
+{
+    for (s_now = from; (int32_t)(to - s_now) >= 0; s_now++) {
+        while (bms_sched_dispatch(s_now)) { }
+    }
+}
+
+static void reset_log(void)
+{
+    s_log_n = 0U;
+    s_early = false;
+}
+
+static void test_init_rejects(void)
+{
+    bms_sched_task_t bad[1] = {
+        { task_a, NULL, 10U, 10U, 0U, BMS_SCHED_SKIP, BMS_SCHED_NO_TRACE }
+    };
+    bms_sched_task_t ok[1] = {
+        { task_a, NULL, 10U, 0U, 0U, BMS_SCHED_SKIP, BMS_SCHED_NO_TRACE }
+    };
+
+    fprintf(stderr, "  test_init_rejects\n");
+    TEST_ASSERT_EQ(bms_sched_init(bad, 1U, 0U), -1);      /* phase == period */
+    bad[0].phase_ms = 0U;
+    bad[0].period_ms = 0U;
+    TEST_ASSERT_EQ(bms_sched_init(bad, 1U, 0U), -1);
+    bad[0].period_ms = 10U;
+    bad[0].lp_period_ms = 5U;
+    TEST_ASSERT_EQ(bms_sched_init(bad, 1U, 0U), -1);      /* lp below period */
+    bad[0].lp_period_ms = 0U;
+    bad[0].run = NULL;
+    TEST_ASSERT_EQ(bms_sched_init(bad, 1U, 0U), -1);
+    TEST_ASSERT_EQ(bms_sched_init(ok, 0U, 0U), -1);
+    TEST_ASSERT_EQ(bms_sched_init(ok, (uint8_t)(BMS_SCHED_MAX_TASKS + 1U), 0U), -1);
+    TEST_ASSERT(!bms_sched_dispatch(100U));               /* failed init = idle */
+    TEST_ASSERT_EQ(bms_sched_init(ok, 1U, 0U), 0);
+}
+
+static void test_grid_and_phase(void)
+{
+    static const bms_sched_task_t tbl[] = {
+        { task_a, NULL, 10U,  0U, 0U,  BMS_SCHED_SKIP, BMS_SCHED_NO_TRACE },
+        { task_b, NULL, 50U,  20U, 0U, BMS_SCHED_SKIP, BMS_SCHED_NO_TRACE },
+    };
+    uint8_t i, nb = 0U;
+    const uint32_t base = 0xFFFFFFE0U;                    /* wraps mid-test */
+
+    fprintf(stderr, "  test_grid_and_phase\n");
+    reset_log();
+    TEST_ASSERT_EQ(bms_sched_init(tbl, 2U, base), 0);
+    run_until(base, base + 119U);
+
+    for (i = 0U; i < s_log_n; i++) {
+        uint32_t off = s_log_t[i] - base;
+        if (s_log_id[i] == 1U) {
+            TEST_ASSERT_EQ(off % 50U, 20U);
+            nb++;
+        } else {
+            TEST_ASSERT_EQ(off % 10U, 0U);
+        }
+    }
+    TEST_ASSERT_EQ(nb, 2U);                               /* 20, 70 */
+    TEST_ASSERT_EQ(s_log_n, 14U);                         /* 12 + 2 */
+}
+
+static void test_priority_order(void)
+{
+    static const bms_sched_task_t tbl[] = {
+        { task_a, NULL, 10U,  0U, 0U, BMS_SCHED_SKIP, BMS_SCHED_NO_TRACE },
+        { task_b, NULL, 100U, 0U, 0U, BMS_SCHED_SKIP, BMS_SCHED_NO_TRACE },
+        { task_c, NULL, 100U, 0U, 0U, BMS_SCHED_SKIP, BMS_SCHED_NO_TRACE },
+    };
+
+    fprintf(stderr, "  test_priority_order\n");
+    reset_log();
+    TEST_ASSERT_EQ(bms_sched_init(tbl, 3U, 0U), 0);
+
+    /* One job per dispatch, re-scanned from the top */
+    s_now = 0U;
+    TEST_ASSERT(bms_sched_dispatch(0U));
+    TEST_ASSERT_EQ(s_log_n, 1U);
+    TEST_ASSERT_EQ(s_log_id[0], 0U);
+    TEST_ASSERT(bms_sched_dispatch(0U));
+    TEST_ASSERT_EQ(s_log_id[1], 1U);
+
+    /* a released again while c is still pending: a goes first */
+    s_now = 10U;
+    TEST_ASSERT(bms_sched_dispatch(10U));
+    TEST_ASSERT_EQ(s_log_id[2], 0U);
+    TEST_ASSERT(bms_sched_dispatch(10U));
+    TEST_ASSERT_EQ(s_log_id[3], 2U);
+    TEST_ASSERT(!bms_sched_dispatch(10U));
+}
+
+static void test_skip_policy(void)
+{
+    static const bms_sched_task_t tbl[] = {
+        { task_a, NULL, 10U, 0U, 0U, BMS_SCHED_SKIP, BMS_SCHED_NO_TRACE },
+    };
+    bms_sched_stats_t st;
+
+    fprintf(stderr, "  test_skip_policy\n");
+    reset_log();
+    TEST_ASSERT_EQ(bms_sched_init(tbl, 1U, 0U), 0);
+    run_until(0U, 0U);
+
+    /* Loop stalled until 35 ms: releases 10, 20, 30 collapse into one run */
+    run_until(35U, 45U);
+    TEST_ASSERT_EQ(s_log_n, 3U);                          /* 0, 35, 40 */
+    TEST_ASSERT_EQ(s_log_t[1], 35U);
+    TEST_ASSERT_EQ(s_log_t[2], 40U);                      /* back on the grid */
+    bms_sched_get_stats(0U, &st);
+    TEST_ASSERT_EQ(st.runs, 3U);
+    TEST_ASSERT_EQ(st.overruns, 1U);
+    TEST_ASSERT_EQ(st.skipped, 2U);
+    TEST_ASSERT_EQ(st.caught_up, 0U);
+    TEST_ASSERT_EQ(st.max_late_ms, 25U);
+}
+
+static void test_catchup_policy(void)
+{
+    static const bms_sched_task_t tbl[] = {
+        { task_a, NULL, 10U, 0U, 0U, BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+    };
+    bms_sched_stats_t st;
+
+    fprintf(stderr, "  test_catchup_policy\n");
+    reset_log();
+    TEST_ASSERT_EQ(bms_sched_init(tbl, 1U, 0U), 0);
+    run_until(0U, 0U);
+
+    /* Stall to 35 ms: 10, 20, 30 all replayed at 35, then 40 on time */
+    run_until(35U, 40U);
+    TEST_ASSERT_EQ(s_log_n, 5U);
+    TEST_ASSERT_EQ(s_log_t[3], 35U);
+    TEST_ASSERT_EQ(s_log_t[4], 40U);
+    bms_sched_get_stats(0U, &st);
+    TEST_ASSERT_EQ(st.caught_up, 2U);                     /* 10, 20 */
+    TEST_ASSERT_EQ(st.overruns, 2U);
+    TEST_ASSERT_EQ(st.skipped, 0U);
+
+    /* Stall past BMS_SCHED_CATCHUP_MAX periods: MAX + 2 releases due
+     * (50 .. 50 + (MAX + 1) × 10), the oldest is skipped, the rest run */
+    reset_log();
+    run_until(40U + (BMS_SCHED_CATCHUP_MAX + 2U) * 10U + 5U,
+              40U + (BMS_SCHED_CATCHUP_MAX + 2U) * 10U + 5U);
+    TEST_ASSERT_EQ(s_log_n, BMS_SCHED_CATCHUP_MAX + 1U);
+    bms_sched_get_stats(0U, &st);
+    TEST_ASSERT_EQ(st.skipped, 1U);
+    TEST_ASSERT_EQ(st.caught_up, 2U + BMS_SCHED_CATCHUP_MAX);
+    TEST_ASSERT_EQ(st.runs, 5U + BMS_SCHED_CATCHUP_MAX + 1U);
+
+    /* ... and the grid resumes on time */
+    reset_log();
+    run_until(40U + (BMS_SCHED_CATCHUP_MAX + 2U) * 10U + 6U,
+              40U + (BMS_SCHED_CATCHUP_MAX + 3U) * 10U);
+    TEST_ASSERT_EQ(s_log_n, 1U);
+    TEST_ASSERT_EQ(s_log_t[0], 40U + (BMS_SCHED_CATCHUP_MAX + 3U) * 10U);
+}
+
+static void test_early_release(void)
+{
+    static const bms_sched_task_t tbl[] = {
+        { task_a, NULL,    10U,  0U, 0U,  BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+        { task_c, early_c, 100U, 30U, 0U, BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+    };
+    bms_sched_stats_t st;
+    uint8_t i, nc = 0U;
+
+    fprintf(stderr, "  test_early_release\n");
+    reset_log();
+    TEST_ASSERT_EQ(bms_sched_init(tbl, 2U, 0U), 0);
+    run_until(0U, 10U);
+    s_early = true;
+    run_until(11U, 11U);
+    s_early = false;
+    run_until(12U, 130U);
+
+    for (i = 0U; i < s_log_n; i++) {
+        if (s_log_id[i] == 2U) { nc++; }
+    }
+    TEST_ASSERT_EQ(nc, 3U);                               /* 11, 30, 130 */
+    bms_sched_get_stats(1U, &st);
+    TEST_ASSERT_EQ(st.early_runs, 1U);
+    TEST_ASSERT_EQ(st.overruns, 0U);                      /* grid not moved */
+}
+
+static void test_low_power_cadence(void)
+{
+    static const bms_sched_task_t tbl[] = {
+        { task_a, NULL, 10U,  0U,  500U, BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+        { task_b, NULL, 100U, 20U, 0U,   BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+    };
+    bms_sched_stats_t st;
+    uint8_t i, na = 0U, nb = 0U;
+
+    fprintf(stderr, "  test_low_power_cadence\n");
+    reset_log();
+    TEST_ASSERT_EQ(bms_sched_init(tbl, 2U, 0U), 0);
+    run_until(0U, 5U);
+    TEST_ASSERT_EQ(s_dt_a, 10U);
+    TEST_ASSERT_EQ(bms_sched_idle_ms(5U), 5U);
+
+    /* Both released together at now + lp period, then on the slow grid */
+    bms_sched_set_low_power(true, 5U);
+    TEST_ASSERT(bms_sched_low_power());
+    TEST_ASSERT_EQ(bms_sched_idle_ms(6U), 99U);           /* b: 0 → same period */
+    reset_log();
+    run_until(6U, 1004U);
+    for (i = 0U; i < s_log_n; i++) {
+        if (s_log_id[i] == 0U) { na++; } else { nb++; }
+    }
+    TEST_ASSERT_EQ(na, 1U);                               /* 505 */
+    TEST_ASSERT_EQ(nb, 9U);                               /* 105 … 905 */
+    TEST_ASSERT_EQ(s_dt_a, 500U);
+    TEST_ASSERT_EQ(bms_sched_idle_ms(1004U), 1U);         /* a and b at 1005 */
+
+    /* Leaving: phase-0 task released at once, full grid from there */
+    bms_sched_set_low_power(false, 1004U);
+    TEST_ASSERT_EQ(bms_sched_idle_ms(1004U), 0U);
+    reset_log();
+    run_until(1004U, 1004U);
+    TEST_ASSERT_EQ(s_log_n, 1U);
+    TEST_ASSERT_EQ(s_dt_a, 10U);
+    bms_sched_get_stats(0U, &st);
+    TEST_ASSERT_EQ(st.overruns, 0U);                      /* re-grid is not a miss */
+}
+
+/* ── Frame load with the real periods and WCET budgets ─────────────── */
+
+static uint32_t s_clk_us;
+static uint32_t s_prot_runs;
+static uint32_t s_prot_late_max_us;
+
+static void burn(uint32_t us) { s_clk_us += us; }
+static void w_monitor(uint32_t dt_ms)   { (void)dt_ms; burn(BMS_MONITOR_WCET_US); }
+static void w_diag(uint32_t dt_ms)      { (void)dt_ms; burn(BMS_DIAG_WCET_US); }
+static void w_contactor(uint32_t dt_ms) { (void)dt_ms; burn(BMS_CONTACTOR_WCET_US); }
+static void w_safety_io(uint32_t dt_ms) { (void)dt_ms; burn(BMS_SAFETY_IO_WCET_US); }
+static void w_state(uint32_t dt_ms)     { (void)dt_ms; burn(BMS_STATE_WCET_US); }
+static void w_can(uint32_t dt_ms)       { (void)dt_ms; burn(BMS_CAN_TX_WCET_US); }
+static void w_nvm(uint32_t dt_ms)       { (void)dt_ms; burn(BMS_NVM_DRAIN_WCET_US); }
+static void w_thermal(uint32_t dt_ms)   { (void)dt_ms; burn(BMS_THERMAL_WCET_US); }
+
+static void w_protection(uint32_t dt_ms)
+{
+    uint32_t late = s_clk_us - s_prot_runs * BMS_PROTECTION_PERIOD_MS * 1000U;
+
+    (void)dt_ms;
+    if (late > s_prot_late_max_us) { s_prot_late_max_us = late; }
+    s_prot_runs++;
+    burn(BMS_PROTECTION_WCET_US);
+}
+
+/* 2 s of the main-loop table, every job taking its full budget */
+static uint32_t loop_prot_late_us(bool phased)
+{
+    const bms_sched_task_t tbl[] = {
+        { w_monitor,    NULL, BMS_MONITOR_PERIOD_MS,    0U, 0U, BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+        { w_protection, NULL, BMS_PROTECTION_PERIOD_MS, 0U, 0U, BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+        { w_diag,       NULL, BMS_DIAG_POLL_MS,         0U, 0U, BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+        { w_contactor,  NULL, BMS_CONTACTOR_PERIOD_MS,
+          phased ? BMS_CONTACTOR_PHASE_MS : 0U, 0U,             BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+        { w_safety_io,  NULL, BMS_SAFETY_IO_PERIOD_MS,
+          phased ? BMS_SAFETY_IO_PHASE_MS : 0U, 0U,             BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+        { w_state,      NULL, BMS_STATE_PERIOD_MS,
+          phased ? BMS_STATE_PHASE_MS : 0U, 0U,                 BMS_SCHED_CATCHUP, BMS_SCHED_NO_TRACE },
+        { w_can,        NULL, BMS_CAN_TX_PERIOD_MS,
+          phased ? BMS_CAN_TX_PHASE_MS : 0U, 0U,                BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+        { w_nvm,        NULL, BMS_NVM_DRAIN_PERIOD_MS,
+          phased ? BMS_NVM_DRAIN_PHASE_MS : 0U, 0U,             BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+        { w_thermal,    NULL, BMS_THERMAL_PERIOD_MS,
+          phased ? BMS_THERMAL_PHASE_MS : 0U, 0U,               BMS_SCHED_SKIP,    BMS_SCHED_NO_TRACE },
+    };
+
+    s_clk_us = 0U;
+    s_prot_runs = 0U;
+    s_prot_late_max_us = 0U;
+    (void)bms_sched_init(tbl, (uint8_t)(sizeof(tbl) / sizeof(tbl[0])), 0U);
+    while (s_clk_us < 2000000U) {
+        if (!bms_sched_dispatch(s_clk_us / 1000U)) {
+            s_clk_us = (s_clk_us / 1000U + 1U) * 1000U;   /* idle to next tick */
+        }
+    }
+    return s_prot_late_max_us;
+}
+
+static void test_phased_frame_load(void)
+{
+    bms_sched_stats_t st;
+    uint8_t i;
+    uint32_t late;
+
+    fprintf(stderr, "  test_phased_frame_load\n");
+
+    /* Phased: protection only ever waits for this frame's monitor */
+    late = loop_prot_late_us(true);
+    TEST_ASSERT_EQ(late, BMS_MONITOR_WCET_US);
+    for (i = 0U; i < 9U; i++) {
+        bms_sched_get_stats(i, &st);
+        TEST_ASSERT_EQ(st.overruns, 0U);
+    }
+    bms_sched_get_stats(8U, &st);
+    TEST_ASSERT_EQ(st.runs, 2U);                          /* thermal at 70, 1070 ms */
+
+    /* All phases 0 (the old superloop): the slow tasks pile into one
+     * frame and push the next protection release late */
+    TEST_ASSERT(loop_prot_late_us(false) > late);
+}
+
+void test_sched_suite(void)
+{
+    test_init_rejects();
+    test_grid_and_phase();
+    test_priority_order();
+    test_skip_policy();
+    test_catchup_policy();
+    test_early_release();
+    test_low_power_cadence();
+    test_phased_frame_load();
+}
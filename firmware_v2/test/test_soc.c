@@ -0,0 +1,206 @@
+/**
+ * test_soc.c — SoC EKF: exact coulomb count, convergence at rest and
+ *              under load, residual clamp, CAN export
+ */
+
+#include "bms_soc.h"
+#include "bms_can_msgs.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+static bms_pack_data_t s_pack;
+
+static int32_t absdiff(int32_t a, int32_t b) { return (a > b) ? a - b : b - a; }
+
+/* Cell OCV in mV at a SoC: the first mV the firmware's own table maps to
+ * at least that SoC */
+static uint16_t ocv_mv_at(uint16_t soc_hundredths)
+{
+    uint16_t mv;
+
+    for (mv = 3000U; mv < 4190U; mv++) {
+        if (bms_soc_from_ocv(mv) >= soc_hundredths) { break; }
+    }
+    return mv;
+}
+
+/* The monitor's cadence: predict every 10 ms, correct on each sweep */
+static void run_scans(uint32_t ms, uint16_t (*truth_mv)(uint32_t t), uint32_t t0)
+{
+    uint32_t t;
+
+    for (t = 0U; t < ms; t += BMS_MONITOR_PERIOD_MS) {
+        bms_soc_update(&s_pack, BMS_MONITOR_PERIOD_MS);
+        if (((t / BMS_MONITOR_PERIOD_MS) % BMS_NUM_MODULES) == BMS_NUM_MODULES - 1U) {
+            s_pack.avg_cell_mv = truth_mv(t0 + t);
+            bms_soc_correct(&s_pack);
+        }
+    }
+}
+
+static void setup(uint16_t soc_hundredths)
+{
+    memset(&s_pack, 0, sizeof(s_pack));
+    bms_soc_init(soc_hundredths);
+}
+
+/* ── Test: 10 ms steps of 1 A are counted, not truncated away ──────── */
+static void test_cc_no_truncation(void)
+{
+    uint32_t i;
+
+    fprintf(stderr, "  test_cc_no_truncation\n");
+
+    /* 1 A for 1 h = 1/128 of capacity = 78.1 hundredths */
+    setup(5000U);
+    s_pack.pack_current_ma = -1000;
+    for (i = 0U; i < 360000U; i++) { bms_soc_update(&s_pack, 10U); }
+    TEST_ASSERT_EQ(s_pack.soc_hundredths, 4922U);
+
+    /* Charging applies the coulombic efficiency: 78.1 × 0.998 */
+    setup(5000U);
+    s_pack.pack_current_ma = 1000;
+    for (i = 0U; i < 360000U; i++) { bms_soc_update(&s_pack, 10U); }
+    TEST_ASSERT_EQ(s_pack.soc_hundredths, 5078U);
+
+    /* No voltage yet: no correction, the estimate stays a pure count */
+    s_pack.avg_cell_mv = 0U;
+    bms_soc_correct(&s_pack);
+    TEST_ASSERT_EQ(bms_soc_get(), 5078U);
+}
+
+/* ── Test: at rest the OCV pulls a wrong boot value in ─────────────── */
+static uint16_t s_rest_mv;
+static uint16_t rest_mv(uint32_t t) { (void)t; return s_rest_mv; }
+
+static void test_converges_at_rest(void)
+{
+    bms_soc_est_t est;
+
+    fprintf(stderr, "  test_converges_at_rest\n");
+    setup(5000U);
+    s_rest_mv = ocv_mv_at(7000U);
+
+    bms_soc_get_estimate(&est);
+    TEST_ASSERT_EQ(est.soc_std_hundredths, 1000U);          /* P0: 10 % */
+
+    run_scans(60000U, rest_mv, 0U);
+    bms_soc_get_estimate(&est);
+    TEST_ASSERT(absdiff(est.soc_hundredths, 7000) <= 100);
+    TEST_ASSERT(est.soc_std_hundredths < 100U);
+    TEST_ASSERT(est.updates > 250U);
+    TEST_ASSERT(absdiff(est.innov_uv, 0) < 1000);
+}
+
+/* ── Test: under a steady discharge, no rest, a 30 % error closes ─── */
+#define LOAD_MA      (-100000)
+#define LOAD_T0_SOC  8000
+
+/* Same ECM as the filter: true SoC falls linearly, V_rc charges up */
+static uint16_t load_mv(uint32_t t)
+{
+    int32_t drop = (int32_t)(((int64_t)-LOAD_MA * t) /
+                             ((int64_t)BMS_NOMINAL_CAPACITY_MAH * 360));
+    double r0_mv = (double)BMS_SOC_EKF_R0_UOHM * LOAD_MA / 1e6;
+    double rc_mv = (double)BMS_SOC_EKF_R1_UOHM * LOAD_MA / 1e6 *
+                   (1.0 - exp(-(double)t / BMS_SOC_EKF_TAU_MS));
+
+    return (uint16_t)((double)ocv_mv_at((uint16_t)(LOAD_T0_SOC - drop)) +
+                      r0_mv + rc_mv + 0.5);
+}
+
+static void test_tracks_under_load(void)
+{
+    bms_soc_est_t est;
+    int32_t truth;
+
+    fprintf(stderr, "  test_tracks_under_load\n");
+    setup(5000U);
+    s_pack.pack_current_ma = LOAD_MA;
+    run_scans(1800000U, load_mv, 0U);
+
+    truth = LOAD_T0_SOC - (int32_t)(((int64_t)-LOAD_MA * 1800000) /
+                                    ((int64_t)BMS_NOMINAL_CAPACITY_MAH * 360));
+    bms_soc_get_estimate(&est);
+    fprintf(stderr, "    30 min at 100 A: truth %ld, EKF %u ± %u (0.01 %%)\n",
+            (long)truth, (unsigned)est.soc_hundredths, (unsigned)est.soc_std_hundredths);
+    TEST_ASSERT(absdiff(est.soc_hundredths, truth) <= 200);
+    TEST_ASSERT(est.soc_std_hundredths < 300U);
+    TEST_ASSERT(est.vrc_uv < 0);                            /* discharge polarisation */
+}
+
+/* ── Test: one wild reading moves the estimate a bounded step ──────── */
+static void test_innovation_clamp(void)
+{
+    bms_soc_est_t est;
+    uint16_t before;
+
+    fprintf(stderr, "  test_innovation_clamp\n");
+    setup(5000U);
+    s_rest_mv = ocv_mv_at(5000U);
+    run_scans(60000U, rest_mv, 0U);
+    before = bms_soc_get();
+
+    s_pack.avg_cell_mv = 4190U;                             /* +500 mV glitch */
+    bms_soc_update(&s_pack, BMS_SOC_EKF_PERIOD_MS);
+    bms_soc_correct(&s_pack);
+    bms_soc_get_estimate(&est);
+    TEST_ASSERT(est.innov_uv > 400000);                      /* seen in full... */
+    TEST_ASSERT(absdiff(bms_soc_get(), before) < 300);      /* ...applied clamped */
+    TEST_ASSERT(est.corr_pct >= -100 && est.corr_pct <= 100);
+
+    /* Back to normal readings: recovers */
+    run_scans(60000U, rest_mv, 0U);
+    TEST_ASSERT(absdiff(bms_soc_get(), 5000) <= 100);
+}
+
+/* ── Test: estimate and covariance on CAN_ID_SOC_EST ───────────────── */
+static void test_can_export(void)
+{
+    bms_can_frame_t f;
+    bms_can_msg_soc_est_t m;
+    bms_soc_est_t est;
+
+    fprintf(stderr, "  test_can_export\n");
+    setup(5000U);
+    s_rest_mv = ocv_mv_at(6000U);
+    run_scans(20000U, rest_mv, 0U);
+
+    bms_soc_get_estimate(&est);
+    bms_soc_encode_can(&f);
+    TEST_ASSERT_EQ(f.id, CAN_ID_SOC_EST);
+    TEST_ASSERT_EQ(f.dlc, 8U);
+    bms_can_msg_soc_est_decode(&f, &m);
+    TEST_ASSERT_EQ(m.soc_hundredths, est.soc_hundredths);
+    TEST_ASSERT_EQ(m.soc_std_hundredths, est.soc_std_hundredths);
+    TEST_ASSERT(absdiff(m.vrc_uv, est.vrc_uv) < 100);
+    TEST_ASSERT(absdiff((int32_t)m.vrc_std_uv, (int32_t)est.vrc_std_uv) < 100);
+    TEST_ASSERT_EQ(m.corr_pct, est.corr_pct);
+    TEST_ASSERT(m.soc_std_hundredths > 0U);
+}
+
+void test_soc_suite(void)
+{
+    test_cc_no_truncation();
+    test_converges_at_rest();
+    test_tracks_under_load();
+    test_innovation_clamp();
+    test_can_export();
+}
@@ -0,0 +1,229 @@
+/**
+ * test_soh.c — State of health: module R from current steps, capacity
+ *              from rest-to-rest swings, capacity-scaled limits, NVM
+ */
+
+#include "bms_soh.h"
+#include "bms_soc.h"
+#include "bms_current_limit.h"
+#include "bms_nvm.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+
+#define R_TRUE_UOHM   3500.0        /* 125 % of a fresh module */
+#define CAP_TRUE      0.90
+
+static bms_pack_data_t s_pack;
+static double s_truth;              /* SoC, hundredths */
+
+static int32_t absdiff(int32_t a, int32_t b) { return (a > b) ? a - b : b - a; }
+
+static uint16_t ocv_mv_at(double soc_hundredths)
+{
+    uint16_t mv = 3000U;
+
+    while (mv < 4190U && bms_soc_from_ocv(mv) < soc_hundredths) { mv++; }
+    return mv;
+}
+
+static void setup(uint16_t soc_hundredths)
+{
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.soc_hundredths = soc_hundredths;
+    bms_soc_init(soc_hundredths);
+    bms_soh_init();
+    s_truth = (double)soc_hundredths;
+}
+
+/* Module scans at the monitor's cadence, stack = OCV + R·I */
+static void scan(uint32_t ms, int32_t i_ma)
+{
+    static uint32_t tick;
+    uint32_t t;
+
+    s_pack.pack_current_ma = i_ma;
+    for (t = 0U; t < ms; t += BMS_MONITOR_PERIOD_MS) {
+        uint8_t mod = (uint8_t)(tick % BMS_NUM_MODULES);
+
+        s_pack.modules[mod].stack_mv = (uint16_t)lround(14.0 * 3700.0 +
+                                       R_TRUE_UOHM * i_ma / 1e6);
+        bms_soh_module_scan(&s_pack, mod);
+        s_pack.uptime_ms += BMS_MONITOR_PERIOD_MS;
+        tick++;
+    }
+}
+
+/* One monitor run per second on a pack of CAP_TRUE × nominal */
+static void drive(uint32_t s, int32_t i_ma)
+{
+    uint32_t t;
+    double eff = (i_ma > 0) ? BMS_COULOMBIC_EFFICIENCY_PPT / 1000.0 : 1.0;
+
+    s_pack.pack_current_ma = i_ma;
+    if (i_ma == 0) { s_pack.avg_cell_mv = ocv_mv_at(s_truth); }
+    for (t = 0U; t < s; t++) {
+        s_truth += eff * (double)i_ma / ((double)BMS_NOMINAL_CAPACITY_MAH * 0.36) / CAP_TRUE;
+        bms_soc_update(&s_pack, 1000U);
+        bms_soh_update(&s_pack, 1000U);
+        s_pack.uptime_ms += 1000U;
+    }
+}
+
+/* Rest, then move SoC by `swing` hundredths at 200 A */
+static void cycle(int32_t swing)
+{
+    int32_t i_ma = (swing > 0) ? 200000 : -200000;
+    uint32_t s = (uint32_t)lround(fabs((double)swing) * BMS_NOMINAL_CAPACITY_MAH *
+                                  0.36 * CAP_TRUE / 200000.0);
+
+    drive(BMS_SOH_REST_MS / 1000U + 5U, 0);
+    drive(s, i_ma);
+}
+
+/* ── Test: module R follows current steps, steady current is ignored ─ */
+static void test_resistance_steps(void)
+{
+    bms_soh_t soh;
+    int n;
+
+    fprintf(stderr, "  test_resistance_steps\n");
+    setup(5000U);
+    scan(1000U, -50000);
+    TEST_ASSERT_EQ(bms_soh_get_module_r_uohm(3U), BMS_SOH_R_MODULE_NOM_UOHM);
+    bms_soh_get(&soh);
+    TEST_ASSERT_EQ(soh.r_events, 0U);
+
+    for (n = 0; n < 200; n++) {
+        scan(500U, (n & 1) ? -50000 : -150000);
+    }
+    bms_soh_get(&soh);
+    fprintf(stderr, "    module 3: %u uOhm (truth %.0f), pack %u, %u events\n",
+            (unsigned)bms_soh_get_module_r_uohm(3U), R_TRUE_UOHM,
+            (unsigned)soh.pack_r_uohm, (unsigned)soh.r_events);
+    TEST_ASSERT_EQ(soh.r_events, 200U * BMS_NUM_MODULES);
+    TEST_ASSERT(absdiff((int32_t)bms_soh_get_module_r_uohm(3U), 3500) <= 35);
+    TEST_ASSERT(absdiff((int32_t)bms_soh_get_module_r_uohm(21U), 3500) <= 35);
+    TEST_ASSERT(absdiff((int32_t)soh.pack_r_uohm, 3500 * (int32_t)BMS_NUM_MODULES) <=
+                35 * (int32_t)BMS_NUM_MODULES);
+}
+
+/* ── Test: capacity from OCV rests around 40 % swings ──────────────── */
+static void test_capacity_swings(void)
+{
+    bms_soh_t soh;
+    int n;
+
+    fprintf(stderr, "  test_capacity_swings\n");
+    setup(9000U);
+    cycle(-1000);                                   /* first rest anchors */
+    bms_soh_get(&soh);
+    TEST_ASSERT_EQ(soh.cap_events, 0U);
+    TEST_ASSERT_EQ(bms_soh_get_capacity_mah(), BMS_NOMINAL_CAPACITY_MAH);
+
+    for (n = 0; n < 8; n++) {
+        cycle((n & 1) ? 4000 : -4000);
+    }
+    drive(BMS_SOH_REST_MS / 1000U + 5U, 0);
+    bms_soh_get(&soh);
+    fprintf(stderr, "    capacity %u mAh (truth %.0f), %u events\n",
+            (unsigned)soh.capacity_mah, CAP_TRUE * BMS_NOMINAL_CAPACITY_MAH,
+            (unsigned)soh.cap_events);
+    TEST_ASSERT_EQ(soh.cap_events, 8U);
+    TEST_ASSERT(absdiff((int32_t)soh.capacity_mah, 115200) <= 1728);   /* ±1.5 % */
+}
+
+/* ── Test: C-rate limits scale with the learned capacity ───────────── */
+static void test_limits_follow_capacity(void)
+{
+    int32_t chg_nom, dchg_nom, chg, dchg;
+
+    fprintf(stderr, "  test_limits_follow_capacity\n");
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.max_temp_deci_c = 250;
+    s_pack.soc_hundredths = 5000U;
+    s_pack.max_cell_mv = 3700U;
+    s_pack.min_cell_mv = 3700U;
+
+    bms_current_limit_set_capacity(BMS_NOMINAL_CAPACITY_MAH);
+    bms_current_limit_compute(&s_pack, &chg_nom, &dchg_nom);
+    TEST_ASSERT(chg_nom > 0 && dchg_nom > 0);
+
+    bms_current_limit_set_capacity(115230U);        /* → 1152 mA per 0.01 C */
+    bms_current_limit_compute(&s_pack, &chg, &dchg);
+    TEST_ASSERT_EQ(chg, chg_nom / 1280 * 1152);
+    TEST_ASSERT_EQ(dchg, dchg_nom / 1280 * 1152);
+
+    bms_current_limit_set_capacity(BMS_NOMINAL_CAPACITY_MAH);
+    bms_current_limit_compute(&s_pack, &chg, &dchg);
+    TEST_ASSERT_EQ(chg, chg_nom);
+}
+
+/* ── Test: estimates reach NVM through the NVM task and come back ──── */
+static void test_persist_restore(void)
+{
+    static bms_nvm_ctx_t ctx, boot;
+    bms_soh_t soh;
+    uint32_t cap, r3;
+    int n;
+
+    fprintf(stderr, "  test_persist_restore\n");
+    mock_reset_all();
+    bms_nvm_init(&ctx);
+    setup(9000U);
+    TEST_ASSERT(!bms_soh_flush(&ctx));              /* nothing learned */
+
+    for (n = 0; n < 20; n++) { scan(500U, (n & 1) ? -50000 : -150000); }
+    cycle(-4000);
+    drive(BMS_SOH_REST_MS / 1000U + 5U, 0);         /* one capacity event */
+    cap = bms_soh_get_capacity_mah();
+    r3 = bms_soh_get_module_r_uohm(3U);
+    TEST_ASSERT(cap < BMS_NOMINAL_CAPACITY_MAH);
+
+    /* R moved and an hour passed mid-rest: that record took the slot, so
+     * the capacity event waits for the NVM task and the next run */
+    TEST_ASSERT(bms_soh_flush(&ctx));
+    TEST_ASSERT(!bms_soh_flush(&ctx));
+    drive(1U, 0);
+    TEST_ASSERT(bms_soh_flush(&ctx));
+    bms_soh_get(&soh);
+    TEST_ASSERT_EQ(soh.persisted, 2U);
+
+    bms_nvm_init(&boot);                            /* reboot */
+    TEST_ASSERT_EQ(boot.persistent.soh_capacity_mah, cap);
+    TEST_ASSERT_EQ(boot.persistent.soh_module_r_uohm[3], r3);
+
+    bms_soh_init();
+    TEST_ASSERT_EQ(bms_soh_get_capacity_mah(), BMS_NOMINAL_CAPACITY_MAH);
+    bms_soh_restore(&boot.persistent);
+    TEST_ASSERT(absdiff((int32_t)bms_soh_get_capacity_mah(), (int32_t)cap) <= 2);
+    TEST_ASSERT_EQ(bms_soh_get_module_r_uohm(3U), r3);
+    TEST_ASSERT_EQ(bms_soh_get_module_r_uohm(4U), boot.persistent.soh_module_r_uohm[4]);
+    mock_reset_all();
+}
+
+void test_soh_suite(void)
+{
+    test_resistance_steps();
+    test_capacity_swings();
+    test_limits_follow_capacity();
+    test_persist_restore();
+}
@@ -0,0 +1,182 @@
+/**
+ * test_sop.c — State of power: R(T, SoC) table, horizon ordering and
+ *              clamps, 10 Hz throttle, CAN frames
+ */
+
+#include "bms_sop.h"
+#include "bms_soc.h"
+#include "bms_soh.h"
+#include "bms_can_msgs.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+static bms_pack_data_t s_pack;
+
+static void setup(uint16_t soc_hundredths, int16_t temp_deci_c, int32_t limit_ma)
+{
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.soc_hundredths = soc_hundredths;
+    s_pack.max_temp_deci_c = temp_deci_c;
+    s_pack.min_temp_deci_c = temp_deci_c;
+    s_pack.charge_limit_ma = limit_ma;
+    s_pack.discharge_limit_ma = limit_ma;
+    bms_soc_init(soc_hundredths);
+    bms_soh_init();
+    bms_sop_init(&s_pack);
+}
+
+static void check_side(const int32_t *sop, int32_t limit_ma)
+{
+    TEST_ASSERT(sop[0] <= limit_ma);
+    TEST_ASSERT(sop[1] <= sop[0]);
+    TEST_ASSERT(sop[2] <= sop[1]);
+    TEST_ASSERT(sop[2] >= 0);
+}
+
+/* ── Test: cell R from the module table, interpolated and clamped ──── */
+static void test_r_table(void)
+{
+    fprintf(stderr, "  test_r_table\n");
+    TEST_ASSERT_EQ(bms_sop_cell_r_uohm(250, 5000U), 221U);     /* 3100 / 14 */
+    TEST_ASSERT_EQ(bms_sop_cell_r_uohm(-100, 500U), 1093U);    /* 15300 / 14 */
+    TEST_ASSERT_EQ(bms_sop_cell_r_uohm(175, 5000U), 254U);     /* 3550 / 14 */
+    TEST_ASSERT_EQ(bms_sop_cell_r_uohm(250, 4250U), 229U);     /* 3200 / 14 */
+    TEST_ASSERT_EQ(bms_sop_cell_r_uohm(-300, 0U), bms_sop_cell_r_uohm(-100, 500U));
+    TEST_ASSERT_EQ(bms_sop_cell_r_uohm(600, 10000U), bms_sop_cell_r_uohm(450, 9500U));
+}
+
+/* ── Test: longer horizons never allow more, limits always cap ─────── */
+static void test_horizons(void)
+{
+    fprintf(stderr, "  test_horizons\n");
+
+    /* Warm, mid SoC: the instantaneous limit binds the short horizon */
+    setup(5000U, 250, 400000);
+    bms_sop_compute(&s_pack);
+    fprintf(stderr, "    25 C 50 %%: dchg %ld / %ld / %ld, chg %ld / %ld / %ld mA\n",
+            (long)s_pack.sop_discharge_ma[0], (long)s_pack.sop_discharge_ma[1],
+            (long)s_pack.sop_discharge_ma[2], (long)s_pack.sop_charge_ma[0],
+            (long)s_pack.sop_charge_ma[1], (long)s_pack.sop_charge_ma[2]);
+    check_side(s_pack.sop_discharge_ma, 400000);
+    check_side(s_pack.sop_charge_ma, 400000);
+    TEST_ASSERT_EQ(s_pack.sop_discharge_ma[0], 400000);
+    TEST_ASSERT_EQ(s_pack.sop_discharge_r_uohm, 221U);
+    TEST_ASSERT_EQ(s_pack.sop_charge_r_uohm, 221U);
+
+    /* Cold and nearly empty: the voltage model binds, 30 s well below 2 s */
+    setup(1000U, -100, 2000000);
+    bms_sop_compute(&s_pack);
+    check_side(s_pack.sop_discharge_ma, 2000000);
+    TEST_ASSERT(s_pack.sop_discharge_ma[0] < 2000000);
+    TEST_ASSERT(s_pack.sop_discharge_ma[2] < s_pack.sop_discharge_ma[0]);
+    TEST_ASSERT(s_pack.sop_discharge_ma[2] > 0);
+
+    /* Nearly full: charge is voltage-bound too */
+    setup(9500U, 250, 2000000);
+    bms_sop_compute(&s_pack);
+    check_side(s_pack.sop_charge_ma, 2000000);
+    TEST_ASSERT(s_pack.sop_charge_ma[2] < s_pack.sop_charge_ma[0]);
+    TEST_ASSERT(s_pack.sop_discharge_ma[2] > s_pack.sop_charge_ma[2]);
+}
+
+/* ── Test: a side derated to zero stays at zero ────────────────────── */
+static void test_zero_limit(void)
+{
+    uint8_t k;
+
+    fprintf(stderr, "  test_zero_limit\n");
+    setup(5000U, 250, 400000);
+    s_pack.charge_limit_ma = 0;
+    bms_sop_compute(&s_pack);
+    for (k = 0U; k < BMS_SOP_HORIZONS; k++) {
+        TEST_ASSERT_EQ(s_pack.sop_charge_ma[k], 0);
+        TEST_ASSERT(s_pack.sop_discharge_ma[k] > 0);
+    }
+
+    /* Discharging from the limiting SE, not the pack average */
+    setup(5000U, 250, 2000000);
+    s_pack.cell_soc_valid = true;
+    s_pack.cell_soc_min_hundredths = 500U;
+    s_pack.cell_soc_max_hundredths = 5000U;
+    bms_sop_compute(&s_pack);
+    TEST_ASSERT_EQ(s_pack.sop_discharge_r_uohm, bms_sop_cell_r_uohm(250, 500U));
+    TEST_ASSERT(s_pack.sop_discharge_ma[2] < s_pack.sop_charge_ma[2]);
+}
+
+/* ── Test: recomputed every BMS_SOP_PERIOD_MS of monitor time ──────── */
+static void test_throttle(void)
+{
+    fprintf(stderr, "  test_throttle\n");
+    setup(5000U, 250, 400000);
+    bms_sop_update(&s_pack, BMS_SOP_PERIOD_MS / 2U);
+    TEST_ASSERT_EQ(s_pack.sop_discharge_ma[0], 0);
+    bms_sop_update(&s_pack, BMS_SOP_PERIOD_MS / 2U);
+    TEST_ASSERT_EQ(s_pack.sop_discharge_ma[0], 400000);
+
+    s_pack.discharge_limit_ma = 100000;
+    bms_sop_update(&s_pack, BMS_SOP_PERIOD_MS - 1U);
+    TEST_ASSERT_EQ(s_pack.sop_discharge_ma[0], 400000);
+    bms_sop_update(&s_pack, 1U);
+    TEST_ASSERT_EQ(s_pack.sop_discharge_ma[0], 100000);
+}
+
+/* ── Test: CAN_ID_SOP_DCHG / CHG carry 100 mA steps, saturate ──────── */
+static void test_can_export(void)
+{
+    bms_can_frame_t fd, fc;
+    bms_can_msg_sop_dchg_t d;
+    bms_can_msg_sop_chg_t c;
+
+    fprintf(stderr, "  test_can_export\n");
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.sop_discharge_ma[0] = 900000;
+    s_pack.sop_discharge_ma[1] = 412345;
+    s_pack.sop_discharge_ma[2] = 0;
+    s_pack.sop_discharge_r_uohm = 1093U;
+    s_pack.sop_charge_ma[0] = 300000;
+    s_pack.sop_charge_ma[1] = 250000;
+    s_pack.sop_charge_ma[2] = 120000;
+    s_pack.sop_charge_r_uohm = 221U;
+
+    bms_sop_encode_can(&s_pack, &fd, &fc);
+    TEST_ASSERT_EQ(fd.id, CAN_ID_SOP_DCHG);
+    TEST_ASSERT_EQ(fc.id, CAN_ID_SOP_CHG);
+    TEST_ASSERT_EQ(fd.dlc, 8U);
+    TEST_ASSERT_EQ(fc.dlc, 8U);
+
+    bms_can_msg_sop_dchg_decode(&fd, &d);
+    bms_can_msg_sop_chg_decode(&fc, &c);
+    TEST_ASSERT_EQ(d.i_2s_ma, 655300);                         /* saturated */
+    TEST_ASSERT_EQ(d.i_10s_ma, 412300);
+    TEST_ASSERT_EQ(d.i_30s_ma, 0);
+    TEST_ASSERT_EQ(d.r_uohm, 1093U);
+    TEST_ASSERT_EQ(c.i_2s_ma, 300000);
+    TEST_ASSERT_EQ(c.i_10s_ma, 250000);
+    TEST_ASSERT_EQ(c.i_30s_ma, 120000);
+    TEST_ASSERT_EQ(c.r_uohm, 221U);
+}
+
+void test_sop_suite(void)
+{
+    test_r_table();
+    test_horizons();
+    test_zero_limit();
+    test_throttle();
+    test_can_export();
+}
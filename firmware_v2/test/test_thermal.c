@@ -0,0 +1,141 @@
+/**
+ * test_thermal.c — dT/dt estimator and alarm tests
+ */
+
+#include "bms_thermal.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+extern void mock_reset_all(void);
+
+static bms_pack_data_t s_pack;
+static bms_thermal_state_t s_therm;
+
+static void set_all_temps(int16_t deci_c)
+{
+    uint8_t mod, sens;
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            s_pack.modules[mod].temp_deci_c[sens] = deci_c;
+        }
+    }
+}
+
+static void setup(void)
+{
+    mock_reset_all();
+    memset(&s_pack, 0, sizeof(s_pack));
+    bms_thermal_init(&s_therm);
+    set_all_temps(250);
+}
+
+static void step(void)
+{
+    bms_thermal_run(&s_therm, &s_pack, BMS_THERMAL_PERIOD_MS);
+}
+
+/* ── Test: flat temperature → zero slope, no alarm ─────────────────── */
+static void test_flat_no_alarm(void)
+{
+    uint16_t k;
+    setup();
+    for (k = 0U; k < 120U; k++) { step(); }
+    TEST_ASSERT_EQ(bms_thermal_get_dtdt(&s_therm, 0U), 0);
+    TEST_ASSERT(!bms_thermal_alarm_active(&s_therm));
+}
+
+/* ── Test: linear ramp 1 deci-°C/s → 60 deci-°C/min ─────────────────── */
+static void test_ramp_slope(void)
+{
+    uint16_t k;
+    setup();
+    for (k = 0U; k < 100U; k++) {
+        s_pack.modules[5].temp_deci_c[1] = (int16_t)(250 + k);
+        step();
+    }
+    {
+        int16_t r = bms_thermal_get_dtdt(&s_therm, 5U * BMS_TEMPS_PER_MODULE + 1U);
+        TEST_ASSERT(r >= 59 && r <= 61);
+    }
+    TEST_ASSERT_EQ(bms_thermal_get_dtdt(&s_therm, 0U), 0);
+}
+
+/* ── Test: sustained 2 °C/min rise with no load → alarm ────────────── */
+static void test_runaway_alarm(void)
+{
+    uint16_t k;
+    setup();
+    for (k = 0U; k < 120U; k++) {
+        s_pack.modules[10].temp_deci_c[0] = (int16_t)(250 + (20 * k) / 60);
+        step();
+    }
+    TEST_ASSERT(bms_thermal_alarm_active(&s_therm));
+    TEST_ASSERT_EQ(s_pack.faults.dtdt_alarm, 1U);
+    TEST_ASSERT_EQ(s_therm.alarm_sensor_idx, 10U * BMS_TEMPS_PER_MODULE);
+}
+
+/* ── Test: repeated single-sample spikes do not alarm ──────────────── */
+static void test_spikes_no_alarm(void)
+{
+    uint16_t k;
+    int16_t worst = 0;
+    setup();
+    for (k = 0U; k < 300U; k++) {
+        /* +5 °C glitch on every other sample, flat underneath */
+        s_pack.modules[2].temp_deci_c[2] = ((k % 2U) == 1U) ? 300 : 250;
+        step();
+        if (k >= 3U * BMS_DTDT_WINDOW_SAMPLES) {   /* past warm-up */
+            int16_t r = bms_thermal_get_dtdt(&s_therm, 2U * BMS_TEMPS_PER_MODULE + 2U);
+            if (r < 0) { r = (int16_t)-r; }
+            if (r > worst) { worst = r; }
+        }
+    }
+    TEST_ASSERT(!bms_thermal_alarm_active(&s_therm));
+    TEST_ASSERT(worst <= BMS_DTDT_ALARM_DECI_C_PER_MIN);
+}
+
+/* ── Test: faulted sensor holds its last good reading ──────────────── */
+static void test_faulted_sensor_held(void)
+{
+    uint16_t k;
+    setup();
+    for (k = 0U; k < 40U; k++) { step(); }
+    s_pack.modules[0].sensor_fault[0].faulted = true;
+    s_pack.modules[0].temp_deci_c[0] = -400;      /* open thermistor */
+    for (k = 0U; k < 40U; k++) { step(); }
+    TEST_ASSERT_EQ(bms_thermal_get_dtdt(&s_therm, 0U), 0);
+    TEST_ASSERT(!bms_thermal_alarm_active(&s_therm));
+}
+
+/* ── Test: history is smaller than the old 66 × 30 int16 ring ──────── */
+static void test_state_size(void)
+{
+    TEST_ASSERT(sizeof(bms_thermal_state_t) <
+                (size_t)BMS_TOTAL_TEMP_SENSORS * BMS_DTDT_WINDOW_SAMPLES * 2U);
+}
+
+void test_thermal_suite(void)
+{
+    test_flat_no_alarm();
+    test_ramp_slope();
+    test_runaway_alarm();
+    test_spikes_no_alarm();
+    test_faulted_sensor_held();
+    test_state_size();
+}
@@ -0,0 +1,168 @@
+/**
+ * test_trace.c — per-task runtime trace: exec time, jitter, misses, stacks
+ */
+
+#include "bms_trace.h"
+#include "bms_config.h"
+#include "bms_can_msgs.h"
+#include <stdio.h>
+#include <string.h>
+
+extern int g_tests_run, g_tests_passed, g_tests_failed;
+#define TEST_ASSERT(expr) do { \
+    g_tests_run++; \
+    if (expr) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); } \
+} while (0)
+#define TEST_ASSERT_EQ(a, b) do { \
+    g_tests_run++; \
+    if ((a) == (b)) { g_tests_passed++; } \
+    else { g_tests_failed++; \
+        fprintf(stderr, "  FAIL: %s:%d: %s == %s (%ld != %ld)\n", \
+                __FILE__, __LINE__, #a, #b, (long)(a), (long)(b)); } \
+} while (0)
+
+/* Microseconds → trace ticks, with an arbitrary base so wrap is exercised */
+static uint32_t us(uint32_t v)
+{
+    return 0xFFF00000U + v * bms_trace_ticks_per_us();
+}
+
+/* One release of task id at start_us running for exec_us */
+static void run(bms_trace_task_t id, uint32_t start_us, uint32_t exec_us)
+{
+    bms_trace_begin_at(id, us(start_us));
+    bms_trace_end_at(id, us(start_us + exec_us));
+}
+
+static void test_exec_stats(void)
+{
+    bms_trace_stats_t st;
+
+    fprintf(stderr, "  test_exec_stats\n");
+    bms_trace_init();
+    bms_trace_register(TRACE_PROTECTION, 10U, 512U);
+
+    run(TRACE_PROTECTION, 0U, 300U);
+    run(TRACE_PROTECTION, 10000U, 500U);
+    run(TRACE_PROTECTION, 20000U, 700U);
+    bms_trace_get(TRACE_PROTECTION, &st);
+    TEST_ASSERT_EQ(st.runs, 3U);
+    TEST_ASSERT_EQ(st.min_us, 300U);
+    TEST_ASSERT_EQ(st.mean_us, 500U);
+    TEST_ASSERT_EQ(st.max_us, 700U);
+    TEST_ASSERT_EQ(st.jitter_max_us, 0U);
+    TEST_ASSERT_EQ(st.misses, 0U);
+    TEST_ASSERT_EQ(st.period_ms, 10U);
+
+    /* Untouched entries stay zero */
+    bms_trace_get(TRACE_THERMAL, &st);
+    TEST_ASSERT_EQ(st.runs, 0U);
+    TEST_ASSERT_EQ(st.mean_us, 0U);
+}
+
+static void test_jitter_and_misses(void)
+{
+    bms_trace_stats_t st;
+
+    fprintf(stderr, "  test_jitter_and_misses\n");
+    bms_trace_init();
+    bms_trace_register(TRACE_STATE, 100U, 384U);
+
+    run(TRACE_STATE, 0U, 1000U);
+    run(TRACE_STATE, 30000U, 1000U);        /* early, event-woken: not late */
+    run(TRACE_STATE, 130000U, 1000U);
+    run(TRACE_STATE, 232000U, 1000U);       /* 2 ms late, still in time */
+    bms_trace_get(TRACE_STATE, &st);
+    TEST_ASSERT_EQ(st.jitter_max_us, 2000U);
+    TEST_ASSERT_EQ(st.misses, 0U);
+
+    run(TRACE_STATE, 332000U, 100001U);     /* overruns its own period */
+    run(TRACE_STATE, 500000U, 40000U);      /* 68 ms late + 40 ms > 100 ms */
+    run(TRACE_STATE, 600000U, 1000U);       /* back on time */
+    bms_trace_get(TRACE_STATE, &st);
+    TEST_ASSERT_EQ(st.misses, 2U);
+    TEST_ASSERT_EQ(st.jitter_max_us, 68000U);
+    TEST_ASSERT_EQ(st.max_us, 100001U);
+    TEST_ASSERT_EQ(st.runs, 7U);
+}
+
+static void test_stack_and_can(void)
+{
+    bms_trace_stats_t st;
+    bms_can_frame_t f;
+    bms_can_msg_task_trace_t m;
+    uint8_t i;
+
+    fprintf(stderr, "  test_stack_and_can\n");
+    bms_trace_init();
+    bms_trace_register(TRACE_MONITOR, 10U, 512U);
+    bms_trace_register(TRACE_NVM, 100U, 400U);
+
+    bms_trace_stack(TRACE_MONITOR, 300U);
+    bms_trace_stack(TRACE_MONITOR, 128U);
+    bms_trace_stack(TRACE_MONITOR, 200U);   /* high-water keeps the least */
+    bms_trace_get(TRACE_MONITOR, &st);
+    TEST_ASSERT_EQ(st.stack_words, 512U);
+    TEST_ASSERT_EQ(st.stack_free_min, 128U);
+
+    run(TRACE_MONITOR, 0U, 250U);
+    run(TRACE_MONITOR, 10000U, 150U);
+    run(TRACE_NVM, 0U, 70000U);             /* saturates the u16 field */
+    for (i = 0U; i < 3U; i++) { run(TRACE_NVM, 200000U + i * 300000U, 150000U); }
+
+    bms_trace_encode_can(TRACE_MONITOR, &f);
+    TEST_ASSERT_EQ(f.id, CAN_ID_TASK_TRACE + TRACE_MONITOR);
+    TEST_ASSERT_EQ(f.dlc, 8U);
+    bms_can_msg_task_trace_decode(&f, &m);
+    TEST_ASSERT_EQ(m.max_us, 250U);
+    TEST_ASSERT_EQ(m.mean_us, 200U);
+    TEST_ASSERT_EQ(m.misses, 0U);
+    TEST_ASSERT_EQ(m.stack_used_pct, 75U);
+
+    bms_trace_encode_can(TRACE_NVM, &f);
+    bms_can_msg_task_trace_decode(&f, &m);
+    TEST_ASSERT_EQ(f.id, CAN_ID_TASK_TRACE + TRACE_NVM);
+    TEST_ASSERT_EQ(m.max_us, 0xFFFFU);
+    TEST_ASSERT_EQ(m.misses, 3U);
+    TEST_ASSERT_EQ(m.stack_used_pct, 0U);
+
+    /* Round robin covers every task, then wraps */
+    for (i = 0U; i < (uint8_t)TRACE_TASK_COUNT; i++) {
+        bms_trace_next_can(&f);
+        TEST_ASSERT_EQ(f.id, (uint32_t)CAN_ID_TASK_TRACE + i);
+    }
+    bms_trace_next_can(&f);
+    TEST_ASSERT_EQ(f.id, CAN_ID_TASK_TRACE);
+}
+
+static void test_live_clock(void)
+{
+    bms_trace_stats_t st;
+    volatile uint32_t spin = 0U;
+    uint32_t i;
+
+    fprintf(stderr, "  test_live_clock\n");
+    bms_trace_init();
+    bms_trace_register(TRACE_CAN, 10U, 256U);
+    for (i = 0U; i < 3U; i++) {
+        bms_trace_begin(TRACE_CAN);
+        while (spin < (i + 1U) * 200000U) { spin++; }
+        bms_trace_end(TRACE_CAN);
+    }
+    bms_trace_get(TRACE_CAN, &st);
+    TEST_ASSERT_EQ(st.runs, 3U);
+    TEST_ASSERT(st.min_us <= st.mean_us);
+    TEST_ASSERT(st.mean_us <= st.max_us);
+    TEST_ASSERT(st.max_us < 1000000U);
+    bms_trace_report();
+}
+
+void test_trace_suite(void)
+{
+    test_exec_stats();
+    test_jitter_and_misses();
+    test_stack_and_can();
+    test_live_clock();
+}
@@ -0,0 +1,445 @@
+/**
+ * wcet_harness.c — worst-case instruction/cycle budgets of the periodic
+ *                  functions, under adversarial inputs
+ *
+ * make wcet  (builds at -O2 with BMS_LOG_OFF, as on target; exits 1 if any
+ * case exceeds its instruction budget or its estimated target time
+ * exceeds the bms_config WCET budget the schedule check relies on)
+ *
+ * Counting: the case runs in a forked child that single-steps under
+ * ptrace, so every user-mode instruction between two SIGSTOPs is counted
+ * exactly — deterministic, no emulator or PMU access needed. Only the
+ * call under test is stepped; setup runs free between the stops.
+ *
+ * Cycles are approximate: host (x86-64) instructions × WCET_CYCLES_PER_INSN
+ * for a Cortex-M4 at BMS_CPU_HZ (Thumb-2 needs somewhat more instructions
+ * for the same integer code, CPI > 1 with flash wait states). Budgets in
+ * instructions are the regression gate and are host/compiler-specific;
+ * the µs check is the sanity bound against the schedule. Target numbers
+ * still come from bms_trace on hardware.
+ */
+
+#define _GNU_SOURCE
+#include "bms_protection.h"
+#include "bms_monitor.h"
+#include "bms_thermal.h"
+#include "bms_can.h"
+#include "bms_soc.h"
+#include "bms_cell_soc.h"
+#include "bms_soh.h"
+#include "bms_sop.h"
+#include "bms_can_txq.h"
+#include "bms_nvm_queue.h"
+#include "bms_config.h"
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define WCET_CYCLES_PER_INSN_X10  20U   /* M4 cycles per host instruction, ×10 */
+#define WCET_REPS                 4U    /* calls measured per case, max kept */
+
+extern void mock_reset_all(void);
+
+typedef struct {
+    const char *name;
+    void     (*setup)(uint32_t rep);    /* adversarial state, not counted */
+    void     (*run)(void);              /* the call under test */
+    uint32_t insn_budget;               /* host instructions, -O2 */
+    uint32_t target_us;                 /* bms_config WCET it must fit */
+} wcet_case_t;
+
+static bms_pack_data_t        s_pack;
+static bms_protection_state_t s_prot;
+static bms_thermal_state_t    s_therm;
+
+/* ── Adversarial pack states ───────────────────────────────────────── */
+
+static void pack_base(void)
+{
+    uint8_t mod, sens;
+
+    mock_reset_all();
+    memset(&s_pack, 0, sizeof(s_pack));
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            s_pack.modules[mod].temp_deci_c[sens] = 250;
+        }
+    }
+    s_pack.mode = BMS_MODE_CONNECTED;
+    s_pack.uptime_ms = 3600000U;
+}
+
+/* Alternate cells at the OV and UV fault levels, every sensor hot, charge
+ * current below freezing and over the limit: every per-cell, per-sensor,
+ * OC, sub-zero and warning integrator active, none yet tripping */
+static void prot_all_active(uint32_t rep)
+{
+    uint16_t i;
+    uint8_t mod, sens;
+
+    (void)rep;
+    pack_base();
+    bms_protection_init(&s_prot);
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        s_pack.cell_mv[i] = ((i & 1U) != 0U) ? BMS_SE_OV_FAULT_MV : BMS_SE_UV_FAULT_MV;
+        s_prot.ov_timer_ms[i] = (uint16_t)(BMS_SE_FAULT_DELAY_MS / 2U);
+        s_prot.uv_timer_ms[i] = (uint16_t)(BMS_SE_FAULT_DELAY_MS / 2U);
+    }
+    for (i = 0U; i < BMS_TOTAL_TEMP_SENSORS; i++) {
+        s_prot.ot_timer_ms[i] = (uint16_t)(BMS_SE_FAULT_DELAY_MS / 2U);
+    }
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        s_prot.ov_active[mod] = (uint16_t)((1UL << BMS_SE_PER_MODULE) - 1U);
+        s_prot.uv_active[mod] = (uint16_t)((1UL << BMS_SE_PER_MODULE) - 1U);
+        s_prot.ot_active[mod] = (uint16_t)((1UL << BMS_TEMPS_PER_MODULE) - 1U);
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            s_pack.modules[mod].temp_deci_c[sens] = BMS_SE_OT_FAULT_DECI_C;
+        }
+    }
+    s_pack.max_cell_mv = BMS_SE_OV_FAULT_MV;
+    s_pack.min_cell_mv = BMS_SE_UV_FAULT_MV;
+    s_pack.max_temp_deci_c = BMS_SE_OT_FAULT_DECI_C;
+    s_pack.min_temp_deci_c = -50;
+    s_pack.pack_current_ma = (int32_t)BMS_MAX_CHARGE_MA + 1000;
+    s_prot.subzero_charge_timer_ms = 1000U;
+    s_prot.oc_charge_timer_ms = 1000U;
+    s_prot.warn_ov_timer_ms = 1000U;
+    s_prot.warn_uv_timer_ms = 1000U;
+    s_prot.warn_ot_timer_ms = 1000U;
+}
+
+/* As above, with the last OT integrator one period from tripping: the
+ * longest path that reaches a latch and an NVM queue push */
+static void prot_trip_last(uint32_t rep)
+{
+    prot_all_active(rep);
+    s_prot.ot_timer_ms[BMS_TOTAL_TEMP_SENSORS - 1U] =
+        (uint16_t)(BMS_SE_FAULT_DELAY_MS - BMS_PROTECTION_PERIOD_MS);
+}
+
+static void run_protection(void)
+{
+    bms_protection_run(&s_prot, &s_pack, BMS_PROTECTION_PERIOD_MS);
+}
+
+/* Cells spread 2.5…4.3 V, module temperatures stepping past the
+ * inter-module delta: every extreme, imbalance and plausibility branch */
+static void agg_spread(uint32_t rep)
+{
+    uint16_t i;
+    uint8_t mod, sens;
+
+    (void)rep;
+    pack_base();
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        s_pack.cell_mv[i] = (uint16_t)(2500U + (i * 7U) % 1800U);
+    }
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            s_pack.modules[mod].temp_deci_c[sens] =
+                (int16_t)(((mod & 1U) != 0U) ? 650 : 100) + (int16_t)sens;
+        }
+    }
+}
+
+static void agg_all_faulted(uint32_t rep)
+{
+    uint8_t mod, sens;
+
+    agg_spread(rep);
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            s_pack.modules[mod].sensor_fault[sens].faulted = true;
+        }
+    }
+}
+
+static void run_aggregate(void)
+{
+    bms_monitor_aggregate(&s_pack);
+}
+
+/* A full dT/dt window with every sensor rising 0.5 °C/s at no load and
+ * the fan stalled under a cooling command */
+static void thermal_rising(uint32_t rep)
+{
+    uint8_t k, mod, sens;
+
+    (void)rep;
+    pack_base();
+    bms_thermal_init(&s_therm);
+    for (k = 0U; k < BMS_DTDT_WINDOW_SAMPLES - 1U; k++) {
+        for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+            for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+                s_pack.modules[mod].temp_deci_c[sens] = (int16_t)(250 + 5 * (int16_t)k);
+            }
+        }
+        bms_thermal_run(&s_therm, &s_pack, BMS_THERMAL_PERIOD_MS);
+    }
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            s_pack.modules[mod].temp_deci_c[sens] += 5;
+        }
+    }
+    s_therm.cooling_commanded = true;
+}
+
+static void thermal_all_faulted(uint32_t rep)
+{
+    uint8_t mod, sens;
+
+    thermal_rising(rep);
+    for (mod = 0U; mod < BMS_NUM_MODULES; mod++) {
+        for (sens = 0U; sens < BMS_TEMPS_PER_MODULE; sens++) {
+            s_pack.modules[mod].sensor_fault[sens].faulted = true;
+        }
+    }
+}
+
+static void run_thermal(void)
+{
+    bms_thermal_run(&s_therm, &s_pack, BMS_THERMAL_PERIOD_MS);
+}
+
+/* Fault latched, every flag set, empty queue each call; the cell
+ * broadcast index advances across the measured calls */
+static void can_tx_faulted(uint32_t rep)
+{
+    if (rep == 0U) {
+        agg_spread(rep);
+        bms_can_init();
+        s_pack.fault_latched = true;
+        memset(&s_pack.faults, 0xFF, sizeof(s_pack.faults));
+        s_pack.pack_current_ma = -(int32_t)BMS_MAX_DISCHARGE_MA;
+    }
+    bms_can_txq_init();
+}
+
+static void run_can_tx(void)
+{
+    bms_can_tx_periodic(&s_pack);
+}
+
+/* SoC EKF correction at its longest: top OCV segment (full table
+ * search), a stalled scan's worth of covariance decay, full current */
+static void soc_ekf_stalled(uint32_t rep)
+{
+    (void)rep;
+    memset(&s_pack, 0, sizeof(s_pack));
+    s_pack.pack_current_ma = -(int32_t)BMS_MAX_DISCHARGE_MA;
+    s_pack.avg_cell_mv = 4100U;
+    bms_soc_init(9990U);
+    bms_soc_update(&s_pack, 60000U);
+}
+
+static void run_soc_correct(void)
+{
+    bms_soc_correct(&s_pack);
+}
+
+/* Per-SE SoC, one module's update plus the pack reduction: every cell
+ * clamped (full-scale residual), the charge step at its clamp */
+static void cell_soc_stalled(uint32_t rep)
+{
+    uint16_t i;
+
+    (void)rep;
+    memset(&s_pack, 0, sizeof(s_pack));
+    for (i = 0U; i < BMS_SE_PER_PACK; i++) {
+        s_pack.cell_mv[i] = (i & 1U) ? 4190U : 3000U;
+    }
+    s_pack.pack_current_ma = -(int32_t)BMS_MAX_DISCHARGE_MA;
+    bms_soc_init(9990U);
+    bms_cell_soc_init();
+    bms_cell_soc_update_module(&s_pack, 0U);
+    bms_soc_update(&s_pack, 60000U);
+    s_pack.uptime_ms = 60000U;
+}
+
+static void run_cell_soc(void)
+{
+    bms_cell_soc_update_module(&s_pack, 0U);
+    bms_cell_soc_publish(&s_pack);
+}
+
+/* SoH at its longest: module 0 sees a full-scale current step, the same
+ * run closes a rest 8000+ hundredths from the last one (capacity fit)
+ * and hands a record to the NVM task */
+static void soh_step_and_rest(uint32_t rep)
+{
+    uint8_t i;
+
+    (void)rep;
+    memset(&s_pack, 0, sizeof(s_pack));
+    bms_soc_init(9000U);
+    bms_soh_init();
+    s_pack.avg_cell_mv = 4000U;
+    bms_soh_update(&s_pack, BMS_SOH_REST_MS);                /* anchor */
+    s_pack.pack_current_ma = -(int32_t)BMS_MAX_DISCHARGE_MA;
+    for (i = 0U; i < 3U; i++) {
+        bms_soc_update(&s_pack, 60000U);
+        bms_soh_update(&s_pack, 60000U);
+    }
+    s_pack.uptime_ms = 180000U;
+    s_pack.modules[0].stack_mv = 48000U;
+    bms_soh_module_scan(&s_pack, 0U);
+    s_pack.pack_current_ma = 0;
+    s_pack.avg_cell_mv = 3500U;
+    bms_soh_update(&s_pack, BMS_SOH_REST_MS - BMS_MONITOR_PERIOD_MS);
+    s_pack.modules[0].stack_mv = 51800U;
+    s_pack.uptime_ms += BMS_MONITOR_PERIOD_MS;
+}
+
+static void run_soh(void)
+{
+    bms_soh_module_scan(&s_pack, 0U);
+    bms_soh_update(&s_pack, BMS_MONITOR_PERIOD_MS);
+}
+
+/* SoP with both sides voltage-bound: cold, SEs at the ends of the SoC
+ * range, limits lifted so every horizon runs both passes of the solve */
+static void sop_both_bound(uint32_t rep)
+{
+    (void)rep;
+    memset(&s_pack, 0, sizeof(s_pack));
+    bms_soc_init(5000U);
+    bms_soh_init();
+    s_pack.soc_hundredths = 5000U;
+    s_pack.min_temp_deci_c = -50;
+    s_pack.max_temp_deci_c = 50;
+    s_pack.cell_soc_valid = true;
+    s_pack.cell_soc_min_hundredths = 700U;
+    s_pack.cell_soc_max_hundredths = 9300U;
+    s_pack.charge_limit_ma = 2000000;
+    s_pack.discharge_limit_ma = 2000000;
+    bms_sop_init(&s_pack);
+}
+
+static void run_sop(void)
+{
+    bms_sop_compute(&s_pack);
+}
+
+static void setup_none(uint32_t rep) { (void)rep; }
+static void run_none(void) { }
+
+/* Instruction budgets: measured worst case + ~25 %, gcc -O2 x86-64. Raise
+ * one only with the reason in the commit; the µs column must still fit. */
+static const wcet_case_t k_cases[] = {
+    { "protection/all-active",  prot_all_active,     run_protection,  33000U, BMS_PROTECTION_WCET_US },
+    { "protection/trip-last",   prot_trip_last,      run_protection,  30000U, BMS_PROTECTION_WCET_US },
+    { "aggregate/spread",       agg_spread,          run_aggregate,    7500U, BMS_MONITOR_WCET_US },
+    { "aggregate/all-faulted",  agg_all_faulted,     run_aggregate,    6700U, BMS_MONITOR_WCET_US },
+    { "thermal/all-rising",     thermal_rising,      run_thermal,      7800U, BMS_THERMAL_WCET_US },
+    { "thermal/all-faulted",    thermal_all_faulted, run_thermal,      7000U, BMS_THERMAL_WCET_US },
+    { "can_tx/fault-latched",   can_tx_faulted,      run_can_tx,        700U, BMS_CAN_TX_WCET_US },
+    { "soc/ekf-correct",        soc_ekf_stalled,     run_soc_correct,  1150U, BMS_MONITOR_WCET_US },
+    { "cell_soc/module",        cell_soc_stalled,    run_cell_soc,     1700U, BMS_MONITOR_WCET_US },
+    { "soh/step-and-rest",      soh_step_and_rest,   run_soh,           560U, BMS_MONITOR_WCET_US },
+    { "sop/compute",            sop_both_bound,      run_sop,          4000U, BMS_MONITOR_WCET_US },
+};
+
+#define WCET_CASES  (sizeof(k_cases) / sizeof(k_cases[0]))
+
+/* ── Counting ──────────────────────────────────────────────────────── */
+
+static void child(const wcet_case_t *c)
+{
+    uint32_t r;
+
+    (void)ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+    for (r = 0U; r < WCET_REPS; r++) {
+        c->setup(r);
+        (void)raise(SIGSTOP);       /* counting starts */
+        c->run();
+        (void)raise(SIGSTOP);       /* counting stops */
+    }
+    _exit(0);
+}
+
+static int wait_stop(pid_t pid)
+{
+    int st;
+
+    if (waitpid(pid, &st, 0) < 0 || WIFEXITED(st) || WIFSIGNALED(st)) { return -1; }
+    return WSTOPSIG(st);
+}
+
+/* Max instructions over WCET_REPS calls, raise() overhead included;
+ * -1 if the child could not be traced */
+static long count_case(const wcet_case_t *c)
+{
+    long max = 0;
+    uint32_t r;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) { return -1; }
+    if (pid == 0) { child(c); }
+
+    for (r = 0U; r < WCET_REPS; r++) {
+        long steps = 0;
+        int sig;
+
+        if (wait_stop(pid) != SIGSTOP) { return -1; }  /* before run */
+        for (;;) {
+            if (ptrace(PTRACE_SINGLESTEP, pid, NULL, NULL) < 0) { return -1; }
+            sig = wait_stop(pid);
+            if (sig == SIGSTOP) { break; }
+            if (sig != SIGTRAP) { return -1; }
+            steps++;
+        }
+        if (steps > max) { max = steps; }
+        (void)ptrace(PTRACE_CONT, pid, NULL, NULL);     /* setup runs free */
+    }
+    (void)waitpid(pid, NULL, 0);
+    return max;
+}
+
+int main(void)
+{
+    static const wcet_case_t k_empty = { "empty", setup_none, run_none, 0U, 0U };
+    long overhead = count_case(&k_empty);
+    unsigned fails = 0U;
+    size_t i;
+
+    if (overhead < 0) {
+        fprintf(stderr, "wcet: cannot single-step a child (ptrace denied?)\n");
+        return 2;
+    }
+
+    printf("WCET harness — host instructions × %u.%u ≈ M4 cycles @ %u MHz\n",
+           WCET_CYCLES_PER_INSN_X10 / 10U, WCET_CYCLES_PER_INSN_X10 % 10U,
+           (unsigned)(BMS_CPU_HZ / 1000000U));
+    printf("%-24s %10s %10s %9s %8s %8s\n",
+           "case", "insns", "budget", "cycles", "est µs", "WCET µs");
+
+    for (i = 0U; i < WCET_CASES; i++) {
+        const wcet_case_t *c = &k_cases[i];
+        long n = count_case(c);
+        unsigned long insns, cycles, us;
+        bool ok;
+
+        if (n < 0) {
+            printf("%-24s  trace failed\n", c->name);
+            fails++;
+            continue;
+        }
+        insns = (unsigned long)((n > overhead) ? (n - overhead) : 0);
+        cycles = insns * WCET_CYCLES_PER_INSN_X10 / 10U;
+        us = (cycles + BMS_CPU_HZ / 1000000U - 1U) / (BMS_CPU_HZ / 1000000U);
+        ok = insns <= c->insn_budget && us <= c->target_us;
+        printf("%-24s %10lu %10lu %9lu %8lu %8u%s\n", c->name, insns,
+               (unsigned long)c->insn_budget, cycles, us, (unsigned)c->target_us,
+               ok ? "" : "  OVER");
+        if (!ok) { fails++; }
+    }
+
+    printf("%s\n", (fails == 0U) ? "wcet: all within budget" : "wcet: BUDGET EXCEEDED");
+    return (fails == 0U) ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file can_log_decode.c
+ * @brief Decode candump -l logs using the firmware message table
+ *
+ * Street Smart Edition.
+ * Usage:  ./can_log_decode [file]        (stdin when no file is given)
+ *         candump -l can0 && ./can_log_decode candump-*.log
+ * Known IDs print as signals, unknown IDs pass through as raw hex, other
+ * lines are echoed unchanged.
+ */
+
+#include "bms_can_log.h"
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    char line[256];
+    char out[512];
+
+    if (argc > 1) {
+        in = fopen(argv[1], "r");
+        if (in == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        bms_can_frame_t frame;
+        size_t prefix = 0U;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!bms_can_log_parse(line, &frame, &prefix)) {
+            printf("%s\n", line);
+        } else if (bms_can_log_format(&frame, out, sizeof(out)) < 0) {
+            printf("%.*s%03X unknown\n", (int)prefix, line, (unsigned)frame.id);
+        } else {
+            printf("%.*s%03X %s\n", (int)prefix, line, (unsigned)frame.id, out);
+        }
+    }
+
+    if (in != stdin) { fclose(in); }
+    return 0;
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+Derating table generator — Street Smart Edition
+
+Emits inc/bms_derating_tables.h from the Figure 28/29/30 breakpoints so the
+firmware evaluates current limits without a runtime divide.
+
+Each segment stores slope = ceil(|dy| * 2^SHIFT / dx) with the sign of dy.
+At runtime:  y = y0 ± ((x - x0) * |slope|) >> SHIFT   (one UMULL on the M4)
+which reproduces the old y0 + (dy * (x - x0)) / dx (C truncation toward
+zero) bit-exactly. The generator proves that by checking every integer x
+in every segment and refuses to write the header otherwise.
+
+Usage:  python3 tools/gen_derating_tables.py [-o inc/bms_derating_tables.h]
+"""
+
+import argparse
+import math
+import os
+import sys
+
+SHIFT = 28
+
+# (name, axis comment, x breakpoints, y = C-rate × 100)
+CURVES = [
+    # Figure 28 — temperature (deci-°C)
+    ("temp_chg", "Fig. 28 charge vs max temp (deci-C)",
+     [-250, 0, 50, 150, 350, 450, 550, 650],
+     [0, 0, 0, 300, 300, 200, 0, 0]),
+    ("temp_dchg", "Fig. 28 discharge vs max temp (deci-C)",
+     [-250, -150, -100, -50, 0, 50, 100, 250, 300, 350, 450, 550, 600, 650, 700],
+     [20, 20, 100, 150, 200, 450, 500, 500, 450, 400, 380, 380, 20, 20, 0]),
+    # Figure 29 — SoC (hundredths of %)
+    ("soc_chg", "Fig. 29 charge vs SoC (0.01 %)",
+     [0, 8500, 9000, 9500, 10000],
+     [300, 300, 200, 100, 50]),
+    ("soc_dchg", "Fig. 29 discharge vs SoC (0.01 %)",
+     [0, 200, 500, 800, 1000, 1500, 2000, 5000, 10000],
+     [100, 100, 220, 220, 400, 400, 500, 500, 500]),
+    # Figure 30 — SE voltage (mV)
+    ("sev_chg", "Fig. 30 charge vs max cell (mV)",
+     [3000, 4100, 4200],
+     [300, 300, 0]),
+    ("sev_dchg", "Fig. 30 discharge vs min cell (mV)",
+     [3000, 3200, 3300, 3400, 3450, 3550, 4200],
+     [0, 0, 200, 250, 380, 500, 500]),
+]
+
+
+def c_div(a, b):
+    """C99 integer division (truncate toward zero)."""
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b >= 0) else -q
+
+
+def slopes(x, y):
+    out = []
+    for i in range(1, len(x)):
+        dx, dy = x[i] - x[i - 1], y[i] - y[i - 1]
+        if dx <= 0:
+            sys.exit("breakpoints must be strictly increasing")
+        m = math.ceil(abs(dy) * (1 << SHIFT) / dx)
+        if m >= (1 << 31):
+            sys.exit("slope overflows int32 — lower SHIFT")
+        for a in range(dx + 1):
+            want = c_div(dy * a, dx)
+            mag = (a * m) >> SHIFT
+            got = -mag if dy < 0 else mag
+            if got != want:
+                sys.exit("segment %d: x0+%d gives %d, want %d" % (i - 1, a, got, want))
+        out.append(-m if dy < 0 else m)
+    return out
+
+
+def fmt(vals, per_line=8):
+    lines = []
+    for i in range(0, len(vals), per_line):
+        lines.append("    " + ", ".join(str(v) for v in vals[i:i + per_line]))
+    return ",\n".join(lines)
+
+
+def emit():
+    out = []
+    out.append("""/**
+ * @file bms_derating_tables.h
+ * @brief Division-free current derating tables (§7.4, Figures 28/29/30)
+ *
+ * Street Smart Edition.
+ * GENERATED by tools/gen_derating_tables.py — do not edit by hand.
+ *
+ * slope[i] = ±ceil(|dy| × 2^BMS_DERATE_SLOPE_SHIFT / dx) for segment i;
+ * y = y[i] ± (((x − x[i]) × |slope[i]|) >> BMS_DERATE_SLOPE_SHIFT) matches
+ * the truncating y[i] + dy·(x − x[i])/dx exactly for every integer x.
+ */
+
+#ifndef BMS_DERATING_TABLES_H
+#define BMS_DERATING_TABLES_H
+
+#include <stdint.h>
+
+#define BMS_DERATE_SLOPE_SHIFT  %dU
+
+typedef struct {
+    const int32_t *x;       /* breakpoints, strictly increasing */
+    const int32_t *y;       /* C-rate × 100 at each breakpoint */
+    const int32_t *slope;   /* n − 1 signed Q%d slopes */
+    uint8_t        n;
+} bms_derate_curve_t;
+""" % (SHIFT, SHIFT))
+    for name, comment, x, y in CURVES:
+        if len(x) != len(y):
+            sys.exit("%s: x/y length mismatch" % name)
+        m = slopes(x, y)
+        out.append("/* %s */" % comment)
+        out.append("static const int32_t derate_%s_x[%d] = {\n%s\n};" % (name, len(x), fmt(x)))
+        out.append("static const int32_t derate_%s_y[%d] = {\n%s\n};" % (name, len(y), fmt(y)))
+        out.append("static const int32_t derate_%s_slope[%d] = {\n%s\n};" % (name, len(m), fmt(m, 4)))
+        out.append("static const bms_derate_curve_t k_derate_%s = {\n"
+                   "    derate_%s_x, derate_%s_y, derate_%s_slope, %dU\n};\n"
+                   % (name, name, name, name, len(x)))
+    out.append("#endif /* BMS_DERATING_TABLES_H */\n")
+    return "\n".join(out)
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    ap.add_argument("-o", "--output",
+                    default=os.path.join(here, "..", "inc", "bms_derating_tables.h"))
+    args = ap.parse_args()
+    with open(args.output, "w") as f:
+        f.write(emit())
+    print("wrote %s" % os.path.normpath(args.output))
+
+
+if __name__ == "__main__":
+    main()